@@ -16,6 +16,8 @@ SRCS += \
 OBJS := ${SRCS:.c=.o}
 
 CFLAGS += -march=native -DMERGE_ARRAY
+#CFLAGS += -DRANDOM_USE_XOSHIRO # or -DRANDOM_USE_PCG, -DRANDOM_USE_PHILOX
+#CFLAGS += -DRANDOM_FILL_LEMIRE
 
 # ==============================================================================
 #
@@ -45,17 +45,6 @@ void usage(char* argv0) {
     exit(-1);
 }
 
-static unsigned long random_uniform(random_t *r, unsigned long range) {
-    const unsigned long max = (((0xffffffffUL + 1) / range) * range);
-    unsigned long v;
-
-    do {
-        v = random_generate(r);
-    } while (v > max);
-
-    return v % range;
-}
-
 void work(data_t *data) {
     TM_THREAD_ENTER();
 
@@ -110,9 +99,9 @@ void work(data_t *data) {
     random_t *random = random_alloc();
     random_seed(random, thread_getId());
 
+    random_fill(random, offsets, data->ops_per_tx, data->size);
+    random_fill(random, ops, data->ops_per_tx, 100);
     for (unsigned int i = 0; i < data->ops_per_tx; ++i) {
-        offsets[i] = random_uniform(random, data->size);
-        ops[i] = random_uniform(random, 100);
         if (ops[i] < data->reads)
             ops[i] = 0;
     }
@@ -171,8 +160,7 @@ void init(data_t *data) {
     random_seed(data->random, 0);
 
     /* Generate the array */
-    for (unsigned long i = 0; i < data->size; ++i)
-        data->array[i] = random_generate(data->random);
+    random_fill(data->random, data->array, data->size, 0);
 }
 
 void compute(data_t *data) {
@@ -15,7 +15,9 @@ SRCS += \
 	net.c \
 	sort.c \
 	$(LIB)/bitmap.c \
+	$(LIB)/dataset.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/queue.c \
 	$(LIB)/random.c \
@@ -27,6 +29,8 @@ OBJS := ${SRCS:.c=.o}
 CFLAGS += -DLIST_NO_DUPLICATES
 CFLAGS += -DLEARNER_TRY_REMOVE
 CFLAGS += -DLEARNER_TRY_REVERSE
+#CFLAGS += -DUSE_PARALLEL_DATA_GENERATION
+#CFLAGS += -DUSE_DATA_CACHE
 CFLAGS += -DMERGE_LIST -DMERGE_LEARNER
 
 
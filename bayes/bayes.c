@@ -275,7 +275,7 @@ MAIN(argc, argv)
 
     data_t* dataPtr = data_alloc(numVar, numRecord, randomPtr);
     assert(dataPtr);
-    net_t* netPtr = data_generate(dataPtr, -1, maxNumParent, percentParent);
+    net_t* netPtr = data_generate(dataPtr, randomSeed, maxNumParent, percentParent);
     puts("done.");
     fflush(stdout);
 
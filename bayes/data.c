@@ -74,12 +74,28 @@
 #include <string.h>
 #include "bitmap.h"
 #include "data.h"
+#include "dataset.h"
 #include "net.h"
 #include "random.h"
 #include "sort.h"
+#include "thread.h"
 #include "types.h"
 #include "vector.h"
 
+
+#define DATA_STREAM_CHUNK (256) /* records per random stream */
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+typedef struct generateArg {
+    data_t* dataPtr;
+    net_t* netPtr;
+    long* order;
+    long** thresholdsTable;
+    unsigned long seed;
+} generateArg_t;
+#endif
+
 enum data_config {
     DATA_PRECISION = 100,
     DATA_INIT      = 2 /* not 0 or 1 */
@@ -125,10 +141,177 @@ data_free (data_t* dataPtr)
 }
 
 
+/* =============================================================================
+ * generateRecords
+ * -- Samples each variable in dependency order, so parents are set first
+ * =============================================================================
+ */
+static void
+generateRecords (char* record,
+                 long numRecord,
+                 long numVar,
+                 long* order,
+                 net_t* netPtr,
+                 long** thresholdsTable,
+                 random_t* randomPtr)
+{
+    long r;
+    for (r = 0; r < numRecord; r++) {
+        long o;
+        for (o = 0; o < numVar; o++) {
+            long v = order[o];
+            list_t* parentIdListPtr = net_getParentIdListPtr(netPtr, v);
+            long index = 0;
+            list_iter_t it;
+            list_iter_reset(&it, parentIdListPtr);
+            while (list_iter_hasNext(&it, parentIdListPtr)) {
+                long parentId = (long)list_iter_next(&it, parentIdListPtr);
+                long value = record[parentId];
+                assert(value != DATA_INIT);
+                index = (index << 1) + value;
+            }
+            long rnd = random_generate(randomPtr) % DATA_PRECISION;
+            long threshold = thresholdsTable[v][index];
+            record[v] = ((rnd < threshold) ? 1 : 0);
+        }
+        record += numVar;
+    }
+}
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+/* =============================================================================
+ * generateChunks
+ * -- Each DATA_STREAM_CHUNK of records draws from its own stream, so the
+ *    records do not depend on the number of threads
+ * =============================================================================
+ */
+static void
+generateChunks (void* argPtr)
+{
+    generateArg_t* generateArgPtr = (generateArg_t*)argPtr;
+    data_t* dataPtr = generateArgPtr->dataPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long numRecord = dataPtr->numRecord;
+    long numVar = dataPtr->numVar;
+    long numChunk = (numRecord + DATA_STREAM_CHUNK - 1) / DATA_STREAM_CHUNK;
+
+    random_t* randomPtr = random_alloc();
+    assert(randomPtr);
+
+    long c;
+    for (c = myId; c < numChunk; c += numThread) {
+        long start = c * DATA_STREAM_CHUNK;
+        long num = numRecord - start;
+        if (num > DATA_STREAM_CHUNK) {
+            num = DATA_STREAM_CHUNK;
+        }
+        random_seedStream(randomPtr, generateArgPtr->seed, c);
+        generateRecords(&dataPtr->records[start * numVar],
+                        num,
+                        numVar,
+                        generateArgPtr->order,
+                        generateArgPtr->netPtr,
+                        generateArgPtr->thresholdsTable,
+                        randomPtr);
+    }
+
+    random_free(randomPtr);
+}
+#endif /* USE_PARALLEL_DATA_GENERATION */
+
+
+/* =============================================================================
+ * makeRecords
+ * =============================================================================
+ */
+static void
+makeRecords (data_t* dataPtr,
+             net_t* netPtr,
+             long* order,
+             long** thresholdsTable,
+             random_t* randomPtr)
+{
+#ifdef USE_PARALLEL_DATA_GENERATION
+    generateArg_t arg;
+    arg.dataPtr = dataPtr;
+    arg.netPtr = netPtr;
+    arg.order = order;
+    arg.thresholdsTable = thresholdsTable;
+    arg.seed = random_generate(randomPtr);
+#  ifdef OTM
+#pragma omp parallel
+    {
+        generateChunks((void*)&arg);
+    }
+#  else
+    thread_start(generateChunks, (void*)&arg);
+#  endif
+#else /* !USE_PARALLEL_DATA_GENERATION */
+    generateRecords(dataPtr->records,
+                    dataPtr->numRecord,
+                    dataPtr->numVar,
+                    order,
+                    netPtr,
+                    thresholdsTable,
+                    randomPtr);
+#endif /* !USE_PARALLEL_DATA_GENERATION */
+}
+
+
+#ifdef USE_DATA_CACHE
+/* =============================================================================
+ * loadRecords
+ * -- Returns FALSE if there is no cached copy
+ * =============================================================================
+ */
+static bool_t
+loadRecords (data_t* dataPtr, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = dataset_open("bayes", params, numParam);
+    if (datasetPtr == NULL) {
+        return FALSE;
+    }
+
+    long numByte = dataPtr->numRecord * dataPtr->numVar;
+    long size;
+    const void* records = dataset_getSection(datasetPtr, 0, &size);
+    bool_t isLoaded = (records != NULL && size == numByte);
+    if (isLoaded) {
+        memcpy(dataPtr->records, records, numByte);
+    }
+    dataset_close(datasetPtr);
+
+    return isLoaded;
+}
+
+
+/* =============================================================================
+ * storeRecords
+ * =============================================================================
+ */
+static void
+storeRecords (data_t* dataPtr, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = dataset_create("bayes", params, numParam);
+    if (datasetPtr) {
+        bool_t status = dataset_addSection(datasetPtr,
+                                           dataPtr->records,
+                                           (dataPtr->numRecord * dataPtr->numVar));
+        dataset_commit(datasetPtr, status);
+    }
+}
+#endif /* USE_DATA_CACHE */
+
+
 /* =============================================================================
  * data_generate
  * -- Binary variables of random PDFs
  * -- If seed is <0, do not reseed
+ * -- With USE_DATA_CACHE, records for a given seed are cached on disk
+ * -- With USE_PARALLEL_DATA_GENERATION, records are made on all threads from
+ *    thread_startup
  * -- Returns random network
  * =============================================================================
  */
@@ -244,30 +427,18 @@ data_generate (data_t* dataPtr, long seed, long maxNumParent, long percentParent
      * Create records
      */
 
-    char* record = dataPtr->records;
-    long r;
-    long numRecord = dataPtr->numRecord;
-    for (r = 0; r < numRecord; r++) {
-        long o;
-        for (o = 0; o < numOrder; o++) {
-            long v = order[o];
-            list_t* parentIdListPtr = net_getParentIdListPtr(netPtr, v);
-            long index = 0;
-            list_iter_t it;
-            list_iter_reset(&it, parentIdListPtr);
-            while (list_iter_hasNext(&it, parentIdListPtr)) {
-                long parentId = (long)list_iter_next(&it, parentIdListPtr);
-                long value = record[parentId];
-                assert(value != DATA_INIT);
-                index = (index << 1) + value;
-            }
-            long rnd = random_generate(randomPtr) % DATA_PRECISION;
-            long threshold = thresholdsTable[v][index];
-            record[v] = ((rnd < threshold) ? 1 : 0);
+#ifdef USE_DATA_CACHE
+    /* Network and thresholds are cheap and always made; records are cached */
+    long params[] = {numVar, dataPtr->numRecord, maxNumParent, percentParent, seed};
+    if (seed < 0 || !loadRecords(dataPtr, params, 5)) {
+        makeRecords(dataPtr, netPtr, order, thresholdsTable, randomPtr);
+        if (seed >= 0) {
+            storeRecords(dataPtr, params, 5);
         }
-        record += numVar;
-        assert(record <= (dataPtr->records + numRecord * numVar));
     }
+#else /* !USE_DATA_CACHE */
+    makeRecords(dataPtr, netPtr, order, thresholdsTable, randomPtr);
+#endif /* !USE_DATA_CACHE */
 
     /*
      * Clean up
@@ -105,6 +105,9 @@ data_free (data_t* dataPtr);
  * data_generate
  * -- Binary variables of random PDFs
  * -- If seed is <0, do not reseed
+ * -- With USE_DATA_CACHE, records for a given seed are cached on disk
+ * -- With USE_PARALLEL_DATA_GENERATION, records are made on all threads from
+ *    thread_startup
  * -- Returns random network
  * =============================================================================
  */
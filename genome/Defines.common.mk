@@ -7,6 +7,9 @@
 
 CFLAGS += -DLIST_NO_DUPLICATES
 CFLAGS += -DCHUNK_STEP1=100 -DOUTPUT_VERIFY
+#CFLAGS += -DUSE_PARALLEL_DATA_GENERATION
+#CFLAGS += -DUSE_DATA_CACHE
+#CFLAGS += -DRANDOM_FILL_LEMIRE
 CFLAGS += -DMERGE_LIST -DMERGE_SEQUENCER -DMERGE_TABLE #-DMERGE_HASHTABLE
 
 PROG := genome
@@ -18,11 +21,13 @@ SRCS += \
 	sequencer.c \
 	table.c \
 	$(LIB)/bitmap.c \
+	$(LIB)/dataset.c \
 	$(LIB)/hash.c \
 	$(LIB)/hashtable.c \
 	$(LIB)/pair.c \
 	$(LIB)/random.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/thread.c \
 	$(LIB)/vector.c \
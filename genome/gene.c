@@ -75,7 +75,22 @@
 #include "gene.h"
 #include "nucleotide.h"
 #include "random.h"
+#include "thread.h"
 #include "tm.h"
+#include "utility.h"
+
+
+#define GENE_FILL_CHUNK   (256)
+#define GENE_STREAM_CHUNK (1L << 16) /* nucleotides per random stream */
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+typedef struct createArg {
+    char* contents;
+    long length;
+    unsigned long seed;
+} createArg_t;
+#endif
 
 
 /* =============================================================================
@@ -113,16 +128,14 @@ gene_alloc (long length)
 
 
 /* =============================================================================
- * gene_create
- * -- Populate contents with random gene
+ * fillContents
  * =============================================================================
  */
-void
-gene_create (gene_t* genePtr, random_t* randomPtr)
+static void
+fillContents (char* contents, long length, random_t* randomPtr)
 {
-    long length;
-    char* contents;
     long i;
+    unsigned long values[GENE_FILL_CHUNK];
     const char nucleotides[] = {
         NUCLEOTIDE_ADENINE,
         NUCLEOTIDE_CYTOSINE,
@@ -130,16 +143,77 @@ gene_create (gene_t* genePtr, random_t* randomPtr)
         NUCLEOTIDE_THYMINE,
     };
 
+    for (i = 0; i < length; i += GENE_FILL_CHUNK) {
+        long n = MIN(GENE_FILL_CHUNK, (length - i));
+        long j;
+        random_fill(randomPtr, values, n, NUCLEOTIDE_NUM_TYPE);
+        for (j = 0; j < n; j++) {
+            contents[i + j] = nucleotides[values[j]];
+        }
+    }
+}
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+/* =============================================================================
+ * createChunks
+ * -- Each GENE_STREAM_CHUNK draws from its own stream, so the gene does not
+ *    depend on the number of threads
+ * =============================================================================
+ */
+static void
+createChunks (void* argPtr)
+{
+    createArg_t* createArgPtr = (createArg_t*)argPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long numChunk = (createArgPtr->length + GENE_STREAM_CHUNK - 1) / GENE_STREAM_CHUNK;
+
+    random_t* randomPtr = random_alloc();
+    assert(randomPtr);
+
+    long c;
+    for (c = myId; c < numChunk; c += numThread) {
+        long start = c * GENE_STREAM_CHUNK;
+        random_seedStream(randomPtr, createArgPtr->seed, c);
+        fillContents(&createArgPtr->contents[start],
+                     MIN(GENE_STREAM_CHUNK, (createArgPtr->length - start)),
+                     randomPtr);
+    }
+
+    random_free(randomPtr);
+}
+#endif /* USE_PARALLEL_DATA_GENERATION */
+
+
+/* =============================================================================
+ * gene_create
+ * -- Populate contents with random gene
+ * -- With USE_PARALLEL_DATA_GENERATION, runs on all threads from thread_startup
+ * =============================================================================
+ */
+void
+gene_create (gene_t* genePtr, random_t* randomPtr)
+{
     assert(genePtr != NULL);
     assert(randomPtr != NULL);
 
-    length = genePtr->length;
-    contents = genePtr->contents;
-
-    for (i = 0; i < length; i++) {
-        contents[i] =
-            nucleotides[(random_generate(randomPtr)% NUCLEOTIDE_NUM_TYPE)];
+#ifdef USE_PARALLEL_DATA_GENERATION
+    createArg_t arg;
+    arg.contents = genePtr->contents;
+    arg.length = genePtr->length;
+    arg.seed = random_generate(randomPtr);
+#  ifdef OTM
+#pragma omp parallel
+    {
+        createChunks((void*)&arg);
     }
+#  else
+    thread_start(createChunks, (void*)&arg);
+#  endif
+#else /* !USE_PARALLEL_DATA_GENERATION */
+    fillContents(genePtr->contents, genePtr->length, randomPtr);
+#endif /* !USE_PARALLEL_DATA_GENERATION */
 }
 
 
@@ -98,6 +98,7 @@ gene_alloc (long length);
 /* =============================================================================
  * gene_create
  * -- Populate contents with random gene
+ * -- With USE_PARALLEL_DATA_GENERATION, runs on all threads from thread_startup
  * =============================================================================
  */
 void
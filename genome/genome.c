@@ -74,6 +74,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "dataset.h"
 #include "gene.h"
 #include "random.h"
 #include "segments.h"
@@ -175,6 +176,65 @@ parseArgs (long argc, char* const argv[])
 }
 
 
+#ifdef USE_DATA_CACHE
+/* =============================================================================
+ * loadInput
+ * -- Returns FALSE if there is no cached copy
+ * =============================================================================
+ */
+static bool_t
+loadInput (gene_t* genePtr, segments_t* segmentsPtr, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = dataset_open("genome", params, numParam);
+    if (datasetPtr == NULL) {
+        return FALSE;
+    }
+
+    long geneSize;
+    long packedSize;
+    const char* gene = (const char*)dataset_getSection(datasetPtr, 0, &geneSize);
+    const char* packed = (const char*)dataset_getSection(datasetPtr, 1, &packedSize);
+    bool_t isLoaded = (gene != NULL && geneSize == genePtr->length &&
+                       packed != NULL &&
+                       (packedSize % segmentsPtr->length) == 0 &&
+                       (packedSize / segmentsPtr->length) >= segmentsPtr->minNum);
+    if (isLoaded) {
+        memcpy(genePtr->contents, gene, geneSize);
+        segments_restore(segmentsPtr, packed, (packedSize / segmentsPtr->length));
+    }
+    dataset_close(datasetPtr);
+
+    return isLoaded;
+}
+
+
+/* =============================================================================
+ * storeInput
+ * =============================================================================
+ */
+static void
+storeInput (gene_t* genePtr, segments_t* segmentsPtr, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = dataset_create("genome", params, numParam);
+    if (datasetPtr == NULL) {
+        return;
+    }
+
+    vector_t* segmentsContentsPtr = segmentsPtr->contentsPtr;
+    long numSegment = vector_getSize(segmentsContentsPtr);
+    bool_t status = dataset_addSection(datasetPtr, genePtr->contents, genePtr->length);
+    status = status && dataset_addSection(datasetPtr, NULL, 0);
+    long i;
+    for (i = 0; status && i < numSegment; i++) {
+        status = dataset_extendSection(datasetPtr,
+                                       vector_at(segmentsContentsPtr, i),
+                                       segmentsPtr->length);
+    }
+    dataset_commit(datasetPtr, status);
+}
+#endif /* USE_DATA_CACHE */
+
+
 /* =============================================================================
  * main
  * =============================================================================
@@ -208,12 +268,22 @@ MAIN (argc,argv)
 
     gene_t* genePtr = gene_alloc(geneLength);
     assert( genePtr != NULL);
-    gene_create(genePtr, randomPtr);
     char* gene = genePtr->contents;
 
     segments_t* segmentsPtr = segments_alloc(segmentLength, minNumSegment);
     assert(segmentsPtr != NULL);
+
+#ifdef USE_DATA_CACHE
+    long params[] = {geneLength, segmentLength, minNumSegment, 0 /* seed */};
+    if (!loadInput(genePtr, segmentsPtr, params, 4)) {
+        gene_create(genePtr, randomPtr);
+        segments_create(segmentsPtr, genePtr, randomPtr);
+        storeInput(genePtr, segmentsPtr, params, 4);
+    }
+#else /* !USE_DATA_CACHE */
+    gene_create(genePtr, randomPtr);
     segments_create(segmentsPtr, genePtr, randomPtr);
+#endif /* !USE_DATA_CACHE */
     sequencer_t* sequencerPtr = sequencer_alloc(geneLength, segmentLength, segmentsPtr);
     assert(sequencerPtr != NULL);
 
@@ -76,10 +76,27 @@
 #include "gene.h"
 #include "random.h"
 #include "segments.h"
+#include "thread.h"
 #include "utility.h"
 #include "vector.h"
 
 
+#define SEGMENTS_STREAM_CHUNK (4096) /* segments per random stream */
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+typedef struct createArg {
+    char** strings;
+    unsigned long* starts;
+    long num;
+    long numStart;
+    long segmentLength;
+    char* geneString;
+    unsigned long seed;
+} createArg_t;
+#endif
+
+
 /* =============================================================================
  * segments_alloc
  * -- Does almost all the memory allocation for random segments
@@ -126,9 +143,51 @@ segments_alloc (long length, long minNum)
 }
 
 
+#ifdef USE_PARALLEL_DATA_GENERATION
+/* =============================================================================
+ * createChunks
+ * -- Picks and copies the initial segments; each SEGMENTS_STREAM_CHUNK draws
+ *    from its own stream, so the picks do not depend on the number of threads
+ * =============================================================================
+ */
+static void
+createChunks (void* argPtr)
+{
+    createArg_t* createArgPtr = (createArg_t*)argPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long num = createArgPtr->num;
+    long numChunk = (num + SEGMENTS_STREAM_CHUNK - 1) / SEGMENTS_STREAM_CHUNK;
+
+    random_t* randomPtr = random_alloc();
+    assert(randomPtr);
+
+    long c;
+    for (c = myId; c < numChunk; c += numThread) {
+        long start = c * SEGMENTS_STREAM_CHUNK;
+        long stop = MIN((start + SEGMENTS_STREAM_CHUNK), num);
+        random_seedStream(randomPtr, createArgPtr->seed, c);
+        random_fill(randomPtr,
+                    &createArgPtr->starts[start],
+                    (stop - start),
+                    createArgPtr->numStart);
+        long i;
+        for (i = start; i < stop; i++) {
+            memcpy(createArgPtr->strings[i],
+                   &(createArgPtr->geneString[createArgPtr->starts[i]]),
+                   createArgPtr->segmentLength * sizeof(char));
+        }
+    }
+
+    random_free(randomPtr);
+}
+#endif /* USE_PARALLEL_DATA_GENERATION */
+
+
 /* =============================================================================
  * segments_create
  * -- Populates 'contentsPtr'
+ * -- With USE_PARALLEL_DATA_GENERATION, runs on all threads from thread_startup
  * =============================================================================
  */
 void
@@ -160,6 +219,32 @@ segments_create (segments_t* segmentsPtr, gene_t* genePtr, random_t* randomPtr)
     numStart = geneLength - segmentLength + 1;
 
     /* Pick some random segments to start */
+#ifdef USE_PARALLEL_DATA_GENERATION
+    createArg_t arg;
+    arg.strings = strings;
+    arg.starts = (unsigned long*)malloc(minNumSegment * sizeof(unsigned long));
+    assert(arg.starts);
+    arg.num = minNumSegment;
+    arg.numStart = numStart;
+    arg.segmentLength = segmentLength;
+    arg.geneString = geneString;
+    arg.seed = random_generate(randomPtr);
+#  ifdef OTM
+#pragma omp parallel
+    {
+        createChunks((void*)&arg);
+    }
+#  else
+    thread_start(createChunks, (void*)&arg);
+#  endif
+    for (i = 0; i < minNumSegment; i++) {
+        bool_t status = bitmap_set(startBitmapPtr, arg.starts[i]);
+        assert(status);
+        status = vector_pushBack(segmentsContentsPtr, (void*)strings[i]);
+        assert(status);
+    }
+    free(arg.starts);
+#else /* !USE_PARALLEL_DATA_GENERATION */
     for (i = 0; i < minNumSegment; i++) {
         long j = (long)(random_generate(randomPtr) % numStart);
         bool_t status = bitmap_set(startBitmapPtr, j);
@@ -168,6 +253,7 @@ segments_create (segments_t* segmentsPtr, gene_t* genePtr, random_t* randomPtr)
         status = vector_pushBack(segmentsContentsPtr, (void*)strings[i]);
         assert(status);
     }
+#endif /* !USE_PARALLEL_DATA_GENERATION */
 
     /* Make sure segment covers start */
     i = 0;
@@ -205,6 +291,39 @@ segments_create (segments_t* segmentsPtr, gene_t* genePtr, random_t* randomPtr)
 }
 
 
+/* =============================================================================
+ * segments_restore
+ * -- Populates 'contentsPtr' from 'numSegment' segments stored back to back,
+ *    as saved from an earlier segments_create
+ * -- Does not touch the gene's start bitmap, which only segments_create uses
+ * =============================================================================
+ */
+void
+segments_restore (segments_t* segmentsPtr, const char* packed, long numSegment)
+{
+    long segmentLength = segmentsPtr->length;
+    long minNum = segmentsPtr->minNum;
+    char** strings = segmentsPtr->strings;
+    long i;
+
+    assert(numSegment >= minNum);
+
+    for (i = 0; i < numSegment; i++) {
+        char* string;
+        if (i < minNum) {
+            string = strings[i];
+        } else {
+            string = (char*)malloc((segmentLength+1) * sizeof(char));
+            assert(string);
+            string[segmentLength] = '\0';
+        }
+        memcpy(string, &packed[i * segmentLength], segmentLength * sizeof(char));
+        bool_t status = vector_pushBack(segmentsPtr->contentsPtr, (void*)string);
+        assert(status);
+    }
+}
+
+
 /* =============================================================================
  * segments_free
  * =============================================================================
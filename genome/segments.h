@@ -103,12 +103,24 @@ segments_alloc (long length, long minNum);
 /* =============================================================================
  * segments_create
  * -- Populates 'contentsPtr'
+ * -- With USE_PARALLEL_DATA_GENERATION, runs on all threads from thread_startup
  * =============================================================================
  */
 void
 segments_create (segments_t* segmentsPtr, gene_t* genePtr, random_t* randomPtr);
 
 
+/* =============================================================================
+ * segments_restore
+ * -- Populates 'contentsPtr' from 'numSegment' segments stored back to back,
+ *    as saved from an earlier segments_create
+ * -- Does not touch the gene's start bitmap, which only segments_create uses
+ * =============================================================================
+ */
+void
+segments_restore (segments_t* segmentsPtr, const char* packed, long numSegment);
+
+
 /* =============================================================================
  * segments_free
  * =============================================================================
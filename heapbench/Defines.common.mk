@@ -0,0 +1,26 @@
+# ==============================================================================
+#
+# Defines.common.mk
+#
+# ==============================================================================
+
+PROG := heapbench
+
+#CFLAGS += -DHEAP_ARITY=4 -DHEAP_CACHED_KEY # or -DHEAP_USE_MULTIQUEUE
+CFLAGS += -DMERGE_HEAP
+
+SRCS += \
+	heapbench.c \
+	$(LIB)/heap.c \
+	$(LIB)/mqheap.c \
+	$(LIB)/mt19937ar.c \
+	$(LIB)/random.c \
+	$(LIB)/thread.c \
+
+OBJS := ${SRCS:.c=.o}
+
+# ==============================================================================
+#
+# End of Defines.common.mk
+#
+# ==============================================================================
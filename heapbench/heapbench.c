@@ -0,0 +1,281 @@
+/* =============================================================================
+ *
+ * heapbench.c
+ * -- Priority queue microbenchmark for heap.h layouts
+ *
+ * =============================================================================
+ *
+ * The heap is filled with -i items, each a cache line of its own in a shuffled
+ * array, so that following an element pointer is a likely cache miss, as it is
+ * for yada's elements. Each thread then runs the hold model: every operation
+ * removes the top item and reinserts one with a new priority, -n operations
+ * per transaction, so the heap size stays constant. Build with -DHEAP_ARITY=<d>
+ * and/or -DHEAP_CACHED_KEY (or -DHEAP_USE_MULTIQUEUE) to compare layouts; run
+ * under 'perf stat -e cache-misses' for misses per operation.
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "heap.h"
+#include "random.h"
+#include "thread.h"
+#include "timer.h"
+#include "tm.h"
+
+typedef struct item {
+    long priority;
+    char pad[64 - sizeof(long)];
+} item_t;
+
+typedef struct {
+    heap_t *heap;
+    item_t *items;
+    long **priorities;
+
+    unsigned long initial;
+    unsigned long range;
+    unsigned long ops_per_tx;
+    unsigned long seed;
+    unsigned long threads;
+    unsigned long transactions;
+    double time;
+} data_t;
+
+HTM_STATS(global_tsx_status);
+
+TM_INIT_GLOBAL;
+
+void usage(char* argv0) {
+    const char help[] =
+        "Usage: %s [switches]\n"
+        "       -i               number of items in the heap\n"
+        "       -k               range of priorities\n"
+        "       -n               number of operations per transaction\n"
+        "       -o               total number of transactions\n"
+        "       -s               random seed\n"
+        "       -t               number of threads\n";
+    fprintf(stderr, help, argv0);
+    exit(-1);
+}
+
+static long compare(const void *a, const void *b) {
+    long pa = ((const item_t *)a)->priority;
+    long pb = ((const item_t *)b)->priority;
+
+    return ((pa > pb) ? 1 : ((pa < pb) ? -1 : 0));
+}
+
+static long key(const void *a) {
+    return ((const item_t *)a)->priority;
+}
+
+static unsigned long random_uniform(random_t *r, unsigned long range) {
+    const unsigned long max = (((0xffffffffUL + 1) / range) * range);
+    unsigned long v;
+
+    do {
+        v = random_generate(r);
+    } while (v >= max);
+
+    return v % range;
+}
+
+static unsigned long stream_length(data_t *data) {
+    return (data->transactions / data->threads) * data->ops_per_tx;
+}
+
+void work(data_t *data) {
+    TM_THREAD_ENTER();
+
+    const long id = thread_getId();
+    const long *priorities = data->priorities[id];
+
+    HTM_TX_INIT;
+    for (unsigned long i = 0; i < data->transactions / data->threads; ++i) {
+        const unsigned long base = i * data->ops_per_tx;
+tsx_begin:
+        if (HTM_BEGIN(tsx_status, global_tsx_status)) {
+            HTM_LOCK_READ();
+            for (unsigned long j = base; j < base + data->ops_per_tx; ++j) {
+                item_t *item = (item_t *)HTMHEAP_REMOVE(data->heap);
+                HTM_SHARED_WRITE(item->priority, priorities[j]);
+                HTMHEAP_INSERT(data->heap, item);
+            }
+            HTM_END(global_tsx_status);
+        } else {
+            HTM_RETRY(tsx_status, tsx_begin);
+
+            TM_BEGIN();
+            for (unsigned long j = base; j < base + data->ops_per_tx; ++j) {
+                item_t *item = (item_t *)TMHEAP_REMOVE(data->heap);
+                TM_SHARED_WRITE(item->priority, priorities[j]);
+                TMHEAP_INSERT(data->heap, item);
+            }
+            TM_END();
+        }
+    }
+
+    TM_THREAD_EXIT();
+}
+
+void init(data_t *data) {
+    const unsigned long length = stream_length(data);
+    random_t *random = random_alloc();
+    item_t **order = malloc(data->initial * sizeof(*order));
+
+    data->items = aligned_alloc(sizeof(item_t), data->initial * sizeof(item_t));
+    data->heap = heap_alloc(data->initial, compare);
+    assert(random && order && data->items && data->heap);
+    heap_setKey(data->heap, key);
+
+    /* Insert in shuffled address order, so heap neighbours are far apart */
+    random_seed(random, data->seed);
+    for (unsigned long i = 0; i < data->initial; ++i) {
+        data->items[i].priority = (long)random_uniform(random, data->range);
+        order[i] = &data->items[i];
+    }
+    for (unsigned long i = data->initial - 1; i > 0; --i) {
+        unsigned long j = random_uniform(random, i + 1);
+        item_t *tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+    for (unsigned long i = 0; i < data->initial; ++i) {
+        bool_t status = heap_insert(data->heap, order[i]);
+        assert(status);
+    }
+
+    /* One priority stream per thread */
+    data->priorities = malloc(data->threads * sizeof(*data->priorities));
+    assert(data->priorities);
+    for (unsigned long t = 0; t < data->threads; ++t) {
+        data->priorities[t] = malloc(length * sizeof(**data->priorities));
+        assert(data->priorities[t]);
+        random_seed(random, data->seed + t + 1);
+        for (unsigned long j = 0; j < length; ++j)
+            data->priorities[t][j] = (long)random_uniform(random, data->range);
+    }
+
+    free(order);
+    random_free(random);
+}
+
+void compute(data_t *data) {
+    TIMER_T start, stop;
+
+    TIMER_READ(start);
+    GOTO_SIM();
+
+    {
+#ifdef OTM
+#pragma omp parallel
+        work(data);
+#else
+        thread_start((void (*)(void *))work, data);
+#endif
+    }
+
+    GOTO_REAL();
+
+    TIMER_READ(stop);
+    data->time = TIMER_DIFF_SECONDS(start, stop);
+}
+
+static bool_t verify(data_t *data) {
+    item_t *prev = NULL;
+    unsigned long size = 0;
+    item_t *item;
+
+    if (!heap_isValid(data->heap))
+        return FALSE;
+
+    /* Drains the heap; exact order is not guaranteed with -DHEAP_USE_MULTIQUEUE */
+    while ((item = (item_t *)heap_remove(data->heap)) != NULL) {
+#ifndef HEAP_USE_MULTIQUEUE
+        if (prev && compare(item, prev) > 0)
+            return FALSE;
+#endif
+        prev = item;
+        size++;
+    }
+
+    return (size == data->initial) ? TRUE : FALSE;
+}
+
+void cleanup(data_t *data) {
+    for (unsigned long t = 0; t < data->threads; ++t)
+        free(data->priorities[t]);
+    free(data->priorities);
+    heap_free(data->heap);
+    free(data->items);
+}
+
+int main(int argc, char **argv) {
+    data_t data = { .initial = 16384, .range = 1 << 20, .ops_per_tx = 1, .seed = 0, .transactions = 1 << 20, .threads = 1 };
+    int opt;
+
+    GOTO_REAL();
+
+    while ((opt = getopt(argc,(char**)argv,"i:k:n:o:s:t:")) != EOF) {
+        switch (opt) {
+            case 'i': data.initial = atol(optarg);
+                break;
+            case 'k': data.range = atol(optarg);
+                break;
+            case 'n': data.ops_per_tx = atol(optarg);
+                break;
+            case 'o': data.transactions = atol(optarg);
+                break;
+            case 's': data.seed = atol(optarg);
+                break;
+            case 't': data.threads = atol(optarg);
+                break;
+            default:  usage((char*)argv[0]);
+                break;
+        }
+    }
+
+    if (!data.initial || !data.range || !data.ops_per_tx || !data.threads || !data.transactions) {
+        fprintf(stderr, "Error: invalid parameter values\n");
+        usage((char*)argv[0]);
+    }
+    printf("Heap size = %ld\nPriority range = %ld\nOperations per TX = %ld\nSeed = %ld\nTransactions = %ld\nThreads = %ld\n", data.initial, data.range, data.ops_per_tx, data.seed, data.transactions, data.threads);
+
+    SIM_GET_NUM_CPU(data.threads);
+    TM_STARTUP(data.threads);
+    thread_startup(data.threads);
+
+    init(&data);
+
+    compute(&data);
+    printf("Time = %f\n", data.time);
+    printf("Operations per second = %.0f\n", (double)stream_length(&data) * data.threads / data.time);
+
+    HTM_STATS_PRINT(global_tsx_status);
+
+    TM_SHUTDOWN();
+    GOTO_SIM();
+
+    printf("Verification = %s\n", verify(&data) ? "passed" : "failed");
+
+    cleanup(&data);
+
+    thread_shutdown();
+    return 0;
+}
+
+
+/* =============================================================================
+ *
+ * End of heapbench.c
+ *
+ * =============================================================================
+ */
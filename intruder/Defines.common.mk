@@ -15,18 +15,30 @@ SRCS += \
 	packet.c \
 	preprocessor.c \
 	stream.c \
+	$(LIB)/atree.c \
+	$(LIB)/dataset.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/pair.c \
 	$(LIB)/queue.c \
 	$(LIB)/random.c \
 	$(LIB)/rbtree.c \
+	$(LIB)/crbtree.c \
+	$(LIB)/rqueue.c \
+	$(LIB)/skiplist.c \
 	$(LIB)/thread.c \
 	$(LIB)/vector.c \
 #
 OBJS := ${SRCS:.c=.o}
 
-CFLAGS += -DMAP_USE_RBTREE
+CFLAGS += -DMAP_USE_RBTREE # or -DMAP_USE_ATREE, -DMAP_USE_SKIPLIST
+#CFLAGS += -DRBTREE_COMPACT
+#CFLAGS += -DQUEUE_USE_RING
+#CFLAGS += -DUSE_PARALLEL_DATA_GENERATION
+#CFLAGS += -DUSE_DATA_CACHE
+#CFLAGS += -DRANDOM_USE_XOSHIRO # or -DRANDOM_USE_PCG, -DRANDOM_USE_PHILOX
+#CFLAGS += -DRANDOM_FILL_LEMIRE
 CFLAGS += -DMERGE_LIST -DMERGE_QUEUE -DMERGE_RBTREE -DMERGE_DECODER -DMERGE_INTRUDER
 
 
@@ -249,6 +249,10 @@ processPackets (void* argPtr)
 
     while (1) {
         HTM_TX_INIT;
+#ifdef QUEUE_USE_RING
+        /* Lock-free pop, cannot be rolled back, so no transaction */
+        bytes = STREAM_GETPACKET(streamPtr);
+#else /* !QUEUE_USE_RING */
 tsx_begin_getpacket:
         if (HTM_BEGIN(tsx_status, global_tsx_status)) {
             HTM_LOCK_READ();
@@ -266,6 +270,7 @@ tsx_begin_getpacket:
             // TM_LOG_END(INTRUDER_PACKET, NULL);
             TM_END();
         }
+#endif /* !QUEUE_USE_RING */
 
         if (!bytes) {
             break;
@@ -73,22 +73,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include "dataset.h"
 #include "detector.h"
 #include "dictionary.h"
 #include "map.h"
 #include "packet.h"
 #include "queue.h"
 #include "random.h"
+#include "rqueue.h"
 #include "stream.h"
+#include "thread.h"
 #include "tm.h"
+#include "utility.h"
 #include "vector.h"
 
 
+#define STREAM_CHUNK (256) /* flows per random stream */
+
+
 struct stream {
     long percentAttack;
     random_t* randomPtr;
     vector_t* allocVectorPtr;
     queue_t* packetQueuePtr;
+#ifdef QUEUE_USE_RING
+    rqueue_t* packetRingPtr;  /* packetQueuePtr's contents, popped by workers */
+#endif
     MAP_T* attackMapPtr;
 };
 
@@ -111,6 +121,10 @@ stream_alloc (long percentAttack)
         assert(streamPtr->allocVectorPtr);
         streamPtr->packetQueuePtr = queue_alloc(-1);
         assert(streamPtr->packetQueuePtr);
+#ifdef QUEUE_USE_RING
+        streamPtr->packetRingPtr = rqueue_alloc(-1);
+        assert(streamPtr->packetRingPtr);
+#endif
         streamPtr->attackMapPtr = MAP_ALLOC(NULL, NULL);
         assert(streamPtr->attackMapPtr);
     }
@@ -137,12 +151,35 @@ stream_free (stream_t* streamPtr)
 
     MAP_FREE(streamPtr->attackMapPtr, NULL);
     queue_free(streamPtr->packetQueuePtr);
+#ifdef QUEUE_USE_RING
+    rqueue_free(streamPtr->packetRingPtr);
+#endif
     vector_free(streamPtr->allocVectorPtr);
     random_free(streamPtr->randomPtr);
     free(streamPtr);
 }
 
 
+typedef struct flow {
+    char* str;
+    long numPacket;
+    bool_t isAttack;
+    bool_t isAllocated;             /* str is ours to free, not the dictionary's */
+} flow_t;
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+typedef struct generateArg {
+    flow_t* flows;
+    long numFlow;
+    dictionary_t* dictionaryPtr;
+    long percentAttack;
+    long maxLength;
+    unsigned long seed;
+} generateArg_t;
+#endif
+
+
 /* =============================================================================
  * splitIntoPackets
  * -- Packets will be equal-size chunks except for last one, which will have
@@ -152,13 +189,11 @@ stream_free (stream_t* streamPtr)
 static void
 splitIntoPackets (char* str,
                   long flowId,
-                  random_t* randomPtr,
+                  long numPacket,
                   vector_t* allocVectorPtr,
                   queue_t* packetQueuePtr)
 {
     long numByte = strlen(str);
-    long numPacket = random_generate(randomPtr) % numByte + 1;
-
     long numDataByte = numByte / numPacket;
 
     long p;
@@ -196,77 +231,367 @@ splitIntoPackets (char* str,
 
 
 /* =============================================================================
- * stream_generate
- * -- Returns number of attacks generated
+ * generateFlow
+ * -- Picks a known attack or a random string, and how many packets to split
+ *    it into; 'values' must hold 'maxLength' entries
  * =============================================================================
  */
-long
-stream_generate (stream_t* streamPtr,
-                 dictionary_t* dictionaryPtr,
-                 long numFlow,
-                 long seed,
-                 long maxLength)
+static void
+generateFlow (flow_t* flowPtr,
+              random_t* randomPtr,
+              detector_t* detectorPtr,
+              dictionary_t* dictionaryPtr,
+              unsigned long* values,
+              long percentAttack,
+              long maxLength)
 {
-    long numAttack = 0;
+    long range = '~' - ' ' + 1;
+    assert(range > 0);
 
-    long      percentAttack  = streamPtr->percentAttack;
-    random_t* randomPtr      = streamPtr->randomPtr;
-    vector_t* allocVectorPtr = streamPtr->allocVectorPtr;
-    queue_t*  packetQueuePtr = streamPtr->packetQueuePtr;
-    MAP_T*    attackMapPtr   = streamPtr->attackMapPtr;
+    if ((random_generate(randomPtr) % 100) < percentAttack) {
+        long s = random_generate(randomPtr) % global_numDefaultSignature;
+        flowPtr->str = dictionary_get(dictionaryPtr, s);
+        flowPtr->isAttack = TRUE;
+        flowPtr->isAllocated = FALSE;
+    } else {
+        /*
+         * Create random string
+         */
+        long length = (random_generate(randomPtr) % maxLength) + 1;
+        char* str = (char*)malloc((length + 1) * sizeof(char));
+        assert(str);
+        long l;
+        random_fill(randomPtr, values, length, range);
+        for (l = 0; l < length; l++) {
+            str[l] = ' ' + (char)values[l];
+        }
+        str[l] = '\0';
+        char* str2 = (char*)malloc((length + 1) * sizeof(char));
+        assert(str2);
+        strcpy(str2, str);
+        error_t error = detector_process(detectorPtr, str2); /* updates in-place */
+        flowPtr->str = str;
+        flowPtr->isAttack = ((error == ERROR_SIGNATURE) ? TRUE : FALSE);
+        flowPtr->isAllocated = TRUE;
+        free(str2);
+    }
 
+    flowPtr->numPacket = random_generate(randomPtr) % strlen(flowPtr->str) + 1;
+}
+
+
+/* =============================================================================
+ * addFlow
+ * -- Records the flow and queues its packets; returns TRUE if it is an attack
+ * =============================================================================
+ */
+static bool_t
+addFlow (stream_t* streamPtr, flow_t* flowPtr, long flowId)
+{
+    if (flowPtr->isAllocated) {
+        bool_t status = vector_pushBack(streamPtr->allocVectorPtr,
+                                        (void*)flowPtr->str);
+        assert(status);
+    }
+    if (flowPtr->isAttack) {
+        bool_t status = MAP_INSERT(streamPtr->attackMapPtr,
+                                   (void*)flowId,
+                                   (void*)flowPtr->str);
+        assert(status);
+    }
+    splitIntoPackets(flowPtr->str,
+                     flowId,
+                     flowPtr->numPacket,
+                     streamPtr->allocVectorPtr,
+                     streamPtr->packetQueuePtr);
+
+    return flowPtr->isAttack;
+}
+
+
+#ifdef USE_PARALLEL_DATA_GENERATION
+/* =============================================================================
+ * generateChunks
+ * -- Each STREAM_CHUNK of flows draws from its own stream, so the flows do not
+ *    depend on the number of threads
+ * =============================================================================
+ */
+static void
+generateChunks (void* argPtr)
+{
+    generateArg_t* generateArgPtr = (generateArg_t*)argPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long numFlow = generateArgPtr->numFlow;
+    long numChunk = (numFlow + STREAM_CHUNK - 1) / STREAM_CHUNK;
+
+    random_t* randomPtr = random_alloc();
+    assert(randomPtr);
     detector_t* detectorPtr = detector_alloc();
     assert(detectorPtr);
     detector_addPreprocessor(detectorPtr, &preprocessor_toLower);
+    unsigned long* values =
+        (unsigned long*)malloc(generateArgPtr->maxLength * sizeof(unsigned long));
+    assert(values);
+
+    long c;
+    for (c = myId; c < numChunk; c += numThread) {
+        long start = c * STREAM_CHUNK;
+        long stop = MIN((start + STREAM_CHUNK), numFlow);
+        random_seedStream(randomPtr, generateArgPtr->seed, c);
+        long f;
+        for (f = start; f < stop; f++) {
+            generateFlow(&generateArgPtr->flows[f],
+                         randomPtr,
+                         detectorPtr,
+                         generateArgPtr->dictionaryPtr,
+                         values,
+                         generateArgPtr->percentAttack,
+                         generateArgPtr->maxLength);
+        }
+    }
 
-    random_seed(randomPtr, seed);
-    queue_clear(packetQueuePtr);
+    free(values);
+    detector_free(detectorPtr);
+    random_free(randomPtr);
+}
+#endif /* USE_PARALLEL_DATA_GENERATION */
 
-    long range = '~' - ' ' + 1;
-    assert(range > 0);
+
+/* =============================================================================
+ * makeStream
+ * -- Returns number of attacks generated
+ * =============================================================================
+ */
+static long
+makeStream (stream_t* streamPtr,
+            dictionary_t* dictionaryPtr,
+            long numFlow,
+            long maxLength)
+{
+    long numAttack = 0;
+    random_t* randomPtr = streamPtr->randomPtr;
 
     long f;
+#ifdef USE_PARALLEL_DATA_GENERATION
+    /* Flows are made in parallel, then added in order */
+    generateArg_t arg;
+    arg.flows = (flow_t*)malloc(numFlow * sizeof(flow_t));
+    assert(arg.flows);
+    arg.numFlow = numFlow;
+    arg.dictionaryPtr = dictionaryPtr;
+    arg.percentAttack = streamPtr->percentAttack;
+    arg.maxLength = maxLength;
+    arg.seed = random_generate(randomPtr);
+#  ifdef OTM
+#pragma omp parallel
+    {
+        generateChunks((void*)&arg);
+    }
+#  else
+    thread_start(generateChunks, (void*)&arg);
+#  endif
     for (f = 1; f <= numFlow; f++) {
-        char* str;
-        if ((random_generate(randomPtr) % 100) < percentAttack) {
-            long s = random_generate(randomPtr) % global_numDefaultSignature;
-            str = dictionary_get(dictionaryPtr, s);
-            bool_t status =
-                MAP_INSERT(attackMapPtr, (void*)f, (void*)str);
-            assert(status);
+        if (addFlow(streamPtr, &arg.flows[f - 1], f)) {
             numAttack++;
-        } else {
-            /*
-             * Create random string
-             */
-            long length = (random_generate(randomPtr) % maxLength) + 1;
-            str = (char*)malloc((length + 1) * sizeof(char));
-            bool_t status = vector_pushBack(allocVectorPtr, (void*)str);
-            assert(status);
-            long l;
-            for (l = 0; l < length; l++) {
-                str[l] = ' ' + (char)(random_generate(randomPtr) % range);
-            }
-            str[l] = '\0';
-            char* str2 = (char*)malloc((length + 1) * sizeof(char));
-            assert(str2);
-            strcpy(str2, str);
-            error_t error = detector_process(detectorPtr, str2); /* updates in-place */
-            if (error == ERROR_SIGNATURE) {
-                bool_t status = MAP_INSERT(attackMapPtr,
-                                           (void*)f,
-                                           (void*)str);
-                assert(status);
-                numAttack++;
-            }
-            free(str2);
         }
-        splitIntoPackets(str, f, randomPtr, allocVectorPtr, packetQueuePtr);
     }
+    free(arg.flows);
+#else /* !USE_PARALLEL_DATA_GENERATION */
+    detector_t* detectorPtr = detector_alloc();
+    assert(detectorPtr);
+    detector_addPreprocessor(detectorPtr, &preprocessor_toLower);
+    unsigned long* values = (unsigned long*)malloc(maxLength * sizeof(unsigned long));
+    assert(values);
 
-    queue_shuffle(packetQueuePtr, randomPtr);
+    for (f = 1; f <= numFlow; f++) {
+        flow_t flow;
+        generateFlow(&flow,
+                     randomPtr,
+                     detectorPtr,
+                     dictionaryPtr,
+                     values,
+                     streamPtr->percentAttack,
+                     maxLength);
+        if (addFlow(streamPtr, &flow, f)) {
+            numAttack++;
+        }
+    }
 
+    free(values);
     detector_free(detectorPtr);
+#endif /* !USE_PARALLEL_DATA_GENERATION */
+
+    queue_shuffle(streamPtr->packetQueuePtr, randomPtr);
+
+    return numAttack;
+}
+
+
+#ifdef USE_DATA_CACHE
+/* =============================================================================
+ * loadStream
+ * -- Sections are the packets in queue order, padded to longs, then pairs of
+ *    (flow id, string offset) for attacks, then the attack strings
+ * -- Packets and strings are copied into one allocation each
+ * -- Returns FALSE if there is no cached copy
+ * =============================================================================
+ */
+static bool_t
+loadStream (stream_t* streamPtr, const long* params, long numParam, long* numAttackPtr)
+{
+    dataset_t* datasetPtr = dataset_open("intruder", params, numParam);
+    if (datasetPtr == NULL) {
+        return FALSE;
+    }
+
+    long packetSize;
+    long attackSize;
+    long stringSize;
+    const char* packets = (const char*)dataset_getSection(datasetPtr, 0, &packetSize);
+    const long* attacks = (const long*)dataset_getSection(datasetPtr, 1, &attackSize);
+    const char* strings = (const char*)dataset_getSection(datasetPtr, 2, &stringSize);
+    if (packets == NULL || attacks == NULL || strings == NULL ||
+        (attackSize % (2 * sizeof(long))) != 0)
+    {
+        dataset_close(datasetPtr);
+        return FALSE;
+    }
+
+    bool_t status;
+    char* packetCopy = (char*)malloc(packetSize);
+    char* stringCopy = (char*)malloc(stringSize);
+    assert(packetCopy && stringCopy);
+    memcpy(packetCopy, packets, packetSize);
+    memcpy(stringCopy, strings, stringSize);
+    status = vector_pushBack(streamPtr->allocVectorPtr, (void*)packetCopy);
+    assert(status);
+    status = vector_pushBack(streamPtr->allocVectorPtr, (void*)stringCopy);
+    assert(status);
+
+    long offset = 0;
+    while (offset < packetSize) {
+        packet_t* packetPtr = (packet_t*)&packetCopy[offset];
+        status = queue_push(streamPtr->packetQueuePtr, (void*)packetPtr);
+        assert(status);
+        offset += PACKET_HEADER_LENGTH + packetPtr->length;
+        offset = (offset + sizeof(long) - 1) & ~(sizeof(long) - 1);
+    }
+
+    long numAttack = attackSize / (2 * sizeof(long));
+    long a;
+    for (a = 0; a < numAttack; a++) {
+        status = MAP_INSERT(streamPtr->attackMapPtr,
+                            (void*)attacks[2 * a],
+                            (void*)&stringCopy[attacks[2 * a + 1]]);
+        assert(status);
+    }
+    *numAttackPtr = numAttack;
+    dataset_close(datasetPtr);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * storeStream
+ * -- Layout as in loadStream
+ * =============================================================================
+ */
+static void
+storeStream (stream_t* streamPtr, long numFlow, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = dataset_create("intruder", params, numParam);
+    if (datasetPtr == NULL) {
+        return;
+    }
+
+    /* Rotate the queue once to visit packets in order */
+    queue_t* packetQueuePtr = streamPtr->packetQueuePtr;
+    vector_t* packetVectorPtr = vector_alloc(numFlow);
+    assert(packetVectorPtr);
+    packet_t* packetPtr;
+    while ((packetPtr = (packet_t*)queue_pop(packetQueuePtr)) != NULL) {
+        bool_t status = vector_pushBack(packetVectorPtr, (void*)packetPtr);
+        assert(status);
+    }
+
+    static const char zeros[sizeof(long)];
+    bool_t isOk = dataset_addSection(datasetPtr, NULL, 0);
+    long numPacket = vector_getSize(packetVectorPtr);
+    long p;
+    for (p = 0; p < numPacket; p++) {
+        packetPtr = (packet_t*)vector_at(packetVectorPtr, p);
+        long size = PACKET_HEADER_LENGTH + packetPtr->length;
+        isOk = isOk &&
+               dataset_extendSection(datasetPtr, packetPtr, size) &&
+               dataset_extendSection(datasetPtr, zeros, (-size & (sizeof(long) - 1)));
+        bool_t status = queue_push(packetQueuePtr, (void*)packetPtr);
+        assert(status);
+    }
+    vector_free(packetVectorPtr);
+
+    /* Attack strings are found by flow id, so no map iteration is needed */
+    long offset = 0;
+    long f;
+    isOk = isOk && dataset_addSection(datasetPtr, NULL, 0);
+    for (f = 1; isOk && f <= numFlow; f++) {
+        char* str = (char*)MAP_FIND(streamPtr->attackMapPtr, f);
+        if (str) {
+            long entry[2] = {f, offset};
+            isOk = dataset_extendSection(datasetPtr, entry, sizeof(entry));
+            offset += strlen(str) + 1;
+        }
+    }
+    isOk = isOk && dataset_addSection(datasetPtr, NULL, 0);
+    for (f = 1; isOk && f <= numFlow; f++) {
+        char* str = (char*)MAP_FIND(streamPtr->attackMapPtr, f);
+        if (str) {
+            isOk = dataset_extendSection(datasetPtr, str, strlen(str) + 1);
+        }
+    }
+
+    dataset_commit(datasetPtr, isOk);
+}
+#endif /* USE_DATA_CACHE */
+
+
+/* =============================================================================
+ * stream_generate
+ * -- Returns number of attacks generated
+ * -- With USE_PARALLEL_DATA_GENERATION, flows are made on all threads from
+ *    thread_startup
+ * -- With USE_DATA_CACHE, the stream for a given seed is cached on disk
+ * =============================================================================
+ */
+long
+stream_generate (stream_t* streamPtr,
+                 dictionary_t* dictionaryPtr,
+                 long numFlow,
+                 long seed,
+                 long maxLength)
+{
+    random_seed(streamPtr->randomPtr, seed);
+    queue_clear(streamPtr->packetQueuePtr);
+
+#ifdef USE_DATA_CACHE
+    long params[] = {numFlow, seed, maxLength, streamPtr->percentAttack};
+    long numAttack;
+    if (!loadStream(streamPtr, params, 4, &numAttack)) {
+        numAttack = makeStream(streamPtr, dictionaryPtr, numFlow, maxLength);
+        storeStream(streamPtr, numFlow, params, 4);
+    }
+#else /* !USE_DATA_CACHE */
+    long numAttack = makeStream(streamPtr, dictionaryPtr, numFlow, maxLength);
+#endif /* !USE_DATA_CACHE */
+
+#ifdef QUEUE_USE_RING
+    void* packetPtr;
+    while ((packetPtr = queue_pop(streamPtr->packetQueuePtr)) != NULL) {
+        bool_t status = rqueue_push(streamPtr->packetRingPtr, packetPtr);
+        assert(status);
+    }
+#endif
 
     return numAttack;
 }
@@ -280,10 +605,15 @@ stream_generate (stream_t* streamPtr,
 char*
 stream_getPacket (stream_t* streamPtr)
 {
+#ifdef QUEUE_USE_RING
+    return rqueue_pop(streamPtr->packetRingPtr);
+#else
     return queue_pop(streamPtr->packetQueuePtr);
+#endif
 }
 
 
+#ifndef QUEUE_USE_RING
 /* =============================================================================
  * HTMstream_getPacket
  * -- If none, returns NULL
@@ -309,6 +639,9 @@ TMstream_getPacket (TM_ARGDECL stream_t* streamPtr)
 }
 
 
+#endif /* !QUEUE_USE_RING */
+
+
 /* =============================================================================
  * stream_isAttack
  * =============================================================================
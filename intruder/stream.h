@@ -97,6 +97,9 @@ stream_free (stream_t* streamPtr);
 /* =============================================================================
  * stream_generate
  * -- Returns number of attacks generated
+ * -- With USE_PARALLEL_DATA_GENERATION, flows are made on all threads from
+ *    thread_startup
+ * -- With USE_DATA_CACHE, the stream for a given seed is cached on disk
  * =============================================================================
  */
 long
@@ -110,12 +113,14 @@ stream_generate (stream_t* streamPtr,
 /* =============================================================================
  * stream_getPacket
  * -- If none, returns NULL
+ * -- With QUEUE_USE_RING, safe to call concurrently outside transactions
  * =============================================================================
  */
 char*
 stream_getPacket (stream_t* streamPtr);
 
 
+#ifndef QUEUE_USE_RING
 /* =============================================================================
  * HTMstream_getPacket
  * -- If none, returns NULL
@@ -135,6 +140,9 @@ char*
 TMstream_getPacket (TM_ARGDECL stream_t* streamPtr);
 
 
+#endif /* !QUEUE_USE_RING */
+
+
 /* =============================================================================
  * stream_isAttack
  * =============================================================================
@@ -16,16 +16,21 @@ SRCS += \
 	maze.c \
 	router.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/pair.c \
 	$(LIB)/queue.c \
 	$(LIB)/random.c \
+	$(LIB)/rqueue.c \
 	$(LIB)/thread.c \
 	$(LIB)/vector.c \
+	$(LIB)/wsdeque.c \
 #
 OBJS := ${SRCS:.c=.o}
 
 CFLAGS += -DUSE_EARLY_RELEASE -DGRID_COPY -DMERGE_ROUTER
+#CFLAGS += -DQUEUE_USE_RING
+#CFLAGS += -DUSE_WORK_STEALING
 
 
 # ==============================================================================
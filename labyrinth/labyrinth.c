@@ -217,6 +217,9 @@ MAIN(argc, argv)
     maze_t* mazePtr = maze_alloc();
     assert(mazePtr);
     long numPathToRoute = maze_read(mazePtr, global_inputFile);
+#ifdef USE_WORK_STEALING
+    maze_splitWork(mazePtr, numThread);
+#endif
     router_t* routerPtr = router_alloc(global_params[PARAM_XCOST],
                                        global_params[PARAM_YCOST],
                                        global_params[PARAM_ZCOST],
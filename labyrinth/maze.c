@@ -93,10 +93,18 @@ maze_alloc ()
     mazePtr = (maze_t*)malloc(sizeof(maze_t));
     if (mazePtr) {
         mazePtr->gridPtr = NULL;
+#ifdef QUEUE_USE_RING
+        mazePtr->workQueuePtr = rqueue_alloc(-1);
+#else
         mazePtr->workQueuePtr = queue_alloc(1024);
+#endif
         mazePtr->wallVectorPtr = vector_alloc(1);
         mazePtr->srcVectorPtr = vector_alloc(1);
         mazePtr->dstVectorPtr = vector_alloc(1);
+#ifdef USE_WORK_STEALING
+        mazePtr->workDequePtrs = NULL;
+        mazePtr->numWorkDeque = 0;
+#endif
         assert(mazePtr->workQueuePtr &&
                mazePtr->wallVectorPtr &&
                mazePtr->srcVectorPtr &&
@@ -116,7 +124,18 @@ maze_free (maze_t* mazePtr)
     if (mazePtr->gridPtr != NULL) {
         grid_free(mazePtr->gridPtr);
     }
+#ifdef QUEUE_USE_RING
+    rqueue_free(mazePtr->workQueuePtr);
+#else
     queue_free(mazePtr->workQueuePtr);
+#endif
+#ifdef USE_WORK_STEALING
+    long t;
+    for (t = 0; t < mazePtr->numWorkDeque; t++) {
+        wsdeque_free(mazePtr->workDequePtrs[t]);
+    }
+    free(mazePtr->workDequePtrs);
+#endif
     for (size_t i = 0; i < vector_getSize(mazePtr->wallVectorPtr); ++i) {
         coordinate_t *wallPtr = (coordinate_t *)vector_at(mazePtr->wallVectorPtr, i);
         coordinate_free(wallPtr);
@@ -276,12 +295,15 @@ maze_read (maze_t* mazePtr, char* inputFileName)
     /*
      * Initialize work queue
      */
-    queue_t* workQueuePtr = mazePtr->workQueuePtr;
     list_iter_t it;
     list_iter_reset(&it, workListPtr);
     while (list_iter_hasNext(&it, workListPtr)) {
         pair_t* coordinatePairPtr = (pair_t*)list_iter_next(&it, workListPtr);
-        queue_push(workQueuePtr, (void*)coordinatePairPtr);
+#ifdef QUEUE_USE_RING
+        rqueue_push(mazePtr->workQueuePtr, (void*)coordinatePairPtr);
+#else
+        queue_push(mazePtr->workQueuePtr, (void*)coordinatePairPtr);
+#endif
     }
     list_free(workListPtr, NULL);
 
@@ -289,6 +311,78 @@ maze_read (maze_t* mazePtr, char* inputFileName)
 }
 
 
+#ifdef USE_WORK_STEALING
+/* =============================================================================
+ * maze_splitWork
+ * -- Moves the work queue into one deque per thread
+ * -- Call after maze_read and before the threads start
+ * =============================================================================
+ */
+void
+maze_splitWork (maze_t* mazePtr, long numThread)
+{
+    vector_t* workVectorPtr = vector_alloc(1);
+    assert(workVectorPtr);
+    void* coordinatePairPtr;
+#ifdef QUEUE_USE_RING
+    while ((coordinatePairPtr = rqueue_pop(mazePtr->workQueuePtr)) != NULL) {
+#else
+    while ((coordinatePairPtr = queue_pop(mazePtr->workQueuePtr)) != NULL) {
+#endif
+        bool_t status = vector_pushBack(workVectorPtr, coordinatePairPtr);
+        assert(status);
+    }
+
+    long numWork = vector_getSize(workVectorPtr);
+    mazePtr->workDequePtrs = (wsdeque_t**)malloc(numThread * sizeof(wsdeque_t*));
+    assert(mazePtr->workDequePtrs);
+    mazePtr->numWorkDeque = numThread;
+    long t;
+    for (t = 0; t < numThread; t++) {
+        mazePtr->workDequePtrs[t] = wsdeque_alloc(numWork / numThread + 1);
+        assert(mazePtr->workDequePtrs[t]);
+    }
+
+    /*
+     * The queue is ordered longest estimated path first. Deal it out
+     * round-robin, pushing the shortest first, so that every thread pops its
+     * longest paths first and thieves take the shortest ones.
+     */
+    long i;
+    for (i = numWork - 1; i >= 0; i--) {
+        bool_t status = wsdeque_push(mazePtr->workDequePtrs[i % numThread],
+                                     vector_at(workVectorPtr, i));
+        assert(status);
+    }
+
+    vector_free(workVectorPtr);
+}
+
+
+/* =============================================================================
+ * maze_getWork
+ * -- Pops from the thread's own deque, else steals from the others
+ * -- Returns NULL once all deques are empty
+ * =============================================================================
+ */
+pair_t*
+maze_getWork (maze_t* mazePtr, long threadId)
+{
+    long numDeque = mazePtr->numWorkDeque;
+    pair_t* coordinatePairPtr =
+        (pair_t*)wsdeque_pop(mazePtr->workDequePtrs[threadId]);
+
+    long i;
+    for (i = 1; coordinatePairPtr == NULL && i < numDeque; i++) {
+        wsdeque_t* victimPtr = mazePtr->workDequePtrs[(threadId + i) % numDeque];
+        coordinatePairPtr = (pair_t*)wsdeque_steal(victimPtr);
+    }
+
+    return coordinatePairPtr;
+}
+#endif /* USE_WORK_STEALING */
+
+
 /* =============================================================================
  * maze_checkPaths
  * =============================================================================
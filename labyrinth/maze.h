@@ -78,15 +78,25 @@
 #include "list.h"
 #include "pair.h"
 #include "queue.h"
+#include "rqueue.h"
 #include "types.h"
 #include "vector.h"
+#include "wsdeque.h"
 
 typedef struct maze {
     grid_t* gridPtr;
+#ifdef QUEUE_USE_RING
+    rqueue_t* workQueuePtr;  /* contains source/destination pairs to route */
+#else
     queue_t* workQueuePtr;   /* contains source/destination pairs to route */
+#endif
     vector_t* wallVectorPtr; /* obstacles */
     vector_t* srcVectorPtr;  /* sources */
     vector_t* dstVectorPtr;  /* destinations */
+#ifdef USE_WORK_STEALING
+    wsdeque_t** workDequePtrs; /* per-thread share of workQueuePtr */
+    long numWorkDeque;
+#endif
 } maze_t;
 
 
@@ -115,6 +125,28 @@ long
 maze_read (maze_t* mazePtr, char* inputFileName);
 
 
+#ifdef USE_WORK_STEALING
+/* =============================================================================
+ * maze_splitWork
+ * -- Moves the work queue into one deque per thread
+ * -- Call after maze_read and before the threads start
+ * =============================================================================
+ */
+void
+maze_splitWork (maze_t* mazePtr, long numThread);
+
+
+/* =============================================================================
+ * maze_getWork
+ * -- Pops from the thread's own deque, else steals from the others
+ * -- Returns NULL once all deques are empty
+ * =============================================================================
+ */
+pair_t*
+maze_getWork (maze_t* mazePtr, long threadId);
+#endif /* USE_WORK_STEALING */
+
+
 /* =============================================================================
  * maze_checkPaths
  * =============================================================================
@@ -75,6 +75,7 @@
 #include "grid.h"
 #include "queue.h"
 #include "router.h"
+#include "thread.h"
 #include "tm.h"
 #include "vector.h"
 
@@ -610,7 +611,13 @@ router_solve (void* argPtr)
     vector_t* myPathVectorPtr = PVECTOR_ALLOC(1);
     assert(myPathVectorPtr);
 
+#if defined(USE_WORK_STEALING)
+    long myId = thread_getId();
+#elif defined(QUEUE_USE_RING)
+    rqueue_t* workQueuePtr = mazePtr->workQueuePtr;
+#else
     queue_t* workQueuePtr = mazePtr->workQueuePtr;
+#endif
     grid_t* gridPtr = mazePtr->gridPtr;
     grid_t* myGridPtr =
         PGRID_ALLOC(gridPtr->width, gridPtr->height, gridPtr->depth);
@@ -626,6 +633,13 @@ router_solve (void* argPtr)
 
         pair_t* coordinatePairPtr;
         HTM_TX_INIT;
+#if defined(USE_WORK_STEALING)
+        /* Own deque first, then steal; no transaction */
+        coordinatePairPtr = maze_getWork(mazePtr, myId);
+#elif defined(QUEUE_USE_RING)
+        /* Lock-free pop, cannot be rolled back, so no transaction */
+        coordinatePairPtr = (pair_t*)rqueue_pop(workQueuePtr);
+#else
 tsx_begin_pop:
         if (HTM_BEGIN(tsx_status, global_tsx_status)) {
             HTM_LOCK_READ();
@@ -646,6 +660,7 @@ tsx_begin_pop:
             }
             TM_END();
             }
+#endif /* !USE_WORK_STEALING && !QUEUE_USE_RING */
 
         if (coordinatePairPtr == NULL) {
             break;
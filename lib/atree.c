@@ -0,0 +1,1593 @@
+/* =============================================================================
+ *
+ * atree.c
+ * -- Andersson (AA) balanced tree map, same interface as rbtree.h
+ *
+ * =============================================================================
+ *
+ * Insertion and deletion are recursive; on the way back up, a child pointer
+ * is only written when the subtree root actually changed, so the write set
+ * stays limited to the nodes that are restructured.
+ *
+ * =============================================================================
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "atree.h"
+#include "tm.h"
+
+
+typedef struct node {
+    void* k;
+    void* v;
+    struct node* l;
+    struct node* r;
+    long level;                              /* leaves are 1 */
+} node_t;
+
+
+struct atree {
+    node_t* root;
+    TM_PURE long (*compare)(const void*, const void*);   /* returns {-1,0,1}, 0 -> equal */
+};
+
+#define LDF(o,f)            ((o)->f)
+#define LDF_P(o,f)          ((o)->f)
+#define STF(o,f,v)          ((o)->f) = (v)
+#define STF_P(o,f,v)        ((o)->f) = (v)
+#define LDNODE(o,f)         ((node_t*)(LDF((o),f)))
+
+#define HTX_LDF(o,f)        ((long)HTM_SHARED_READ((o)->f))
+#define HTX_LDF_P(o,f)      ((void*)HTM_SHARED_READ_P((o)->f))
+#define HTX_STF(o,f,v)      HTM_SHARED_WRITE((o)->f, v)
+#define HTX_STF_P(o,f,v)    HTM_SHARED_WRITE_P((o)->f, v)
+#define HTX_LDNODE(o,f)     ((node_t*)(HTX_LDF_P((o),f)))
+
+#define TX_LDF(o,f)         ((long)TM_SHARED_READ_TAG((o)->f, (uintptr_t)o))
+#define TX_LDF_P(o,f)       ((void*)TM_SHARED_READ_TAG_P((o)->f, (uintptr_t)o))
+#define TX_STF(o,f,v)       TM_SHARED_WRITE((o)->f, v)
+#define TX_STF_P(o,f,v)     TM_SHARED_WRITE_P((o)->f, v)
+#define TX_LDNODE(o,f)      ((node_t*)(TX_LDF_P((o),f)))
+
+#ifndef ORIGINAL
+# define TM_LOG_OP TM_LOG_OP_DECLARE
+# include "atree.inc"
+# undef TM_LOG_OP
+#endif /* ORIGINAL */
+
+
+/* =============================================================================
+ * getNode
+ * =============================================================================
+ */
+static node_t*
+getNode ()
+{
+    node_t* n = (node_t*)malloc(sizeof(*n));
+    return n;
+}
+
+
+/* =============================================================================
+ * HTMgetNode
+ * =============================================================================
+ */
+static node_t*
+HTMgetNode ()
+{
+    node_t* n = (node_t*)HTM_MALLOC(sizeof(*n));
+    return n;
+}
+
+
+/* =============================================================================
+ * TMgetNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMgetNode (TM_ARGDECL_ALONE)
+{
+    node_t* n = (node_t*)TM_MALLOC(sizeof(*n));
+    return n;
+}
+
+
+/* =============================================================================
+ * releaseNode
+ * =============================================================================
+ */
+static void
+releaseNode (node_t* n)
+{
+#ifndef SIMULATOR
+    free(n);
+#endif
+}
+
+
+/* =============================================================================
+ * HTMreleaseNode
+ * =============================================================================
+ */
+static void
+HTMreleaseNode (node_t* n)
+{
+    HTM_FREE(n);
+}
+
+
+/* =============================================================================
+ * TMreleaseNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMreleaseNode (TM_ARGDECL  node_t* n)
+{
+    TM_FREE(n);
+}
+
+
+/* =============================================================================
+ * skew
+ * -- Removes a left horizontal link
+ * =============================================================================
+ */
+static node_t*
+skew (node_t* t)
+{
+    node_t* l;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = LDNODE(t, l);
+    if (l != NULL && LDF(l, level) == LDF(t, level)) {
+        STF_P(t, l, LDNODE(l, r));
+        STF_P(l, r, t);
+        t = l;
+    }
+
+    return t;
+}
+#define SKEW(t)  skew(t)
+
+
+/* =============================================================================
+ * HTMskew
+ * -- Removes a left horizontal link
+ * =============================================================================
+ */
+static node_t*
+HTMskew (node_t* t)
+{
+    node_t* l;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = HTX_LDNODE(t, l);
+    if (l != NULL && HTX_LDF(l, level) == HTX_LDF(t, level)) {
+        HTX_STF_P(t, l, HTX_LDNODE(l, r));
+        HTX_STF_P(l, r, t);
+        t = l;
+    }
+
+    return t;
+}
+#define HTX_SKEW(t)  HTMskew(t)
+
+
+/* =============================================================================
+ * TMskew
+ * -- Removes a left horizontal link
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMskew (TM_ARGDECL  node_t* t)
+{
+    node_t* l;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = TX_LDNODE(t, l);
+    if (l != NULL && TX_LDF(l, level) == TX_LDF(t, level)) {
+        TX_STF_P(t, l, TX_LDNODE(l, r));
+        TX_STF_P(l, r, t);
+        t = l;
+    }
+
+    return t;
+}
+#define TX_SKEW(t)  TMskew(TM_ARG  t)
+
+
+/* =============================================================================
+ * split
+ * -- Removes two consecutive right horizontal links
+ * =============================================================================
+ */
+static node_t*
+split (node_t* t)
+{
+    node_t* r;
+    node_t* rr;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    r = LDNODE(t, r);
+    if (r == NULL) {
+        return t;
+    }
+    rr = LDNODE(r, r);
+    if (rr != NULL && LDF(rr, level) == LDF(t, level)) {
+        STF_P(t, r, LDNODE(r, l));
+        STF_P(r, l, t);
+        STF(r, level, LDF(r, level) + 1);
+        t = r;
+    }
+
+    return t;
+}
+#define SPLIT(t)  split(t)
+
+
+/* =============================================================================
+ * HTMsplit
+ * -- Removes two consecutive right horizontal links
+ * =============================================================================
+ */
+static node_t*
+HTMsplit (node_t* t)
+{
+    node_t* r;
+    node_t* rr;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    r = HTX_LDNODE(t, r);
+    if (r == NULL) {
+        return t;
+    }
+    rr = HTX_LDNODE(r, r);
+    if (rr != NULL && HTX_LDF(rr, level) == HTX_LDF(t, level)) {
+        HTX_STF_P(t, r, HTX_LDNODE(r, l));
+        HTX_STF_P(r, l, t);
+        HTX_STF(r, level, HTX_LDF(r, level) + 1);
+        t = r;
+    }
+
+    return t;
+}
+#define HTX_SPLIT(t)  HTMsplit(t)
+
+
+/* =============================================================================
+ * TMsplit
+ * -- Removes two consecutive right horizontal links
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMsplit (TM_ARGDECL  node_t* t)
+{
+    node_t* r;
+    node_t* rr;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    r = TX_LDNODE(t, r);
+    if (r == NULL) {
+        return t;
+    }
+    rr = TX_LDNODE(r, r);
+    if (rr != NULL && TX_LDF(rr, level) == TX_LDF(t, level)) {
+        TX_STF_P(t, r, TX_LDNODE(r, l));
+        TX_STF_P(r, l, t);
+        TX_STF(r, level, TX_LDF(r, level) + 1);
+        t = r;
+    }
+
+    return t;
+}
+#define TX_SPLIT(t)  TMsplit(TM_ARG  t)
+
+
+/* =============================================================================
+ * decreaseLevel
+ * =============================================================================
+ */
+static void
+decreaseLevel (node_t* t)
+{
+    node_t* l = LDNODE(t, l);
+    node_t* r = LDNODE(t, r);
+    long ll = ((l != NULL) ? LDF(l, level) : 0);
+    long rl = ((r != NULL) ? LDF(r, level) : 0);
+    long should = ((ll < rl) ? ll : rl) + 1;
+
+    if (should < LDF(t, level)) {
+        STF(t, level, should);
+        if (r != NULL && should < rl) {
+            STF(r, level, should);
+        }
+    }
+}
+#define DECREASE_LEVEL(t)  decreaseLevel(t)
+
+
+/* =============================================================================
+ * HTMdecreaseLevel
+ * =============================================================================
+ */
+static void
+HTMdecreaseLevel (node_t* t)
+{
+    node_t* l = HTX_LDNODE(t, l);
+    node_t* r = HTX_LDNODE(t, r);
+    long ll = ((l != NULL) ? HTX_LDF(l, level) : 0);
+    long rl = ((r != NULL) ? HTX_LDF(r, level) : 0);
+    long should = ((ll < rl) ? ll : rl) + 1;
+
+    if (should < HTX_LDF(t, level)) {
+        HTX_STF(t, level, should);
+        if (r != NULL && should < rl) {
+            HTX_STF(r, level, should);
+        }
+    }
+}
+#define HTX_DECREASE_LEVEL(t)  HTMdecreaseLevel(t)
+
+
+/* =============================================================================
+ * TMdecreaseLevel
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMdecreaseLevel (TM_ARGDECL  node_t* t)
+{
+    node_t* l = TX_LDNODE(t, l);
+    node_t* r = TX_LDNODE(t, r);
+    long ll = ((l != NULL) ? TX_LDF(l, level) : 0);
+    long rl = ((r != NULL) ? TX_LDF(r, level) : 0);
+    long should = ((ll < rl) ? ll : rl) + 1;
+
+    if (should < TX_LDF(t, level)) {
+        TX_STF(t, level, should);
+        if (r != NULL && should < rl) {
+            TX_STF(r, level, should);
+        }
+    }
+}
+#define TX_DECREASE_LEVEL(t)  TMdecreaseLevel(TM_ARG  t)
+
+
+/* =============================================================================
+ * insert
+ * -- Returns new subtree root; *ex is set to the node if key already exists
+ * =============================================================================
+ */
+static node_t*
+insert (atree_t* s, node_t* t, void* k, void* v, node_t* n, node_t** ex)
+{
+    long cmp;
+
+    if (t == NULL) {
+        n->k = k;
+        n->v = v;
+        n->l = NULL;
+        n->r = NULL;
+        n->level = 1;
+        return n;
+    }
+
+    cmp = s->compare(k, LDF_P(t, k));
+    if (cmp == 0) {
+        *ex = t;
+        return t;
+    } else if (cmp < 0) {
+        node_t* l = LDNODE(t, l);
+        node_t* nl = insert(s, l, k, v, n, ex);
+        if (nl != l) {
+            STF_P(t, l, nl);
+        }
+    } else {
+        node_t* r = LDNODE(t, r);
+        node_t* nr = insert(s, r, k, v, n, ex);
+        if (nr != r) {
+            STF_P(t, r, nr);
+        }
+    }
+
+    if (*ex != NULL) {
+        return t;
+    }
+
+    t = SKEW(t);
+    t = SPLIT(t);
+
+    return t;
+}
+#define INSERT(s, t, k, v, n, ex)  insert(s, t, k, v, n, ex)
+
+
+/* =============================================================================
+ * HTMinsert
+ * -- Returns new subtree root; *ex is set to the node if key already exists
+ * =============================================================================
+ */
+static node_t*
+HTMinsert (atree_t* s, node_t* t, void* k, void* v, node_t* n, node_t** ex)
+{
+    long cmp;
+
+    if (t == NULL) {
+        n->k = k;
+        n->v = v;
+        n->l = NULL;
+        n->r = NULL;
+        n->level = 1;
+        return n;
+    }
+
+    cmp = s->compare(k, HTX_LDF_P(t, k));
+    if (cmp == 0) {
+        *ex = t;
+        return t;
+    } else if (cmp < 0) {
+        node_t* l = HTX_LDNODE(t, l);
+        node_t* nl = HTMinsert(s, l, k, v, n, ex);
+        if (nl != l) {
+            HTX_STF_P(t, l, nl);
+        }
+    } else {
+        node_t* r = HTX_LDNODE(t, r);
+        node_t* nr = HTMinsert(s, r, k, v, n, ex);
+        if (nr != r) {
+            HTX_STF_P(t, r, nr);
+        }
+    }
+
+    if (*ex != NULL) {
+        return t;
+    }
+
+    t = HTX_SKEW(t);
+    t = HTX_SPLIT(t);
+
+    return t;
+}
+#define HTX_INSERT(s, t, k, v, n, ex)  HTMinsert(s, t, k, v, n, ex)
+
+
+/* =============================================================================
+ * TMinsert
+ * -- Returns new subtree root; *ex is set to the node if key already exists
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMinsert (TM_ARGDECL  atree_t* s, node_t* t, void* k, void* v, node_t* n, node_t** ex)
+{
+    long cmp;
+
+    if (t == NULL) {
+        n->k = k;
+        n->v = v;
+        n->l = NULL;
+        n->r = NULL;
+        n->level = 1;
+        return n;
+    }
+
+    cmp = s->compare(k, TX_LDF_P(t, k));
+    if (cmp == 0) {
+        *ex = t;
+        return t;
+    } else if (cmp < 0) {
+        node_t* l = TX_LDNODE(t, l);
+        node_t* nl = TMinsert(TM_ARG  s, l, k, v, n, ex);
+        if (nl != l) {
+            TX_STF_P(t, l, nl);
+        }
+    } else {
+        node_t* r = TX_LDNODE(t, r);
+        node_t* nr = TMinsert(TM_ARG  s, r, k, v, n, ex);
+        if (nr != r) {
+            TX_STF_P(t, r, nr);
+        }
+    }
+
+    if (*ex != NULL) {
+        return t;
+    }
+
+    t = TX_SKEW(t);
+    t = TX_SPLIT(t);
+
+    return t;
+}
+#define TX_INSERT(s, t, k, v, n, ex)  TMinsert(TM_ARG  s, t, k, v, n, ex)
+
+
+/* =============================================================================
+ * copySuccessor
+ * -- Copies the leftmost element of the subtree r into t
+ * =============================================================================
+ */
+static void
+copySuccessor (node_t* t, node_t* r)
+{
+    node_t* l;
+
+    while ((l = LDNODE(r, l)) != NULL) {
+        r = l;
+    }
+
+    STF_P(t, k, LDF_P(r, k));
+    STF_P(t, v, LDF_P(r, v));
+}
+#define COPY_SUCCESSOR(t, r)  copySuccessor(t, r)
+
+
+/* =============================================================================
+ * HTMcopySuccessor
+ * -- Copies the leftmost element of the subtree r into t
+ * =============================================================================
+ */
+static void
+HTMcopySuccessor (node_t* t, node_t* r)
+{
+    node_t* l;
+
+    while ((l = HTX_LDNODE(r, l)) != NULL) {
+        r = l;
+    }
+
+    HTX_STF_P(t, k, HTX_LDF_P(r, k));
+    HTX_STF_P(t, v, HTX_LDF_P(r, v));
+}
+#define HTX_COPY_SUCCESSOR(t, r)  HTMcopySuccessor(t, r)
+
+
+/* =============================================================================
+ * TMcopySuccessor
+ * -- Copies the leftmost element of the subtree r into t
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMcopySuccessor (TM_ARGDECL  node_t* t, node_t* r)
+{
+    node_t* l;
+
+    while ((l = TX_LDNODE(r, l)) != NULL) {
+        r = l;
+    }
+
+    TX_STF_P(t, k, TX_LDF_P(r, k));
+    TX_STF_P(t, v, TX_LDF_P(r, v));
+}
+#define TX_COPY_SUCCESSOR(t, r)  TMcopySuccessor(TM_ARG  t, r)
+
+
+/* =============================================================================
+ * deleteNode
+ * -- Returns new subtree root; *del is set to the node that was unlinked
+ * =============================================================================
+ */
+static node_t*
+deleteNode (atree_t* s, node_t* t, void* k, node_t** del)
+{
+    node_t* l;
+    node_t* r;
+    long cmp;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = LDNODE(t, l);
+    r = LDNODE(t, r);
+    cmp = s->compare(k, LDF_P(t, k));
+    if (cmp < 0) {
+        node_t* nl = deleteNode(s, l, k, del);
+        if (nl != l) {
+            STF_P(t, l, nl);
+        }
+    } else if (cmp > 0) {
+        node_t* nr = deleteNode(s, r, k, del);
+        if (nr != r) {
+            STF_P(t, r, nr);
+        }
+    } else if (l == NULL || r == NULL) {
+        *del = t;
+        return ((l != NULL) ? l : r);
+    } else {
+        /* Take over the successor's element, then unlink the successor */
+        node_t* nr;
+        COPY_SUCCESSOR(t, r);
+        nr = deleteNode(s, r, LDF_P(t, k), del);
+        if (nr != r) {
+            STF_P(t, r, nr);
+        }
+    }
+
+    if (*del == NULL) {
+        return t;
+    }
+
+    DECREASE_LEVEL(t);
+    t = SKEW(t);
+    r = LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = SKEW(r);
+        node_t* rr;
+        node_t* nrr;
+        if (nr != r) {
+            STF_P(t, r, nr);
+            r = nr;
+        }
+        rr = LDNODE(r, r);
+        nrr = SKEW(rr);
+        if (nrr != rr) {
+            STF_P(r, r, nrr);
+        }
+    }
+    t = SPLIT(t);
+    r = LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = SPLIT(r);
+        if (nr != r) {
+            STF_P(t, r, nr);
+        }
+    }
+
+    return t;
+}
+#define DELETE(s, t, k, del)  deleteNode(s, t, k, del)
+
+
+/* =============================================================================
+ * HTMdeleteNode
+ * -- Returns new subtree root; *del is set to the node that was unlinked
+ * =============================================================================
+ */
+static node_t*
+HTMdeleteNode (atree_t* s, node_t* t, void* k, node_t** del)
+{
+    node_t* l;
+    node_t* r;
+    long cmp;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = HTX_LDNODE(t, l);
+    r = HTX_LDNODE(t, r);
+    cmp = s->compare(k, HTX_LDF_P(t, k));
+    if (cmp < 0) {
+        node_t* nl = HTMdeleteNode(s, l, k, del);
+        if (nl != l) {
+            HTX_STF_P(t, l, nl);
+        }
+    } else if (cmp > 0) {
+        node_t* nr = HTMdeleteNode(s, r, k, del);
+        if (nr != r) {
+            HTX_STF_P(t, r, nr);
+        }
+    } else if (l == NULL || r == NULL) {
+        *del = t;
+        return ((l != NULL) ? l : r);
+    } else {
+        /* Take over the successor's element, then unlink the successor */
+        node_t* nr;
+        HTX_COPY_SUCCESSOR(t, r);
+        nr = HTMdeleteNode(s, r, HTX_LDF_P(t, k), del);
+        if (nr != r) {
+            HTX_STF_P(t, r, nr);
+        }
+    }
+
+    if (*del == NULL) {
+        return t;
+    }
+
+    HTX_DECREASE_LEVEL(t);
+    t = HTX_SKEW(t);
+    r = HTX_LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = HTX_SKEW(r);
+        node_t* rr;
+        node_t* nrr;
+        if (nr != r) {
+            HTX_STF_P(t, r, nr);
+            r = nr;
+        }
+        rr = HTX_LDNODE(r, r);
+        nrr = HTX_SKEW(rr);
+        if (nrr != rr) {
+            HTX_STF_P(r, r, nrr);
+        }
+    }
+    t = HTX_SPLIT(t);
+    r = HTX_LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = HTX_SPLIT(r);
+        if (nr != r) {
+            HTX_STF_P(t, r, nr);
+        }
+    }
+
+    return t;
+}
+#define HTX_DELETE(s, t, k, del)  HTMdeleteNode(s, t, k, del)
+
+
+/* =============================================================================
+ * TMdeleteNode
+ * -- Returns new subtree root; *del is set to the node that was unlinked
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMdeleteNode (TM_ARGDECL  atree_t* s, node_t* t, void* k, node_t** del)
+{
+    node_t* l;
+    node_t* r;
+    long cmp;
+
+    if (t == NULL) {
+        return NULL;
+    }
+
+    l = TX_LDNODE(t, l);
+    r = TX_LDNODE(t, r);
+    cmp = s->compare(k, TX_LDF_P(t, k));
+    if (cmp < 0) {
+        node_t* nl = TMdeleteNode(TM_ARG  s, l, k, del);
+        if (nl != l) {
+            TX_STF_P(t, l, nl);
+        }
+    } else if (cmp > 0) {
+        node_t* nr = TMdeleteNode(TM_ARG  s, r, k, del);
+        if (nr != r) {
+            TX_STF_P(t, r, nr);
+        }
+    } else if (l == NULL || r == NULL) {
+        *del = t;
+        return ((l != NULL) ? l : r);
+    } else {
+        /* Take over the successor's element, then unlink the successor */
+        node_t* nr;
+        TX_COPY_SUCCESSOR(t, r);
+        nr = TMdeleteNode(TM_ARG  s, r, TX_LDF_P(t, k), del);
+        if (nr != r) {
+            TX_STF_P(t, r, nr);
+        }
+    }
+
+    if (*del == NULL) {
+        return t;
+    }
+
+    TX_DECREASE_LEVEL(t);
+    t = TX_SKEW(t);
+    r = TX_LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = TX_SKEW(r);
+        node_t* rr;
+        node_t* nrr;
+        if (nr != r) {
+            TX_STF_P(t, r, nr);
+            r = nr;
+        }
+        rr = TX_LDNODE(r, r);
+        nrr = TX_SKEW(rr);
+        if (nrr != rr) {
+            TX_STF_P(r, r, nrr);
+        }
+    }
+    t = TX_SPLIT(t);
+    r = TX_LDNODE(t, r);
+    if (r != NULL) {
+        node_t* nr = TX_SPLIT(r);
+        if (nr != r) {
+            TX_STF_P(t, r, nr);
+        }
+    }
+
+    return t;
+}
+#define TX_DELETE(s, t, k, del)  TMdeleteNode(TM_ARG  s, t, k, del)
+
+
+/* =============================================================================
+ * lookup
+ * =============================================================================
+ */
+static node_t*
+lookup (atree_t* s, void* k)
+{
+    node_t* p = LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, LDF_P(p, k));
+        if (cmp == 0) {
+            goto out;
+        }
+        p = ((cmp < 0) ? LDNODE(p, l) : LDNODE(p, r));
+    }
+
+out:
+    return p;
+}
+#define LOOKUP(s, k)  lookup(s, k)
+
+
+/* =============================================================================
+ * HTMlookup
+ * =============================================================================
+ */
+static node_t*
+HTMlookup (atree_t* s, void* k)
+{
+    node_t* p = HTX_LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, HTX_LDF_P(p, k));
+        if (cmp == 0) {
+            goto out;
+        }
+        p = ((cmp < 0) ? HTX_LDNODE(p, l) : HTX_LDNODE(p, r));
+    }
+
+out:
+    return p;
+}
+#define HTX_LOOKUP(s, k)  HTMlookup(s, k)
+
+
+/* =============================================================================
+ * TMlookup
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMlookup (TM_ARGDECL  atree_t* s, void* k)
+{
+    node_t* p = TX_LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, TX_LDF_P(p, k));
+        if (cmp == 0) {
+            goto out;
+        }
+        p = ((cmp < 0) ? TX_LDNODE(p, l) : TX_LDNODE(p, r));
+    }
+
+out:
+    return p;
+}
+#define TX_LOOKUP(s, k)  TMlookup(TM_ARG  s, k)
+
+/* =============================================================================
+ * verifyNode
+ * -- Returns number of elements in subtree, or -1 on error
+ * =============================================================================
+ */
+static long
+verifyNode (atree_t* s, node_t* t, long verbose)
+{
+    long nl;
+    long nr;
+
+    if (t == NULL) {
+        return 0;
+    }
+
+    if (t->l == NULL && t->r == NULL && t->level != 1) {
+        if (verbose) {
+            printf("Leaf %p at level %ld\n", t, t->level);
+        }
+        return -1;
+    }
+    if (t->l != NULL &&
+        (t->l->level != t->level - 1 || s->compare(t->l->k, t->k) >= 0)) {
+        if (verbose) {
+            printf("Bad left child of %p\n", t);
+        }
+        return -1;
+    }
+    if (t->r != NULL &&
+        ((t->r->level != t->level && t->r->level != t->level - 1) ||
+         s->compare(t->r->k, t->k) <= 0)) {
+        if (verbose) {
+            printf("Bad right child of %p\n", t);
+        }
+        return -1;
+    }
+    if (t->r != NULL && t->r->r != NULL && t->r->r->level == t->level) {
+        if (verbose) {
+            printf("Two horizontal links below %p\n", t);
+        }
+        return -1;
+    }
+    if (t->level > 1 && (t->l == NULL || t->r == NULL)) {
+        if (verbose) {
+            printf("Internal node %p missing a child\n", t);
+        }
+        return -1;
+    }
+
+    nl = verifyNode(s, t->l, verbose);
+    nr = verifyNode(s, t->r, verbose);
+    if (nl < 0 || nr < 0) {
+        return -1;
+    }
+
+    return (nl + nr + 1);
+}
+
+
+/* =============================================================================
+ * atree_verify
+ * -- Returns number of elements, or -1 on error
+ * =============================================================================
+ */
+long
+atree_verify (atree_t* s, long verbose)
+{
+    long count = verifyNode(s, s->root, verbose);
+
+    if (verbose) {
+        printf("Integrity check: ");
+        printf("%ld elements, root level %ld\n",
+               count, ((s->root != NULL) ? s->root->level : 0));
+    }
+
+    return count;
+}
+
+
+/* =============================================================================
+ * atree_compare
+ * =============================================================================
+ */
+long
+atree_compare (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * atree_alloc
+ * =============================================================================
+ */
+atree_t*
+atree_alloc (long (*compare)(const void*, const void*))
+{
+    atree_t* s = (atree_t*)malloc(sizeof(*s));
+    if (s) {
+        atree_setCompare(s, compare ? compare : atree_compare);
+        s->root = NULL;
+    }
+    return s;
+}
+
+
+/* =============================================================================
+ * HTMatree_alloc
+ * =============================================================================
+ */
+atree_t*
+HTMatree_alloc (long (*compare)(const void*, const void*))
+{
+    atree_t* s = (atree_t*)HTM_MALLOC(sizeof(*s));
+    if (s) {
+        atree_setCompare(s, compare ? compare : atree_compare);
+        s->root = NULL;
+    }
+    return s;
+}
+
+
+/* =============================================================================
+ * TMatree_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+atree_t*
+TMatree_alloc (TM_ARGDECL  long (*compare)(const void*, const void*))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_ALLOC, NULL, compare);
+#endif /* ORIGINAL */
+
+    atree_t* s = (atree_t*)TM_MALLOC(sizeof(*s));
+    if (s) {
+        atree_setCompare(s, compare ? compare : atree_compare);
+        s->root = NULL;
+    }
+
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_ALLOC, &s);
+#endif /* ORIGINAL */
+    return s;
+}
+
+
+/* =============================================================================
+ * freeNode
+ * =============================================================================
+ */
+static void
+freeNode (node_t* n, void (*freeData)(void *, void *))
+{
+    if (n) {
+        freeNode(n->l, freeData);
+        freeNode(n->r, freeData);
+        if (freeData)
+            freeData(n->k, n->v);
+        releaseNode(n);
+    }
+}
+
+
+/* =============================================================================
+ * HTMfreeNode
+ * =============================================================================
+ */
+static void
+HTMfreeNode (node_t* n, void (*HTMfreeData)(void *, void *))
+{
+    if (n) {
+        HTMfreeNode(HTX_LDNODE(n, l), HTMfreeData);
+        HTMfreeNode(HTX_LDNODE(n, r), HTMfreeData);
+        if (HTMfreeData)
+            HTMfreeData(HTX_LDF_P(n, k), HTX_LDF_P(n, v));
+        HTMreleaseNode(n);
+    }
+}
+
+
+/* =============================================================================
+ * TMfreeNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMfreeNode (TM_ARGDECL  node_t* n, TM_CALLABLE void (*TMfreeData)(void *, void *))
+{
+    if (n) {
+        TMfreeNode(TM_ARG  TX_LDNODE(n, l), TMfreeData);
+        TMfreeNode(TM_ARG  TX_LDNODE(n, r), TMfreeData);
+        if (TMfreeData)
+            TMfreeData(TM_ARG  TX_LDF_P(n, k), TX_LDF_P(n, v));
+        TMreleaseNode(TM_ARG  n);
+    }
+}
+
+
+/* =============================================================================
+ * atree_free
+ * =============================================================================
+ */
+void
+atree_free (atree_t* s, void (*freeData)(void *, void *))
+{
+    freeNode(s->root, freeData);
+    free(s);
+}
+
+
+/* =============================================================================
+ * HTMatree_free
+ * =============================================================================
+ */
+void
+HTMatree_free (atree_t* s, void (*HTMfreeData)(void *, void *))
+{
+    HTMfreeNode(HTX_LDNODE(s, root), HTMfreeData);
+    HTM_FREE(s);
+}
+
+
+/* =============================================================================
+ * TMatree_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMatree_free (TM_ARGDECL  atree_t* s, TM_CALLABLE void (*TMfreeData)(void *, void *))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_FREE, NULL, s);
+#endif /* ORIGINAL */
+    TMfreeNode(TM_ARG  TX_LDNODE(s, root), TMfreeData);
+    TM_FREE(s);
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_FREE, NULL);
+#endif /* ORIGINAL */
+}
+
+
+/* =============================================================================
+ * atree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+atree_insert (atree_t* s, void* key, void* val)
+{
+    node_t* ex = NULL;
+    node_t* node = getNode();
+    node_t* root;
+    node_t* nroot;
+
+    if (node == NULL) {
+        return FALSE;
+    }
+
+    root = LDNODE(s, root);
+    nroot = INSERT(s, root, key, val, node, &ex);
+    if (nroot != root) {
+        STF_P(s, root, nroot);
+    }
+    if (ex != NULL) {
+        releaseNode(node);
+    }
+    return ((ex == NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMatree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+HTMatree_insert (atree_t* s, void* key, void* val)
+{
+    node_t* ex = NULL;
+    node_t* node = HTMgetNode();
+    node_t* root;
+    node_t* nroot;
+
+    if (node == NULL) {
+        return FALSE;
+    }
+
+    root = HTX_LDNODE(s, root);
+    nroot = HTX_INSERT(s, root, key, val, node, &ex);
+    if (nroot != root) {
+        HTX_STF_P(s, root, nroot);
+    }
+    if (ex != NULL) {
+        HTMreleaseNode(node);
+    }
+    return ((ex == NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * TMatree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_insert (TM_ARGDECL  atree_t* s, void* key, void* val)
+{
+    bool_t rv = FALSE;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_INSERT, NULL, s, key, val);
+#endif /* ORIGINAL */
+    node_t* ex = NULL;
+    node_t* node = TMgetNode(TM_ARG_ALONE);
+    node_t* root;
+    node_t* nroot;
+
+    if (node == NULL) {
+        goto out;
+    }
+
+    root = TX_LDNODE(s, root);
+    nroot = TX_INSERT(s, root, key, val, node, &ex);
+    if (nroot != root) {
+        TX_STF_P(s, root, nroot);
+    }
+    if (ex != NULL) {
+        TMreleaseNode(TM_ARG  node);
+    }
+    rv = (ex == NULL) ? TRUE : FALSE;
+
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_INSERT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * atree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+atree_delete (atree_t* s, void* key)
+{
+    node_t* node = NULL;
+    node_t* root = LDNODE(s, root);
+    node_t* nroot = DELETE(s, root, key, &node);
+
+    if (nroot != root) {
+        STF_P(s, root, nroot);
+    }
+    if (node != NULL) {
+        releaseNode(node);
+    }
+    return ((node != NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMatree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+HTMatree_delete (atree_t* s, void* key)
+{
+    node_t* node = NULL;
+    node_t* root = HTX_LDNODE(s, root);
+    node_t* nroot = HTX_DELETE(s, root, key, &node);
+
+    if (nroot != root) {
+        HTX_STF_P(s, root, nroot);
+    }
+    if (node != NULL) {
+        HTMreleaseNode(node);
+    }
+    return ((node != NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * TMatree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_delete (TM_ARGDECL  atree_t* s, void* key)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_DELETE, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* node = NULL;
+    node_t* root = TX_LDNODE(s, root);
+    node_t* nroot = TX_DELETE(s, root, key, &node);
+
+    if (nroot != root) {
+        TX_STF_P(s, root, nroot);
+    }
+    if (node != NULL) {
+        TMreleaseNode(TM_ARG  node);
+    }
+    rv = (node != NULL) ? TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_DELETE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * atree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+bool_t
+atree_update (atree_t* s, void* key, void* val)
+{
+    node_t* n = LOOKUP(s, key);
+    if (n != NULL) {
+        STF_P(n, v, val);
+        return TRUE;
+    }
+    atree_insert(s, key, val);
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * TMatree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_update (TM_ARGDECL  atree_t* s, void* key, void* val)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_UPDATE, NULL, s, key, val);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(s, key);
+    if (n != NULL) {
+        TX_STF_P(n, v, val);
+        rv = TRUE;
+    } else {
+        TMatree_insert(TM_ARG  s, key, val);
+        rv = FALSE;
+    }
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_UPDATE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * atree_get
+ * =============================================================================
+ */
+void*
+atree_get (atree_t* s, void* key)
+{
+    node_t* n = LOOKUP(s, key);
+    if (n != NULL) {
+        return LDF_P(n, v);
+    }
+    return NULL;
+}
+
+
+/* =============================================================================
+ * HTMatree_get
+ * =============================================================================
+ */
+void*
+HTMatree_get (atree_t* s, void* key)
+{
+    void* val = NULL;
+    node_t* n = HTX_LOOKUP(s, key);
+    if (n != NULL) {
+        val = HTX_LDF_P(n, v);
+    }
+    return val;
+}
+
+
+/* =============================================================================
+ * TMatree_get
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMatree_get (TM_ARGDECL  atree_t* s, void* key)
+{
+    void* val = NULL;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_GET, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(s, key);
+    if (n != NULL) {
+        val = TX_LDF_P(n, v);
+    }
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_GET, &val);
+#endif /* ORIGINAL */
+    return val;
+}
+
+
+/* =============================================================================
+ * atree_contains
+ * =============================================================================
+ */
+long
+atree_contains (atree_t* s, void* key)
+{
+    node_t* n = LOOKUP(s, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * HTMatree_contains
+ * =============================================================================
+ */
+long
+HTMatree_contains (atree_t* s, void* key)
+{
+    node_t* n = HTX_LOOKUP(s, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * TMatree_contains
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMatree_contains (TM_ARGDECL  atree_t* s, void* key)
+{
+    long rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(ATREE_CONTAINS, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(s, key);
+    rv = (n != NULL);
+#ifndef ORIGINAL
+    TM_LOG_END(ATREE_CONTAINS, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * atree_setCompare
+ * =============================================================================
+ */
+void
+atree_setCompare (atree_t* s, long (*compare)(const void*, const void*))
+{
+    STF_P(s, compare, compare);
+}
+
+
+/* =============================================================================
+ * iterateNode
+ * =============================================================================
+ */
+static void
+iterateNode (node_t* n, void (*cb)(void *, void *))
+{
+    if (n) {
+        iterateNode(LDNODE(n, l), cb);
+        if (cb)
+            cb(LDF_P(n, k), LDF_P(n, v));
+        iterateNode(LDNODE(n, r), cb);
+    }
+}
+
+
+/* =============================================================================
+ * atree_iterate
+ * -- Visits elements in key order
+ * =============================================================================
+ */
+void
+atree_iterate (atree_t* s, void (*cb)(void *, void *))
+{
+    iterateNode(LDNODE(s, root), cb);
+}
+
+
+/* /////////////////////////////////////////////////////////////////////////////
+ * TEST_ATREE
+ * /////////////////////////////////////////////////////////////////////////////
+ */
+#ifdef TEST_ATREE
+
+
+#include <assert.h>
+#include <stdio.h>
+
+
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+static void
+insertInt (atree_t* atreePtr, long* data)
+{
+    printf("Inserting: %li\n", *data);
+    atree_insert(atreePtr, (void*)data, (void*)data);
+    assert(*(long*)atree_get(atreePtr, (void*)data) == *data);
+    assert(atree_verify(atreePtr, 0) > 0);
+}
+
+
+static void
+removeInt (atree_t* atreePtr, long* data)
+{
+    printf("Removing: %li\n", *data);
+    atree_delete(atreePtr, (void*)data);
+    assert(atree_get(atreePtr, (void*)data) == NULL);
+    assert(atree_verify(atreePtr, 0) >= 0);
+}
+
+
+int
+main ()
+{
+    long data[] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7};
+    long numData = sizeof(data) / sizeof(data[0]);
+    long i;
+
+    puts("Starting...");
+
+    atree_t* atreePtr = atree_alloc(&compare);
+    assert(atreePtr);
+
+    for (i = 0; i < numData; i++) {
+        insertInt(atreePtr, &data[i]);
+    }
+    assert(atree_verify(atreePtr, 1) == 9);
+
+    for (i = 0; i < numData; i++) {
+        removeInt(atreePtr, &data[i]);
+    }
+    assert(atree_verify(atreePtr, 1) == 0);
+
+    /* Default compare on pointer values, enough keys for deep rebalancing */
+    atree_setCompare(atreePtr, atree_compare);
+    for (i = 1; i <= 4096; i++) {
+        assert(atree_insert(atreePtr, (void*)((i * 7919) % 4099), (void*)i));
+    }
+    assert(atree_verify(atreePtr, 1) == 4096);
+    assert(!atree_insert(atreePtr, (void*)(7919 % 4099), NULL));
+    assert(atree_update(atreePtr, (void*)(7919 % 4099), (void*)-1));
+    assert(atree_get(atreePtr, (void*)(7919 % 4099)) == (void*)-1);
+    for (i = 1; i <= 4096; i += 2) {
+        assert(atree_delete(atreePtr, (void*)((i * 7919) % 4099)));
+        assert(atree_verify(atreePtr, 0) >= 0);
+    }
+    assert(atree_verify(atreePtr, 1) == 2048);
+
+    atree_free(atreePtr, NULL);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_ATREE */
+
+
+/* =============================================================================
+ *
+ * End of atree.c
+ *
+ * =============================================================================
+ */
+
+#ifndef ORIGINAL
+__attribute__((constructor)) void atree_init() {
+    TM_LOG_FFI_DECLARE;
+    TM_LOG_TYPE_DECLARE_INIT(*ppp[], {&ffi_type_pointer, &ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*pp[], {&ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*p[], {&ffi_type_pointer});
+    # define TM_LOG_OP TM_LOG_OP_INIT
+    # include "atree.inc"
+    # undef TM_LOG_OP
+}
+#endif /* ORIGINAL */
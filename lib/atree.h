@@ -0,0 +1,270 @@
+/* =============================================================================
+ *
+ * atree.h
+ * -- Andersson (AA) balanced tree map, same interface as rbtree.h
+ *
+ * =============================================================================
+ *
+ * Selected as the map backend with -DMAP_USE_ATREE. Balance is kept with a
+ * single level per node and only two restructuring primitives (skew and
+ * split), so rebalancing touches fewer nodes than red-black fixups, and
+ * nodes need no parent pointers.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef ATREE_H
+#define ATREE_H 1
+
+
+#include "tm.h"
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct atree atree_t;
+
+
+/* =============================================================================
+ * atree_compare
+ * =============================================================================
+ */
+long
+atree_compare (const void* a, const void* b);
+
+
+/* =============================================================================
+ * atree_verify
+ * -- Returns number of elements, or -1 on error
+ * =============================================================================
+ */
+long
+atree_verify (atree_t* s, long verbose);
+
+
+/* =============================================================================
+ * atree_alloc
+ * =============================================================================
+ */
+atree_t*
+atree_alloc (long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * HTMatree_alloc
+ * =============================================================================
+ */
+atree_t*
+HTMatree_alloc (long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * TMatree_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+atree_t*
+TMatree_alloc (TM_ARGDECL  long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * atree_free
+ * =============================================================================
+ */
+void
+atree_free (atree_t* s, void (*freeData)(void *, void *));
+
+
+/* =============================================================================
+ * HTMatree_free
+ * =============================================================================
+ */
+void
+HTMatree_free (atree_t* s, void (*HTMfreeData)(void *, void *));
+
+
+/* =============================================================================
+ * TMatree_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMatree_free (TM_ARGDECL  atree_t* s, TM_CALLABLE void (*TMfreeData)(void *, void *));
+
+
+/* =============================================================================
+ * atree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+atree_insert (atree_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * HTMatree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+HTMatree_insert (atree_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * TMatree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_insert (TM_ARGDECL  atree_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * atree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+atree_delete (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMatree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+HTMatree_delete (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * TMatree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_delete (TM_ARGDECL  atree_t* s, void* key);
+
+
+/* =============================================================================
+ * atree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+bool_t
+atree_update (atree_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * TMatree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMatree_update (TM_ARGDECL  atree_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * atree_get
+ * =============================================================================
+ */
+void*
+atree_get (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMatree_get
+ * =============================================================================
+ */
+void*
+HTMatree_get (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * TMatree_get
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMatree_get (TM_ARGDECL  atree_t* s, void* key);
+
+
+/* =============================================================================
+ * atree_contains
+ * =============================================================================
+ */
+long
+atree_contains (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMatree_contains
+ * =============================================================================
+ */
+long
+HTMatree_contains (atree_t* s, void* key);
+
+
+/* =============================================================================
+ * TMatree_contains
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMatree_contains (TM_ARGDECL  atree_t* s, void* key);
+
+
+/* =============================================================================
+ * atree_setCompare
+ * =============================================================================
+ */
+void
+atree_setCompare (atree_t* s, long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * atree_iterate
+ * -- Visits elements in key order
+ * =============================================================================
+ */
+void
+atree_iterate (atree_t* s, void (*cb)(void *, void *));
+
+#define HTMATREE_ALLOC(cmp)      HTMatree_alloc(cmp)
+#define HTMATREE_FREE(s, free)   HTMatree_free(s, free)
+#define HTMATREE_INSERT(s, k, v) HTMatree_insert(s, (void*)(k), (void*)(v))
+#define HTMATREE_DELETE(s, k)    HTMatree_delete(s, (void*)(k))
+#define HTMATREE_GET(s, k)       HTMatree_get(s, (void*)(k))
+#define HTMATREE_CONTAINS(s, k)  HTMatree_contains(s, (void*)(k))
+
+#define TMATREE_ALLOC(cmp)       TMatree_alloc(TM_ARG  cmp)
+#define TMATREE_FREE(s, free)    TMatree_free(TM_ARG  s, free)
+#define TMATREE_INSERT(s, k, v)  TMatree_insert(TM_ARG  s, (void*)(k), (void*)(v))
+#define TMATREE_DELETE(s, k)     TMatree_delete(TM_ARG  s, (void*)(k))
+#define TMATREE_UPDATE(s, k, v)  TMatree_update(TM_ARG  s, (void*)(k), (void*)(v))
+#define TMATREE_GET(s, k)        TMatree_get(TM_ARG  s, (void*)(k))
+#define TMATREE_CONTAINS(s, k)   TMatree_contains(TM_ARG  s, (void*)(k))
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* ATREE_H */
+
+
+/* =============================================================================
+ *
+ * End of atree.h
+ *
+ * =============================================================================
+ */
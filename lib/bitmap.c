@@ -77,10 +77,23 @@
 #include "types.h"
 #include "utility.h"
 
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
 
 #define NUM_BIT_PER_BYTE (8L)
 #define NUM_BIT_PER_WORD (sizeof(ulong_t) * NUM_BIT_PER_BYTE)
 
+/* Bits past numBit in the last word are kept clear */
+#define LAST_WORD_MASK(numBit) \
+    (((numBit) % NUM_BIT_PER_WORD) ? \
+     ((1UL << ((numBit) % NUM_BIT_PER_WORD)) - 1) : (ulong_t)(-1L))
+
+#ifdef __AVX2__
+#  define NUM_WORD_PER_VECTOR (long)(sizeof(__m256i) / sizeof(ulong_t))
+#endif
+
 
 /* =============================================================================
  * bitmap_alloc
@@ -260,17 +273,26 @@ bitmap_isSet (bitmap_t* bitmapPtr, long i)
 long
 bitmap_findClear (bitmap_t* bitmapPtr, long startIndex)
 {
-    long i;
     long numBit = bitmapPtr->numBit;
+    long numWord = bitmapPtr->numWord;
     ulong_t* bits = bitmapPtr->bits;
 
-    for (i = MAX(startIndex, 0); i < numBit; i++) {
-        if (!(bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD)))) {
-            return i;
+    long i = MAX(startIndex, 0);
+    if (i >= numBit) {
+        return -1;
+    }
+
+    long w = i / NUM_BIT_PER_WORD;
+    ulong_t word = ~bits[w] & ((ulong_t)(-1L) << (i % NUM_BIT_PER_WORD));
+    while (!word) {
+        if (++w >= numWord) {
+            return -1;
         }
+        word = ~bits[w];
     }
+    i = w * NUM_BIT_PER_WORD + __builtin_ctzl(word);
 
-    return -1;
+    return ((i < numBit) ? i : -1);
 }
 
 
@@ -284,17 +306,25 @@ bitmap_findClear (bitmap_t* bitmapPtr, long startIndex)
 long
 bitmap_findSet (bitmap_t* bitmapPtr, long startIndex)
 {
-    long i;
     long numBit = bitmapPtr->numBit;
+    long numWord = bitmapPtr->numWord;
     ulong_t* bits = bitmapPtr->bits;
 
-    for (i = MAX(startIndex, 0); i < numBit; i++) {
-        if (bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD))) {
-            return i;
+    long i = MAX(startIndex, 0);
+    if (i >= numBit) {
+        return -1;
+    }
+
+    long w = i / NUM_BIT_PER_WORD;
+    ulong_t word = bits[w] & ((ulong_t)(-1L) << (i % NUM_BIT_PER_WORD));
+    while (!word) {
+        if (++w >= numWord) {
+            return -1;
         }
+        word = bits[w];
     }
 
-    return -1;
+    return (w * NUM_BIT_PER_WORD + __builtin_ctzl(word));
 }
 
 
@@ -318,15 +348,13 @@ bitmap_getNumClear (bitmap_t* bitmapPtr)
 long
 bitmap_getNumSet (bitmap_t* bitmapPtr)
 {
-    long i;
-    long numBit = bitmapPtr->numBit;
+    long numWord = bitmapPtr->numWord;
     ulong_t* bits = bitmapPtr->bits;
     long count = 0;
 
-    for (i = 0; i < numBit; i++) {
-        if (bits[i/NUM_BIT_PER_WORD] & (1UL << (i % NUM_BIT_PER_WORD))) {
-            count++;
-        }
+    long w;
+    for (w = 0; w < numWord; w++) {
+        count += __builtin_popcountl(bits[w]);
     }
 
     return count;
@@ -358,6 +386,173 @@ bitmap_toggleAll (bitmap_t* bitmapPtr)
     for (w = 0; w < numWord; w++) {
         bits[w] ^= (ulong_t)(-1L);
     }
+    if (numWord > 0) {
+        bits[numWord - 1] &= LAST_WORD_MASK(bitmapPtr->numBit);
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_setRange
+ * -- Sets bits [startIndex, stopIndex) to 1; range is clipped to the bitmap
+ * =============================================================================
+ */
+void
+bitmap_setRange (bitmap_t* bitmapPtr, long startIndex, long stopIndex)
+{
+    long i = MAX(startIndex, 0);
+    long j = MIN(stopIndex, bitmapPtr->numBit);
+    if (i >= j) {
+        return;
+    }
+
+    ulong_t* bits = bitmapPtr->bits;
+    long w = i / NUM_BIT_PER_WORD;
+    long lastW = (j - 1) / NUM_BIT_PER_WORD;
+    ulong_t firstMask = (ulong_t)(-1L) << (i % NUM_BIT_PER_WORD);
+    ulong_t lastMask = LAST_WORD_MASK(j);
+
+    if (w == lastW) {
+        bits[w] |= (firstMask & lastMask);
+        return;
+    }
+    bits[w] |= firstMask;
+    memset(&bits[w + 1], 0xff, ((lastW - w - 1) * sizeof(ulong_t)));
+    bits[lastW] |= lastMask;
+}
+
+
+/* =============================================================================
+ * bitmap_clearRange
+ * -- Clears bits [startIndex, stopIndex) to 0; range is clipped to the bitmap
+ * =============================================================================
+ */
+void
+bitmap_clearRange (bitmap_t* bitmapPtr, long startIndex, long stopIndex)
+{
+    long i = MAX(startIndex, 0);
+    long j = MIN(stopIndex, bitmapPtr->numBit);
+    if (i >= j) {
+        return;
+    }
+
+    ulong_t* bits = bitmapPtr->bits;
+    long w = i / NUM_BIT_PER_WORD;
+    long lastW = (j - 1) / NUM_BIT_PER_WORD;
+    ulong_t firstMask = (ulong_t)(-1L) << (i % NUM_BIT_PER_WORD);
+    ulong_t lastMask = LAST_WORD_MASK(j);
+
+    if (w == lastW) {
+        bits[w] &= ~(firstMask & lastMask);
+        return;
+    }
+    bits[w] &= ~firstMask;
+    memset(&bits[w + 1], 0, ((lastW - w - 1) * sizeof(ulong_t)));
+    bits[lastW] &= ~lastMask;
+}
+
+
+/* =============================================================================
+ * bitmap_union
+ * -- dst |= src; both must have the same number of bits
+ * =============================================================================
+ */
+void
+bitmap_union (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    ulong_t* dst = dstPtr->bits;
+    ulong_t* src = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w = 0;
+
+#ifdef __AVX2__
+    for (; w + NUM_WORD_PER_VECTOR <= numWord; w += NUM_WORD_PER_VECTOR) {
+        __m256i a = _mm256_loadu_si256((__m256i*)&dst[w]);
+        __m256i b = _mm256_loadu_si256((__m256i*)&src[w]);
+        _mm256_storeu_si256((__m256i*)&dst[w], _mm256_or_si256(a, b));
+    }
+#endif
+    for (; w < numWord; w++) {
+        dst[w] |= src[w];
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_intersect
+ * -- dst &= src; both must have the same number of bits
+ * =============================================================================
+ */
+void
+bitmap_intersect (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    ulong_t* dst = dstPtr->bits;
+    ulong_t* src = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w = 0;
+
+#ifdef __AVX2__
+    for (; w + NUM_WORD_PER_VECTOR <= numWord; w += NUM_WORD_PER_VECTOR) {
+        __m256i a = _mm256_loadu_si256((__m256i*)&dst[w]);
+        __m256i b = _mm256_loadu_si256((__m256i*)&src[w]);
+        _mm256_storeu_si256((__m256i*)&dst[w], _mm256_and_si256(a, b));
+    }
+#endif
+    for (; w < numWord; w++) {
+        dst[w] &= src[w];
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_difference
+ * -- dst &= ~src; both must have the same number of bits
+ * =============================================================================
+ */
+void
+bitmap_difference (bitmap_t* dstPtr, bitmap_t* srcPtr)
+{
+    assert(dstPtr->numBit == srcPtr->numBit);
+    ulong_t* dst = dstPtr->bits;
+    ulong_t* src = srcPtr->bits;
+    long numWord = dstPtr->numWord;
+    long w = 0;
+
+#ifdef __AVX2__
+    for (; w + NUM_WORD_PER_VECTOR <= numWord; w += NUM_WORD_PER_VECTOR) {
+        __m256i a = _mm256_loadu_si256((__m256i*)&dst[w]);
+        __m256i b = _mm256_loadu_si256((__m256i*)&src[w]);
+        _mm256_storeu_si256((__m256i*)&dst[w], _mm256_andnot_si256(b, a));
+    }
+#endif
+    for (; w < numWord; w++) {
+        dst[w] &= ~src[w];
+    }
+}
+
+
+/* =============================================================================
+ * bitmap_intersectCount
+ * -- Returns number of bits set in both; same number of bits required
+ * =============================================================================
+ */
+long
+bitmap_intersectCount (bitmap_t* aPtr, bitmap_t* bPtr)
+{
+    assert(aPtr->numBit == bPtr->numBit);
+    ulong_t* a = aPtr->bits;
+    ulong_t* b = bPtr->bits;
+    long numWord = aPtr->numWord;
+    long count = 0;
+
+    long w;
+    for (w = 0; w < numWord; w++) {
+        count += __builtin_popcountl(a[w] & b[w]);
+    }
+
+    return count;
 }
 
 
@@ -449,6 +644,67 @@ main ()
     assert(bitmap_getNumClear(bitmapPtr) == j);
     assert(bitmap_getNumSet(bitmapPtr) == (numBit - j));
 
+    /* Toggle keeps the bits past numBit clear */
+    bitmap_t* oddPtr = bitmap_alloc(numBit - 3);
+    bitmap_toggleAll(oddPtr);
+    assert(bitmap_getNumSet(oddPtr) == (numBit - 3));
+    assert(bitmap_findClear(oddPtr, -1) == -1);
+    bitmap_free(oddPtr);
+
+    /* Ranges */
+    bitmap_clearAll(bitmapPtr);
+    bitmap_setRange(bitmapPtr, 3, 200);
+    assert(bitmap_getNumSet(bitmapPtr) == 197);
+    assert(bitmap_findSet(bitmapPtr, -1) == 3);
+    assert(bitmap_findClear(bitmapPtr, 3) == 200);
+    bitmap_clearRange(bitmapPtr, 64, 128);
+    assert(bitmap_getNumSet(bitmapPtr) == 133);
+    assert(bitmap_findClear(bitmapPtr, 3) == 64);
+    assert(bitmap_findSet(bitmapPtr, 64) == 128);
+    bitmap_clearRange(bitmapPtr, 10, 11);
+    assert(bitmap_isClear(bitmapPtr, 10) && bitmap_isSet(bitmapPtr, 11));
+    bitmap_setRange(bitmapPtr, -5, numBit + 5);
+    assert(bitmap_getNumSet(bitmapPtr) == numBit);
+
+    /* Set algebra against a per-bit reference */
+    bitmap_t* aPtr = bitmap_alloc(numBit);
+    bitmap_t* bPtr = bitmap_alloc(numBit);
+    char a[numBit];
+    char b[numBit];
+    for (i = 0; i < numBit; i++) {
+        a[i] = (rand() % 3 == 0);
+        b[i] = (rand() % 2 == 0);
+        if (a[i]) {
+            bitmap_set(aPtr, i);
+        }
+        if (b[i]) {
+            bitmap_set(bPtr, i);
+        }
+    }
+    long numBoth = 0;
+    for (i = 0; i < numBit; i++) {
+        numBoth += (a[i] && b[i]);
+    }
+    assert(bitmap_intersectCount(aPtr, bPtr) == numBoth);
+    bitmap_copy(bitmapPtr, aPtr);
+    bitmap_union(bitmapPtr, bPtr);
+    for (i = 0; i < numBit; i++) {
+        assert(bitmap_isSet(bitmapPtr, i) == (a[i] || b[i]));
+    }
+    bitmap_copy(bitmapPtr, aPtr);
+    bitmap_intersect(bitmapPtr, bPtr);
+    assert(bitmap_getNumSet(bitmapPtr) == numBoth);
+    for (i = 0; i < numBit; i++) {
+        assert(bitmap_isSet(bitmapPtr, i) == (a[i] && b[i]));
+    }
+    bitmap_copy(bitmapPtr, aPtr);
+    bitmap_difference(bitmapPtr, bPtr);
+    for (i = 0; i < numBit; i++) {
+        assert(bitmap_isSet(bitmapPtr, i) == (a[i] && !b[i]));
+    }
+    bitmap_free(aPtr);
+    bitmap_free(bPtr);
+
     bitmap_free(bitmapPtr);
 
     puts("All tests passed.");
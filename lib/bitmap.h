@@ -228,6 +228,66 @@ void
 bitmap_toggleAll (bitmap_t* bitmapPtr);
 
 
+/* =============================================================================
+ * bitmap_setRange
+ * -- Sets bits [startIndex, stopIndex) to 1; range is clipped to the bitmap
+ * =============================================================================
+ */
+TM_PURE
+void
+bitmap_setRange (bitmap_t* bitmapPtr, long startIndex, long stopIndex);
+
+
+/* =============================================================================
+ * bitmap_clearRange
+ * -- Clears bits [startIndex, stopIndex) to 0; range is clipped to the bitmap
+ * =============================================================================
+ */
+TM_PURE
+void
+bitmap_clearRange (bitmap_t* bitmapPtr, long startIndex, long stopIndex);
+
+
+/* =============================================================================
+ * bitmap_union
+ * -- dst |= src; both must have the same number of bits
+ * =============================================================================
+ */
+TM_PURE
+void
+bitmap_union (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
+/* =============================================================================
+ * bitmap_intersect
+ * -- dst &= src; both must have the same number of bits
+ * =============================================================================
+ */
+TM_PURE
+void
+bitmap_intersect (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
+/* =============================================================================
+ * bitmap_difference
+ * -- dst &= ~src; both must have the same number of bits
+ * =============================================================================
+ */
+TM_PURE
+void
+bitmap_difference (bitmap_t* dstPtr, bitmap_t* srcPtr);
+
+
+/* =============================================================================
+ * bitmap_intersectCount
+ * -- Returns number of bits set in both; same number of bits required
+ * =============================================================================
+ */
+TM_PURE
+long
+bitmap_intersectCount (bitmap_t* aPtr, bitmap_t* bPtr);
+
+
 #define PBITMAP_ALLOC(n)                Pbitmap_alloc(n)
 #define PBITMAP_FREE(b)                 Pbitmap_free(b)
 #define PBITMAP_SET(b, i)               bitmap_set(b, i)
@@ -240,6 +300,12 @@ bitmap_toggleAll (bitmap_t* bitmapPtr);
 #define PBITMAP_GETNUMSET(b)            bitmap_getNumSet(b)
 #define PBITMAP_COPY(b)                 bitmap_copy(b)
 #define PBITMAP_TOGGLEALL(b)            bitmap_toggleAll(b)
+#define PBITMAP_SETRANGE(b, i, j)       bitmap_setRange(b, i, j)
+#define PBITMAP_CLEARRANGE(b, i, j)     bitmap_clearRange(b, i, j)
+#define PBITMAP_UNION(d, s)             bitmap_union(d, s)
+#define PBITMAP_INTERSECT(d, s)         bitmap_intersect(d, s)
+#define PBITMAP_DIFFERENCE(d, s)        bitmap_difference(d, s)
+#define PBITMAP_INTERSECTCOUNT(a, b)    bitmap_intersectCount(a, b)
 
 
 #ifdef __cplusplus
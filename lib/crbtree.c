@@ -0,0 +1,3646 @@
+/* =============================================================================
+ *
+ * crbtree.c
+ * -- Red-black tree with compact, slab-allocated nodes, storage mode for rbtree.h
+ * -- Selected with -DRBTREE_COMPACT, exports the same rbtree_* API
+ *
+ * =============================================================================
+ *
+ * Copyright (C) Sun Microsystems Inc., 2006.  All Rights Reserved.
+ * Authors: Dave Dice, Nir Shavit, Ori Shalev.
+ *
+ * STM: Transactional Locking for Disjoint Access Parallelism
+ *
+ * Transactional Locking II,
+ * Dave Dice, Ori Shalev, Nir Shavit
+ * DISC 2006, Sept 2006, Stockholm, Sweden.
+ *
+ * =============================================================================
+ *
+ * Modified by Chi Cao Minh, Aug 2006
+ *
+ * =============================================================================
+ *
+ * For the license of bayes/sort.h and bayes/sort.c, please see the header
+ * of the files.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * For the license of kmeans, please see kmeans/LICENSE.kmeans
+ *
+ * ------------------------------------------------------------------------
+ *
+ * For the license of ssca2, please see ssca2/COPYRIGHT
+ *
+ * ------------------------------------------------------------------------
+ *
+ * For the license of lib/mt19937ar.c and lib/mt19937ar.h, please see the
+ * header of the files.
+ *
+ * ------------------------------------------------------------------------
+ *
+ * For the license of lib/rbtree.h and lib/rbtree.c, please see
+ * lib/LEGALNOTICE.rbtree and lib/LICENSE.rbtree
+ *
+ * ------------------------------------------------------------------------
+ *
+ * Unless otherwise noted, the following license applies to STAMP files:
+ *
+ * Copyright (c) 2007, Stanford University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *
+ *     * Neither the name of Stanford University nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY STANFORD UNIVERSITY ``AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL STANFORD UNIVERSITY BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF
+ * THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * =============================================================================
+ */
+
+/*
+ * Nodes are 32 bytes, half a cache line: the child and parent links are
+ * 32-bit indices into one node array reserved at startup, and the color lives
+ * in the low bit of the parent word.
+ *
+ * Each thread allocates from its own pool, which bump-allocates from slabs of
+ * RBTREE_CHUNK_NODES contiguous nodes; freed nodes go on the pool's free
+ * list. A tree built by one thread, such as a table loaded at startup, thus
+ * occupies consecutive lines. The pool is accessed like shared data, so allocations and
+ * frees are undone when a transaction aborts and no shared allocator state is
+ * written inside transactions. Node memory is never returned to the system,
+ * so a stale index read by a doomed transaction always points to a node.
+ *
+ * The transactional operations are registered in crbtree.inc under the same
+ * opcodes as rbtree.inc, but without merge functions, so -DMERGE_RBTREE has
+ * no effect here and conflicts fall back to a restart.
+ */
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <sys/mman.h>
+#include "memory.h"
+#include "rbtree.h"
+#include "tm.h"
+
+#ifdef RBTREE_COMPACT
+
+#ifndef RBTREE_MAX_NODES
+#  define RBTREE_MAX_NODES    (1UL << 24)  /* 512MB of address space */
+#endif
+#ifndef RBTREE_CHUNK_NODES
+#  define RBTREE_CHUNK_NODES  (1024)       /* nodes per pool refill, 32KB */
+#endif
+
+/*
+ * Half a cache line per node. Children and parent are 32-bit indices into
+ * global_nodes (0 -> NULL); l and r share one word, and the color is kept in
+ * the low bit of the parent word. All packed fields are whole words, so
+ * transactional accesses stay word-sized.
+ */
+typedef struct node {
+    void* k;
+    void* v;
+    uint64_t lr;     /* left index | right index << 32 */
+    uint64_t pc;     /* parent index << 1 | color */
+} node_t;
+
+/* Per-thread node pool; read and written like shared data */
+typedef struct pool {
+    uint64_t freeIdx;    /* free list, linked through lr */
+    uint64_t nextIdx;    /* bump allocation in [nextIdx, endIdx) */
+    uint64_t endIdx;
+    uint64_t spareIdx;   /* chunk grabbed by a transaction that may have aborted */
+} pool_t;
+
+
+struct rbtree {
+    node_t* root;
+    TM_PURE long (*compare)(const void*, const void*);   /* returns {-1,0,1}, 0 -> equal */
+};
+
+#define IDX_MASK            ((uint64_t)0xffffffff)
+
+#define LR_GET_L(w)         ((w) & IDX_MASK)
+#define LR_GET_R(w)         ((w) >> 32)
+#define LR_SET_L(w,i)       (((w) & ~IDX_MASK) | (i))
+#define LR_SET_R(w,i)       (((w) & IDX_MASK) | ((i) << 32))
+#define PC_GET_P(w)         ((w) >> 1)
+#define PC_GET_C(w)         ((long)((w) & 1))
+#define PC_SET_P(w,i)       (((w) & 1) | ((i) << 1))
+#define PC_SET_C(w,c)       (((w) & ~(uint64_t)1) | (uint64_t)(c))
+
+static node_t* global_nodes;                      /* RBTREE_MAX_NODES reserved */
+static atomic_ulong global_numNode = 1;           /* index 0 -> NULL */
+static __thread pool_t global_pool;
+
+
+/* =============================================================================
+ * nodeAt
+ * =============================================================================
+ */
+TM_PURE
+static inline node_t*
+nodeAt (uint64_t i)
+{
+    return (i ? &global_nodes[i] : NULL);
+}
+#define NODE_AT(i)  nodeAt(i)
+
+
+/* =============================================================================
+ * indexOf
+ * =============================================================================
+ */
+TM_PURE
+static inline uint64_t
+indexOf (node_t* n)
+{
+    return (n ? (uint64_t)(n - global_nodes) : 0);
+}
+#define INDEX_OF(n)  indexOf((node_t*)(n))
+
+#define LDA(a)              *(a)
+#define STA(a,v)            *(a) = (v)
+#define LDV(a)              (a)
+#define STV(a,v)            (a) = (v)
+#define LDF(o,f)            LD_##f(o)
+#define LDW(o,f)            ((o)->f)
+#define STW(o,f,x)          ((o)->f = (x))
+#define STF(o,f,x)          ST_##f(o, x)
+#define LDNODE(o,f)         ((node_t*)(LDF(o,f)))
+
+#define LD_k(o)             ((o)->k)
+#define LD_v(o)             ((o)->v)
+#define LD_root(o)          ((o)->root)
+#define LD_l(o)             NODE_AT(LR_GET_L((o)->lr))
+#define LD_r(o)             NODE_AT(LR_GET_R((o)->lr))
+#define LD_p(o)             NODE_AT(PC_GET_P((o)->pc))
+#define LD_c(o)             PC_GET_C((o)->pc)
+#define ST_k(o,x)           ((o)->k = (x))
+#define ST_v(o,x)           ((o)->v = (x))
+#define ST_root(o,x)        ((o)->root = (x))
+#define ST_compare(o,x)     ((o)->compare = (x))
+#define ST_l(o,x)           ((o)->lr = LR_SET_L((o)->lr, INDEX_OF(x)))
+#define ST_r(o,x)           ((o)->lr = LR_SET_R((o)->lr, INDEX_OF(x)))
+#define ST_p(o,x)           ((o)->pc = PC_SET_P((o)->pc, INDEX_OF(x)))
+#define ST_c(o,x)           ((o)->pc = PC_SET_C((o)->pc, x))
+
+#define HTX_LDF(o,f)        ((long)HTX_LD_##f(o))
+#define HTX_LDF_P(o,f)      ((void*)HTX_LD_##f(o))
+#define HTX_STF(o,f,x)      HTX_ST_##f(o, x)
+#define HTX_STF_P(o,f,x)    HTX_ST_##f(o, x)
+#define HTX_LDNODE(o,f)     ((node_t*)(HTX_LDF_P((o),f)))
+#define HTX_LDW(o,f)        ((uint64_t)HTM_SHARED_READ((o)->f))
+#define HTX_STW(o,f,x)      HTM_SHARED_WRITE((o)->f, x)
+
+#define HTX_LD_k(o)         HTM_SHARED_READ_P((o)->k)
+#define HTX_LD_v(o)         HTM_SHARED_READ_P((o)->v)
+#define HTX_LD_root(o)      HTM_SHARED_READ_P((o)->root)
+#define HTX_LD_l(o)         NODE_AT(LR_GET_L(HTX_LDW(o, lr)))
+#define HTX_LD_r(o)         NODE_AT(LR_GET_R(HTX_LDW(o, lr)))
+#define HTX_LD_p(o)         NODE_AT(PC_GET_P(HTX_LDW(o, pc)))
+#define HTX_LD_c(o)         PC_GET_C(HTX_LDW(o, pc))
+#define HTX_ST_k(o,x)       HTM_SHARED_WRITE_P((o)->k, x)
+#define HTX_ST_v(o,x)       HTM_SHARED_WRITE_P((o)->v, x)
+#define HTX_ST_root(o,x)    HTM_SHARED_WRITE_P((o)->root, x)
+#define HTX_ST_l(o,x)       HTX_STW(o, lr, LR_SET_L(HTX_LDW(o, lr), INDEX_OF(x)))
+#define HTX_ST_r(o,x)       HTX_STW(o, lr, LR_SET_R(HTX_LDW(o, lr), INDEX_OF(x)))
+#define HTX_ST_p(o,x)       HTX_STW(o, pc, PC_SET_P(HTX_LDW(o, pc), INDEX_OF(x)))
+#define HTX_ST_c(o,x)       HTX_STW(o, pc, PC_SET_C(HTX_LDW(o, pc), x))
+
+#define TX_LDF(o,f)         ((long)TX_LD_##f(o))
+#define TX_LDF_P(o,f)       ((void*)TX_LD_##f(o))
+#define TX_STF(o,f,x)       TX_ST_##f(o, x)
+#define TX_STF_P(o,f,x)     TX_ST_##f(o, x)
+#define TX_LDNODE(o,f)      ((node_t*)(TX_LDF_P((o),f)))
+#define TX_LDW(o,f)         ((uint64_t)TM_SHARED_READ_TAG((o)->f, (uintptr_t)o))
+#define TX_STW(o,f,x)       TM_SHARED_WRITE((o)->f, x)
+
+#define TX_LD_k(o)          TM_SHARED_READ_TAG_P((o)->k, (uintptr_t)o)
+#define TX_LD_v(o)          TM_SHARED_READ_TAG_P((o)->v, (uintptr_t)o)
+#define TX_LD_root(o)       TM_SHARED_READ_TAG_P((o)->root, (uintptr_t)o)
+#define TX_LD_l(o)          NODE_AT(LR_GET_L(TX_LDW(o, lr)))
+#define TX_LD_r(o)          NODE_AT(LR_GET_R(TX_LDW(o, lr)))
+#define TX_LD_p(o)          NODE_AT(PC_GET_P(TX_LDW(o, pc)))
+#define TX_LD_c(o)          PC_GET_C(TX_LDW(o, pc))
+#define TX_ST_k(o,x)        TM_SHARED_WRITE_P((o)->k, x)
+#define TX_ST_v(o,x)        TM_SHARED_WRITE_P((o)->v, x)
+#define TX_ST_root(o,x)     TM_SHARED_WRITE_P((o)->root, x)
+#define TX_ST_compare(o,x)  TM_SHARED_WRITE_P((o)->compare, x)
+#define TX_ST_l(o,x)        TX_STW(o, lr, LR_SET_L(TX_LDW(o, lr), INDEX_OF(x)))
+#define TX_ST_r(o,x)        TX_STW(o, lr, LR_SET_R(TX_LDW(o, lr), INDEX_OF(x)))
+#define TX_ST_p(o,x)        TX_STW(o, pc, PC_SET_P(TX_LDW(o, pc), INDEX_OF(x)))
+#define TX_ST_c(o,x)        TX_STW(o, pc, PC_SET_C(TX_LDW(o, pc), x))
+
+#ifndef ORIGINAL
+# define TM_LOG_OP TM_LOG_OP_DECLARE
+# include "crbtree.inc"
+# undef TM_LOG_OP
+#endif /* ORIGINAL */
+
+/* =============================================================================
+ * DECLARATION OF TM_CALLABLE FUNCTIONS
+ * =============================================================================
+ */
+
+TM_CALLABLE
+static node_t*
+TMlookup (TM_ARGDECL  rbtree_t* s, void* k);
+
+TM_CALLABLE
+static void
+TMrotateLeft (TM_ARGDECL  rbtree_t* s, node_t* x);
+
+TM_CALLABLE
+static void
+TMrotateRight (TM_ARGDECL  rbtree_t* s, node_t* x);
+
+TM_CALLABLE
+static inline node_t*
+TMparentOf (TM_ARGDECL  node_t* n);
+
+TM_CALLABLE
+static inline node_t*
+TMleftOf (TM_ARGDECL  node_t* n);
+
+TM_CALLABLE
+static inline node_t*
+TMrightOf (TM_ARGDECL  node_t* n);
+
+TM_CALLABLE
+static inline long
+TMcolorOf (TM_ARGDECL  node_t* n);
+
+TM_CALLABLE
+static inline void
+TMsetColor (TM_ARGDECL  node_t* n, long c);
+
+#if !defined(RBTREE_RELAXED) || !defined(ORIGINAL)
+TM_CALLABLE
+static void
+TMfixAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x);
+#endif
+
+TM_CALLABLE
+static node_t*
+TMsuccessor  (TM_ARGDECL  node_t* t);
+
+TM_CALLABLE
+static void
+TMfixAfterDeletion  (TM_ARGDECL  rbtree_t* s, node_t*  x);
+
+TM_CALLABLE
+static node_t*
+TMinsert (TM_ARGDECL  rbtree_t* s, void* k, void* v, node_t* n);
+
+TM_CALLABLE
+static node_t*
+TMgetNode (TM_ARGDECL_ALONE);
+
+TM_CALLABLE
+static node_t*
+TMdelete (TM_ARGDECL  rbtree_t* s, node_t* p);
+
+enum {
+    RED   = 0,
+    BLACK = 1
+};
+
+
+/*
+ * See also:
+ * - Doug Lea's j.u.TreeMap
+ * - Keir Fraser's rb_stm.c and rb_lock_serialisedwriters.c in libLtx.
+ *
+ * Following Doug Lea's TreeMap example, we avoid the use of the magic
+ * "nil" sentinel pointers.  The sentinel is simply a convenience and
+ * is not fundamental to the algorithm.  We forgo the sentinel as
+ * it is a source of false+ data conflicts in transactions.  Relatedly,
+ * even with locks, use of a nil sentil can result in considerable
+ * cache coherency traffic on traditional SMPs.
+ */
+
+
+/* =============================================================================
+ * lookup
+ * =============================================================================
+ */
+static node_t*
+lookup (rbtree_t* s, void* k)
+{
+    node_t* p = LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, LDF(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        p = ((cmp < 0) ? LDNODE(p, l) : LDNODE(p, r));
+    }
+
+    return NULL;
+}
+#define LOOKUP(set, key)  lookup(set, key)
+
+
+/* =============================================================================
+ * HTMlookup
+ * =============================================================================
+ */
+static node_t*
+HTMlookup (rbtree_t* s, void* k)
+{
+    node_t* p = HTX_LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, HTX_LDF_P(p, k));
+        if (cmp == 0)
+            goto out;
+        p = ((cmp < 0) ? HTX_LDNODE(p, l) : HTX_LDNODE(p, r));
+    }
+
+out:
+    return p;
+}
+#define HTX_LOOKUP(set, key)  HTMlookup(set, key)
+
+
+/* =============================================================================
+ * TMlookup
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMlookup (TM_ARGDECL  rbtree_t* s, void* k)
+{
+    node_t* p;
+
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_LOOKUP, NULL, s, k);
+#endif /* ORIGINAL */
+
+    p = TX_LDNODE(s, root);
+
+    while (p != NULL) {
+        long cmp = s->compare(k, TX_LDF_P(p, k));
+        if (cmp == 0)
+            goto out;
+        p = ((cmp < 0) ? TX_LDNODE(p, l) : TX_LDNODE(p, r));
+    }
+
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_LOOKUP, &p);
+#endif /* ORIGINAL */
+    return p;
+}
+#define TX_LOOKUP(set, key)  TMlookup(TM_ARG  set, key)
+
+
+/*
+ * Balancing operations.
+ *
+ * Implementations of rebalancings during insertion and deletion are
+ * slightly different than the CLR version.  Rather than using dummy
+ * nilnodes, we use a set of accessors that deal properly with null.  They
+ * are used to avoid messiness surrounding nullness checks in the main
+ * algorithms.
+ *
+ * From CLR
+ */
+
+
+/* =============================================================================
+ * rotateLeft
+ * =============================================================================
+ */
+static void
+rotateLeft (rbtree_t* s, node_t* x)
+{
+    node_t* r = LDNODE(x, r); /* AKA r, y */
+    node_t* rl = LDNODE(r, l);
+    STF(x, r, rl);
+    if (rl != NULL) {
+        STF(rl, p, x);
+    }
+    /* TODO: compute p = xp = LDNODE(x, p).  Use xp for R-Values in following */
+    node_t* xp = LDNODE(x, p);
+    STF(r, p, xp);
+    if (xp == NULL) {
+        STF(s, root, r);
+    } else if (LDNODE(xp, l) == x) {
+        STF(xp, l, r);
+    } else {
+        STF(xp, r, r);
+    }
+    STF(r, l, x);
+    STF(x, p, r);
+}
+#define ROTATE_LEFT(set, node)  rotateLeft(set, node)
+
+
+/* =============================================================================
+ * HTMrotateLeft
+ * =============================================================================
+ */
+static void
+HTMrotateLeft (rbtree_t* s, node_t* x)
+{
+    node_t* r = HTX_LDNODE(x, r); /* AKA r, y */
+    node_t* rl = HTX_LDNODE(r, l);
+    HTX_STF_P(x, r, rl);
+    if (rl != NULL) {
+        HTX_STF_P(rl, p, x);
+    }
+    /* TODO: compute p = xp = LDNODE(x, p).  Use xp for R-Values in following */
+    node_t* xp = HTX_LDNODE(x, p);
+    HTX_STF_P(r, p, xp);
+    if (xp == NULL) {
+        HTX_STF_P(s, root, r);
+    } else if (HTX_LDNODE(xp, l) == x) {
+        HTX_STF_P(xp, l, r);
+    } else {
+        HTX_STF_P(xp, r, r);
+    }
+    HTX_STF_P(r, l, x);
+    HTX_STF_P(x, p, r);
+}
+#define HTX_ROTATE_LEFT(set, node)  HTMrotateLeft(set, node)
+
+
+/* =============================================================================
+ * TMrotateLeft
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMrotateLeft (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    node_t* r = TX_LDNODE(x, r); /* AKA r, y */
+    node_t* rl = TX_LDNODE(r, l);
+    TX_STF_P(x, r, rl);
+    if (rl != NULL) {
+        TX_STF_P(rl, p, x);
+    }
+    /* TODO: compute p = xp = LDNODE(x, p).  Use xp for R-Values in following */
+    node_t* xp = TX_LDNODE(x, p);
+    TX_STF_P(r, p, xp);
+    if (xp == NULL) {
+        TX_STF_P(s, root, r);
+    } else if (TX_LDNODE(xp, l) == x) {
+        TX_STF_P(xp, l, r);
+    } else {
+        TX_STF_P(xp, r, r);
+    }
+    TX_STF_P(r, l, x);
+    TX_STF_P(x, p, r);
+}
+#define TX_ROTATE_LEFT(set, node)  TMrotateLeft(TM_ARG  set, node)
+
+
+/* =============================================================================
+ * rotateRight
+ * =============================================================================
+ */
+static void
+rotateRight (rbtree_t* s, node_t* x)
+{
+    node_t* l = LDNODE(x, l); /* AKA l,y */
+    node_t* lr = LDNODE(l, r);
+    STF(x, l, lr);
+    if (lr != NULL) {
+        STF(lr, p, x);
+    }
+    node_t* xp = LDNODE(x, p);
+    STF(l, p, xp);
+    if (xp == NULL) {
+        STF(s, root, l);
+    } else if (LDNODE(xp, r) == x) {
+        STF(xp, r, l);
+    } else {
+        STF(xp, l, l);
+    }
+    STF(l, r, x);
+    STF(x, p, l);
+}
+#define ROTATE_RIGHT(set, node)  rotateRight(set, node)
+
+
+/* =============================================================================
+ * HTMrotateRight
+ * =============================================================================
+ */
+static void
+HTMrotateRight (rbtree_t* s, node_t* x)
+{
+    node_t* l = HTX_LDNODE(x, l); /* AKA l,y */
+    node_t* lr = HTX_LDNODE(l, r);
+    HTX_STF_P(x, l, lr);
+    if (lr != NULL) {
+        HTX_STF_P(lr, p, x);
+    }
+    node_t* xp = HTX_LDNODE(x, p);
+    HTX_STF_P(l, p, xp);
+    if (xp == NULL) {
+        HTX_STF_P(s, root, l);
+    } else if (HTX_LDNODE(xp, r) == x) {
+        HTX_STF_P(xp, r, l);
+    } else {
+        HTX_STF_P(xp, l, l);
+    }
+    HTX_STF_P(l, r, x);
+    HTX_STF_P(x, p, l);
+}
+#define HTX_ROTATE_RIGHT(set, node)  HTMrotateRight(set, node)
+
+
+/* =============================================================================
+ * TMrotateRight
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMrotateRight (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    node_t* l = TX_LDNODE(x, l); /* AKA l,y */
+    node_t* lr = TX_LDNODE(l, r);
+    TX_STF_P(x, l, lr);
+    if (lr != NULL) {
+        TX_STF_P(lr, p, x);
+    }
+    node_t* xp = TX_LDNODE(x, p);
+    TX_STF_P(l, p, xp);
+    if (xp == NULL) {
+        TX_STF_P(s, root, l);
+    } else if (TX_LDNODE(xp, r) == x) {
+        TX_STF_P(xp, r, l);
+    } else {
+        TX_STF_P(xp, l, l);
+    }
+    TX_STF_P(l, r, x);
+    TX_STF_P(x, p, l);
+}
+#define TX_ROTATE_RIGHT(set, node)  TMrotateRight(TM_ARG  set, node)
+
+
+/* =============================================================================
+ * parentOf
+ * =============================================================================
+ */
+static inline node_t*
+parentOf (node_t* n)
+{
+   return (n ? LDNODE(n,p) : NULL);
+}
+#define PARENT_OF(n) parentOf(n)
+
+
+/* =============================================================================
+ * HTMparentOf
+ * =============================================================================
+ */
+static inline node_t*
+HTMparentOf (node_t* n)
+{
+   return (n ? HTX_LDNODE(n,p) : NULL);
+}
+#define HTX_PARENT_OF(n)  HTMparentOf(TM_ARG  n)
+
+
+/* =============================================================================
+ * TMparentOf
+ * =============================================================================
+ */
+TM_CALLABLE
+static inline node_t*
+TMparentOf (TM_ARGDECL  node_t* n)
+{
+   return (n ? TX_LDNODE(n,p) : NULL);
+}
+#define TX_PARENT_OF(n)  TMparentOf(TM_ARG  n)
+
+
+/* =============================================================================
+ * leftOf
+ * =============================================================================
+ */
+static inline node_t*
+leftOf (node_t* n)
+{
+   return (n ? LDNODE(n, l) : NULL);
+}
+#define LEFT_OF(n)  leftOf(n)
+
+
+/* =============================================================================
+ * HTMleftOf
+ * =============================================================================
+ */
+static inline node_t*
+HTMleftOf (node_t* n)
+{
+   return (n ? HTX_LDNODE(n, l) : NULL);
+}
+#define HTX_LEFT_OF(n)  HTMleftOf(n)
+
+/* =============================================================================
+ * TMleftOf
+ * =============================================================================
+ */
+TM_CALLABLE
+static inline node_t*
+TMleftOf (TM_ARGDECL  node_t* n)
+{
+   return (n ? TX_LDNODE(n, l) : NULL);
+}
+#define TX_LEFT_OF(n)  TMleftOf(TM_ARG  n)
+
+
+/* =============================================================================
+ * rightOf
+ * =============================================================================
+ */
+static inline node_t*
+rightOf (node_t* n)
+{
+    return (n ? LDNODE(n, r) : NULL);
+}
+#define RIGHT_OF(n)  rightOf(n)
+
+
+/* =============================================================================
+ * HTMrightOf
+ * =============================================================================
+ */
+static inline node_t*
+HTMrightOf (node_t* n)
+{
+    return (n ? HTX_LDNODE(n, r) : NULL);
+}
+#define HTX_RIGHT_OF(n)  HTMrightOf(n)
+
+
+/* =============================================================================
+ * TMrightOf
+ * =============================================================================
+ */
+TM_CALLABLE
+static inline node_t*
+TMrightOf (TM_ARGDECL  node_t* n)
+{
+    return (n ? TX_LDNODE(n, r) : NULL);
+}
+#define TX_RIGHT_OF(n)  TMrightOf(TM_ARG  n)
+
+
+/* =============================================================================
+ * colorOf
+ * =============================================================================
+ */
+static inline long
+colorOf (node_t* n)
+{
+    return (n ? (long)LDNODE(n, c) : BLACK);
+}
+#define COLOR_OF(n)  colorOf(n)
+
+
+/* =============================================================================
+ * HTMcolorOf
+ * =============================================================================
+ */
+static inline long
+HTMcolorOf (node_t* n)
+{
+    return (n ? (long)HTX_LDF(n, c) : BLACK);
+}
+#define HTX_COLOR_OF(n)  HTMcolorOf(n)
+
+
+/* =============================================================================
+ * TMcolorOf
+ * =============================================================================
+ */
+TM_CALLABLE
+static inline long
+TMcolorOf (TM_ARGDECL  node_t* n)
+{
+    return (n ? (long)TX_LDF(n, c) : BLACK);
+}
+#define TX_COLOR_OF(n)  TMcolorOf(TM_ARG  n)
+
+
+/* =============================================================================
+ * setColor
+ * =============================================================================
+ */
+static inline void
+setColor (node_t* n, long c)
+{
+    if (n != NULL) {
+        STF(n, c, c);
+    }
+}
+#define SET_COLOR(n, c)  setColor(n, c)
+
+
+/* =============================================================================
+ * HTMsetColor
+ * =============================================================================
+ */
+static inline void
+HTMsetColor (node_t* n, long c)
+{
+    if (n != NULL) {
+        HTX_STF(n, c, c);
+    }
+}
+#define HTX_SET_COLOR(n, c)  HTMsetColor(n, c)
+
+
+/* =============================================================================
+ * TMsetColor
+ * =============================================================================
+ */
+TM_CALLABLE
+static inline void
+TMsetColor (TM_ARGDECL  node_t* n, long c)
+{
+    if (n != NULL) {
+        TX_STF(n, c, c);
+    }
+}
+#define TX_SET_COLOR(n, c)  TMsetColor(TM_ARG  n, c)
+
+
+/* =============================================================================
+ * fixAfterInsertion
+ * =============================================================================
+ */
+static void
+fixAfterInsertion (rbtree_t* s, node_t* x)
+{
+    STF(x, c, RED);
+    while (x != NULL && x != LDNODE(s, root)) {
+        node_t* xp = PARENT_OF(x);
+        if (LDF(xp, c) != RED) {
+            break;
+        }
+        node_t *g = PARENT_OF(xp);
+        if (xp == LEFT_OF(g)) {
+            node_t* y = RIGHT_OF(g);
+            if (COLOR_OF(y) == RED) {
+                SET_COLOR(xp, BLACK);
+                SET_COLOR(y, BLACK);
+                SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == RIGHT_OF(xp)) {
+                    x = xp;
+                    ROTATE_LEFT(s, x);
+                    xp = PARENT_OF(x);
+                }
+                SET_COLOR(xp, BLACK);
+                SET_COLOR(g, RED);
+                if (g != NULL) {
+                    ROTATE_RIGHT(s, g);
+                }
+            }
+        } else {
+            node_t* y = LEFT_OF(g);
+            if (COLOR_OF(y) == RED) {
+                SET_COLOR(xp, BLACK);
+                SET_COLOR(y, BLACK);
+                SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == LEFT_OF(xp)) {
+                    x = xp;
+                    ROTATE_RIGHT(s, x);
+                    xp = PARENT_OF(x);
+                }
+                SET_COLOR(xp, BLACK);
+                SET_COLOR(g, RED);
+                if (g != NULL) {
+                    ROTATE_LEFT(s, g);
+                }
+            }
+        }
+    }
+    node_t* ro = LDNODE(s, root);
+    if (LDF(ro, c) != BLACK) {
+        STF(ro, c, BLACK);
+    }
+}
+#define FIX_AFTER_INSERTION(s, x)  fixAfterInsertion(s, x)
+
+
+#ifndef RBTREE_RELAXED /* relaxed transactions repair instead */
+/* =============================================================================
+ * HTMfixAfterInsertion
+ * =============================================================================
+ */
+static void
+HTMfixAfterInsertion (rbtree_t* s, node_t* x)
+{
+    HTX_STF(x, c, RED);
+    while (x != NULL && x != HTX_LDNODE(s, root)) {
+        node_t* xp = HTX_PARENT_OF(x);
+        if (HTX_LDF(xp, c) != RED) {
+            break;
+        }
+        node_t *g = HTX_PARENT_OF(xp);
+        if (xp == HTX_LEFT_OF(g)) {
+            node_t* y = HTX_RIGHT_OF(g);
+            if (HTX_COLOR_OF(y) == RED) {
+                HTX_SET_COLOR(xp, BLACK);
+                HTX_SET_COLOR(y, BLACK);
+                HTX_SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == HTX_RIGHT_OF(xp)) {
+                    x = xp;
+                    HTX_ROTATE_LEFT(s, x);
+                    xp = HTX_PARENT_OF(x);
+                }
+                HTX_SET_COLOR(xp, BLACK);
+                HTX_SET_COLOR(g, RED);
+                if (g != NULL) {
+                    HTX_ROTATE_RIGHT(s, g);
+                }
+            }
+        } else {
+            node_t* y = HTX_LEFT_OF(g);
+            if (HTX_COLOR_OF(y) == RED) {
+                HTX_SET_COLOR(xp, BLACK);
+                HTX_SET_COLOR(y, BLACK);
+                HTX_SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == HTX_LEFT_OF(xp)) {
+                    x = xp;
+                    HTX_ROTATE_RIGHT(s, x);
+                    xp = HTX_PARENT_OF(x);
+                }
+                HTX_SET_COLOR(xp, BLACK);
+                HTX_SET_COLOR(g, RED);
+                if (g != NULL) {
+                    HTX_ROTATE_LEFT(s, g);
+                }
+            }
+        }
+    }
+    node_t* ro = HTX_LDNODE(s, root);
+    if (HTX_LDF(ro, c) != BLACK) {
+        HTX_STF(ro, c, BLACK);
+    }
+}
+#define HTX_FIX_AFTER_INSERTION(s, x)  HTMfixAfterInsertion(s, x)
+#endif /* !RBTREE_RELAXED */
+
+
+#if !defined(RBTREE_RELAXED) || !defined(ORIGINAL) /* rbtree.inc names it */
+/* =============================================================================
+ * TMfixAfterInsertion
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMfixAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_FIX_INS, NULL, s, x);
+#endif /* ORIGINAL */
+
+    TX_STF(x, c, RED);
+    while (x != NULL && x != TX_LDNODE(s, root)) {
+        node_t* xp = TX_PARENT_OF(x);
+        if (TX_LDF(xp, c) != RED) {
+            break;
+        }
+        node_t *g = TX_PARENT_OF(xp);
+        if (xp == TX_LEFT_OF(g)) {
+            node_t* y = TX_RIGHT_OF(g);
+            if (TX_COLOR_OF(y) == RED) {
+                TX_SET_COLOR(xp, BLACK);
+                TX_SET_COLOR(y, BLACK);
+                TX_SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == TX_RIGHT_OF(xp)) {
+                    x = xp;
+                    TX_ROTATE_LEFT(s, x);
+                    xp = TX_PARENT_OF(x);
+                }
+                TX_SET_COLOR(xp, BLACK);
+                TX_SET_COLOR(g, RED);
+                if (g != NULL) {
+                    TX_ROTATE_RIGHT(s, g);
+                }
+            }
+        } else {
+            node_t* y = TX_LEFT_OF(g);
+            if (TX_COLOR_OF(y) == RED) {
+                TX_SET_COLOR(xp, BLACK);
+                TX_SET_COLOR(y, BLACK);
+                TX_SET_COLOR(g, RED);
+                x = g;
+            } else {
+                if (x == TX_LEFT_OF(xp)) {
+                    x = xp;
+                    TX_ROTATE_RIGHT(s, x);
+                    xp = TX_PARENT_OF(x);
+                }
+                TX_SET_COLOR(xp, BLACK);
+                TX_SET_COLOR(g, RED);
+                if (g != NULL) {
+                    TX_ROTATE_LEFT(s, g);
+                }
+            }
+        }
+    }
+    node_t* ro = TX_LDNODE(s, root);
+    if (TX_LDF(ro, c) != BLACK) {
+        TX_STF(ro, c, BLACK);
+    }
+
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_FIX_INS, NULL);
+#endif /* ORIGINAL */
+}
+#define TX_FIX_AFTER_INSERTION(s, x)  TMfixAfterInsertion(TM_ARG  s, x)
+#endif /* !RBTREE_RELAXED || !ORIGINAL */
+
+
+#ifdef RBTREE_RELAXED
+/*
+ * Relaxed balance: a transactional insertion only links the new RED leaf.
+ * When that creates a red-red violation, the (tree, key) pair is recorded in
+ * a per-thread buffer instead of rotating near the root inside the enclosing
+ * transaction; [TM]rbtree_rebalance() repairs the recorded violations later
+ * in a separate short transaction. Repairs look the key up again and only act
+ * if the violation is still present, so entries left behind by an aborted
+ * transaction, or by a node that has since been deleted, are harmless.
+ *
+ * Deferred violations can stack: a thread may insert below another thread's
+ * pending violation, leaving a chain of red nodes whose top pair must be fixed
+ * first, since the usual fix assumes a black grandparent. Repairs always run
+ * to completion, so every pending violation is between nodes of black height
+ * one; black heights are never affected, and a deletion fix, which only sees
+ * nodes of greater black height around a black node, never meets one.
+ */
+typedef struct pending {
+    rbtree_t* s;
+    void* k;
+} pending_t;
+
+static __thread pending_t global_pending[RBTREE_PENDING_MAX];
+static __thread long global_numPending = 0;
+
+
+/* =============================================================================
+ * deferFix
+ * -- Returns FALSE if the buffer is full and the caller must fix in place
+ * =============================================================================
+ */
+static inline bool_t
+deferFix (rbtree_t* s, void* k)
+{
+    if (global_numPending == RBTREE_PENDING_MAX) {
+        return FALSE;
+    }
+    global_pending[global_numPending].s = s;
+    global_pending[global_numPending].k = k;
+    global_numPending++;
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * fixInsertionStep
+ * -- x and its parent are red and its grandparent is not: does one step of
+ *    the insertion fix, and returns the grandparent if that step recolored it
+ *    red, else NULL
+ * =============================================================================
+ */
+static node_t*
+fixInsertionStep (rbtree_t* s, node_t* x)
+{
+    node_t* xp = PARENT_OF(x);
+    node_t* g = PARENT_OF(xp);
+    if (g == NULL) {
+        SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == LEFT_OF(g)) {
+        node_t* y = RIGHT_OF(g);
+        if (COLOR_OF(y) == RED) {
+            SET_COLOR(xp, BLACK);
+            SET_COLOR(y, BLACK);
+            SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == RIGHT_OF(xp)) {
+            ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        SET_COLOR(xp, BLACK);
+        SET_COLOR(g, RED);
+        ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = LEFT_OF(g);
+        if (COLOR_OF(y) == RED) {
+            SET_COLOR(xp, BLACK);
+            SET_COLOR(y, BLACK);
+            SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == LEFT_OF(xp)) {
+            ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        SET_COLOR(xp, BLACK);
+        SET_COLOR(g, RED);
+        ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define FIX_INSERTION_STEP(s, x)  fixInsertionStep(s, x)
+
+
+/* =============================================================================
+ * HTMfixInsertionStep
+ * =============================================================================
+ */
+static node_t*
+HTMfixInsertionStep (rbtree_t* s, node_t* x)
+{
+    node_t* xp = HTX_PARENT_OF(x);
+    node_t* g = HTX_PARENT_OF(xp);
+    if (g == NULL) {
+        HTX_SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == HTX_LEFT_OF(g)) {
+        node_t* y = HTX_RIGHT_OF(g);
+        if (HTX_COLOR_OF(y) == RED) {
+            HTX_SET_COLOR(xp, BLACK);
+            HTX_SET_COLOR(y, BLACK);
+            HTX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == HTX_RIGHT_OF(xp)) {
+            HTX_ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        HTX_SET_COLOR(xp, BLACK);
+        HTX_SET_COLOR(g, RED);
+        HTX_ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = HTX_LEFT_OF(g);
+        if (HTX_COLOR_OF(y) == RED) {
+            HTX_SET_COLOR(xp, BLACK);
+            HTX_SET_COLOR(y, BLACK);
+            HTX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == HTX_LEFT_OF(xp)) {
+            HTX_ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        HTX_SET_COLOR(xp, BLACK);
+        HTX_SET_COLOR(g, RED);
+        HTX_ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define HTX_FIX_INSERTION_STEP(s, x)  HTMfixInsertionStep(s, x)
+
+
+/* =============================================================================
+ * TMfixInsertionStep
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMfixInsertionStep (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    node_t* xp = TX_PARENT_OF(x);
+    node_t* g = TX_PARENT_OF(xp);
+    if (g == NULL) {
+        TX_SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == TX_LEFT_OF(g)) {
+        node_t* y = TX_RIGHT_OF(g);
+        if (TX_COLOR_OF(y) == RED) {
+            TX_SET_COLOR(xp, BLACK);
+            TX_SET_COLOR(y, BLACK);
+            TX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == TX_RIGHT_OF(xp)) {
+            TX_ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        TX_SET_COLOR(xp, BLACK);
+        TX_SET_COLOR(g, RED);
+        TX_ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = TX_LEFT_OF(g);
+        if (TX_COLOR_OF(y) == RED) {
+            TX_SET_COLOR(xp, BLACK);
+            TX_SET_COLOR(y, BLACK);
+            TX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == TX_LEFT_OF(xp)) {
+            TX_ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        TX_SET_COLOR(xp, BLACK);
+        TX_SET_COLOR(g, RED);
+        TX_ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define TX_FIX_INSERTION_STEP(s, x)  TMfixInsertionStep(TM_ARG  s, x)
+
+
+/* =============================================================================
+ * repairInsertion
+ * -- Repairs the red-red violation between x and its parent, if there is one
+ * -- Violations deferred by other threads can sit right above it, and the
+ *    insertion fix assumes a black grandparent, so each step is taken at the
+ *    topmost red pair of the chain; a step that recolors the grandparent red
+ *    repairs that new violation before going on
+ * =============================================================================
+ */
+static void
+repairInsertion (rbtree_t* s, node_t* x)
+{
+    while (COLOR_OF(x) == RED && COLOR_OF(PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (COLOR_OF(PARENT_OF(PARENT_OF(t))) == RED) {
+            t = PARENT_OF(t);
+        }
+        node_t* g = FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            repairInsertion(s, g);
+        }
+    }
+    node_t* ro = LDNODE(s, root);
+    if (COLOR_OF(ro) == RED) {
+        SET_COLOR(ro, BLACK);
+    }
+}
+#define REPAIR_INSERTION(s, x)  repairInsertion(s, x)
+
+
+/* =============================================================================
+ * HTMrepairInsertion
+ * =============================================================================
+ */
+static void
+HTMrepairInsertion (rbtree_t* s, node_t* x)
+{
+    while (HTX_COLOR_OF(x) == RED && HTX_COLOR_OF(HTX_PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (HTX_COLOR_OF(HTX_PARENT_OF(HTX_PARENT_OF(t))) == RED) {
+            t = HTX_PARENT_OF(t);
+        }
+        node_t* g = HTX_FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            HTMrepairInsertion(s, g);
+        }
+    }
+    node_t* ro = HTX_LDNODE(s, root);
+    if (HTX_COLOR_OF(ro) == RED) {
+        HTX_SET_COLOR(ro, BLACK);
+    }
+}
+#define HTX_REPAIR_INSERTION(s, x)  HTMrepairInsertion(s, x)
+
+
+/* =============================================================================
+ * TMrepairInsertion
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMrepairInsertion (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    while (TX_COLOR_OF(x) == RED && TX_COLOR_OF(TX_PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (TX_COLOR_OF(TX_PARENT_OF(TX_PARENT_OF(t))) == RED) {
+            t = TX_PARENT_OF(t);
+        }
+        node_t* g = TX_FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            TMrepairInsertion(TM_ARG  s, g);
+        }
+    }
+    node_t* ro = TX_LDNODE(s, root);
+    if (TX_COLOR_OF(ro) == RED) {
+        TX_SET_COLOR(ro, BLACK);
+    }
+}
+#define TX_REPAIR_INSERTION(s, x)  TMrepairInsertion(TM_ARG  s, x)
+
+
+/* =============================================================================
+ * HTMmarkAfterInsertion
+ * -- New node x is still private; xp is its parent
+ * =============================================================================
+ */
+static void
+HTMmarkAfterInsertion (rbtree_t* s, node_t* x, node_t* xp)
+{
+    HTX_STF(x, c, RED);
+    if (HTX_LDF(xp, c) == RED && !deferFix(s, HTX_LDF_P(x, k))) {
+        HTX_REPAIR_INSERTION(s, x);
+    }
+}
+#define HTX_MARK_AFTER_INSERTION(s, x, xp)  HTMmarkAfterInsertion(s, x, xp)
+
+
+/* =============================================================================
+ * TMmarkAfterInsertion
+ * -- New node x is still private; xp is its parent
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMmarkAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x, node_t* xp)
+{
+    TX_STF(x, c, RED);
+    if (TX_LDF(xp, c) == RED && !deferFix(s, TX_LDF_P(x, k))) {
+        TX_REPAIR_INSERTION(s, x);
+    }
+}
+#define TX_MARK_AFTER_INSERTION(s, x, xp)  TMmarkAfterInsertion(TM_ARG  s, x, xp)
+
+#else /* !RBTREE_RELAXED */
+
+#define HTX_MARK_AFTER_INSERTION(s, x, xp)  HTX_FIX_AFTER_INSERTION(s, x)
+#define TX_MARK_AFTER_INSERTION(s, x, xp)   TX_FIX_AFTER_INSERTION(s, x)
+
+#endif /* !RBTREE_RELAXED */
+
+
+/* =============================================================================
+ * insert
+ * =============================================================================
+ */
+static node_t*
+insert (rbtree_t* s, void* k, void* v, node_t* n)
+{
+    node_t* t  = LDNODE(s, root);
+    if (t == NULL) {
+        if (n == NULL) {
+            return NULL;
+        }
+        /* Note: the following STs don't really need to be transactional */
+        STF(n, l, NULL);
+        STF(n, r, NULL);
+        STF(n, p, NULL);
+        STF(n, k, k);
+        STF(n, v, v);
+        STF(n, c, BLACK);
+        STF(s, root, n);
+        return NULL;
+    }
+
+    for (;;) {
+        long cmp = s->compare(k, LDF(t, k));
+        if (cmp == 0) {
+            return t;
+        } else if (cmp < 0) {
+            node_t* tl = LDNODE(t, l);
+            if (tl != NULL) {
+                t = tl;
+            } else {
+                STF(n, l, NULL);
+                STF(n, r, NULL);
+                STF(n, k, k);
+                STF(n, v, v);
+                STF(n, p, t);
+                STF(t, l, n);
+                FIX_AFTER_INSERTION(s, n);
+                return NULL;
+            }
+        } else { /* cmp > 0 */
+            node_t* tr = LDNODE(t, r);
+            if (tr != NULL) {
+                t = tr;
+            } else {
+                STF(n, l, NULL);
+                STF(n, r, NULL);
+                STF(n, k, k);
+                STF(n, v, v);
+                STF(n, p, t);
+                STF(t, r, n);
+                FIX_AFTER_INSERTION(s, n);
+                return NULL;
+            }
+        }
+    }
+}
+#define INSERT(s, k, v, n)  insert(s, k, v, n)
+
+
+/* =============================================================================
+ * TMinsert
+ * =============================================================================
+ */
+static node_t*
+HTMinsert (rbtree_t* s, void* k, void* v, node_t* n)
+{
+    node_t* t  = HTX_LDNODE(s, root);
+    if (t == NULL) {
+        if (n == NULL) {
+            return NULL;
+        }
+        n->lr = 0;
+        n->pc = BLACK;
+        n->k = k;
+        n->v = v;
+        HTX_STF_P(s, root, n);
+        return NULL;
+    }
+
+    for (;;) {
+        long cmp = s->compare(k, HTX_LDF_P(t, k));
+        if (cmp == 0) {
+            return t;
+        } else if (cmp < 0) {
+            node_t* tl = HTX_LDNODE(t, l);
+            if (tl != NULL) {
+                t = tl;
+            } else {
+                n->lr = 0;
+                n->pc = PC_SET_P((uint64_t)RED, INDEX_OF(t));
+                n->k = k;
+                n->v = v;
+                HTX_STF_P(t, l, n);
+                HTX_MARK_AFTER_INSERTION(s, n, t);
+                return NULL;
+            }
+        } else { /* cmp > 0 */
+            node_t* tr = HTX_LDNODE(t, r);
+            if (tr != NULL) {
+                t = tr;
+            } else {
+                n->lr = 0;
+                n->pc = PC_SET_P((uint64_t)RED, INDEX_OF(t));
+                n->k = k;
+                n->v = v;
+                HTX_STF_P(t, r, n);
+                HTX_MARK_AFTER_INSERTION(s, n, t);
+                return NULL;
+            }
+        }
+    }
+}
+#define HTX_INSERT(s, k, v, n) HTMinsert(s, k, v, n)
+
+
+/* =============================================================================
+ * TMinsert
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMinsert (TM_ARGDECL  rbtree_t* s, void* k, void* v, node_t* n)
+{
+    node_t* t  = TX_LDNODE(s, root);
+    if (t == NULL) {
+        if (n == NULL) {
+            return NULL;
+        }
+        TX_STW(n, lr, 0);
+        TX_STW(n, pc, BLACK);
+        TX_STW(n, k, k);
+        TX_STW(n, v, v);
+        TX_STF_P(s, root, n);
+        return NULL;
+    }
+
+    for (;;) {
+        long cmp = s->compare(k, TX_LDF_P(t, k));
+        if (cmp == 0) {
+            return t;
+        } else if (cmp < 0) {
+            node_t* tl = TX_LDNODE(t, l);
+            if (tl != NULL) {
+                t = tl;
+            } else {
+                TX_STW(n, lr, 0);
+                TX_STW(n, pc, PC_SET_P((uint64_t)RED, INDEX_OF(t)));
+                TX_STW(n, k, k);
+                TX_STW(n, v, v);
+                TX_STF_P(t, l, n);
+                TX_MARK_AFTER_INSERTION(s, n, t);
+                return NULL;
+            }
+        } else { /* cmp > 0 */
+            node_t* tr = TX_LDNODE(t, r);
+            if (tr != NULL) {
+                t = tr;
+            } else {
+                TX_STW(n, lr, 0);
+                TX_STW(n, pc, PC_SET_P((uint64_t)RED, INDEX_OF(t)));
+                TX_STW(n, k, k);
+                TX_STW(n, v, v);
+                TX_STF_P(t, r, n);
+                TX_MARK_AFTER_INSERTION(s, n, t);
+                return NULL;
+            }
+        }
+    }
+}
+#define TX_INSERT(s, k, v, n)  TMinsert(TM_ARG  s, k, v, n)
+
+
+/*
+ * Return the given node's successor node---the node which has the
+ * next key in the the left to right ordering. If the node has
+ * no successor, a null pointer is returned rather than a pointer to
+ * the nil node
+ */
+
+
+/* =============================================================================
+ * successor
+ * =============================================================================
+ */
+static node_t*
+successor (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (LDNODE(t, r) != NULL) {
+        node_t* p = LDNODE(t, r);
+        while (LDNODE(p, l) != NULL) {
+            p = LDNODE(p, l);
+        }
+        return p;
+    } else {
+        node_t* p = LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == LDNODE(p, r)) {
+            ch = p;
+            p = LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define SUCCESSOR(n)  successor(n)
+
+
+/* =============================================================================
+ * HTMsuccessor
+ * =============================================================================
+ */
+static node_t*
+HTMsuccessor  (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (HTX_LDNODE(t, r) != NULL) {
+        node_t* p = HTX_LDNODE(t,r);
+        while (HTX_LDNODE(p, l) != NULL) {
+            p = HTX_LDNODE(p, l);
+        }
+        return p;
+    } else {
+        node_t* p = HTX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == HTX_LDNODE(p, r)) {
+            ch = p;
+            p = HTX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define HTX_SUCCESSOR(n)  HTMsuccessor(n)
+
+
+/* =============================================================================
+ * TMsuccessor
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMsuccessor  (TM_ARGDECL  node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (TX_LDNODE(t, r) != NULL) {
+        node_t* p = TX_LDNODE(t,r);
+        while (TX_LDNODE(p, l) != NULL) {
+            p = TX_LDNODE(p, l);
+        }
+        return p;
+    } else {
+        node_t* p = TX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == TX_LDNODE(p, r)) {
+            ch = p;
+            p = TX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define TX_SUCCESSOR(n)  TMsuccessor(TM_ARG  n)
+
+
+/* =============================================================================
+ * fixAfterDeletion
+ * =============================================================================
+ */
+static void
+fixAfterDeletion (rbtree_t* s, node_t* x)
+{
+    while (x != LDNODE(s,root) && COLOR_OF(x) == BLACK) {
+        if (x == LEFT_OF(PARENT_OF(x))) {
+            node_t* sib = RIGHT_OF(PARENT_OF(x));
+            if (COLOR_OF(sib) == RED) {
+                SET_COLOR(sib, BLACK);
+                SET_COLOR(PARENT_OF(x), RED);
+                ROTATE_LEFT(s, PARENT_OF(x));
+                sib = RIGHT_OF(PARENT_OF(x));
+            }
+            if (COLOR_OF(LEFT_OF(sib)) == BLACK &&
+                COLOR_OF(RIGHT_OF(sib)) == BLACK) {
+                SET_COLOR(sib, RED);
+                x = PARENT_OF(x);
+            } else {
+                if (COLOR_OF(RIGHT_OF(sib)) == BLACK) {
+                    SET_COLOR(LEFT_OF(sib), BLACK);
+                    SET_COLOR(sib, RED);
+                    ROTATE_RIGHT(s, sib);
+                    sib = RIGHT_OF(PARENT_OF(x));
+                }
+                SET_COLOR(sib, COLOR_OF(PARENT_OF(x)));
+                SET_COLOR(PARENT_OF(x), BLACK);
+                SET_COLOR(RIGHT_OF(sib), BLACK);
+                ROTATE_LEFT(s, PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = LDNODE(s,root);
+            }
+        } else { /* symmetric */
+            node_t* sib = LEFT_OF(PARENT_OF(x));
+            if (COLOR_OF(sib) == RED) {
+                SET_COLOR(sib, BLACK);
+                SET_COLOR(PARENT_OF(x), RED);
+                ROTATE_RIGHT(s, PARENT_OF(x));
+                sib = LEFT_OF(PARENT_OF(x));
+            }
+            if (COLOR_OF(RIGHT_OF(sib)) == BLACK &&
+                COLOR_OF(LEFT_OF(sib)) == BLACK) {
+                SET_COLOR(sib,  RED);
+                x = PARENT_OF(x);
+            } else {
+                if (COLOR_OF(LEFT_OF(sib)) == BLACK) {
+                    SET_COLOR(RIGHT_OF(sib), BLACK);
+                    SET_COLOR(sib, RED);
+                    ROTATE_LEFT(s, sib);
+                    sib = LEFT_OF(PARENT_OF(x));
+                }
+                SET_COLOR(sib, COLOR_OF(PARENT_OF(x)));
+                SET_COLOR(PARENT_OF(x), BLACK);
+                SET_COLOR(LEFT_OF(sib), BLACK);
+                ROTATE_RIGHT(s, PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = LDNODE(s, root);
+            }
+        }
+    }
+
+    if (x != NULL && LDF(x,c) != BLACK) {
+       STF(x, c, BLACK);
+    }
+}
+#define FIX_AFTER_DELETION(s, n)  fixAfterDeletion(s, n)
+
+
+/* =============================================================================
+ * HTMfixAfterDeletion
+ * =============================================================================
+ */
+static void
+HTMfixAfterDeletion  (rbtree_t* s, node_t* x)
+{
+    while (x != HTX_LDNODE(s,root) && HTX_COLOR_OF(x) == BLACK) {
+        if (x == HTX_LEFT_OF(HTX_PARENT_OF(x))) {
+            node_t* sib = HTX_RIGHT_OF(HTX_PARENT_OF(x));
+            if (HTX_COLOR_OF(sib) == RED) {
+                HTX_SET_COLOR(sib, BLACK);
+                HTX_SET_COLOR(TX_PARENT_OF(x), RED);
+                HTX_ROTATE_LEFT(s, HTX_PARENT_OF(x));
+                sib = HTX_RIGHT_OF(HTX_PARENT_OF(x));
+            }
+            if (HTX_COLOR_OF(HTX_LEFT_OF(sib)) == BLACK &&
+                HTX_COLOR_OF(HTX_RIGHT_OF(sib)) == BLACK) {
+                HTX_SET_COLOR(sib, RED);
+                x = HTX_PARENT_OF(x);
+            } else {
+                if (HTX_COLOR_OF(HTX_RIGHT_OF(sib)) == BLACK) {
+                    HTX_SET_COLOR(HTX_LEFT_OF(sib), BLACK);
+                    HTX_SET_COLOR(sib, RED);
+                    HTX_ROTATE_RIGHT(s, sib);
+                    sib = HTX_RIGHT_OF(HTX_PARENT_OF(x));
+                }
+                HTX_SET_COLOR(sib, HTX_COLOR_OF(HTX_PARENT_OF(x)));
+                HTX_SET_COLOR(HTX_PARENT_OF(x), BLACK);
+                HTX_SET_COLOR(HTX_RIGHT_OF(sib), BLACK);
+                HTX_ROTATE_LEFT(s, HTX_PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = HTX_LDNODE(s,root);
+            }
+        } else { /* symmetric */
+            node_t* sib = HTX_LEFT_OF(HTX_PARENT_OF(x));
+
+            if (HTX_COLOR_OF(sib) == RED) {
+                HTX_SET_COLOR(sib, BLACK);
+                HTX_SET_COLOR(HTX_PARENT_OF(x), RED);
+                HTX_ROTATE_RIGHT(s, HTX_PARENT_OF(x));
+                sib = HTX_LEFT_OF(HTX_PARENT_OF(x));
+            }
+            if (HTX_COLOR_OF(HTX_RIGHT_OF(sib)) == BLACK &&
+                HTX_COLOR_OF(HTX_LEFT_OF(sib)) == BLACK) {
+                HTX_SET_COLOR(sib,  RED);
+                x = HTX_PARENT_OF(x);
+            } else {
+                if (HTX_COLOR_OF(HTX_LEFT_OF(sib)) == BLACK) {
+                    HTX_SET_COLOR(HTX_RIGHT_OF(sib), BLACK);
+                    HTX_SET_COLOR(sib, RED);
+                    HTX_ROTATE_LEFT(s, sib);
+                    sib = HTX_LEFT_OF(HTX_PARENT_OF(x));
+                }
+                HTX_SET_COLOR(sib, HTX_COLOR_OF(HTX_PARENT_OF(x)));
+                HTX_SET_COLOR(HTX_PARENT_OF(x), BLACK);
+                HTX_SET_COLOR(HTX_LEFT_OF(sib), BLACK);
+                HTX_ROTATE_RIGHT(s, TX_PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = HTX_LDNODE(s, root);
+            }
+        }
+    }
+
+    if (x != NULL && HTX_LDF(x,c) != BLACK) {
+       HTX_STF(x, c, BLACK);
+    }
+}
+#define HTX_FIX_AFTER_DELETION(s, n)  HTMfixAfterDeletion(TM_ARG  s, n )
+
+
+/* =============================================================================
+ * TMfixAfterDeletion
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMfixAfterDeletion  (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_FIX_DEL, NULL, s, x);
+#endif /* ORIGINAL */
+
+    while (x != TX_LDNODE(s,root) && TX_COLOR_OF(x) == BLACK) {
+        if (x == TX_LEFT_OF(TX_PARENT_OF(x))) {
+            node_t* sib = TX_RIGHT_OF(TX_PARENT_OF(x));
+            if (TX_COLOR_OF(sib) == RED) {
+                TX_SET_COLOR(sib, BLACK);
+                TX_SET_COLOR(TX_PARENT_OF(x), RED);
+                TX_ROTATE_LEFT(s, TX_PARENT_OF(x));
+                sib = TX_RIGHT_OF(TX_PARENT_OF(x));
+            }
+            if (TX_COLOR_OF(TX_LEFT_OF(sib)) == BLACK &&
+                TX_COLOR_OF(TX_RIGHT_OF(sib)) == BLACK) {
+                TX_SET_COLOR(sib, RED);
+                x = TX_PARENT_OF(x);
+            } else {
+                if (TX_COLOR_OF(TX_RIGHT_OF(sib)) == BLACK) {
+                    TX_SET_COLOR(TX_LEFT_OF(sib), BLACK);
+                    TX_SET_COLOR(sib, RED);
+                    TX_ROTATE_RIGHT(s, sib);
+                    sib = TX_RIGHT_OF(TX_PARENT_OF(x));
+                }
+                TX_SET_COLOR(sib, TX_COLOR_OF(TX_PARENT_OF(x)));
+                TX_SET_COLOR(TX_PARENT_OF(x), BLACK);
+                TX_SET_COLOR(TX_RIGHT_OF(sib), BLACK);
+                TX_ROTATE_LEFT(s, TX_PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = TX_LDNODE(s,root);
+            }
+        } else { /* symmetric */
+            node_t* sib = TX_LEFT_OF(TX_PARENT_OF(x));
+
+            if (TX_COLOR_OF(sib) == RED) {
+                TX_SET_COLOR(sib, BLACK);
+                TX_SET_COLOR(TX_PARENT_OF(x), RED);
+                TX_ROTATE_RIGHT(s, TX_PARENT_OF(x));
+                sib = TX_LEFT_OF(TX_PARENT_OF(x));
+            }
+            if (TX_COLOR_OF(TX_RIGHT_OF(sib)) == BLACK &&
+                TX_COLOR_OF(TX_LEFT_OF(sib)) == BLACK) {
+                TX_SET_COLOR(sib,  RED);
+                x = TX_PARENT_OF(x);
+            } else {
+                if (TX_COLOR_OF(TX_LEFT_OF(sib)) == BLACK) {
+                    TX_SET_COLOR(TX_RIGHT_OF(sib), BLACK);
+                    TX_SET_COLOR(sib, RED);
+                    TX_ROTATE_LEFT(s, sib);
+                    sib = TX_LEFT_OF(TX_PARENT_OF(x));
+                }
+                TX_SET_COLOR(sib, TX_COLOR_OF(TX_PARENT_OF(x)));
+                TX_SET_COLOR(TX_PARENT_OF(x), BLACK);
+                TX_SET_COLOR(TX_LEFT_OF(sib), BLACK);
+                TX_ROTATE_RIGHT(s, TX_PARENT_OF(x));
+                /* TODO: consider break ... */
+                x = TX_LDNODE(s, root);
+            }
+        }
+    }
+
+    if (x != NULL && TX_LDF(x,c) != BLACK) {
+       TX_STF(x, c, BLACK);
+    }
+
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_FIX_DEL, NULL);
+#endif /* ORIGINAL */
+}
+#define TX_FIX_AFTER_DELETION(s, n)  TMfixAfterDeletion(TM_ARG  s, n )
+
+
+/* =============================================================================
+ * delete_node
+ * =============================================================================
+ */
+static node_t*
+delete_node (rbtree_t* s, node_t* p)
+{
+    /*
+     * If strictly internal, copy successor's element to p and then make p
+     * point to successor
+     */
+    if (LDNODE(p, l) != NULL && LDNODE(p, r) != NULL) {
+        node_t* s = SUCCESSOR(p);
+        STF(p, k, LDNODE(s, k));
+        STF(p, v, LDNODE(s, v));
+        p = s;
+    } /* p has 2 children */
+
+    /* Start fixup at replacement node, if it exists */
+    node_t* replacement =
+        ((LDNODE(p, l) != NULL) ? LDNODE(p, l) : LDNODE(p, r));
+    node_t* pp = LDNODE(p, p);
+
+    if (replacement != NULL) {
+        /* Link replacement to parent */
+        STF (replacement, p, pp);
+        if (pp == NULL) {
+            STF(s, root, replacement);
+        } else if (p == LDNODE(pp, l)) {
+            STF(pp, l, replacement);
+        } else {
+            STF(pp, r, replacement);
+        }
+
+        /* Null out links so they are OK to use by fixAfterDeletion */
+        STF(p, l, NULL);
+        STF(p, r, NULL);
+        STF(p, p, NULL);
+
+        /* Fix replacement */
+        if (LDF(p, c) == BLACK) {
+            FIX_AFTER_DELETION(s, replacement);
+        }
+    } else if (pp == NULL) { /* return if we are the only node */
+        STF(s, root, NULL);
+    } else { /* No children. Use self as phantom replacement and unlink */
+        if (LDF(p, c) == BLACK) {
+            FIX_AFTER_DELETION(s, p);
+        }
+        if (pp != NULL) {
+            if (p == LDNODE(pp, l)) {
+                STF(pp, l, NULL);
+            } else if (p == LDNODE(pp, r)) {
+                STF(pp, r, NULL);
+            }
+            STF(p, p, NULL);
+        }
+    }
+    return p;
+}
+#define DELETE(s, n)  delete_node(s, n)
+
+
+/* =============================================================================
+ * HTMdelete
+ * =============================================================================
+ */
+static node_t*
+HTMdelete (rbtree_t* s, node_t* p)
+{
+    /*
+     * If strictly internal, copy successor's element to p and then make p
+     * point to successor
+     */
+    if (HTX_LDNODE(p, l) != NULL && HTX_LDNODE(p, r) != NULL) {
+        node_t* s = TX_SUCCESSOR(p);
+        HTX_STF_P(p,k, HTX_LDF_P(s, k));
+        HTX_STF_P(p,v, HTX_LDF_P(s, v));
+        p = s;
+    } /* p has 2 children */
+
+    /* Start fixup at replacement node, if it exists */
+    node_t* replacement =
+        ((HTX_LDNODE(p, l) != NULL) ? HTX_LDNODE(p, l) : HTX_LDNODE(p, r));
+    node_t* pp = HTX_LDNODE(p, p);
+
+    if (replacement != NULL) {
+        /* Link replacement to parent */
+        HTX_STF_P(replacement, p, pp);
+        if (pp == NULL) {
+            HTX_STF_P(s, root, replacement);
+        } else if (p == HTX_LDNODE(pp, l)) {
+            HTX_STF_P(pp, l, replacement);
+        } else {
+            HTX_STF_P(pp, r, replacement);
+        }
+
+        /* Null out links so they are OK to use by fixAfterDeletion */
+        HTX_STF_P(p, l, (node_t*)NULL);
+        HTX_STF_P(p, r, (node_t*)NULL);
+        HTX_STF_P(p, p, (node_t*)NULL);
+
+        /* Fix replacement */
+        if (HTX_LDF(p, c) == BLACK) {
+            HTX_FIX_AFTER_DELETION(s, replacement);
+        }
+    } else if (pp == NULL) { /* return if we are the only node */
+        HTX_STF_P(s, root, (node_t*)NULL);
+    } else { /* No children. Use self as phantom replacement and unlink */
+        if (HTX_LDF(p, c) == BLACK) {
+            HTX_FIX_AFTER_DELETION(s, p);
+        }
+        if (pp != NULL) {
+            if (p == HTX_LDNODE(pp, l)) {
+                HTX_STF_P(pp, l, (node_t*)NULL);
+            } else if (p == HTX_LDNODE(pp, r)) {
+                HTX_STF_P(pp, r, (node_t*)NULL);
+            }
+            HTX_STF_P(p, p, (node_t*)NULL);
+        }
+    }
+    return p;
+}
+#define HTX_DELETE(s, n)  HTMdelete(TM_ARG  s, n)
+
+
+/* =============================================================================
+ * TMdelete
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMdelete (TM_ARGDECL  rbtree_t* s, node_t* p)
+{
+    /*
+     * If strictly internal, copy successor's element to p and then make p
+     * point to successor
+     */
+    if (TX_LDNODE(p, l) != NULL && TX_LDNODE(p, r) != NULL) {
+        node_t* s = TX_SUCCESSOR(p);
+        TX_STF_P(p,k, TX_LDF_P(s, k));
+        TX_STF_P(p,v, TX_LDF_P(s, v));
+        p = s;
+    } /* p has 2 children */
+
+    /* Start fixup at replacement node, if it exists */
+    node_t* replacement =
+        ((TX_LDNODE(p, l) != NULL) ? TX_LDNODE(p, l) : TX_LDNODE(p, r));
+    node_t* pp = TX_LDNODE(p, p);
+
+    if (replacement != NULL) {
+        /* Link replacement to parent */
+        TX_STF_P(replacement, p, pp);
+        if (pp == NULL) {
+            TX_STF_P(s, root, replacement);
+        } else if (p == TX_LDNODE(pp, l)) {
+            TX_STF_P(pp, l, replacement);
+        } else {
+            TX_STF_P(pp, r, replacement);
+        }
+
+        /* Null out links so they are OK to use by fixAfterDeletion */
+        TX_STF_P(p, l, (node_t*)NULL);
+        TX_STF_P(p, r, (node_t*)NULL);
+        TX_STF_P(p, p, (node_t*)NULL);
+
+        /* Fix replacement */
+        if (TX_LDF(p, c) == BLACK) {
+            TX_FIX_AFTER_DELETION(s, replacement);
+        }
+    } else if (pp == NULL) { /* return if we are the only node */
+        TX_STF_P(s, root, (node_t*)NULL);
+    } else { /* No children. Use self as phantom replacement and unlink */
+        if (TX_LDF(p, c) == BLACK) {
+            TX_FIX_AFTER_DELETION(s, p);
+        }
+        if (pp != NULL) {
+            if (p == TX_LDNODE(pp, l)) {
+                TX_STF_P(pp, l, (node_t*)NULL);
+            } else if (p == TX_LDNODE(pp, r)) {
+                TX_STF_P(pp, r, (node_t*)NULL);
+            }
+            TX_STF_P(p, p, (node_t*)NULL);
+        }
+    }
+    return p;
+}
+#define TX_DELETE(s, n)  TMdelete(TM_ARG  s, n)
+
+
+/*
+ * Diagnostic section
+ */
+
+
+/* =============================================================================
+ * firstEntry
+ * =============================================================================
+ */
+static node_t*
+firstEntry (rbtree_t* s)
+{
+    node_t* p = s->root;
+    if (p != NULL) {
+        while (LDNODE(p, l) != NULL) {
+            p = LDNODE(p, l);
+        }
+    }
+    return p;
+}
+
+
+/* =============================================================================
+ * ceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+static node_t*
+ceilingEntry (rbtree_t* s, void* k)
+{
+    node_t* p = LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, LDF(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = LDNODE(p, l);
+        } else {
+            p = LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define CEILING_ENTRY(s, k)  ceilingEntry(s, k)
+
+
+/* =============================================================================
+ * HTMceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+static node_t*
+HTMceilingEntry (rbtree_t* s, void* k)
+{
+    node_t* p = HTX_LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, HTX_LDF_P(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = HTX_LDNODE(p, l);
+        } else {
+            p = HTX_LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define HTX_CEILING_ENTRY(s, k)  HTMceilingEntry(s, k)
+
+
+/* =============================================================================
+ * TMceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMceilingEntry (TM_ARGDECL  rbtree_t* s, void* k)
+{
+    node_t* p = TX_LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, TX_LDF_P(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = TX_LDNODE(p, l);
+        } else {
+            p = TX_LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define TX_CEILING_ENTRY(s, k)  TMceilingEntry(TM_ARG  s, k)
+
+
+/* =============================================================================
+ * predecessor
+ * =============================================================================
+ */
+static node_t*
+predecessor (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (LDNODE(t, l) != NULL) {
+        node_t* p = LDNODE(t, l);
+        while (LDNODE(p, r) != NULL) {
+            p = LDNODE(p, r);
+        }
+        return p;
+    } else {
+        node_t* p = LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == LDNODE(p, l)) {
+            ch = p;
+            p = LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define PREDECESSOR(n)  predecessor(n)
+
+
+/* =============================================================================
+ * HTMpredecessor
+ * =============================================================================
+ */
+static node_t*
+HTMpredecessor (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (HTX_LDNODE(t, l) != NULL) {
+        node_t* p = HTX_LDNODE(t, l);
+        while (HTX_LDNODE(p, r) != NULL) {
+            p = HTX_LDNODE(p, r);
+        }
+        return p;
+    } else {
+        node_t* p = HTX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == HTX_LDNODE(p, l)) {
+            ch = p;
+            p = HTX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define HTX_PREDECESSOR(n)  HTMpredecessor(n)
+
+
+/* =============================================================================
+ * TMpredecessor
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMpredecessor (TM_ARGDECL  node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (TX_LDNODE(t, l) != NULL) {
+        node_t* p = TX_LDNODE(t, l);
+        while (TX_LDNODE(p, r) != NULL) {
+            p = TX_LDNODE(p, r);
+        }
+        return p;
+    } else {
+        node_t* p = TX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == TX_LDNODE(p, l)) {
+            ch = p;
+            p = TX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define TX_PREDECESSOR(n)  TMpredecessor(TM_ARG  n)
+
+
+/*
+ * Compute the BH (BlackHeight) and validate the tree.
+ *
+ * This function recursively verifies that the given binary subtree satisfies
+ * three of the red black properties. It checks that every red node has only
+ * black children. It makes sure that each node is either red or black. And it
+ * checks that every path has the same count of black nodes from root to leaf.
+ * It returns the blackheight of the given subtree; this allows blackheights to
+ * be computed recursively and compared for left and right siblings for
+ * mismatches. It does not check for every nil node being black, because there
+ * is only one sentinel nil node. The return value of this function is the
+ * black height of the subtree rooted at the node ``root'', or zero if the
+ * subtree is not red-black.
+ *
+ */
+
+
+/* =============================================================================
+ * verifyRedBlack
+ * =============================================================================
+ */
+static long
+verifyRedBlack (node_t* root, long depth)
+{
+    long height_left;
+    long height_right;
+
+    if (root == NULL) {
+        return 1;
+    }
+
+    height_left  = verifyRedBlack(LDNODE(root, l), depth+1);
+    height_right = verifyRedBlack(LDNODE(root, r), depth+1);
+    if (height_left == 0 || height_right == 0) {
+        return 0;
+    }
+    if (height_left != height_right) {
+        printf(" Imbalance @depth=%ld : %ld %ld\n", depth, height_left, height_right);
+    }
+
+    if (LDNODE(root, l) != NULL && LDNODE(LDNODE(root, l), p) != root) {
+       printf(" lineage\n");
+    }
+    if (LDNODE(root, r) != NULL && LDNODE(LDNODE(root, r), p) != root) {
+       printf(" lineage\n");
+    }
+
+    /* Red-Black alternation */
+    if (LDF(root, c) == RED) {
+        if (LDNODE(root, l) != NULL && LDF(LDNODE(root, l), c) != BLACK) {
+          printf("VERIFY %d\n", __LINE__);
+          return 0;
+        }
+        if (LDNODE(root, r) != NULL && LDF(LDNODE(root, r), c) != BLACK) {
+          printf("VERIFY %d\n", __LINE__);
+          return 0;
+        }
+        return height_left;
+    }
+    if (LDF(root, c) != BLACK) {
+        printf("VERIFY %d\n", __LINE__);
+        return 0;
+    }
+
+    return (height_left + 1);
+}
+
+
+/* =============================================================================
+ * rbtree_verify
+ * =============================================================================
+ */
+long
+rbtree_verify (rbtree_t* s, long verbose)
+{
+    node_t* root = s->root;
+    if (root == NULL) {
+        return 1;
+    }
+    if (verbose) {
+       printf("Integrity check: ");
+    }
+
+    if (LDNODE(root, p) != NULL) {
+        printf("  (WARNING) root %lX parent=%lX\n",
+               (unsigned long)root, (unsigned long)LDNODE(root, p));
+        return -1;
+    }
+    if (LDF(root, c) != BLACK) {
+        printf("  (WARNING) root %lX color=%lX\n",
+               (unsigned long)root, (unsigned long)LDF(root, c));
+    }
+
+    /* Weak check of binary-tree property */
+    long ctr = 0;
+    node_t* its = firstEntry(s);
+    while (its != NULL) {
+        ctr++;
+        node_t* child = LDNODE(its, l);
+        if (child != NULL && LDNODE(child, p) != its) {
+            printf("Bad parent\n");
+        }
+        child = LDNODE(its, r);
+        if (child != NULL && LDNODE(child, p) != its) {
+            printf("Bad parent\n");
+        }
+        node_t* nxt = successor(its);
+        if (nxt == NULL) {
+            break;
+        }
+        if (s->compare(its->k, nxt->k) >= 0) {
+            printf("Key order %lX (%ld %ld) %lX (%ld %ld)\n",
+                   (unsigned long)its, (long)its->k, (long)its->v,
+                   (unsigned long)nxt, (long)nxt->k, (long)nxt->v);
+            return -3;
+        }
+        its = nxt;
+    }
+
+    long vfy = verifyRedBlack(root, 0);
+    if (verbose) {
+        printf(" Nodes=%ld Depth=%ld\n", ctr, vfy);
+    }
+
+    return vfy;
+}
+
+
+/* =============================================================================
+ * rbtree_compare
+ * =============================================================================
+ */
+long
+rbtree_compare (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * rbtree_alloc
+ * =============================================================================
+ */
+rbtree_t*
+rbtree_alloc (long (*compare)(const void*, const void*))
+{
+    rbtree_t* n = (rbtree_t* )malloc(sizeof(*n));
+    if (n) {
+        rbtree_setCompare(n, compare ? compare : rbtree_compare);
+        n->root = NULL;
+    }
+    return n;
+}
+
+
+/* =============================================================================
+ * HTMrbtree_alloc
+ * =============================================================================
+ */
+rbtree_t*
+HTMrbtree_alloc (long (*compare)(const void*, const void*))
+{
+    rbtree_t* n = (rbtree_t* )HTM_MALLOC(sizeof(*n));
+    if (n){
+        rbtree_setCompare(n, compare ? compare : rbtree_compare);
+        n->root = NULL;
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * TMrbtree_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+rbtree_t*
+TMrbtree_alloc (TM_ARGDECL  long (*compare)(const void*, const void*))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_ALLOC, NULL, compare);
+#endif /* ORIGINAL */
+
+    rbtree_t* n = (rbtree_t* )TM_MALLOC(sizeof(*n));
+    if (n){
+        rbtree_setCompare(n, compare ? compare : rbtree_compare);
+        n->root = NULL;
+    }
+
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_ALLOC, &n);
+#endif /* ORIGINAL */
+    return n;
+}
+
+
+/* =============================================================================
+ * reserveNodes
+ * -- Address space only; pages are committed as chunks are first used
+ * =============================================================================
+ */
+__attribute__((constructor)) static void
+reserveNodes ()
+{
+    global_nodes = (node_t*)mmap(NULL, RBTREE_MAX_NODES * sizeof(node_t),
+                                 (PROT_READ | PROT_WRITE),
+                                 (MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE),
+                                 -1, 0);
+    if (global_nodes == MAP_FAILED) {
+        perror("rbtree: mmap");
+        abort();
+    }
+}
+
+
+/* =============================================================================
+ * grabChunk
+ * -- Returns index of the first of RBTREE_CHUNK_NODES new nodes
+ * =============================================================================
+ */
+TM_PURE
+static uint64_t
+grabChunk ()
+{
+    uint64_t i = atomic_fetch_add(&global_numNode, RBTREE_CHUNK_NODES);
+    if (i + RBTREE_CHUNK_NODES > RBTREE_MAX_NODES) {
+        fprintf(stderr, "rbtree: out of nodes (RBTREE_MAX_NODES=%lu)\n",
+                (unsigned long)RBTREE_MAX_NODES);
+        abort();
+    }
+    return i;
+}
+
+
+/* =============================================================================
+ * refillPool
+ * -- Returns the start of the chunk to bump-allocate from once endIdx is hit
+ * =============================================================================
+ */
+TM_PURE
+static uint64_t
+refillPool (pool_t* poolPtr, uint64_t endIdx)
+{
+    /*
+     * A chunk grabbed by an aborted transaction is not visible in endIdx;
+     * reuse it instead of grabbing another one.
+     */
+    if (poolPtr->spareIdx == 0 || poolPtr->spareIdx + RBTREE_CHUNK_NODES == endIdx) {
+        poolPtr->spareIdx = grabChunk();
+    }
+    return poolPtr->spareIdx;
+}
+
+
+/* =============================================================================
+ * releaseNode
+ * =============================================================================
+ */
+static void
+releaseNode (node_t* n)
+{
+    STW(n, lr, LDW(&global_pool, freeIdx));
+    STW(&global_pool, freeIdx, INDEX_OF(n));
+}
+
+
+/* =============================================================================
+ * HTMreleaseNode
+ * =============================================================================
+ */
+static void
+HTMreleaseNode  (node_t* n)
+{
+    HTX_STW(n, lr, HTX_LDW(&global_pool, freeIdx));
+    HTX_STW(&global_pool, freeIdx, INDEX_OF(n));
+}
+
+
+/* =============================================================================
+ * TMreleaseNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMreleaseNode  (TM_ARGDECL  node_t* n)
+{
+    TX_STW(n, lr, TX_LDW(&global_pool, freeIdx));
+    TX_STW(&global_pool, freeIdx, INDEX_OF(n));
+}
+
+
+/* =============================================================================
+ * freeNode
+ * =============================================================================
+ */
+static void
+freeNode (node_t* n, void (*freeData)(void *, void *))
+{
+    if (n) {
+        freeNode(LDNODE(n, l), freeData);
+        freeNode(LDNODE(n, r), freeData);
+        if (freeData)
+            freeData(n->k, n->v);
+        releaseNode(n);
+    }
+}
+
+
+/* =============================================================================
+ * HTMfreeNode
+ * =============================================================================
+ */
+static void
+HTMfreeNode (node_t* n, void (*HTMfreeData)(void *, void *))
+{
+    if (n) {
+        HTMfreeNode(LDNODE(n, l), HTMfreeData);
+        HTMfreeNode(LDNODE(n, r), HTMfreeData);
+        if (HTMfreeData)
+            HTMfreeData(n->k, n-> v);
+        HTMreleaseNode(n);
+    }
+}
+
+
+/* =============================================================================
+ * TMfreeNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMfreeNode (TM_ARGDECL  node_t* n, TM_CALLABLE void (*TMfreeData)(void *, void *))
+{
+    if (n) {
+        TMfreeNode(TM_ARG  LDNODE(n, l), TMfreeData);
+        TMfreeNode(TM_ARG  LDNODE(n, r), TMfreeData);
+        if (TMfreeData)
+            TMfreeData(TM_ARG  n->k, n-> v);
+        TMreleaseNode(TM_ARG  n);
+    }
+}
+
+
+/* =============================================================================
+ * rbtree_free
+ * =============================================================================
+ */
+void
+rbtree_free (rbtree_t* r, void (*freeData)(void *, void *))
+{
+    freeNode(r->root, freeData);
+    free(r);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_free
+ * =============================================================================
+ */
+void
+HTMrbtree_free (rbtree_t* r, void (*HTMfreeData)(void *, void *))
+{
+    HTMfreeNode(TM_ARG  r->root, HTMfreeData);
+    HTM_FREE(r);
+}
+
+
+/* =============================================================================
+ * TMrbtree_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_free (TM_ARGDECL  rbtree_t* r, TM_CALLABLE void (*TMfreeData)(void *, void *))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_FREE, NULL, r);
+#endif /* ORIGINAL */
+    TMfreeNode(TM_ARG  r->root, TMfreeData);
+    TM_FREE(r);
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_FREE, NULL);
+#endif /* ORIGINAL */
+}
+
+
+/* =============================================================================
+ * getNode
+ * =============================================================================
+ */
+static node_t*
+getNode ()
+{
+    pool_t* poolPtr = &global_pool;
+    uint64_t i = LDW(poolPtr, freeIdx);
+    if (i != 0) {
+        STW(poolPtr, freeIdx, LDW(NODE_AT(i), lr));
+        return NODE_AT(i);
+    }
+    i = LDW(poolPtr, nextIdx);
+    uint64_t end = LDW(poolPtr, endIdx);
+    if (i == end) {
+        i = refillPool(poolPtr, end);
+        STW(poolPtr, endIdx, i + RBTREE_CHUNK_NODES);
+    }
+    STW(poolPtr, nextIdx, i + 1);
+    return NODE_AT(i);
+}
+
+
+/* =============================================================================
+ * HTMgetNode
+ * =============================================================================
+ */
+static node_t*
+HTMgetNode ()
+{
+    pool_t* poolPtr = &global_pool;
+    uint64_t i = HTX_LDW(poolPtr, freeIdx);
+    if (i != 0) {
+        HTX_STW(poolPtr, freeIdx, HTX_LDW(NODE_AT(i), lr));
+        return NODE_AT(i);
+    }
+    i = HTX_LDW(poolPtr, nextIdx);
+    uint64_t end = HTX_LDW(poolPtr, endIdx);
+    if (i == end) {
+        i = refillPool(poolPtr, end);
+        HTX_STW(poolPtr, endIdx, i + RBTREE_CHUNK_NODES);
+    }
+    HTX_STW(poolPtr, nextIdx, i + 1);
+    return NODE_AT(i);
+}
+
+
+/* =============================================================================
+ * TMgetNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMgetNode (TM_ARGDECL_ALONE)
+{
+    pool_t* poolPtr = &global_pool;
+    uint64_t i = TX_LDW(poolPtr, freeIdx);
+    if (i != 0) {
+        TX_STW(poolPtr, freeIdx, TX_LDW(NODE_AT(i), lr));
+        return NODE_AT(i);
+    }
+    i = TX_LDW(poolPtr, nextIdx);
+    uint64_t end = TX_LDW(poolPtr, endIdx);
+    if (i == end) {
+        i = refillPool(poolPtr, end);
+        TX_STW(poolPtr, endIdx, i + RBTREE_CHUNK_NODES);
+    }
+    TX_STW(poolPtr, nextIdx, i + 1);
+    return NODE_AT(i);
+}
+
+
+/* =============================================================================
+ * rbtree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+rbtree_insert (rbtree_t* r, void* key, void* val)
+{
+    node_t* node = getNode();
+    node_t* ex = INSERT(r, key, val, node);
+    if (ex != NULL) {
+        releaseNode(node);
+    }
+    return ((ex == NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+HTMrbtree_insert (rbtree_t* r, void* key, void* val)
+{
+    bool_t rv;
+
+    node_t* node = HTMgetNode();
+    node_t* ex = HTX_INSERT(r, key, val, node);
+    if (ex != NULL) {
+        HTMreleaseNode(TM_ARG  node);
+    }
+    rv = (ex == NULL) ? TRUE : FALSE;
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMrbtree_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMrbtree_insert (TM_ARGDECL  rbtree_t* r, void* key, void* val)
+{
+    bool_t rv;
+
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_INSERT, NULL, r, key, val);
+#endif /* ORIGINAL */
+    node_t* node = TMgetNode(TM_ARG_ALONE);
+    node_t* ex = TX_INSERT(r, key, val, node);
+    if (ex != NULL) {
+        TMreleaseNode(TM_ARG  node);
+    }
+    rv = (ex == NULL) ? TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_INSERT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * buildRange
+ * -- Links the sorted elements [lo, hi] into a subtree and returns its root
+ * -- Only nodes at 'redDepth', the bottom level of a tree that is not full,
+ *    are red, so every path has the same number of black nodes
+ * =============================================================================
+ */
+static node_t*
+buildRange (void** keys, void** vals, long lo, long hi, long depth, long redDepth)
+{
+    long mid = lo + (hi - lo) / 2;
+    node_t* n = getNode();
+    assert(n != NULL);
+    node_t* l = NULL;
+    node_t* r = NULL;
+
+    if (lo < mid) {
+        l = buildRange(keys, vals, lo, (mid - 1), (depth + 1), redDepth);
+    }
+    if (mid < hi) {
+        r = buildRange(keys, vals, (mid + 1), hi, (depth + 1), redDepth);
+    }
+    STW(n, lr, 0);
+    STW(n, pc, 0);
+    STF(n, k, keys[mid]);
+    STF(n, v, vals[mid]);
+    STF(n, p, NULL);
+    STF(n, l, l);
+    STF(n, r, r);
+    STF(n, c, ((depth == redDepth) ? RED : BLACK));
+    if (l != NULL) {
+        STF(l, p, n);
+    }
+    if (r != NULL) {
+        STF(r, p, n);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * rbtree_build
+ * -- Fills an empty tree from 'n' keys in strictly increasing order, in O(n)
+ * -- Returns FALSE if the tree is not empty or the keys are not sorted
+ * =============================================================================
+ */
+bool_t
+rbtree_build (rbtree_t* r, void** keys, void** vals, long n)
+{
+    long i;
+    long redDepth = 0;
+
+    if (LDNODE(r, root) != NULL) {
+        return FALSE;
+    }
+    for (i = 1; i < n; i++) {
+        if (r->compare(keys[i - 1], keys[i]) >= 0) {
+            return FALSE;
+        }
+    }
+    if (n == 0) {
+        return TRUE;
+    }
+
+    /* Number of levels that are full */
+    for (i = (n - 1); i >= 0; i = (i / 2 - 1)) {
+        redDepth++;
+    }
+    STF(r, root, buildRange(keys, vals, 0, (n - 1), 0, redDepth));
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * rbtree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+rbtree_delete (rbtree_t* r, void* key)
+{
+    node_t* node = NULL;
+    node = LOOKUP(r, key);
+    if (node != NULL) {
+        node = DELETE(r, node);
+    }
+    if (node != NULL) {
+        releaseNode(node);
+    }
+    return ((node != NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+HTMrbtree_delete (rbtree_t* r, void* key)
+{
+    bool_t rv;
+    node_t* node = NULL;
+    node = HTX_LOOKUP(r, key);
+    if (node != NULL) {
+        node = HTX_DELETE(r, node);
+    }
+    if (node != NULL) {
+        HTMreleaseNode(TM_ARG  node);
+    }
+    rv = (node != NULL) ? TRUE : FALSE;
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMrbtree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMrbtree_delete (TM_ARGDECL  rbtree_t* r, void* key)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_DELETE, NULL, r, key);
+#endif /* ORIGINAL */
+    node_t* node = NULL;
+    node = TX_LOOKUP(r, key);
+    if (node != NULL) {
+        node = TX_DELETE(r, node);
+    }
+    if (node != NULL) {
+        TMreleaseNode(TM_ARG  node);
+    }
+    rv = (node != NULL) ? TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_DELETE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * rbtree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+bool_t
+rbtree_update (rbtree_t* r, void* key, void* val)
+{
+    node_t* nn = getNode();
+    node_t* ex = INSERT(r, key, val, nn);
+    if (ex != NULL) {
+        STF(ex, v, val);
+        releaseNode(nn);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * TMrbtree_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMrbtree_update (TM_ARGDECL  rbtree_t* r, void* key, void* val)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_UPDATE, NULL, r, key, val);
+#endif /* ORIGINAL */
+    node_t* nn = TMgetNode(TM_ARG_ALONE);
+    node_t* ex = TX_INSERT(r, key, val, nn);
+    if (ex != NULL) {
+        TX_STF(ex, v, val);
+        TMreleaseNode(TM_ARG  nn);
+        rv = TRUE;
+        goto out;
+    }
+    rv = FALSE;
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_UPDATE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * rbtree_get
+ * =============================================================================
+ */
+void*
+rbtree_get (rbtree_t* r, void* key) {
+    node_t* n = LOOKUP(r, key);
+    if (n != NULL) {
+        void* val = LDF(n, v);
+        return val;
+    }
+    return NULL;
+}
+
+
+/* =============================================================================
+ * HTMrbtree_get
+ * =============================================================================
+ */
+void*
+HTMrbtree_get (rbtree_t* r, void* key) {
+    void *val = NULL;
+    node_t* n = HTX_LOOKUP(r, key);
+    if (n != NULL) {
+        val = HTX_LDF_P(n, v);
+        goto out;
+    }
+out:
+    return val;
+}
+
+
+/* =============================================================================
+ * TMrbtree_get
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_get (TM_ARGDECL  rbtree_t* r, void* key) {
+    void *val = NULL;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_GET, NULL, r, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(r, key);
+    if (n != NULL) {
+        val = TX_LDF_P(n, v);
+        goto out;
+    }
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_GET, &val);
+#endif /* ORIGINAL */
+    return val;
+}
+
+
+/* =============================================================================
+ * rbtree_contains
+ * =============================================================================
+ */
+long
+rbtree_contains (rbtree_t* r, void* key)
+{
+    node_t* n = LOOKUP(r, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_contains
+ * =============================================================================
+ */
+long
+HTMrbtree_contains (rbtree_t* r, void* key)
+{
+    node_t* n = HTX_LOOKUP(r, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * TMrbtree_contains
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMrbtree_contains (TM_ARGDECL  rbtree_t* r, void* key)
+{
+    long rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(RBTREE_CONTAINS, NULL, r, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(r, key);
+    rv = (n != NULL);
+#ifndef ORIGINAL
+    TM_LOG_END(RBTREE_CONTAINS, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * rbtree_setCompare
+ * =============================================================================
+ */
+void
+rbtree_setCompare (rbtree_t* r, long (*compare)(const void*, const void*))
+{
+    STF(r, compare, compare);
+}
+
+
+/* =============================================================================
+ * TMrbtree_compare
+ * =============================================================================
+ */
+TM_CALLABLE
+TM_CALLABLE
+void
+TMrbtree_setCompare (TM_ARGDECL  rbtree_t* r, long (*compare)(const void*, const void*))
+{
+    TX_STF_P(r, compare, compare);
+}
+
+
+/* =============================================================================
+ * rbtree_iterate
+ * =============================================================================
+ */
+static
+void rbtree_node(node_t *n, void (*cb)(void *, void *))
+{
+    if (n) {
+        rbtree_node(LDF(n, l), cb);
+        rbtree_node(LDF(n, r), cb);
+        if (cb)
+            cb(LDF(n, k), LDF(n, v));
+    }
+}
+
+
+/* =============================================================================
+ * rbtree_iterate
+ * =============================================================================
+ */
+void
+rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *))
+{
+    node_t* n = LDNODE(r, root);
+    rbtree_node(n, cb);
+}
+
+
+/* =============================================================================
+ * rbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+rbtree_range (rbtree_t* r, void* lo, void* hi, void (*cb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = CEILING_ENTRY(r, lo);
+
+    while (p != NULL && r->compare(LDF(p, k), hi) <= 0) {
+        if (cb)
+            cb(LDF(p, k), LDF(p, v));
+        n++;
+        p = SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * HTMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+HTMrbtree_range (rbtree_t* r, void* lo, void* hi, void (*HTMcb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = HTX_CEILING_ENTRY(r, lo);
+
+    while (p != NULL) {
+        void* k = HTX_LDF_P(p, k);
+        if (r->compare(k, hi) > 0)
+            break;
+        if (HTMcb)
+            HTMcb(k, HTX_LDF_P(p, v));
+        n++;
+        p = HTX_SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * TMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMrbtree_range (TM_ARGDECL  rbtree_t* r, void* lo, void* hi, TM_CALLABLE void (*TMcb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = TX_CEILING_ENTRY(r, lo);
+
+    while (p != NULL) {
+        void* k = TX_LDF_P(p, k);
+        if (r->compare(k, hi) > 0)
+            break;
+        if (TMcb)
+            TMcb(k, TX_LDF_P(p, v));
+        n++;
+        p = TX_SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * rbtree_iter_seek
+ * =============================================================================
+ */
+void
+rbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    *itPtr = CEILING_ENTRY(r, key);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_seek
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    HTM_LOCAL_WRITE_P(*itPtr, HTX_CEILING_ENTRY(r, key));
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_seek
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_seek (TM_ARGDECL  rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_CEILING_ENTRY(r, key));
+}
+
+
+/* =============================================================================
+ * rbtree_iter_valid
+ * =============================================================================
+ */
+bool_t
+rbtree_iter_valid (rbtree_iter_t* itPtr)
+{
+    return (*itPtr != NULL);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_key
+ * =============================================================================
+ */
+void*
+rbtree_iter_key (rbtree_iter_t* itPtr)
+{
+    return LDF((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_key
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_key (rbtree_iter_t* itPtr)
+{
+    return HTX_LDF_P((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_key
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_key (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    return TX_LDF_P((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_val
+ * =============================================================================
+ */
+void*
+rbtree_iter_val (rbtree_iter_t* itPtr)
+{
+    return LDF((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_val
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_val (rbtree_iter_t* itPtr)
+{
+    return HTX_LDF_P((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_val
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_val (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    return TX_LDF_P((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_next
+ * =============================================================================
+ */
+void
+rbtree_iter_next (rbtree_iter_t* itPtr)
+{
+    *itPtr = SUCCESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_next
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_next (rbtree_iter_t* itPtr)
+{
+    HTM_LOCAL_WRITE_P(*itPtr, HTX_SUCCESSOR((node_t*)*itPtr));
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_next
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_next (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_SUCCESSOR((node_t*)*itPtr));
+}
+
+
+/* =============================================================================
+ * rbtree_iter_prev
+ * =============================================================================
+ */
+void
+rbtree_iter_prev (rbtree_iter_t* itPtr)
+{
+    *itPtr = PREDECESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_prev
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_prev (rbtree_iter_t* itPtr)
+{
+    /* The cursor is thread-local, so a plain store is enough */
+    *itPtr = HTX_PREDECESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_prev
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_prev (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_PREDECESSOR((node_t*)*itPtr));
+}
+
+
+#ifdef RBTREE_RELAXED
+/* =============================================================================
+ * rbtree_numPending
+ * -- Returns number of insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+long
+rbtree_numPending (void)
+{
+    return global_numPending;
+}
+
+
+/* =============================================================================
+ * rbtree_clearPending
+ * -- Call once the transaction running [HTM|TM]rbtree_rebalance has committed
+ * =============================================================================
+ */
+void
+rbtree_clearPending (void)
+{
+    global_numPending = 0;
+}
+
+
+/* =============================================================================
+ * rbtree_rebalance
+ * -- Repairs and clears the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+rbtree_rebalance (void)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = LOOKUP(s, global_pending[i].k);
+        REPAIR_INSERTION(s, x);
+    }
+    rbtree_clearPending();
+}
+
+
+/* =============================================================================
+ * HTMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+HTMrbtree_rebalance (void)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = HTX_LOOKUP(s, global_pending[i].k);
+        HTX_REPAIR_INSERTION(s, x);
+    }
+}
+
+
+/* =============================================================================
+ * TMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_rebalance (TM_ARGDECL_ALONE)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = TX_LOOKUP(s, global_pending[i].k);
+        TX_REPAIR_INSERTION(s, x);
+    }
+}
+#endif /* RBTREE_RELAXED */
+
+
+/* /////////////////////////////////////////////////////////////////////////////
+ * TEST_RBTREE
+ * /////////////////////////////////////////////////////////////////////////////
+ */
+#ifdef TEST_RBTREE
+
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+
+
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+#ifdef RBTREE_RELAXED
+/* Each simulated client has its own deferred-fix buffer */
+typedef struct client {
+    pending_t pending[RBTREE_PENDING_MAX];
+    long numPending;
+} client_t;
+
+
+static void
+switchClient (client_t* fromPtr, client_t* toPtr)
+{
+    memcpy(fromPtr->pending, global_pending, sizeof(global_pending));
+    fromPtr->numPending = global_numPending;
+    memcpy(global_pending, toPtr->pending, sizeof(global_pending));
+    global_numPending = toPtr->numPending;
+}
+
+
+/* Returns -1 if black heights differ; red-red violations are allowed */
+static long
+blackHeight (node_t* n)
+{
+    if (n == NULL) {
+        return 1;
+    }
+    long left = blackHeight(LEFT_OF(n));
+    long right = blackHeight(RIGHT_OF(n));
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return (left + ((COLOR_OF(n) == BLACK) ? 1 : 0));
+}
+
+
+#define NUM_CLIENT (4)
+#define NUM_KEY    (512)
+
+static void
+testRelaxed ()
+{
+    client_t clients[NUM_CLIENT];
+    long current = 0;
+    long vals[NUM_KEY];
+    long i;
+
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < NUM_KEY; i++) {
+        vals[i] = i;
+    }
+
+    /*
+     * Client 0 inserts 3 under 5 and defers; client 1 inserts 1 under 3,
+     * defers, and rebalances first, below client 0's violation
+     */
+    rbtree_t* rbtreePtr = rbtree_alloc(&compare);
+    assert(rbtree_insert(rbtreePtr, &vals[10], &vals[10]));
+    assert(rbtree_insert(rbtreePtr, &vals[5], &vals[5]));
+    assert(TMrbtree_insert(rbtreePtr, &vals[3], &vals[3]));
+    assert(rbtree_numPending() == 1);
+    switchClient(&clients[0], &clients[1]);
+    assert(TMrbtree_insert(rbtreePtr, &vals[1], &vals[1]));
+    assert(rbtree_numPending() == 1);
+    rbtree_rebalance();
+    assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    switchClient(&clients[1], &clients[0]);
+    rbtree_rebalance();
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+    rbtree_free(rbtreePtr, NULL);
+
+    /*
+     * Several clients insert, delete and rebalance in random order; an
+     * ascending burst first overflows client 0's buffer
+     */
+    memset(clients, 0, sizeof(clients));
+    rbtreePtr = rbtree_alloc(&compare);
+    for (i = 0; i < NUM_KEY; i += 2) {
+        TMrbtree_insert(rbtreePtr, &vals[i], &vals[i]);
+        assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    }
+    unsigned long seed = 1;
+    for (i = 0; i < 100000; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        unsigned long r = seed >> 24;
+        long next = (long)(r % NUM_CLIENT);
+        long key = (long)((r / NUM_CLIENT) % NUM_KEY);
+        long op = (long)((r / (NUM_CLIENT * NUM_KEY)) % 32);
+        if (next != current) {
+            switchClient(&clients[current], &clients[next]);
+            current = next;
+        }
+        if (op < 16) {
+            TMrbtree_insert(rbtreePtr, &vals[key], &vals[key]);
+        } else if (op < 31) {
+            TMrbtree_delete(rbtreePtr, &vals[key]);
+        } else {
+            rbtree_rebalance();
+        }
+        assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    }
+    for (i = 0; i < NUM_CLIENT; i++) {
+        switchClient(&clients[current], &clients[i]);
+        current = i;
+        rbtree_rebalance();
+    }
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+    rbtree_free(rbtreePtr, NULL);
+}
+#endif /* RBTREE_RELAXED */
+
+
+static void
+insertInt (rbtree_t* rbtreePtr, long* data)
+{
+    printf("Inserting: %li\n", *data);
+    rbtree_insert(rbtreePtr, (void*)data, (void*)data);
+    assert(*(long*)rbtree_get(rbtreePtr, (void*)data) == *data);
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+}
+
+
+static void
+removeInt (rbtree_t* rbtreePtr, long* data)
+{
+    printf("Removing: %li\n", *data);
+    rbtree_delete(rbtreePtr, (void*)data);
+    assert(rbtree_get(rbtreePtr, (void*)data) == NULL);
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+}
+
+
+int
+main ()
+{
+    long data[] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7};
+    long numData = sizeof(data) / sizeof(data[0]);
+    long i;
+
+    puts("Starting...");
+
+    rbtree_t* rbtreePtr = rbtree_alloc(&compare);
+    assert(rbtreePtr);
+
+    for (i = 0; i < numData; i++) {
+        insertInt(rbtreePtr, &data[i]);
+    }
+
+    long lo = 2;
+    long hi = 6;
+    assert(rbtree_range(rbtreePtr, &lo, &hi, NULL) == 5);
+
+    rbtree_iter_t it;
+    long prev = 0;
+    rbtree_iter_seek(&it, rbtreePtr, &lo);
+    for (i = 0; rbtree_iter_valid(&it); i++) {
+        long key = *(long*)rbtree_iter_key(&it);
+        assert(key >= lo && key > prev);
+        prev = key;
+        rbtree_iter_next(&it);
+    }
+    assert(i == 8);
+    rbtree_iter_seek(&it, rbtreePtr, &hi);
+    for (i = 0; rbtree_iter_valid(&it); i++) {
+        rbtree_iter_prev(&it);
+    }
+    assert(i == 6);
+
+    for (i = 0; i < numData; i++) {
+        removeInt(rbtreePtr, &data[i]);
+    }
+
+    rbtree_free(rbtreePtr, NULL);
+
+    /* Bulk load, for every size up to a few full levels */
+    long sorted[64];
+    void* keys[64];
+    for (i = 0; i < 64; i++) {
+        sorted[i] = i;
+        keys[i] = &sorted[i];
+    }
+    long n;
+    for (n = 0; n <= 64; n++) {
+        rbtreePtr = rbtree_alloc(&compare);
+        assert(rbtree_build(rbtreePtr, keys, keys, n));
+        assert(rbtree_verify(rbtreePtr, 0) > 0);
+        for (i = 0; i < n; i++) {
+            assert(rbtree_get(rbtreePtr, keys[i]) == keys[i]);
+        }
+        assert(!rbtree_build(rbtreePtr, keys, keys, n) || n == 0);
+        if (n > 0) {
+            removeInt(rbtreePtr, &sorted[n / 2]);
+            insertInt(rbtreePtr, &sorted[n / 2]);
+        }
+        rbtree_free(rbtreePtr, NULL);
+    }
+
+#ifdef RBTREE_RELAXED
+    testRelaxed();
+#endif
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_RBTREE */
+
+
+/* =============================================================================
+ *
+ * End of crbtree.c
+ *
+ * =============================================================================
+ */
+
+#ifndef ORIGINAL
+__attribute__((constructor)) void crbtree_init() {
+    TM_LOG_FFI_DECLARE;
+    TM_LOG_TYPE_DECLARE_INIT(*ppp[], {&ffi_type_pointer, &ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*pp[], {&ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*p[], {&ffi_type_pointer});
+    # define TM_LOG_OP TM_LOG_OP_INIT
+    # include "crbtree.inc"
+    # undef TM_LOG_OP
+}
+#endif /* ORIGINAL */
+
+#endif /* RBTREE_COMPACT */
@@ -0,0 +1,474 @@
+/* =============================================================================
+ *
+ * dataset.c
+ * -- On-disk cache of generated benchmark inputs
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "dataset.h"
+#include "types.h"
+
+
+#define DATASET_MAGIC       "STAMPDS1"
+#define DATASET_ALIGN       (64)
+#define DATASET_NAME_SIZE   (64)
+#define DATASET_PATH_SIZE   (4096)
+
+
+/*
+ * Build options that change what a generator produces for the same
+ * parameters; part of every key.
+ */
+#if defined(RANDOM_USE_XOSHIRO)
+#  define DATASET_TAG_RANDOM "xoshiro"
+#elif defined(RANDOM_USE_PCG)
+#  define DATASET_TAG_RANDOM "pcg"
+#elif defined(RANDOM_USE_PHILOX)
+#  define DATASET_TAG_RANDOM "philox"
+#else
+#  define DATASET_TAG_RANDOM "mt"
+#endif
+#ifdef USE_PARALLEL_DATA_GENERATION
+#  define DATASET_TAG_PARALLEL "-par"
+#else
+#  define DATASET_TAG_PARALLEL ""
+#endif
+#ifdef RANDOM_FILL_LEMIRE
+#  define DATASET_TAG_FILL "-lemire"
+#else
+#  define DATASET_TAG_FILL ""
+#endif
+#define DATASET_TAG DATASET_TAG_RANDOM DATASET_TAG_FILL DATASET_TAG_PARALLEL
+
+
+typedef struct header {
+    char magic[8];
+    char name[DATASET_NAME_SIZE];
+    char tag[DATASET_NAME_SIZE];
+    long numParam;
+    long params[DATASET_MAX_PARAM];
+    long numSection;
+    long offsets[DATASET_MAX_SECTION];
+    long sizes[DATASET_MAX_SECTION];
+} header_t;
+
+struct dataset {
+    header_t header;
+    /* Opened entries */
+    char* base;
+    long mapSize;
+    /* Entries being written */
+    int fd;
+    long offset;
+    bool_t isError;
+    char path[DATASET_PATH_SIZE];
+    char tmpPath[DATASET_PATH_SIZE];
+};
+
+
+/* =============================================================================
+ * initHeader
+ * -- Returns FALSE if the name or parameters do not fit
+ * =============================================================================
+ */
+static bool_t
+initHeader (header_t* headerPtr, const char* name, const long* params, long numParam)
+{
+    if (strlen(name) >= DATASET_NAME_SIZE || numParam > DATASET_MAX_PARAM) {
+        return FALSE;
+    }
+
+    memset(headerPtr, 0, sizeof(header_t));
+    memcpy(headerPtr->magic, DATASET_MAGIC, sizeof(headerPtr->magic));
+    strcpy(headerPtr->name, name);
+    strcpy(headerPtr->tag, DATASET_TAG);
+    headerPtr->numParam = numParam;
+    memcpy(headerPtr->params, params, numParam * sizeof(long));
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * makePath
+ * -- File name is the generator name plus an FNV-1a hash of the whole key
+ * =============================================================================
+ */
+static bool_t
+makePath (char* path, const header_t* headerPtr)
+{
+    const char* dir = getenv("STAMP_CACHE_DIR");
+    if (dir == NULL || dir[0] == '\0') {
+        dir = DATASET_DEFAULT_DIR;
+    }
+
+    unsigned long hash = 14695981039346656037UL;
+    const unsigned char* bytes = (const unsigned char*)headerPtr;
+    long size = (long)((const char*)&headerPtr->numSection - (const char*)headerPtr);
+    long i;
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 1099511628211UL;
+    }
+
+    int n = snprintf(path, DATASET_PATH_SIZE, "%s/%s-%016lx.ds",
+                     dir, headerPtr->name, hash);
+
+    return ((n > 0 && n < DATASET_PATH_SIZE) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * dataset_open
+ * -- Maps the entry for 'name' and 'params'
+ * -- Returns NULL if there is none or it does not match
+ * =============================================================================
+ */
+dataset_t*
+dataset_open (const char* name, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = (dataset_t*)malloc(sizeof(dataset_t));
+    if (datasetPtr == NULL) {
+        return NULL;
+    }
+    if (!initHeader(&datasetPtr->header, name, params, numParam) ||
+        !makePath(datasetPtr->path, &datasetPtr->header))
+    {
+        free(datasetPtr);
+        return NULL;
+    }
+
+    int fd = open(datasetPtr->path, O_RDONLY);
+    if (fd < 0) {
+        free(datasetPtr);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(header_t)) {
+        close(fd);
+        free(datasetPtr);
+        return NULL;
+    }
+    void* base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        free(datasetPtr);
+        return NULL;
+    }
+    datasetPtr->base = (char*)base;
+    datasetPtr->mapSize = st.st_size;
+
+    /* Key must match exactly; the hash only picks the file */
+    const header_t* fileHeaderPtr = (const header_t*)base;
+    const header_t* keyPtr = &datasetPtr->header;
+    long keySize = (long)((const char*)&keyPtr->numSection - (const char*)keyPtr);
+    bool_t isValid = (memcmp(fileHeaderPtr, keyPtr, keySize) == 0);
+    if (isValid) {
+        long s;
+        isValid = (fileHeaderPtr->numSection >= 0 &&
+                   fileHeaderPtr->numSection <= DATASET_MAX_SECTION);
+        for (s = 0; isValid && s < fileHeaderPtr->numSection; s++) {
+            isValid = (fileHeaderPtr->offsets[s] >= (long)sizeof(header_t) &&
+                       fileHeaderPtr->sizes[s] >= 0 &&
+                       (fileHeaderPtr->offsets[s] + fileHeaderPtr->sizes[s]) <=
+                       datasetPtr->mapSize);
+        }
+    }
+    if (!isValid) {
+        dataset_close(datasetPtr);
+        return NULL;
+    }
+    datasetPtr->header = *fileHeaderPtr;
+
+    return datasetPtr;
+}
+
+
+/* =============================================================================
+ * dataset_getSection
+ * -- Returns NULL if 'index' is out of range
+ * =============================================================================
+ */
+const void*
+dataset_getSection (dataset_t* datasetPtr, long index, long* sizePtr)
+{
+    if (index < 0 || index >= datasetPtr->header.numSection) {
+        return NULL;
+    }
+
+    *sizePtr = datasetPtr->header.sizes[index];
+
+    return (datasetPtr->base + datasetPtr->header.offsets[index]);
+}
+
+
+/* =============================================================================
+ * dataset_close
+ * -- Unmaps an opened entry; its sections are no longer valid
+ * =============================================================================
+ */
+void
+dataset_close (dataset_t* datasetPtr)
+{
+    munmap(datasetPtr->base, datasetPtr->mapSize);
+    free(datasetPtr);
+}
+
+
+/* =============================================================================
+ * writeAll
+ * =============================================================================
+ */
+static bool_t
+writeAll (dataset_t* datasetPtr, const void* data, long size)
+{
+    const char* bytes = (const char*)data;
+
+    while (size > 0) {
+        ssize_t n = write(datasetPtr->fd, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            datasetPtr->isError = TRUE;
+            return FALSE;
+        }
+        bytes += n;
+        size -= n;
+        datasetPtr->offset += n;
+    }
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * dataset_create
+ * -- Starts writing the entry for 'name' and 'params'
+ * -- Returns NULL on failure; callers then just skip caching
+ * =============================================================================
+ */
+dataset_t*
+dataset_create (const char* name, const long* params, long numParam)
+{
+    dataset_t* datasetPtr = (dataset_t*)malloc(sizeof(dataset_t));
+    if (datasetPtr == NULL) {
+        return NULL;
+    }
+    if (!initHeader(&datasetPtr->header, name, params, numParam) ||
+        !makePath(datasetPtr->path, &datasetPtr->header))
+    {
+        free(datasetPtr);
+        return NULL;
+    }
+
+    /* Only the last path component is created */
+    char* slash = strrchr(datasetPtr->path, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        mkdir(datasetPtr->path, 0777);
+        *slash = '/';
+    }
+
+    /* Private temporary name, so concurrent writers do not collide */
+    int n = snprintf(datasetPtr->tmpPath, DATASET_PATH_SIZE, "%s.%ld.tmp",
+                     datasetPtr->path, (long)getpid());
+    if (n <= 0 || n >= DATASET_PATH_SIZE) {
+        free(datasetPtr);
+        return NULL;
+    }
+    datasetPtr->fd = open(datasetPtr->tmpPath, (O_WRONLY | O_CREAT | O_TRUNC), 0666);
+    if (datasetPtr->fd < 0) {
+        free(datasetPtr);
+        return NULL;
+    }
+    datasetPtr->offset = 0;
+    datasetPtr->isError = FALSE;
+
+    /* Header is rewritten with the section table on commit */
+    writeAll(datasetPtr, &datasetPtr->header, sizeof(header_t));
+
+    return datasetPtr;
+}
+
+
+/* =============================================================================
+ * dataset_addSection
+ * -- Starts a new section holding 'size' bytes of 'data' ('data' may be NULL
+ *    if 'size' is 0)
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+dataset_addSection (dataset_t* datasetPtr, const void* data, long size)
+{
+    header_t* headerPtr = &datasetPtr->header;
+    static const char zeros[DATASET_ALIGN];
+
+    if (datasetPtr->isError || headerPtr->numSection == DATASET_MAX_SECTION) {
+        datasetPtr->isError = TRUE;
+        return FALSE;
+    }
+
+    long pad = (DATASET_ALIGN - (datasetPtr->offset % DATASET_ALIGN)) % DATASET_ALIGN;
+    if (!writeAll(datasetPtr, zeros, pad)) {
+        return FALSE;
+    }
+
+    long s = headerPtr->numSection++;
+    headerPtr->offsets[s] = datasetPtr->offset;
+    headerPtr->sizes[s] = 0;
+
+    return dataset_extendSection(datasetPtr, data, size);
+}
+
+
+/* =============================================================================
+ * dataset_extendSection
+ * -- Appends to the last section
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+dataset_extendSection (dataset_t* datasetPtr, const void* data, long size)
+{
+    header_t* headerPtr = &datasetPtr->header;
+
+    assert(headerPtr->numSection > 0);
+    if (datasetPtr->isError || !writeAll(datasetPtr, data, size)) {
+        return FALSE;
+    }
+    headerPtr->sizes[headerPtr->numSection - 1] += size;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * dataset_commit
+ * -- Publishes the entry and frees 'datasetPtr'; pass FALSE for 'isComplete'
+ *    to throw it away instead
+ * -- Returns FALSE if nothing was published
+ * =============================================================================
+ */
+bool_t
+dataset_commit (dataset_t* datasetPtr, bool_t isComplete)
+{
+    bool_t isPublished = FALSE;
+
+    if (isComplete && !datasetPtr->isError &&
+        pwrite(datasetPtr->fd, &datasetPtr->header, sizeof(header_t), 0) ==
+        (ssize_t)sizeof(header_t))
+    {
+        isPublished = TRUE;
+    }
+    if (close(datasetPtr->fd) != 0) {
+        isPublished = FALSE;
+    }
+
+    if (isPublished && rename(datasetPtr->tmpPath, datasetPtr->path) == 0) {
+        isPublished = TRUE;
+    } else {
+        unlink(datasetPtr->tmpPath);
+        isPublished = FALSE;
+    }
+
+    free(datasetPtr);
+
+    return isPublished;
+}
+
+
+/* =============================================================================
+ * TEST_DATASET
+ * =============================================================================
+ */
+#ifdef TEST_DATASET
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    long params[] = {1, 2, 3};
+    long otherParams[] = {1, 2, 4};
+    const char text[] = "hello";
+    long values[100];
+    dataset_t* datasetPtr;
+    const void* section;
+    long size;
+    long i;
+
+    puts("Starting...");
+
+    header_t header;
+    char path[DATASET_PATH_SIZE];
+
+    setenv("STAMP_CACHE_DIR", "/tmp", 1);
+    assert(initHeader(&header, "test", params, 3));
+    assert(makePath(path, &header));
+    unlink(path);
+
+    for (i = 0; i < 100; i++) {
+        values[i] = i * i;
+    }
+
+    /* Abandoned entries are not published */
+    datasetPtr = dataset_create("test", params, 3);
+    assert(datasetPtr);
+    assert(dataset_addSection(datasetPtr, text, sizeof(text)));
+    assert(!dataset_commit(datasetPtr, FALSE));
+    assert(dataset_open("test", params, 3) == NULL);
+
+    datasetPtr = dataset_create("test", params, 3);
+    assert(datasetPtr);
+    assert(dataset_addSection(datasetPtr, text, sizeof(text)));
+    assert(dataset_addSection(datasetPtr, NULL, 0));
+    assert(dataset_extendSection(datasetPtr, values, 50 * sizeof(long)));
+    assert(dataset_extendSection(datasetPtr, &values[50], 50 * sizeof(long)));
+    assert(dataset_commit(datasetPtr, TRUE));
+
+    assert(dataset_open("test", otherParams, 3) == NULL);
+    assert(dataset_open("test", params, 2) == NULL);
+    assert(dataset_open("other", params, 3) == NULL);
+
+    datasetPtr = dataset_open("test", params, 3);
+    assert(datasetPtr);
+    section = dataset_getSection(datasetPtr, 0, &size);
+    assert(section && size == sizeof(text));
+    assert(strcmp((const char*)section, text) == 0);
+    section = dataset_getSection(datasetPtr, 1, &size);
+    assert(section && size == sizeof(values));
+    assert(((long)section % DATASET_ALIGN) == 0);
+    assert(memcmp(section, values, sizeof(values)) == 0);
+    assert(dataset_getSection(datasetPtr, 2, &size) == NULL);
+    dataset_close(datasetPtr);
+    unlink(path);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_DATASET */
+
+
+/* =============================================================================
+ *
+ * End of dataset.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,127 @@
+/* =============================================================================
+ *
+ * dataset.h
+ * -- On-disk cache of generated benchmark inputs
+ *
+ * =============================================================================
+ *
+ * An entry is a flat file of sections, named by a hash of the generator name,
+ * its parameters and the build options that change generated data (random
+ * generator, parallel generation). The first run writes the entry under a
+ * temporary name and renames it into place; later runs map it read-only and
+ * copy the sections into their own structures.
+ *
+ * Entries live in $STAMP_CACHE_DIR, or DATASET_DEFAULT_DIR if unset. Remove
+ * the directory to invalidate everything.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef DATASET_H
+#define DATASET_H 1
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifndef DATASET_DEFAULT_DIR
+#  define DATASET_DEFAULT_DIR "/tmp/stamp-cache"
+#endif
+
+#define DATASET_MAX_PARAM   (16)
+#define DATASET_MAX_SECTION (8)
+
+
+typedef struct dataset dataset_t;
+
+
+/* =============================================================================
+ * dataset_open
+ * -- Maps the entry for 'name' and 'params'
+ * -- Returns NULL if there is none or it does not match
+ * =============================================================================
+ */
+dataset_t*
+dataset_open (const char* name, const long* params, long numParam);
+
+
+/* =============================================================================
+ * dataset_getSection
+ * -- Returns NULL if 'index' is out of range
+ * =============================================================================
+ */
+const void*
+dataset_getSection (dataset_t* datasetPtr, long index, long* sizePtr);
+
+
+/* =============================================================================
+ * dataset_close
+ * -- Unmaps an opened entry; its sections are no longer valid
+ * =============================================================================
+ */
+void
+dataset_close (dataset_t* datasetPtr);
+
+
+/* =============================================================================
+ * dataset_create
+ * -- Starts writing the entry for 'name' and 'params'
+ * -- Returns NULL on failure; callers then just skip caching
+ * =============================================================================
+ */
+dataset_t*
+dataset_create (const char* name, const long* params, long numParam);
+
+
+/* =============================================================================
+ * dataset_addSection
+ * -- Starts a new section holding 'size' bytes of 'data' ('data' may be NULL
+ *    if 'size' is 0)
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+dataset_addSection (dataset_t* datasetPtr, const void* data, long size);
+
+
+/* =============================================================================
+ * dataset_extendSection
+ * -- Appends to the last section
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+dataset_extendSection (dataset_t* datasetPtr, const void* data, long size);
+
+
+/* =============================================================================
+ * dataset_commit
+ * -- Publishes the entry and frees 'datasetPtr'; pass FALSE for 'isComplete'
+ *    to throw it away instead
+ * -- Returns FALSE if nothing was published
+ * =============================================================================
+ */
+bool_t
+dataset_commit (dataset_t* datasetPtr, bool_t isComplete);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* DATASET_H */
+
+
+/* =============================================================================
+ *
+ * End of dataset.h
+ *
+ * =============================================================================
+ */
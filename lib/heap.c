@@ -75,17 +75,100 @@
 #include "tm.h"
 #include "types.h"
 
+#ifndef HEAP_USE_MULTIQUEUE
+
+#ifndef HEAP_ARITY
+#  define HEAP_ARITY (2)
+#endif
+
+#define HEAP_LINE_SIZE (64)
+
+#ifdef HEAP_CACHED_KEY
+typedef struct heap_entry {
+    long key;
+    void* dataPtr;
+} heap_entry_t;
+#else
+typedef struct heap_entry {
+    void* dataPtr;
+} heap_entry_t;
+#endif /* HEAP_CACHED_KEY */
+
 struct heap {
-    void** elements;
+    heap_entry_t* elements;
+    heap_entry_t* block;        /* allocation holding elements, to free */
     long size;
     long capacity;
     TM_PURE long (*compare)(const void*, const void*);
+    TM_PURE long (*key)(const void*);
 };
 
 
-#define PARENT(i)       ((i) / 2)
-#define LEFT_CHILD(i)   (2*i)
-#define RIGHT_CHILD(i)  (2*(i) + 1)
+/*
+ * Elements are numbered from 1 (the root) and element i is stored in slot
+ * SLOT(i). The offset makes the HEAP_ARITY children of a node start on a
+ * multiple of HEAP_ARITY slots, so in the line-aligned array they span as few
+ * cache lines as possible. HEAP_ARITY 2 gives the usual binary layout.
+ */
+#define SLOT(i)         ((i) + HEAP_ARITY - 2)
+#define PARENT(i)       (((i) - 2) / HEAP_ARITY + 1)
+#define FIRST_CHILD(i)  (HEAP_ARITY * ((i) - 1) + 2)
+
+
+#ifdef HEAP_CACHED_KEY
+#  define COMPARE_ENTRY(compare, a, b) \
+    (((a).key != (b).key) ? (((a).key > (b).key) ? 1 : -1) \
+                          : (compare)((a).dataPtr, (b).dataPtr))
+#  define HTX_LDENTRY(e, s) \
+    ((e).key = (long)HTM_SHARED_READ((s).key), \
+     (e).dataPtr = (void*)HTM_SHARED_READ_P((s).dataPtr))
+#  define HTX_STENTRY(s, e) \
+    do { \
+        HTM_SHARED_WRITE((s).key, (e).key); \
+        HTM_SHARED_WRITE_P((s).dataPtr, (e).dataPtr); \
+    } while (0)
+#  define HTX_CPENTRY(d, s) \
+    do { \
+        HTM_SHARED_WRITE((d).key, HTM_SHARED_READ((s).key)); \
+        HTM_SHARED_WRITE_P((d).dataPtr, HTM_SHARED_READ_P((s).dataPtr)); \
+    } while (0)
+#  define HTX_STDATA(s, h, d) \
+    do { \
+        HTM_SHARED_WRITE((s).key, makeEntry(h, d).key); \
+        HTM_SHARED_WRITE_P((s).dataPtr, (d)); \
+    } while (0)
+#  define TX_LDENTRY(e, s) \
+    ((e).key = (long)TM_SHARED_READ((s).key), \
+     (e).dataPtr = (void*)TM_SHARED_READ_P((s).dataPtr))
+#  define TX_STENTRY(s, e) \
+    do { \
+        TM_SHARED_WRITE((s).key, (e).key); \
+        TM_SHARED_WRITE_P((s).dataPtr, (e).dataPtr); \
+    } while (0)
+#else
+#  define COMPARE_ENTRY(compare, a, b) \
+    ((compare)((a).dataPtr, (b).dataPtr))
+#  define HTX_LDENTRY(e, s) \
+    ((e).dataPtr = (void*)HTM_SHARED_READ_P((s).dataPtr))
+#  define HTX_STENTRY(s, e) \
+    do { \
+        HTM_SHARED_WRITE_P((s).dataPtr, (e).dataPtr); \
+    } while (0)
+#  define HTX_CPENTRY(d, s) \
+    do { \
+        HTM_SHARED_WRITE_P((d).dataPtr, HTM_SHARED_READ_P((s).dataPtr)); \
+    } while (0)
+#  define HTX_STDATA(s, h, d) \
+    do { \
+        HTM_SHARED_WRITE_P((s).dataPtr, (d)); \
+    } while (0)
+#  define TX_LDENTRY(e, s) \
+    ((e).dataPtr = (void*)TM_SHARED_READ_P((s).dataPtr))
+#  define TX_STENTRY(s, e) \
+    do { \
+        TM_SHARED_WRITE_P((s).dataPtr, (e).dataPtr); \
+    } while (0)
+#endif /* HEAP_CACHED_KEY */
 
 
 #ifndef ORIGINAL
@@ -109,6 +192,67 @@ static void
 TMheapify (TM_ARGDECL  heap_t* heapPtr, long startIndex);
 
 
+/* =============================================================================
+ * allocElements
+ * -- Cache-line aligned array of 'capacity' slots
+ * =============================================================================
+ */
+static heap_entry_t*
+allocElements (long capacity)
+{
+    size_t size = capacity * sizeof(heap_entry_t);
+    size = (size + HEAP_LINE_SIZE - 1) & ~(size_t)(HEAP_LINE_SIZE - 1);
+
+    return (heap_entry_t*)aligned_alloc(HEAP_LINE_SIZE, size);
+}
+
+
+/* =============================================================================
+ * ELEMENTS_BLOCK_SIZE
+ * -- Transactional allocators do not align, so transactions allocate this
+ *    much for 'capacity' slots and start the array at the first line boundary
+ *    in the block
+ * =============================================================================
+ */
+#define ELEMENTS_BLOCK_SIZE(capacity) \
+    ((capacity) * sizeof(heap_entry_t) + HEAP_LINE_SIZE - 1)
+
+
+/* =============================================================================
+ * alignElements
+ * =============================================================================
+ */
+TM_PURE
+static heap_entry_t*
+alignElements (heap_entry_t* blockPtr)
+{
+    unsigned long address = (unsigned long)blockPtr;
+
+    address = (address + HEAP_LINE_SIZE - 1) & ~(unsigned long)(HEAP_LINE_SIZE - 1);
+
+    return (heap_entry_t*)address;
+}
+
+
+/* =============================================================================
+ * makeEntry
+ * =============================================================================
+ */
+TM_PURE
+static heap_entry_t
+makeEntry (heap_t* heapPtr, void* dataPtr)
+{
+    heap_entry_t entry;
+
+#ifdef HEAP_CACHED_KEY
+    entry.key = ((heapPtr->key) ? (heapPtr->key(dataPtr)) : (0));
+#endif
+    entry.dataPtr = dataPtr;
+
+    return entry;
+}
+
+
 /* =============================================================================
  * heap_alloc
  * -- Returns NULL on failure
@@ -121,18 +265,35 @@ heap_alloc (long initCapacity, long (*compare)(const void*, const void*))
 
     heapPtr = (heap_t*)malloc(sizeof(heap_t));
     if (heapPtr) {
-        long capacity = ((initCapacity > 0) ? (initCapacity) : (1));
-        heapPtr->elements = (void**)malloc(capacity * sizeof(void*));
+        long capacity = SLOT((initCapacity > 0) ? (initCapacity) : (1));
+        heapPtr->elements = allocElements(capacity);
         assert(heapPtr->elements);
+        heapPtr->block = heapPtr->elements;
         heapPtr->size = 0;
         heapPtr->capacity = capacity;
         heapPtr->compare = compare;
+        heapPtr->key = NULL;
     }
 
     return heapPtr;
 }
 
 
+/* =============================================================================
+ * heap_setKey
+ * -- With -DHEAP_CACHED_KEY, key(dataPtr) is computed on insert and stored
+ *    next to the pointer; compare is only called when keys are equal
+ * -- key must agree with compare; call before the first insert
+ * =============================================================================
+ */
+void
+heap_setKey (heap_t* heapPtr, long (*key)(const void*))
+{
+    assert(heapPtr->size == 0);
+    heapPtr->key = key;
+}
+
+
 /* =============================================================================
  * heap_free
  * =============================================================================
@@ -140,7 +301,7 @@ heap_alloc (long initCapacity, long (*compare)(const void*, const void*))
 void
 heap_free (heap_t* heapPtr)
 {
-    free(heapPtr->elements);
+    free(heapPtr->block);
     free(heapPtr);
 }
 
@@ -152,20 +313,19 @@ heap_free (heap_t* heapPtr)
 static void
 siftUp (heap_t* heapPtr, long startIndex)
 {
-    void** elements = heapPtr->elements;
+    heap_entry_t* elements = heapPtr->elements;
     long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long index = startIndex;
     while ((index > 1)) {
         long parentIndex = PARENT(index);
-        void* parentPtr = elements[parentIndex];
-        void* thisPtr   = elements[index];
-        if (compare(parentPtr, thisPtr) >= 0) {
+        heap_entry_t parentEntry = elements[SLOT(parentIndex)];
+        heap_entry_t thisEntry   = elements[SLOT(index)];
+        if (COMPARE_ENTRY(compare, parentEntry, thisEntry) >= 0) {
             break;
         }
-        void* tmpPtr = parentPtr;
-        elements[parentIndex] = thisPtr;
-        elements[index] = tmpPtr;
+        elements[SLOT(parentIndex)] = thisEntry;
+        elements[SLOT(index)] = parentEntry;
         index = parentIndex;
     }
 }
@@ -178,20 +338,21 @@ siftUp (heap_t* heapPtr, long startIndex)
 static void
 HTMsiftUp (heap_t* heapPtr, long startIndex)
 {
-    void** elements = (void**)HTM_SHARED_READ_P(heapPtr->elements);
+    heap_entry_t* elements = (heap_entry_t*)HTM_SHARED_READ_P(heapPtr->elements);
     long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long index = startIndex;
     while ((index > 1)) {
         long parentIndex = PARENT(index);
-        void* parentPtr = (void*)HTM_SHARED_READ_P(elements[parentIndex]);
-        void* thisPtr   = (void*)HTM_SHARED_READ_P(elements[index]);
-        if (compare(parentPtr, thisPtr) >= 0) {
+        heap_entry_t parentEntry;
+        heap_entry_t thisEntry;
+        HTX_LDENTRY(parentEntry, elements[SLOT(parentIndex)]);
+        HTX_LDENTRY(thisEntry, elements[SLOT(index)]);
+        if (COMPARE_ENTRY(compare, parentEntry, thisEntry) >= 0) {
             break;
         }
-        void* tmpPtr = parentPtr;
-        HTM_SHARED_WRITE_P(elements[parentIndex], thisPtr);
-        HTM_SHARED_WRITE_P(elements[index], tmpPtr);
+        HTX_STENTRY(elements[SLOT(parentIndex)], thisEntry);
+        HTX_STENTRY(elements[SLOT(index)], parentEntry);
         index = parentIndex;
     }
 
@@ -233,20 +394,21 @@ TMsiftUp (TM_ARGDECL  heap_t* heapPtr, long startIndex)
 # endif /* MERGE_HEAP */
         , heapPtr, startIndex);
 #endif /* ORIGINAL */
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
+    heap_entry_t* elements = (heap_entry_t*)TM_SHARED_READ_P(heapPtr->elements);
     TM_PURE long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long index = startIndex;
     while ((index > 1)) {
         long parentIndex = PARENT(index);
-        void* parentPtr = (void*)TM_SHARED_READ_P(elements[parentIndex]);
-        void* thisPtr   = (void*)TM_SHARED_READ_P(elements[index]);
-        if (compare(parentPtr, thisPtr) >= 0) {
+        heap_entry_t parentEntry;
+        heap_entry_t thisEntry;
+        TX_LDENTRY(parentEntry, elements[SLOT(parentIndex)]);
+        TX_LDENTRY(thisEntry, elements[SLOT(index)]);
+        if (COMPARE_ENTRY(compare, parentEntry, thisEntry) >= 0) {
             break;
         }
-        void* tmpPtr = parentPtr;
-        TM_SHARED_WRITE_P(elements[parentIndex], thisPtr);
-        TM_SHARED_WRITE_P(elements[index], tmpPtr);
+        TX_STENTRY(elements[SLOT(parentIndex)], thisEntry);
+        TX_STENTRY(elements[SLOT(index)], parentEntry);
         index = parentIndex;
     }
 
@@ -269,24 +431,25 @@ heap_insert (heap_t* heapPtr, void* dataPtr)
     long size = heapPtr->size;
     long capacity = heapPtr->capacity;
 
-    if ((size + 1) >= capacity) {
+    if (SLOT(size + 1) >= capacity) {
         long newCapacity = capacity * 2;
-        void** newElements = (void**)malloc(newCapacity * sizeof(void*));
+        heap_entry_t* newElements = allocElements(newCapacity);
         if (newElements == NULL) {
             return FALSE;
         }
         heapPtr->capacity = newCapacity;
         long i;
-        void** elements = heapPtr->elements;
-        for (i = 0; i <= size; i++) {
-            newElements[i] = elements[i];
+        heap_entry_t* elements = heapPtr->elements;
+        for (i = 1; i <= size; i++) {
+            newElements[SLOT(i)] = elements[SLOT(i)];
         }
-        free(heapPtr->elements);
+        free(heapPtr->block);
         heapPtr->elements = newElements;
+        heapPtr->block = newElements;
     }
 
     size = ++(heapPtr->size);
-    heapPtr->elements[size] = dataPtr;
+    heapPtr->elements[SLOT(size)] = makeEntry(heapPtr, dataPtr);
     siftUp(heapPtr, size);
 
     return TRUE;
@@ -306,27 +469,30 @@ HTMheap_insert (heap_t* heapPtr, void* dataPtr)
     long size = (long)HTM_SHARED_READ(heapPtr->size);
     long capacity = (long)HTM_SHARED_READ(heapPtr->capacity);
 
-    if ((size + 1) >= capacity) {
+    if (SLOT(size + 1) >= capacity) {
         long newCapacity = capacity * 2;
-        void** newElements = (void**)HTM_MALLOC(newCapacity * sizeof(void*));
-        if (newElements == NULL) {
+        heap_entry_t* newBlock =
+            (heap_entry_t*)HTM_MALLOC(ELEMENTS_BLOCK_SIZE(newCapacity));
+        if (newBlock == NULL) {
             rv = FALSE;
             goto out;
         }
+        heap_entry_t* newElements = alignElements(newBlock);
         HTM_SHARED_WRITE(heapPtr->capacity, newCapacity);
         long i;
-        void** elements = HTM_SHARED_READ_P(heapPtr->elements);
-        for (i = 0; i <= size; i++) {
-            newElements[i] = (void*)HTM_SHARED_READ_P(elements[i]);
+        heap_entry_t* elements = HTM_SHARED_READ_P(heapPtr->elements);
+        for (i = 1; i <= size; i++) {
+            HTX_LDENTRY(newElements[SLOT(i)], elements[SLOT(i)]);
         }
-        TM_FREE(heapPtr->elements);
-        TM_SHARED_WRITE(heapPtr->elements, newElements);
+        HTM_FREE((heap_entry_t*)HTM_SHARED_READ_P(heapPtr->block));
+        HTM_SHARED_WRITE_P(heapPtr->block, newBlock);
+        HTM_SHARED_WRITE_P(heapPtr->elements, newElements);
     }
 
     size++;
     HTM_SHARED_WRITE(heapPtr->size, size);
-    void** elements = (void**)HTM_SHARED_READ_P(heapPtr->elements);
-    HTM_SHARED_WRITE_P(elements[size], dataPtr);
+    heap_entry_t* elements = (heap_entry_t*)HTM_SHARED_READ_P(heapPtr->elements);
+    HTX_STDATA(elements[SLOT(size)], heapPtr, dataPtr);
     HTMsiftUp(TM_ARG  heapPtr, size);
 
     rv = TRUE;
@@ -377,27 +543,32 @@ TMheap_insert (TM_ARGDECL  heap_t* heapPtr, void* dataPtr)
     long size = (long)TM_SHARED_READ(heapPtr->size);
     long capacity = (long)TM_SHARED_READ(heapPtr->capacity);
 
-    if ((size + 1) >= capacity) {
+    if (SLOT(size + 1) >= capacity) {
         long newCapacity = capacity * 2;
-        void** newElements = (void**)TM_MALLOC(newCapacity * sizeof(void*));
-        if (newElements == NULL) {
+        heap_entry_t* newBlock =
+            (heap_entry_t*)TM_MALLOC(ELEMENTS_BLOCK_SIZE(newCapacity));
+        if (newBlock == NULL) {
             rv = FALSE;
             goto out;
         }
+        heap_entry_t* newElements = alignElements(newBlock);
         TM_SHARED_WRITE(heapPtr->capacity, newCapacity);
         long i;
-        void** elements = TM_SHARED_READ_P(heapPtr->elements);
-        for (i = 0; i <= size; i++) {
-            newElements[i] = (void*)TM_SHARED_READ_P(elements[i]);
+        heap_entry_t* elements = TM_SHARED_READ_P(heapPtr->elements);
+        for (i = 1; i <= size; i++) {
+            TX_LDENTRY(newElements[SLOT(i)], elements[SLOT(i)]);
         }
-        TM_FREE(heapPtr->elements);
-        TM_SHARED_WRITE(heapPtr->elements, newElements);
+        heap_entry_t* oldBlock = (heap_entry_t*)TM_SHARED_READ_P(heapPtr->block);
+        TM_FREE(oldBlock);
+        TM_SHARED_WRITE_P(heapPtr->block, newBlock);
+        TM_SHARED_WRITE_P(heapPtr->elements, newElements);
     }
 
     size++;
     TM_SHARED_WRITE(heapPtr->size, size);
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
-    TM_SHARED_WRITE_P(elements[size], dataPtr);
+    heap_entry_t* elements = (heap_entry_t*)TM_SHARED_READ_P(heapPtr->elements);
+    heap_entry_t entry = makeEntry(heapPtr, dataPtr);
+    TX_STENTRY(elements[SLOT(size)], entry);
     TMsiftUp(TM_ARG  heapPtr, size);
 
     rv = TRUE;
@@ -417,7 +588,7 @@ replay:
 static void
 heapify (heap_t* heapPtr, long startIndex)
 {
-    void** elements = heapPtr->elements;
+    heap_entry_t* elements = heapPtr->elements;
     long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long size = heapPtr->size;
@@ -425,30 +596,27 @@ heapify (heap_t* heapPtr, long startIndex)
 
     while (1) {
 
-        long leftIndex = LEFT_CHILD(index);
-        long rightIndex = RIGHT_CHILD(index);
-        long maxIndex = -1;
-
-        if ((leftIndex <= size) &&
-            (compare(elements[leftIndex], elements[index]) > 0))
-        {
-            maxIndex = leftIndex;
-        } else {
-            maxIndex = index;
+        long childIndex = FIRST_CHILD(index);
+        long lastIndex = childIndex + HEAP_ARITY - 1;
+        if (lastIndex > size) {
+            lastIndex = size;
         }
 
-        if ((rightIndex <= size) &&
-            (compare(elements[rightIndex], elements[maxIndex]) > 0))
-        {
-            maxIndex = rightIndex;
+        long maxIndex = index;
+        heap_entry_t maxEntry = elements[SLOT(index)];
+        for (; childIndex <= lastIndex; childIndex++) {
+            heap_entry_t childEntry = elements[SLOT(childIndex)];
+            if (COMPARE_ENTRY(compare, childEntry, maxEntry) > 0) {
+                maxIndex = childIndex;
+                maxEntry = childEntry;
+            }
         }
 
         if (maxIndex == index) {
             break;
         } else {
-            void* tmpPtr = elements[index];
-            elements[index] = elements[maxIndex];
-            elements[maxIndex] = tmpPtr;
+            elements[SLOT(maxIndex)] = elements[SLOT(index)];
+            elements[SLOT(index)] = maxEntry;
             index = maxIndex;
         }
     }
@@ -462,7 +630,7 @@ heapify (heap_t* heapPtr, long startIndex)
 static void
 HTMheapify (heap_t* heapPtr, long startIndex)
 {
-    void** elements = (void**)HTM_SHARED_READ_P(heapPtr->elements);
+    heap_entry_t* elements = (heap_entry_t*)HTM_SHARED_READ_P(heapPtr->elements);
     long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long size = (long)HTM_SHARED_READ(heapPtr->size);
@@ -470,33 +638,30 @@ HTMheapify (heap_t* heapPtr, long startIndex)
 
     while (1) {
 
-        long leftIndex = LEFT_CHILD(index);
-        long rightIndex = RIGHT_CHILD(index);
-        long maxIndex = -1;
-
-        if ((leftIndex <= size) &&
-            (compare((void*)HTM_SHARED_READ_P(elements[leftIndex]),
-                     (void*)HTM_SHARED_READ_P(elements[index])) > 0))
-        {
-            maxIndex = leftIndex;
-        } else {
-            maxIndex = index;
+        long childIndex = FIRST_CHILD(index);
+        long lastIndex = childIndex + HEAP_ARITY - 1;
+        if (lastIndex > size) {
+            lastIndex = size;
         }
 
-        if ((rightIndex <= size) &&
-            (compare((void*)HTM_SHARED_READ_P(elements[rightIndex]),
-                     (void*)HTM_SHARED_READ_P(elements[maxIndex])) > 0))
-        {
-            maxIndex = rightIndex;
+        long maxIndex = index;
+        heap_entry_t thisEntry;
+        HTX_LDENTRY(thisEntry, elements[SLOT(index)]);
+        heap_entry_t maxEntry = thisEntry;
+        for (; childIndex <= lastIndex; childIndex++) {
+            heap_entry_t childEntry;
+            HTX_LDENTRY(childEntry, elements[SLOT(childIndex)]);
+            if (COMPARE_ENTRY(compare, childEntry, maxEntry) > 0) {
+                maxIndex = childIndex;
+                maxEntry = childEntry;
+            }
         }
 
         if (maxIndex == index) {
             break;
         } else {
-            void* tmpPtr = (void*)HTM_SHARED_READ_P(elements[index]);
-            HTM_SHARED_WRITE_P(elements[index],
-                              (void*)HTM_SHARED_READ(elements[maxIndex]));
-            HTM_SHARED_WRITE_P(elements[maxIndex], tmpPtr);
+            HTX_STENTRY(elements[SLOT(maxIndex)], thisEntry);
+            HTX_STENTRY(elements[SLOT(index)], maxEntry);
             index = maxIndex;
         }
     }
@@ -511,7 +676,7 @@ TM_CALLABLE
 static void
 TMheapify (TM_ARGDECL  heap_t* heapPtr, long startIndex)
 {
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
+    heap_entry_t* elements = (heap_entry_t*)TM_SHARED_READ_P(heapPtr->elements);
     TM_PURE long (*compare)(const void*, const void*) = heapPtr->compare;
 
     long size = (long)TM_SHARED_READ(heapPtr->size);
@@ -519,33 +684,30 @@ TMheapify (TM_ARGDECL  heap_t* heapPtr, long startIndex)
 
     while (1) {
 
-        long leftIndex = LEFT_CHILD(index);
-        long rightIndex = RIGHT_CHILD(index);
-        long maxIndex = -1;
-
-        if ((leftIndex <= size) &&
-            (compare((void*)TM_SHARED_READ_P(elements[leftIndex]),
-                     (void*)TM_SHARED_READ_P(elements[index])) > 0))
-        {
-            maxIndex = leftIndex;
-        } else {
-            maxIndex = index;
+        long childIndex = FIRST_CHILD(index);
+        long lastIndex = childIndex + HEAP_ARITY - 1;
+        if (lastIndex > size) {
+            lastIndex = size;
         }
 
-        if ((rightIndex <= size) &&
-            (compare((void*)TM_SHARED_READ_P(elements[rightIndex]),
-                     (void*)TM_SHARED_READ_P(elements[maxIndex])) > 0))
-        {
-            maxIndex = rightIndex;
+        long maxIndex = index;
+        heap_entry_t thisEntry;
+        TX_LDENTRY(thisEntry, elements[SLOT(index)]);
+        heap_entry_t maxEntry = thisEntry;
+        for (; childIndex <= lastIndex; childIndex++) {
+            heap_entry_t childEntry;
+            TX_LDENTRY(childEntry, elements[SLOT(childIndex)]);
+            if (COMPARE_ENTRY(compare, childEntry, maxEntry) > 0) {
+                maxIndex = childIndex;
+                maxEntry = childEntry;
+            }
         }
 
         if (maxIndex == index) {
             break;
         } else {
-            void* tmpPtr = (void*)TM_SHARED_READ_P(elements[index]);
-            TM_SHARED_WRITE_P(elements[index],
-                              (void*)TM_SHARED_READ(elements[maxIndex]));
-            TM_SHARED_WRITE_P(elements[maxIndex], tmpPtr);
+            TX_STENTRY(elements[SLOT(maxIndex)], thisEntry);
+            TX_STENTRY(elements[SLOT(index)], maxEntry);
             index = maxIndex;
         }
     }
@@ -567,9 +729,9 @@ heap_remove (heap_t* heapPtr)
         return NULL;
     }
 
-    void** elements = heapPtr->elements;
-    void* dataPtr = elements[1];
-    elements[1] = elements[size];
+    heap_entry_t* elements = heapPtr->elements;
+    void* dataPtr = elements[SLOT(1)].dataPtr;
+    elements[SLOT(1)] = elements[SLOT(size)];
     heapPtr->size = size - 1;
     heapify(heapPtr, 1);
 
@@ -591,9 +753,9 @@ HTMheap_remove (heap_t* heapPtr)
         return NULL;
     }
 
-    void** elements = (void**)HTM_SHARED_READ_P(heapPtr->elements);
-    void* dataPtr = (void*)HTM_SHARED_READ_P(elements[1]);
-    HTM_SHARED_WRITE_P(elements[1], HTM_SHARED_READ_P(elements[size]));
+    heap_entry_t* elements = (heap_entry_t*)HTM_SHARED_READ_P(heapPtr->elements);
+    void* dataPtr = (void*)HTM_SHARED_READ_P(elements[SLOT(1)].dataPtr);
+    HTX_CPENTRY(elements[SLOT(1)], elements[SLOT(size)]);
     HTM_SHARED_WRITE(heapPtr->size, (size - 1));
     HTMheapify(TM_ARG  heapPtr, 1);
 
@@ -616,9 +778,11 @@ TMheap_remove (TM_ARGDECL  heap_t* heapPtr)
         return NULL;
     }
 
-    void** elements = (void**)TM_SHARED_READ_P(heapPtr->elements);
-    void* dataPtr = (void*)TM_SHARED_READ_P(elements[1]);
-    TM_SHARED_WRITE_P(elements[1], TM_SHARED_READ_P(elements[size]));
+    heap_entry_t* elements = (heap_entry_t*)TM_SHARED_READ_P(heapPtr->elements);
+    void* dataPtr = (void*)TM_SHARED_READ_P(elements[SLOT(1)].dataPtr);
+    heap_entry_t lastEntry;
+    TX_LDENTRY(lastEntry, elements[SLOT(size)]);
+    TX_STENTRY(elements[SLOT(1)], lastEntry);
     TM_SHARED_WRITE(heapPtr->size, (size - 1));
     TMheapify(TM_ARG  heapPtr, 1);
 
@@ -635,11 +799,11 @@ heap_isValid (heap_t* heapPtr)
 {
     long size = heapPtr->size;
     long (*compare)(const void*, const void*) = heapPtr->compare;
-    void** elements = heapPtr->elements;
+    heap_entry_t* elements = heapPtr->elements;
 
     long i;
-    for (i = 1; i < size; i++) {
-        if (compare(elements[i+1], elements[PARENT(i+1)]) > 0) {
+    for (i = 2; i <= size; i++) {
+        if (COMPARE_ENTRY(compare, elements[SLOT(i)], elements[SLOT(PARENT(i))]) > 0) {
             return FALSE;
         }
     }
@@ -666,6 +830,13 @@ compare (const void* a, const void* b)
 }
 
 
+static long
+key (const void* a)
+{
+    return *((const long*)a);
+}
+
+
 static void
 printHeap (heap_t* heapPtr)
 {
@@ -673,7 +844,7 @@ printHeap (heap_t* heapPtr)
 
     long i;
     for (i = 0; i < heapPtr->size; i++) {
-        printf("%li ", *(long*)heapPtr->elements[i+1]);
+        printf("%li ", *(long*)heapPtr->elements[SLOT(i+1)].dataPtr);
     }
 
     puts("]");
@@ -690,13 +861,15 @@ insertInt (heap_t* heapPtr, long* data)
 }
 
 
-static void
+static long
 removeInt (heap_t* heapPtr)
 {
     long* data = heap_remove(heapPtr);
     printf("Removing: %li\n", *data);
     printHeap(heapPtr);
     assert(heap_isValid(heapPtr));
+
+    return *data;
 }
 
 
@@ -712,20 +885,35 @@ main ()
     heap_t* heapPtr = heap_alloc(1, compare);
 
     assert(heapPtr);
+    heap_setKey(heapPtr, key);
 
     long i;
     for (i = 0; i < global_numData; i++) {
         insertInt(heapPtr, &global_data[i]);
     }
 
-    for (i = 0; i < global_numData; i++) {
-        removeInt(heapPtr);
+    long prev = removeInt(heapPtr);
+    for (i = 1; i < global_numData; i++) {
+        long curr = removeInt(heapPtr);
+        assert(curr <= prev);
+        prev = curr;
     }
 
     assert(heap_remove(heapPtr) == NULL); /* empty */
 
     heap_free(heapPtr);
 
+    /* Transactional growth keeps the array line-aligned */
+    heapPtr = heap_alloc(1, compare);
+    assert(heapPtr);
+    for (i = 0; i < global_numData; i++) {
+        assert(TMheap_insert(TM_ARG  heapPtr, &global_data[i]));
+        assert(((unsigned long)heapPtr->elements % HEAP_LINE_SIZE) == 0);
+        assert(heap_isValid(heapPtr));
+    }
+    assert(heapPtr->capacity > global_numData);
+    heap_free(heapPtr);
+
     puts("Passed all tests.");
 
     return 0;
@@ -783,15 +971,21 @@ stm_merge_t TMheap_merge(stm_merge_context_t *params) {
             ASSERT_FAIL(TM_SHARED_READ_UPDATE(r, heapPtr->capacity, newCapacity));
             ASSERT(newCapacity > 0);
 
-            if (oldCapacity != newCapacity || new + 1 >= newCapacity)
+            if (oldCapacity != newCapacity || SLOT(new + 1) >= newCapacity)
                 return STM_MERGE_ABORT;
 
             /* Revert and reinsert the element in the heap */
-            void **elements = TM_SHARED_READ_P(heapPtr->elements);
-            stm_write_t w = TM_SHARED_DID_WRITE(elements[old + 1]);
+            heap_entry_t *elements = TM_SHARED_READ_P(heapPtr->elements);
+            stm_write_t w = TM_SHARED_DID_WRITE(elements[SLOT(old + 1)].dataPtr);
+            ASSERT_FAIL(STM_VALID_WRITE(w));
+            ASSERT_FAIL(TM_SHARED_UNDO_WRITE(w));
+#  ifdef HEAP_CACHED_KEY
+            w = TM_SHARED_DID_WRITE(elements[SLOT(old + 1)].key);
             ASSERT_FAIL(STM_VALID_WRITE(w));
             ASSERT_FAIL(TM_SHARED_UNDO_WRITE(w));
-            TM_SHARED_WRITE(elements[new + 1], dataPtr);
+#  endif /* HEAP_CACHED_KEY */
+            heap_entry_t entry = makeEntry(heapPtr, dataPtr);
+            TX_STENTRY(elements[SLOT(new + 1)], entry);
 
             /* Increment the heap size */
             w = TM_SHARED_DID_WRITE(heapPtr->size);
@@ -827,3 +1021,5 @@ __attribute__((constructor)) void heap_init() {
     # undef TM_LOG_OP
 }
 #endif /* ORIGINAL */
+
+#endif /* !HEAP_USE_MULTIQUEUE */
@@ -1,6 +1,9 @@
 /* =============================================================================
  *
  * heap.c
+ * -- Options: -DHEAP_ARITY=<d> (default 2; 4 or 8 keep siblings in one line)
+ * -- Options: -DHEAP_CACHED_KEY (store a priority key next to each pointer)
+ * -- Options: -DHEAP_USE_MULTIQUEUE (relaxed MultiQueue, see mqheap.c)
  *
  * =============================================================================
  *
@@ -88,6 +91,17 @@ heap_t*
 heap_alloc (long initCapacity, long (*compare)(const void*, const void*));
 
 
+/* =============================================================================
+ * heap_setKey
+ * -- With -DHEAP_CACHED_KEY, key(dataPtr) is computed on insert and stored
+ *    next to the pointer; compare is only called when keys are equal
+ * -- key must agree with compare; call before the first insert
+ * =============================================================================
+ */
+void
+heap_setKey (heap_t* heapPtr, long (*key)(const void*));
+
+
 /* =============================================================================
  * heap_free
  * =============================================================================
@@ -0,0 +1,259 @@
+/* =============================================================================
+ *
+ * histogram.c
+ * -- Log-linear histogram of latencies, in the style of HdrHistogram
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "histogram.h"
+#include "types.h"
+
+
+#define HISTOGRAM_HALF      (1UL << (HISTOGRAM_SUB_BITS - 1))
+#define HISTOGRAM_NUM_BUCKET \
+    ((64 - HISTOGRAM_SUB_BITS + 2) * HISTOGRAM_HALF)
+
+
+struct histogram {
+    unsigned long count;
+    unsigned long max;
+    unsigned long buckets[HISTOGRAM_NUM_BUCKET];
+};
+
+
+/* =============================================================================
+ * bucketOf
+ * -- Values of the same magnitude keep their top HISTOGRAM_SUB_BITS bits
+ * =============================================================================
+ */
+static inline long
+bucketOf (unsigned long value)
+{
+    long shift;
+
+    if (value < (2 * HISTOGRAM_HALF)) {
+        return (long)value;
+    }
+    shift = (63 - __builtin_clzl(value)) - (HISTOGRAM_SUB_BITS - 1);
+
+    return (long)(shift * HISTOGRAM_HALF + (value >> shift));
+}
+
+
+/* =============================================================================
+ * highestOf
+ * -- Returns the largest value that falls in 'bucket'
+ * =============================================================================
+ */
+static inline unsigned long
+highestOf (long bucket)
+{
+    long shift;
+    unsigned long mantissa;
+
+    if ((unsigned long)bucket < (2 * HISTOGRAM_HALF)) {
+        return (unsigned long)bucket;
+    }
+    shift = (long)((unsigned long)bucket / HISTOGRAM_HALF) - 1;
+    mantissa = (unsigned long)bucket - (unsigned long)shift * HISTOGRAM_HALF;
+
+    return ((mantissa + 1) << shift) - 1;
+}
+
+
+/* =============================================================================
+ * histogram_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+histogram_t*
+histogram_alloc ()
+{
+    histogram_t* histogramPtr = (histogram_t*)calloc(1, sizeof(histogram_t));
+
+    return histogramPtr;
+}
+
+
+/* =============================================================================
+ * histogram_free
+ * =============================================================================
+ */
+void
+histogram_free (histogram_t* histogramPtr)
+{
+    free(histogramPtr);
+}
+
+
+/* =============================================================================
+ * histogram_record
+ * =============================================================================
+ */
+void
+histogram_record (histogram_t* histogramPtr, unsigned long value)
+{
+    histogramPtr->buckets[bucketOf(value)]++;
+    histogramPtr->count++;
+    if (value > histogramPtr->max) {
+        histogramPtr->max = value;
+    }
+}
+
+
+/* =============================================================================
+ * histogram_merge
+ * -- Adds the counts of 'srcPtr' to 'dstPtr'
+ * =============================================================================
+ */
+void
+histogram_merge (histogram_t* dstPtr, const histogram_t* srcPtr)
+{
+    long b;
+
+    for (b = 0; b < HISTOGRAM_NUM_BUCKET; b++) {
+        dstPtr->buckets[b] += srcPtr->buckets[b];
+    }
+    dstPtr->count += srcPtr->count;
+    if (srcPtr->max > dstPtr->max) {
+        dstPtr->max = srcPtr->max;
+    }
+}
+
+
+/* =============================================================================
+ * histogram_getCount
+ * =============================================================================
+ */
+unsigned long
+histogram_getCount (const histogram_t* histogramPtr)
+{
+    return histogramPtr->count;
+}
+
+
+/* =============================================================================
+ * histogram_getMax
+ * -- Returns the largest recorded value, exactly
+ * =============================================================================
+ */
+unsigned long
+histogram_getMax (const histogram_t* histogramPtr)
+{
+    return histogramPtr->max;
+}
+
+
+/* =============================================================================
+ * histogram_getPercentile
+ * -- Returns the largest value in the bucket holding the 'percentile'th
+ *    recorded value (0 < percentile <= 100), or 0 if nothing was recorded
+ * =============================================================================
+ */
+unsigned long
+histogram_getPercentile (const histogram_t* histogramPtr, double percentile)
+{
+    unsigned long rank;
+    unsigned long seen = 0;
+    long b;
+
+    if (histogramPtr->count == 0) {
+        return 0;
+    }
+
+    rank = (unsigned long)ceil(percentile / 100.0 * (double)histogramPtr->count);
+    if (rank < 1) {
+        rank = 1;
+    } else if (rank > histogramPtr->count) {
+        rank = histogramPtr->count;
+    }
+
+    for (b = 0; b < HISTOGRAM_NUM_BUCKET; b++) {
+        seen += histogramPtr->buckets[b];
+        if (seen >= rank) {
+            unsigned long value = highestOf(b);
+            return ((value < histogramPtr->max) ? value : histogramPtr->max);
+        }
+    }
+
+    return histogramPtr->max;
+}
+
+
+/* =============================================================================
+ * TEST_HISTOGRAM
+ * =============================================================================
+ */
+#ifdef TEST_HISTOGRAM
+
+
+#include <stdio.h>
+
+
+int
+main ()
+{
+    histogram_t* histogramPtr = histogram_alloc();
+    histogram_t* otherPtr = histogram_alloc();
+    unsigned long v;
+    long b;
+
+    assert(histogramPtr && otherPtr);
+
+    puts("Starting...");
+
+    /* Buckets are ordered and every value lands in a bucket that covers it */
+    for (b = 1; b < HISTOGRAM_NUM_BUCKET; b++) {
+        assert(highestOf(b) > highestOf(b - 1));
+        assert(bucketOf(highestOf(b)) == b);
+        assert(bucketOf(highestOf(b - 1) + 1) == b);
+    }
+    assert(bucketOf(~0UL) == (HISTOGRAM_NUM_BUCKET - 1));
+    assert(highestOf(HISTOGRAM_NUM_BUCKET - 1) == ~0UL);
+
+    assert(histogram_getPercentile(histogramPtr, 50.0) == 0);
+
+    /* 1..100000: percentiles are within 1/64 of the exact answer */
+    for (v = 1; v <= 100000; v++) {
+        histogram_record(((v % 2) ? histogramPtr : otherPtr), v);
+    }
+    histogram_merge(histogramPtr, otherPtr);
+    assert(histogram_getCount(histogramPtr) == 100000);
+    assert(histogram_getMax(histogramPtr) == 100000);
+    {
+        double percentiles[] = { 50.0, 90.0, 99.0, 99.9 };
+        long p;
+        for (p = 0; p < (long)(sizeof(percentiles) / sizeof(percentiles[0])); p++) {
+            double exact = percentiles[p] * 1000.0;
+            unsigned long value = histogram_getPercentile(histogramPtr, percentiles[p]);
+            printf("p%g = %lu\n", percentiles[p], value);
+            assert((double)value >= exact);
+            assert((double)value <= exact * (1.0 + 1.0 / 64.0));
+        }
+    }
+    assert(histogram_getPercentile(histogramPtr, 100.0) == 100000);
+
+    histogram_free(histogramPtr);
+    histogram_free(otherPtr);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_HISTOGRAM */
+
+
+/* =============================================================================
+ *
+ * End of histogram.c
+ *
+ * =============================================================================
+ */
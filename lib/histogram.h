@@ -0,0 +1,112 @@
+/* =============================================================================
+ *
+ * histogram.h
+ * -- Log-linear histogram of latencies, in the style of HdrHistogram
+ *
+ * =============================================================================
+ *
+ * Values below 2^HISTOGRAM_SUB_BITS are counted exactly. Larger values share
+ * a bucket with others of the same magnitude, 2^(HISTOGRAM_SUB_BITS-1) buckets
+ * per power of two, so a reported percentile is within 1/64 of the recorded
+ * value. Recording is a few shifts and an increment, and the whole 64-bit
+ * range fits in a fixed array, so a histogram never allocates after
+ * histogram_alloc. Histograms are not thread-safe; keep one per thread and
+ * merge them afterwards.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H 1
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define HISTOGRAM_SUB_BITS (7)
+
+
+typedef struct histogram histogram_t;
+
+
+/* =============================================================================
+ * histogram_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+histogram_t*
+histogram_alloc ();
+
+
+/* =============================================================================
+ * histogram_free
+ * =============================================================================
+ */
+void
+histogram_free (histogram_t* histogramPtr);
+
+
+/* =============================================================================
+ * histogram_record
+ * =============================================================================
+ */
+void
+histogram_record (histogram_t* histogramPtr, unsigned long value);
+
+
+/* =============================================================================
+ * histogram_merge
+ * -- Adds the counts of 'srcPtr' to 'dstPtr'
+ * =============================================================================
+ */
+void
+histogram_merge (histogram_t* dstPtr, const histogram_t* srcPtr);
+
+
+/* =============================================================================
+ * histogram_getCount
+ * =============================================================================
+ */
+unsigned long
+histogram_getCount (const histogram_t* histogramPtr);
+
+
+/* =============================================================================
+ * histogram_getMax
+ * -- Returns the largest recorded value, exactly
+ * =============================================================================
+ */
+unsigned long
+histogram_getMax (const histogram_t* histogramPtr);
+
+
+/* =============================================================================
+ * histogram_getPercentile
+ * -- Returns the largest value in the bucket holding the 'percentile'th
+ *    recorded value (0 < percentile <= 100), or 0 if nothing was recorded
+ * =============================================================================
+ */
+unsigned long
+histogram_getPercentile (const histogram_t* histogramPtr, double percentile);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* HISTOGRAM_H */
+
+
+/* =============================================================================
+ *
+ * End of histogram.h
+ *
+ * =============================================================================
+ */
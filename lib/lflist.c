@@ -0,0 +1,449 @@
+/* =============================================================================
+ *
+ * lflist.c
+ * -- Lock-free sorted singly linked list (Harris-Michael)
+ * -- Same find/insert/remove semantics as list.h, without transactions
+ * -- Options: -DLIST_NO_DUPLICATES (default: allow duplicates)
+ *
+ * =============================================================================
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include "lflist.h"
+#include "types.h"
+
+
+#define IS_MARKED(next)                 ((next) & 1)
+#define GET_NODE(next)                  ((lflist_node_t*)((next) & ~(uintptr_t)1))
+#define MARK(next)                      ((next) | 1)
+
+
+/* =============================================================================
+ * lflist_compare
+ * -- Default compare function
+ * =============================================================================
+ */
+static long
+lflist_compare (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * allocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static lflist_node_t*
+allocNode (void* dataPtr)
+{
+    lflist_node_t* nodePtr = (lflist_node_t*)malloc(sizeof(lflist_node_t));
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    nodePtr->dataPtr = dataPtr;
+    atomic_init(&nodePtr->next, (uintptr_t)NULL);
+    nodePtr->retiredNextPtr = NULL;
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * retireNode
+ * -- Called exactly once per node, by the thread whose CAS unlinked it
+ * =============================================================================
+ */
+static void
+retireNode (lflist_t* listPtr, lflist_node_t* nodePtr)
+{
+    lflist_node_t* headPtr = atomic_load_explicit(&listPtr->retiredPtr,
+                                                  memory_order_relaxed);
+    do {
+        nodePtr->retiredNextPtr = headPtr;
+    } while (!atomic_compare_exchange_weak_explicit(&listPtr->retiredPtr,
+                                                    &headPtr,
+                                                    nodePtr,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+
+/* =============================================================================
+ * freeNodes
+ * =============================================================================
+ */
+static void
+freeNodes (lflist_node_t* nodePtr, bool_t isRetired, void (*freeData)(void *))
+{
+    while (nodePtr) {
+        lflist_node_t* nextPtr = isRetired ?
+            nodePtr->retiredNextPtr :
+            GET_NODE(atomic_load_explicit(&nodePtr->next, memory_order_relaxed));
+        if (!isRetired && freeData) {
+            freeData(nodePtr->dataPtr);
+        }
+        free(nodePtr);
+        nodePtr = nextPtr;
+    }
+}
+
+
+/* =============================================================================
+ * lflist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+lflist_t*
+lflist_alloc (long (*compare)(const void*, const void*))
+{
+    lflist_t* listPtr = (lflist_t*)malloc(sizeof(lflist_t));
+    if (listPtr == NULL) {
+        return NULL;
+    }
+
+    listPtr->head.dataPtr = NULL;
+    atomic_init(&listPtr->head.next, (uintptr_t)NULL);
+    listPtr->head.retiredNextPtr = NULL;
+    listPtr->compare = (compare ? compare : lflist_compare);
+    atomic_init(&listPtr->size, 0);
+    atomic_init(&listPtr->retiredPtr, NULL);
+
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * lflist_free
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+lflist_free (lflist_t* listPtr, void (*freeData)(void *))
+{
+    lflist_clear(listPtr, freeData);
+    free(listPtr);
+}
+
+
+/* =============================================================================
+ * lflist_getSize
+ * -- Returns size of list
+ * =============================================================================
+ */
+long
+lflist_getSize (lflist_t* listPtr)
+{
+    return atomic_load_explicit(&listPtr->size, memory_order_relaxed);
+}
+
+
+/* =============================================================================
+ * search
+ * -- Returns the first unmarked node >= dataPtr (or NULL) and its predecessor
+ * -- Unlinks any marked nodes on the way
+ * =============================================================================
+ */
+static lflist_node_t*
+search (lflist_t* listPtr, void* dataPtr, lflist_node_t** prevPtrPtr)
+{
+    lflist_node_t* prevPtr;
+    lflist_node_t* currPtr;
+    uintptr_t next;
+
+retry:
+    prevPtr = &listPtr->head;
+    currPtr = GET_NODE(atomic_load_explicit(&prevPtr->next, memory_order_acquire));
+
+    while (currPtr != NULL) {
+        next = atomic_load_explicit(&currPtr->next, memory_order_acquire);
+        if (IS_MARKED(next)) {
+            uintptr_t expected = (uintptr_t)currPtr;
+            if (!atomic_compare_exchange_strong_explicit(&prevPtr->next,
+                                                         &expected,
+                                                         (uintptr_t)GET_NODE(next),
+                                                         memory_order_acq_rel,
+                                                         memory_order_acquire)) {
+                goto retry;
+            }
+            retireNode(listPtr, currPtr);
+            currPtr = GET_NODE(next);
+            continue;
+        }
+        if (listPtr->compare(currPtr->dataPtr, dataPtr) >= 0) {
+            break;
+        }
+        prevPtr = currPtr;
+        currPtr = GET_NODE(next);
+    }
+
+    *prevPtrPtr = prevPtr;
+    return currPtr;
+}
+
+
+/* =============================================================================
+ * lflist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * -- Wait-free, does not help unlink
+ * =============================================================================
+ */
+void*
+lflist_find (lflist_t* listPtr, void* dataPtr)
+{
+    lflist_node_t* currPtr =
+        GET_NODE(atomic_load_explicit(&listPtr->head.next, memory_order_acquire));
+
+    while ((currPtr != NULL) &&
+           (listPtr->compare(currPtr->dataPtr, dataPtr) < 0)) {
+        currPtr = GET_NODE(atomic_load_explicit(&currPtr->next, memory_order_acquire));
+    }
+
+    /* Skip over equal elements that are being removed */
+    while ((currPtr != NULL) &&
+           IS_MARKED(atomic_load_explicit(&currPtr->next, memory_order_acquire))) {
+        currPtr = GET_NODE(atomic_load_explicit(&currPtr->next, memory_order_acquire));
+    }
+
+    if ((currPtr == NULL) ||
+        (listPtr->compare(currPtr->dataPtr, dataPtr) != 0)) {
+        return NULL;
+    }
+
+    return currPtr->dataPtr;
+}
+
+
+/* =============================================================================
+ * lflist_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+lflist_insert (lflist_t* listPtr, void* dataPtr)
+{
+    lflist_node_t* nodePtr = NULL;
+
+    while (1) {
+        lflist_node_t* prevPtr;
+        lflist_node_t* currPtr = search(listPtr, dataPtr, &prevPtr);
+
+#ifdef LIST_NO_DUPLICATES
+        if ((currPtr != NULL) &&
+            (listPtr->compare(currPtr->dataPtr, dataPtr) == 0)) {
+            free(nodePtr);
+            return FALSE;
+        }
+#endif
+
+        if (nodePtr == NULL) {
+            nodePtr = allocNode(dataPtr);
+            if (nodePtr == NULL) {
+                return FALSE;
+            }
+        }
+
+        atomic_store_explicit(&nodePtr->next, (uintptr_t)currPtr, memory_order_relaxed);
+        uintptr_t expected = (uintptr_t)currPtr;
+        if (atomic_compare_exchange_strong_explicit(&prevPtr->next,
+                                                    &expected,
+                                                    (uintptr_t)nodePtr,
+                                                    memory_order_release,
+                                                    memory_order_relaxed)) {
+            atomic_fetch_add_explicit(&listPtr->size, 1, memory_order_relaxed);
+            return TRUE;
+        }
+    }
+}
+
+
+/* =============================================================================
+ * lflist_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+bool_t
+lflist_remove (lflist_t* listPtr, void* dataPtr)
+{
+    while (1) {
+        lflist_node_t* prevPtr;
+        lflist_node_t* currPtr = search(listPtr, dataPtr, &prevPtr);
+
+        if ((currPtr == NULL) ||
+            (listPtr->compare(currPtr->dataPtr, dataPtr) != 0)) {
+            return FALSE;
+        }
+
+        uintptr_t next = atomic_load_explicit(&currPtr->next, memory_order_acquire);
+        if (IS_MARKED(next)) {
+            continue;
+        }
+
+        /* Linearization point: logical removal */
+        if (!atomic_compare_exchange_strong_explicit(&currPtr->next,
+                                                     &next,
+                                                     MARK(next),
+                                                     memory_order_acq_rel,
+                                                     memory_order_relaxed)) {
+            continue;
+        }
+        atomic_fetch_sub_explicit(&listPtr->size, 1, memory_order_relaxed);
+
+        uintptr_t expected = (uintptr_t)currPtr;
+        if (atomic_compare_exchange_strong_explicit(&prevPtr->next,
+                                                    &expected,
+                                                    next,
+                                                    memory_order_acq_rel,
+                                                    memory_order_relaxed)) {
+            retireNode(listPtr, currPtr);
+        } else {
+            /* Let a traversal unlink it */
+            search(listPtr, dataPtr, &prevPtr);
+        }
+
+        return TRUE;
+    }
+}
+
+
+/* =============================================================================
+ * lflist_clear
+ * -- Removes all elements and frees retired nodes
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+lflist_clear (lflist_t* listPtr, void (*freeData)(void *))
+{
+    freeNodes(GET_NODE(atomic_load(&listPtr->head.next)), FALSE, freeData);
+    freeNodes(atomic_load(&listPtr->retiredPtr), TRUE, NULL);
+    atomic_store(&listPtr->head.next, (uintptr_t)NULL);
+    atomic_store(&listPtr->retiredPtr, NULL);
+    atomic_store(&listPtr->size, 0);
+}
+
+
+/* =============================================================================
+ * lflist_isSorted
+ * -- Returns TRUE if the unmarked elements are sorted and match the size
+ * -- Not thread-safe
+ * =============================================================================
+ */
+bool_t
+lflist_isSorted (lflist_t* listPtr)
+{
+    lflist_node_t* prevPtr = NULL;
+    lflist_node_t* currPtr = GET_NODE(atomic_load(&listPtr->head.next));
+    long size = 0;
+
+    for (; currPtr != NULL; currPtr = GET_NODE(atomic_load(&currPtr->next))) {
+        if (IS_MARKED(atomic_load(&currPtr->next))) {
+            continue;
+        }
+        if ((prevPtr != NULL) &&
+            (listPtr->compare(prevPtr->dataPtr, currPtr->dataPtr) > 0)) {
+            return FALSE;
+        }
+        prevPtr = currPtr;
+        size++;
+    }
+
+    return ((size == lflist_getSize(listPtr)) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * TEST_LFLIST
+ * =============================================================================
+ */
+#ifdef TEST_LFLIST
+
+
+#include <pthread.h>
+#include <stdio.h>
+
+
+#define NUM_THREAD  4
+#define NUM_KEY     256
+#define NUM_OP      100000
+
+
+static lflist_t* global_listPtr;
+
+
+static void*
+work (void* argPtr)
+{
+    unsigned long seed = (unsigned long)argPtr;
+    long i;
+
+    for (i = 0; i < NUM_OP; i++) {
+        long key;
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        key = (long)((seed >> 33) % NUM_KEY) + 1;
+        switch ((seed >> 20) % 3) {
+            case 0: lflist_insert(global_listPtr, (void*)key); break;
+            case 1: lflist_remove(global_listPtr, (void*)key); break;
+            default: lflist_find(global_listPtr, (void*)key); break;
+        }
+    }
+
+    return NULL;
+}
+
+
+int
+main ()
+{
+    pthread_t threads[NUM_THREAD];
+    long i;
+
+    puts("Starting...");
+
+    global_listPtr = lflist_alloc(NULL);
+
+    for (i = 1; i <= 8; i++) {
+        assert(lflist_insert(global_listPtr, (void*)i));
+        assert(lflist_find(global_listPtr, (void*)i) == (void*)i);
+    }
+#ifdef LIST_NO_DUPLICATES
+    assert(!lflist_insert(global_listPtr, (void*)1));
+#endif
+    for (i = 1; i <= 8; i += 2) {
+        assert(lflist_remove(global_listPtr, (void*)i));
+        assert(lflist_find(global_listPtr, (void*)i) == NULL);
+    }
+    assert(!lflist_remove(global_listPtr, (void*)1));
+    assert(lflist_isSorted(global_listPtr));
+
+    for (i = 0; i < NUM_THREAD; i++) {
+        pthread_create(&threads[i], NULL, work, (void*)(i + 1));
+    }
+    for (i = 0; i < NUM_THREAD; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    assert(lflist_isSorted(global_listPtr));
+    printf("Size = %li\n", lflist_getSize(global_listPtr));
+
+    lflist_free(global_listPtr, NULL);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_LFLIST */
+
+
+/* =============================================================================
+ *
+ * End of lflist.c
+ *
+ * =============================================================================
+ */
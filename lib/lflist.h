@@ -0,0 +1,136 @@
+/* =============================================================================
+ *
+ * lflist.h
+ * -- Lock-free sorted singly linked list (Harris-Michael)
+ * -- Same find/insert/remove semantics as list.h, without transactions
+ * -- Options: -DLIST_NO_DUPLICATES (default: allow duplicates)
+ *
+ * =============================================================================
+ *
+ * Removal first marks the low bit of the victim's next pointer, then unlinks
+ * it with a CAS on the predecessor; traversals help unlink marked nodes.
+ * Unlinked nodes are not reused: they are kept on a per-list retired stack
+ * and only freed by lflist_clear() or lflist_free(), which must be called
+ * when no other thread is accessing the list.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef LFLIST_H
+#define LFLIST_H 1
+
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct lflist_node {
+    void* dataPtr;
+    _Atomic(uintptr_t) next;                 /* low bit set -> logically removed */
+    struct lflist_node* retiredNextPtr;
+} lflist_node_t;
+
+typedef struct lflist {
+    lflist_node_t head;
+    long (*compare)(const void*, const void*);   /* returns {-1,0,1}, 0 -> equal */
+    atomic_long size;
+    _Atomic(lflist_node_t*) retiredPtr;
+} lflist_t;
+
+
+/* =============================================================================
+ * lflist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+lflist_t*
+lflist_alloc (long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * lflist_free
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+lflist_free (lflist_t* listPtr, void (*freeData)(void *));
+
+
+/* =============================================================================
+ * lflist_getSize
+ * -- Returns size of list
+ * =============================================================================
+ */
+long
+lflist_getSize (lflist_t* listPtr);
+
+
+/* =============================================================================
+ * lflist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+void*
+lflist_find (lflist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * lflist_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+lflist_insert (lflist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * lflist_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+bool_t
+lflist_remove (lflist_t* listPtr, void* dataPtr);
+
+
+/* =============================================================================
+ * lflist_clear
+ * -- Removes all elements and frees retired nodes
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+lflist_clear (lflist_t* listPtr, void (*freeData)(void *));
+
+
+/* =============================================================================
+ * lflist_isSorted
+ * -- Returns TRUE if the unmarked elements are sorted and match the size
+ * -- Not thread-safe
+ * =============================================================================
+ */
+bool_t
+lflist_isSorted (lflist_t* listPtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* LFLIST_H */
+
+
+/* =============================================================================
+ *
+ * End of lflist.h
+ *
+ * =============================================================================
+ */
@@ -77,6 +77,8 @@
 #include "types.h"
 #include "tm.h"
 
+#ifndef LIST_USE_UNROLLED
+
 #ifndef ORIGINAL
 # define TM_LOG_OP TM_LOG_OP_DECLARE
 # include "list.inc"
@@ -2475,3 +2477,5 @@ __attribute__((constructor)) void list_init() {
     # undef TM_LOG_OP
 }
 #endif /* ORIGINAL */
+
+#endif /* !LIST_USE_UNROLLED */
@@ -3,6 +3,7 @@
  * list.h
  * -- Sorted singly linked list
  * -- Options: -DLIST_NO_DUPLICATES (default: allow duplicates)
+ * -- Options: -DLIST_USE_UNROLLED (cache-line nodes, see ulist.h and ulist.c)
  *
  * =============================================================================
  *
@@ -83,6 +84,12 @@ extern "C" {
 #endif
 
 
+#ifdef LIST_USE_UNROLLED
+
+#  include "ulist.h"
+
+#else
+
 typedef struct list_node {
     void* dataPtr;
     struct list_node* nextPtr;
@@ -96,6 +103,8 @@ typedef struct list {
     long size;
 } list_t;
 
+#endif /* LIST_USE_UNROLLED */
+
 /* =============================================================================
  * list_compare
  * =============================================================================
@@ -111,53 +111,31 @@
 
 #  include "atree.h"
 
-#  define MAP_T                       jsw_atree_t
-#  define MAP_ALLOC(hash, cmp)        jsw_anew((cmp_f)cmp)
-#  define MAP_FREE(map, free)         jsw_adelete(map, free)
-#  define MAP_CONTAINS(map, key) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)key; \
-        if (jsw_afind(map, (void*)&searchPair) != NULL) { \
-            success = TRUE; \
-        } \
-        success; \
-     })
-#  define MAP_FIND(map, key) \
-    ({ \
-        void* dataPtr = NULL; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pair_t* pairPtr = (pair_t*)jsw_afind(map, (void*)&searchPair); \
-        if (pairPtr != NULL) { \
-            dataPtr = pairPtr->secondPtr; \
-        } \
-        dataPtr; \
-     })
+#  define MAP_T                       atree_t
+#  define MAP_ALLOC(hash, cmp)        atree_alloc(cmp)
+#  define MAP_FREE(map, free)         atree_free(map, free)
+
+#  define MAP_CONTAINS(map, key)      atree_contains(map, (void*)(key))
+#  define MAP_FIND(map, key)          atree_get(map, (void*)(key))
 #  define MAP_INSERT(map, key, data) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t* insertPtr = pair_alloc((void*)(key), (void*)data); \
-        if (insertPtr != NULL) { \
-            if (jsw_ainsert(map, (void*)insertPtr)) { \
-                success = TRUE; \
-            } \
-        } \
-        success; \
-     })
-#  define MAP_REMOVE(map, key) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pair_t* pairPtr = (pair_t*)jsw_afind(map, (void*)&searchPair); \
-        if (jsw_aerase(map, (void*)&searchPair)) { \
-            pair_free(pairPtr); \
-            success = TRUE; \
-        } \
-        success; \
-     })
+    atree_insert(map, (void*)(key), (void*)(data))
+#  define MAP_REMOVE(map, key)        atree_delete(map, (void*)(key))
+
+#  define HTMMAP_ALLOC(hash, cmp)     HTMATREE_ALLOC(cmp)
+#  define HTMMAP_FREE(map, free)      HTMATREE_FREE(map, free)
+#  define HTMMAP_CONTAINS(map, key)   HTMATREE_CONTAINS(map, (void*)(key))
+#  define HTMMAP_FIND(map, key)       HTMATREE_GET(map, (void*)(key))
+#  define HTMMAP_INSERT(map, key, data) \
+   HTMATREE_INSERT(map, (void*)(key), (void*)(data))
+#  define HTMMAP_REMOVE(map, key)     HTMATREE_DELETE(map, (void*)(key))
+
+#  define TMMAP_ALLOC(hash, cmp)      TMATREE_ALLOC(cmp)
+#  define TMMAP_FREE(map, free)       TMATREE_FREE(map, free)
+#  define TMMAP_CONTAINS(map, key)    TMATREE_CONTAINS(map, (void*)(key))
+#  define TMMAP_FIND(map, key)        TMATREE_GET(map, (void*)(key))
+#  define TMMAP_INSERT(map, key, data) \
+    TMATREE_INSERT(map, (void*)(key), (void*)(data))
+#  define TMMAP_REMOVE(map, key)      TMATREE_DELETE(map, (void*)(key))
 
 #elif defined(MAP_USE_AVLTREE)
 
@@ -296,6 +274,8 @@
 #  define MAP_INSERT(map, key, data) \
     rbtree_insert(map, (void*)(key), (void*)(data))
 #  define MAP_REMOVE(map, key)        rbtree_delete(map, (void*)(key))
+#  define MAP_BUILD(map, keys, vals, n) \
+    rbtree_build(map, (void**)(keys), (void**)(vals), n)
 
 #  define HTMMAP_ALLOC(hash, cmp)     HTMRBTREE_ALLOC(cmp)
 #  define HTMMAP_FREE(map, free)      HTMRBTREE_FREE(map, free)
@@ -318,56 +298,31 @@
 
 #  include "skiplist.h"
 
-#  define SKIPLIST_MAX_HEIGHT (64)
+#  define MAP_T                       skiplist_t
+#  define MAP_ALLOC(hash, cmp)        skiplist_alloc(cmp)
+#  define MAP_FREE(map, free)         skiplist_free(map, free)
 
-#  define MAP_T                       jsw_skip_t
-#  define MAP_ALLOC(hash, cmp)        jsw_snew(SKIPLIST_MAX_HEIGHT, (cmp_f)cmp)
-#  define MAP_FREE(map, free)         jsw_sdelete(map, free)
-#  define MAP_CONTAINS(map, key) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)key; \
-        if (jsw_sfind(map, (void*)&searchPair) != NULL) { \
-            success = TRUE; \
-        } \
-        success; \
-     })
-#  define MAP_FIND(map, key) \
-    ({ \
-        void* dataPtr = NULL; \
-        pair_t* pairPtr; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pairPtr = (pair_t*)jsw_sfind(map, (void*)&searchPair); \
-        if (pairPtr != NULL) { \
-            dataPtr = pairPtr->secondPtr; \
-        } \
-        dataPtr; \
-     })
+#  define MAP_CONTAINS(map, key)      skiplist_contains(map, (void*)(key))
+#  define MAP_FIND(map, key)          skiplist_get(map, (void*)(key))
 #  define MAP_INSERT(map, key, data) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t* insertPtr = pair_alloc((void*)(key), (void*)data); \
-        if (insertPtr != NULL) { \
-            if (jsw_sinsert(map, (void*)insertPtr)) { \
-                success = TRUE; \
-            } \
-        } \
-        success; \
-     })
-#  define MAP_REMOVE(map, key) \
-    ({ \
-        bool_t success = FALSE; \
-        pair_t searchPair; \
-        searchPair.firstPtr = (void*)(key); \
-        pairPtr = (pair_t*)jsw_sfind(map, (void*)&searchPair); \
-        if (jsw_serase(map, (void*)&searchPair)) { \
-            pair_free(pairPtr); \
-            success = TRUE; \
-        } \
-        success; \
-     })
+    skiplist_insert(map, (void*)(key), (void*)(data))
+#  define MAP_REMOVE(map, key)        skiplist_delete(map, (void*)(key))
+
+#  define HTMMAP_ALLOC(hash, cmp)     HTMSKIPLIST_ALLOC(cmp)
+#  define HTMMAP_FREE(map, free)      HTMSKIPLIST_FREE(map, free)
+#  define HTMMAP_CONTAINS(map, key)   HTMSKIPLIST_CONTAINS(map, (void*)(key))
+#  define HTMMAP_FIND(map, key)       HTMSKIPLIST_GET(map, (void*)(key))
+#  define HTMMAP_INSERT(map, key, data) \
+   HTMSKIPLIST_INSERT(map, (void*)(key), (void*)(data))
+#  define HTMMAP_REMOVE(map, key)     HTMSKIPLIST_DELETE(map, (void*)(key))
+
+#  define TMMAP_ALLOC(hash, cmp)      TMSKIPLIST_ALLOC(cmp)
+#  define TMMAP_FREE(map, free)       TMSKIPLIST_FREE(map, free)
+#  define TMMAP_CONTAINS(map, key)    TMSKIPLIST_CONTAINS(map, (void*)(key))
+#  define TMMAP_FIND(map, key)        TMSKIPLIST_GET(map, (void*)(key))
+#  define TMMAP_INSERT(map, key, data) \
+    TMSKIPLIST_INSERT(map, (void*)(key), (void*)(data))
+#  define TMMAP_REMOVE(map, key)      TMSKIPLIST_DELETE(map, (void*)(key))
 
 #else
 
@@ -375,6 +330,19 @@
 
 #endif
 
+/* Maps without a bulk load are filled one element at a time */
+#ifndef MAP_BUILD
+#  define MAP_BUILD(map, keys, vals, n) \
+    ({ \
+        bool_t built = TRUE; \
+        long i_; \
+        for (i_ = 0; built && i_ < (n); i_++) { \
+            built = MAP_INSERT(map, (keys)[i_], (vals)[i_]); \
+        } \
+        built; \
+     })
+#endif
+
 
 #endif /* MAP_H */
 
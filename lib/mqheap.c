@@ -0,0 +1,750 @@
+/* =============================================================================
+ *
+ * mqheap.c
+ * -- Relaxed priority queue (MultiQueue), storage layout for heap.h
+ * -- Selected with -DHEAP_USE_MULTIQUEUE, exports the same heap_* API
+ *
+ * =============================================================================
+ *
+ * The queue is an array of independent binary heaps, HEAP_MULTIQUEUE_FACTOR
+ * per thread, each on its own cache line. An insert goes to a random heap. A
+ * remove looks at the tops of two random heaps and takes the better one, so
+ * it returns an element close to, but not necessarily, the maximum. Removes
+ * and inserts by different threads usually touch different heaps and do not
+ * conflict. Only when both chosen heaps are empty does a remove scan the
+ * others, so NULL is still returned only if the whole queue is empty.
+ *
+ * The number of heaps is fixed by heap_alloc from thread_getNumThread(); with
+ * a single thread there is one heap and removal order is exact.
+ *
+ * The transactional operations are registered in mqheap.inc under the same
+ * opcodes as heap.inc, but without merge functions, so -DMERGE_HEAP has no
+ * effect here and conflicts fall back to a restart.
+ *
+ * =============================================================================
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include "heap.h"
+#include "thread.h"
+#include "tm.h"
+#include "types.h"
+
+#ifdef HEAP_USE_MULTIQUEUE
+
+#ifndef HEAP_MULTIQUEUE_FACTOR
+#  define HEAP_MULTIQUEUE_FACTOR (2)
+#endif
+
+#define MQHEAP_LINE_SIZE (64)
+
+typedef struct subheap {
+    void** elements;        /* 1-based, as in heap.c */
+    long size;
+    long capacity;
+    char pad[MQHEAP_LINE_SIZE - sizeof(void**) - 2 * sizeof(long)];
+} subheap_t;
+
+struct heap {
+    subheap_t* subheaps;
+    long numSubheap;
+    TM_PURE long (*compare)(const void*, const void*);
+};
+
+
+#define PARENT(i)       ((i) / 2)
+#define LEFT_CHILD(i)   (2*(i))
+#define RIGHT_CHILD(i)  (2*(i) + 1)
+
+
+#ifndef ORIGINAL
+# define TM_LOG_OP TM_LOG_OP_DECLARE
+# include "mqheap.inc"
+# undef TM_LOG_OP
+#endif /* ORIGINAL */
+
+
+static __thread unsigned long global_seed = 0;
+
+
+/* =============================================================================
+ * randomSubheap
+ * -- Per-thread xorshift; not rolled back on abort, which is harmless
+ * =============================================================================
+ */
+TM_PURE
+static long
+randomSubheap (long numSubheap)
+{
+    unsigned long x = global_seed;
+    if (x == 0) {
+        x = (unsigned long)&global_seed | 1;
+    }
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    global_seed = x;
+
+    return (long)(((x * 0x2545F4914F6CDD1DUL) >> 32) % numSubheap);
+}
+
+
+/* =============================================================================
+ * heap_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+heap_t*
+heap_alloc (long initCapacity, long (*compare)(const void*, const void*))
+{
+    heap_t* heapPtr = (heap_t*)malloc(sizeof(heap_t));
+    if (heapPtr == NULL) {
+        return NULL;
+    }
+
+    long numThread = thread_getNumThread();
+    long numSubheap = ((numThread > 1) ? (HEAP_MULTIQUEUE_FACTOR * numThread) : 1);
+    heapPtr->subheaps =
+        (subheap_t*)aligned_alloc(MQHEAP_LINE_SIZE, numSubheap * sizeof(subheap_t));
+    assert(heapPtr->subheaps);
+    heapPtr->numSubheap = numSubheap;
+    heapPtr->compare = compare;
+
+    long capacity = initCapacity / numSubheap + 1;
+    if (capacity < 2) {
+        capacity = 2;
+    }
+    long s;
+    for (s = 0; s < numSubheap; s++) {
+        subheap_t* subheapPtr = &heapPtr->subheaps[s];
+        subheapPtr->elements = (void**)malloc(capacity * sizeof(void*));
+        assert(subheapPtr->elements);
+        subheapPtr->size = 0;
+        subheapPtr->capacity = capacity;
+    }
+
+    return heapPtr;
+}
+
+
+/* =============================================================================
+ * heap_setKey
+ * -- Keys are not cached in this layout, so this has no effect
+ * =============================================================================
+ */
+void
+heap_setKey (heap_t* heapPtr, long (*key)(const void*))
+{
+}
+
+
+/* =============================================================================
+ * heap_free
+ * =============================================================================
+ */
+void
+heap_free (heap_t* heapPtr)
+{
+    long s;
+    for (s = 0; s < heapPtr->numSubheap; s++) {
+        free(heapPtr->subheaps[s].elements);
+    }
+    free(heapPtr->subheaps);
+    free(heapPtr);
+}
+
+
+/* =============================================================================
+ * siftUp
+ * =============================================================================
+ */
+static void
+siftUp (subheap_t* subheapPtr, long startIndex,
+        long (*compare)(const void*, const void*))
+{
+    void** elements = subheapPtr->elements;
+
+    long index = startIndex;
+    while (index > 1) {
+        long parentIndex = PARENT(index);
+        void* parentPtr = elements[parentIndex];
+        void* thisPtr   = elements[index];
+        if (compare(parentPtr, thisPtr) >= 0) {
+            break;
+        }
+        elements[parentIndex] = thisPtr;
+        elements[index] = parentPtr;
+        index = parentIndex;
+    }
+}
+
+
+/* =============================================================================
+ * HTMsiftUp
+ * =============================================================================
+ */
+static void
+HTMsiftUp (subheap_t* subheapPtr, long startIndex,
+           long (*compare)(const void*, const void*))
+{
+    void** elements = (void**)HTM_SHARED_READ_P(subheapPtr->elements);
+
+    long index = startIndex;
+    while (index > 1) {
+        long parentIndex = PARENT(index);
+        void* parentPtr = (void*)HTM_SHARED_READ_P(elements[parentIndex]);
+        void* thisPtr   = (void*)HTM_SHARED_READ_P(elements[index]);
+        if (compare(parentPtr, thisPtr) >= 0) {
+            break;
+        }
+        HTM_SHARED_WRITE_P(elements[parentIndex], thisPtr);
+        HTM_SHARED_WRITE_P(elements[index], parentPtr);
+        index = parentIndex;
+    }
+}
+
+
+/* =============================================================================
+ * TMsiftUp
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMsiftUp (TM_ARGDECL  subheap_t* subheapPtr, long startIndex,
+          TM_PURE long (*compare)(const void*, const void*))
+{
+    void** elements = (void**)TM_SHARED_READ_P(subheapPtr->elements);
+
+    long index = startIndex;
+    while (index > 1) {
+        long parentIndex = PARENT(index);
+        void* parentPtr = (void*)TM_SHARED_READ_P(elements[parentIndex]);
+        void* thisPtr   = (void*)TM_SHARED_READ_P(elements[index]);
+        if (compare(parentPtr, thisPtr) >= 0) {
+            break;
+        }
+        TM_SHARED_WRITE_P(elements[parentIndex], thisPtr);
+        TM_SHARED_WRITE_P(elements[index], parentPtr);
+        index = parentIndex;
+    }
+}
+
+
+/* =============================================================================
+ * siftDown
+ * =============================================================================
+ */
+static void
+siftDown (subheap_t* subheapPtr, long (*compare)(const void*, const void*))
+{
+    void** elements = subheapPtr->elements;
+    long size = subheapPtr->size;
+
+    long index = 1;
+    while (1) {
+        long leftIndex = LEFT_CHILD(index);
+        long rightIndex = RIGHT_CHILD(index);
+        long maxIndex = index;
+        if ((leftIndex <= size) &&
+            (compare(elements[leftIndex], elements[maxIndex]) > 0))
+        {
+            maxIndex = leftIndex;
+        }
+        if ((rightIndex <= size) &&
+            (compare(elements[rightIndex], elements[maxIndex]) > 0))
+        {
+            maxIndex = rightIndex;
+        }
+        if (maxIndex == index) {
+            break;
+        }
+        void* tmpPtr = elements[index];
+        elements[index] = elements[maxIndex];
+        elements[maxIndex] = tmpPtr;
+        index = maxIndex;
+    }
+}
+
+
+/* =============================================================================
+ * HTMsiftDown
+ * =============================================================================
+ */
+static void
+HTMsiftDown (subheap_t* subheapPtr, long (*compare)(const void*, const void*))
+{
+    void** elements = (void**)HTM_SHARED_READ_P(subheapPtr->elements);
+    long size = (long)HTM_SHARED_READ(subheapPtr->size);
+
+    long index = 1;
+    while (1) {
+        long leftIndex = LEFT_CHILD(index);
+        long rightIndex = RIGHT_CHILD(index);
+        long maxIndex = index;
+        void* maxPtr = (void*)HTM_SHARED_READ_P(elements[index]);
+        if (leftIndex <= size) {
+            void* leftPtr = (void*)HTM_SHARED_READ_P(elements[leftIndex]);
+            if (compare(leftPtr, maxPtr) > 0) {
+                maxIndex = leftIndex;
+                maxPtr = leftPtr;
+            }
+        }
+        if (rightIndex <= size) {
+            void* rightPtr = (void*)HTM_SHARED_READ_P(elements[rightIndex]);
+            if (compare(rightPtr, maxPtr) > 0) {
+                maxIndex = rightIndex;
+                maxPtr = rightPtr;
+            }
+        }
+        if (maxIndex == index) {
+            break;
+        }
+        HTM_SHARED_WRITE_P(elements[maxIndex],
+                           (void*)HTM_SHARED_READ_P(elements[index]));
+        HTM_SHARED_WRITE_P(elements[index], maxPtr);
+        index = maxIndex;
+    }
+}
+
+
+/* =============================================================================
+ * TMsiftDown
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMsiftDown (TM_ARGDECL  subheap_t* subheapPtr,
+            TM_PURE long (*compare)(const void*, const void*))
+{
+    void** elements = (void**)TM_SHARED_READ_P(subheapPtr->elements);
+    long size = (long)TM_SHARED_READ(subheapPtr->size);
+
+    long index = 1;
+    while (1) {
+        long leftIndex = LEFT_CHILD(index);
+        long rightIndex = RIGHT_CHILD(index);
+        long maxIndex = index;
+        void* maxPtr = (void*)TM_SHARED_READ_P(elements[index]);
+        if (leftIndex <= size) {
+            void* leftPtr = (void*)TM_SHARED_READ_P(elements[leftIndex]);
+            if (compare(leftPtr, maxPtr) > 0) {
+                maxIndex = leftIndex;
+                maxPtr = leftPtr;
+            }
+        }
+        if (rightIndex <= size) {
+            void* rightPtr = (void*)TM_SHARED_READ_P(elements[rightIndex]);
+            if (compare(rightPtr, maxPtr) > 0) {
+                maxIndex = rightIndex;
+                maxPtr = rightPtr;
+            }
+        }
+        if (maxIndex == index) {
+            break;
+        }
+        TM_SHARED_WRITE_P(elements[maxIndex],
+                          (void*)TM_SHARED_READ_P(elements[index]));
+        TM_SHARED_WRITE_P(elements[index], maxPtr);
+        index = maxIndex;
+    }
+}
+
+
+/* =============================================================================
+ * heap_insert
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+heap_insert (heap_t* heapPtr, void* dataPtr)
+{
+    subheap_t* subheapPtr =
+        &heapPtr->subheaps[randomSubheap(heapPtr->numSubheap)];
+    long size = subheapPtr->size;
+    long capacity = subheapPtr->capacity;
+
+    if ((size + 1) >= capacity) {
+        long newCapacity = capacity * 2;
+        void** newElements = (void**)malloc(newCapacity * sizeof(void*));
+        if (newElements == NULL) {
+            return FALSE;
+        }
+        long i;
+        for (i = 1; i <= size; i++) {
+            newElements[i] = subheapPtr->elements[i];
+        }
+        free(subheapPtr->elements);
+        subheapPtr->elements = newElements;
+        subheapPtr->capacity = newCapacity;
+    }
+
+    size++;
+    subheapPtr->size = size;
+    subheapPtr->elements[size] = dataPtr;
+    siftUp(subheapPtr, size, heapPtr->compare);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * HTMheap_insert
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+HTMheap_insert (heap_t* heapPtr, void* dataPtr)
+{
+    subheap_t* subheapPtr =
+        &heapPtr->subheaps[randomSubheap(heapPtr->numSubheap)];
+    long size = (long)HTM_SHARED_READ(subheapPtr->size);
+    long capacity = (long)HTM_SHARED_READ(subheapPtr->capacity);
+
+    if ((size + 1) >= capacity) {
+        long newCapacity = capacity * 2;
+        void** newElements = (void**)HTM_MALLOC(newCapacity * sizeof(void*));
+        if (newElements == NULL) {
+            return FALSE;
+        }
+        void** elements = (void**)HTM_SHARED_READ_P(subheapPtr->elements);
+        long i;
+        for (i = 1; i <= size; i++) {
+            newElements[i] = (void*)HTM_SHARED_READ_P(elements[i]);
+        }
+        HTM_FREE(elements);
+        HTM_SHARED_WRITE_P(subheapPtr->elements, newElements);
+        HTM_SHARED_WRITE(subheapPtr->capacity, newCapacity);
+    }
+
+    size++;
+    HTM_SHARED_WRITE(subheapPtr->size, size);
+    void** elements = (void**)HTM_SHARED_READ_P(subheapPtr->elements);
+    HTM_SHARED_WRITE_P(elements[size], dataPtr);
+    HTMsiftUp(subheapPtr, size, heapPtr->compare);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * TMheap_insert
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMheap_insert (TM_ARGDECL  heap_t* heapPtr, void* dataPtr)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(HEAP_INSERT, NULL, heapPtr, dataPtr);
+#endif /* ORIGINAL */
+
+    subheap_t* subheapPtr =
+        &heapPtr->subheaps[randomSubheap(heapPtr->numSubheap)];
+    long size = (long)TM_SHARED_READ(subheapPtr->size);
+    long capacity = (long)TM_SHARED_READ(subheapPtr->capacity);
+
+    if ((size + 1) >= capacity) {
+        long newCapacity = capacity * 2;
+        void** newElements = (void**)TM_MALLOC(newCapacity * sizeof(void*));
+        if (newElements == NULL) {
+            rv = FALSE;
+            goto out;
+        }
+        void** elements = (void**)TM_SHARED_READ_P(subheapPtr->elements);
+        long i;
+        for (i = 1; i <= size; i++) {
+            newElements[i] = (void*)TM_SHARED_READ_P(elements[i]);
+        }
+        TM_FREE(elements);
+        TM_SHARED_WRITE_P(subheapPtr->elements, newElements);
+        TM_SHARED_WRITE(subheapPtr->capacity, newCapacity);
+    }
+
+    size++;
+    TM_SHARED_WRITE(subheapPtr->size, size);
+    void** elements = (void**)TM_SHARED_READ_P(subheapPtr->elements);
+    TM_SHARED_WRITE_P(elements[size], dataPtr);
+    TMsiftUp(TM_ARG  subheapPtr, size, heapPtr->compare);
+
+    rv = TRUE;
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(HEAP_INSERT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * heap_remove
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+heap_remove (heap_t* heapPtr)
+{
+    subheap_t* subheaps = heapPtr->subheaps;
+    long numSubheap = heapPtr->numSubheap;
+    long a = randomSubheap(numSubheap);
+    long b = randomSubheap(numSubheap);
+    long sizeA = subheaps[a].size;
+    long sizeB = subheaps[b].size;
+
+    subheap_t* subheapPtr;
+    if (sizeA > 0 && sizeB > 0) {
+        long cmp = heapPtr->compare(subheaps[a].elements[1],
+                                    subheaps[b].elements[1]);
+        subheapPtr = &subheaps[(cmp >= 0) ? a : b];
+    } else if (sizeA > 0) {
+        subheapPtr = &subheaps[a];
+    } else if (sizeB > 0) {
+        subheapPtr = &subheaps[b];
+    } else {
+        long i;
+        for (i = 1; i < numSubheap; i++) {
+            if (subheaps[(a + i) % numSubheap].size > 0) {
+                break;
+            }
+        }
+        if (i == numSubheap) {
+            return NULL;
+        }
+        subheapPtr = &subheaps[(a + i) % numSubheap];
+    }
+
+    long size = subheapPtr->size;
+    void** elements = subheapPtr->elements;
+    void* dataPtr = elements[1];
+    elements[1] = elements[size];
+    subheapPtr->size = size - 1;
+    siftDown(subheapPtr, heapPtr->compare);
+
+    return dataPtr;
+}
+
+
+/* =============================================================================
+ * HTMheap_remove
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+HTMheap_remove (heap_t* heapPtr)
+{
+    subheap_t* subheaps = heapPtr->subheaps;
+    long numSubheap = heapPtr->numSubheap;
+    long a = randomSubheap(numSubheap);
+    long b = randomSubheap(numSubheap);
+    long sizeA = (long)HTM_SHARED_READ(subheaps[a].size);
+    long sizeB = (long)HTM_SHARED_READ(subheaps[b].size);
+
+    subheap_t* subheapPtr;
+    if (sizeA > 0 && sizeB > 0) {
+        void** elementsA = (void**)HTM_SHARED_READ_P(subheaps[a].elements);
+        void** elementsB = (void**)HTM_SHARED_READ_P(subheaps[b].elements);
+        long cmp = heapPtr->compare((void*)HTM_SHARED_READ_P(elementsA[1]),
+                                    (void*)HTM_SHARED_READ_P(elementsB[1]));
+        subheapPtr = &subheaps[(cmp >= 0) ? a : b];
+    } else if (sizeA > 0) {
+        subheapPtr = &subheaps[a];
+    } else if (sizeB > 0) {
+        subheapPtr = &subheaps[b];
+    } else {
+        long i;
+        for (i = 1; i < numSubheap; i++) {
+            if ((long)HTM_SHARED_READ(subheaps[(a + i) % numSubheap].size) > 0) {
+                break;
+            }
+        }
+        if (i == numSubheap) {
+            return NULL;
+        }
+        subheapPtr = &subheaps[(a + i) % numSubheap];
+    }
+
+    long size = (long)HTM_SHARED_READ(subheapPtr->size);
+    void** elements = (void**)HTM_SHARED_READ_P(subheapPtr->elements);
+    void* dataPtr = (void*)HTM_SHARED_READ_P(elements[1]);
+    HTM_SHARED_WRITE_P(elements[1], (void*)HTM_SHARED_READ_P(elements[size]));
+    HTM_SHARED_WRITE(subheapPtr->size, (size - 1));
+    HTMsiftDown(subheapPtr, heapPtr->compare);
+
+    return dataPtr;
+}
+
+
+/* =============================================================================
+ * TMheap_remove
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMheap_remove (TM_ARGDECL  heap_t* heapPtr)
+{
+    subheap_t* subheaps = heapPtr->subheaps;
+    long numSubheap = heapPtr->numSubheap;
+    long a = randomSubheap(numSubheap);
+    long b = randomSubheap(numSubheap);
+    long sizeA = (long)TM_SHARED_READ(subheaps[a].size);
+    long sizeB = (long)TM_SHARED_READ(subheaps[b].size);
+
+    subheap_t* subheapPtr;
+    if (sizeA > 0 && sizeB > 0) {
+        void** elementsA = (void**)TM_SHARED_READ_P(subheaps[a].elements);
+        void** elementsB = (void**)TM_SHARED_READ_P(subheaps[b].elements);
+        long cmp = heapPtr->compare((void*)TM_SHARED_READ_P(elementsA[1]),
+                                    (void*)TM_SHARED_READ_P(elementsB[1]));
+        subheapPtr = &subheaps[(cmp >= 0) ? a : b];
+    } else if (sizeA > 0) {
+        subheapPtr = &subheaps[a];
+    } else if (sizeB > 0) {
+        subheapPtr = &subheaps[b];
+    } else {
+        long i;
+        for (i = 1; i < numSubheap; i++) {
+            if ((long)TM_SHARED_READ(subheaps[(a + i) % numSubheap].size) > 0) {
+                break;
+            }
+        }
+        if (i == numSubheap) {
+            return NULL;
+        }
+        subheapPtr = &subheaps[(a + i) % numSubheap];
+    }
+
+    long size = (long)TM_SHARED_READ(subheapPtr->size);
+    void** elements = (void**)TM_SHARED_READ_P(subheapPtr->elements);
+    void* dataPtr = (void*)TM_SHARED_READ_P(elements[1]);
+    TM_SHARED_WRITE_P(elements[1], (void*)TM_SHARED_READ_P(elements[size]));
+    TM_SHARED_WRITE(subheapPtr->size, (size - 1));
+    TMsiftDown(TM_ARG  subheapPtr, heapPtr->compare);
+
+    return dataPtr;
+}
+
+
+/* =============================================================================
+ * heap_isValid
+ * -- Checks the heap property of every sub-heap
+ * =============================================================================
+ */
+bool_t
+heap_isValid (heap_t* heapPtr)
+{
+    long (*compare)(const void*, const void*) = heapPtr->compare;
+
+    long s;
+    for (s = 0; s < heapPtr->numSubheap; s++) {
+        subheap_t* subheapPtr = &heapPtr->subheaps[s];
+        void** elements = subheapPtr->elements;
+        long i;
+        for (i = 2; i <= subheapPtr->size; i++) {
+            if (compare(elements[i], elements[PARENT(i)]) > 0) {
+                return FALSE;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * TEST_MQHEAP
+ * =============================================================================
+ */
+#ifdef TEST_MQHEAP
+
+
+#include <stdio.h>
+
+
+#define NUM_DATA (1000)
+
+
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+long global_data[NUM_DATA];
+
+
+int
+main ()
+{
+    puts("Starting...");
+
+    long i;
+    for (i = 0; i < NUM_DATA; i++) {
+        global_data[i] = (i * 7919) % NUM_DATA;
+    }
+
+    /* One thread: a single heap, exact order */
+    heap_t* heapPtr = heap_alloc(1, compare);
+    assert(heapPtr);
+    for (i = 0; i < NUM_DATA; i++) {
+        assert(heap_insert(heapPtr, (void*)&global_data[i]));
+    }
+    assert(heap_isValid(heapPtr));
+    for (i = NUM_DATA - 1; i >= 0; i--) {
+        long* dataPtr = (long*)heap_remove(heapPtr);
+        assert(dataPtr && *dataPtr == i);
+    }
+    assert(heap_remove(heapPtr) == NULL);
+    heap_free(heapPtr);
+
+    /* Several threads: relaxed order, but nothing lost */
+    thread_startup(4);
+    heapPtr = heap_alloc(NUM_DATA, compare);
+    assert(heapPtr);
+    for (i = 0; i < NUM_DATA; i++) {
+        assert(heap_insert(heapPtr, (void*)&global_data[i]));
+    }
+    assert(heap_isValid(heapPtr));
+    long sum = 0;
+    for (i = 0; i < NUM_DATA; i++) {
+        long* dataPtr = (long*)heap_remove(heapPtr);
+        assert(dataPtr);
+        sum += *dataPtr;
+        assert(heap_isValid(heapPtr));
+    }
+    assert(sum == (long)NUM_DATA * (NUM_DATA - 1) / 2);
+    assert(heap_remove(heapPtr) == NULL);
+    heap_free(heapPtr);
+    thread_shutdown();
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_MQHEAP */
+
+
+/* =============================================================================
+ *
+ * End of mqheap.c
+ *
+ * =============================================================================
+ */
+
+#ifndef ORIGINAL
+__attribute__((constructor)) void heap_init() {
+    TM_LOG_FFI_DECLARE;
+    TM_LOG_TYPE_DECLARE_INIT(*pp[], {&ffi_type_pointer, &ffi_type_pointer});
+    # define TM_LOG_OP TM_LOG_OP_INIT
+    # include "mqheap.inc"
+    # undef TM_LOG_OP
+}
+#endif /* ORIGINAL */
+
+#endif /* HEAP_USE_MULTIQUEUE */
@@ -69,11 +69,86 @@
  */
 
 
+#include <assert.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include "mt19937ar.h"
 #include "random.h"
 #include "tm.h"
 
+#ifdef __AVX2__
+#  include <immintrin.h>
+#endif
+
+
+#define RANDOM_FILL_CHUNK (256)
+
+#if defined(RANDOM_USE_PHILOX)
+#  define PHILOX_M0     (0xD2511F53U)
+#  define PHILOX_M1     (0xCD9E8D57U)
+#  define PHILOX_W0     (0x9E3779B9U)
+#  define PHILOX_W1     (0xBB67AE85U)
+#  define PHILOX_ROUNDS (10)
+#endif
+
+
+#if !defined(RANDOM_USE_PCG) && !defined(RANDOM_USE_PHILOX)
+/* =============================================================================
+ * splitMix64
+ * -- Expands a seed into well-mixed 64-bit words
+ * =============================================================================
+ */
+static uint64_t
+splitMix64 (uint64_t* xPtr)
+{
+    uint64_t z = (*xPtr += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return (z ^ (z >> 31));
+}
+#endif /* !RANDOM_USE_PCG && !RANDOM_USE_PHILOX */
+
+
+#if defined(RANDOM_USE_PHILOX)
+/* =============================================================================
+ * philoxBlock
+ * -- Encrypts the counter into the next four outputs and advances it
+ * =============================================================================
+ */
+static void
+philoxBlock (random_t* randomPtr)
+{
+    uint32_t c0 = randomPtr->counter[0];
+    uint32_t c1 = randomPtr->counter[1];
+    uint32_t c2 = randomPtr->counter[2];
+    uint32_t c3 = randomPtr->counter[3];
+    uint32_t k0 = randomPtr->key[0];
+    uint32_t k1 = randomPtr->key[1];
+
+    long r;
+    for (r = 0; r < PHILOX_ROUNDS; r++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        c0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        c1 = (uint32_t)p1;
+        c2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c3 = (uint32_t)p0;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    randomPtr->block[0] = c0;
+    randomPtr->block[1] = c1;
+    randomPtr->block[2] = c2;
+    randomPtr->block[3] = c3;
+    randomPtr->blockIndex = 0;
+
+    if (++randomPtr->counter[0] == 0) {
+        ++randomPtr->counter[1];
+    }
+}
+#endif /* RANDOM_USE_PHILOX */
+
 
 /* =============================================================================
  * random_alloc
@@ -85,8 +160,7 @@ random_alloc (void)
 {
     random_t* randomPtr = (random_t*)malloc(sizeof(random_t));
     if (randomPtr != NULL) {
-        randomPtr->mti = N;
-        init_genrand(randomPtr->mt, &(randomPtr->mti), RANDOM_DEFAULT_SEED);
+        random_seed(randomPtr, RANDOM_DEFAULT_SEED);
     }
 
     return randomPtr;
@@ -103,8 +177,7 @@ Prandom_alloc (void)
 {
     random_t* randomPtr = (random_t*)P_MALLOC(sizeof(random_t));
     if (randomPtr != NULL) {
-        randomPtr->mti = N;
-        init_genrand(randomPtr->mt, &(randomPtr->mti), RANDOM_DEFAULT_SEED);
+        random_seed(randomPtr, RANDOM_DEFAULT_SEED);
     }
 
     return randomPtr;
@@ -140,18 +213,288 @@ Prandom_free (random_t* randomPtr)
 void
 random_seed (random_t* randomPtr, unsigned long seed)
 {
+#if defined(RANDOM_USE_XOSHIRO)
+    uint64_t x = seed;
+    long i;
+    for (i = 0; i < 4; i++) {
+        randomPtr->s[i] = splitMix64(&x);
+    }
+#elif defined(RANDOM_USE_PCG) || defined(RANDOM_USE_PHILOX)
+    random_seedStream(randomPtr, seed, 0);
+#else
+    randomPtr->mti = N;
     init_genrand(randomPtr->mt, &(randomPtr->mti), seed);
+#endif
+}
+
+
+/* =============================================================================
+ * random_seedStream
+ * -- Seeds stream 'stream' of 'seed'; use one stream per thread
+ * -- Philox streams never overlap; other generators derive a seed from both
+ * =============================================================================
+ */
+void
+random_seedStream (random_t* randomPtr, unsigned long seed, unsigned long stream)
+{
+#if defined(RANDOM_USE_PCG)
+    /* pcg32_srandom_r: the stream selects the increment */
+    randomPtr->state = 0;
+    randomPtr->inc = ((uint64_t)stream << 1) | 1;
+    random_generate(randomPtr);
+    randomPtr->state += seed;
+    random_generate(randomPtr);
+#elif defined(RANDOM_USE_PHILOX)
+    randomPtr->key[0] = (uint32_t)seed;
+    randomPtr->key[1] = (uint32_t)((uint64_t)seed >> 32);
+    randomPtr->counter[0] = 0;
+    randomPtr->counter[1] = 0;
+    randomPtr->counter[2] = (uint32_t)stream;
+    randomPtr->counter[3] = (uint32_t)((uint64_t)stream >> 32);
+    randomPtr->blockIndex = 4;
+#else
+    if (stream == 0) {
+        random_seed(randomPtr, seed);
+    } else {
+        uint64_t x = (uint64_t)seed ^ ((uint64_t)stream * 0xD1342543DE82EF95ULL);
+        random_seed(randomPtr, (unsigned long)splitMix64(&x));
+    }
+#endif
 }
 
 
 /* =============================================================================
  * random_generate
+ * -- Returns a 32-bit value
  * =============================================================================
  */
 unsigned long
 random_generate (random_t* randomPtr)
 {
+#if defined(RANDOM_USE_XOSHIRO)
+    uint64_t* s = randomPtr->s;
+    uint64_t x = s[1] * 5;
+    uint64_t result = ((x << 7) | (x >> 57)) * 9;
+    uint64_t t = s[1] << 17;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = (s[3] << 45) | (s[3] >> 19);
+    return (unsigned long)(result >> 32);
+#elif defined(RANDOM_USE_PCG)
+    uint64_t old = randomPtr->state;
+    randomPtr->state = old * 6364136223846793005ULL + randomPtr->inc;
+    uint32_t xorShifted = (uint32_t)(((old >> 18) ^ old) >> 27);
+    uint32_t rot = (uint32_t)(old >> 59);
+    return (unsigned long)((xorShifted >> rot) | (xorShifted << ((-rot) & 31)));
+#elif defined(RANDOM_USE_PHILOX)
+    if (randomPtr->blockIndex == 4) {
+        philoxBlock(randomPtr);
+    }
+    return (unsigned long)randomPtr->block[randomPtr->blockIndex++];
+#else
     return genrand_int32(randomPtr->mt, &(randomPtr->mti));
+#endif
+}
+
+
+#if defined(RANDOM_USE_PHILOX) && defined(__AVX2__)
+/* =============================================================================
+ * philoxFillVector
+ * -- Encrypts four consecutive counters per pass, one per 64-bit lane
+ * -- Produces the same sequence as philoxBlock; returns number of values filled
+ * =============================================================================
+ */
+static long
+philoxFillVector (random_t* randomPtr, unsigned long* buffer, long numPass)
+{
+    const __m256i m0 = _mm256_set1_epi64x(PHILOX_M0);
+    const __m256i m1 = _mm256_set1_epi64x(PHILOX_M1);
+    const __m256i lowMask = _mm256_set1_epi64x(0xffffffffLL);
+    const __m256i c2Init = _mm256_set1_epi64x(randomPtr->counter[2]);
+    const __m256i c3Init = _mm256_set1_epi64x(randomPtr->counter[3]);
+    uint64_t blockNum = ((uint64_t)randomPtr->counter[1] << 32) |
+                        randomPtr->counter[0];
+    long p;
+
+    for (p = 0; p < numPass; p++) {
+        __m256i c0 = _mm256_set_epi64x((uint32_t)(blockNum + 3),
+                                       (uint32_t)(blockNum + 2),
+                                       (uint32_t)(blockNum + 1),
+                                       (uint32_t)blockNum);
+        __m256i c1 = _mm256_set_epi64x((uint32_t)((blockNum + 3) >> 32),
+                                       (uint32_t)((blockNum + 2) >> 32),
+                                       (uint32_t)((blockNum + 1) >> 32),
+                                       (uint32_t)(blockNum >> 32));
+        __m256i c2 = c2Init;
+        __m256i c3 = c3Init;
+        uint32_t k0 = randomPtr->key[0];
+        uint32_t k1 = randomPtr->key[1];
+        long r;
+        for (r = 0; r < PHILOX_ROUNDS; r++) {
+            __m256i p0 = _mm256_mul_epu32(c0, m0);
+            __m256i p1 = _mm256_mul_epu32(c2, m1);
+            c0 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p1, 32), c1),
+                                  _mm256_set1_epi64x(k0));
+            c1 = _mm256_and_si256(p1, lowMask);
+            c2 = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi64(p0, 32), c3),
+                                  _mm256_set1_epi64x(k1));
+            c3 = _mm256_and_si256(p0, lowMask);
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+
+        /* Lanes hold blocks; the sequence wants each block's words in turn */
+        unsigned long words[4][4];
+        _mm256_storeu_si256((__m256i*)words[0], c0);
+        _mm256_storeu_si256((__m256i*)words[1], c1);
+        _mm256_storeu_si256((__m256i*)words[2], c2);
+        _mm256_storeu_si256((__m256i*)words[3], c3);
+        long b;
+        for (b = 0; b < 4; b++) {
+            buffer[16 * p + 4 * b + 0] = words[0][b];
+            buffer[16 * p + 4 * b + 1] = words[1][b];
+            buffer[16 * p + 4 * b + 2] = words[2][b];
+            buffer[16 * p + 4 * b + 3] = words[3][b];
+        }
+        blockNum += 4;
+    }
+
+    randomPtr->counter[0] = (uint32_t)blockNum;
+    randomPtr->counter[1] = (uint32_t)(blockNum >> 32);
+
+    return (16 * numPass);
+}
+#endif /* RANDOM_USE_PHILOX && __AVX2__ */
+
+
+/* =============================================================================
+ * fillRaw
+ * =============================================================================
+ */
+static void
+fillRaw (random_t* randomPtr, unsigned long* buffer, long n)
+{
+    long i = 0;
+
+#if defined(RANDOM_USE_PHILOX) && defined(__AVX2__)
+    /* Use up the buffered block so the vector path starts on a boundary */
+    while (i < n && randomPtr->blockIndex != 4) {
+        buffer[i++] = random_generate(randomPtr);
+    }
+    i += philoxFillVector(randomPtr, &buffer[i], (n - i) / 16);
+#endif
+    for (; i < n; i++) {
+        buffer[i] = random_generate(randomPtr);
+    }
+}
+
+
+#ifdef RANDOM_FILL_LEMIRE
+/* =============================================================================
+ * boundValue
+ * -- Lemire's multiply-shift; redraws the rare value that would bias the result
+ * =============================================================================
+ */
+static inline unsigned long
+boundValue (random_t* randomPtr, uint64_t x, uint64_t range, uint32_t threshold)
+{
+    uint64_t m = x * range;
+    while ((uint32_t)m < threshold) {
+        m = (uint64_t)random_generate(randomPtr) * range;
+    }
+    return (unsigned long)(m >> 32);
+}
+
+
+/* =============================================================================
+ * fillBounded
+ * -- Maps raw values in buffer to [0, range) in place
+ * =============================================================================
+ */
+static void
+fillBounded (random_t* randomPtr,
+             unsigned long* buffer,
+             long n,
+             unsigned long range,
+             uint32_t threshold)
+{
+    long i = 0;
+
+#ifdef __AVX2__
+    const __m256i rangeVec = _mm256_set1_epi64x(range);
+    const __m256i thresholdVec = _mm256_set1_epi64x(threshold);
+    const __m256i lowMask = _mm256_set1_epi64x(0xffffffffLL);
+    for (; i + 4 <= n; i += 4) {
+        __m256i m = _mm256_mul_epu32(_mm256_loadu_si256((__m256i*)&buffer[i]),
+                                     rangeVec);
+        __m256i reject = _mm256_cmpgt_epi64(thresholdVec,
+                                            _mm256_and_si256(m, lowMask));
+        if (!_mm256_testz_si256(reject, reject)) {
+            break;
+        }
+        _mm256_storeu_si256((__m256i*)&buffer[i], _mm256_srli_epi64(m, 32));
+    }
+    /* After a rejection, redraws must stay in order, so finish in scalar */
+#endif
+    for (; i < n; i++) {
+        buffer[i] = boundValue(randomPtr, buffer[i], range, threshold);
+    }
+}
+#else /* !RANDOM_FILL_LEMIRE */
+
+/* =============================================================================
+ * fillBounded
+ * -- Maps raw values in buffer to [0, range) in place
+ * -- Same mapping as random_generate() % range, so inputs match earlier runs
+ * =============================================================================
+ */
+static void
+fillBounded (unsigned long* buffer, long n, unsigned long range)
+{
+    long i;
+
+    for (i = 0; i < n; i++) {
+        buffer[i] %= range;
+    }
+}
+
+#endif /* !RANDOM_FILL_LEMIRE */
+
+
+/* =============================================================================
+ * random_fill
+ * -- Fills buffer with n values in [0, range), or raw 32-bit values if range is 0
+ * -- Range must be at most 2^32
+ * =============================================================================
+ */
+void
+random_fill (random_t* randomPtr, unsigned long* buffer, long n, unsigned long range)
+{
+    assert((uint64_t)range <= ((uint64_t)1 << 32));
+    if (range == 0 || (uint64_t)range == ((uint64_t)1 << 32)) {
+        fillRaw(randomPtr, buffer, n);
+        return;
+    }
+
+#ifdef RANDOM_FILL_LEMIRE
+    /* 2^32 mod range, the number of low products that must be rejected */
+    uint32_t threshold = (uint32_t)(-(uint32_t)range) % (uint32_t)range;
+#endif
+
+    /* Map each chunk while it is still in L1 */
+    long i;
+    for (i = 0; i < n; i += RANDOM_FILL_CHUNK) {
+        long m = ((n - i) < RANDOM_FILL_CHUNK) ? (n - i) : RANDOM_FILL_CHUNK;
+        fillRaw(randomPtr, &buffer[i], m);
+#ifdef RANDOM_FILL_LEMIRE
+        fillBounded(randomPtr, &buffer[i], m, range, threshold);
+#else
+        fillBounded(&buffer[i], m, range);
+#endif
+    }
 }
 
 
@@ -197,8 +540,77 @@ main ()
         assert(rand2 == rand3);
     }
 
+    /* Streams of one seed differ; the same stream repeats */
+    random_seedStream(random1Ptr, 7, 1);
+    random_seedStream(random2Ptr, 7, 2);
+    random_seedStream(random3Ptr, 7, 2);
+    for (i = 0; i < NUM_ITERATIONS; i++) {
+        unsigned long rand1 = random_generate(random1Ptr);
+        unsigned long rand2 = random_generate(random2Ptr);
+        unsigned long rand3 = random_generate(random3Ptr);
+        assert(rand1 != rand2);
+        assert(rand2 == rand3);
+        assert(rand1 <= 0xffffffffUL);
+    }
+
+    /* Known answers from the reference implementations */
+#if defined(RANDOM_USE_PCG)
+    {
+        const unsigned long expected[] = {0xa15c02b7, 0x7b47f409, 0xba1d3330};
+        random_seedStream(random1Ptr, 42, 54);
+        for (i = 0; i < 3; i++) {
+            assert(random_generate(random1Ptr) == expected[i]);
+        }
+    }
+#elif defined(RANDOM_USE_PHILOX)
+    {
+        const unsigned long expected[] = {0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8};
+        random_seedStream(random1Ptr, 0, 0);
+        for (i = 0; i < 4; i++) {
+            assert(random_generate(random1Ptr) == expected[i]);
+        }
+    }
+#endif
+
+    /* Bulk fill matches one-at-a-time generation, from any block offset */
+    {
+        unsigned long buffer[1001];
+        long counts[3] = {0, 0, 0};
+        random_seed(random1Ptr, 11);
+        random_seed(random2Ptr, 11);
+        random_generate(random1Ptr);
+        random_fill(random1Ptr, buffer, 1001, 0);
+        random_generate(random2Ptr);
+        for (i = 0; i < 1001; i++) {
+            assert(buffer[i] == random_generate(random2Ptr));
+        }
+        assert(random_generate(random1Ptr) == random_generate(random2Ptr));
+
+        random_fill(random1Ptr, buffer, 1001, 3);
+        for (i = 0; i < 1001; i++) {
+            assert(buffer[i] < 3);
+            counts[buffer[i]]++;
+        }
+        assert(counts[0] > 250 && counts[1] > 250 && counts[2] > 250);
+
+#ifndef RANDOM_FILL_LEMIRE
+        random_seed(random1Ptr, 13);
+        random_seed(random2Ptr, 13);
+        random_fill(random1Ptr, buffer, 1001, 7);
+        for (i = 0; i < 1001; i++) {
+            assert(buffer[i] == (random_generate(random2Ptr) % 7));
+        }
+#endif
+
+        random_fill(random1Ptr, buffer, 17, 1);
+        for (i = 0; i < 17; i++) {
+            assert(buffer[i] == 0);
+        }
+    }
+
     random_free(random1Ptr);
     random_free(random2Ptr);
+    random_free(random3Ptr);
 
     puts("Done.");
 
@@ -206,7 +618,7 @@ main ()
 }
 
 
-#endif /* TEST_VECTOR */
+#endif /* TEST_RANDOM */
 
 
 /* =============================================================================
@@ -73,6 +73,7 @@
 #define RANDOM_H 1
 
 
+#include <stdint.h>
 #include "mt19937ar.h"
 
 
@@ -83,10 +84,31 @@ extern "C" {
 
 #define RANDOM_DEFAULT_SEED (0)
 
+/*
+ * random_generate returns 32-bit values from MT19937 by default. Small-state
+ * generators can be selected at build time instead; they produce different
+ * sequences, so leave the default to reproduce published results:
+ *   -DRANDOM_USE_XOSHIRO   xoshiro256** (32 bytes of state)
+ *   -DRANDOM_USE_PCG       PCG32 XSH-RR (16 bytes of state)
+ *   -DRANDOM_USE_PHILOX    Philox4x32-10, counter-based (random_seedStream
+ *                          gives disjoint, reproducible per-thread streams)
+ */
 typedef struct random {
+#if defined(RANDOM_USE_XOSHIRO)
+    uint64_t s[4];
+#elif defined(RANDOM_USE_PCG)
+    uint64_t state;
+    uint64_t inc;
+#elif defined(RANDOM_USE_PHILOX)
+    uint32_t counter[4];        /* [0..1] block number, [2..3] stream */
+    uint32_t key[2];
+    uint32_t block[4];
+    long blockIndex;
+#else
     unsigned long (*rand)(unsigned long*, unsigned long*);
     unsigned long mt[N];
     unsigned long mti;
+#endif
 } random_t;
 
 
@@ -134,6 +156,16 @@ void
 random_seed (random_t* randomPtr, unsigned long seed);
 
 
+/* =============================================================================
+ * random_seedStream
+ * -- Seeds stream 'stream' of 'seed'; use one stream per thread
+ * -- Philox streams never overlap; other generators derive a seed from both
+ * =============================================================================
+ */
+void
+random_seedStream (random_t* randomPtr, unsigned long seed, unsigned long stream);
+
+
 /* =============================================================================
  * random_generate
  * =============================================================================
@@ -142,10 +174,26 @@ unsigned long
 random_generate (random_t* randomPtr);
 
 
+/* =============================================================================
+ * random_fill
+ * -- Fills buffer with n values in [0, range), or raw 32-bit values if range is 0
+ * -- Range must be at most 2^32
+ * -- Raw values are the same sequence as n calls to random_generate
+ * -- Bounded values are random_generate() % range, so a seed gives the same
+ *    inputs as before; -DRANDOM_FILL_LEMIRE maps them with Lemire's unbiased
+ *    multiply-shift instead, which changes the inputs for a given seed
+ * =============================================================================
+ */
+void
+random_fill (random_t* randomPtr, unsigned long* buffer, long n, unsigned long range);
+
+
 #define PRANDOM_ALLOC()                 Prandom_alloc()
 #define PRANDOM_FREE(r)                 Prandom_free(r)
 #define PRANDOM_SEED(r, s)              random_seed(r, s)
+#define PRANDOM_SEEDSTREAM(r, s, i)     random_seedStream(r, s, i)
 #define PRANDOM_GENERATE(r)             random_generate(r)
+#define PRANDOM_FILL(r, b, n, m)        random_fill(r, b, n, m)
 
 
 #ifdef __cplusplus
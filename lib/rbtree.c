@@ -88,6 +88,7 @@
 #include "rbtree.h"
 #include "tm.h"
 
+#ifndef RBTREE_COMPACT
 
 typedef struct node {
     void* k;
@@ -177,9 +178,11 @@ TM_CALLABLE
 static inline void
 TMsetColor (TM_ARGDECL  node_t* n, long c);
 
+#if !defined(RBTREE_RELAXED) || !defined(ORIGINAL)
 TM_CALLABLE
 static void
 TMfixAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x);
+#endif
 
 TM_CALLABLE
 static node_t*
@@ -761,6 +764,7 @@ fixAfterInsertion (rbtree_t* s, node_t* x)
 #define FIX_AFTER_INSERTION(s, x)  fixAfterInsertion(s, x)
 
 
+#ifndef RBTREE_RELAXED /* relaxed transactions repair instead */
 /* =============================================================================
  * HTMfixAfterInsertion
  * =============================================================================
@@ -821,8 +825,10 @@ HTMfixAfterInsertion (rbtree_t* s, node_t* x)
     }
 }
 #define HTX_FIX_AFTER_INSERTION(s, x)  HTMfixAfterInsertion(s, x)
+#endif /* !RBTREE_RELAXED */
 
 
+#if !defined(RBTREE_RELAXED) || !defined(ORIGINAL) /* rbtree.inc names it */
 /* =============================================================================
  * TMfixAfterInsertion
  * =============================================================================
@@ -892,6 +898,323 @@ TMfixAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x)
 #endif /* ORIGINAL */
 }
 #define TX_FIX_AFTER_INSERTION(s, x)  TMfixAfterInsertion(TM_ARG  s, x)
+#endif /* !RBTREE_RELAXED || !ORIGINAL */
+
+
+#ifdef RBTREE_RELAXED
+/*
+ * Relaxed balance: a transactional insertion only links the new RED leaf.
+ * When that creates a red-red violation, the (tree, key) pair is recorded in
+ * a per-thread buffer instead of rotating near the root inside the enclosing
+ * transaction; [TM]rbtree_rebalance() repairs the recorded violations later
+ * in a separate short transaction. Repairs look the key up again and only act
+ * if the violation is still present, so entries left behind by an aborted
+ * transaction, or by a node that has since been deleted, are harmless.
+ *
+ * Deferred violations can stack: a thread may insert below another thread's
+ * pending violation, leaving a chain of red nodes whose top pair must be fixed
+ * first, since the usual fix assumes a black grandparent. Repairs always run
+ * to completion, so every pending violation is between nodes of black height
+ * one; black heights are never affected, and a deletion fix, which only sees
+ * nodes of greater black height around a black node, never meets one.
+ */
+typedef struct pending {
+    rbtree_t* s;
+    void* k;
+} pending_t;
+
+static __thread pending_t global_pending[RBTREE_PENDING_MAX];
+static __thread long global_numPending = 0;
+
+
+/* =============================================================================
+ * deferFix
+ * -- Returns FALSE if the buffer is full and the caller must fix in place
+ * =============================================================================
+ */
+static inline bool_t
+deferFix (rbtree_t* s, void* k)
+{
+    if (global_numPending == RBTREE_PENDING_MAX) {
+        return FALSE;
+    }
+    global_pending[global_numPending].s = s;
+    global_pending[global_numPending].k = k;
+    global_numPending++;
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * fixInsertionStep
+ * -- x and its parent are red and its grandparent is not: does one step of
+ *    the insertion fix, and returns the grandparent if that step recolored it
+ *    red, else NULL
+ * =============================================================================
+ */
+static node_t*
+fixInsertionStep (rbtree_t* s, node_t* x)
+{
+    node_t* xp = PARENT_OF(x);
+    node_t* g = PARENT_OF(xp);
+    if (g == NULL) {
+        SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == LEFT_OF(g)) {
+        node_t* y = RIGHT_OF(g);
+        if (COLOR_OF(y) == RED) {
+            SET_COLOR(xp, BLACK);
+            SET_COLOR(y, BLACK);
+            SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == RIGHT_OF(xp)) {
+            ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        SET_COLOR(xp, BLACK);
+        SET_COLOR(g, RED);
+        ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = LEFT_OF(g);
+        if (COLOR_OF(y) == RED) {
+            SET_COLOR(xp, BLACK);
+            SET_COLOR(y, BLACK);
+            SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == LEFT_OF(xp)) {
+            ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        SET_COLOR(xp, BLACK);
+        SET_COLOR(g, RED);
+        ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define FIX_INSERTION_STEP(s, x)  fixInsertionStep(s, x)
+
+
+/* =============================================================================
+ * HTMfixInsertionStep
+ * =============================================================================
+ */
+static node_t*
+HTMfixInsertionStep (rbtree_t* s, node_t* x)
+{
+    node_t* xp = HTX_PARENT_OF(x);
+    node_t* g = HTX_PARENT_OF(xp);
+    if (g == NULL) {
+        HTX_SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == HTX_LEFT_OF(g)) {
+        node_t* y = HTX_RIGHT_OF(g);
+        if (HTX_COLOR_OF(y) == RED) {
+            HTX_SET_COLOR(xp, BLACK);
+            HTX_SET_COLOR(y, BLACK);
+            HTX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == HTX_RIGHT_OF(xp)) {
+            HTX_ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        HTX_SET_COLOR(xp, BLACK);
+        HTX_SET_COLOR(g, RED);
+        HTX_ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = HTX_LEFT_OF(g);
+        if (HTX_COLOR_OF(y) == RED) {
+            HTX_SET_COLOR(xp, BLACK);
+            HTX_SET_COLOR(y, BLACK);
+            HTX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == HTX_LEFT_OF(xp)) {
+            HTX_ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        HTX_SET_COLOR(xp, BLACK);
+        HTX_SET_COLOR(g, RED);
+        HTX_ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define HTX_FIX_INSERTION_STEP(s, x)  HTMfixInsertionStep(s, x)
+
+
+/* =============================================================================
+ * TMfixInsertionStep
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMfixInsertionStep (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    node_t* xp = TX_PARENT_OF(x);
+    node_t* g = TX_PARENT_OF(xp);
+    if (g == NULL) {
+        TX_SET_COLOR(xp, BLACK);
+        return NULL;
+    }
+    if (xp == TX_LEFT_OF(g)) {
+        node_t* y = TX_RIGHT_OF(g);
+        if (TX_COLOR_OF(y) == RED) {
+            TX_SET_COLOR(xp, BLACK);
+            TX_SET_COLOR(y, BLACK);
+            TX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == TX_RIGHT_OF(xp)) {
+            TX_ROTATE_LEFT(s, xp);
+            xp = x;
+        }
+        TX_SET_COLOR(xp, BLACK);
+        TX_SET_COLOR(g, RED);
+        TX_ROTATE_RIGHT(s, g);
+    } else {
+        node_t* y = TX_LEFT_OF(g);
+        if (TX_COLOR_OF(y) == RED) {
+            TX_SET_COLOR(xp, BLACK);
+            TX_SET_COLOR(y, BLACK);
+            TX_SET_COLOR(g, RED);
+            return g;
+        }
+        if (x == TX_LEFT_OF(xp)) {
+            TX_ROTATE_RIGHT(s, xp);
+            xp = x;
+        }
+        TX_SET_COLOR(xp, BLACK);
+        TX_SET_COLOR(g, RED);
+        TX_ROTATE_LEFT(s, g);
+    }
+    return NULL;
+}
+#define TX_FIX_INSERTION_STEP(s, x)  TMfixInsertionStep(TM_ARG  s, x)
+
+
+/* =============================================================================
+ * repairInsertion
+ * -- Repairs the red-red violation between x and its parent, if there is one
+ * -- Violations deferred by other threads can sit right above it, and the
+ *    insertion fix assumes a black grandparent, so each step is taken at the
+ *    topmost red pair of the chain; a step that recolors the grandparent red
+ *    repairs that new violation before going on
+ * =============================================================================
+ */
+static void
+repairInsertion (rbtree_t* s, node_t* x)
+{
+    while (COLOR_OF(x) == RED && COLOR_OF(PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (COLOR_OF(PARENT_OF(PARENT_OF(t))) == RED) {
+            t = PARENT_OF(t);
+        }
+        node_t* g = FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            repairInsertion(s, g);
+        }
+    }
+    node_t* ro = LDNODE(s, root);
+    if (COLOR_OF(ro) == RED) {
+        SET_COLOR(ro, BLACK);
+    }
+}
+#define REPAIR_INSERTION(s, x)  repairInsertion(s, x)
+
+
+/* =============================================================================
+ * HTMrepairInsertion
+ * =============================================================================
+ */
+static void
+HTMrepairInsertion (rbtree_t* s, node_t* x)
+{
+    while (HTX_COLOR_OF(x) == RED && HTX_COLOR_OF(HTX_PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (HTX_COLOR_OF(HTX_PARENT_OF(HTX_PARENT_OF(t))) == RED) {
+            t = HTX_PARENT_OF(t);
+        }
+        node_t* g = HTX_FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            HTMrepairInsertion(s, g);
+        }
+    }
+    node_t* ro = HTX_LDNODE(s, root);
+    if (HTX_COLOR_OF(ro) == RED) {
+        HTX_SET_COLOR(ro, BLACK);
+    }
+}
+#define HTX_REPAIR_INSERTION(s, x)  HTMrepairInsertion(s, x)
+
+
+/* =============================================================================
+ * TMrepairInsertion
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMrepairInsertion (TM_ARGDECL  rbtree_t* s, node_t* x)
+{
+    while (TX_COLOR_OF(x) == RED && TX_COLOR_OF(TX_PARENT_OF(x)) == RED) {
+        node_t* t = x;
+        while (TX_COLOR_OF(TX_PARENT_OF(TX_PARENT_OF(t))) == RED) {
+            t = TX_PARENT_OF(t);
+        }
+        node_t* g = TX_FIX_INSERTION_STEP(s, t);
+        if (g != NULL) {
+            TMrepairInsertion(TM_ARG  s, g);
+        }
+    }
+    node_t* ro = TX_LDNODE(s, root);
+    if (TX_COLOR_OF(ro) == RED) {
+        TX_SET_COLOR(ro, BLACK);
+    }
+}
+#define TX_REPAIR_INSERTION(s, x)  TMrepairInsertion(TM_ARG  s, x)
+
+
+/* =============================================================================
+ * HTMmarkAfterInsertion
+ * -- New node x is still private; xp is its parent
+ * =============================================================================
+ */
+static void
+HTMmarkAfterInsertion (rbtree_t* s, node_t* x, node_t* xp)
+{
+    x->c = RED;
+    if (HTX_LDF(xp, c) == RED && !deferFix(s, x->k)) {
+        HTX_REPAIR_INSERTION(s, x);
+    }
+}
+#define HTX_MARK_AFTER_INSERTION(s, x, xp)  HTMmarkAfterInsertion(s, x, xp)
+
+
+/* =============================================================================
+ * TMmarkAfterInsertion
+ * -- New node x is still private; xp is its parent
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMmarkAfterInsertion (TM_ARGDECL  rbtree_t* s, node_t* x, node_t* xp)
+{
+    x->c = RED;
+    if (TX_LDF(xp, c) == RED && !deferFix(s, x->k)) {
+        TX_REPAIR_INSERTION(s, x);
+    }
+}
+#define TX_MARK_AFTER_INSERTION(s, x, xp)  TMmarkAfterInsertion(TM_ARG  s, x, xp)
+
+#else /* !RBTREE_RELAXED */
+
+#define HTX_MARK_AFTER_INSERTION(s, x, xp)  HTX_FIX_AFTER_INSERTION(s, x)
+#define TX_MARK_AFTER_INSERTION(s, x, xp)   TX_FIX_AFTER_INSERTION(s, x)
+
+#endif /* !RBTREE_RELAXED */
 
 
 /* =============================================================================
@@ -992,7 +1315,7 @@ HTMinsert (rbtree_t* s, void* k, void* v, node_t* n)
                 n->k = k;
                 n->v = v;
                 HTX_STF_P(t, l, n);
-                HTX_FIX_AFTER_INSERTION(s, n);
+                HTX_MARK_AFTER_INSERTION(s, n, t);
                 return NULL;
             }
         } else { /* cmp > 0 */
@@ -1006,7 +1329,7 @@ HTMinsert (rbtree_t* s, void* k, void* v, node_t* n)
                 n->k = k;
                 n->v = v;
                 HTX_STF_P(t, r, n);
-                HTX_FIX_AFTER_INSERTION(s, n);
+                HTX_MARK_AFTER_INSERTION(s, n, t);
                 return NULL;
             }
         }
@@ -1053,7 +1376,7 @@ TMinsert (TM_ARGDECL  rbtree_t* s, void* k, void* v, node_t* n)
                 n->k = k;
                 n->v = v;
                 TX_STF_P(t, l, n);
-                TX_FIX_AFTER_INSERTION(s, n);
+                TX_MARK_AFTER_INSERTION(s, n, t);
                 return NULL;
             }
         } else { /* cmp > 0 */
@@ -1067,7 +1390,7 @@ TMinsert (TM_ARGDECL  rbtree_t* s, void* k, void* v, node_t* n)
                 n->k = k;
                 n->v = v;
                 TX_STF_P(t, r, n);
-                TX_FIX_AFTER_INSERTION(s, n);
+                TX_MARK_AFTER_INSERTION(s, n, t);
                 return NULL;
             }
         }
@@ -1112,6 +1435,34 @@ successor (node_t* t)
 #define SUCCESSOR(n)  successor(n)
 
 
+/* =============================================================================
+ * HTMsuccessor
+ * =============================================================================
+ */
+static node_t*
+HTMsuccessor  (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (HTX_LDNODE(t, r) != NULL) {
+        node_t* p = HTX_LDNODE(t,r);
+        while (HTX_LDNODE(p, l) != NULL) {
+            p = HTX_LDNODE(p, l);
+        }
+        return p;
+    } else {
+        node_t* p = HTX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == HTX_LDNODE(p, r)) {
+            ch = p;
+            p = HTX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define HTX_SUCCESSOR(n)  HTMsuccessor(n)
+
+
 /* =============================================================================
  * TMsuccessor
  * =============================================================================
@@ -1574,7 +1925,91 @@ firstEntry (rbtree_t* s)
 }
 
 
-#if 0
+/* =============================================================================
+ * ceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+static node_t*
+ceilingEntry (rbtree_t* s, void* k)
+{
+    node_t* p = LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, LDF(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = LDNODE(p, l);
+        } else {
+            p = LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define CEILING_ENTRY(s, k)  ceilingEntry(s, k)
+
+
+/* =============================================================================
+ * HTMceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+static node_t*
+HTMceilingEntry (rbtree_t* s, void* k)
+{
+    node_t* p = HTX_LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, HTX_LDF_P(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = HTX_LDNODE(p, l);
+        } else {
+            p = HTX_LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define HTX_CEILING_ENTRY(s, k)  HTMceilingEntry(s, k)
+
+
+/* =============================================================================
+ * TMceilingEntry
+ * -- Returns the node with the smallest key >= k, or NULL
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMceilingEntry (TM_ARGDECL  rbtree_t* s, void* k)
+{
+    node_t* p = TX_LDNODE(s, root);
+    node_t* c = NULL;
+
+    while (p != NULL) {
+        long cmp = s->compare(k, TX_LDF_P(p, k));
+        if (cmp == 0) {
+            return p;
+        }
+        if (cmp < 0) {
+            c = p;
+            p = TX_LDNODE(p, l);
+        } else {
+            p = TX_LDNODE(p, r);
+        }
+    }
+    return c;
+}
+#define TX_CEILING_ENTRY(s, k)  TMceilingEntry(TM_ARG  s, k)
+
+
 /* =============================================================================
  * predecessor
  * =============================================================================
@@ -1582,25 +2017,82 @@ firstEntry (rbtree_t* s)
 static node_t*
 predecessor (node_t* t)
 {
-    if (t == NULL)
+    if (t == NULL) {
         return NULL;
-    else if (t->l != NULL) {
-        node_t* p = t->l;
-        while (p->r != NULL) {
-            p = p->r;
+    } else if (LDNODE(t, l) != NULL) {
+        node_t* p = LDNODE(t, l);
+        while (LDNODE(p, r) != NULL) {
+            p = LDNODE(p, r);
         }
         return p;
     } else {
-        node_t* p = t->p;
+        node_t* p = LDNODE(t, p);
         node_t* ch = t;
-        while (p != NULL && ch == p->l) {
+        while (p != NULL && ch == LDNODE(p, l)) {
             ch = p;
-            p = p->p;
+            p = LDNODE(p, p);
         }
         return p;
     }
 }
-#endif
+#define PREDECESSOR(n)  predecessor(n)
+
+
+/* =============================================================================
+ * HTMpredecessor
+ * =============================================================================
+ */
+static node_t*
+HTMpredecessor (node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (HTX_LDNODE(t, l) != NULL) {
+        node_t* p = HTX_LDNODE(t, l);
+        while (HTX_LDNODE(p, r) != NULL) {
+            p = HTX_LDNODE(p, r);
+        }
+        return p;
+    } else {
+        node_t* p = HTX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == HTX_LDNODE(p, l)) {
+            ch = p;
+            p = HTX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define HTX_PREDECESSOR(n)  HTMpredecessor(n)
+
+
+/* =============================================================================
+ * TMpredecessor
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMpredecessor (TM_ARGDECL  node_t* t)
+{
+    if (t == NULL) {
+        return NULL;
+    } else if (TX_LDNODE(t, l) != NULL) {
+        node_t* p = TX_LDNODE(t, l);
+        while (TX_LDNODE(p, r) != NULL) {
+            p = TX_LDNODE(p, r);
+        }
+        return p;
+    } else {
+        node_t* p = TX_LDNODE(t, p);
+        node_t* ch = t;
+        while (p != NULL && ch == TX_LDNODE(p, l)) {
+            ch = p;
+            p = TX_LDNODE(p, p);
+        }
+        return p;
+    }
+}
+#define TX_PREDECESSOR(n)  TMpredecessor(TM_ARG  n)
 
 
 /*
@@ -2115,17 +2607,90 @@ replay:
 
 
 /* =============================================================================
- * rbtree_delete
- * -- Returns TRUE if key exists
+ * buildRange
+ * -- Links the sorted elements [lo, hi] into a subtree and returns its root
+ * -- Only nodes at 'redDepth', the bottom level of a tree that is not full,
+ *    are red, so every path has the same number of black nodes
  * =============================================================================
  */
-bool_t
-rbtree_delete (rbtree_t* r, void* key)
+static node_t*
+buildRange (void** keys, void** vals, long lo, long hi, long depth, long redDepth)
 {
-    node_t* node = NULL;
-    node = LOOKUP(r, key);
-    if (node != NULL) {
-        node = DELETE(r, node);
+    long mid = lo + (hi - lo) / 2;
+    node_t* n = getNode();
+    assert(n != NULL);
+    node_t* l = NULL;
+    node_t* r = NULL;
+
+    if (lo < mid) {
+        l = buildRange(keys, vals, lo, (mid - 1), (depth + 1), redDepth);
+    }
+    if (mid < hi) {
+        r = buildRange(keys, vals, (mid + 1), hi, (depth + 1), redDepth);
+    }
+    STF(n, k, keys[mid]);
+    STF(n, v, vals[mid]);
+    STF(n, p, NULL);
+    STF(n, l, l);
+    STF(n, r, r);
+    STF(n, c, ((depth == redDepth) ? RED : BLACK));
+    if (l != NULL) {
+        STF(l, p, n);
+    }
+    if (r != NULL) {
+        STF(r, p, n);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * rbtree_build
+ * -- Fills an empty tree from 'n' keys in strictly increasing order, in O(n)
+ * -- Returns FALSE if the tree is not empty or the keys are not sorted
+ * =============================================================================
+ */
+bool_t
+rbtree_build (rbtree_t* r, void** keys, void** vals, long n)
+{
+    long i;
+    long redDepth = 0;
+
+    if (LDNODE(r, root) != NULL) {
+        return FALSE;
+    }
+    for (i = 1; i < n; i++) {
+        if (r->compare(keys[i - 1], keys[i]) >= 0) {
+            return FALSE;
+        }
+    }
+    if (n == 0) {
+        return TRUE;
+    }
+
+    /* Number of levels that are full */
+    for (i = (n - 1); i >= 0; i = (i / 2 - 1)) {
+        redDepth++;
+    }
+    STF(r, root, buildRange(keys, vals, 0, (n - 1), 0, redDepth));
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * rbtree_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+rbtree_delete (rbtree_t* r, void* key)
+{
+    node_t* node = NULL;
+    node = LOOKUP(r, key);
+    if (node != NULL) {
+        node = DELETE(r, node);
     }
     if (node != NULL) {
         releaseNode(node);
@@ -2387,6 +2952,346 @@ rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *))
 }
 
 
+/* =============================================================================
+ * rbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+rbtree_range (rbtree_t* r, void* lo, void* hi, void (*cb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = CEILING_ENTRY(r, lo);
+
+    while (p != NULL && r->compare(LDF(p, k), hi) <= 0) {
+        if (cb)
+            cb(LDF(p, k), LDF(p, v));
+        n++;
+        p = SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * HTMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+HTMrbtree_range (rbtree_t* r, void* lo, void* hi, void (*HTMcb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = HTX_CEILING_ENTRY(r, lo);
+
+    while (p != NULL) {
+        void* k = HTX_LDF_P(p, k);
+        if (r->compare(k, hi) > 0)
+            break;
+        if (HTMcb)
+            HTMcb(k, HTX_LDF_P(p, v));
+        n++;
+        p = HTX_SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * TMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMrbtree_range (TM_ARGDECL  rbtree_t* r, void* lo, void* hi, TM_CALLABLE void (*TMcb)(void *, void *))
+{
+    long n = 0;
+    node_t* p = TX_CEILING_ENTRY(r, lo);
+
+    while (p != NULL) {
+        void* k = TX_LDF_P(p, k);
+        if (r->compare(k, hi) > 0)
+            break;
+        if (TMcb)
+            TMcb(k, TX_LDF_P(p, v));
+        n++;
+        p = TX_SUCCESSOR(p);
+    }
+
+    return n;
+}
+
+
+/* =============================================================================
+ * rbtree_iter_seek
+ * =============================================================================
+ */
+void
+rbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    *itPtr = CEILING_ENTRY(r, key);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_seek
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    HTM_LOCAL_WRITE_P(*itPtr, HTX_CEILING_ENTRY(r, key));
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_seek
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_seek (TM_ARGDECL  rbtree_iter_t* itPtr, rbtree_t* r, void* key)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_CEILING_ENTRY(r, key));
+}
+
+
+/* =============================================================================
+ * rbtree_iter_valid
+ * =============================================================================
+ */
+bool_t
+rbtree_iter_valid (rbtree_iter_t* itPtr)
+{
+    return (*itPtr != NULL);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_key
+ * =============================================================================
+ */
+void*
+rbtree_iter_key (rbtree_iter_t* itPtr)
+{
+    return LDF((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_key
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_key (rbtree_iter_t* itPtr)
+{
+    return HTX_LDF_P((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_key
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_key (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    return TX_LDF_P((node_t*)*itPtr, k);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_val
+ * =============================================================================
+ */
+void*
+rbtree_iter_val (rbtree_iter_t* itPtr)
+{
+    return LDF((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_val
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_val (rbtree_iter_t* itPtr)
+{
+    return HTX_LDF_P((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_val
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_val (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    return TX_LDF_P((node_t*)*itPtr, v);
+}
+
+
+/* =============================================================================
+ * rbtree_iter_next
+ * =============================================================================
+ */
+void
+rbtree_iter_next (rbtree_iter_t* itPtr)
+{
+    *itPtr = SUCCESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_next
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_next (rbtree_iter_t* itPtr)
+{
+    HTM_LOCAL_WRITE_P(*itPtr, HTX_SUCCESSOR((node_t*)*itPtr));
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_next
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_next (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_SUCCESSOR((node_t*)*itPtr));
+}
+
+
+/* =============================================================================
+ * rbtree_iter_prev
+ * =============================================================================
+ */
+void
+rbtree_iter_prev (rbtree_iter_t* itPtr)
+{
+    *itPtr = PREDECESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * HTMrbtree_iter_prev
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_prev (rbtree_iter_t* itPtr)
+{
+    /* The cursor is thread-local, so a plain store is enough */
+    *itPtr = HTX_PREDECESSOR((node_t*)*itPtr);
+}
+
+
+/* =============================================================================
+ * TMrbtree_iter_prev
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_prev (TM_ARGDECL  rbtree_iter_t* itPtr)
+{
+    TM_LOCAL_WRITE_P(*itPtr, TX_PREDECESSOR((node_t*)*itPtr));
+}
+
+
+#ifdef RBTREE_RELAXED
+/* =============================================================================
+ * rbtree_numPending
+ * -- Returns number of insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+long
+rbtree_numPending (void)
+{
+    return global_numPending;
+}
+
+
+/* =============================================================================
+ * rbtree_clearPending
+ * -- Call once the transaction running [HTM|TM]rbtree_rebalance has committed
+ * =============================================================================
+ */
+void
+rbtree_clearPending (void)
+{
+    global_numPending = 0;
+}
+
+
+/* =============================================================================
+ * rbtree_rebalance
+ * -- Repairs and clears the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+rbtree_rebalance (void)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = LOOKUP(s, global_pending[i].k);
+        REPAIR_INSERTION(s, x);
+    }
+    rbtree_clearPending();
+}
+
+
+/* =============================================================================
+ * HTMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+HTMrbtree_rebalance (void)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = HTX_LOOKUP(s, global_pending[i].k);
+        HTX_REPAIR_INSERTION(s, x);
+    }
+}
+
+
+/* =============================================================================
+ * TMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_rebalance (TM_ARGDECL_ALONE)
+{
+    long i;
+
+    for (i = 0; i < global_numPending; i++) {
+        rbtree_t* s = global_pending[i].s;
+        node_t* x = TX_LOOKUP(s, global_pending[i].k);
+        TX_REPAIR_INSERTION(s, x);
+    }
+}
+#endif /* RBTREE_RELAXED */
+
+
 /* /////////////////////////////////////////////////////////////////////////////
  * TEST_RBTREE
  * /////////////////////////////////////////////////////////////////////////////
@@ -2396,6 +3301,7 @@ rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *))
 
 #include <assert.h>
 #include <stdio.h>
+#include <string.h>
 
 
 static long
@@ -2405,6 +3311,116 @@ compare (const void* a, const void* b)
 }
 
 
+#ifdef RBTREE_RELAXED
+/* Each simulated client has its own deferred-fix buffer */
+typedef struct client {
+    pending_t pending[RBTREE_PENDING_MAX];
+    long numPending;
+} client_t;
+
+
+static void
+switchClient (client_t* fromPtr, client_t* toPtr)
+{
+    memcpy(fromPtr->pending, global_pending, sizeof(global_pending));
+    fromPtr->numPending = global_numPending;
+    memcpy(global_pending, toPtr->pending, sizeof(global_pending));
+    global_numPending = toPtr->numPending;
+}
+
+
+/* Returns -1 if black heights differ; red-red violations are allowed */
+static long
+blackHeight (node_t* n)
+{
+    if (n == NULL) {
+        return 1;
+    }
+    long left = blackHeight(LEFT_OF(n));
+    long right = blackHeight(RIGHT_OF(n));
+    if (left < 0 || left != right) {
+        return -1;
+    }
+    return (left + ((COLOR_OF(n) == BLACK) ? 1 : 0));
+}
+
+
+#define NUM_CLIENT (4)
+#define NUM_KEY    (512)
+
+static void
+testRelaxed ()
+{
+    client_t clients[NUM_CLIENT];
+    long current = 0;
+    long vals[NUM_KEY];
+    long i;
+
+    memset(clients, 0, sizeof(clients));
+    for (i = 0; i < NUM_KEY; i++) {
+        vals[i] = i;
+    }
+
+    /*
+     * Client 0 inserts 3 under 5 and defers; client 1 inserts 1 under 3,
+     * defers, and rebalances first, below client 0's violation
+     */
+    rbtree_t* rbtreePtr = rbtree_alloc(&compare);
+    assert(rbtree_insert(rbtreePtr, &vals[10], &vals[10]));
+    assert(rbtree_insert(rbtreePtr, &vals[5], &vals[5]));
+    assert(TMrbtree_insert(rbtreePtr, &vals[3], &vals[3]));
+    assert(rbtree_numPending() == 1);
+    switchClient(&clients[0], &clients[1]);
+    assert(TMrbtree_insert(rbtreePtr, &vals[1], &vals[1]));
+    assert(rbtree_numPending() == 1);
+    rbtree_rebalance();
+    assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    switchClient(&clients[1], &clients[0]);
+    rbtree_rebalance();
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+    rbtree_free(rbtreePtr, NULL);
+
+    /*
+     * Several clients insert, delete and rebalance in random order; an
+     * ascending burst first overflows client 0's buffer
+     */
+    memset(clients, 0, sizeof(clients));
+    rbtreePtr = rbtree_alloc(&compare);
+    for (i = 0; i < NUM_KEY; i += 2) {
+        TMrbtree_insert(rbtreePtr, &vals[i], &vals[i]);
+        assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    }
+    unsigned long seed = 1;
+    for (i = 0; i < 100000; i++) {
+        seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+        unsigned long r = seed >> 24;
+        long next = (long)(r % NUM_CLIENT);
+        long key = (long)((r / NUM_CLIENT) % NUM_KEY);
+        long op = (long)((r / (NUM_CLIENT * NUM_KEY)) % 32);
+        if (next != current) {
+            switchClient(&clients[current], &clients[next]);
+            current = next;
+        }
+        if (op < 16) {
+            TMrbtree_insert(rbtreePtr, &vals[key], &vals[key]);
+        } else if (op < 31) {
+            TMrbtree_delete(rbtreePtr, &vals[key]);
+        } else {
+            rbtree_rebalance();
+        }
+        assert(blackHeight(LDNODE(rbtreePtr, root)) > 0);
+    }
+    for (i = 0; i < NUM_CLIENT; i++) {
+        switchClient(&clients[current], &clients[i]);
+        current = i;
+        rbtree_rebalance();
+    }
+    assert(rbtree_verify(rbtreePtr, 0) > 0);
+    rbtree_free(rbtreePtr, NULL);
+}
+#endif /* RBTREE_RELAXED */
+
+
 static void
 insertInt (rbtree_t* rbtreePtr, long* data)
 {
@@ -2441,11 +3457,58 @@ main ()
         insertInt(rbtreePtr, &data[i]);
     }
 
+    long lo = 2;
+    long hi = 6;
+    assert(rbtree_range(rbtreePtr, &lo, &hi, NULL) == 5);
+
+    rbtree_iter_t it;
+    long prev = 0;
+    rbtree_iter_seek(&it, rbtreePtr, &lo);
+    for (i = 0; rbtree_iter_valid(&it); i++) {
+        long key = *(long*)rbtree_iter_key(&it);
+        assert(key >= lo && key > prev);
+        prev = key;
+        rbtree_iter_next(&it);
+    }
+    assert(i == 8);
+    rbtree_iter_seek(&it, rbtreePtr, &hi);
+    for (i = 0; rbtree_iter_valid(&it); i++) {
+        rbtree_iter_prev(&it);
+    }
+    assert(i == 6);
+
     for (i = 0; i < numData; i++) {
         removeInt(rbtreePtr, &data[i]);
     }
 
-    rbtree_free(rbtreePtr);
+    rbtree_free(rbtreePtr, NULL);
+
+    /* Bulk load, for every size up to a few full levels */
+    long sorted[64];
+    void* keys[64];
+    for (i = 0; i < 64; i++) {
+        sorted[i] = i;
+        keys[i] = &sorted[i];
+    }
+    long n;
+    for (n = 0; n <= 64; n++) {
+        rbtreePtr = rbtree_alloc(&compare);
+        assert(rbtree_build(rbtreePtr, keys, keys, n));
+        assert(rbtree_verify(rbtreePtr, 0) > 0);
+        for (i = 0; i < n; i++) {
+            assert(rbtree_get(rbtreePtr, keys[i]) == keys[i]);
+        }
+        assert(!rbtree_build(rbtreePtr, keys, keys, n) || n == 0);
+        if (n > 0) {
+            removeInt(rbtreePtr, &sorted[n / 2]);
+            insertInt(rbtreePtr, &sorted[n / 2]);
+        }
+        rbtree_free(rbtreePtr, NULL);
+    }
+
+#ifdef RBTREE_RELAXED
+    testRelaxed();
+#endif
 
     puts("Done.");
 
@@ -2798,3 +3861,5 @@ __attribute__((constructor)) void rbtree_init() {
     # undef TM_LOG_OP
 }
 #endif /* ORIGINAL */
+
+#endif /* !RBTREE_COMPACT */
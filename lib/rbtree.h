@@ -95,6 +95,27 @@ extern "C" {
 
 typedef struct rbtree rbtree_t;
 
+/*
+ * Cursor over the elements in key order; NULL once it has moved past either
+ * end. A cursor is only valid within the transaction that positioned it.
+ */
+typedef void* rbtree_iter_t;
+
+
+/*
+ * With -DRBTREE_COMPACT the tree is implemented by crbtree.c instead, using
+ * 32-byte nodes with 32-bit links allocated from per-thread slabs.
+ *
+ * With -DRBTREE_RELAXED, HTMrbtree_insert/TMrbtree_insert do not rebalance
+ * inside the caller's transaction. Insertion fixes are deferred to a
+ * per-thread buffer of RBTREE_PENDING_MAX entries (falling back to an
+ * in-place fix when it is full) and are applied by [HTM|TM]rbtree_rebalance
+ * in a separate short transaction. Deletion fixes are still done in place.
+ */
+#ifndef RBTREE_PENDING_MAX
+#  define RBTREE_PENDING_MAX (64)
+#endif
+
 
 /* =============================================================================
  * rbtree_compare
@@ -190,6 +211,16 @@ bool_t
 TMrbtree_insert (TM_ARGDECL  rbtree_t* r, void* key, void* val);
 
 
+/* =============================================================================
+ * rbtree_build
+ * -- Fills an empty tree from 'n' keys in strictly increasing order, in O(n)
+ * -- Returns FALSE if the tree is not empty or the keys are not sorted
+ * =============================================================================
+ */
+bool_t
+rbtree_build (rbtree_t* r, void** keys, void** vals, long n);
+
+
 /* =============================================================================
  * rbtree_delete
  * =============================================================================
@@ -308,6 +339,181 @@ TMrbtree_setCompare (TM_ARGDECL  rbtree_t* r, long (*compare)(const void*, const
 void
 rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *));
 
+
+/* =============================================================================
+ * rbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+rbtree_range (rbtree_t* r, void* lo, void* hi, void (*cb)(void *, void *));
+
+
+/* =============================================================================
+ * HTMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+long
+HTMrbtree_range (rbtree_t* r, void* lo, void* hi, void (*HTMcb)(void *, void *));
+
+
+/* =============================================================================
+ * TMrbtree_range
+ * -- Visits elements with lo <= key <= hi in key order
+ * -- Returns number of elements visited
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMrbtree_range (TM_ARGDECL  rbtree_t* r, void* lo, void* hi, TM_CALLABLE void (*TMcb)(void *, void *));
+
+
+/* =============================================================================
+ * rbtree_iter_seek
+ * -- Positions cursor at the smallest key >= key
+ * =============================================================================
+ */
+void
+rbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key);
+
+
+/* =============================================================================
+ * HTMrbtree_iter_seek
+ * -- Positions cursor at the smallest key >= key
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_seek (rbtree_iter_t* itPtr, rbtree_t* r, void* key);
+
+
+/* =============================================================================
+ * TMrbtree_iter_seek
+ * -- Positions cursor at the smallest key >= key
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_seek (TM_ARGDECL  rbtree_iter_t* itPtr, rbtree_t* r, void* key);
+
+
+/* =============================================================================
+ * rbtree_iter_valid
+ * -- Returns FALSE if cursor has moved past either end
+ * =============================================================================
+ */
+bool_t
+rbtree_iter_valid (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * rbtree_iter_key
+ * =============================================================================
+ */
+void*
+rbtree_iter_key (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * HTMrbtree_iter_key
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_key (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * TMrbtree_iter_key
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_key (TM_ARGDECL  rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * rbtree_iter_val
+ * =============================================================================
+ */
+void*
+rbtree_iter_val (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * HTMrbtree_iter_val
+ * =============================================================================
+ */
+void*
+HTMrbtree_iter_val (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * TMrbtree_iter_val
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMrbtree_iter_val (TM_ARGDECL  rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * rbtree_iter_next
+ * -- Moves cursor to the next larger key
+ * =============================================================================
+ */
+void
+rbtree_iter_next (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * HTMrbtree_iter_next
+ * -- Moves cursor to the next larger key
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_next (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * TMrbtree_iter_next
+ * -- Moves cursor to the next larger key
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_next (TM_ARGDECL  rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * rbtree_iter_prev
+ * -- Moves cursor to the next smaller key
+ * =============================================================================
+ */
+void
+rbtree_iter_prev (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * HTMrbtree_iter_prev
+ * -- Moves cursor to the next smaller key
+ * =============================================================================
+ */
+void
+HTMrbtree_iter_prev (rbtree_iter_t* itPtr);
+
+
+/* =============================================================================
+ * TMrbtree_iter_prev
+ * -- Moves cursor to the next smaller key
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_iter_prev (TM_ARGDECL  rbtree_iter_t* itPtr);
+
+
 #define HTMRBTREE_ALLOC(cmp)      HTMrbtree_alloc(cmp)
 #define HTMRBTREE_FREE(r, free)   HTMrbtree_free(r, free)
 #define HTMRBTREE_INSERT(r, k, v) HTMrbtree_insert(r, (void*)(k), (void*)(v))
@@ -315,6 +521,14 @@ rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *));
 #define HTMRBTREE_UPDATE(r, k, v) HTMrbtree_update(r, (void*)(k), (void*)(v))
 #define HTMRBTREE_GET(r, k)       HTMrbtree_get(r, (void*)(k))
 #define HTMRBTREE_CONTAINS(r, k)  HTMrbtree_contains(r, (void*)(k))
+#define HTMRBTREE_RANGE(r, lo, hi, cb) \
+    HTMrbtree_range(r, (void*)(lo), (void*)(hi), cb)
+#define HTMRBTREE_ITER_SEEK(it, r, k)  HTMrbtree_iter_seek(it, r, (void*)(k))
+#define HTMRBTREE_ITER_VALID(it)       rbtree_iter_valid(it)
+#define HTMRBTREE_ITER_KEY(it)         HTMrbtree_iter_key(it)
+#define HTMRBTREE_ITER_VAL(it)         HTMrbtree_iter_val(it)
+#define HTMRBTREE_ITER_NEXT(it)        HTMrbtree_iter_next(it)
+#define HTMRBTREE_ITER_PREV(it)        HTMrbtree_iter_prev(it)
 
 #define TMRBTREE_ALLOC(cmp)       TMrbtree_alloc(TM_ARG  cmp)
 #define TMRBTREE_FREE(r, free)    TMrbtree_free(TM_ARG  r, free)
@@ -323,6 +537,65 @@ rbtree_iterate (rbtree_t* r, void (*cb)(void *, void *));
 #define TMRBTREE_UPDATE(r, k, v)  TMrbtree_update(TM_ARG  r, (void*)(k), (void*)(v))
 #define TMRBTREE_GET(r, k)        TMrbtree_get(TM_ARG  r, (void*)(k))
 #define TMRBTREE_CONTAINS(r, k)   TMrbtree_contains(TM_ARG  r, (void*)(k))
+#define TMRBTREE_RANGE(r, lo, hi, cb) \
+    TMrbtree_range(TM_ARG  r, (void*)(lo), (void*)(hi), cb)
+#define TMRBTREE_ITER_SEEK(it, r, k)   TMrbtree_iter_seek(TM_ARG  it, r, (void*)(k))
+#define TMRBTREE_ITER_VALID(it)        rbtree_iter_valid(it)
+#define TMRBTREE_ITER_KEY(it)          TMrbtree_iter_key(TM_ARG  it)
+#define TMRBTREE_ITER_VAL(it)          TMrbtree_iter_val(TM_ARG  it)
+#define TMRBTREE_ITER_NEXT(it)         TMrbtree_iter_next(TM_ARG  it)
+#define TMRBTREE_ITER_PREV(it)         TMrbtree_iter_prev(TM_ARG  it)
+
+
+#ifdef RBTREE_RELAXED
+/* =============================================================================
+ * rbtree_numPending
+ * -- Returns number of insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+long
+rbtree_numPending (void);
+
+
+/* =============================================================================
+ * rbtree_clearPending
+ * -- Call once the transaction running [HTM|TM]rbtree_rebalance has committed
+ * =============================================================================
+ */
+void
+rbtree_clearPending (void);
+
+
+/* =============================================================================
+ * rbtree_rebalance
+ * -- Repairs and clears the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+rbtree_rebalance (void);
+
+
+/* =============================================================================
+ * HTMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+void
+HTMrbtree_rebalance (void);
+
+
+/* =============================================================================
+ * TMrbtree_rebalance
+ * -- Repairs the insertion fixes deferred by the calling thread
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMrbtree_rebalance (TM_ARGDECL_ALONE);
+
+#define HTMRBTREE_REBALANCE()     HTMrbtree_rebalance()
+#define TMRBTREE_REBALANCE()      TMrbtree_rebalance(TM_ARG_ALONE)
+#endif /* RBTREE_RELAXED */
 
 
 #ifdef __cplusplus
@@ -0,0 +1,937 @@
+/* =============================================================================
+ *
+ * redolog.c
+ * -- Checkpoint and per-thread redo logs with group commit, in plain files
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "redolog.h"
+#include "thread.h"
+#include "tm.h"
+#include "types.h"
+
+
+/*
+ * Each file is mapped once with a window this large and grown underneath it
+ * with ftruncate, so a mapping never moves and the flusher can msync a range
+ * while its writer appends.
+ */
+#ifndef REDOLOG_MAP_SIZE
+#  define REDOLOG_MAP_SIZE      (1L << 36)
+#endif
+#define REDOLOG_INITIAL_SIZE    (1L << 20)
+#define REDOLOG_MAGIC           (0x676f6c6f646572L) /* "redolog" */
+#define REDOLOG_ALIGN(size)     (((size) + 7L) & ~7L)
+
+
+typedef struct header {
+    uint32_t size;          /* of the payload; 0 marks the end of a log */
+    uint32_t checksum;      /* of the epoch and the payload */
+    int64_t epoch;
+} header_t;
+
+typedef struct file {
+    int fd;
+    char* base;
+    long size;              /* of the file, not the mapping */
+    long tail;              /* end of the last record */
+} file_t;
+
+typedef struct writer {
+    file_t file;
+    long active;            /* lowest epoch it may still commit in */
+    long written;           /* tail as published to the flusher */
+    long synced;            /* flusher only */
+    long numRecord;
+    long numByte;
+} __attribute__((aligned(64))) writer_t;
+
+typedef struct state {
+    long magic;
+    long durable;
+} state_t;
+
+struct redolog {
+    long epoch __attribute__((aligned(64)));
+    long durable __attribute__((aligned(64)));
+    char* dirName;
+    long intervalUs;
+    long checkpointEpoch;
+    int stateFd;
+    long numWriter;
+    writer_t* writers;
+    file_t dumpFile;
+    THREAD_MUTEX_T lock;
+    THREAD_COND_T cond;
+    bool_t flushing;
+    long numFlush;
+    struct timespec lastFlush;
+};
+
+
+/* =============================================================================
+ * fail
+ * -- A commit that cannot be made durable must not look like one that was
+ * =============================================================================
+ */
+static void
+fail (const char* what)
+{
+    fprintf(stderr, "redolog: %s: %s\n", what, strerror(errno));
+    exit(1);
+}
+
+
+/* =============================================================================
+ * makePath
+ * =============================================================================
+ */
+static void
+makePath (redolog_t* logPtr, char* path, const char* name, long index)
+{
+    if (index < 0) {
+        snprintf(path, PATH_MAX, "%s/%s", logPtr->dirName, name);
+    } else {
+        snprintf(path, PATH_MAX, "%s/%s.%ld", logPtr->dirName, name, index);
+    }
+}
+
+
+/* =============================================================================
+ * checksum
+ * -- FNV-1a
+ * =============================================================================
+ */
+static uint32_t
+checksum (int64_t epoch, const void* dataPtr, long size)
+{
+    const unsigned char* bytes = (const unsigned char*)&epoch;
+    uint32_t hash = 2166136261U;
+    long i;
+
+    for (i = 0; i < (long)sizeof(epoch); i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+    bytes = (const unsigned char*)dataPtr;
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619U;
+    }
+
+    return hash;
+}
+
+
+/* =============================================================================
+ * syncDir
+ * -- Makes creates, renames, and unlinks in the directory durable
+ * =============================================================================
+ */
+static bool_t
+syncDir (redolog_t* logPtr)
+{
+    int fd = open(logPtr->dirName, O_RDONLY | O_DIRECTORY);
+    bool_t status;
+
+    if (fd < 0) {
+        return FALSE;
+    }
+    status = (fsync(fd) == 0);
+    close(fd);
+
+    return status;
+}
+
+
+/* =============================================================================
+ * writeState
+ * =============================================================================
+ */
+static bool_t
+writeState (redolog_t* logPtr, long durable)
+{
+    state_t state;
+
+    state.magic = REDOLOG_MAGIC;
+    state.durable = durable;
+
+    return (pwrite(logPtr->stateFd, &state, sizeof(state), 0) ==
+                (ssize_t)sizeof(state) &&
+            fdatasync(logPtr->stateFd) == 0);
+}
+
+
+/* =============================================================================
+ * fileCreate
+ * =============================================================================
+ */
+static bool_t
+fileCreate (file_t* filePtr, const char* path)
+{
+    filePtr->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (filePtr->fd < 0) {
+        return FALSE;
+    }
+    if (ftruncate(filePtr->fd, REDOLOG_INITIAL_SIZE) != 0) {
+        close(filePtr->fd);
+        return FALSE;
+    }
+    filePtr->base = (char*)mmap(NULL, REDOLOG_MAP_SIZE, PROT_READ | PROT_WRITE,
+                                MAP_SHARED, filePtr->fd, 0);
+    if (filePtr->base == MAP_FAILED) {
+        close(filePtr->fd);
+        return FALSE;
+    }
+    filePtr->size = REDOLOG_INITIAL_SIZE;
+    filePtr->tail = 0;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * fileClose
+ * =============================================================================
+ */
+static void
+fileClose (file_t* filePtr)
+{
+    munmap(filePtr->base, REDOLOG_MAP_SIZE);
+    close(filePtr->fd);
+}
+
+
+/* =============================================================================
+ * fileAppend
+ * -- The file past the tail is zero, so the next header reads as the end
+ * =============================================================================
+ */
+static bool_t
+fileAppend (file_t* filePtr, long epoch, const void* dataPtr, long size)
+{
+    long recordSize = (long)sizeof(header_t) + REDOLOG_ALIGN(size);
+    header_t header;
+
+    assert(size > 0 && size <= (long)UINT32_MAX);
+
+    if (filePtr->tail + recordSize + (long)sizeof(header_t) > filePtr->size) {
+        long newSize = filePtr->size;
+        while (filePtr->tail + recordSize + (long)sizeof(header_t) > newSize) {
+            newSize *= 2;
+        }
+        if (newSize > REDOLOG_MAP_SIZE || ftruncate(filePtr->fd, newSize) != 0) {
+            return FALSE;
+        }
+        filePtr->size = newSize;
+    }
+
+    header.size = (uint32_t)size;
+    header.checksum = checksum(epoch, dataPtr, size);
+    header.epoch = epoch;
+    memcpy(filePtr->base + filePtr->tail + sizeof(header_t), dataPtr, size);
+    memcpy(filePtr->base + filePtr->tail, &header, sizeof(header_t));
+    filePtr->tail += recordSize;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * fileReplay
+ * -- Passes records after the first 'numSkip' with minEpoch < epoch <=
+ *    maxEpoch to applyFn, as 'asEpoch' if that is not negative
+ * -- Stops at the end of the log or at the first torn record
+ * -- Returns the number of records applied, 0 for a missing file, or -1
+ * =============================================================================
+ */
+static long
+fileReplay (const char* path, long numSkip, long minEpoch, long maxEpoch,
+            long asEpoch,
+            void (*applyFn)(void*, long, const void*, long), void* argPtr)
+{
+    struct stat st;
+    char* base;
+    long offset = 0;
+    long numApplied = 0;
+    long numRecord = 0;
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0) {
+        return ((errno == ENOENT) ? 0 : -1);
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    if (st.st_size == 0) {
+        close(fd);
+        return 0;
+    }
+    base = (char*)mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        return -1;
+    }
+
+    while (offset + (long)sizeof(header_t) <= (long)st.st_size) {
+        header_t header;
+        const char* dataPtr = base + offset + sizeof(header_t);
+        memcpy(&header, base + offset, sizeof(header_t));
+        if (header.size == 0 ||
+            (offset + (long)sizeof(header_t) + REDOLOG_ALIGN((long)header.size) >
+             (long)st.st_size) ||
+            header.checksum != checksum(header.epoch, dataPtr, header.size))
+        {
+            break;
+        }
+        if (numRecord++ >= numSkip &&
+            header.epoch > minEpoch && header.epoch <= maxEpoch)
+        {
+            applyFn(argPtr, ((asEpoch < 0) ? (long)header.epoch : asEpoch),
+                    dataPtr, (long)header.size);
+            numApplied++;
+        }
+        offset += (long)sizeof(header_t) + REDOLOG_ALIGN((long)header.size);
+    }
+
+    munmap(base, st.st_size);
+
+    return numApplied;
+}
+
+
+/* =============================================================================
+ * readCheckpointEpoch
+ * -- A checkpoint starts with a record holding the magic number, in the
+ *    epoch that the checkpoint covers
+ * -- Returns -1 if there is no valid checkpoint
+ * =============================================================================
+ */
+static long
+readCheckpointEpoch (redolog_t* logPtr)
+{
+    char path[PATH_MAX];
+    header_t header;
+    long magic;
+    int fd;
+    bool_t status;
+
+    makePath(logPtr, path, "checkpoint", -1);
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    status = (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+              header.size == sizeof(magic) &&
+              pread(fd, &magic, sizeof(magic), sizeof(header)) ==
+                  (ssize_t)sizeof(magic) &&
+              magic == REDOLOG_MAGIC &&
+              header.checksum == checksum(header.epoch, &magic, sizeof(magic)));
+    close(fd);
+
+    return (status ? (long)header.epoch : -1);
+}
+
+
+/* =============================================================================
+ * redolog_open
+ * -- Creates 'dirName' if needed; 'intervalUs' is the group commit interval
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+redolog_t*
+redolog_open (const char* dirName, long intervalUs)
+{
+    char path[PATH_MAX];
+    redolog_t* logPtr;
+    state_t state;
+    long last;
+
+    if (mkdir(dirName, 0755) != 0 && errno != EEXIST) {
+        return NULL;
+    }
+
+    logPtr = (redolog_t*)aligned_alloc(64, sizeof(redolog_t));
+    if (logPtr == NULL) {
+        return NULL;
+    }
+    memset(logPtr, 0, sizeof(redolog_t));
+    logPtr->dirName = strdup(dirName);
+    if (logPtr->dirName == NULL) {
+        free(logPtr);
+        return NULL;
+    }
+    logPtr->intervalUs = intervalUs;
+
+    makePath(logPtr, path, "state", -1);
+    logPtr->stateFd = open(path, O_RDWR | O_CREAT, 0644);
+    if (logPtr->stateFd < 0) {
+        free(logPtr->dirName);
+        free(logPtr);
+        return NULL;
+    }
+    if (pread(logPtr->stateFd, &state, sizeof(state), 0) != (ssize_t)sizeof(state) ||
+        state.magic != REDOLOG_MAGIC)
+    {
+        state.durable = 0;
+    }
+
+    /*
+     * Epochs keep growing across checkpoints, so logs that a crash left
+     * behind a newer checkpoint are recognized as covered by it.
+     */
+    logPtr->checkpointEpoch = readCheckpointEpoch(logPtr);
+    last = ((state.durable > logPtr->checkpointEpoch) ?
+            state.durable : logPtr->checkpointEpoch);
+    if (last < 0) {
+        last = 0;
+    }
+    logPtr->durable = last;
+    logPtr->epoch = last + 1;
+
+    THREAD_MUTEX_INIT(logPtr->lock);
+    THREAD_COND_INIT(logPtr->cond);
+    clock_gettime(CLOCK_MONOTONIC, &logPtr->lastFlush);
+
+    return logPtr;
+}
+
+
+/* =============================================================================
+ * redolog_close
+ * -- Leaves the files in place
+ * =============================================================================
+ */
+void
+redolog_close (redolog_t* logPtr)
+{
+    long w;
+
+    for (w = 0; w < logPtr->numWriter; w++) {
+        fileClose(&logPtr->writers[w].file);
+    }
+    free(logPtr->writers);
+    close(logPtr->stateFd);
+    free(logPtr->dirName);
+    free(logPtr);
+}
+
+
+/* =============================================================================
+ * redolog_hasCheckpoint
+ * =============================================================================
+ */
+bool_t
+redolog_hasCheckpoint (redolog_t* logPtr)
+{
+    return (logPtr->checkpointEpoch >= 0);
+}
+
+
+/* =============================================================================
+ * redolog_replay
+ * -- Calls applyFn for every checkpoint record (with epoch 0) and then for
+ *    every durable log record, in log order; records of different writers in
+ *    the same epoch are not ordered with respect to each other
+ * -- Returns the number of log records applied, or -1 on failure
+ * =============================================================================
+ */
+long
+redolog_replay (redolog_t* logPtr,
+                void (*applyFn)(void* argPtr, long epoch,
+                                const void* dataPtr, long size),
+                void* argPtr)
+{
+    char path[PATH_MAX];
+    long numApplied = 0;
+    long w;
+
+    if (logPtr->checkpointEpoch >= 0) {
+        makePath(logPtr, path, "checkpoint", -1);
+        if (fileReplay(path, 1, LONG_MIN, LONG_MAX, 0, applyFn, argPtr) < 0) {
+            return -1;
+        }
+    }
+
+    for (w = 0; ; w++) {
+        long numRecord;
+        makePath(logPtr, path, "log", w);
+        if (access(path, F_OK) != 0) {
+            break;
+        }
+        numRecord = fileReplay(path, 0, logPtr->checkpointEpoch, logPtr->durable,
+                               -1, applyFn, argPtr);
+        if (numRecord < 0) {
+            return -1;
+        }
+        numApplied += numRecord;
+    }
+
+    return numApplied;
+}
+
+
+/* =============================================================================
+ * redolog_checkpoint
+ * -- dumpFn writes the whole state with redolog_dump; the new checkpoint
+ *    replaces the old one and the logs atomically
+ * -- Only while no writer is running
+ * -- Returns FALSE on failure, leaving the previous checkpoint in place
+ * =============================================================================
+ */
+bool_t
+redolog_checkpoint (redolog_t* logPtr,
+                    bool_t (*dumpFn)(void* argPtr, redolog_t* logPtr),
+                    void* argPtr)
+{
+    char tmpPath[PATH_MAX];
+    char path[PATH_MAX];
+    long covered = logPtr->epoch;
+    long magic = REDOLOG_MAGIC;
+    file_t* filePtr = &logPtr->dumpFile;
+    bool_t status;
+    long w;
+
+    makePath(logPtr, tmpPath, "checkpoint.tmp", -1);
+    if (!fileCreate(filePtr, tmpPath)) {
+        return FALSE;
+    }
+
+    /* Whatever was committed so far, durable or not, is in the dump */
+    status = (fileAppend(filePtr, covered, &magic, sizeof(magic)) &&
+              dumpFn(argPtr, logPtr) &&
+              msync(filePtr->base, filePtr->tail, MS_SYNC) == 0 &&
+              ftruncate(filePtr->fd, filePtr->tail + sizeof(header_t)) == 0 &&
+              fdatasync(filePtr->fd) == 0);
+    fileClose(filePtr);
+    makePath(logPtr, path, "checkpoint", -1);
+    if (!status || rename(tmpPath, path) != 0 || !syncDir(logPtr)) {
+        unlink(tmpPath);
+        return FALSE;
+    }
+
+    for (w = 0; ; w++) {
+        makePath(logPtr, path, "log", w);
+        if (unlink(path) != 0) {
+            break;
+        }
+    }
+    if (!syncDir(logPtr) || !writeState(logPtr, covered)) {
+        return FALSE;
+    }
+
+    logPtr->checkpointEpoch = covered;
+    logPtr->durable = covered;
+    logPtr->epoch = covered + 1;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * redolog_dump
+ * -- Appends a checkpoint record; only from within dumpFn
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+redolog_dump (redolog_t* logPtr, const void* dataPtr, long size)
+{
+    return fileAppend(&logPtr->dumpFile, logPtr->epoch, dataPtr, size);
+}
+
+
+/* =============================================================================
+ * redolog_start
+ * -- Creates empty logs for writers 0 to numWriter - 1
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+redolog_start (redolog_t* logPtr, long numWriter)
+{
+    char path[PATH_MAX];
+    long w;
+
+    assert(logPtr->writers == NULL);
+    logPtr->writers =
+        (writer_t*)aligned_alloc(64, numWriter * sizeof(writer_t));
+    if (logPtr->writers == NULL) {
+        return FALSE;
+    }
+    memset(logPtr->writers, 0, numWriter * sizeof(writer_t));
+
+    for (w = 0; w < numWriter; w++) {
+        writer_t* writerPtr = &logPtr->writers[w];
+        makePath(logPtr, path, "log", w);
+        if (!fileCreate(&writerPtr->file, path)) {
+            while (--w >= 0) {
+                fileClose(&logPtr->writers[w].file);
+            }
+            free(logPtr->writers);
+            logPtr->writers = NULL;
+            return FALSE;
+        }
+        writerPtr->active = LONG_MAX;
+    }
+    logPtr->numWriter = numWriter;
+
+    return syncDir(logPtr);
+}
+
+
+/* =============================================================================
+ * redolog_getEpochPtr
+ * -- The current epoch; committing transactions read it with TM_SHARED_READ
+ * =============================================================================
+ */
+long*
+redolog_getEpochPtr (redolog_t* logPtr)
+{
+    return &logPtr->epoch;
+}
+
+
+/* =============================================================================
+ * redolog_begin
+ * -- Writer announces a transaction; call before the transaction begins
+ * =============================================================================
+ */
+void
+redolog_begin (redolog_t* logPtr, long writer)
+{
+    /*
+     * An epoch read here may already be stale, which only makes the flusher
+     * wait longer. Either the flusher sees this announcement, or its advance
+     * of the epoch happened first and the transaction reads the new epoch.
+     */
+    long epoch = __atomic_load_n(&logPtr->epoch, __ATOMIC_SEQ_CST);
+
+    __atomic_store_n(&logPtr->writers[writer].active, epoch, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+
+/* =============================================================================
+ * redolog_commit
+ * -- Appends the record of a committed transaction, read in 'epoch'; a zero
+ *    'size' only ends the announcement
+ * -- Exits the program if the log cannot grow
+ * =============================================================================
+ */
+void
+redolog_commit (redolog_t* logPtr, long writer,
+                long epoch, const void* dataPtr, long size)
+{
+    writer_t* writerPtr = &logPtr->writers[writer];
+
+    if (size > 0) {
+        assert(epoch > logPtr->checkpointEpoch);
+        if (!fileAppend(&writerPtr->file, epoch, dataPtr, size)) {
+            fail("cannot grow log");
+        }
+        writerPtr->numRecord++;
+        writerPtr->numByte += size;
+        __atomic_store_n(&writerPtr->written, writerPtr->file.tail,
+                         __ATOMIC_RELEASE);
+    }
+
+    __atomic_store_n(&writerPtr->active, LONG_MAX, __ATOMIC_RELEASE);
+}
+
+
+/* =============================================================================
+ * flush
+ * -- Makes the current epoch durable; one flusher at a time
+ * =============================================================================
+ */
+static void
+flush (redolog_t* logPtr)
+{
+    long epoch = logPtr->epoch; /* only a flusher writes it */
+    long pageSize = sysconf(_SC_PAGESIZE);
+    long w;
+
+    if (logPtr->intervalUs > 0) {
+        struct timespec until = logPtr->lastFlush;
+        until.tv_nsec += (logPtr->intervalUs % 1000000L) * 1000L;
+        until.tv_sec += logPtr->intervalUs / 1000000L + until.tv_nsec / 1000000000L;
+        until.tv_nsec %= 1000000000L;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &until, NULL) ==
+               EINTR)
+        {
+            /* retry */
+        }
+    }
+
+    /* Transactions that read the old epoch serialize before this one */
+    TM_BEGIN();
+    TM_SHARED_WRITE(logPtr->epoch, (epoch + 1));
+    TM_END();
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    for (w = 0; w < logPtr->numWriter; w++) {
+        while (__atomic_load_n(&logPtr->writers[w].active, __ATOMIC_SEQ_CST) <=
+               epoch)
+        {
+            sched_yield();
+        }
+    }
+
+    for (w = 0; w < logPtr->numWriter; w++) {
+        writer_t* writerPtr = &logPtr->writers[w];
+        long written = __atomic_load_n(&writerPtr->written, __ATOMIC_ACQUIRE);
+        if (written > writerPtr->synced) {
+            long start = writerPtr->synced & ~(pageSize - 1);
+            if (msync(writerPtr->file.base + start, written - start, MS_SYNC) != 0) {
+                fail("cannot sync log");
+            }
+            writerPtr->synced = written;
+        }
+    }
+
+    if (!writeState(logPtr, epoch)) {
+        fail("cannot write state");
+    }
+
+    logPtr->numFlush++;
+    clock_gettime(CLOCK_MONOTONIC, &logPtr->lastFlush);
+    __atomic_store_n(&logPtr->durable, epoch, __ATOMIC_RELEASE);
+}
+
+
+/* =============================================================================
+ * redolog_sync
+ * -- Returns once every record of 'epoch' is durable
+ * -- Exits the program if the logs cannot be synced
+ * =============================================================================
+ */
+void
+redolog_sync (redolog_t* logPtr, long epoch)
+{
+    if (__atomic_load_n(&logPtr->durable, __ATOMIC_ACQUIRE) >= epoch) {
+        return;
+    }
+
+    THREAD_MUTEX_LOCK(logPtr->lock);
+    while (__atomic_load_n(&logPtr->durable, __ATOMIC_ACQUIRE) < epoch) {
+        if (logPtr->flushing) {
+            THREAD_COND_WAIT(logPtr->cond, logPtr->lock);
+            continue;
+        }
+        logPtr->flushing = TRUE;
+        THREAD_MUTEX_UNLOCK(logPtr->lock);
+        flush(logPtr);
+        THREAD_MUTEX_LOCK(logPtr->lock);
+        logPtr->flushing = FALSE;
+        THREAD_COND_BROADCAST(logPtr->cond);
+    }
+    THREAD_MUTEX_UNLOCK(logPtr->lock);
+}
+
+
+/* =============================================================================
+ * redolog_getStats
+ * =============================================================================
+ */
+void
+redolog_getStats (redolog_t* logPtr,
+                  long* numRecordPtr, long* numBytePtr, long* numFlushPtr)
+{
+    long numRecord = 0;
+    long numByte = 0;
+    long w;
+
+    for (w = 0; w < logPtr->numWriter; w++) {
+        numRecord += logPtr->writers[w].numRecord;
+        numByte += logPtr->writers[w].numByte;
+    }
+
+    *numRecordPtr = numRecord;
+    *numBytePtr = numByte;
+    *numFlushPtr = logPtr->numFlush;
+}
+
+
+/* =============================================================================
+ * TEST_REDOLOG
+ * =============================================================================
+ */
+#ifdef TEST_REDOLOG
+
+
+TM_INIT_GLOBAL;
+
+
+static long global_sum;
+static long global_numApplied;
+
+
+static void
+apply (void* argPtr, long epoch, const void* dataPtr, long size)
+{
+    long value;
+
+    assert(size == sizeof(value));
+    memcpy(&value, dataPtr, sizeof(value));
+    if (epoch == 0) {
+        assert(value < 100);
+    } else {
+        assert(value >= 100);
+    }
+    global_sum += value;
+    global_numApplied++;
+}
+
+
+static bool_t
+dump (void* argPtr, redolog_t* logPtr)
+{
+    long i;
+
+    for (i = 1; i <= *(long*)argPtr; i++) {
+        if (!redolog_dump(logPtr, &i, sizeof(i))) {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+static void
+commit (redolog_t* logPtr, long writer, long value, bool_t doSync)
+{
+    long epoch;
+
+    redolog_begin(logPtr, writer);
+    epoch = *redolog_getEpochPtr(logPtr);
+    redolog_commit(logPtr, writer, epoch, &value, sizeof(value));
+    if (doSync) {
+        redolog_sync(logPtr, epoch);
+    }
+}
+
+
+static long
+replay (redolog_t* logPtr)
+{
+    long numLogged;
+
+    global_sum = 0;
+    global_numApplied = 0;
+    numLogged = redolog_replay(logPtr, &apply, NULL);
+    assert(numLogged >= 0);
+
+    return numLogged;
+}
+
+
+int
+main ()
+{
+    char dirName[] = "/tmp/redologXXXXXX";
+    char path[PATH_MAX];
+    redolog_t* logPtr;
+    long numDump;
+    long numRecord;
+    long numByte;
+    long numFlush;
+    long i;
+
+    assert(mkdtemp(dirName));
+
+    puts("Starting...");
+
+    /* Empty */
+    logPtr = redolog_open(dirName, 0);
+    assert(logPtr);
+    assert(!redolog_hasCheckpoint(logPtr));
+    assert(replay(logPtr) == 0 && global_numApplied == 0);
+
+    /* Checkpoint of 1..3, a durable record, and one that is not */
+    numDump = 3;
+    assert(redolog_checkpoint(logPtr, &dump, &numDump));
+    assert(redolog_hasCheckpoint(logPtr));
+    assert(redolog_start(logPtr, 2));
+    commit(logPtr, 0, 100, TRUE);
+    commit(logPtr, 1, 200, TRUE);
+    commit(logPtr, 0, 1000, FALSE);
+    redolog_getStats(logPtr, &numRecord, &numByte, &numFlush);
+    assert(numRecord == 3 && numByte == 3 * sizeof(long) && numFlush == 2);
+    redolog_close(logPtr);
+
+    logPtr = redolog_open(dirName, 0);
+    assert(logPtr);
+    assert(redolog_hasCheckpoint(logPtr));
+    assert(replay(logPtr) == 2);
+    assert(global_numApplied == 5 && global_sum == 1 + 2 + 3 + 100 + 200);
+
+    /* A new checkpoint supersedes the logs */
+    numDump = 4;
+    assert(redolog_checkpoint(logPtr, &dump, &numDump));
+    assert(replay(logPtr) == 0);
+    assert(global_numApplied == 4 && global_sum == 1 + 2 + 3 + 4);
+
+    /* Many records, so the log grows, then a torn one ends it */
+    assert(redolog_start(logPtr, 1));
+    for (i = 0; i < 100000; i++) {
+        commit(logPtr, 0, 100 + i, ((i % 1000) == 999));
+    }
+    commit(logPtr, 0, 7777777, TRUE);
+    commit(logPtr, 0, 8888888, TRUE);
+    redolog_close(logPtr);
+    {
+        long offset = 100001 * (sizeof(header_t) + sizeof(long)) + sizeof(header_t);
+        long garbage = 1;
+        int fd;
+        snprintf(path, PATH_MAX, "%s/log.0", dirName);
+        fd = open(path, O_WRONLY);
+        assert(fd >= 0);
+        assert(pwrite(fd, &garbage, sizeof(garbage), offset) == sizeof(garbage));
+        close(fd);
+    }
+    logPtr = redolog_open(dirName, 100);
+    assert(logPtr);
+    assert(replay(logPtr) == 100001);
+    assert(global_sum ==
+           1 + 2 + 3 + 4 + 100L * 100000 + (100000L * 99999) / 2 + 7777777);
+    redolog_close(logPtr);
+
+    snprintf(path, PATH_MAX, "%s/log.0", dirName);
+    assert(unlink(path) == 0);
+    snprintf(path, PATH_MAX, "%s/checkpoint", dirName);
+    assert(unlink(path) == 0);
+    snprintf(path, PATH_MAX, "%s/state", dirName);
+    assert(unlink(path) == 0);
+    assert(rmdir(dirName) == 0);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_REDOLOG */
+
+
+/* =============================================================================
+ *
+ * End of redolog.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,191 @@
+/* =============================================================================
+ *
+ * redolog.h
+ * -- Checkpoint and per-thread redo logs with group commit, in plain files
+ *
+ * =============================================================================
+ *
+ * A log lives in one directory:
+ *
+ *   checkpoint   records written by redolog_checkpoint, replayed first
+ *   log.N        records appended by writer N, memory-mapped
+ *   state        the newest durable epoch
+ *
+ * Every record carries the epoch it was committed in. The epoch is a counter
+ * that the committing transaction reads transactionally, and that the flusher
+ * advances transactionally, so all records of epoch e belong to transactions
+ * serialized before every record of epoch e + 1. A flush advances the epoch
+ * from e to e + 1, waits until no writer can still commit in e, msyncs what
+ * was appended to each log since the previous flush, and then writes e to
+ * the state file and fdatasyncs it. Replay therefore
+ * applies exactly the records of epochs up to the one in the state file,
+ * which is a prefix of the serialization order.
+ *
+ * Writers that call redolog_sync wait for the flush that covers their epoch.
+ * The first one to arrive runs it; the others wait and are released together
+ * (group commit). A positive interval makes the flusher wait until that long
+ * after the previous flush, so more commits share one fdatasync.
+ *
+ * Only plain POSIX calls are used (open, ftruncate, mmap, msync, fdatasync,
+ * rename), so the directory may be on any filesystem, including tmpfs.
+ * Records carry a checksum; replay of a log stops at the first record that is
+ * torn.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef REDOLOG_H
+#define REDOLOG_H 1
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct redolog redolog_t;
+
+
+/* =============================================================================
+ * redolog_open
+ * -- Creates 'dirName' if needed; 'intervalUs' is the group commit interval
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+redolog_t*
+redolog_open (const char* dirName, long intervalUs);
+
+
+/* =============================================================================
+ * redolog_close
+ * -- Leaves the files in place
+ * =============================================================================
+ */
+void
+redolog_close (redolog_t* logPtr);
+
+
+/* =============================================================================
+ * redolog_hasCheckpoint
+ * =============================================================================
+ */
+bool_t
+redolog_hasCheckpoint (redolog_t* logPtr);
+
+
+/* =============================================================================
+ * redolog_replay
+ * -- Calls applyFn for every checkpoint record (with epoch 0) and then for
+ *    every durable log record, in log order; records of different writers in
+ *    the same epoch are not ordered with respect to each other
+ * -- Returns the number of log records applied, or -1 on failure
+ * =============================================================================
+ */
+long
+redolog_replay (redolog_t* logPtr,
+                void (*applyFn)(void* argPtr, long epoch,
+                                const void* dataPtr, long size),
+                void* argPtr);
+
+
+/* =============================================================================
+ * redolog_checkpoint
+ * -- dumpFn writes the whole state with redolog_dump; the new checkpoint
+ *    replaces the old one and the logs atomically
+ * -- Only while no writer is running
+ * -- Returns FALSE on failure, leaving the previous checkpoint in place
+ * =============================================================================
+ */
+bool_t
+redolog_checkpoint (redolog_t* logPtr,
+                    bool_t (*dumpFn)(void* argPtr, redolog_t* logPtr),
+                    void* argPtr);
+
+
+/* =============================================================================
+ * redolog_dump
+ * -- Appends a checkpoint record; only from within dumpFn
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+redolog_dump (redolog_t* logPtr, const void* dataPtr, long size);
+
+
+/* =============================================================================
+ * redolog_start
+ * -- Creates empty logs for writers 0 to numWriter - 1
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+redolog_start (redolog_t* logPtr, long numWriter);
+
+
+/* =============================================================================
+ * redolog_getEpochPtr
+ * -- The current epoch; committing transactions read it with TM_SHARED_READ
+ * =============================================================================
+ */
+long*
+redolog_getEpochPtr (redolog_t* logPtr);
+
+
+/* =============================================================================
+ * redolog_begin
+ * -- Writer announces a transaction; call before the transaction begins
+ * =============================================================================
+ */
+void
+redolog_begin (redolog_t* logPtr, long writer);
+
+
+/* =============================================================================
+ * redolog_commit
+ * -- Appends the record of a committed transaction, read in 'epoch'; a zero
+ *    'size' only ends the announcement
+ * -- Exits the program if the log cannot grow
+ * =============================================================================
+ */
+void
+redolog_commit (redolog_t* logPtr, long writer,
+                long epoch, const void* dataPtr, long size);
+
+
+/* =============================================================================
+ * redolog_sync
+ * -- Returns once every record of 'epoch' is durable
+ * -- Exits the program if the logs cannot be synced
+ * =============================================================================
+ */
+void
+redolog_sync (redolog_t* logPtr, long epoch);
+
+
+/* =============================================================================
+ * redolog_getStats
+ * =============================================================================
+ */
+void
+redolog_getStats (redolog_t* logPtr,
+                  long* numRecordPtr, long* numBytePtr, long* numFlushPtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* REDOLOG_H */
+
+
+/* =============================================================================
+ *
+ * End of redolog.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,484 @@
+/* =============================================================================
+ *
+ * rqueue.c
+ * -- Lock-free multi-producer multi-consumer FIFO queue (Vyukov)
+ * -- Bounded ring, or unbounded chain of ring segments
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "rqueue.h"
+#include "types.h"
+
+
+#define RQUEUE_LINE_SIZE  (64)
+
+
+typedef struct cell {
+    atomic_ulong seq;        /* == index -> free, == index + 1 -> full */
+    void* dataPtr;
+} cell_t;
+
+typedef struct segment {
+    atomic_ulong pushIdx;
+    char pad1[RQUEUE_LINE_SIZE - sizeof(atomic_ulong)];
+    atomic_ulong popIdx;
+    char pad2[RQUEUE_LINE_SIZE - sizeof(atomic_ulong)];
+    _Atomic(struct segment*) nextPtr;
+    struct segment* retiredNextPtr;
+    unsigned long mask;
+    unsigned long limit;     /* ULONG_MAX for a ring, else capacity */
+    cell_t cells[];
+} segment_t;
+
+struct rqueue {
+    _Atomic(segment_t*) headPtr;
+    char pad1[RQUEUE_LINE_SIZE - sizeof(segment_t*)];
+    _Atomic(segment_t*) tailPtr;
+    char pad2[RQUEUE_LINE_SIZE - sizeof(segment_t*)];
+    _Atomic(segment_t*) retiredPtr;
+    char pad3[RQUEUE_LINE_SIZE - sizeof(segment_t*)];
+};
+
+
+/* =============================================================================
+ * allocSegment
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static segment_t*
+allocSegment (unsigned long capacity, bool_t isRing)
+{
+    unsigned long size = sizeof(segment_t) + capacity * sizeof(cell_t);
+    size = (size + RQUEUE_LINE_SIZE - 1) & ~(unsigned long)(RQUEUE_LINE_SIZE - 1);
+
+    segment_t* segPtr = (segment_t*)aligned_alloc(RQUEUE_LINE_SIZE, size);
+    if (segPtr == NULL) {
+        return NULL;
+    }
+
+    atomic_init(&segPtr->pushIdx, 0);
+    atomic_init(&segPtr->popIdx, 0);
+    atomic_init(&segPtr->nextPtr, NULL);
+    segPtr->retiredNextPtr = NULL;
+    segPtr->mask = capacity - 1;
+    segPtr->limit = (isRing ? ULONG_MAX : capacity);
+
+    unsigned long i;
+    for (i = 0; i < capacity; i++) {
+        atomic_init(&segPtr->cells[i].seq, i);
+        segPtr->cells[i].dataPtr = NULL;
+    }
+
+    return segPtr;
+}
+
+
+/* =============================================================================
+ * segmentPush
+ * -- Returns FALSE if ring is full or segment is closed
+ * =============================================================================
+ */
+static bool_t
+segmentPush (segment_t* segPtr, void* dataPtr)
+{
+    unsigned long pos = atomic_load_explicit(&segPtr->pushIdx,
+                                             memory_order_relaxed);
+
+    while (pos < segPtr->limit) {
+        cell_t* cellPtr = &segPtr->cells[pos & segPtr->mask];
+        unsigned long seq = atomic_load_explicit(&cellPtr->seq,
+                                                 memory_order_acquire);
+        long dif = (long)(seq - pos);
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&segPtr->pushIdx,
+                                                      &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                cellPtr->dataPtr = dataPtr;
+                atomic_store_explicit(&cellPtr->seq, pos + 1,
+                                      memory_order_release);
+                return TRUE;
+            }
+        } else if (dif < 0) {
+            return FALSE; /* full */
+        } else {
+            pos = atomic_load_explicit(&segPtr->pushIdx, memory_order_relaxed);
+        }
+    }
+
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * segmentPop
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+static void*
+segmentPop (segment_t* segPtr)
+{
+    unsigned long pos = atomic_load_explicit(&segPtr->popIdx,
+                                             memory_order_relaxed);
+
+    while (pos < segPtr->limit) {
+        cell_t* cellPtr = &segPtr->cells[pos & segPtr->mask];
+        unsigned long seq = atomic_load_explicit(&cellPtr->seq,
+                                                 memory_order_acquire);
+        long dif = (long)(seq - (pos + 1));
+        if (dif == 0) {
+            if (atomic_compare_exchange_weak_explicit(&segPtr->popIdx,
+                                                      &pos,
+                                                      pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                void* dataPtr = cellPtr->dataPtr;
+                atomic_store_explicit(&cellPtr->seq, pos + segPtr->mask + 1,
+                                      memory_order_release);
+                return dataPtr;
+            }
+        } else if (dif < 0) {
+            return NULL; /* empty, or push in progress */
+        } else {
+            pos = atomic_load_explicit(&segPtr->popIdx, memory_order_relaxed);
+        }
+    }
+
+    return NULL;
+}
+
+
+/* =============================================================================
+ * retireSegment
+ * -- Called exactly once per segment, by the thread that unlinked it
+ * =============================================================================
+ */
+static void
+retireSegment (rqueue_t* queuePtr, segment_t* segPtr)
+{
+    segment_t* headPtr = atomic_load_explicit(&queuePtr->retiredPtr,
+                                              memory_order_relaxed);
+    do {
+        segPtr->retiredNextPtr = headPtr;
+    } while (!atomic_compare_exchange_weak_explicit(&queuePtr->retiredPtr,
+                                                    &headPtr,
+                                                    segPtr,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+
+/* =============================================================================
+ * rqueue_alloc
+ * -- If capacity <= 0, queue is unbounded
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+rqueue_t*
+rqueue_alloc (long capacity)
+{
+    rqueue_t* queuePtr = (rqueue_t*)aligned_alloc(RQUEUE_LINE_SIZE,
+                                                  sizeof(rqueue_t));
+    if (queuePtr == NULL) {
+        return NULL;
+    }
+
+    segment_t* segPtr;
+    if (capacity > 0) {
+        unsigned long size = 1;
+        while (size < (unsigned long)capacity) {
+            size <<= 1;
+        }
+        segPtr = allocSegment(size, TRUE);
+    } else {
+        assert((RQUEUE_SEGMENT_SIZE & (RQUEUE_SEGMENT_SIZE - 1)) == 0);
+        segPtr = allocSegment(RQUEUE_SEGMENT_SIZE, FALSE);
+    }
+    if (segPtr == NULL) {
+        free(queuePtr);
+        return NULL;
+    }
+
+    atomic_init(&queuePtr->headPtr, segPtr);
+    atomic_init(&queuePtr->tailPtr, segPtr);
+    atomic_init(&queuePtr->retiredPtr, NULL);
+
+    return queuePtr;
+}
+
+
+/* =============================================================================
+ * rqueue_free
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+rqueue_free (rqueue_t* queuePtr)
+{
+    segment_t* segPtr = atomic_load(&queuePtr->headPtr);
+    while (segPtr != NULL) {
+        segment_t* nextPtr = atomic_load(&segPtr->nextPtr);
+        free(segPtr);
+        segPtr = nextPtr;
+    }
+
+    segPtr = atomic_load(&queuePtr->retiredPtr);
+    while (segPtr != NULL) {
+        segment_t* nextPtr = segPtr->retiredNextPtr;
+        free(segPtr);
+        segPtr = nextPtr;
+    }
+
+    free(queuePtr);
+}
+
+
+/* =============================================================================
+ * rqueue_isEmpty
+ * -- Elements whose push has not completed yet are not counted
+ * =============================================================================
+ */
+bool_t
+rqueue_isEmpty (rqueue_t* queuePtr)
+{
+    segment_t* segPtr = atomic_load_explicit(&queuePtr->headPtr,
+                                             memory_order_acquire);
+
+    while (1) {
+        unsigned long pos = atomic_load_explicit(&segPtr->popIdx,
+                                                 memory_order_relaxed);
+        if (pos < segPtr->limit) {
+            cell_t* cellPtr = &segPtr->cells[pos & segPtr->mask];
+            return ((atomic_load_explicit(&cellPtr->seq, memory_order_acquire)
+                     != pos + 1) ? TRUE : FALSE);
+        }
+        segPtr = atomic_load_explicit(&segPtr->nextPtr, memory_order_acquire);
+        if (segPtr == NULL) {
+            return TRUE;
+        }
+    }
+}
+
+
+/* =============================================================================
+ * rqueue_push
+ * -- dataPtr must not be NULL
+ * -- Returns FALSE if bounded queue is full or allocation fails
+ * =============================================================================
+ */
+bool_t
+rqueue_push (rqueue_t* queuePtr, void* dataPtr)
+{
+    assert(dataPtr != NULL);
+
+    while (1) {
+        segment_t* segPtr = atomic_load_explicit(&queuePtr->tailPtr,
+                                                 memory_order_acquire);
+        if (segmentPush(segPtr, dataPtr)) {
+            return TRUE;
+        }
+        if (segPtr->limit == ULONG_MAX) {
+            return FALSE; /* bounded */
+        }
+
+        /* Segment is closed: append a new one if nobody has yet */
+        segment_t* nextPtr = atomic_load_explicit(&segPtr->nextPtr,
+                                                  memory_order_acquire);
+        if (nextPtr == NULL) {
+            segment_t* newPtr = allocSegment(RQUEUE_SEGMENT_SIZE, FALSE);
+            if (newPtr == NULL) {
+                return FALSE;
+            }
+            if (atomic_compare_exchange_strong_explicit(&segPtr->nextPtr,
+                                                        &nextPtr,
+                                                        newPtr,
+                                                        memory_order_acq_rel,
+                                                        memory_order_acquire)) {
+                nextPtr = newPtr;
+            } else {
+                free(newPtr);
+            }
+        }
+        atomic_compare_exchange_strong_explicit(&queuePtr->tailPtr,
+                                                &segPtr,
+                                                nextPtr,
+                                                memory_order_release,
+                                                memory_order_relaxed);
+    }
+}
+
+
+/* =============================================================================
+ * rqueue_pop
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+rqueue_pop (rqueue_t* queuePtr)
+{
+    while (1) {
+        segment_t* segPtr = atomic_load_explicit(&queuePtr->headPtr,
+                                                 memory_order_acquire);
+        void* dataPtr = segmentPop(segPtr);
+        if (dataPtr != NULL) {
+            return dataPtr;
+        }
+        if (atomic_load_explicit(&segPtr->popIdx, memory_order_relaxed)
+            < segPtr->limit)
+        {
+            return NULL;
+        }
+
+        /* Segment is drained: move on to the next one */
+        segment_t* nextPtr = atomic_load_explicit(&segPtr->nextPtr,
+                                                  memory_order_acquire);
+        if (nextPtr == NULL) {
+            return NULL;
+        }
+        if (atomic_compare_exchange_strong_explicit(&queuePtr->headPtr,
+                                                    &segPtr,
+                                                    nextPtr,
+                                                    memory_order_release,
+                                                    memory_order_relaxed)) {
+            retireSegment(queuePtr, segPtr);
+        }
+    }
+}
+
+
+/* =============================================================================
+ * TEST_RQUEUE
+ * =============================================================================
+ */
+#ifdef TEST_RQUEUE
+
+
+#include <pthread.h>
+#include <stdio.h>
+
+
+#define NUM_PRODUCER  4
+#define NUM_CONSUMER  4
+#define NUM_PUSH      20000
+
+
+static rqueue_t* global_queuePtr;
+static atomic_long global_numPop;
+static atomic_long global_sum;
+
+
+static void*
+produce (void* argPtr)
+{
+    long p = (long)argPtr;
+    long i;
+
+    for (i = 1; i <= NUM_PUSH; i++) {
+        while (!rqueue_push(global_queuePtr, (void*)(i * NUM_PRODUCER + p))) {
+            /* bounded queue is full */
+        }
+    }
+
+    return NULL;
+}
+
+
+static void*
+consume (void* argPtr)
+{
+    long last[NUM_PRODUCER] = { 0 };
+
+    while (atomic_load(&global_numPop) < NUM_PRODUCER * NUM_PUSH) {
+        long value = (long)rqueue_pop(global_queuePtr);
+        if (value == 0) {
+            continue;
+        }
+        /* Values from one producer come out in the order they went in */
+        assert(value / NUM_PRODUCER > last[value % NUM_PRODUCER]);
+        last[value % NUM_PRODUCER] = value / NUM_PRODUCER;
+        atomic_fetch_add(&global_sum, value / NUM_PRODUCER);
+        atomic_fetch_add(&global_numPop, 1);
+    }
+
+    return NULL;
+}
+
+
+static void
+run (long capacity)
+{
+    pthread_t threads[NUM_PRODUCER + NUM_CONSUMER];
+    long i;
+
+    global_queuePtr = rqueue_alloc(capacity);
+    assert(global_queuePtr);
+    atomic_store(&global_numPop, 0);
+    atomic_store(&global_sum, 0);
+
+    assert(rqueue_isEmpty(global_queuePtr));
+    assert(rqueue_pop(global_queuePtr) == NULL);
+
+    for (i = 0; i < NUM_PRODUCER; i++) {
+        pthread_create(&threads[i], NULL, produce, (void*)i);
+    }
+    for (i = 0; i < NUM_CONSUMER; i++) {
+        pthread_create(&threads[NUM_PRODUCER + i], NULL, consume, NULL);
+    }
+    for (i = 0; i < NUM_PRODUCER + NUM_CONSUMER; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    assert(atomic_load(&global_sum) ==
+           NUM_PRODUCER * ((long)NUM_PUSH * (NUM_PUSH + 1) / 2));
+    assert(rqueue_isEmpty(global_queuePtr));
+
+    rqueue_free(global_queuePtr);
+}
+
+
+int
+main ()
+{
+    long i;
+
+    puts("Starting...");
+
+    rqueue_t* queuePtr = rqueue_alloc(3);
+    assert(queuePtr);
+    for (i = 1; i <= 4; i++) {
+        assert(rqueue_push(queuePtr, (void*)i));
+    }
+    assert(!rqueue_push(queuePtr, (void*)5));
+    for (i = 1; i <= 4; i++) {
+        assert(rqueue_pop(queuePtr) == (void*)i);
+    }
+    assert(rqueue_pop(queuePtr) == NULL);
+    rqueue_free(queuePtr);
+
+    puts("Bounded...");
+    run(256);
+    puts("Unbounded...");
+    run(-1);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_RQUEUE */
+
+
+/* =============================================================================
+ *
+ * End of rqueue.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,104 @@
+/* =============================================================================
+ *
+ * rqueue.h
+ * -- Lock-free multi-producer multi-consumer FIFO queue (Vyukov)
+ * -- Bounded ring, or unbounded chain of ring segments
+ *
+ * =============================================================================
+ *
+ * Every slot carries a sequence number that tells producers and consumers
+ * whether it is free for the lap they are on, so a push or pop only contends
+ * on its own end of the queue and on one slot. Operations are not
+ * transactional: they take effect immediately and are not undone if an
+ * enclosing software transaction aborts, so callers pop outside transactions.
+ *
+ * A queue allocated with a capacity > 0 is a single ring of that capacity
+ * rounded up to a power of two, and rqueue_push fails when it is full.
+ * Otherwise the queue is a linked chain of RQUEUE_SEGMENT_SIZE-slot segments
+ * that are filled once each; drained segments are kept until rqueue_free.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef RQUEUE_H
+#define RQUEUE_H 1
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#ifndef RQUEUE_SEGMENT_SIZE
+#  define RQUEUE_SEGMENT_SIZE (1024)
+#endif
+
+
+typedef struct rqueue rqueue_t;
+
+
+/* =============================================================================
+ * rqueue_alloc
+ * -- If capacity <= 0, queue is unbounded
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+rqueue_t*
+rqueue_alloc (long capacity);
+
+
+/* =============================================================================
+ * rqueue_free
+ * -- Not thread-safe
+ * =============================================================================
+ */
+void
+rqueue_free (rqueue_t* queuePtr);
+
+
+/* =============================================================================
+ * rqueue_isEmpty
+ * -- Elements whose push has not completed yet are not counted
+ * =============================================================================
+ */
+bool_t
+rqueue_isEmpty (rqueue_t* queuePtr);
+
+
+/* =============================================================================
+ * rqueue_push
+ * -- dataPtr must not be NULL
+ * -- Returns FALSE if bounded queue is full or allocation fails
+ * =============================================================================
+ */
+bool_t
+rqueue_push (rqueue_t* queuePtr, void* dataPtr);
+
+
+/* =============================================================================
+ * rqueue_pop
+ * -- Returns NULL if empty
+ * =============================================================================
+ */
+void*
+rqueue_pop (rqueue_t* queuePtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* RQUEUE_H */
+
+
+/* =============================================================================
+ *
+ * End of rqueue.h
+ *
+ * =============================================================================
+ */
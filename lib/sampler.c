@@ -0,0 +1,369 @@
+/* =============================================================================
+ *
+ * sampler.c
+ * -- Draws from a fixed discrete distribution with an alias table
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "random.h"
+#include "sampler.h"
+#include "types.h"
+
+
+typedef struct entry {
+    uint32_t threshold;     /* keep the slot if a 32-bit draw is below this */
+    uint32_t alias;
+} entry_t;
+
+struct sampler {
+    long n;
+    entry_t* entries;
+};
+
+
+/* =============================================================================
+ * sampler_alloc
+ * -- Value i is drawn with probability weights[i] / sum(weights)
+ * -- Weights must be non-negative with a positive sum; n must fit in 32 bits
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_alloc (const double* weights, long n)
+{
+    sampler_t* samplerPtr;
+    double* scaled;
+    long* work;
+    long numSmall = 0;
+    long largeTop = n;
+    double sum = 0.0;
+    long i;
+
+    if (n < 1 || (unsigned long)n > 0xffffffffUL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (!(weights[i] >= 0.0)) {
+            return NULL;
+        }
+        sum += weights[i];
+    }
+    if (!(sum > 0.0)) {
+        return NULL;
+    }
+
+    samplerPtr = (sampler_t*)malloc(sizeof(sampler_t));
+    scaled = (double*)malloc(n * sizeof(double));
+    work = (long*)malloc(n * sizeof(long));
+    if (samplerPtr == NULL || scaled == NULL || work == NULL) {
+        free(samplerPtr);
+        free(scaled);
+        free(work);
+        return NULL;
+    }
+    samplerPtr->n = n;
+    samplerPtr->entries = (entry_t*)malloc(n * sizeof(entry_t));
+    if (samplerPtr->entries == NULL) {
+        free(samplerPtr);
+        free(scaled);
+        free(work);
+        return NULL;
+    }
+
+    /*
+     * Scale so the average is 1. Slots below 1 are filled up from slots above
+     * 1; 'work' holds the small ones growing up and the large ones growing
+     * down, which never overlap.
+     */
+    for (i = 0; i < n; i++) {
+        scaled[i] = weights[i] * (double)n / sum;
+        if (scaled[i] < 1.0) {
+            work[numSmall++] = i;
+        } else {
+            work[--largeTop] = i;
+        }
+    }
+    while (numSmall > 0 && largeTop < n) {
+        long s = work[--numSmall];
+        long l = work[largeTop++];
+        samplerPtr->entries[s].threshold =
+            (uint32_t)(scaled[s] * 4294967296.0);
+        samplerPtr->entries[s].alias = (uint32_t)l;
+        scaled[l] -= (1.0 - scaled[s]);
+        if (scaled[l] < 1.0) {
+            work[numSmall++] = l;
+        } else {
+            work[--largeTop] = l;
+        }
+    }
+
+    /* What is left is 1 up to rounding; aliasing to itself makes it exact */
+    while (numSmall > 0) {
+        long s = work[--numSmall];
+        samplerPtr->entries[s].threshold = 0xffffffffU;
+        samplerPtr->entries[s].alias = (uint32_t)s;
+    }
+    while (largeTop < n) {
+        long l = work[largeTop++];
+        samplerPtr->entries[l].threshold = 0xffffffffU;
+        samplerPtr->entries[l].alias = (uint32_t)l;
+    }
+
+    free(scaled);
+    free(work);
+
+    return samplerPtr;
+}
+
+
+/* =============================================================================
+ * sampler_allocZipf
+ * -- Value i is drawn with probability proportional to 1 / (i + 1)^theta, so
+ *    0 is the most popular; theta = 0 is uniform
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_allocZipf (long n, double theta)
+{
+    sampler_t* samplerPtr;
+    double* weights;
+    long i;
+
+    if (n < 1 || !(theta >= 0.0)) {
+        return NULL;
+    }
+
+    weights = (double*)malloc(n * sizeof(double));
+    if (weights == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        weights[i] = pow((double)(i + 1), -theta);
+    }
+
+    samplerPtr = sampler_alloc(weights, n);
+    free(weights);
+
+    return samplerPtr;
+}
+
+
+/* =============================================================================
+ * sampler_allocHotspot
+ * -- The first ceil(hotFraction * n) values share 'hotProbability' of the
+ *    draws evenly and the rest share the remainder
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_allocHotspot (long n, double hotFraction, double hotProbability)
+{
+    sampler_t* samplerPtr;
+    double* weights;
+    long numHot;
+    long i;
+
+    if (n < 1 ||
+        !(hotFraction > 0.0 && hotFraction <= 1.0) ||
+        !(hotProbability >= 0.0 && hotProbability <= 1.0))
+    {
+        return NULL;
+    }
+
+    numHot = (long)ceil(hotFraction * (double)n);
+    if (numHot > n) {
+        numHot = n;
+    }
+
+    weights = (double*)malloc(n * sizeof(double));
+    if (weights == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < n; i++) {
+        if (i < numHot) {
+            weights[i] = hotProbability / (double)numHot;
+        } else {
+            weights[i] = (1.0 - hotProbability) / (double)(n - numHot);
+        }
+    }
+
+    samplerPtr = sampler_alloc(weights, n);
+    free(weights);
+
+    return samplerPtr;
+}
+
+
+/* =============================================================================
+ * sampler_free
+ * =============================================================================
+ */
+void
+sampler_free (sampler_t* samplerPtr)
+{
+    if (samplerPtr != NULL) {
+        free(samplerPtr->entries);
+        free(samplerPtr);
+    }
+}
+
+
+/* =============================================================================
+ * sampler_getSize
+ * =============================================================================
+ */
+long
+sampler_getSize (const sampler_t* samplerPtr)
+{
+    return samplerPtr->n;
+}
+
+
+/* =============================================================================
+ * sampler_generate
+ * -- Returns a value in [0, n)
+ * =============================================================================
+ */
+long
+sampler_generate (const sampler_t* samplerPtr, random_t* randomPtr)
+{
+    /* Multiply-shift maps a 32-bit draw onto [0, n) without a division */
+    uint64_t slot = ((uint64_t)(uint32_t)random_generate(randomPtr) *
+                     (uint64_t)samplerPtr->n) >> 32;
+    const entry_t* entryPtr = &samplerPtr->entries[slot];
+
+    if ((uint32_t)random_generate(randomPtr) < entryPtr->threshold) {
+        return (long)slot;
+    }
+
+    return (long)entryPtr->alias;
+}
+
+
+/* =============================================================================
+ * TEST_SAMPLER
+ * =============================================================================
+ */
+#ifdef TEST_SAMPLER
+
+
+#include <stdio.h>
+
+
+#define NUM_DRAW (1L << 22)
+
+
+static void
+check (sampler_t* samplerPtr, const double* weights, random_t* randomPtr)
+{
+    long n = sampler_getSize(samplerPtr);
+    long* counts = (long*)calloc(n, sizeof(long));
+    double sum = 0.0;
+    long i;
+
+    assert(counts);
+    for (i = 0; i < n; i++) {
+        sum += weights[i];
+    }
+    for (i = 0; i < NUM_DRAW; i++) {
+        long v = sampler_generate(samplerPtr, randomPtr);
+        assert(v >= 0 && v < n);
+        counts[v]++;
+    }
+
+    /* Every count within 5 standard deviations of its expectation */
+    for (i = 0; i < n; i++) {
+        double p = weights[i] / sum;
+        double expected = p * (double)NUM_DRAW;
+        double sigma = sqrt((double)NUM_DRAW * p * (1.0 - p));
+        assert(fabs((double)counts[i] - expected) <= 5.0 * sigma + 1.0);
+        if (p == 0.0) {
+            assert(counts[i] == 0);
+        }
+    }
+
+    free(counts);
+}
+
+
+int
+main ()
+{
+    random_t* randomPtr = random_alloc();
+    double weights[1000];
+    sampler_t* samplerPtr;
+    long i;
+
+    assert(randomPtr);
+    random_seed(randomPtr, 0);
+
+    puts("Starting...");
+
+    /* Invalid input */
+    weights[0] = 0.0;
+    assert(sampler_alloc(weights, 1) == NULL);
+    assert(sampler_alloc(weights, 0) == NULL);
+    weights[0] = -1.0;
+    weights[1] = 2.0;
+    assert(sampler_alloc(weights, 2) == NULL);
+    assert(sampler_allocHotspot(10, 0.0, 0.5) == NULL);
+
+    /* Single value */
+    samplerPtr = sampler_allocZipf(1, 1.0);
+    assert(samplerPtr);
+    for (i = 0; i < 100; i++) {
+        assert(sampler_generate(samplerPtr, randomPtr) == 0);
+    }
+    sampler_free(samplerPtr);
+
+    /* Arbitrary weights, including zeros */
+    for (i = 0; i < 100; i++) {
+        weights[i] = (double)((i * 7919) % 13) * ((i % 5) ? 1.0 : 0.0);
+    }
+    samplerPtr = sampler_alloc(weights, 100);
+    assert(samplerPtr);
+    check(samplerPtr, weights, randomPtr);
+    sampler_free(samplerPtr);
+
+    /* Zipf */
+    for (i = 0; i < 1000; i++) {
+        weights[i] = pow((double)(i + 1), -0.99);
+    }
+    samplerPtr = sampler_allocZipf(1000, 0.99);
+    assert(samplerPtr);
+    check(samplerPtr, weights, randomPtr);
+    sampler_free(samplerPtr);
+
+    /* Hotspot: 10% of the values get 90% of the draws */
+    for (i = 0; i < 1000; i++) {
+        weights[i] = (i < 100) ? (0.9 / 100.0) : (0.1 / 900.0);
+    }
+    samplerPtr = sampler_allocHotspot(1000, 0.1, 0.9);
+    assert(samplerPtr);
+    check(samplerPtr, weights, randomPtr);
+    sampler_free(samplerPtr);
+
+    random_free(randomPtr);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_SAMPLER */
+
+
+/* =============================================================================
+ *
+ * End of sampler.c
+ *
+ * =============================================================================
+ */
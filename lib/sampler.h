@@ -0,0 +1,107 @@
+/* =============================================================================
+ *
+ * sampler.h
+ * -- Draws from a fixed discrete distribution with an alias table
+ *
+ * =============================================================================
+ *
+ * The table is built once, in O(n), with Vose's variant of Walker's alias
+ * method. Each draw then costs two random numbers: one picks a slot, the other
+ * decides between the slot's own value and its alias. A sampler is read-only
+ * after allocation, so threads may share one as long as each passes its own
+ * random_t.
+ *
+ * Entries are 8 bytes, so a table for 2^20 values is 8 MB.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef SAMPLER_H
+#define SAMPLER_H 1
+
+
+#include "random.h"
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct sampler sampler_t;
+
+
+/* =============================================================================
+ * sampler_alloc
+ * -- Value i is drawn with probability weights[i] / sum(weights)
+ * -- Weights must be non-negative with a positive sum; n must fit in 32 bits
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_alloc (const double* weights, long n);
+
+
+/* =============================================================================
+ * sampler_allocZipf
+ * -- Value i is drawn with probability proportional to 1 / (i + 1)^theta, so
+ *    0 is the most popular; theta = 0 is uniform
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_allocZipf (long n, double theta);
+
+
+/* =============================================================================
+ * sampler_allocHotspot
+ * -- The first ceil(hotFraction * n) values share 'hotProbability' of the
+ *    draws evenly and the rest share the remainder
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+sampler_t*
+sampler_allocHotspot (long n, double hotFraction, double hotProbability);
+
+
+/* =============================================================================
+ * sampler_free
+ * =============================================================================
+ */
+void
+sampler_free (sampler_t* samplerPtr);
+
+
+/* =============================================================================
+ * sampler_getSize
+ * =============================================================================
+ */
+long
+sampler_getSize (const sampler_t* samplerPtr);
+
+
+/* =============================================================================
+ * sampler_generate
+ * -- Returns a value in [0, n)
+ * =============================================================================
+ */
+long
+sampler_generate (const sampler_t* samplerPtr, random_t* randomPtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* SAMPLER_H */
+
+
+/* =============================================================================
+ *
+ * End of sampler.h
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,1139 @@
+/* =============================================================================
+ *
+ * skiplist.c
+ * -- Sorted skip list map, same interface as rbtree.h
+ *
+ * =============================================================================
+ *
+ * Keys and tower heights never change once a node is linked, so only the
+ * forward pointers and the list level are accessed transactionally.
+ *
+ * =============================================================================
+ */
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "skiplist.h"
+#include "tm.h"
+
+
+typedef struct node {
+    void* k;
+    void* v;
+    long height;
+    struct node* next[];                     /* [0, height) */
+} node_t;
+
+
+struct skiplist {
+    long level;                              /* highest tower in use, never shrinks */
+    TM_PURE long (*compare)(const void*, const void*);   /* returns {-1,0,1}, 0 -> equal */
+    node_t* head;                            /* SKIPLIST_MAX_LEVEL tall, no key */
+};
+
+#define LDF(o,f)            ((o)->f)
+#define STF(o,f,v)          ((o)->f) = (v)
+#define LDNODE(o,f)         ((node_t*)(LDF((o),f)))
+
+#define HTX_LDF(o,f)        ((long)HTM_SHARED_READ((o)->f))
+#define HTX_LDF_P(o,f)      ((void*)HTM_SHARED_READ_P((o)->f))
+#define HTX_STF(o,f,v)      HTM_SHARED_WRITE((o)->f, v)
+#define HTX_STF_P(o,f,v)    HTM_SHARED_WRITE_P((o)->f, v)
+#define HTX_LDNODE(o,f)     ((node_t*)(HTX_LDF_P((o),f)))
+
+#define TX_LDF(o,f)         ((long)TM_SHARED_READ_TAG((o)->f, (uintptr_t)o))
+#define TX_LDF_P(o,f)       ((void*)TM_SHARED_READ_TAG_P((o)->f, (uintptr_t)o))
+#define TX_STF(o,f,v)       TM_SHARED_WRITE((o)->f, v)
+#define TX_STF_P(o,f,v)     TM_SHARED_WRITE_P((o)->f, v)
+#define TX_LDNODE(o,f)      ((node_t*)(TX_LDF_P((o),f)))
+
+#ifndef ORIGINAL
+# define TM_LOG_OP TM_LOG_OP_DECLARE
+# include "skiplist.inc"
+# undef TM_LOG_OP
+#endif /* ORIGINAL */
+
+
+/* =============================================================================
+ * towerHeight
+ * -- Geometric (p = 1/2) height from a hash of the key
+ * =============================================================================
+ */
+static long
+towerHeight (void* k)
+{
+    uint64_t h = (uint64_t)(uintptr_t)k;
+    long height = 1;
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+
+    while ((h & 1) && (height < SKIPLIST_MAX_LEVEL)) {
+        height++;
+        h >>= 1;
+    }
+
+    return height;
+}
+
+
+/* =============================================================================
+ * getNode
+ * =============================================================================
+ */
+static node_t*
+getNode (long height)
+{
+    node_t* n = (node_t*)malloc(sizeof(*n) + height * sizeof(node_t*));
+    if (n) {
+        n->height = height;
+    }
+    return n;
+}
+
+
+/* =============================================================================
+ * HTMgetNode
+ * =============================================================================
+ */
+static node_t*
+HTMgetNode (long height)
+{
+    node_t* n = (node_t*)HTM_MALLOC(sizeof(*n) + height * sizeof(node_t*));
+    if (n) {
+        n->height = height;
+    }
+    return n;
+}
+
+
+/* =============================================================================
+ * TMgetNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMgetNode (TM_ARGDECL  long height)
+{
+    node_t* n = (node_t*)TM_MALLOC(sizeof(*n) + height * sizeof(node_t*));
+    if (n) {
+        n->height = height;
+    }
+    return n;
+}
+
+
+/* =============================================================================
+ * releaseNode
+ * =============================================================================
+ */
+static void
+releaseNode (node_t* n)
+{
+#ifndef SIMULATOR
+    free(n);
+#endif
+}
+
+
+/* =============================================================================
+ * HTMreleaseNode
+ * =============================================================================
+ */
+static void
+HTMreleaseNode (node_t* n)
+{
+    HTM_FREE(n);
+}
+
+
+/* =============================================================================
+ * TMreleaseNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMreleaseNode (TM_ARGDECL  node_t* n)
+{
+    TM_FREE(n);
+}
+
+
+/* =============================================================================
+ * lookup
+ * -- Stops at the highest level where the key is found
+ * =============================================================================
+ */
+static node_t*
+lookup (skiplist_t* s, void* k)
+{
+    node_t* p = s->head;
+    long i;
+
+    for (i = LDF(s, level) - 1; i >= 0; i--) {
+        node_t* n = LDNODE(p, next[i]);
+        long cmp = 1;
+        while (n != NULL && (cmp = s->compare(k, n->k)) > 0) {
+            p = n;
+            n = LDNODE(p, next[i]);
+        }
+        if (n != NULL && cmp == 0) {
+            return n;
+        }
+    }
+
+    return NULL;
+}
+#define LOOKUP(s, k)  lookup(s, k)
+
+
+/* =============================================================================
+ * HTMlookup
+ * =============================================================================
+ */
+static node_t*
+HTMlookup (skiplist_t* s, void* k)
+{
+    node_t* p = s->head;
+    long i;
+
+    for (i = HTX_LDF(s, level) - 1; i >= 0; i--) {
+        node_t* n = HTX_LDNODE(p, next[i]);
+        long cmp = 1;
+        while (n != NULL && (cmp = s->compare(k, n->k)) > 0) {
+            p = n;
+            n = HTX_LDNODE(p, next[i]);
+        }
+        if (n != NULL && cmp == 0) {
+            p = n;
+            goto out;
+        }
+    }
+    p = NULL;
+
+out:
+    return p;
+}
+#define HTX_LOOKUP(s, k)  HTMlookup(s, k)
+
+
+/* =============================================================================
+ * TMlookup
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMlookup (TM_ARGDECL  skiplist_t* s, void* k)
+{
+    node_t* p = s->head;
+    long i;
+
+    for (i = TX_LDF(s, level) - 1; i >= 0; i--) {
+        node_t* n = TX_LDNODE(p, next[i]);
+        long cmp = 1;
+        while (n != NULL && (cmp = s->compare(k, n->k)) > 0) {
+            p = n;
+            n = TX_LDNODE(p, next[i]);
+        }
+        if (n != NULL && cmp == 0) {
+            p = n;
+            goto out;
+        }
+    }
+    p = NULL;
+
+out:
+    return p;
+}
+#define TX_LOOKUP(s, k)  TMlookup(TM_ARG  s, k)
+
+
+/* =============================================================================
+ * findPreds
+ * -- Fills preds[0, level) with the last node before k on each level
+ * -- Returns the first node >= k on level 0
+ * =============================================================================
+ */
+static node_t*
+findPreds (skiplist_t* s, void* k, node_t** preds, long level)
+{
+    node_t* p = s->head;
+    node_t* n = NULL;
+    long i;
+
+    for (i = level - 1; i >= 0; i--) {
+        n = LDNODE(p, next[i]);
+        while (n != NULL && s->compare(k, n->k) > 0) {
+            p = n;
+            n = LDNODE(p, next[i]);
+        }
+        preds[i] = p;
+    }
+
+    return n;
+}
+#define FIND_PREDS(s, k, preds, l)  findPreds(s, k, preds, l)
+
+
+/* =============================================================================
+ * HTMfindPreds
+ * =============================================================================
+ */
+static node_t*
+HTMfindPreds (skiplist_t* s, void* k, node_t** preds, long level)
+{
+    node_t* p = s->head;
+    node_t* n = NULL;
+    long i;
+
+    for (i = level - 1; i >= 0; i--) {
+        n = HTX_LDNODE(p, next[i]);
+        while (n != NULL && s->compare(k, n->k) > 0) {
+            p = n;
+            n = HTX_LDNODE(p, next[i]);
+        }
+        preds[i] = p;
+    }
+
+    return n;
+}
+#define HTX_FIND_PREDS(s, k, preds, l)  HTMfindPreds(s, k, preds, l)
+
+
+/* =============================================================================
+ * TMfindPreds
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMfindPreds (TM_ARGDECL  skiplist_t* s, void* k, node_t** preds, long level)
+{
+    node_t* p = s->head;
+    node_t* n = NULL;
+    long i;
+
+    for (i = level - 1; i >= 0; i--) {
+        n = TX_LDNODE(p, next[i]);
+        while (n != NULL && s->compare(k, n->k) > 0) {
+            p = n;
+            n = TX_LDNODE(p, next[i]);
+        }
+        preds[i] = p;
+    }
+
+    return n;
+}
+#define TX_FIND_PREDS(s, k, preds, l)  TMfindPreds(TM_ARG  s, k, preds, l)
+
+
+/* =============================================================================
+ * insert
+ * -- Returns existing node with same key, else links a new node and returns NULL
+ * -- *failed is set if allocation fails
+ * =============================================================================
+ */
+static node_t*
+insert (skiplist_t* s, void* k, void* v, bool_t* failed)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    long level = LDF(s, level);
+    node_t* n = FIND_PREDS(s, k, preds, level);
+    long height;
+    long i;
+
+    if (n != NULL && s->compare(k, n->k) == 0) {
+        return n;
+    }
+
+    height = towerHeight(k);
+    n = getNode(height);
+    if (n == NULL) {
+        *failed = TRUE;
+        return NULL;
+    }
+    n->k = k;
+    n->v = v;
+
+    if (height > level) {
+        for (i = level; i < height; i++) {
+            preds[i] = s->head;
+        }
+        STF(s, level, height);
+    }
+
+    for (i = 0; i < height; i++) {
+        n->next[i] = LDNODE(preds[i], next[i]);
+        STF(preds[i], next[i], n);
+    }
+
+    return NULL;
+}
+#define INSERT(s, k, v, f)  insert(s, k, v, f)
+
+
+/* =============================================================================
+ * HTMinsert
+ * =============================================================================
+ */
+static node_t*
+HTMinsert (skiplist_t* s, void* k, void* v, bool_t* failed)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    long level = HTX_LDF(s, level);
+    node_t* n = HTX_FIND_PREDS(s, k, preds, level);
+    long height;
+    long i;
+
+    if (n != NULL && s->compare(k, n->k) == 0) {
+        return n;
+    }
+
+    height = towerHeight(k);
+    n = HTMgetNode(height);
+    if (n == NULL) {
+        *failed = TRUE;
+        return NULL;
+    }
+    n->k = k;
+    n->v = v;
+
+    if (height > level) {
+        for (i = level; i < height; i++) {
+            preds[i] = s->head;
+        }
+        HTX_STF(s, level, height);
+    }
+
+    for (i = 0; i < height; i++) {
+        n->next[i] = HTX_LDNODE(preds[i], next[i]);
+        HTX_STF_P(preds[i], next[i], n);
+    }
+
+    return NULL;
+}
+#define HTX_INSERT(s, k, v, f)  HTMinsert(s, k, v, f)
+
+
+/* =============================================================================
+ * TMinsert
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMinsert (TM_ARGDECL  skiplist_t* s, void* k, void* v, bool_t* failed)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    long level = TX_LDF(s, level);
+    node_t* n = TX_FIND_PREDS(s, k, preds, level);
+    long height;
+    long i;
+
+    if (n != NULL && s->compare(k, n->k) == 0) {
+        return n;
+    }
+
+    height = towerHeight(k);
+    n = TMgetNode(TM_ARG  height);
+    if (n == NULL) {
+        *failed = TRUE;
+        return NULL;
+    }
+    n->k = k;
+    n->v = v;
+
+    if (height > level) {
+        for (i = level; i < height; i++) {
+            preds[i] = s->head;
+        }
+        TX_STF(s, level, height);
+    }
+
+    for (i = 0; i < height; i++) {
+        n->next[i] = TX_LDNODE(preds[i], next[i]);
+        TX_STF_P(preds[i], next[i], n);
+    }
+
+    return NULL;
+}
+#define TX_INSERT(s, k, v, f)  TMinsert(TM_ARG  s, k, v, f)
+
+
+/* =============================================================================
+ * delete_node
+ * -- Returns unlinked node, or NULL if not found
+ * =============================================================================
+ */
+static node_t*
+delete_node (skiplist_t* s, void* k)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    node_t* n = FIND_PREDS(s, k, preds, LDF(s, level));
+    long i;
+
+    if (n == NULL || s->compare(k, n->k) != 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < n->height; i++) {
+        STF(preds[i], next[i], LDNODE(n, next[i]));
+    }
+
+    return n;
+}
+#define DELETE(s, k)  delete_node(s, k)
+
+
+/* =============================================================================
+ * HTMdelete
+ * =============================================================================
+ */
+static node_t*
+HTMdelete (skiplist_t* s, void* k)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    node_t* n = HTX_FIND_PREDS(s, k, preds, HTX_LDF(s, level));
+    long i;
+
+    if (n == NULL || s->compare(k, n->k) != 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < n->height; i++) {
+        HTX_STF_P(preds[i], next[i], HTX_LDNODE(n, next[i]));
+    }
+
+    return n;
+}
+#define HTX_DELETE(s, k)  HTMdelete(s, k)
+
+
+/* =============================================================================
+ * TMdelete
+ * =============================================================================
+ */
+TM_CALLABLE
+static node_t*
+TMdelete (TM_ARGDECL  skiplist_t* s, void* k)
+{
+    node_t* preds[SKIPLIST_MAX_LEVEL];
+    node_t* n = TX_FIND_PREDS(s, k, preds, TX_LDF(s, level));
+    long i;
+
+    if (n == NULL || s->compare(k, n->k) != 0) {
+        return NULL;
+    }
+
+    for (i = 0; i < n->height; i++) {
+        TX_STF_P(preds[i], next[i], TX_LDNODE(n, next[i]));
+    }
+
+    return n;
+}
+#define TX_DELETE(s, k)  TMdelete(TM_ARG  s, k)
+
+
+/* =============================================================================
+ * skiplist_verify
+ * -- Returns number of elements, or -1 on error
+ * =============================================================================
+ */
+long
+skiplist_verify (skiplist_t* s, long verbose)
+{
+    node_t* n;
+    long count = 0;
+    long i;
+
+    for (i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+        if (i >= s->level && s->head->next[i] != NULL) {
+            if (verbose) {
+                printf("Tower above level %ld\n", s->level);
+            }
+            return -1;
+        }
+        for (n = s->head->next[i]; n != NULL; n = n->next[i]) {
+            if (n->height <= i) {
+                if (verbose) {
+                    printf("Node %p linked above its height\n", n);
+                }
+                return -1;
+            }
+            if (n->next[i] != NULL && s->compare(n->k, n->next[i]->k) >= 0) {
+                if (verbose) {
+                    printf("Level %ld out of order at %p\n", i, n);
+                }
+                return -1;
+            }
+            if (i == 0) {
+                count++;
+            }
+        }
+    }
+
+    if (verbose) {
+        printf("Integrity check: ");
+        printf("%ld elements, level %ld\n", count, s->level);
+    }
+
+    return count;
+}
+
+
+/* =============================================================================
+ * skiplist_compare
+ * =============================================================================
+ */
+long
+skiplist_compare (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * skiplist_alloc
+ * =============================================================================
+ */
+skiplist_t*
+skiplist_alloc (long (*compare)(const void*, const void*))
+{
+    skiplist_t* s = (skiplist_t*)malloc(sizeof(*s));
+    if (s) {
+        s->head = getNode(SKIPLIST_MAX_LEVEL);
+        if (s->head == NULL) {
+            free(s);
+            return NULL;
+        }
+        for (long i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+            s->head->next[i] = NULL;
+        }
+        s->level = 1;
+        skiplist_setCompare(s, compare ? compare : skiplist_compare);
+    }
+    return s;
+}
+
+
+/* =============================================================================
+ * HTMskiplist_alloc
+ * =============================================================================
+ */
+skiplist_t*
+HTMskiplist_alloc (long (*compare)(const void*, const void*))
+{
+    skiplist_t* s = (skiplist_t*)HTM_MALLOC(sizeof(*s));
+    if (s) {
+        s->head = HTMgetNode(SKIPLIST_MAX_LEVEL);
+        if (s->head == NULL) {
+            HTM_FREE(s);
+            return NULL;
+        }
+        for (long i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+            s->head->next[i] = NULL;
+        }
+        s->level = 1;
+        skiplist_setCompare(s, compare ? compare : skiplist_compare);
+    }
+    return s;
+}
+
+
+/* =============================================================================
+ * TMskiplist_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+skiplist_t*
+TMskiplist_alloc (TM_ARGDECL  long (*compare)(const void*, const void*))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_ALLOC, NULL, compare);
+#endif /* ORIGINAL */
+
+    skiplist_t* s = (skiplist_t*)TM_MALLOC(sizeof(*s));
+    if (s) {
+        s->head = TMgetNode(TM_ARG  SKIPLIST_MAX_LEVEL);
+        if (s->head == NULL) {
+            TM_FREE(s);
+            s = NULL;
+            goto out;
+        }
+        for (long i = 0; i < SKIPLIST_MAX_LEVEL; i++) {
+            s->head->next[i] = NULL;
+        }
+        s->level = 1;
+        skiplist_setCompare(s, compare ? compare : skiplist_compare);
+    }
+
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_ALLOC, &s);
+#endif /* ORIGINAL */
+    return s;
+}
+
+
+/* =============================================================================
+ * skiplist_free
+ * =============================================================================
+ */
+void
+skiplist_free (skiplist_t* s, void (*freeData)(void *, void *))
+{
+    node_t* n = s->head->next[0];
+
+    while (n != NULL) {
+        node_t* next = n->next[0];
+        if (freeData) {
+            freeData(n->k, n->v);
+        }
+        releaseNode(n);
+        n = next;
+    }
+
+    releaseNode(s->head);
+    free(s);
+}
+
+
+/* =============================================================================
+ * HTMskiplist_free
+ * =============================================================================
+ */
+void
+HTMskiplist_free (skiplist_t* s, void (*HTMfreeData)(void *, void *))
+{
+    node_t* n = HTX_LDNODE(s->head, next[0]);
+
+    while (n != NULL) {
+        node_t* next = HTX_LDNODE(n, next[0]);
+        if (HTMfreeData) {
+            HTMfreeData(n->k, HTX_LDF_P(n, v));
+        }
+        HTMreleaseNode(n);
+        n = next;
+    }
+
+    HTMreleaseNode(s->head);
+    HTM_FREE(s);
+}
+
+
+/* =============================================================================
+ * TMskiplist_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMskiplist_free (TM_ARGDECL  skiplist_t* s, TM_CALLABLE void (*TMfreeData)(void *, void *))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_FREE, NULL, s);
+#endif /* ORIGINAL */
+    node_t* n = TX_LDNODE(s->head, next[0]);
+
+    while (n != NULL) {
+        node_t* next = TX_LDNODE(n, next[0]);
+        if (TMfreeData) {
+            TMfreeData(TM_ARG  n->k, TX_LDF_P(n, v));
+        }
+        TMreleaseNode(TM_ARG  n);
+        n = next;
+    }
+
+    TMreleaseNode(TM_ARG  s->head);
+    TM_FREE(s);
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_FREE, NULL);
+#endif /* ORIGINAL */
+}
+
+
+/* =============================================================================
+ * skiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+skiplist_insert (skiplist_t* s, void* key, void* val)
+{
+    bool_t failed = FALSE;
+    node_t* ex = INSERT(s, key, val, &failed);
+    return ((ex == NULL && !failed) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMskiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+HTMskiplist_insert (skiplist_t* s, void* key, void* val)
+{
+    bool_t failed = FALSE;
+    node_t* ex = HTX_INSERT(s, key, val, &failed);
+    return ((ex == NULL && !failed) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * TMskiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_insert (TM_ARGDECL  skiplist_t* s, void* key, void* val)
+{
+    bool_t rv;
+    bool_t failed = FALSE;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_INSERT, NULL, s, key, val);
+#endif /* ORIGINAL */
+    node_t* ex = TX_INSERT(s, key, val, &failed);
+    rv = (ex == NULL && !failed) ? TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_INSERT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * skiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+skiplist_delete (skiplist_t* s, void* key)
+{
+    node_t* node = DELETE(s, key);
+    if (node != NULL) {
+        releaseNode(node);
+    }
+    return ((node != NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMskiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+HTMskiplist_delete (skiplist_t* s, void* key)
+{
+    node_t* node = HTX_DELETE(s, key);
+    if (node != NULL) {
+        HTMreleaseNode(node);
+    }
+    return ((node != NULL) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * TMskiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_delete (TM_ARGDECL  skiplist_t* s, void* key)
+{
+    bool_t rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_DELETE, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* node = TX_DELETE(s, key);
+    if (node != NULL) {
+        TMreleaseNode(TM_ARG  node);
+    }
+    rv = (node != NULL) ? TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_DELETE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * skiplist_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+bool_t
+skiplist_update (skiplist_t* s, void* key, void* val)
+{
+    bool_t failed = FALSE;
+    node_t* ex = INSERT(s, key, val, &failed);
+    if (ex != NULL) {
+        STF(ex, v, val);
+        return TRUE;
+    }
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * TMskiplist_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_update (TM_ARGDECL  skiplist_t* s, void* key, void* val)
+{
+    bool_t rv = FALSE;
+    bool_t failed = FALSE;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_UPDATE, NULL, s, key, val);
+#endif /* ORIGINAL */
+    node_t* ex = TX_INSERT(s, key, val, &failed);
+    if (ex != NULL) {
+        TX_STF_P(ex, v, val);
+        rv = TRUE;
+    }
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_UPDATE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * skiplist_get
+ * =============================================================================
+ */
+void*
+skiplist_get (skiplist_t* s, void* key)
+{
+    node_t* n = LOOKUP(s, key);
+    if (n != NULL) {
+        return LDF(n, v);
+    }
+    return NULL;
+}
+
+
+/* =============================================================================
+ * HTMskiplist_get
+ * =============================================================================
+ */
+void*
+HTMskiplist_get (skiplist_t* s, void* key)
+{
+    void* val = NULL;
+    node_t* n = HTX_LOOKUP(s, key);
+    if (n != NULL) {
+        val = HTX_LDF_P(n, v);
+    }
+    return val;
+}
+
+
+/* =============================================================================
+ * TMskiplist_get
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMskiplist_get (TM_ARGDECL  skiplist_t* s, void* key)
+{
+    void* val = NULL;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_GET, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(s, key);
+    if (n != NULL) {
+        val = TX_LDF_P(n, v);
+    }
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_GET, &val);
+#endif /* ORIGINAL */
+    return val;
+}
+
+
+/* =============================================================================
+ * skiplist_contains
+ * =============================================================================
+ */
+long
+skiplist_contains (skiplist_t* s, void* key)
+{
+    node_t* n = LOOKUP(s, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * HTMskiplist_contains
+ * =============================================================================
+ */
+long
+HTMskiplist_contains (skiplist_t* s, void* key)
+{
+    node_t* n = HTX_LOOKUP(s, key);
+    return (n != NULL);
+}
+
+
+/* =============================================================================
+ * TMskiplist_contains
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMskiplist_contains (TM_ARGDECL  skiplist_t* s, void* key)
+{
+    long rv;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(SKIPLIST_CONTAINS, NULL, s, key);
+#endif /* ORIGINAL */
+    node_t* n = TX_LOOKUP(s, key);
+    rv = (n != NULL);
+#ifndef ORIGINAL
+    TM_LOG_END(SKIPLIST_CONTAINS, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * skiplist_setCompare
+ * =============================================================================
+ */
+void
+skiplist_setCompare (skiplist_t* s, long (*compare)(const void*, const void*))
+{
+    STF(s, compare, compare);
+}
+
+
+/* =============================================================================
+ * skiplist_iterate
+ * -- Visits elements in key order
+ * =============================================================================
+ */
+void
+skiplist_iterate (skiplist_t* s, void (*cb)(void *, void *))
+{
+    node_t* n;
+
+    for (n = LDNODE(s->head, next[0]); n != NULL; n = LDNODE(n, next[0])) {
+        if (cb) {
+            cb(LDF(n, k), LDF(n, v));
+        }
+    }
+}
+
+
+/* /////////////////////////////////////////////////////////////////////////////
+ * TEST_SKIPLIST
+ * /////////////////////////////////////////////////////////////////////////////
+ */
+#ifdef TEST_SKIPLIST
+
+
+#include <assert.h>
+#include <stdio.h>
+
+
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+static void
+insertInt (skiplist_t* skiplistPtr, long* data)
+{
+    printf("Inserting: %li\n", *data);
+    skiplist_insert(skiplistPtr, (void*)data, (void*)data);
+    assert(*(long*)skiplist_get(skiplistPtr, (void*)data) == *data);
+    assert(skiplist_verify(skiplistPtr, 0) > 0);
+}
+
+
+static void
+removeInt (skiplist_t* skiplistPtr, long* data)
+{
+    printf("Removing: %li\n", *data);
+    skiplist_delete(skiplistPtr, (void*)data);
+    assert(skiplist_get(skiplistPtr, (void*)data) == NULL);
+    assert(skiplist_verify(skiplistPtr, 0) >= 0);
+}
+
+
+int
+main ()
+{
+    long data[] = {3, 1, 4, 1, 5, 9, 2, 6, 5, 3, 5, 8, 9, 7};
+    long numData = sizeof(data) / sizeof(data[0]);
+    long i;
+
+    puts("Starting...");
+
+    skiplist_t* skiplistPtr = skiplist_alloc(&compare);
+    assert(skiplistPtr);
+
+    for (i = 0; i < numData; i++) {
+        insertInt(skiplistPtr, &data[i]);
+    }
+    assert(skiplist_verify(skiplistPtr, 1) == 9);
+
+    for (i = 0; i < numData; i++) {
+        removeInt(skiplistPtr, &data[i]);
+    }
+    assert(skiplist_verify(skiplistPtr, 1) == 0);
+
+    /* Default compare on pointer values, with enough keys to grow towers */
+    skiplist_setCompare(skiplistPtr, skiplist_compare);
+    for (i = 1; i <= 4096; i++) {
+        assert(skiplist_insert(skiplistPtr, (void*)((i * 7919) % 4099), (void*)i));
+    }
+    assert(skiplist_verify(skiplistPtr, 1) == 4096);
+    assert(!skiplist_insert(skiplistPtr, (void*)(7919 % 4099), NULL));
+    assert(skiplist_update(skiplistPtr, (void*)(7919 % 4099), (void*)-1));
+    assert(skiplist_get(skiplistPtr, (void*)(7919 % 4099)) == (void*)-1);
+    for (i = 1; i <= 4096; i += 2) {
+        assert(skiplist_delete(skiplistPtr, (void*)((i * 7919) % 4099)));
+    }
+    assert(skiplist_verify(skiplistPtr, 1) == 2048);
+
+    skiplist_free(skiplistPtr, NULL);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_SKIPLIST */
+
+
+/* =============================================================================
+ *
+ * End of skiplist.c
+ *
+ * =============================================================================
+ */
+
+#ifndef ORIGINAL
+__attribute__((constructor)) void skiplist_init() {
+    TM_LOG_FFI_DECLARE;
+    TM_LOG_TYPE_DECLARE_INIT(*ppp[], {&ffi_type_pointer, &ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*pp[], {&ffi_type_pointer, &ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*p[], {&ffi_type_pointer});
+    # define TM_LOG_OP TM_LOG_OP_INIT
+    # include "skiplist.inc"
+    # undef TM_LOG_OP
+}
+#endif /* ORIGINAL */
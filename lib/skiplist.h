@@ -0,0 +1,274 @@
+/* =============================================================================
+ *
+ * skiplist.h
+ * -- Sorted skip list map, same interface as rbtree.h
+ *
+ * =============================================================================
+ *
+ * Selected as the map backend with -DMAP_USE_SKIPLIST. An insertion or
+ * deletion only writes the forward pointers of the neighbouring towers, so
+ * unlike tree rotations it does not create write hotspots near the root.
+ * Tower heights are derived from a hash of the key instead of a shared
+ * random number generator, which would otherwise be a conflict point.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef SKIPLIST_H
+#define SKIPLIST_H 1
+
+
+#include "tm.h"
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define SKIPLIST_MAX_LEVEL (32)
+
+
+typedef struct skiplist skiplist_t;
+
+
+/* =============================================================================
+ * skiplist_compare
+ * =============================================================================
+ */
+long
+skiplist_compare (const void* a, const void* b);
+
+
+/* =============================================================================
+ * skiplist_verify
+ * -- Returns number of elements, or -1 on error
+ * =============================================================================
+ */
+long
+skiplist_verify (skiplist_t* s, long verbose);
+
+
+/* =============================================================================
+ * skiplist_alloc
+ * =============================================================================
+ */
+skiplist_t*
+skiplist_alloc (long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * HTMskiplist_alloc
+ * =============================================================================
+ */
+skiplist_t*
+HTMskiplist_alloc (long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * TMskiplist_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+skiplist_t*
+TMskiplist_alloc (TM_ARGDECL  long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * skiplist_free
+ * =============================================================================
+ */
+void
+skiplist_free (skiplist_t* s, void (*freeData)(void *, void *));
+
+
+/* =============================================================================
+ * HTMskiplist_free
+ * =============================================================================
+ */
+void
+HTMskiplist_free (skiplist_t* s, void (*HTMfreeData)(void *, void *));
+
+
+/* =============================================================================
+ * TMskiplist_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMskiplist_free (TM_ARGDECL  skiplist_t* s, TM_CALLABLE void (*TMfreeData)(void *, void *));
+
+
+/* =============================================================================
+ * skiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+skiplist_insert (skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * HTMskiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+bool_t
+HTMskiplist_insert (skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * TMskiplist_insert
+ * -- Returns TRUE on success
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_insert (TM_ARGDECL  skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * skiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+skiplist_delete (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMskiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+bool_t
+HTMskiplist_delete (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * TMskiplist_delete
+ * -- Returns TRUE if key exists
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_delete (TM_ARGDECL  skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+bool_t
+skiplist_update (skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * TMskiplist_update
+ * -- Return FALSE if had to insert node first
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMskiplist_update (TM_ARGDECL  skiplist_t* s, void* key, void* val);
+
+
+/* =============================================================================
+ * skiplist_get
+ * =============================================================================
+ */
+void*
+skiplist_get (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMskiplist_get
+ * =============================================================================
+ */
+void*
+HTMskiplist_get (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * TMskiplist_get
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMskiplist_get (TM_ARGDECL  skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_contains
+ * =============================================================================
+ */
+long
+skiplist_contains (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * HTMskiplist_contains
+ * =============================================================================
+ */
+long
+HTMskiplist_contains (skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * TMskiplist_contains
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMskiplist_contains (TM_ARGDECL  skiplist_t* s, void* key);
+
+
+/* =============================================================================
+ * skiplist_setCompare
+ * =============================================================================
+ */
+void
+skiplist_setCompare (skiplist_t* s, long (*compare)(const void*, const void*));
+
+
+/* =============================================================================
+ * skiplist_iterate
+ * -- Visits elements in key order
+ * =============================================================================
+ */
+void
+skiplist_iterate (skiplist_t* s, void (*cb)(void *, void *));
+
+#define HTMSKIPLIST_ALLOC(cmp)      HTMskiplist_alloc(cmp)
+#define HTMSKIPLIST_FREE(s, free)   HTMskiplist_free(s, free)
+#define HTMSKIPLIST_INSERT(s, k, v) HTMskiplist_insert(s, (void*)(k), (void*)(v))
+#define HTMSKIPLIST_DELETE(s, k)    HTMskiplist_delete(s, (void*)(k))
+#define HTMSKIPLIST_GET(s, k)       HTMskiplist_get(s, (void*)(k))
+#define HTMSKIPLIST_CONTAINS(s, k)  HTMskiplist_contains(s, (void*)(k))
+
+#define TMSKIPLIST_ALLOC(cmp)       TMskiplist_alloc(TM_ARG  cmp)
+#define TMSKIPLIST_FREE(s, free)    TMskiplist_free(TM_ARG  s, free)
+#define TMSKIPLIST_INSERT(s, k, v)  TMskiplist_insert(TM_ARG  s, (void*)(k), (void*)(v))
+#define TMSKIPLIST_DELETE(s, k)     TMskiplist_delete(TM_ARG  s, (void*)(k))
+#define TMSKIPLIST_UPDATE(s, k, v)  TMskiplist_update(TM_ARG  s, (void*)(k), (void*)(v))
+#define TMSKIPLIST_GET(s, k)        TMskiplist_get(TM_ARG  s, (void*)(k))
+#define TMSKIPLIST_CONTAINS(s, k)   TMskiplist_contains(TM_ARG  s, (void*)(k))
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* SKIPLIST_H */
+
+
+/* =============================================================================
+ *
+ * End of skiplist.h
+ *
+ * =============================================================================
+ */
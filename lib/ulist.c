@@ -0,0 +1,1646 @@
+/* =============================================================================
+ *
+ * ulist.c
+ * -- Sorted unrolled linked list, storage layout for list.h
+ * -- Selected with -DLIST_USE_UNROLLED, exports the same list_* API
+ * -- Options: -DLIST_NO_DUPLICATES (default: allow duplicates)
+ *
+ * =============================================================================
+ *
+ * A traversal stops at the first node whose last element is >= the key, so
+ * each visited node costs one line and reads only 'count', 'nextPtr' and the
+ * last data pointer. A full node is split in half on insert, and a node is
+ * unlinked once its last element is removed.
+ *
+ * The transactional operations are registered in ulist.inc under the same
+ * opcodes as list.inc, but without merge functions, so -DMERGE_LIST has no
+ * effect here and conflicts fall back to a restart.
+ *
+ * =============================================================================
+ */
+
+
+#include <stdlib.h>
+#include <assert.h>
+#include "list.h"
+#include "types.h"
+#include "tm.h"
+
+#ifdef LIST_USE_UNROLLED
+
+#ifndef ORIGINAL
+# define TM_LOG_OP TM_LOG_OP_DECLARE
+# include "ulist.inc"
+# undef TM_LOG_OP
+#endif /* ORIGINAL */
+
+/* =============================================================================
+ * DECLARATION OF TM_CALLABLE FUNCTIONS
+ * =============================================================================
+ */
+
+TM_CALLABLE
+static list_node_t*
+TMfindNode (TM_ARGDECL  list_t* listPtr, void* dataPtr, list_node_t** prevPtrPtr);
+
+TM_CALLABLE
+static void
+TMfreeList (TM_ARGDECL  list_node_t* nodePtr, TM_CALLABLE void (*TMfreeData)(void *));
+
+TM_CALLABLE
+void
+TMlist_free (TM_ARGDECL  list_t* listPtr, TM_CALLABLE void (*TMfreeData)(void *));
+
+/* =============================================================================
+ * list_compare
+ * -- Default compare function
+ * =============================================================================
+ */
+long
+list_compare (const void* a, const void* b)
+{
+    return ((long)a - (long)b);
+}
+
+
+/* =============================================================================
+ * list_iter_reset
+ * =============================================================================
+ */
+void
+list_iter_reset (list_iter_t* itPtr, list_t* listPtr)
+{
+    itPtr->nodePtr = NULL;
+    itPtr->index = -1;
+}
+
+
+/* =============================================================================
+ * HTMlist_iter_reset
+ * =============================================================================
+ */
+void
+HTMlist_iter_reset (list_iter_t* itPtr, list_t* listPtr)
+{
+    HTM_LOCAL_WRITE_P(itPtr->nodePtr, NULL);
+    HTM_LOCAL_WRITE(itPtr->index, -1);
+}
+
+
+/* =============================================================================
+ * TMlist_iter_reset
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMlist_iter_reset (TM_ARGDECL  list_iter_t* itPtr, list_t* listPtr)
+{
+    TM_LOCAL_WRITE_P(itPtr->nodePtr, NULL);
+    TM_LOCAL_WRITE(itPtr->index, -1);
+}
+
+
+/* =============================================================================
+ * list_iter_hasNext
+ * =============================================================================
+ */
+bool_t
+list_iter_hasNext (list_iter_t* itPtr, list_t* listPtr)
+{
+    list_node_t* nodePtr = itPtr->nodePtr;
+
+    if (nodePtr == NULL) {
+        return ((listPtr->firstPtr != NULL) ? TRUE : FALSE);
+    }
+
+    return (((itPtr->index + 1 < nodePtr->count) ||
+             (nodePtr->nextPtr != NULL)) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * HTMlist_iter_hasNext
+ * =============================================================================
+ */
+bool_t
+HTMlist_iter_hasNext (list_iter_t* itPtr, list_t* listPtr)
+{
+    bool_t rv;
+    list_node_t* nodePtr = itPtr->nodePtr;
+
+    if (nodePtr == NULL) {
+        rv = ((list_node_t*)HTM_SHARED_READ_P(listPtr->firstPtr) != NULL) ? TRUE : FALSE;
+    } else {
+        rv = ((itPtr->index + 1 < (long)HTM_SHARED_READ(nodePtr->count)) ||
+              ((list_node_t*)HTM_SHARED_READ_P(nodePtr->nextPtr) != NULL)) ? TRUE : FALSE;
+    }
+
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMlist_iter_hasNext
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMlist_iter_hasNext (TM_ARGDECL  list_iter_t* itPtr, list_t* listPtr)
+{
+    bool_t rv;
+    list_node_t* nodePtr = itPtr->nodePtr;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_IT_HASNEXT, NULL, nodePtr, listPtr);
+#endif /* ORIGINAL */
+
+    if (nodePtr == NULL) {
+        rv = ((list_node_t*)TM_SHARED_READ_TAG_P(listPtr->firstPtr, (uintptr_t)listPtr) != NULL) ?
+             TRUE : FALSE;
+    } else {
+        rv = ((itPtr->index + 1 < (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr)) ||
+              ((list_node_t*)TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr) != NULL)) ?
+             TRUE : FALSE;
+    }
+
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_IT_HASNEXT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * list_iter_next
+ * =============================================================================
+ */
+void*
+list_iter_next (list_iter_t* itPtr, list_t* listPtr)
+{
+    list_node_t* nodePtr = itPtr->nodePtr;
+    long index = itPtr->index + 1;
+
+    if (nodePtr == NULL) {
+        nodePtr = listPtr->firstPtr;
+        index = 0;
+    } else if (index >= nodePtr->count) {
+        nodePtr = nodePtr->nextPtr;
+        index = 0;
+    }
+
+    itPtr->nodePtr = nodePtr;
+    itPtr->index = index;
+
+    return nodePtr->dataPtrs[index];
+}
+
+
+/* =============================================================================
+ * HTMlist_iter_next
+ * =============================================================================
+ */
+void*
+HTMlist_iter_next (list_iter_t* itPtr, list_t* listPtr)
+{
+    list_node_t* nodePtr = itPtr->nodePtr;
+    long index = itPtr->index + 1;
+
+    if (nodePtr == NULL) {
+        nodePtr = (list_node_t*)HTM_SHARED_READ_P(listPtr->firstPtr);
+        index = 0;
+    } else if (index >= (long)HTM_SHARED_READ(nodePtr->count)) {
+        nodePtr = (list_node_t*)HTM_SHARED_READ_P(nodePtr->nextPtr);
+        index = 0;
+    }
+
+    HTM_LOCAL_WRITE_P(itPtr->nodePtr, nodePtr);
+    HTM_LOCAL_WRITE(itPtr->index, index);
+
+    void* r = HTM_SHARED_READ_P(nodePtr->dataPtrs[index]);
+    return r;
+}
+
+
+/* =============================================================================
+ * TMlist_iter_next
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMlist_iter_next (TM_ARGDECL  list_iter_t* itPtr, list_t* listPtr)
+{
+    list_node_t* nodePtr = itPtr->nodePtr;
+    long index = itPtr->index + 1;
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_IT_NEXT, NULL, nodePtr, listPtr);
+#endif /* ORIGINAL */
+
+    if (nodePtr == NULL) {
+        nodePtr = (list_node_t*)TM_SHARED_READ_TAG_P(listPtr->firstPtr, (uintptr_t)listPtr);
+        index = 0;
+    } else if (index >= (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr)) {
+        nodePtr = (list_node_t*)TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr);
+        index = 0;
+    }
+
+    TM_LOCAL_WRITE_P(itPtr->nodePtr, nodePtr);
+    TM_LOCAL_WRITE(itPtr->index, index);
+
+    void* r = TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[index], (uintptr_t)nodePtr);
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_IT_NEXT, &r);
+#endif /* ORIGINAL */
+    return r;
+}
+
+
+/* =============================================================================
+ * NODE_BLOCK_SIZE
+ * -- Transactional allocators do not align, so every allocator takes this much
+ *    per node and places the node at a line boundary inside the block, with
+ *    the block's address in the word just below the node for the free
+ * =============================================================================
+ */
+#define NODE_BLOCK_SIZE (sizeof(void*) + LIST_LINE_SIZE - 1 + sizeof(list_node_t))
+
+
+/* =============================================================================
+ * placeNode
+ * -- Returns NULL if 'blockPtr' is NULL
+ * =============================================================================
+ */
+TM_PURE
+static list_node_t*
+placeNode (void* blockPtr)
+{
+    if (blockPtr == NULL) {
+        return NULL;
+    }
+
+    unsigned long address = (unsigned long)blockPtr + sizeof(void*);
+    address = (address + LIST_LINE_SIZE - 1) & ~(unsigned long)(LIST_LINE_SIZE - 1);
+    ((void**)address)[-1] = blockPtr;
+
+    return (list_node_t*)address;
+}
+
+
+/* =============================================================================
+ * nodeBlock
+ * -- Returns the block placeNode() put 'nodePtr' in
+ * =============================================================================
+ */
+TM_PURE
+static void*
+nodeBlock (list_node_t* nodePtr)
+{
+    return ((void**)nodePtr)[-1];
+}
+
+
+/* =============================================================================
+ * allocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static list_node_t*
+allocNode ()
+{
+    list_node_t* nodePtr = placeNode(malloc(NODE_BLOCK_SIZE));
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    nodePtr->count = 0;
+    nodePtr->nextPtr = NULL;
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * PallocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static list_node_t*
+PallocNode ()
+{
+    list_node_t* nodePtr = placeNode(P_MALLOC(NODE_BLOCK_SIZE));
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    nodePtr->count = 0;
+    nodePtr->nextPtr = NULL;
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * HTMallocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static list_node_t*
+HTMallocNode ()
+{
+    list_node_t* nodePtr = placeNode(HTM_MALLOC(NODE_BLOCK_SIZE));
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    nodePtr->count = 0;
+    nodePtr->nextPtr = NULL;
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * TMallocNode
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static list_node_t*
+TMallocNode (TM_ARGDECL_ALONE)
+{
+    list_node_t* nodePtr = placeNode(TM_MALLOC(NODE_BLOCK_SIZE));
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    nodePtr->count = 0;
+    nodePtr->nextPtr = NULL;
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * list_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+list_t*
+list_alloc (long (*compare)(const void*, const void*))
+{
+    list_t* listPtr = (list_t*)malloc(sizeof(list_t));
+    if (listPtr == NULL) {
+        return NULL;
+    }
+
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+
+    list_setCompare(listPtr, compare ? compare : list_compare);
+
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * Plist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+list_t*
+Plist_alloc (long (*compare)(const void*, const void*))
+{
+    list_t* listPtr = (list_t*)P_MALLOC(sizeof(list_t));
+    if (listPtr == NULL) {
+        return NULL;
+    }
+
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+
+    list_setCompare(listPtr, compare ? compare : list_compare);
+
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * HTMlist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+list_t*
+HTMlist_alloc (long (*compare)(const void*, const void*))
+{
+    list_t* listPtr = (list_t*)HTM_MALLOC(sizeof(list_t));
+    if (listPtr == NULL)
+        goto out;
+
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+    list_setCompare(listPtr, compare ? compare : list_compare);
+
+out:
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * TMlist_alloc
+ * -- If NULL passed for 'compare' function, will compare data pointer addresses
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+TM_CALLABLE
+list_t*
+TMlist_alloc (TM_ARGDECL  long (*compare)(const void*, const void*))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_ALLOC, NULL, compare);
+#endif /* ORIGINAL */
+
+    list_t* listPtr = (list_t*)TM_MALLOC(sizeof(list_t));
+    if (listPtr == NULL)
+        goto out;
+
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+    list_setCompare(listPtr, compare ? compare : list_compare);
+
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_ALLOC, &listPtr);
+#endif /* ORIGINAL */
+    return listPtr;
+}
+
+
+/* =============================================================================
+ * freeNode
+ * =============================================================================
+ */
+static void
+freeNode (list_node_t* nodePtr)
+{
+    free(nodeBlock(nodePtr));
+}
+
+
+/* =============================================================================
+ * PfreeNode
+ * =============================================================================
+ */
+static void
+PfreeNode (list_node_t* nodePtr)
+{
+    P_FREE(nodeBlock(nodePtr));
+}
+
+
+/* =============================================================================
+ * HTMfreeNode
+ * =============================================================================
+ */
+static void
+HTMfreeNode (list_node_t* nodePtr)
+{
+    HTM_FREE(nodeBlock(nodePtr));
+}
+
+
+/* =============================================================================
+ * TMfreeNode
+ * =============================================================================
+ */
+static void
+TMfreeNode (TM_ARGDECL  list_node_t* nodePtr)
+{
+    TM_FREE(nodeBlock(nodePtr));
+}
+
+
+/* =============================================================================
+ * freeList
+ * =============================================================================
+ */
+static void
+freeList (list_node_t* nodePtr, void (*freeData)(void *))
+{
+    list_node_t *nextPtr;
+    long i;
+
+    while (nodePtr) {
+        nextPtr = nodePtr->nextPtr;
+        if (freeData) {
+            for (i = 0; i < nodePtr->count; i++) {
+                freeData(nodePtr->dataPtrs[i]);
+            }
+        }
+        freeNode(nodePtr);
+        nodePtr = nextPtr;
+    }
+}
+
+
+/* =============================================================================
+ * PfreeList
+ * =============================================================================
+ */
+static void
+PfreeList (list_node_t* nodePtr, void (*PfreeData)(void *))
+{
+    list_node_t *nextPtr;
+    long i;
+
+    while (nodePtr) {
+        nextPtr = nodePtr->nextPtr;
+        if (PfreeData) {
+            for (i = 0; i < nodePtr->count; i++) {
+                PfreeData(nodePtr->dataPtrs[i]);
+            }
+        }
+        PfreeNode(nodePtr);
+        nodePtr = nextPtr;
+    }
+}
+
+
+/* =============================================================================
+ * HTMfreeList
+ * =============================================================================
+ */
+static void
+HTMfreeList (list_node_t* nodePtr, void (*HTMfreeData)(void *))
+{
+    long i;
+
+    while (nodePtr) {
+        list_node_t *nextPtr = HTM_SHARED_READ_P(nodePtr->nextPtr);
+        if (HTMfreeData) {
+            long count = (long)HTM_SHARED_READ(nodePtr->count);
+            for (i = 0; i < count; i++) {
+                HTMfreeData(HTM_SHARED_READ_P(nodePtr->dataPtrs[i]));
+            }
+        }
+        HTMfreeNode(nodePtr);
+        nodePtr = nextPtr;
+    }
+}
+
+
+/* =============================================================================
+ * TMfreeList
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+TMfreeList (TM_ARGDECL  list_node_t* nodePtr, TM_CALLABLE void (*TMfreeData)(void *))
+{
+    long i;
+
+    while (nodePtr) {
+        list_node_t *nextPtr = TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr);
+        if (TMfreeData) {
+            long count = (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr);
+            for (i = 0; i < count; i++) {
+                TMfreeData(TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i], (uintptr_t)nodePtr));
+            }
+        }
+        TMfreeNode(TM_ARG  nodePtr);
+        nodePtr = nextPtr;
+    }
+}
+
+
+/* =============================================================================
+ * list_free
+ * =============================================================================
+ */
+void
+list_free (list_t* listPtr, void (*freeData)(void *))
+{
+    freeList(listPtr->firstPtr, freeData);
+    free(listPtr);
+}
+
+
+/* =============================================================================
+ * Plist_free
+ * =============================================================================
+ */
+void
+Plist_free (list_t* listPtr, void (*PfreeData)(void *))
+{
+    PfreeList(listPtr->firstPtr, PfreeData);
+    P_FREE(listPtr);
+}
+
+
+/* =============================================================================
+ * HTMlist_free
+ * =============================================================================
+ */
+void
+HTMlist_free (list_t* listPtr, void (*HTMfreeData)(void *))
+{
+    list_node_t* firstPtr = (list_node_t*)HTM_SHARED_READ_P(listPtr->firstPtr);
+    HTMfreeList(firstPtr, HTMfreeData);
+    HTM_FREE(listPtr);
+}
+
+
+/* =============================================================================
+ * TMlist_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMlist_free (TM_ARGDECL  list_t* listPtr, TM_CALLABLE void (*TMfreeData)(void *))
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_FREE, NULL, listPtr);
+#endif /* ORIGINAL */
+    list_node_t* firstPtr = (list_node_t*)TM_SHARED_READ_TAG_P(listPtr->firstPtr, (uintptr_t)listPtr);
+    TMfreeList(TM_ARG  firstPtr, TMfreeData);
+    TM_FREE(listPtr);
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_FREE, NULL);
+#endif /* ORIGINAL */
+}
+
+
+/* =============================================================================
+ * list_isEmpty
+ * -- Return TRUE if list is empty, else FALSE
+ * =============================================================================
+ */
+bool_t
+list_isEmpty (list_t* listPtr)
+{
+    return (listPtr->firstPtr == NULL);
+}
+
+
+/* =============================================================================
+ * TMlist_isEmpty
+ * -- Return TRUE if list is empty, else FALSE
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMlist_isEmpty (TM_ARGDECL  list_t* listPtr)
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_ISEMPTY, NULL, listPtr);
+#endif /* ORIGINAL */
+    bool_t rv = ((void*)TM_SHARED_READ_TAG_P(listPtr->firstPtr, (uintptr_t)listPtr) == NULL) ?
+            TRUE : FALSE;
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_ISEMPTY, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * list_getSize
+ * -- Returns the size of the list
+ * =============================================================================
+ */
+long
+list_getSize (list_t* listPtr)
+{
+    return listPtr->size;
+}
+
+
+/* =============================================================================
+ * HTMlist_getSize
+ * -- Returns the size of the list
+ * =============================================================================
+ */
+long
+HTMlist_getSize (list_t* listPtr)
+{
+    return HTM_SHARED_READ(listPtr->size);
+}
+
+
+/* =============================================================================
+ * TMlist_getSize
+ * -- Returns the size of the list
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+TMlist_getSize (TM_ARGDECL  list_t* listPtr)
+{
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_GETSZ, NULL, listPtr);
+#endif /* ORIGINAL */
+    long rv = TM_SHARED_READ_TAG(listPtr->size, (uintptr_t)listPtr);
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_GETSZ, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * findNode
+ * -- Returns the node that holds (or should hold) dataPtr, NULL if empty
+ * -- Stores the preceding node, or NULL if first, into *prevPtrPtr
+ * =============================================================================
+ */
+static list_node_t*
+findNode (list_t* listPtr, void* dataPtr, list_node_t** prevPtrPtr)
+{
+    list_node_t* prevPtr = NULL;
+    list_node_t* nodePtr = listPtr->firstPtr;
+    list_node_t* nextPtr;
+
+    for (; nodePtr != NULL; nodePtr = nextPtr) {
+        nextPtr = nodePtr->nextPtr;
+        if ((nextPtr == NULL) ||
+            (listPtr->compare(nodePtr->dataPtrs[nodePtr->count - 1], dataPtr) >= 0)) {
+            break;
+        }
+        prevPtr = nodePtr;
+    }
+
+    *prevPtrPtr = prevPtr;
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * HTMfindNode
+ * =============================================================================
+ */
+static list_node_t*
+HTMfindNode (list_t* listPtr, void* dataPtr, list_node_t** prevPtrPtr)
+{
+    list_node_t* prevPtr = NULL;
+    list_node_t* nodePtr;
+    list_node_t* nextPtr;
+
+    for (nodePtr = (list_node_t*)HTM_SHARED_READ_P(listPtr->firstPtr);
+         nodePtr != NULL;
+         nodePtr = nextPtr)
+    {
+        nextPtr = (list_node_t*)HTM_SHARED_READ_P(nodePtr->nextPtr);
+        if (nextPtr == NULL)
+            break;
+        if (listPtr->compare(HTM_SHARED_READ_P(nodePtr->dataPtrs[(long)HTM_SHARED_READ(nodePtr->count) - 1]), dataPtr) >= 0)
+            break;
+        prevPtr = nodePtr;
+    }
+
+    *prevPtrPtr = prevPtr;
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * TMfindNode
+ * =============================================================================
+ */
+TM_CALLABLE
+static list_node_t*
+TMfindNode (TM_ARGDECL  list_t* listPtr, void* dataPtr, list_node_t** prevPtrPtr)
+{
+    list_node_t* prevPtr = NULL;
+    list_node_t* nodePtr;
+    list_node_t* nextPtr;
+
+    for (nodePtr = (list_node_t*)TM_SHARED_READ_TAG_P(listPtr->firstPtr, (uintptr_t)listPtr);
+         nodePtr != NULL;
+         nodePtr = nextPtr)
+    {
+        long count;
+        nextPtr = (list_node_t*)TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr);
+        if (nextPtr == NULL)
+            break;
+        count = (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr);
+        if (listPtr->compare(TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[count - 1], (uintptr_t)nodePtr), dataPtr) >= 0)
+            break;
+        prevPtr = nodePtr;
+    }
+
+    *prevPtrPtr = prevPtr;
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * findIndex
+ * -- Returns index of the first element >= dataPtr, or count if none
+ * =============================================================================
+ */
+static long
+findIndex (list_t* listPtr, list_node_t* nodePtr, long count, void* dataPtr)
+{
+    long i;
+
+    for (i = 0; i < count; i++) {
+        if (listPtr->compare(nodePtr->dataPtrs[i], dataPtr) >= 0) {
+            break;
+        }
+    }
+
+    return i;
+}
+
+
+/* =============================================================================
+ * HTMfindIndex
+ * =============================================================================
+ */
+static long
+HTMfindIndex (list_t* listPtr, list_node_t* nodePtr, long count, void* dataPtr)
+{
+    long i;
+
+    for (i = 0; i < count; i++) {
+        if (listPtr->compare(HTM_SHARED_READ_P(nodePtr->dataPtrs[i]), dataPtr) >= 0)
+            break;
+    }
+
+    return i;
+}
+
+
+/* =============================================================================
+ * TMfindIndex
+ * =============================================================================
+ */
+TM_CALLABLE
+static long
+TMfindIndex (TM_ARGDECL  list_t* listPtr, list_node_t* nodePtr, long count, void* dataPtr)
+{
+    long i;
+
+    for (i = 0; i < count; i++) {
+        if (listPtr->compare(TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i], (uintptr_t)nodePtr), dataPtr) >= 0)
+            break;
+    }
+
+    return i;
+}
+
+
+/* =============================================================================
+ * list_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+void*
+list_find (list_t* listPtr, void* dataPtr)
+{
+    list_node_t* prevPtr;
+    list_node_t* nodePtr = findNode(listPtr, dataPtr, &prevPtr);
+    long i;
+
+    if (nodePtr == NULL) {
+        return NULL;
+    }
+
+    i = findIndex(listPtr, nodePtr, nodePtr->count, dataPtr);
+    if ((i == nodePtr->count) ||
+        (listPtr->compare(nodePtr->dataPtrs[i], dataPtr) != 0)) {
+        return NULL;
+    }
+
+    return nodePtr->dataPtrs[i];
+}
+
+
+/* =============================================================================
+ * HTMlist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+void*
+HTMlist_find (list_t* listPtr, void* dataPtr)
+{
+    void* rv = NULL;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr = HTMfindNode(listPtr, dataPtr, &prevPtr);
+
+    if (nodePtr != NULL) {
+        long count = (long)HTM_SHARED_READ(nodePtr->count);
+        long i = HTMfindIndex(listPtr, nodePtr, count, dataPtr);
+        if (i < count) {
+            rv = HTM_SHARED_READ_P(nodePtr->dataPtrs[i]);
+            if (listPtr->compare(rv, dataPtr) != 0)
+                rv = NULL;
+        }
+    }
+
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMlist_find
+ * -- Returns NULL if not found, else returns pointer to data
+ * =============================================================================
+ */
+TM_CALLABLE
+void*
+TMlist_find (TM_ARGDECL  list_t* listPtr, void* dataPtr)
+{
+    void* rv = NULL;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_FIND, NULL, listPtr, dataPtr);
+#endif /* ORIGINAL */
+    nodePtr = TMfindNode(TM_ARG  listPtr, dataPtr, &prevPtr);
+    if (nodePtr != NULL) {
+        long count = (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr);
+        long i = TMfindIndex(TM_ARG  listPtr, nodePtr, count, dataPtr);
+        if (i < count) {
+            rv = TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i], (uintptr_t)nodePtr);
+            if (listPtr->compare(rv, dataPtr) != 0)
+                rv = NULL;
+        }
+    }
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_FIND, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * splitNode
+ * -- Moves the upper half of a full node into splitPtr, linked after nodePtr
+ * -- Returns the node and adjusts *indexPtr for inserting at *indexPtr
+ * =============================================================================
+ */
+static list_node_t*
+splitNode (list_node_t* nodePtr, list_node_t* splitPtr, long* indexPtr)
+{
+    const long half = LIST_NODE_CAPACITY / 2;
+    long i;
+
+    for (i = half; i < (long)LIST_NODE_CAPACITY; i++) {
+        splitPtr->dataPtrs[i - half] = nodePtr->dataPtrs[i];
+    }
+    splitPtr->count = LIST_NODE_CAPACITY - half;
+    splitPtr->nextPtr = nodePtr->nextPtr;
+    nodePtr->nextPtr = splitPtr;
+    nodePtr->count = half;
+
+    if (*indexPtr > half) {
+        *indexPtr -= half;
+        return splitPtr;
+    }
+
+    return nodePtr;
+}
+
+
+/* =============================================================================
+ * insertIntoNode
+ * =============================================================================
+ */
+static void
+insertIntoNode (list_node_t* nodePtr, long index, void* dataPtr)
+{
+    long i;
+
+    for (i = nodePtr->count; i > index; i--) {
+        nodePtr->dataPtrs[i] = nodePtr->dataPtrs[i - 1];
+    }
+    nodePtr->dataPtrs[index] = dataPtr;
+    nodePtr->count++;
+}
+
+
+/* =============================================================================
+ * list_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+list_insert (list_t* listPtr, void* dataPtr)
+{
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long i;
+
+    nodePtr = findNode(listPtr, dataPtr, &prevPtr);
+
+    if (nodePtr == NULL) {
+        nodePtr = allocNode();
+        if (nodePtr == NULL) {
+            return FALSE;
+        }
+        nodePtr->dataPtrs[0] = dataPtr;
+        nodePtr->count = 1;
+        listPtr->firstPtr = nodePtr;
+        listPtr->size++;
+        return TRUE;
+    }
+
+    i = findIndex(listPtr, nodePtr, nodePtr->count, dataPtr);
+
+#ifdef LIST_NO_DUPLICATES
+    if ((i < nodePtr->count) &&
+        listPtr->compare(nodePtr->dataPtrs[i], dataPtr) == 0) {
+        return FALSE;
+    }
+#endif
+
+    if (nodePtr->count == (long)LIST_NODE_CAPACITY) {
+        list_node_t* splitPtr = allocNode();
+        if (splitPtr == NULL) {
+            return FALSE;
+        }
+        nodePtr = splitNode(nodePtr, splitPtr, &i);
+    }
+
+    insertIntoNode(nodePtr, i, dataPtr);
+    listPtr->size++;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * Plist_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+Plist_insert (list_t* listPtr, void* dataPtr)
+{
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long i;
+
+    nodePtr = findNode(listPtr, dataPtr, &prevPtr);
+
+    if (nodePtr == NULL) {
+        nodePtr = PallocNode();
+        if (nodePtr == NULL) {
+            return FALSE;
+        }
+        nodePtr->dataPtrs[0] = dataPtr;
+        nodePtr->count = 1;
+        listPtr->firstPtr = nodePtr;
+        listPtr->size++;
+        return TRUE;
+    }
+
+    i = findIndex(listPtr, nodePtr, nodePtr->count, dataPtr);
+
+#ifdef LIST_NO_DUPLICATES
+    if ((i < nodePtr->count) &&
+        listPtr->compare(nodePtr->dataPtrs[i], dataPtr) == 0) {
+        return FALSE;
+    }
+#endif
+
+    if (nodePtr->count == (long)LIST_NODE_CAPACITY) {
+        list_node_t* splitPtr = PallocNode();
+        if (splitPtr == NULL) {
+            return FALSE;
+        }
+        nodePtr = splitNode(nodePtr, splitPtr, &i);
+    }
+
+    insertIntoNode(nodePtr, i, dataPtr);
+    listPtr->size++;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * HTMlist_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+HTMlist_insert (list_t* listPtr, void* dataPtr)
+{
+    bool_t rv;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr = HTMfindNode(listPtr, dataPtr, &prevPtr);
+    long count;
+    long i;
+
+    if (nodePtr == NULL) {
+        nodePtr = HTMallocNode();
+        if (nodePtr == NULL) {
+            rv = FALSE;
+            goto out;
+        }
+        nodePtr->dataPtrs[0] = dataPtr;
+        nodePtr->count = 1;
+        HTM_SHARED_WRITE_P(listPtr->firstPtr, nodePtr);
+        goto inserted;
+    }
+
+    count = (long)HTM_SHARED_READ(nodePtr->count);
+    i = HTMfindIndex(listPtr, nodePtr, count, dataPtr);
+
+#ifdef LIST_NO_DUPLICATES
+    if ((i < count) &&
+        listPtr->compare(HTM_SHARED_READ_P(nodePtr->dataPtrs[i]), dataPtr) == 0) {
+        rv = FALSE;
+        goto out;
+    }
+#endif
+
+    if (count == (long)LIST_NODE_CAPACITY) {
+        const long half = LIST_NODE_CAPACITY / 2;
+        long j;
+        list_node_t* splitPtr = HTMallocNode();
+        if (splitPtr == NULL) {
+            rv = FALSE;
+            goto out;
+        }
+        /* The new node is private until linked */
+        for (j = half; j < count; j++)
+            splitPtr->dataPtrs[j - half] = HTM_SHARED_READ_P(nodePtr->dataPtrs[j]);
+        splitPtr->count = count - half;
+        splitPtr->nextPtr = HTM_SHARED_READ_P(nodePtr->nextPtr);
+        HTM_SHARED_WRITE_P(nodePtr->nextPtr, splitPtr);
+        HTM_SHARED_WRITE(nodePtr->count, half);
+        count = half;
+        if (i > half) {
+            nodePtr = splitPtr;
+            i -= half;
+            count = splitPtr->count;
+        }
+    }
+
+    for (; count > i; count--)
+        HTM_SHARED_WRITE_P(nodePtr->dataPtrs[count], HTM_SHARED_READ_P(nodePtr->dataPtrs[count - 1]));
+    HTM_SHARED_WRITE_P(nodePtr->dataPtrs[i], dataPtr);
+    HTM_SHARED_WRITE(nodePtr->count, HTM_SHARED_READ(nodePtr->count) + 1);
+
+inserted:
+    HTM_SHARED_WRITE(listPtr->size, HTM_SHARED_READ(listPtr->size) + 1);
+
+    rv = TRUE;
+out:
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMlist_insert
+ * -- Return TRUE on success, else FALSE
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMlist_insert (TM_ARGDECL  list_t* listPtr, void* dataPtr)
+{
+    bool_t rv;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long count;
+    long i;
+
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_INSERT, NULL, listPtr, dataPtr);
+#endif /* ORIGINAL */
+    nodePtr = TMfindNode(TM_ARG  listPtr, dataPtr, &prevPtr);
+
+    if (nodePtr == NULL) {
+        nodePtr = TMallocNode(TM_ARG_ALONE);
+        if (nodePtr == NULL) {
+            rv = FALSE;
+            goto out;
+        }
+        nodePtr->dataPtrs[0] = dataPtr;
+        nodePtr->count = 1;
+        TM_SHARED_WRITE_P(listPtr->firstPtr, nodePtr);
+        goto inserted;
+    }
+
+    count = (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr);
+    i = TMfindIndex(TM_ARG  listPtr, nodePtr, count, dataPtr);
+
+#ifdef LIST_NO_DUPLICATES
+    if ((i < count) &&
+        listPtr->compare(TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i], (uintptr_t)nodePtr), dataPtr) == 0) {
+        rv = FALSE;
+        goto out;
+    }
+#endif
+
+    if (count == (long)LIST_NODE_CAPACITY) {
+        const long half = LIST_NODE_CAPACITY / 2;
+        long j;
+        list_node_t* splitPtr = TMallocNode(TM_ARG_ALONE);
+        if (splitPtr == NULL) {
+            rv = FALSE;
+            goto out;
+        }
+        /* The new node is private until linked */
+        for (j = half; j < count; j++)
+            splitPtr->dataPtrs[j - half] = TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[j], (uintptr_t)nodePtr);
+        splitPtr->count = count - half;
+        splitPtr->nextPtr = TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr);
+        TM_SHARED_WRITE_P(nodePtr->nextPtr, splitPtr);
+        TM_SHARED_WRITE(nodePtr->count, half);
+        count = half;
+        if (i > half) {
+            nodePtr = splitPtr;
+            i -= half;
+            count = splitPtr->count;
+        }
+    }
+
+    /* Shift within the line; only the node being inserted into is written */
+    TM_SHARED_WRITE(nodePtr->count, count + 1);
+    for (; count > i; count--)
+        TM_SHARED_WRITE_P(nodePtr->dataPtrs[count], TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[count - 1], (uintptr_t)nodePtr));
+    TM_SHARED_WRITE_P(nodePtr->dataPtrs[i], dataPtr);
+
+inserted:
+    TM_SHARED_WRITE(listPtr->size, TM_SHARED_READ_TAG(listPtr->size, (uintptr_t)listPtr) + 1);
+
+    rv = TRUE;
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_INSERT, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * removeFromNode
+ * -- Returns TRUE if the node became empty
+ * =============================================================================
+ */
+static bool_t
+removeFromNode (list_node_t* nodePtr, long index)
+{
+    long i;
+
+    nodePtr->count--;
+    for (i = index; i < nodePtr->count; i++) {
+        nodePtr->dataPtrs[i] = nodePtr->dataPtrs[i + 1];
+    }
+
+    return ((nodePtr->count == 0) ? TRUE : FALSE);
+}
+
+
+/* =============================================================================
+ * list_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+bool_t
+list_remove (list_t* listPtr, void* dataPtr)
+{
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long i;
+
+    nodePtr = findNode(listPtr, dataPtr, &prevPtr);
+    if (nodePtr == NULL) {
+        return FALSE;
+    }
+
+    i = findIndex(listPtr, nodePtr, nodePtr->count, dataPtr);
+    if ((i == nodePtr->count) ||
+        (listPtr->compare(nodePtr->dataPtrs[i], dataPtr) != 0)) {
+        return FALSE;
+    }
+
+    if (removeFromNode(nodePtr, i)) {
+        if (prevPtr == NULL) {
+            listPtr->firstPtr = nodePtr->nextPtr;
+        } else {
+            prevPtr->nextPtr = nodePtr->nextPtr;
+        }
+        freeNode(nodePtr);
+    }
+    listPtr->size--;
+    assert(listPtr->size >= 0);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * Plist_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+bool_t
+Plist_remove (list_t* listPtr, void* dataPtr)
+{
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long i;
+
+    nodePtr = findNode(listPtr, dataPtr, &prevPtr);
+    if (nodePtr == NULL) {
+        return FALSE;
+    }
+
+    i = findIndex(listPtr, nodePtr, nodePtr->count, dataPtr);
+    if ((i == nodePtr->count) ||
+        (listPtr->compare(nodePtr->dataPtrs[i], dataPtr) != 0)) {
+        return FALSE;
+    }
+
+    if (removeFromNode(nodePtr, i)) {
+        if (prevPtr == NULL) {
+            listPtr->firstPtr = nodePtr->nextPtr;
+        } else {
+            prevPtr->nextPtr = nodePtr->nextPtr;
+        }
+        PfreeNode(nodePtr);
+    }
+    listPtr->size--;
+    assert(listPtr->size >= 0);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * HTMlist_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+bool_t
+HTMlist_remove (list_t* listPtr, void* dataPtr)
+{
+    bool_t rv = FALSE;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr = HTMfindNode(listPtr, dataPtr, &prevPtr);
+    long count;
+    long i;
+
+    if (nodePtr == NULL)
+        goto out;
+
+    count = (long)HTM_SHARED_READ(nodePtr->count);
+    i = HTMfindIndex(listPtr, nodePtr, count, dataPtr);
+    if ((i == count) ||
+        (listPtr->compare(HTM_SHARED_READ_P(nodePtr->dataPtrs[i]), dataPtr) != 0))
+        goto out;
+
+    if (count == 1) {
+        if (prevPtr == NULL)
+            HTM_SHARED_WRITE_P(listPtr->firstPtr, HTM_SHARED_READ_P(nodePtr->nextPtr));
+        else
+            HTM_SHARED_WRITE_P(prevPtr->nextPtr, HTM_SHARED_READ_P(nodePtr->nextPtr));
+        HTMfreeNode(nodePtr);
+    } else {
+        for (; i < count - 1; i++)
+            HTM_SHARED_WRITE_P(nodePtr->dataPtrs[i], HTM_SHARED_READ_P(nodePtr->dataPtrs[i + 1]));
+        HTM_SHARED_WRITE(nodePtr->count, count - 1);
+    }
+    HTM_SHARED_WRITE(listPtr->size, HTM_SHARED_READ(listPtr->size) - 1);
+    rv = TRUE;
+
+out:
+    return rv;
+}
+
+
+/* =============================================================================
+ * TMlist_remove
+ * -- Returns TRUE if successful, else FALSE
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+TMlist_remove (TM_ARGDECL  list_t* listPtr, void* dataPtr)
+{
+    bool_t rv = FALSE;
+    list_node_t* prevPtr;
+    list_node_t* nodePtr;
+    long count;
+    long i;
+
+#ifndef ORIGINAL
+    TM_LOG_BEGIN(LIST_REMOVE, NULL, listPtr, dataPtr);
+#endif /* ORIGINAL */
+    nodePtr = TMfindNode(TM_ARG  listPtr, dataPtr, &prevPtr);
+    if (nodePtr == NULL)
+        goto out;
+
+    count = (long)TM_SHARED_READ_TAG(nodePtr->count, (uintptr_t)nodePtr);
+    i = TMfindIndex(TM_ARG  listPtr, nodePtr, count, dataPtr);
+    if ((i == count) ||
+        (listPtr->compare(TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i], (uintptr_t)nodePtr), dataPtr) != 0))
+        goto out;
+
+    if (count == 1) {
+        list_node_t* nextPtr = (list_node_t*)TM_SHARED_READ_TAG_P(nodePtr->nextPtr, (uintptr_t)nodePtr);
+        if (prevPtr == NULL)
+            TM_SHARED_WRITE_P(listPtr->firstPtr, nextPtr);
+        else
+            TM_SHARED_WRITE_P(prevPtr->nextPtr, nextPtr);
+        TMfreeNode(TM_ARG  nodePtr);
+    } else {
+        for (; i < count - 1; i++)
+            TM_SHARED_WRITE_P(nodePtr->dataPtrs[i], TM_SHARED_READ_TAG_P(nodePtr->dataPtrs[i + 1], (uintptr_t)nodePtr));
+        TM_SHARED_WRITE(nodePtr->count, count - 1);
+    }
+    TM_SHARED_WRITE(listPtr->size, (TM_SHARED_READ_TAG(listPtr->size, (uintptr_t)listPtr) - 1));
+    assert(listPtr->size >= 0);
+    rv = TRUE;
+
+out:
+#ifndef ORIGINAL
+    TM_LOG_END(LIST_REMOVE, &rv);
+#endif /* ORIGINAL */
+    return rv;
+}
+
+
+/* =============================================================================
+ * list_clear
+ * -- Removes all elements
+ * =============================================================================
+ */
+void
+list_clear (list_t* listPtr, void (*freeData)(void *))
+{
+    freeList(listPtr->firstPtr, freeData);
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+}
+
+
+/* =============================================================================
+ * Plist_clear
+ * -- Removes all elements
+ * =============================================================================
+ */
+void
+Plist_clear (list_t* listPtr, void (*PfreeData)(void *))
+{
+    PfreeList(listPtr->firstPtr, PfreeData);
+    listPtr->firstPtr = NULL;
+    listPtr->size = 0;
+}
+
+
+/* =============================================================================
+ * list_setCompare
+ * =============================================================================
+ */
+void
+list_setCompare (list_t* listPtr, long (*compare)(const void*, const void*))
+{
+    listPtr->compare = compare;
+}
+
+
+/* =============================================================================
+ * TMlist_setCompare
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+TMlist_setCompare (TM_ARGDECL  list_t* listPtr, long (*compare)(const void*, const void*))
+{
+    TM_SHARED_WRITE_P(listPtr->compare, compare);
+}
+
+
+/* =============================================================================
+ * TEST_LIST
+ * =============================================================================
+ */
+#ifdef TEST_LIST
+
+
+#include <assert.h>
+#include <stdio.h>
+
+
+static long
+compare (const void* a, const void* b)
+{
+    return (*((const long*)a) - *((const long*)b));
+}
+
+
+static void
+printList (list_t* listPtr)
+{
+    list_iter_t it;
+    printf("[");
+    list_iter_reset(&it, listPtr);
+    while (list_iter_hasNext(&it, listPtr)) {
+        printf("%li ", *((long*)(list_iter_next(&it, listPtr))));
+    }
+    puts("]");
+}
+
+
+static void
+checkList (list_t* listPtr)
+{
+    list_iter_t it;
+    long* prevPtr = NULL;
+    long size = 0;
+
+    list_iter_reset(&it, listPtr);
+    while (list_iter_hasNext(&it, listPtr)) {
+        long* dataPtr = (long*)list_iter_next(&it, listPtr);
+        assert(prevPtr == NULL || compare(prevPtr, dataPtr) <= 0);
+        prevPtr = dataPtr;
+        size++;
+    }
+    assert(size == list_getSize(listPtr));
+
+    list_node_t* nodePtr;
+    for (nodePtr = listPtr->firstPtr; nodePtr != NULL; nodePtr = nodePtr->nextPtr) {
+        assert(((unsigned long)nodePtr % LIST_LINE_SIZE) == 0);
+    }
+}
+
+
+int
+main ()
+{
+    list_t* listPtr;
+    long data[64];
+    long i;
+
+    puts("Starting...");
+
+    listPtr = list_alloc(&compare);
+
+    /* Interleaved order exercises splits in the middle and at the tail */
+    for (i = 0; i < 64; i++) {
+        data[i] = (i * 37) % 64;
+        /* Odd elements go through the transactional allocator */
+        if (i % 2) {
+            assert(TMlist_insert(listPtr, &data[i]));
+        } else {
+            assert(list_insert(listPtr, &data[i]));
+        }
+        assert(*((long*)list_find(listPtr, &data[i])) == data[i]);
+        checkList(listPtr);
+    }
+#ifdef LIST_NO_DUPLICATES
+    assert(!list_insert(listPtr, &data[0]));
+#endif
+    printList(listPtr);
+
+    for (i = 0; i < 64; i += 2) {
+        assert(list_remove(listPtr, &data[i]));
+        assert(list_find(listPtr, &data[i]) == NULL);
+        checkList(listPtr);
+    }
+    printList(listPtr);
+
+    for (i = 1; i < 64; i += 2) {
+        assert(list_remove(listPtr, &data[i]));
+        checkList(listPtr);
+    }
+    assert(list_isEmpty(listPtr));
+    assert(!list_remove(listPtr, &data[0]));
+
+    list_free(listPtr, NULL);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_LIST */
+
+
+/* =============================================================================
+ *
+ * End of ulist.c
+ *
+ * =============================================================================
+ */
+
+#ifndef ORIGINAL
+__attribute__((constructor)) void list_init() {
+    TM_LOG_FFI_DECLARE;
+    TM_LOG_TYPE_DECLARE_INIT(*p[], {&ffi_type_pointer});
+    TM_LOG_TYPE_DECLARE_INIT(*pp[], {&ffi_type_pointer, &ffi_type_pointer});
+    # define TM_LOG_OP TM_LOG_OP_INIT
+    # include "ulist.inc"
+    # undef TM_LOG_OP
+}
+#endif /* ORIGINAL */
+
+#endif /* LIST_USE_UNROLLED */
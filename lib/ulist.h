@@ -0,0 +1,68 @@
+/* =============================================================================
+ *
+ * ulist.h
+ * -- Sorted unrolled linked list, storage layout for list.h
+ * -- Selected with -DLIST_USE_UNROLLED, exports the same list_* API
+ * -- Options: -DLIST_NO_DUPLICATES (default: allow duplicates)
+ *
+ * =============================================================================
+ *
+ * Each node packs several sorted data pointers into a single cache line, so
+ * a traversal reads one line (and logs three transactional reads) per node
+ * instead of one line per element. Traversal only compares against the last
+ * element of each node, which also bounds the number of data dereferences.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef ULIST_H
+#define ULIST_H 1
+
+#include "tm.h"
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define LIST_LINE_SIZE (64)
+
+#define LIST_NODE_CAPACITY \
+    ((LIST_LINE_SIZE - sizeof(long) - sizeof(void*)) / sizeof(void*))
+
+/* Exactly one cache line; every allocator in ulist.c aligns it */
+typedef struct list_node {
+    long count;                              /* never 0 while linked */
+    struct list_node* nextPtr;
+    void* dataPtrs[LIST_NODE_CAPACITY];      /* sorted, [0, count) valid */
+} list_node_t;
+
+typedef struct list_iter {
+    list_node_t* nodePtr;                    /* NULL -> before first element */
+    long index;                              /* of last returned element */
+} list_iter_t;
+
+typedef struct list {
+    list_node_t* firstPtr;
+    TM_PURE long (*compare)(const void*, const void*);   /* returns {-1,0,1}, 0 -> equal */
+    long size;
+} list_t;
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* ULIST_H */
+
+
+/* =============================================================================
+ *
+ * End of ulist.h
+ *
+ * =============================================================================
+ */
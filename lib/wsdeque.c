@@ -0,0 +1,303 @@
+/* =============================================================================
+ *
+ * wsdeque.c
+ * -- Lock-free work-stealing deque (Chase-Lev), fixed capacity
+ *
+ * =============================================================================
+ *
+ * Memory orderings follow Le, Pop, Cohen and Zappa Nardelli, "Correct and
+ * Efficient Work-Stealing for Weak Memory Models", PPoPP 2013.
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include "types.h"
+#include "wsdeque.h"
+
+
+#define WSDEQUE_LINE_SIZE  (64)
+
+
+struct wsdeque {
+    atomic_long top;                        /* next to steal */
+    char pad1[WSDEQUE_LINE_SIZE - sizeof(atomic_long)];
+    atomic_long bottom;                     /* next free slot */
+    char pad2[WSDEQUE_LINE_SIZE - sizeof(atomic_long)];
+    long mask;
+    _Atomic(void*)* elements;
+    char pad3[WSDEQUE_LINE_SIZE - sizeof(long) - sizeof(void*)];
+};
+
+
+/* =============================================================================
+ * wsdeque_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+wsdeque_t*
+wsdeque_alloc (long capacity)
+{
+    wsdeque_t* dequePtr = (wsdeque_t*)aligned_alloc(WSDEQUE_LINE_SIZE,
+                                                    sizeof(wsdeque_t));
+    if (dequePtr == NULL) {
+        return NULL;
+    }
+
+    long size = 1;
+    while (size < capacity) {
+        size <<= 1;
+    }
+    dequePtr->elements = (_Atomic(void*)*)malloc(size * sizeof(_Atomic(void*)));
+    if (dequePtr->elements == NULL) {
+        free(dequePtr);
+        return NULL;
+    }
+
+    long i;
+    for (i = 0; i < size; i++) {
+        atomic_init(&dequePtr->elements[i], NULL);
+    }
+    dequePtr->mask = size - 1;
+    atomic_init(&dequePtr->top, 0);
+    atomic_init(&dequePtr->bottom, 0);
+
+    return dequePtr;
+}
+
+
+/* =============================================================================
+ * wsdeque_free
+ * =============================================================================
+ */
+void
+wsdeque_free (wsdeque_t* dequePtr)
+{
+    free(dequePtr->elements);
+    free(dequePtr);
+}
+
+
+/* =============================================================================
+ * wsdeque_getSize
+ * -- Approximate while other threads are accessing the deque
+ * =============================================================================
+ */
+long
+wsdeque_getSize (wsdeque_t* dequePtr)
+{
+    long b = atomic_load_explicit(&dequePtr->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&dequePtr->top, memory_order_relaxed);
+    return ((b > t) ? (b - t) : 0);
+}
+
+
+/* =============================================================================
+ * wsdeque_push
+ * -- Owner only; dataPtr must not be NULL
+ * -- Returns FALSE if full
+ * =============================================================================
+ */
+bool_t
+wsdeque_push (wsdeque_t* dequePtr, void* dataPtr)
+{
+    assert(dataPtr != NULL);
+
+    long b = atomic_load_explicit(&dequePtr->bottom, memory_order_relaxed);
+    long t = atomic_load_explicit(&dequePtr->top, memory_order_acquire);
+    if (b - t > dequePtr->mask) {
+        return FALSE;
+    }
+
+    atomic_store_explicit(&dequePtr->elements[b & dequePtr->mask], dataPtr,
+                          memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&dequePtr->bottom, b + 1, memory_order_relaxed);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * wsdeque_pop
+ * -- Owner only; returns the most recently pushed element, or NULL if empty
+ * =============================================================================
+ */
+void*
+wsdeque_pop (wsdeque_t* dequePtr)
+{
+    long b = atomic_load_explicit(&dequePtr->bottom, memory_order_relaxed) - 1;
+    atomic_store_explicit(&dequePtr->bottom, b, memory_order_relaxed);
+    atomic_thread_fence(memory_order_seq_cst);
+    long t = atomic_load_explicit(&dequePtr->top, memory_order_relaxed);
+
+    if (t > b) {
+        /* Empty */
+        atomic_store_explicit(&dequePtr->bottom, b + 1, memory_order_relaxed);
+        return NULL;
+    }
+
+    void* dataPtr = atomic_load_explicit(&dequePtr->elements[b & dequePtr->mask],
+                                         memory_order_relaxed);
+    if (t == b) {
+        /* Last element: race against thieves for it */
+        if (!atomic_compare_exchange_strong_explicit(&dequePtr->top,
+                                                     &t,
+                                                     t + 1,
+                                                     memory_order_seq_cst,
+                                                     memory_order_relaxed)) {
+            dataPtr = NULL;
+        }
+        atomic_store_explicit(&dequePtr->bottom, b + 1, memory_order_relaxed);
+    }
+
+    return dataPtr;
+}
+
+
+/* =============================================================================
+ * wsdeque_steal
+ * -- Any thread; returns the least recently pushed element, or NULL if empty
+ * =============================================================================
+ */
+void*
+wsdeque_steal (wsdeque_t* dequePtr)
+{
+    while (1) {
+        long t = atomic_load_explicit(&dequePtr->top, memory_order_acquire);
+        atomic_thread_fence(memory_order_seq_cst);
+        long b = atomic_load_explicit(&dequePtr->bottom, memory_order_acquire);
+
+        if (t >= b) {
+            return NULL;
+        }
+
+        void* dataPtr =
+            atomic_load_explicit(&dequePtr->elements[t & dequePtr->mask],
+                                 memory_order_relaxed);
+        if (atomic_compare_exchange_strong_explicit(&dequePtr->top,
+                                                    &t,
+                                                    t + 1,
+                                                    memory_order_seq_cst,
+                                                    memory_order_relaxed)) {
+            return dataPtr;
+        }
+        /* Lost the race to another thief or the owner; retry */
+    }
+}
+
+
+/* =============================================================================
+ * TEST_WSDEQUE
+ * =============================================================================
+ */
+#ifdef TEST_WSDEQUE
+
+
+#include <pthread.h>
+#include <stdio.h>
+
+
+#define NUM_THIEF  3
+#define NUM_DATA   100000
+
+
+static wsdeque_t* global_dequePtr;
+static atomic_long global_numTaken;
+static atomic_long global_sum;
+static atomic_char global_taken[NUM_DATA + 1];
+
+
+static void
+take (long value)
+{
+    assert(atomic_fetch_add(&global_taken[value], 1) == 0);
+    atomic_fetch_add(&global_sum, value);
+    atomic_fetch_add(&global_numTaken, 1);
+}
+
+
+static void*
+steal (void* argPtr)
+{
+    while (atomic_load(&global_numTaken) < NUM_DATA) {
+        long value = (long)wsdeque_steal(global_dequePtr);
+        if (value) {
+            take(value);
+        }
+    }
+
+    return NULL;
+}
+
+
+int
+main ()
+{
+    pthread_t threads[NUM_THIEF];
+    long i;
+
+    puts("Starting...");
+
+    global_dequePtr = wsdeque_alloc(3);
+    assert(global_dequePtr);
+    for (i = 1; i <= 4; i++) {
+        assert(wsdeque_push(global_dequePtr, (void*)i));
+    }
+    assert(!wsdeque_push(global_dequePtr, (void*)5));
+    assert(wsdeque_getSize(global_dequePtr) == 4);
+    assert(wsdeque_steal(global_dequePtr) == (void*)1);
+    assert(wsdeque_pop(global_dequePtr) == (void*)4);
+    assert(wsdeque_pop(global_dequePtr) == (void*)3);
+    assert(wsdeque_steal(global_dequePtr) == (void*)2);
+    assert(wsdeque_pop(global_dequePtr) == NULL);
+    assert(wsdeque_steal(global_dequePtr) == NULL);
+    wsdeque_free(global_dequePtr);
+
+    global_dequePtr = wsdeque_alloc(NUM_DATA);
+    assert(global_dequePtr);
+    for (i = 0; i < NUM_THIEF; i++) {
+        pthread_create(&threads[i], NULL, steal, NULL);
+    }
+    /* Owner interleaves pushes and pops while the thieves steal */
+    for (i = 1; i <= NUM_DATA; i++) {
+        assert(wsdeque_push(global_dequePtr, (void*)i));
+        if (i % 3 == 0) {
+            long value = (long)wsdeque_pop(global_dequePtr);
+            if (value) {
+                take(value);
+            }
+        }
+    }
+    while (atomic_load(&global_numTaken) < NUM_DATA) {
+        long value = (long)wsdeque_pop(global_dequePtr);
+        if (value) {
+            take(value);
+        }
+    }
+    for (i = 0; i < NUM_THIEF; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    assert(atomic_load(&global_sum) == (long)NUM_DATA * (NUM_DATA + 1) / 2);
+    assert(wsdeque_getSize(global_dequePtr) == 0);
+    wsdeque_free(global_dequePtr);
+
+    puts("Done.");
+
+    return 0;
+}
+
+
+#endif /* TEST_WSDEQUE */
+
+
+/* =============================================================================
+ *
+ * End of wsdeque.c
+ *
+ * =============================================================================
+ */
@@ -0,0 +1,99 @@
+/* =============================================================================
+ *
+ * wsdeque.h
+ * -- Lock-free work-stealing deque (Chase-Lev), fixed capacity
+ *
+ * =============================================================================
+ *
+ * The owning thread pushes and pops at the bottom; any other thread may steal
+ * from the top. The owner only synchronizes with thieves when the deque is
+ * down to its last element, so in the common case a pop is a couple of plain
+ * loads and stores. Operations are not transactional.
+ *
+ * =============================================================================
+ */
+
+
+#ifndef WSDEQUE_H
+#define WSDEQUE_H 1
+
+
+#include "types.h"
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+typedef struct wsdeque wsdeque_t;
+
+
+/* =============================================================================
+ * wsdeque_alloc
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+wsdeque_t*
+wsdeque_alloc (long capacity);
+
+
+/* =============================================================================
+ * wsdeque_free
+ * =============================================================================
+ */
+void
+wsdeque_free (wsdeque_t* dequePtr);
+
+
+/* =============================================================================
+ * wsdeque_getSize
+ * -- Approximate while other threads are accessing the deque
+ * =============================================================================
+ */
+long
+wsdeque_getSize (wsdeque_t* dequePtr);
+
+
+/* =============================================================================
+ * wsdeque_push
+ * -- Owner only; dataPtr must not be NULL
+ * -- Returns FALSE if full
+ * =============================================================================
+ */
+bool_t
+wsdeque_push (wsdeque_t* dequePtr, void* dataPtr);
+
+
+/* =============================================================================
+ * wsdeque_pop
+ * -- Owner only; returns the most recently pushed element, or NULL if empty
+ * =============================================================================
+ */
+void*
+wsdeque_pop (wsdeque_t* dequePtr);
+
+
+/* =============================================================================
+ * wsdeque_steal
+ * -- Any thread; returns the least recently pushed element, or NULL if empty
+ * =============================================================================
+ */
+void*
+wsdeque_steal (wsdeque_t* dequePtr);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+
+#endif /* WSDEQUE_H */
+
+
+/* =============================================================================
+ *
+ * End of wsdeque.h
+ *
+ * =============================================================================
+ */
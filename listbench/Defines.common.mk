@@ -0,0 +1,28 @@
+# ==============================================================================
+#
+# Defines.common.mk
+#
+# ==============================================================================
+
+PROG := listbench
+
+CFLAGS += -DLIST_NO_DUPLICATES
+#CFLAGS += -DLIST_USE_UNROLLED
+CFLAGS += -DMERGE_LIST
+
+SRCS += \
+	listbench.c \
+	$(LIB)/lflist.c \
+	$(LIB)/list.c \
+	$(LIB)/ulist.c \
+	$(LIB)/mt19937ar.c \
+	$(LIB)/random.c \
+	$(LIB)/thread.c \
+
+OBJS := ${SRCS:.c=.o}
+
+# ==============================================================================
+#
+# End of Defines.common.mk
+#
+# ==============================================================================
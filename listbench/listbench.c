@@ -0,0 +1,308 @@
+/* =============================================================================
+ *
+ * listbench.c
+ * -- Sorted list microbenchmark, transactional list vs. lock-free list
+ *
+ * =============================================================================
+ *
+ * Each thread replays a pre-generated stream of find/insert/remove operations
+ * against the transactional list (list.h, or the unrolled layout when built
+ * with -DLIST_USE_UNROLLED), grouped -n operations per transaction, and then
+ * replays the identical stream against the lock-free list (lflist.h), one
+ * operation at a time. Both lists start from the same initial contents, so
+ * the two phases see the same key distribution and operation mix.
+ *
+ * =============================================================================
+ */
+
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lflist.h"
+#include "list.h"
+#include "random.h"
+#include "thread.h"
+#include "timer.h"
+#include "tm.h"
+
+enum op_type {
+    OP_FIND   = 0,
+    OP_INSERT = 1,
+    OP_REMOVE = 2,
+};
+
+typedef struct {
+    list_t *list;
+    lflist_t *lflist;
+    long **keys;
+    char **ops;
+
+    unsigned long range;
+    unsigned long initial;
+    unsigned long ops_per_tx;
+    unsigned long finds;
+    unsigned long seed;
+    unsigned long threads;
+    unsigned long transactions;
+    double time_tm;
+    double time_lf;
+} data_t;
+
+HTM_STATS(global_tsx_status);
+
+TM_INIT_GLOBAL;
+
+void usage(char* argv0) {
+    const char help[] =
+        "Usage: %s [switches]\n"
+        "       -i               initial size of list\n"
+        "       -k               range of keys\n"
+        "       -n               number of operations per transaction\n"
+        "       -o               total number of transactions\n"
+        "       -r               percentage of finds\n"
+        "       -s               random seed\n"
+        "       -t               number of threads\n";
+    fprintf(stderr, help, argv0);
+    exit(-1);
+}
+
+static unsigned long stream_length(data_t *data) {
+    return (data->transactions / data->threads) * data->ops_per_tx;
+}
+
+void work_tm(data_t *data) {
+    TM_THREAD_ENTER();
+
+    const long id = thread_getId();
+    const long *keys = data->keys[id];
+    const char *ops = data->ops[id];
+
+    HTM_TX_INIT;
+    for (unsigned long i = 0; i < data->transactions / data->threads; ++i) {
+        const unsigned long base = i * data->ops_per_tx;
+tsx_begin:
+        if (HTM_BEGIN(tsx_status, global_tsx_status)) {
+            HTM_LOCK_READ();
+
+            for (unsigned long j = base; j < base + data->ops_per_tx; ++j) {
+                void *key = (void *)keys[j];
+                switch (ops[j]) {
+                    case OP_FIND:   HTMLIST_FIND(data->list, key); break;
+                    case OP_INSERT: HTMLIST_INSERT(data->list, key); break;
+                    case OP_REMOVE: HTMLIST_REMOVE(data->list, key); break;
+                    default: assert(0);
+                }
+            }
+            HTM_END(global_tsx_status);
+        } else {
+            HTM_RETRY(tsx_status, tsx_begin);
+
+            TM_BEGIN();
+            for (unsigned long j = base; j < base + data->ops_per_tx; ++j) {
+                void *key = (void *)keys[j];
+                switch (ops[j]) {
+                    case OP_FIND:   TMLIST_FIND(data->list, key); break;
+                    case OP_INSERT: TMLIST_INSERT(data->list, key); break;
+                    case OP_REMOVE: TMLIST_REMOVE(data->list, key); break;
+                    default: assert(0);
+                }
+            }
+            TM_END();
+        }
+    }
+
+    TM_THREAD_EXIT();
+}
+
+void work_lf(data_t *data) {
+    const long id = thread_getId();
+    const long *keys = data->keys[id];
+    const char *ops = data->ops[id];
+    const unsigned long length = stream_length(data);
+
+    for (unsigned long j = 0; j < length; ++j) {
+        void *key = (void *)keys[j];
+        switch (ops[j]) {
+            case OP_FIND:   lflist_find(data->lflist, key); break;
+            case OP_INSERT: lflist_insert(data->lflist, key); break;
+            case OP_REMOVE: lflist_remove(data->lflist, key); break;
+            default: assert(0);
+        }
+    }
+}
+
+void init(data_t *data) {
+    const unsigned long length = stream_length(data);
+    random_t *random = random_alloc();
+
+    data->list = list_alloc(NULL);
+    data->lflist = lflist_alloc(NULL);
+    assert(data->list && data->lflist);
+
+    /* Same initial contents in both lists */
+    random_seed(random, data->seed);
+    while ((unsigned long)list_getSize(data->list) < data->initial) {
+        unsigned long k;
+        random_fill(random, &k, 1, data->range);
+        void *key = (void *)(long)(k + 1);
+        if (list_insert(data->list, key))
+            lflist_insert(data->lflist, key);
+    }
+
+    /* One operation stream per thread, replayed by both phases */
+    data->keys = malloc(data->threads * sizeof(*data->keys));
+    data->ops = malloc(data->threads * sizeof(*data->ops));
+    unsigned long *rolls = malloc(length * sizeof(*rolls));
+    assert(data->keys && data->ops && rolls);
+    for (unsigned long t = 0; t < data->threads; ++t) {
+        data->keys[t] = malloc(length * sizeof(**data->keys));
+        data->ops[t] = malloc(length * sizeof(**data->ops));
+        assert(data->keys[t] && data->ops[t]);
+
+        random_seed(random, data->seed + t + 1);
+        random_fill(random, rolls, length, 100);
+        random_fill(random, (unsigned long *)data->keys[t], length, data->range);
+        for (unsigned long j = 0; j < length; ++j) {
+            unsigned long r = rolls[j];
+            data->keys[t][j] += 1;
+            if (r < data->finds)
+                data->ops[t][j] = OP_FIND;
+            else
+                data->ops[t][j] = ((r - data->finds) & 1) ? OP_REMOVE : OP_INSERT;
+        }
+    }
+
+    free(rolls);
+    random_free(random);
+}
+
+static double run(data_t *data, void (*fn)(void *)) {
+    TIMER_T start, stop;
+
+    TIMER_READ(start);
+    GOTO_SIM();
+
+    {
+#ifdef OTM
+#pragma omp parallel
+        fn((void *)data);
+#else
+        thread_start(fn, data);
+#endif
+    }
+
+    GOTO_REAL();
+
+    TIMER_READ(stop);
+    return TIMER_DIFF_SECONDS(start, stop);
+}
+
+void compute(data_t *data) {
+    data->time_tm = run(data, (void (*)(void *))work_tm);
+    data->time_lf = run(data, (void (*)(void *))work_lf);
+}
+
+static bool_t verify(data_t *data) {
+    list_iter_t it;
+    long prev = 0;
+    long size = 0;
+
+    list_iter_reset(&it, data->list);
+    while (list_iter_hasNext(&it, data->list)) {
+        long key = (long)list_iter_next(&it, data->list);
+        if (key < prev)
+            return FALSE;
+        prev = key;
+        size++;
+    }
+
+    if (size != list_getSize(data->list) || !lflist_isSorted(data->lflist))
+        return FALSE;
+
+    /* Without concurrency, both lists must apply the streams identically */
+    if (data->threads == 1 && list_getSize(data->list) != lflist_getSize(data->lflist))
+        return FALSE;
+
+    return TRUE;
+}
+
+void cleanup(data_t *data) {
+    for (unsigned long t = 0; t < data->threads; ++t) {
+        free(data->keys[t]);
+        free(data->ops[t]);
+    }
+    free(data->keys);
+    free(data->ops);
+    list_free(data->list, NULL);
+    lflist_free(data->lflist, NULL);
+}
+
+int main(int argc, char **argv) {
+    data_t data = { .range = 1024, .initial = 512, .ops_per_tx = 4, .finds = 80, .seed = 0, .transactions = 16000, .threads = 1 };
+    int opt;
+
+    GOTO_REAL();
+
+    while ((opt = getopt(argc,(char**)argv,"i:k:n:o:r:s:t:")) != EOF) {
+        switch (opt) {
+            case 'i': data.initial = atol(optarg);
+                break;
+            case 'k': data.range = atol(optarg);
+                break;
+            case 'n': data.ops_per_tx = atol(optarg);
+                break;
+            case 'o': data.transactions = atol(optarg);
+                break;
+            case 'r': data.finds = atol(optarg);
+                break;
+            case 's': data.seed = atol(optarg);
+                break;
+            case 't': data.threads = atol(optarg);
+                break;
+            default:  usage((char*)argv[0]);
+                break;
+        }
+    }
+
+    if (!data.range || data.initial > data.range || !data.ops_per_tx || data.finds > 100 || !data.threads || !data.transactions) {
+        fprintf(stderr, "Error: invalid parameter values\n");
+        usage((char*)argv[0]);
+    }
+    printf("Key range = %ld\nInitial size = %ld\nOperations per TX = %ld\nPercent Finds = %ld\nSeed = %ld\nTransactions = %ld\nThreads = %ld\n", data.range, data.initial, data.ops_per_tx, data.finds, data.seed, data.transactions, data.threads);
+
+    init(&data);
+
+    SIM_GET_NUM_CPU(data.threads);
+    TM_STARTUP(data.threads);
+    thread_startup(data.threads);
+
+    compute(&data);
+    printf("Time (TM list) = %f\n", data.time_tm);
+    printf("Time (lock-free list) = %f\n", data.time_lf);
+    printf("Final size = %ld (TM), %ld (lock-free)\n", list_getSize(data.list), lflist_getSize(data.lflist));
+
+    HTM_STATS_PRINT(global_tsx_status);
+
+    TM_SHUTDOWN();
+    GOTO_SIM();
+
+    printf("Verification = %s\n", verify(&data) ? "passed" : "failed");
+
+    cleanup(&data);
+
+    thread_shutdown();
+    return 0;
+}
+
+
+/* =============================================================================
+ *
+ * End of listbench.c
+ *
+ * =============================================================================
+ */
@@ -2,7 +2,7 @@
 
 set -e
 
-for i in array bayes genome intruder kmeans labyrinth ssca2 vacation yada; do
+for i in array listbench heapbench bayes genome intruder kmeans labyrinth ssca2 vacation yada; do
   cd $i
   if [ "${ITM}" = "1" ]; then
     make -f Makefile.stm.itm clean
@@ -9,6 +9,8 @@ fi
 
 if [ "$1" == "real" ]; then
   declare -a RUN=("./array/array -t"
+                  "./listbench/listbench -k4096 -i2048 -n4 -o262144 -r80 -t"
+                  "./heapbench/heapbench -i16384 -n2 -o1048576 -t"
                   "./bayes/bayes -v32 -r4096 -n10 -p40 -i2 -e8 -s1 -t"
                   "./genome/genome -g16384 -s64 -n16777216 -t"
                   "./intruder/intruder -a10 -l128 -n262144 -s1 -t"
@@ -21,6 +23,8 @@ if [ "$1" == "real" ]; then
                   "./yada/yada -a15 -i yada/inputs/ttimeu1000000.2 -t")
 elif [ "$1" == "sim" ]; then
   declare -a RUN=("./array/array -n 10 -o 100 -t"
+                  "./listbench/listbench -k256 -i128 -n4 -o1024 -r80 -t"
+                  "./heapbench/heapbench -i1024 -n2 -o4096 -t"
                   "./bayes/bayes -v32 -r1024 -n2 -p20 -s0 -i2 -e2 -t"
                   "./genome/genome -g256 -s16 -n16384 -t"
                   "./intruder/intruder -a10 -l4 -n2048 -s1 -t"
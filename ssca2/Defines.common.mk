@@ -18,6 +18,7 @@ SRCS += \
 	getUserParameters.c \
 	globals.c \
 	ssca2.c \
+	$(LIB)/dataset.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/random.c \
 	$(LIB)/thread.c \
@@ -25,6 +26,8 @@ SRCS += \
 OBJS := ${SRCS:.c=.o}
 
 #CFLAGS += -DUSE_PARALLEL_DATA_GENERATION
+#CFLAGS += -DUSE_SEEDED_DATA_GENERATION
+#CFLAGS += -DUSE_DATA_CACHE
 #CFLAGS += -DWRITE_RESULT_FILES
 CFLAGS += -DENABLE_KERNEL1 -DMERGE_COMPUTE
 #CFLAGS += -DENABLE_KERNEL2 -DENABLE_KERNEL3
@@ -77,6 +77,7 @@
 #include "random.h"
 #include "thread.h"
 #include "tm.h"
+#include "utility.h"
 
 static ULONGINT_T* global_permV              = NULL;
 static long*       global_cliqueSizes        = NULL;
@@ -93,6 +94,482 @@ static ULONGINT_T* global_tempIndex          = NULL;
 
 HTM_STATS_EXTERN(global_tsx_status);
 
+
+/* =============================================================================
+ * addCliqueEdges
+ * -- Writes the edges of one clique to startV/endV; returns how many
+ * =============================================================================
+ */
+static long
+addCliqueEdges (random_t* stream,
+                long i_cliqueSize,
+                long i_firstVsInClique,
+                ULONGINT_T** tmpEdgeCounter,
+                ULONGINT_T* startV,
+                ULONGINT_T* endV)
+{
+    long i_edgePtr = 0;
+    float p = PROB_UNIDIRECTIONAL;
+    long i;
+
+    /*
+     * First create at least one edge between two vetices in a clique
+     */
+
+    for (i = 0; i < i_cliqueSize; i++) {
+
+        long j;
+        for (j = 0; j < i; j++) {
+
+            float r = (float)(random_generate(stream) % 1000) / (float)1000;
+            if (r >= p) {
+
+                startV[i_edgePtr] = i + i_firstVsInClique;
+                endV[i_edgePtr] = j + i_firstVsInClique;
+                i_edgePtr++;
+                tmpEdgeCounter[i][j] = 1;
+
+                startV[i_edgePtr] = j + i_firstVsInClique;
+                endV[i_edgePtr] = i + i_firstVsInClique;
+                i_edgePtr++;
+                tmpEdgeCounter[j][i] = 1;
+
+            } else  if (r >= 0.5) {
+
+                startV[i_edgePtr] = i + i_firstVsInClique;
+                endV[i_edgePtr] = j + i_firstVsInClique;
+                i_edgePtr++;
+                tmpEdgeCounter[i][j] = 1;
+                tmpEdgeCounter[j][i] = 0;
+
+            } else {
+
+                startV[i_edgePtr] = j + i_firstVsInClique;
+                endV[i_edgePtr] = i + i_firstVsInClique;
+                i_edgePtr++;
+                tmpEdgeCounter[j][i] = 1;
+                tmpEdgeCounter[i][j] = 0;
+
+            }
+
+        } /* for j */
+    } /* for i */
+
+    if (i_cliqueSize != 1) {
+        long randNumEdges = (long)(random_generate(stream)
+                                   % (2*i_cliqueSize*MAX_PARAL_EDGES));
+        long i_paralEdge;
+        for (i_paralEdge = 0; i_paralEdge < randNumEdges; i_paralEdge++) {
+            i = (random_generate(stream) % i_cliqueSize);
+            long j = (random_generate(stream) % i_cliqueSize);
+            if ((i != j) && (tmpEdgeCounter[i][j] < MAX_PARAL_EDGES)) {
+                float r = (float)(random_generate(stream) % 1000) / (float)1000;
+                if (r >= p) {
+                    /* Copy to edge structure. */
+                    startV[i_edgePtr] = i + i_firstVsInClique;
+                    endV[i_edgePtr] = j + i_firstVsInClique;
+                    i_edgePtr++;
+                    tmpEdgeCounter[i][j]++;
+                }
+            }
+        }
+    }
+
+    return i_edgePtr;
+}
+
+
+/* =============================================================================
+ * findClique
+ * -- Returns the first vertex of the clique that holds vertex
+ * =============================================================================
+ */
+static long
+findClique (ULONGINT_T vertex, ULONGINT_T* firstVsInCliques, long totCliques)
+{
+    long h = totCliques;
+    long l = 0;
+    long t = -1;
+    while (h - l > 1) {
+        long m = (h + l) / 2;
+        if (vertex >= firstVsInCliques[m]) {
+            l = m;
+        } else {
+            if ((vertex < firstVsInCliques[m]) && (m > 0)) {
+                if (vertex >= firstVsInCliques[m-1]) {
+                    t = m - 1;
+                    break;
+                } else {
+                    h = m;
+                }
+            }
+        }
+    }
+
+    if (t == -1) {
+        long m;
+        for (m = (l + 1); m < h; m++) {
+            if (vertex < firstVsInCliques[m]) {
+                break;
+            }
+        }
+        t = m - 1;
+    }
+
+    return firstVsInCliques[t];
+}
+
+
+/* =============================================================================
+ * addInterEdges
+ * -- Writes the inter-clique edges that leave vertex i; returns how many
+ * =============================================================================
+ */
+static long
+addInterEdges (random_t* stream,
+               ULONGINT_T i,
+               ULONGINT_T* firstVsInCliques,
+               long totCliques,
+               ULONGINT_T* startV,
+               ULONGINT_T* endV)
+{
+    long i_edgePtr = 0;
+    ULONGINT_T tempVertex1 = i;
+    long t1 = findClique(tempVertex1, firstVsInCliques, totCliques);
+
+    ULONGINT_T d;
+    float p;
+    for (d = 1, p = PROB_INTERCL_EDGES; d < TOT_VERTICES; d *= 2, p /= 2) {
+
+        float r = (float)(random_generate(stream) % 1000) / (float)1000;
+
+        if (r <= p) {
+
+            ULONGINT_T tempVertex2 = (i+d) % TOT_VERTICES;
+            long t2 = findClique(tempVertex2, firstVsInCliques, totCliques);
+
+            if (t1 != t2) {
+                long randNumEdges =
+                    random_generate(stream) % MAX_PARAL_EDGES + 1;
+                long j;
+                for (j = 0; j < randNumEdges; j++) {
+                    startV[i_edgePtr] = tempVertex1;
+                    endV[i_edgePtr] = tempVertex2;
+                    i_edgePtr++;
+                }
+            }
+
+        } /* r <= p */
+
+        float r0 = (float)(random_generate(stream) % 1000) / (float)1000;
+
+        if ((r0 <= p) && (i >= d)) {
+
+            ULONGINT_T tempVertex2 = (i-d) % TOT_VERTICES;
+            long t2 = findClique(tempVertex2, firstVsInCliques, totCliques);
+
+            if (t1 != t2) {
+                long randNumEdges =
+                    random_generate(stream) % MAX_PARAL_EDGES + 1;
+                long j;
+                for (j = 0; j < randNumEdges; j++) {
+                    startV[i_edgePtr] = tempVertex1;
+                    endV[i_edgePtr] = tempVertex2;
+                    i_edgePtr++;
+                }
+            }
+
+        } /* r0 <= p && (i-d) > 0 */
+
+    } /* for d, p */
+
+    return i_edgePtr;
+}
+
+
+#ifdef USE_SEEDED_DATA_GENERATION
+/*
+ * Each chunk of each phase draws from its own stream of SDG_SEED, so the
+ * graph does not depend on the number of threads. Results are merged on the
+ * main thread in chunk order.
+ */
+#define SDG_SEED         (0)
+#define SDG_FILL_CHUNK   (1L << 12) /* values per random stream */
+#define SDG_CLIQUE_CHUNK (256)      /* cliques per random stream */
+#define SDG_VERTEX_CHUNK (1024)     /* vertices per random stream */
+#define SDG_WEIGHT_CHUNK (1L << 12) /* edges per random stream */
+#define NUM_CHUNK(n, c)  (((n) + (c) - 1) / (c))
+
+enum sdg_phase {
+    PHASE_PERMUTE = 0,
+    PHASE_CLIQUE_SIZE,
+    PHASE_CLIQUE_EDGE,
+    PHASE_INTER_EDGE,
+    PHASE_WEIGHT,
+    PHASE_SOUGHT,
+    NUM_PHASE
+};
+
+typedef struct chunkArg {
+    long phase;
+    long numChunk;
+    void (*funcPtr)(long chunk, random_t* stream, void* argPtr);
+    void* argPtr;
+} chunkArg_t;
+
+typedef struct fillArg {
+    unsigned long* values;
+    long num;
+    unsigned long range;
+} fillArg_t;
+
+typedef struct edgeChunk {
+    ULONGINT_T* startV;
+    ULONGINT_T* endV;
+    long numEdge;
+} edgeChunk_t;
+
+typedef struct edgeArg {
+    long* cliqueSizes;
+    ULONGINT_T* firstVsInCliques;
+    long totCliques;
+    edgeChunk_t* chunks;
+} edgeArg_t;
+
+typedef struct weightArg {
+    LONGINT_T* intWeight;
+    long numEdge;
+    char** strWeights;
+    long* numStrWts;
+} weightArg_t;
+
+
+/* =============================================================================
+ * runChunks
+ * -- Threads take the chunks of a phase round-robin
+ * =============================================================================
+ */
+static void
+runChunks (void* argPtr)
+{
+    chunkArg_t* chunkArgPtr = (chunkArg_t*)argPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+
+    random_t* stream = random_alloc();
+    assert(stream);
+
+    long c;
+    for (c = myId; c < chunkArgPtr->numChunk; c += numThread) {
+        random_seedStream(stream, SDG_SEED, (c * NUM_PHASE + chunkArgPtr->phase));
+        chunkArgPtr->funcPtr(c, stream, chunkArgPtr->argPtr);
+    }
+
+    random_free(stream);
+}
+
+
+/* =============================================================================
+ * forEachChunk
+ * -- Runs funcPtr on every chunk of phase, on all threads from thread_startup
+ * =============================================================================
+ */
+static void
+forEachChunk (long phase,
+              long numChunk,
+              void (*funcPtr)(long chunk, random_t* stream, void* argPtr),
+              void* argPtr)
+{
+    chunkArg_t arg;
+    arg.phase = phase;
+    arg.numChunk = numChunk;
+    arg.funcPtr = funcPtr;
+    arg.argPtr = argPtr;
+#ifdef OTM
+#pragma omp parallel
+    {
+        runChunks((void*)&arg);
+    }
+#else
+    thread_start(runChunks, (void*)&arg);
+#endif
+}
+
+
+/* =============================================================================
+ * fillChunk
+ * =============================================================================
+ */
+static void
+fillChunk (long chunk, random_t* stream, void* argPtr)
+{
+    fillArg_t* fillArgPtr = (fillArg_t*)argPtr;
+    long start = chunk * SDG_FILL_CHUNK;
+
+    random_fill(stream,
+                &fillArgPtr->values[start],
+                MIN(SDG_FILL_CHUNK, (fillArgPtr->num - start)),
+                fillArgPtr->range);
+}
+
+
+/* =============================================================================
+ * cliqueEdgeChunk
+ * =============================================================================
+ */
+static void
+cliqueEdgeChunk (long chunk, random_t* stream, void* argPtr)
+{
+    edgeArg_t* edgeArgPtr = (edgeArg_t*)argPtr;
+    edgeChunk_t* chunkPtr = &edgeArgPtr->chunks[chunk];
+    long first = chunk * SDG_CLIQUE_CHUNK;
+    long last = MIN((first + SDG_CLIQUE_CHUNK), edgeArgPtr->totCliques);
+    long i;
+
+    /* Each pair gives at most two edges, plus the parallel ones */
+    long maxNumEdge = 0;
+    for (i = first; i < last; i++) {
+        long size = edgeArgPtr->cliqueSizes[i];
+        maxNumEdge += size * (size - 1) + 2 * size * MAX_PARAL_EDGES;
+    }
+    chunkPtr->startV = (ULONGINT_T*)malloc(maxNumEdge * sizeof(ULONGINT_T));
+    chunkPtr->endV = (ULONGINT_T*)malloc(maxNumEdge * sizeof(ULONGINT_T));
+    assert(chunkPtr->startV);
+    assert(chunkPtr->endV);
+
+    ULONGINT_T** tmpEdgeCounter =
+        (ULONGINT_T**)malloc(MAX_CLIQUE_SIZE * sizeof(ULONGINT_T *));
+    assert(tmpEdgeCounter);
+    for (i = 0; i < MAX_CLIQUE_SIZE; i++) {
+        tmpEdgeCounter[i] =
+            (ULONGINT_T*)malloc(MAX_CLIQUE_SIZE * sizeof(ULONGINT_T));
+        assert(tmpEdgeCounter[i]);
+    }
+
+    long numEdge = 0;
+    for (i = first; i < last; i++) {
+        numEdge += addCliqueEdges(stream,
+                                  edgeArgPtr->cliqueSizes[i],
+                                  edgeArgPtr->firstVsInCliques[i],
+                                  tmpEdgeCounter,
+                                  &chunkPtr->startV[numEdge],
+                                  &chunkPtr->endV[numEdge]);
+    }
+    chunkPtr->numEdge = numEdge;
+
+    for (i = 0; i < MAX_CLIQUE_SIZE; i++) {
+        free(tmpEdgeCounter[i]);
+    }
+    free(tmpEdgeCounter);
+}
+
+
+/* =============================================================================
+ * interEdgeChunk
+ * =============================================================================
+ */
+static void
+interEdgeChunk (long chunk, random_t* stream, void* argPtr)
+{
+    edgeArg_t* edgeArgPtr = (edgeArg_t*)argPtr;
+    edgeChunk_t* chunkPtr = &edgeArgPtr->chunks[chunk];
+    ULONGINT_T first = chunk * SDG_VERTEX_CHUNK;
+    ULONGINT_T last = MIN((first + SDG_VERTEX_CHUNK), TOT_VERTICES);
+
+    /* Each distance gives at most MAX_PARAL_EDGES edges in each direction */
+    long numDistance = 0;
+    ULONGINT_T d;
+    for (d = 1; d < TOT_VERTICES; d *= 2) {
+        numDistance++;
+    }
+    long maxNumEdge = (last - first) * numDistance * 2 * MAX_PARAL_EDGES;
+    chunkPtr->startV = (ULONGINT_T*)malloc(maxNumEdge * sizeof(ULONGINT_T));
+    chunkPtr->endV = (ULONGINT_T*)malloc(maxNumEdge * sizeof(ULONGINT_T));
+    assert(chunkPtr->startV);
+    assert(chunkPtr->endV);
+
+    long numEdge = 0;
+    ULONGINT_T i;
+    for (i = first; i < last; i++) {
+        numEdge += addInterEdges(stream,
+                                 i,
+                                 edgeArgPtr->firstVsInCliques,
+                                 edgeArgPtr->totCliques,
+                                 &chunkPtr->startV[numEdge],
+                                 &chunkPtr->endV[numEdge]);
+    }
+    chunkPtr->numEdge = numEdge;
+}
+
+
+/* =============================================================================
+ * mergeEdgeChunks
+ * -- Appends the chunks to startV/endV in order and frees them
+ * -- Returns the number of edges
+ * =============================================================================
+ */
+static long
+mergeEdgeChunks (edgeChunk_t* chunks,
+                 long numChunk,
+                 ULONGINT_T* startV,
+                 ULONGINT_T* endV,
+                 long maxNumEdge)
+{
+    long numEdge = 0;
+    long c;
+
+    for (c = 0; c < numChunk; c++) {
+        long n = chunks[c].numEdge;
+        assert((numEdge + n) <= maxNumEdge);
+        memcpy(&startV[numEdge], chunks[c].startV, n * sizeof(ULONGINT_T));
+        memcpy(&endV[numEdge], chunks[c].endV, n * sizeof(ULONGINT_T));
+        numEdge += n;
+        free(chunks[c].startV);
+        free(chunks[c].endV);
+    }
+
+    return numEdge;
+}
+
+
+/* =============================================================================
+ * weightChunk
+ * -- String weights are kept per chunk until the edges have been numbered
+ * =============================================================================
+ */
+static void
+weightChunk (long chunk, random_t* stream, void* argPtr)
+{
+    weightArg_t* weightArgPtr = (weightArg_t*)argPtr;
+    LONGINT_T* intWeight = weightArgPtr->intWeight;
+    long first = chunk * SDG_WEIGHT_CHUNK;
+    long last = MIN((first + SDG_WEIGHT_CHUNK), weightArgPtr->numEdge);
+    float p = PERC_INT_WEIGHTS;
+    long numStrWt = 0;
+    long i;
+
+    for (i = first; i < last; i++) {
+        float r = (float)(random_generate(stream) % 1000) / (float)1000;
+        if (r <= p) {
+            intWeight[i] = 1 + (random_generate(stream) % (MAX_INT_WEIGHT-1));
+        } else {
+            intWeight[i] = -1;
+            numStrWt++;
+        }
+    }
+
+    char* strWeight = (char*)malloc(numStrWt * MAX_STRLEN * sizeof(char));
+    assert(strWeight || (numStrWt == 0));
+    for (i = 0; i < (numStrWt * MAX_STRLEN); i++) {
+        strWeight[i] = (char) (1 + random_generate(stream) % 127);
+    }
+
+    weightArgPtr->strWeights[chunk] = strWeight;
+    weightArgPtr->numStrWts[chunk] = numStrWt;
+}
+#endif /* USE_SEEDED_DATA_GENERATION */
+
+
 /* =============================================================================
  * genScalData_seq
  * =============================================================================
@@ -119,8 +596,26 @@ genScalData_seq (graphSDG* SDGdataPtr)
         permV[i] = i;
     }
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    unsigned long* draws =
+        (unsigned long*)malloc(TOT_VERTICES * sizeof(unsigned long));
+    assert(draws);
+    fillArg_t fillArg;
+    fillArg.values = draws;
+    fillArg.num = TOT_VERTICES;
+    fillArg.range = 0;
+    forEachChunk(PHASE_PERMUTE,
+                 NUM_CHUNK(fillArg.num, SDG_FILL_CHUNK),
+                 fillChunk,
+                 (void*)&fillArg);
+#endif
+
     for (i = 0; i < TOT_VERTICES; i++) {
+#ifdef USE_SEEDED_DATA_GENERATION
+        long t1 = draws[i];
+#else
         long t1 = random_generate(stream);
+#endif
         long t = i + t1 % (TOT_VERTICES - i);
         if (t != i) {
             ULONGINT_T t2 = permV[t];
@@ -129,6 +624,10 @@ genScalData_seq (graphSDG* SDGdataPtr)
         }
     }
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    free(draws);
+#endif
+
     /*
      * STEP 1: Create Cliques
      */
@@ -146,9 +645,22 @@ genScalData_seq (graphSDG* SDGdataPtr)
 
 
     /* Generate random clique sizes. */
+#ifdef USE_SEEDED_DATA_GENERATION
+    fillArg.values = (unsigned long*)cliqueSizes;
+    fillArg.num = estTotCliques;
+    fillArg.range = MAX_CLIQUE_SIZE;
+    forEachChunk(PHASE_CLIQUE_SIZE,
+                 NUM_CHUNK(fillArg.num, SDG_FILL_CHUNK),
+                 fillChunk,
+                 (void*)&fillArg);
+    for (i = 0; i < estTotCliques; i++) {
+        cliqueSizes[i]++;
+    }
+#else
     for (i = 0; i < estTotCliques; i++) {
         cliqueSizes[i] = 1 + (random_generate(stream) % MAX_CLIQUE_SIZE);
     }
+#endif
 
     long totCliques = 0;
 
@@ -228,7 +740,6 @@ genScalData_seq (graphSDG* SDGdataPtr)
      * Initialize edge counter
      */
     long i_edgePtr = 0;
-    float p = PROB_UNIDIRECTIONAL;
 
     /*
      * Partial edgeLists
@@ -242,6 +753,22 @@ genScalData_seq (graphSDG* SDGdataPtr)
     assert(startV);
     assert(endV);
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    edgeArg_t edgeArg;
+    edgeArg.cliqueSizes = cliqueSizes;
+    edgeArg.firstVsInCliques = firstVsInCliques;
+    edgeArg.totCliques = totCliques;
+    long numChunk = NUM_CHUNK(totCliques, SDG_CLIQUE_CHUNK);
+    edgeArg.chunks = (edgeChunk_t*)malloc(numChunk * sizeof(edgeChunk_t));
+    assert(edgeArg.chunks);
+    forEachChunk(PHASE_CLIQUE_EDGE, numChunk, cliqueEdgeChunk, (void*)&edgeArg);
+    i_edgePtr = mergeEdgeChunks(edgeArg.chunks,
+                                numChunk,
+                                startV,
+                                endV,
+                                estTotEdges);
+    free(edgeArg.chunks);
+#else /* !USE_SEEDED_DATA_GENERATION */
     /*
      * Tmp array to keep track of the no. of parallel edges in each direction
      */
@@ -257,87 +784,23 @@ genScalData_seq (graphSDG* SDGdataPtr)
     /*
      * Create edges
      */
-     long i_clique;
-
-     for (i_clique = 0; i_clique < totCliques; i_clique++) {
-
-        /*
-         * Get current clique parameters
-         */
-
-        long i_cliqueSize = cliqueSizes[i_clique];
-        long i_firstVsInClique = firstVsInCliques[i_clique];
-
-        /*
-         * First create at least one edge between two vetices in a clique
-         */
-
-        for (i = 0; i < i_cliqueSize; i++) {
-
-            long j;
-            for (j = 0; j < i; j++) {
-
-                float r = (float)(random_generate(stream) % 1000) / (float)1000;
-                if (r >= p) {
-
-                    startV[i_edgePtr] = i + i_firstVsInClique;
-                    endV[i_edgePtr] = j + i_firstVsInClique;
-                    i_edgePtr++;
-                    tmpEdgeCounter[i][j] = 1;
-
-                    startV[i_edgePtr] = j + i_firstVsInClique;
-                    endV[i_edgePtr] = i + i_firstVsInClique;
-                    i_edgePtr++;
-                    tmpEdgeCounter[j][i] = 1;
-
-                } else  if (r >= 0.5) {
-
-                    startV[i_edgePtr] = i + i_firstVsInClique;
-                    endV[i_edgePtr] = j + i_firstVsInClique;
-                    i_edgePtr++;
-                    tmpEdgeCounter[i][j] = 1;
-                    tmpEdgeCounter[j][i] = 0;
-
-                } else {
-
-                    startV[i_edgePtr] = j + i_firstVsInClique;
-                    endV[i_edgePtr] = i + i_firstVsInClique;
-                    i_edgePtr++;
-                    tmpEdgeCounter[j][i] = 1;
-                    tmpEdgeCounter[i][j] = 0;
-
-                }
-
-            } /* for j */
-        } /* for i */
-
-        if (i_cliqueSize != 1) {
-            long randNumEdges = (long)(random_generate(stream)
-                                       % (2*i_cliqueSize*MAX_PARAL_EDGES));
-            long i_paralEdge;
-            for (i_paralEdge = 0; i_paralEdge < randNumEdges; i_paralEdge++) {
-                i = (random_generate(stream) % i_cliqueSize);
-                long j = (random_generate(stream) % i_cliqueSize);
-                if ((i != j) && (tmpEdgeCounter[i][j] < MAX_PARAL_EDGES)) {
-                    float r = (float)(random_generate(stream) % 1000) / (float)1000;
-                    if (r >= p) {
-                        /* Copy to edge structure. */
-                        startV[i_edgePtr] = i + i_firstVsInClique;
-                        endV[i_edgePtr] = j + i_firstVsInClique;
-                        i_edgePtr++;
-                        tmpEdgeCounter[i][j]++;
-                    }
-                }
-            }
-        }
-
-    } /* for i_clique */
+    long i_clique;
+
+    for (i_clique = 0; i_clique < totCliques; i_clique++) {
+        i_edgePtr += addCliqueEdges(stream,
+                                    cliqueSizes[i_clique],
+                                    firstVsInCliques[i_clique],
+                                    tmpEdgeCounter,
+                                    &startV[i_edgePtr],
+                                    &endV[i_edgePtr]);
+    }
 
     for (i = 0; i < MAX_CLIQUE_SIZE; i++) {
         free(tmpEdgeCounter[i]);
     }
 
     free(tmpEdgeCounter);
+#endif /* !USE_SEEDED_DATA_GENERATION */
 
 
     /*
@@ -379,153 +842,32 @@ genScalData_seq (graphSDG* SDGdataPtr)
      * STEP 3: Connect the cliques
      */
 
-    i_edgePtr = 0;
-    p = PROB_INTERCL_EDGES;
-
     /*
      * Generating inter-clique edges as given in the specs
      */
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    numChunk = NUM_CHUNK(TOT_VERTICES, SDG_VERTEX_CHUNK);
+    edgeArg.chunks = (edgeChunk_t*)malloc(numChunk * sizeof(edgeChunk_t));
+    assert(edgeArg.chunks);
+    forEachChunk(PHASE_INTER_EDGE, numChunk, interEdgeChunk, (void*)&edgeArg);
+    i_edgePtr = mergeEdgeChunks(edgeArg.chunks,
+                                numChunk,
+                                startV,
+                                endV,
+                                estTotEdges);
+    free(edgeArg.chunks);
+#else /* !USE_SEEDED_DATA_GENERATION */
+    i_edgePtr = 0;
     for (i = 0; i < TOT_VERTICES; i++) {
-
-        ULONGINT_T tempVertex1 = i;
-        long h = totCliques;
-        long l = 0;
-        long t = -1;
-        while (h - l > 1) {
-            long m = (h + l) / 2;
-            if (tempVertex1 >= firstVsInCliques[m]) {
-                l = m;
-            } else {
-                if ((tempVertex1 < firstVsInCliques[m]) && (m > 0)) {
-                    if (tempVertex1 >= firstVsInCliques[m-1]) {
-                        t = m - 1;
-                        break;
-                    } else {
-                        h = m;
-                    }
-                }
-            }
-        }
-
-        if (t == -1) {
-            long m;
-            for (m = (l + 1); m < h; m++) {
-                if (tempVertex1<firstVsInCliques[m]) {
-                    break;
-                }
-            }
-            t = m-1;
-        }
-
-        long t1 = firstVsInCliques[t];
-
-        ULONGINT_T d;
-        for (d = 1, p = PROB_INTERCL_EDGES; d < TOT_VERTICES; d *= 2, p /= 2) {
-
-            float r = (float)(random_generate(stream) % 1000) / (float)1000;
-
-            if (r <= p) {
-
-                ULONGINT_T tempVertex2 = (i+d) % TOT_VERTICES;
-
-                h = totCliques;
-                l = 0;
-                t = -1;
-                while (h - l > 1) {
-                    long m = (h + l) / 2;
-                    if (tempVertex2 >= firstVsInCliques[m]) {
-                        l = m;
-                    } else {
-                        if ((tempVertex2 < firstVsInCliques[m]) && (m > 0)) {
-                            if (firstVsInCliques[m-1] <= tempVertex2) {
-                                t = m - 1;
-                                break;
-                            } else {
-                                h = m;
-                            }
-                        }
-                    }
-                }
-
-                if (t == -1) {
-                    long m;
-                    for (m = (l + 1); m < h; m++) {
-                        if (tempVertex2 < firstVsInCliques[m]) {
-                            break;
-                        }
-                    }
-                    t = m - 1;
-                }
-
-                long t2 = firstVsInCliques[t];
-
-                if (t1 != t2) {
-                    long randNumEdges =
-                        random_generate(stream) % MAX_PARAL_EDGES + 1;
-                    long j;
-                    for (j = 0; j < randNumEdges; j++) {
-                        startV[i_edgePtr] = tempVertex1;
-                        endV[i_edgePtr] = tempVertex2;
-                        i_edgePtr++;
-                    }
-                }
-
-            } /* r <= p */
-
-            float r0 = (float)(random_generate(stream) % 1000) / (float)1000;
-
-            if ((r0 <= p) && (i >= d)) {
-
-                ULONGINT_T tempVertex2 = (i-d) % TOT_VERTICES;
-
-                h = totCliques;
-                l = 0;
-                t = -1;
-                while (h - l > 1) {
-                    long m = (h + l) / 2;
-                    if (tempVertex2 >= firstVsInCliques[m]) {
-                        l = m;
-                    } else {
-                        if ((tempVertex2 < firstVsInCliques[m]) && (m > 0)) {
-                            if (firstVsInCliques[m-1] <= tempVertex2) {
-                                t = m - 1;
-                                break;
-                            } else {
-                                h = m;
-                            }
-                        }
-                    }
-                }
-
-                if (t == -1) {
-                    long m;
-                    for (m = (l + 1); m < h; m++) {
-                        if (tempVertex2 < firstVsInCliques[m]) {
-                            break;
-                        }
-                    }
-                    t = m - 1;
-                }
-
-                long t2 = firstVsInCliques[t];
-
-                if (t1 != t2) {
-                    long randNumEdges =
-                        random_generate(stream) % MAX_PARAL_EDGES + 1;
-                    long j;
-                    for (j = 0; j < randNumEdges; j++) {
-                        startV[i_edgePtr] = tempVertex1;
-                        endV[i_edgePtr] = tempVertex2;
-                        i_edgePtr++;
-                    }
-                }
-
-            } /* r0 <= p && (i-d) > 0 */
-
-        } /* for d, p */
-
-    } /* for i */
+        i_edgePtr += addInterEdges(stream,
+                                   i,
+                                   firstVsInCliques,
+                                   totCliques,
+                                   &startV[i_edgePtr],
+                                   &endV[i_edgePtr]);
+    }
+#endif /* !USE_SEEDED_DATA_GENERATION */
 
 
     i_edgeEndCounter = i_edgePtr;
@@ -563,9 +905,25 @@ genScalData_seq (graphSDG* SDGdataPtr)
         (LONGINT_T*)malloc(numEdgesPlaced * sizeof(LONGINT_T));
     assert(SDGdataPtr->intWeight);
 
-    p = PERC_INT_WEIGHTS;
     ULONGINT_T numStrWtEdges  = 0;
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    weightArg_t weightArg;
+    weightArg.intWeight = SDGdataPtr->intWeight;
+    weightArg.numEdge = numEdgesPlaced;
+    numChunk = NUM_CHUNK(numEdgesPlaced, SDG_WEIGHT_CHUNK);
+    weightArg.strWeights = (char**)malloc(numChunk * sizeof(char*));
+    weightArg.numStrWts = (long*)malloc(numChunk * sizeof(long));
+    assert(weightArg.strWeights);
+    assert(weightArg.numStrWts);
+    forEachChunk(PHASE_WEIGHT, numChunk, weightChunk, (void*)&weightArg);
+    long c;
+    for (c = 0; c < numChunk; c++) {
+        numStrWtEdges += weightArg.numStrWts[c];
+    }
+#else /* !USE_SEEDED_DATA_GENERATION */
+    float p = PERC_INT_WEIGHTS;
+
     for (i = 0; i < numEdgesPlaced; i++) {
         float r = (float)(random_generate(stream) % 1000) / (float)1000;
         if (r <= p) {
@@ -576,6 +934,7 @@ genScalData_seq (graphSDG* SDGdataPtr)
             numStrWtEdges++;
         }
     }
+#endif /* !USE_SEEDED_DATA_GENERATION */
 
     long t = 0;
     for (i = 0; i < numEdgesPlaced; i++) {
@@ -589,6 +948,18 @@ genScalData_seq (graphSDG* SDGdataPtr)
         (char*)malloc(numStrWtEdges * MAX_STRLEN * sizeof(char));
     assert(SDGdataPtr->strWeight);
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    /* String edges were numbered in edge order, so chunks go in order too */
+    char* strWeight = SDGdataPtr->strWeight;
+    for (c = 0; c < numChunk; c++) {
+        long numChar = weightArg.numStrWts[c] * MAX_STRLEN;
+        memcpy(strWeight, weightArg.strWeights[c], numChar * sizeof(char));
+        strWeight += numChar;
+        free(weightArg.strWeights[c]);
+    }
+    free(weightArg.strWeights);
+    free(weightArg.numStrWts);
+#else /* !USE_SEEDED_DATA_GENERATION */
     for (i = 0; i < numEdgesPlaced; i++) {
         if (SDGdataPtr->intWeight[i] <= 0) {
             long j;
@@ -598,6 +969,7 @@ genScalData_seq (graphSDG* SDGdataPtr)
             }
         }
     }
+#endif /* !USE_SEEDED_DATA_GENERATION */
 
     /*
      * Choose SOUGHT STRING randomly if not assigned
@@ -608,6 +980,9 @@ genScalData_seq (graphSDG* SDGdataPtr)
         assert(SOUGHT_STRING);
     }
 
+#ifdef USE_SEEDED_DATA_GENERATION
+    random_seedStream(stream, SDG_SEED, PHASE_SOUGHT);
+#endif
     t = random_generate(stream) % numStrWtEdges;
     long j;
     for (j = 0; j < MAX_STRLEN; j++) {
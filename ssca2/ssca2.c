@@ -67,8 +67,10 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include "computeGraph.h"
 #include "cutClusters.h"
+#include "dataset.h"
 #include "defs.h"
 #include "findSubGraphs.h"
 #include "genScalData.h"
@@ -83,6 +85,133 @@
 HTM_STATS(global_tsx_status);
 
 
+#if defined(USE_DATA_CACHE) && !defined(USE_PARALLEL_DATA_GENERATION)
+/* =============================================================================
+ * getParams
+ * -- Everything genScalData_seq reads; probabilities are kept to 6 places
+ * =============================================================================
+ */
+static long
+getParams (long* params)
+{
+    params[0] = SCALE;
+    params[1] = TOT_VERTICES;
+    params[2] = MAX_CLIQUE_SIZE;
+    params[3] = MAX_PARAL_EDGES;
+    params[4] = (long)(PROB_UNIDIRECTIONAL * 1000000);
+    params[5] = (long)(PROB_INTERCL_EDGES * 1000000);
+    params[6] = (long)(PERC_INT_WEIGHTS * 1000000);
+    params[7] = MAX_INT_WEIGHT;
+    params[8] = MAX_STRLEN;
+#ifdef USE_SEEDED_DATA_GENERATION
+    params[9] = 1;
+#else
+    params[9] = 0;
+#endif
+
+    return 10;
+}
+
+
+/* =============================================================================
+ * loadSDG
+ * -- Sections are startVertex, endVertex, intWeight, strWeight and the
+ *    sought string
+ * -- Returns FALSE if there is no cached copy
+ * =============================================================================
+ */
+static bool_t
+loadSDG (graphSDG* SDGdataPtr)
+{
+    long params[DATASET_MAX_PARAM];
+    long numParam = getParams(params);
+    dataset_t* datasetPtr = dataset_open("ssca2", params, numParam);
+    if (datasetPtr == NULL) {
+        return FALSE;
+    }
+
+    long sizes[5];
+    const void* sections[5];
+    long s;
+    for (s = 0; s < 5; s++) {
+        sections[s] = dataset_getSection(datasetPtr, s, &sizes[s]);
+        if (sections[s] == NULL) {
+            dataset_close(datasetPtr);
+            return FALSE;
+        }
+    }
+    long numEdgesPlaced = sizes[0] / sizeof(ULONGINT_T);
+    if (sizes[1] != sizes[0] ||
+        sizes[2] != (long)(numEdgesPlaced * sizeof(LONGINT_T)) ||
+        sizes[4] != MAX_STRLEN)
+    {
+        dataset_close(datasetPtr);
+        return FALSE;
+    }
+
+    SDGdataPtr->numEdgesPlaced = numEdgesPlaced;
+    SDGdataPtr->startVertex = (ULONGINT_T*)malloc(sizes[0]);
+    SDGdataPtr->endVertex = (ULONGINT_T*)malloc(sizes[1]);
+    SDGdataPtr->intWeight = (LONGINT_T*)malloc(sizes[2]);
+    SDGdataPtr->strWeight = (char*)malloc(sizes[3]);
+    assert(SDGdataPtr->startVertex && SDGdataPtr->endVertex &&
+           SDGdataPtr->intWeight && SDGdataPtr->strWeight);
+    memcpy(SDGdataPtr->startVertex, sections[0], sizes[0]);
+    memcpy(SDGdataPtr->endVertex, sections[1], sizes[1]);
+    memcpy(SDGdataPtr->intWeight, sections[2], sizes[2]);
+    memcpy(SDGdataPtr->strWeight, sections[3], sizes[3]);
+
+    /* As genScalData_seq does */
+    if (strlen(SOUGHT_STRING) != MAX_STRLEN) {
+        SOUGHT_STRING = (char*)malloc(MAX_STRLEN * sizeof(char));
+        assert(SOUGHT_STRING);
+    }
+    memcpy(SOUGHT_STRING, sections[4], MAX_STRLEN);
+
+    dataset_close(datasetPtr);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * storeSDG
+ * =============================================================================
+ */
+static void
+storeSDG (graphSDG* SDGdataPtr)
+{
+    long params[DATASET_MAX_PARAM];
+    long numParam = getParams(params);
+    dataset_t* datasetPtr = dataset_create("ssca2", params, numParam);
+    if (datasetPtr == NULL) {
+        return;
+    }
+
+    long numEdgesPlaced = SDGdataPtr->numEdgesPlaced;
+    long numStrWtEdges = 0;
+    long i;
+    for (i = 0; i < numEdgesPlaced; i++) {
+        if (SDGdataPtr->intWeight[i] <= 0) {
+            numStrWtEdges++;
+        }
+    }
+
+    bool_t status =
+        dataset_addSection(datasetPtr, SDGdataPtr->startVertex,
+                           numEdgesPlaced * sizeof(ULONGINT_T)) &&
+        dataset_addSection(datasetPtr, SDGdataPtr->endVertex,
+                           numEdgesPlaced * sizeof(ULONGINT_T)) &&
+        dataset_addSection(datasetPtr, SDGdataPtr->intWeight,
+                           numEdgesPlaced * sizeof(LONGINT_T)) &&
+        dataset_addSection(datasetPtr, SDGdataPtr->strWeight,
+                           numStrWtEdges * MAX_STRLEN * sizeof(char)) &&
+        dataset_addSection(datasetPtr, SOUGHT_STRING, MAX_STRLEN);
+    dataset_commit(datasetPtr, status);
+}
+#endif /* USE_DATA_CACHE && !USE_PARALLEL_DATA_GENERATION */
+
+
 MAIN(argc, argv)
 {
     GOTO_REAL();
@@ -183,9 +312,15 @@ MAIN(argc, argv)
     thread_start(genScalData, (void*)SDGdata);
 #endif
     GOTO_REAL();
-#else /* !USE_PARALLEL_DATA_GENERATION */
+#elif defined(USE_DATA_CACHE)
+    /* The parallel generator depends on thread timing, so only this is cached */
+    if (!loadSDG(SDGdata)) {
+        genScalData_seq(SDGdata);
+        storeSDG(SDGdata);
+    }
+#else /* !USE_PARALLEL_DATA_GENERATION && !USE_DATA_CACHE */
     genScalData_seq(SDGdata);
-#endif /* !USE_PARALLEL_DATA_GENERATION */
+#endif /* !USE_PARALLEL_DATA_GENERATION && !USE_DATA_CACHE */
 
     TIMER_T stop;
     TIMER_READ(stop);
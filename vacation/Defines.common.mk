@@ -6,7 +6,22 @@
 
 
 CFLAGS += -DLIST_NO_DUPLICATES
-CFLAGS += -DMAP_USE_RBTREE
+#CFLAGS += -DLIST_USE_UNROLLED
+CFLAGS += -DMAP_USE_RBTREE # or -DMAP_USE_ATREE, -DMAP_USE_SKIPLIST
+#CFLAGS += -DRBTREE_COMPACT
+#CFLAGS += -DRBTREE_RELAXED
+#CFLAGS += -DRANDOM_USE_XOSHIRO # or -DRANDOM_USE_PCG, -DRANDOM_USE_PHILOX
+#CFLAGS += -DRANDOM_FILL_LEMIRE
+#CFLAGS += -DUSE_BULK_LOAD
+#CFLAGS += -DMANAGER_SHARDED
+#CFLAGS += -DCLIENT_OPEN_LOOP
+#CFLAGS += -DCUSTOMER_INLINE_INFO
+#CFLAGS += -DCLIENT_COMBINE_UPDATES
+#CFLAGS += -DMANAGER_SNAPSHOT
+#CFLAGS += -DMANAGER_DURABLE # -DDURABLE_DIR=\"/path\" to move the log
+#CFLAGS += -DRESERVATION_SPLIT
+#CFLAGS += -DRESERVATION_ESCROW
+#CFLAGS += -DCLIENT_PHASES
 CFLAGS += -DMERGE_LIST -DMERGE_RBTREE -DMERGE_CLIENT -DMERGE_MANAGER -DMERGE_RESERVATION
 
 PROG := vacation
@@ -17,11 +32,18 @@ SRCS += \
 	manager.c \
 	reservation.c \
 	vacation.c \
+	$(LIB)/atree.c \
+	$(LIB)/histogram.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/pair.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/random.c \
 	$(LIB)/rbtree.c \
+	$(LIB)/redolog.c \
+	$(LIB)/crbtree.c \
+	$(LIB)/sampler.c \
+	$(LIB)/skiplist.c \
 	$(LIB)/thread.c \
 #
 OBJS := ${SRCS:.c=.o}
@@ -77,6 +77,46 @@
 #include "thread.h"
 #include "types.h"
 
+#ifdef CLIENT_OPEN_LOOP
+#  include <math.h>
+#  include <sched.h>
+#  ifndef CLIENT_SPIN_NS
+#    define CLIENT_SPIN_NS (50000)
+#  endif
+#endif
+#ifdef CLIENT_PHASES
+#  include <limits.h>
+#  include <stdlib.h>
+#  include <string.h>
+#endif
+#if defined(CLIENT_OPEN_LOOP) || defined(CLIENT_PHASES)
+#  include <time.h>
+#endif
+
+/*
+ * Attempts are counted as aborts up front and taken back on commit. The count
+ * is changed by a TM_PURE function, so compilers that instrument transactions
+ * do not roll it back with the attempt. Hardware aborts are counted where the
+ * transaction falls back. Requests that snapshots answer without a
+ * transaction are counted as served.
+ */
+#ifdef CLIENT_PHASES
+#  define PHASE_TM_ATTEMPT(statsPtr)    phaseAdd(&(statsPtr)->numAbort, 1)
+#  define PHASE_TM_COMMIT(statsPtr)     phaseAdd(&(statsPtr)->numAbort, -1)
+#  ifdef HTM
+#    define PHASE_HTM_ABORT(statsPtr)   ((statsPtr)->numAbort++)
+#  else
+#    define PHASE_HTM_ABORT(statsPtr)   /* nothing */
+#  endif
+#  define PHASE_SERVED(statsPtr, action) \
+    ((statsPtr)->numServed[action]++)
+#else
+#  define PHASE_TM_ATTEMPT(statsPtr)    /* nothing */
+#  define PHASE_TM_COMMIT(statsPtr)     /* nothing */
+#  define PHASE_HTM_ABORT(statsPtr)     /* nothing */
+#  define PHASE_SERVED(statsPtr, action) /* nothing */
+#endif
+
 #if !defined(ORIGINAL) && defined(MERGE_CLIENT)
 # define TM_LOG_OP TM_LOG_OP_DECLARE
 # include "client.inc"
@@ -119,6 +159,30 @@ client_alloc (long id,
     clientPtr->numQueryPerTransaction = numQueryPerTransaction;
     clientPtr->queryRange = queryRange;
     clientPtr->percentUser = percentUser;
+    clientPtr->idSamplerPtr = NULL;
+
+#ifdef CLIENT_PHASES
+    clientPtr->phases = NULL;
+    clientPtr->numPhase = 0;
+    clientPtr->phaseStats = NULL;
+#endif
+
+#ifdef CLIENT_OPEN_LOOP
+    long a;
+    clientPtr->arrivalRate = 0.0;
+    clientPtr->arrivalRandomPtr = random_alloc();
+    if (clientPtr->arrivalRandomPtr == NULL) {
+        return NULL;
+    }
+    /* Own stream, so arrivals do not change the sequence of requests */
+    random_seedStream(clientPtr->arrivalRandomPtr, id, 1);
+    for (a = 0; a < NUM_ACTION; a++) {
+        clientPtr->latencies[a] = histogram_alloc();
+        if (clientPtr->latencies[a] == NULL) {
+            return NULL;
+        }
+    }
+#endif /* CLIENT_OPEN_LOOP */
 
     return clientPtr;
 }
@@ -131,22 +195,331 @@ client_alloc (long id,
 void
 client_free (client_t* clientPtr)
 {
+#ifdef CLIENT_OPEN_LOOP
+    long a;
+    for (a = 0; a < NUM_ACTION; a++) {
+        histogram_free(clientPtr->latencies[a]);
+    }
+    random_free(clientPtr->arrivalRandomPtr);
+#endif /* CLIENT_OPEN_LOOP */
+#ifdef CLIENT_PHASES
+    free(clientPtr->phaseStats);
+#endif
     free(clientPtr->randomPtr);
     free(clientPtr);
 }
 
 
+/* =============================================================================
+ * client_setIdSampler
+ * -- Customer and reservation ids become 1 + sampler_generate(samplerPtr);
+ *    the sampler is shared, not owned, and must cover queryRange values
+ * =============================================================================
+ */
+void
+client_setIdSampler (client_t* clientPtr, const sampler_t* samplerPtr)
+{
+    assert(samplerPtr == NULL ||
+           sampler_getSize(samplerPtr) == clientPtr->queryRange);
+    clientPtr->idSamplerPtr = samplerPtr;
+}
+
+
+#if defined(CLIENT_OPEN_LOOP) || defined(CLIENT_PHASES)
+/* =============================================================================
+ * nowNs
+ * =============================================================================
+ */
+static inline unsigned long
+nowNs ()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((unsigned long)ts.tv_sec * 1000000000UL + (unsigned long)ts.tv_nsec);
+}
+
+
+#endif /* CLIENT_OPEN_LOOP || CLIENT_PHASES */
+
+
+#ifdef CLIENT_OPEN_LOOP
+/* =============================================================================
+ * client_setArrivalRate
+ * -- 'rate' is in requests/second; 0 restores the closed loop
+ * =============================================================================
+ */
+void
+client_setArrivalRate (client_t* clientPtr, double rate)
+{
+    clientPtr->arrivalRate = rate;
+}
+
+
+/* =============================================================================
+ * nextArrival
+ * -- Exponential gaps give Poisson arrivals at 'rate' per second
+ * =============================================================================
+ */
+static unsigned long
+nextArrival (random_t* randomPtr, double rate, unsigned long prev)
+{
+    /* Uniform in (0, 1), never 0 so the log is finite */
+    double u = ((double)random_generate(randomPtr) + 0.5) / 4294967296.0;
+
+    return prev + (unsigned long)(-log(u) / rate * 1e9);
+}
+
+
+/* =============================================================================
+ * waitUntil
+ * -- Sleeps through long gaps and yields through the last CLIENT_SPIN_NS
+ * =============================================================================
+ */
+static void
+waitUntil (unsigned long deadline)
+{
+    unsigned long now;
+
+    while ((now = nowNs()) < deadline) {
+        unsigned long gap = deadline - now;
+        if (gap > CLIENT_SPIN_NS) {
+            struct timespec ts;
+            gap -= CLIENT_SPIN_NS;
+            ts.tv_sec = (time_t)(gap / 1000000000UL);
+            ts.tv_nsec = (long)(gap % 1000000000UL);
+            nanosleep(&ts, NULL);
+        } else {
+            sched_yield();
+        }
+    }
+}
+#endif /* CLIENT_OPEN_LOOP */
+
+
+#ifdef CLIENT_PHASES
+/* =============================================================================
+ * parseSetting
+ * -- Parses "<key>=<value>" at *strPtr and advances past it
+ * -- Returns FALSE if malformed or 'value' is negative
+ * =============================================================================
+ */
+static bool_t
+parseSetting (const char** strPtr, char* keyPtr, long* valuePtr)
+{
+    const char* str = *strPtr;
+    char* end;
+
+    if (str[0] == '\0' || str[1] != '=') {
+        return FALSE;
+    }
+    *keyPtr = str[0];
+    *valuePtr = strtol(str + 2, &end, 10);
+    if (end == str + 2 || *valuePtr < 0) {
+        return FALSE;
+    }
+    *strPtr = end;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * parsePhase
+ * -- Parses one phase at *strPtr and advances past it
+ * -- Returns FALSE if malformed
+ * =============================================================================
+ */
+static bool_t
+parsePhase (const char** strPtr, client_phase_t* phasePtr, long numClient)
+{
+    const char* str = *strPtr;
+    char* end;
+    long length = strtol(str, &end, 10);
+
+    if (end == str || length <= 0) {
+        return FALSE;
+    }
+    if (strncmp(end, "ms", 2) == 0) {
+        phasePtr->durationNs = (unsigned long)length * 1000000UL;
+        end += 2;
+    } else if (*end == 's') {
+        phasePtr->durationNs = (unsigned long)length * 1000000000UL;
+        end++;
+    } else if (*end == 't') {
+        phasePtr->numTransaction =
+            (long)((double)length / (double)numClient + 0.5);
+        if (phasePtr->numTransaction < 1) {
+            phasePtr->numTransaction = 1;
+        }
+        end++;
+    } else {
+        return FALSE;
+    }
+    str = end;
+
+    while (*str == ':') {
+        char key;
+        long value;
+        str++;
+        if (!parseSetting(&str, &key, &value)) {
+            return FALSE;
+        }
+        if ((key == 'u' || key == 'd') ? (value > 100) : (value < 1)) {
+            return FALSE;
+        }
+        switch (key) {
+            case 'u': phasePtr->percentUser = value;            break;
+            case 'd': phasePtr->percentDelete = value;          break;
+            case 'n': phasePtr->numQueryPerTransaction = value; break;
+            default:  return FALSE;
+        }
+    }
+    if (phasePtr->percentDelete >= 0 &&
+        phasePtr->percentUser + phasePtr->percentDelete > 100)
+    {
+        return FALSE;
+    }
+    *strPtr = str;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * client_parsePhases
+ * -- 'percentUser' and 'numQueryPerTransaction' are the defaults for phases
+ *    that leave them out; transaction counts are split over 'numClient'
+ * -- Returns NULL on a malformed script or failure
+ * =============================================================================
+ */
+client_phase_t*
+client_parsePhases (const char* script,
+                    long numClient,
+                    long percentUser,
+                    long numQueryPerTransaction,
+                    long* numPhasePtr)
+{
+    client_phase_t* phases;
+    const char* str;
+    long numPhase = 1;
+    long p;
+
+    for (str = script; *str != '\0'; str++) {
+        numPhase += (*str == ',');
+    }
+    phases = (client_phase_t*)malloc(numPhase * sizeof(client_phase_t));
+    if (phases == NULL) {
+        return NULL;
+    }
+
+    str = script;
+    for (p = 0; p < numPhase; p++) {
+        client_phase_t* phasePtr = &phases[p];
+        phasePtr->numTransaction = 0;
+        phasePtr->durationNs = 0;
+        phasePtr->percentUser = percentUser;
+        phasePtr->percentDelete = -1;
+        phasePtr->numQueryPerTransaction = numQueryPerTransaction;
+        if (!parsePhase(&str, phasePtr, numClient) ||
+            *str != ((p == numPhase - 1) ? '\0' : ','))
+        {
+            free(phases);
+            return NULL;
+        }
+        str++;
+    }
+
+    *numPhasePtr = numPhase;
+
+    return phases;
+}
+
+
+/* =============================================================================
+ * client_setPhases
+ * -- The phases are shared, not owned; the run ends with the last phase
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+client_setPhases (client_t* clientPtr,
+                  const client_phase_t* phases,
+                  long numPhase)
+{
+    long p;
+
+    free(clientPtr->phaseStats);
+    clientPtr->phaseStats =
+        (client_phase_stats_t*)calloc(numPhase, sizeof(client_phase_stats_t));
+    if (clientPtr->phaseStats == NULL) {
+        return FALSE;
+    }
+    clientPtr->phases = phases;
+    clientPtr->numPhase = numPhase;
+
+    /* Buffers in client_run are sized once, for the largest phase */
+    for (p = 0; p < numPhase; p++) {
+        if (phases[p].numQueryPerTransaction >
+            clientPtr->numQueryPerTransaction)
+        {
+            clientPtr->numQueryPerTransaction =
+                phases[p].numQueryPerTransaction;
+        }
+    }
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * phaseAdd
+ * -- Outside the transaction's undo, so aborted attempts stay counted
+ * =============================================================================
+ */
+TM_PURE
+static void
+phaseAdd (long* counterPtr, long delta)
+{
+    *counterPtr += delta;
+}
+
+
+/* =============================================================================
+ * isPhaseOver
+ * =============================================================================
+ */
+static inline bool_t
+isPhaseOver (const client_phase_t* phasePtr,
+             const client_phase_stats_t* statsPtr,
+             long numInPhase,
+             unsigned long now)
+{
+    if (phasePtr->numTransaction > 0) {
+        return (numInPhase >= phasePtr->numTransaction);
+    }
+
+    return (now - statsPtr->startNs >= phasePtr->durationNs);
+}
+#endif /* CLIENT_PHASES */
+
+
 /* =============================================================================
  * selectAction
+ * -- A negative 'percentDelete' splits the rest evenly with table updates
  * =============================================================================
  */
 static action_t
-selectAction (long r, long percentUser)
+selectAction (long r, long percentUser, long percentDelete)
 {
     action_t action;
 
     if (r < percentUser) {
         action = ACTION_MAKE_RESERVATION;
+    } else if (percentDelete >= 0) {
+        action = ((r < percentUser + percentDelete) ?
+                  ACTION_DELETE_CUSTOMER : ACTION_UPDATE_TABLES);
     } else if (r & 1) {
         action = ACTION_DELETE_CUSTOMER;
     } else {
@@ -157,6 +530,95 @@ selectAction (long r, long percentUser)
 }
 
 
+/* =============================================================================
+ * selectId
+ * -- Returns a customer or reservation id in [1, queryRange]
+ * =============================================================================
+ */
+static inline long
+selectId (const sampler_t* idSamplerPtr, random_t* randomPtr, long queryRange)
+{
+    if (idSamplerPtr != NULL) {
+        return (sampler_generate(idSamplerPtr, randomPtr) + 1);
+    }
+
+    return (random_generate(randomPtr) % queryRange + 1);
+}
+
+
+#ifdef CLIENT_COMBINE_UPDATES
+#define UPDATE_INDEX_BITS (20)
+#define UPDATE_ID_BITS    (41)
+
+/* =============================================================================
+ * combineUpdates
+ * -- Sorts a batch of table updates by (type, id), keeping batch order within
+ *    each reservation, and folds each run of adds to a reservation into one
+ *    add of nums[n] with the last price given
+ * -- Deletes are kept as they are: one may fail (too few free, or a flight
+ *    still in use), and the adds around it must then apply as they would have
+ *    in sequence. Adds never fail, so folding them does not change the result.
+ * -- 'scratch' holds 2 * numUpdate longs
+ * -- Returns the new number of updates
+ * =============================================================================
+ */
+static long
+combineUpdates (long* types, long* ids, long* ops, long* nums, long* prices,
+                long numUpdate, long* scratch)
+{
+    long* keys = scratch;
+    long* adds = scratch + numUpdate; /* price of each add, -1 for a delete */
+    long numCombined = 0;
+    long i;
+    long j;
+
+    assert(numUpdate < (1L << UPDATE_INDEX_BITS));
+
+    /*
+     * Sort one word per update, (type, id, index), so the sort moves a single
+     * array and ties keep their batch order.
+     */
+    for (i = 0; i < numUpdate; i++) {
+        assert(ids[i] >= 0 && ids[i] < (1L << UPDATE_ID_BITS));
+        keys[i] = ((((types[i] << UPDATE_ID_BITS) | ids[i]) << UPDATE_INDEX_BITS) | i);
+        adds[i] = (ops[i] ? prices[i] : -1);
+    }
+    for (i = 1; i < numUpdate; i++) {
+        long key = keys[i];
+        for (j = i; j > 0 && keys[j-1] > key; j--) {
+            keys[j] = keys[j-1];
+        }
+        keys[j] = key;
+    }
+
+    /* keys and adds hold the whole batch, so the arrays are rewritten in place */
+    for (i = 0; i < numUpdate; i++) {
+        long group = (keys[i] >> UPDATE_INDEX_BITS);
+        long add = adds[keys[i] & ((1L << UPDATE_INDEX_BITS) - 1)];
+
+        if (add >= 0 &&
+            i > 0 &&
+            (keys[i-1] >> UPDATE_INDEX_BITS) == group &&
+            ops[numCombined-1])
+        {
+            nums[numCombined-1] += 100;
+            prices[numCombined-1] = add;
+            continue;
+        }
+
+        types[numCombined] = (group >> UPDATE_ID_BITS);
+        ids[numCombined] = (group & ((1L << UPDATE_ID_BITS) - 1));
+        ops[numCombined] = (add >= 0);
+        nums[numCombined] = 100;
+        prices[numCombined] = add;
+        numCombined++;
+    }
+
+    return numCombined;
+}
+#endif /* CLIENT_COMBINE_UPDATES */
+
+
 /* =============================================================================
  * client_run
  * -- Execute list operations on the database
@@ -237,18 +699,77 @@ client_run (void* argPtr)
     long numQueryPerTransaction = clientPtr->numQueryPerTransaction;
     long queryRange             = clientPtr->queryRange;
     long percentUser            = clientPtr->percentUser;
+    const sampler_t* idSamplerPtr = clientPtr->idSamplerPtr;
 
     long* types  = (long*)P_MALLOC(numQueryPerTransaction * sizeof(long));
     long* ids    = (long*)P_MALLOC(numQueryPerTransaction * sizeof(long));
     long* ops    = (long*)P_MALLOC(numQueryPerTransaction * sizeof(long));
     long* prices = (long*)P_MALLOC(numQueryPerTransaction * sizeof(long));
+#ifdef CLIENT_COMBINE_UPDATES
+    long* nums   = (long*)P_MALLOC(numQueryPerTransaction * sizeof(long));
+    long* scratch = (long*)P_MALLOC(2 * numQueryPerTransaction * sizeof(long));
+#endif
 
     long i;
 
+#ifdef CLIENT_OPEN_LOOP
+    unsigned long arrival = nowNs();
+#endif
+
+    long percentDelete = -1;
+#ifdef CLIENT_PHASES
+    client_phase_stats_t noStats = { 0 };
+    client_phase_stats_t* phaseStatsPtr = &noStats;
+    long phase = -1;
+    long numInPhase = 0;
+    if (clientPtr->numPhase > 0) {
+        numOperation = LONG_MAX; /* the script decides */
+    }
+#endif
+
     for (i = 0; i < numOperation; i++) {
 
+#ifdef CLIENT_PHASES
+        if (clientPtr->numPhase > 0) {
+            unsigned long now = nowNs();
+            while (phase < 0 ||
+                   isPhaseOver(&clientPtr->phases[phase], phaseStatsPtr,
+                               numInPhase, now))
+            {
+                if (phase >= 0) {
+                    phaseStatsPtr->stopNs = now;
+                }
+                if (++phase == clientPtr->numPhase) {
+                    break;
+                }
+                const client_phase_t* phasePtr = &clientPtr->phases[phase];
+                phaseStatsPtr = &clientPtr->phaseStats[phase];
+                phaseStatsPtr->startNs = now;
+                numInPhase = 0;
+                percentUser = phasePtr->percentUser;
+                percentDelete = phasePtr->percentDelete;
+                numQueryPerTransaction = phasePtr->numQueryPerTransaction;
+            }
+            if (phase == clientPtr->numPhase) {
+                break;
+            }
+            numInPhase++;
+        }
+#endif /* CLIENT_PHASES */
+
+#ifdef CLIENT_OPEN_LOOP
+        if (clientPtr->arrivalRate > 0.0) {
+            arrival = nextArrival(clientPtr->arrivalRandomPtr,
+                                  clientPtr->arrivalRate,
+                                  arrival);
+            waitUntil(arrival);
+        } else {
+            arrival = nowNs();
+        }
+#endif
+
         long r = random_generate(randomPtr) % 100;
-        action_t action = selectAction(r, percentUser);
+        action_t action = selectAction(r, percentUser, percentDelete);
 
         switch (action) {
 
@@ -257,16 +778,43 @@ client_run (void* argPtr)
                 long maxIds[NUM_RESERVATION_TYPE] = { -1, -1, -1 };
                 long n;
                 long numQuery = random_generate(randomPtr) % numQueryPerTransaction + 1;
-                long customerId = random_generate(randomPtr) % queryRange + 1;
+                long customerId = selectId(idSamplerPtr, randomPtr, queryRange);
                 for (n = 0; n < numQuery; n++) {
                     types[n] = random_generate(randomPtr) % NUM_RESERVATION_TYPE;
-                    ids[n] = (random_generate(randomPtr) % queryRange) + 1;
+                    ids[n] = selectId(idSamplerPtr, randomPtr, queryRange);
                 }
                 bool_t isFound = FALSE;
+#ifdef MANAGER_SNAPSHOT
+                /*
+                 * Pick from snapshots. Each id is read from its own committed
+                 * state, so the maxima may mix commits; reserving re-checks
+                 * availability (see MANAGER_SNAPSHOT in manager.h).
+                 */
+                for (n = 0; n < numQuery; n++) {
+                    long t = types[n];
+                    long id = ids[n];
+                    long price = -1;
+                    if (manager_snapshotQuery(managerPtr, t, id, &price) < 0) {
+                        price = -1;
+                    }
+                    if (price > maxPrices[t]) {
+                        maxPrices[t] = price;
+                        maxIds[t] = id;
+                        isFound = TRUE;
+                    }
+                } /* for n */
+                if (!isFound) {
+                    PHASE_SERVED(phaseStatsPtr, action);
+                    break;
+                }
+#endif /* MANAGER_SNAPSHOT */
+                MANAGER_REDO_ENTER(managerPtr);
                 HTM_TX_INIT;
 tsx_begin_make:
                 if (HTM_BEGIN(tsx_status, global_tsx_status)) {
                     HTM_LOCK_READ();
+                    MANAGER_REDO_BEGIN(managerPtr);
+#ifndef MANAGER_SNAPSHOT
                     for (n = 0; n < numQuery; n++) {
                         long t = types[n];
                         long id = ids[n];
@@ -296,6 +844,7 @@ tsx_begin_make:
                             isFound = TRUE;
                         }
                     } /* for n */
+#endif /* !MANAGER_SNAPSHOT */
                     if (isFound) {
                         HTMMANAGER_ADD_CUSTOMER(managerPtr, customerId);
                     }
@@ -311,14 +860,20 @@ tsx_begin_make:
                         HTMMANAGER_RESERVE_ROOM(managerPtr,
                                              customerId, maxIds[RESERVATION_ROOM]);
                     }
+                    HTMMANAGER_REDO_END(managerPtr);
                     HTM_END(global_tsx_status);
                 } else {
+                    PHASE_HTM_ABORT(phaseStatsPtr);
                     HTM_RETRY(tsx_status, tsx_begin_make);
 
                     TM_BEGIN();
 #if !defined(ORIGINAL) && defined(MERGE_CLIENT)
                     TM_LOG_BEGIN(CLT_RESERVE, merge);
 #endif /* !ORIGINAL && MERGE_CLIENT */
+                    MANAGER_REDO_BEGIN(managerPtr);
+                    RESERVATION_ESCROW_BEGIN();
+                    PHASE_TM_ATTEMPT(phaseStatsPtr);
+#ifndef MANAGER_SNAPSHOT
                     for (n = 0; n < numQuery; n++) {
                         long t = types[n];
                         long id = ids[n];
@@ -348,6 +903,7 @@ tsx_begin_make:
                             isFound = TRUE;
                         }
                     } /* for n */
+#endif /* !MANAGER_SNAPSHOT */
                     if (isFound) {
                         MANAGER_ADD_CUSTOMER(managerPtr, customerId);
                     }
@@ -365,24 +921,42 @@ tsx_begin_make:
                     }
                     /* Since the merge function remains in scope, do not explicitly end the operation; it will be done implicitly when the transaction ends */
                     // TM_LOG_END(CLT_RESERVE, NULL);
+                    MANAGER_REDO_END(managerPtr);
                     TM_END();
+                    RESERVATION_ESCROW_COMMIT();
+                    PHASE_TM_COMMIT(phaseStatsPtr);
                 }
+                MANAGER_REDO_COMMIT(managerPtr);
 
                 break;
             }
 
             case ACTION_DELETE_CUSTOMER: {
-                long customerId = random_generate(randomPtr) % queryRange + 1;
+                long customerId = selectId(idSamplerPtr, randomPtr, queryRange);
+#ifdef MANAGER_SNAPSHOT
+                if (manager_snapshotQueryCustomerBill(managerPtr, customerId) < 0) {
+                    PHASE_SERVED(phaseStatsPtr, action);
+                    break;
+                }
+#endif /* MANAGER_SNAPSHOT */
+                MANAGER_REDO_ENTER(managerPtr);
                 HTM_TX_INIT;
 tsx_begin_delete:
                 if (HTM_BEGIN(tsx_status, global_tsx_status)) {
                     HTM_LOCK_READ();
+                    MANAGER_REDO_BEGIN(managerPtr);
+#ifdef MANAGER_SNAPSHOT
+                    HTMMANAGER_DELETE_CUSTOMER(managerPtr, customerId);
+#else
                     long bill = HTMMANAGER_QUERY_CUSTOMER_BILL(managerPtr, customerId);
                     if (bill >= 0) {
                         HTMMANAGER_DELETE_CUSTOMER(managerPtr, customerId);
                     }
+#endif
+                    HTMMANAGER_REDO_END(managerPtr);
                     HTM_END(global_tsx_status);
                 } else {
+                    PHASE_HTM_ABORT(phaseStatsPtr);
                     HTM_RETRY(tsx_status, tsx_begin_delete);
 
                     TM_BEGIN();
@@ -390,14 +964,25 @@ tsx_begin_delete:
 #if !defined(ORIGINAL) && defined(MERGE_CLIENT)
                     TM_LOG_BEGIN(CLT_DELCUSTOMER, NULL);
 #endif /* !ORIGINAL && MERGE_CLIENT */
+                    MANAGER_REDO_BEGIN(managerPtr);
+                    RESERVATION_ESCROW_BEGIN();
+                    PHASE_TM_ATTEMPT(phaseStatsPtr);
+#ifdef MANAGER_SNAPSHOT
+                    MANAGER_DELETE_CUSTOMER(managerPtr, customerId);
+#else
                     long bill = MANAGER_QUERY_CUSTOMER_BILL(managerPtr, customerId);
                     if (bill >= 0) {
                         MANAGER_DELETE_CUSTOMER(managerPtr, customerId);
                     }
+#endif
                     /* Since the merge function remains in scope, do not explicitly end the operation; it will be done implicitly when the transaction ends */
                     // TM_LOG_END(CLT_DELCUSTOMER, NULL);
+                    MANAGER_REDO_END(managerPtr);
                     TM_END();
+                    RESERVATION_ESCROW_COMMIT();
+                    PHASE_TM_COMMIT(phaseStatsPtr);
                 }
+                MANAGER_REDO_COMMIT(managerPtr);
 
                 break;
             }
@@ -407,31 +992,42 @@ tsx_begin_delete:
                 long n;
                 for (n = 0; n < numUpdate; n++) {
                     types[n] = random_generate(randomPtr) % NUM_RESERVATION_TYPE;
-                    ids[n] = (random_generate(randomPtr) % queryRange) + 1;
+                    ids[n] = selectId(idSamplerPtr, randomPtr, queryRange);
                     ops[n] = random_generate(randomPtr) % 2;
                     if (ops[n]) {
                         prices[n] = ((random_generate(randomPtr) % 5) * 10) + 50;
                     }
                 }
+#ifdef CLIENT_COMBINE_UPDATES
+                numUpdate = combineUpdates(types, ids, ops, nums, prices, numUpdate,
+                                           scratch);
+#endif
+                MANAGER_REDO_ENTER(managerPtr);
                 HTM_TX_INIT;
 tsx_begin_update:
                 if (HTM_BEGIN(tsx_status, global_tsx_status)) {
                     HTM_LOCK_READ();
+                    MANAGER_REDO_BEGIN(managerPtr);
                     for (n = 0; n < numUpdate; n++) {
                         long t = types[n];
                         long id = ids[n];
                         long doAdd = ops[n];
+#ifdef CLIENT_COMBINE_UPDATES
+                        long num = nums[n];
+#else
+                        long num = 100;
+#endif
                         if (doAdd) {
                             long newPrice = prices[n];
                             switch (t) {
                                 case RESERVATION_CAR:
-                                    HTMMANAGER_ADD_CAR(managerPtr, id, 100, newPrice);
+                                    HTMMANAGER_ADD_CAR(managerPtr, id, num, newPrice);
                                     break;
                                 case RESERVATION_FLIGHT:
-                                    HTMMANAGER_ADD_FLIGHT(managerPtr, id, 100, newPrice);
+                                    HTMMANAGER_ADD_FLIGHT(managerPtr, id, num, newPrice);
                                     break;
                                 case RESERVATION_ROOM:
-                                    HTMMANAGER_ADD_ROOM(managerPtr, id, 100, newPrice);
+                                    HTMMANAGER_ADD_ROOM(managerPtr, id, num, newPrice);
                                     break;
                                 default:
                                     assert(0);
@@ -439,42 +1035,52 @@ tsx_begin_update:
                         } else { /* do delete */
                             switch (t) {
                                 case RESERVATION_CAR:
-                                    HTMMANAGER_DELETE_CAR(managerPtr, id, 100);
+                                    HTMMANAGER_DELETE_CAR(managerPtr, id, num);
                                     break;
                                 case RESERVATION_FLIGHT:
                                     HTMMANAGER_DELETE_FLIGHT(managerPtr, id);
                                     break;
                                 case RESERVATION_ROOM:
-                                    HTMMANAGER_DELETE_ROOM(managerPtr, id, 100);
+                                    HTMMANAGER_DELETE_ROOM(managerPtr, id, num);
                                     break;
                                 default:
                                     assert(0);
                             }
                         }
                     }
+                    HTMMANAGER_REDO_END(managerPtr);
                     HTM_END(global_tsx_status);
                 } else {
+                    PHASE_HTM_ABORT(phaseStatsPtr);
                     HTM_RETRY(tsx_status, tsx_begin_update);
 
                     TM_BEGIN();
 #if !defined(ORIGINAL) && defined(MERGE_CLIENT)
                     TM_LOG_BEGIN(CLT_UPDATE, merge);
 #endif /* !ORIGINAL && MERGE_CLIENT */
+                    MANAGER_REDO_BEGIN(managerPtr);
+                    RESERVATION_ESCROW_BEGIN();
+                    PHASE_TM_ATTEMPT(phaseStatsPtr);
                     for (n = 0; n < numUpdate; n++) {
                         long t = types[n];
                         long id = ids[n];
                         long doAdd = ops[n];
+#ifdef CLIENT_COMBINE_UPDATES
+                        long num = nums[n];
+#else
+                        long num = 100;
+#endif
                         if (doAdd) {
                             long newPrice = prices[n];
                             switch (t) {
                                 case RESERVATION_CAR:
-                                    MANAGER_ADD_CAR(managerPtr, id, 100, newPrice);
+                                    MANAGER_ADD_CAR(managerPtr, id, num, newPrice);
                                     break;
                                 case RESERVATION_FLIGHT:
-                                    MANAGER_ADD_FLIGHT(managerPtr, id, 100, newPrice);
+                                    MANAGER_ADD_FLIGHT(managerPtr, id, num, newPrice);
                                     break;
                                 case RESERVATION_ROOM:
-                                    MANAGER_ADD_ROOM(managerPtr, id, 100, newPrice);
+                                    MANAGER_ADD_ROOM(managerPtr, id, num, newPrice);
                                     break;
                                 default:
                                     assert(0);
@@ -482,13 +1088,13 @@ tsx_begin_update:
                         } else { /* do delete */
                             switch (t) {
                                 case RESERVATION_CAR:
-                                    MANAGER_DELETE_CAR(managerPtr, id, 100);
+                                    MANAGER_DELETE_CAR(managerPtr, id, num);
                                     break;
                                 case RESERVATION_FLIGHT:
                                     MANAGER_DELETE_FLIGHT(managerPtr, id);
                                     break;
                                 case RESERVATION_ROOM:
-                                    MANAGER_DELETE_ROOM(managerPtr, id, 100);
+                                    MANAGER_DELETE_ROOM(managerPtr, id, num);
                                     break;
                                 default:
                                     assert(0);
@@ -497,8 +1103,12 @@ tsx_begin_update:
                     }
                     /* Since the merge function remains in scope, do not explicitly end the operation; it will be done implicitly when the transaction ends */
                     // TM_LOG_END(CLT_UPDATE, NULL);
+                    MANAGER_REDO_END(managerPtr);
                     TM_END();
+                    RESERVATION_ESCROW_COMMIT();
+                    PHASE_TM_COMMIT(phaseStatsPtr);
                 }
+                MANAGER_REDO_COMMIT(managerPtr);
 
                 break;
             }
@@ -508,17 +1118,236 @@ tsx_begin_update:
 
         } /* switch (action) */
 
+#if defined(MAP_USE_RBTREE) && defined(RBTREE_RELAXED)
+        /* Apply the tree fixes deferred by the transaction above */
+        if (rbtree_numPending() > 0) {
+            HTM_TX_INIT;
+tsx_begin_rebalance:
+            if (HTM_BEGIN(tsx_status, global_tsx_status)) {
+                HTM_LOCK_READ();
+                HTMRBTREE_REBALANCE();
+                HTM_END(global_tsx_status);
+            } else {
+                HTM_RETRY(tsx_status, tsx_begin_rebalance);
+
+                TM_BEGIN();
+                TMRBTREE_REBALANCE();
+                TM_END();
+            }
+            rbtree_clearPending();
+        }
+#endif /* MAP_USE_RBTREE && RBTREE_RELAXED */
+
+#ifdef CLIENT_OPEN_LOOP
+        histogram_record(clientPtr->latencies[action], (nowNs() - arrival));
+#endif
+
+#ifdef CLIENT_PHASES
+        phaseStatsPtr->numRequest[action]++;
+#endif
+
     } /* for i */
 
+    RESERVATION_ESCROW_EXIT();
     TM_THREAD_EXIT();
 
     P_FREE(types);
     P_FREE(ids);
     P_FREE(ops);
     P_FREE(prices);
+#ifdef CLIENT_COMBINE_UPDATES
+    P_FREE(nums);
+    P_FREE(scratch);
+#endif
+}
+
+
+/* =============================================================================
+ * TEST_CLIENT
+ * -- Checks combineUpdates against applying the batch in generation order,
+ *    with deletes that fail for lack of free units or a flight in use
+ * =============================================================================
+ */
+#ifdef TEST_CLIENT
+
+
+#include <stdio.h>
+#include <string.h>
+
+
+#define NUM_TEST_ID       (4)
+#define NUM_TEST_CUSTOMER (2)
+#define NUM_TEST_UPDATE   (12)
+#define NUM_TEST_BATCH    (100000)
+
+
+static void
+applyUpdates (manager_t* managerPtr, long* types, long* ids, long* ops,
+              long* nums, long* prices, long numUpdate)
+{
+    long n;
+
+    for (n = 0; n < numUpdate; n++) {
+        long num = ((nums != NULL) ? nums[n] : 100);
+        if (ops[n]) {
+            switch (types[n]) {
+                case RESERVATION_CAR:
+                    MANAGER_ADD_CAR(managerPtr, ids[n], num, prices[n]);
+                    break;
+                case RESERVATION_FLIGHT:
+                    MANAGER_ADD_FLIGHT(managerPtr, ids[n], num, prices[n]);
+                    break;
+                case RESERVATION_ROOM:
+                    MANAGER_ADD_ROOM(managerPtr, ids[n], num, prices[n]);
+                    break;
+                default:
+                    assert(0);
+            }
+        } else {
+            switch (types[n]) {
+                case RESERVATION_CAR:
+                    MANAGER_DELETE_CAR(managerPtr, ids[n], num);
+                    break;
+                case RESERVATION_FLIGHT:
+                    MANAGER_DELETE_FLIGHT(managerPtr, ids[n]);
+                    break;
+                case RESERVATION_ROOM:
+                    MANAGER_DELETE_ROOM(managerPtr, ids[n], num);
+                    break;
+                default:
+                    assert(0);
+            }
+        }
+    }
+}
+
+
+/* Each entry is a number of units (0 for none) or a customer reservation */
+static void
+setUp (manager_t* managerPtr, long (*units)[NUM_TEST_ID + 1],
+       long (*used)[NUM_TEST_ID + 1])
+{
+    long c;
+    long id;
+
+    for (c = 1; c <= NUM_TEST_CUSTOMER; c++) {
+        MANAGER_ADD_CUSTOMER(managerPtr, c);
+    }
+    for (id = 1; id <= NUM_TEST_ID; id++) {
+        if (units[RESERVATION_CAR][id] > 0) {
+            MANAGER_ADD_CAR(managerPtr, id, units[RESERVATION_CAR][id], 50);
+        }
+        if (units[RESERVATION_FLIGHT][id] > 0) {
+            MANAGER_ADD_FLIGHT(managerPtr, id, units[RESERVATION_FLIGHT][id], 50);
+        }
+        if (units[RESERVATION_ROOM][id] > 0) {
+            MANAGER_ADD_ROOM(managerPtr, id, units[RESERVATION_ROOM][id], 50);
+        }
+        for (c = 1; c <= used[RESERVATION_CAR][id]; c++) {
+            MANAGER_RESERVE_CAR(managerPtr, c, id);
+        }
+        for (c = 1; c <= used[RESERVATION_FLIGHT][id]; c++) {
+            MANAGER_RESERVE_FLIGHT(managerPtr, c, id);
+        }
+        for (c = 1; c <= used[RESERVATION_ROOM][id]; c++) {
+            MANAGER_RESERVE_ROOM(managerPtr, c, id);
+        }
+    }
+}
+
+
+static bool_t
+isSameTables (manager_t* aPtr, manager_t* bPtr)
+{
+    long id;
+
+    for (id = 1; id <= NUM_TEST_ID; id++) {
+        if (MANAGER_QUERY_CAR(aPtr, id) != MANAGER_QUERY_CAR(bPtr, id) ||
+            MANAGER_QUERY_CAR_PRICE(aPtr, id) != MANAGER_QUERY_CAR_PRICE(bPtr, id) ||
+            MANAGER_QUERY_FLIGHT(aPtr, id) != MANAGER_QUERY_FLIGHT(bPtr, id) ||
+            MANAGER_QUERY_FLIGHT_PRICE(aPtr, id) != MANAGER_QUERY_FLIGHT_PRICE(bPtr, id) ||
+            MANAGER_QUERY_ROOM(aPtr, id) != MANAGER_QUERY_ROOM(bPtr, id) ||
+            MANAGER_QUERY_ROOM_PRICE(aPtr, id) != MANAGER_QUERY_ROOM_PRICE(bPtr, id))
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+
+int
+main ()
+{
+    random_t* randomPtr = random_alloc();
+    long types[NUM_TEST_UPDATE];
+    long ids[NUM_TEST_UPDATE];
+    long ops[NUM_TEST_UPDATE];
+    long nums[NUM_TEST_UPDATE];
+    long prices[NUM_TEST_UPDATE];
+    long scratch[2 * NUM_TEST_UPDATE];
+    long numFailable = 0;
+    long b;
+
+    assert(randomPtr != NULL);
+    puts("Starting...");
+
+    for (b = 0; b < NUM_TEST_BATCH; b++) {
+        long units[NUM_RESERVATION_TYPE][NUM_TEST_ID + 1];
+        long used[NUM_RESERVATION_TYPE][NUM_TEST_ID + 1];
+        long t;
+        long id;
+        long n;
+
+        /* Totals below 100 make a delete fail; a reservation pins a flight */
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            for (id = 0; id <= NUM_TEST_ID; id++) {
+                units[t][id] = (random_generate(randomPtr) % 3) * 50 *
+                               (long)(random_generate(randomPtr) % 4);
+                used[t][id] = ((units[t][id] > 0) ?
+                               (long)(random_generate(randomPtr) % (NUM_TEST_CUSTOMER + 1)) :
+                               0);
+                numFailable += ((units[t][id] - used[t][id]) < 100 ||
+                                (t == RESERVATION_FLIGHT && used[t][id] > 0));
+            }
+        }
+
+        long numUpdate = random_generate(randomPtr) % NUM_TEST_UPDATE + 1;
+        for (n = 0; n < numUpdate; n++) {
+            types[n] = random_generate(randomPtr) % NUM_RESERVATION_TYPE;
+            ids[n] = random_generate(randomPtr) % NUM_TEST_ID + 1;
+            ops[n] = random_generate(randomPtr) % 2;
+            prices[n] = ((random_generate(randomPtr) % 5) * 10) + 50;
+        }
+
+        manager_t* inOrderPtr = manager_alloc();
+        manager_t* combinedPtr = manager_alloc();
+        setUp(inOrderPtr, units, used);
+        setUp(combinedPtr, units, used);
+
+        applyUpdates(inOrderPtr, types, ids, ops, NULL, prices, numUpdate);
+        numUpdate = combineUpdates(types, ids, ops, nums, prices, numUpdate,
+                                   scratch);
+        applyUpdates(combinedPtr, types, ids, ops, nums, prices, numUpdate);
+        assert(isSameTables(inOrderPtr, combinedPtr));
+
+        manager_free(inOrderPtr);
+        manager_free(combinedPtr);
+    }
+    assert(numFailable > 0);
+
+    random_free(randomPtr);
+
+    puts("All tests passed.");
+
+    return 0;
 }
 
 
+#endif /* TEST_CLIENT */
+
+
 /* =============================================================================
  *
  * End of client.c
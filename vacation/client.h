@@ -74,10 +74,62 @@
 
 
 #include "action.h"
+#ifdef CLIENT_OPEN_LOOP
+#  include "histogram.h"
+#endif
 #include "manager.h"
 #include "random.h"
+#include "sampler.h"
 #include "tm.h"
 
+
+#ifdef CLIENT_PHASES
+/*
+ * With -DCLIENT_PHASES a client can run a script of phases instead of a
+ * fixed mix. A script is a comma-separated list of phases, each a length
+ * followed by optional settings:
+ *
+ *   10s:u=98,10s:u=60,2000t:u=0:d=100
+ *
+ * The length is a time ("10s", "500ms"), which every client spends in the
+ * phase, or a number of transactions ("2000t"), which the clients split
+ * among themselves. The settings are u= the percentage of reservations,
+ * d= the percentage of customer deletions, with the rest table updates, and
+ * n= the number of queries per transaction. A setting left out takes the
+ * value given on the command line; without d= the non-reservation share is
+ * split evenly between deletions and updates, as without a script.
+ */
+typedef struct client_phase {
+    long numTransaction;                /* per client, 0 -> timed */
+    unsigned long durationNs;
+    long percentUser;
+    long percentDelete;                 /* -1 -> half of the rest */
+    long numQueryPerTransaction;
+} client_phase_t;
+
+/*
+ * Per client and phase. Requests that snapshots answer without running a
+ * transaction (MANAGER_SNAPSHOT) are counted in numRequest and numServed. A
+ * transaction attempt that does not commit counts as an abort, whether it
+ * ran in hardware or software; the sequential build never aborts.
+ */
+typedef struct client_phase_stats {
+    unsigned long startNs;
+    unsigned long stopNs;
+    long numRequest[NUM_ACTION];
+    long numServed[NUM_ACTION];
+    long numAbort;
+} client_phase_stats_t;
+#endif /* CLIENT_PHASES */
+
+
+/*
+ * With -DCLIENT_OPEN_LOOP each client records the latency of every action,
+ * in nanoseconds, into latencies[action]. If an arrival rate is set, the
+ * client issues requests at Poisson arrival times instead of back to back,
+ * and latency is measured from the arrival time, so time spent queued behind
+ * a slow request counts against the request that waited.
+ */
 typedef struct client {
     long id;
     manager_t* managerPtr;
@@ -86,6 +138,17 @@ typedef struct client {
     long numQueryPerTransaction;
     long queryRange;
     long percentUser;
+    const sampler_t* idSamplerPtr;      /* NULL -> ids uniform in queryRange */
+#ifdef CLIENT_OPEN_LOOP
+    double arrivalRate;                 /* requests/second, 0 -> closed loop */
+    random_t* arrivalRandomPtr;
+    histogram_t* latencies[NUM_ACTION];
+#endif
+#ifdef CLIENT_PHASES
+    const client_phase_t* phases;       /* shared, not owned */
+    long numPhase;                      /* 0 -> no script */
+    client_phase_stats_t* phaseStats;
+#endif
 } client_t;
 
 
@@ -111,6 +174,56 @@ void
 client_free (client_t* clientPtr);
 
 
+/* =============================================================================
+ * client_setIdSampler
+ * -- Customer and reservation ids become 1 + sampler_generate(samplerPtr);
+ *    the sampler is shared, not owned, and must cover queryRange values
+ * =============================================================================
+ */
+void
+client_setIdSampler (client_t* clientPtr, const sampler_t* samplerPtr);
+
+
+#ifdef CLIENT_OPEN_LOOP
+/* =============================================================================
+ * client_setArrivalRate
+ * -- 'rate' is in requests/second; 0 restores the closed loop
+ * =============================================================================
+ */
+void
+client_setArrivalRate (client_t* clientPtr, double rate);
+#endif /* CLIENT_OPEN_LOOP */
+
+
+#ifdef CLIENT_PHASES
+/* =============================================================================
+ * client_parsePhases
+ * -- 'percentUser' and 'numQueryPerTransaction' are the defaults for phases
+ *    that leave them out; transaction counts are split over 'numClient'
+ * -- Returns NULL on a malformed script or failure
+ * =============================================================================
+ */
+client_phase_t*
+client_parsePhases (const char* script,
+                    long numClient,
+                    long percentUser,
+                    long numQueryPerTransaction,
+                    long* numPhasePtr);
+
+
+/* =============================================================================
+ * client_setPhases
+ * -- The phases are shared, not owned; the run ends with the last phase
+ * -- Returns FALSE on failure
+ * =============================================================================
+ */
+bool_t
+client_setPhases (client_t* clientPtr,
+                  const client_phase_t* phases,
+                  long numPhase);
+#endif /* CLIENT_PHASES */
+
+
 /* =============================================================================
  * client_run
  * -- Execute list operations on the database
@@ -80,6 +80,574 @@
 #include "types.h"
 
 
+/* =============================================================================
+ * customer_compare
+ * -- Returns -1 if A < B, 0 if A = B, 1 if A > B
+ * =============================================================================
+ */
+long
+customer_compare (customer_t* aPtr, customer_t* bPtr)
+{
+    return (aPtr->id - bPtr->id);
+}
+
+
+#ifdef CUSTOMER_INLINE_INFO
+
+
+/* =============================================================================
+ * infoAt
+ * -- 'overflowPtr' is the customer's current overflow array
+ * =============================================================================
+ */
+static inline customer_info_t*
+infoAt (customer_t* customerPtr, customer_info_t* overflowPtr, long index)
+{
+    return ((index < CUSTOMER_NUM_INLINE_INFO) ?
+            &customerPtr->infos[index] :
+            &overflowPtr[index - CUSTOMER_NUM_INLINE_INFO]);
+}
+
+
+/* =============================================================================
+ * HTMinfoKey, HTMinfoPrice, HTMsetInfo, HTMsetOverflow
+ * -- HTM accesses go through these so their operands stay referenced in
+ *    builds where the HTM_SHARED_* macros expand to nothing
+ * =============================================================================
+ */
+static inline long
+HTMinfoKey (customer_info_t* infoPtr)
+{
+    return (long)HTM_SHARED_READ(infoPtr->key);
+}
+
+static inline long
+HTMinfoPrice (customer_info_t* infoPtr)
+{
+    return (long)HTM_SHARED_READ(infoPtr->price);
+}
+
+static inline void
+HTMsetInfo (customer_info_t* infoPtr, long key, long price)
+{
+    HTM_SHARED_WRITE(infoPtr->key, key);
+    HTM_SHARED_WRITE(infoPtr->price, price);
+}
+
+static inline void
+HTMsetOverflow (customer_t* customerPtr,
+                customer_info_t* overflowPtr,
+                long capacity)
+{
+    HTM_SHARED_WRITE_P(customerPtr->overflowPtr, overflowPtr);
+    HTM_SHARED_WRITE(customerPtr->overflowCapacity, capacity);
+}
+
+
+/* =============================================================================
+ * customer_alloc
+ * =============================================================================
+ */
+TM_CALLABLE
+customer_t*
+customer_alloc (TM_ARGDECL  long id)
+{
+    customer_t* customerPtr;
+
+    customerPtr = (customer_t*)TM_MALLOC(sizeof(customer_t));
+    assert(customerPtr != NULL);
+
+    customerPtr->id = id;
+    customerPtr->numInfo = 0;
+    customerPtr->overflowCapacity = 0;
+    customerPtr->overflowPtr = NULL;
+
+    return customerPtr;
+}
+
+
+customer_t*
+HTMcustomer_alloc (long id)
+{
+    customer_t* customerPtr;
+
+    customerPtr = (customer_t*)HTM_MALLOC(sizeof(customer_t));
+    assert(customerPtr != NULL);
+
+    customerPtr->id = id;
+    customerPtr->numInfo = 0;
+    customerPtr->overflowCapacity = 0;
+    customerPtr->overflowPtr = NULL;
+
+    return customerPtr;
+}
+
+
+customer_t*
+customer_alloc_seq (long id)
+{
+    customer_t* customerPtr;
+
+    customerPtr = (customer_t*)malloc(sizeof(customer_t));
+    assert(customerPtr != NULL);
+
+    customerPtr->id = id;
+    customerPtr->numInfo = 0;
+    customerPtr->overflowCapacity = 0;
+    customerPtr->overflowPtr = NULL;
+
+    return customerPtr;
+}
+
+
+/* =============================================================================
+ * customer_free
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+customer_free (TM_ARGDECL  customer_t* customerPtr)
+{
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    if (overflowPtr != NULL) {
+        TM_FREE(overflowPtr);
+    }
+    TM_FREE(customerPtr);
+}
+
+void
+HTMcustomer_free (customer_t* customerPtr)
+{
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    if (overflowPtr != NULL) {
+        HTM_FREE(overflowPtr);
+    }
+    HTM_FREE(customerPtr);
+}
+
+void
+customer_free_seq (customer_t* customerPtr)
+{
+    free(customerPtr->overflowPtr);
+    free(customerPtr);
+}
+
+
+/* =============================================================================
+ * customer_addReservationInfo
+ * -- Returns TRUE if success, else FALSE
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+customer_addReservationInfo (TM_ARGDECL
+                             customer_t* customerPtr,
+                             reservation_type_t type, long id, long price)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = (long)TM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, i);
+        if ((long)TM_SHARED_READ(infoPtr->key) == key) {
+            return FALSE;
+        }
+    }
+
+    /* Full: move the overflow entries to an array twice the size */
+    long capacity = (long)TM_SHARED_READ(customerPtr->overflowCapacity);
+    if (numInfo == CUSTOMER_NUM_INLINE_INFO + capacity) {
+        long newCapacity =
+            ((capacity > 0) ? (2 * capacity) : CUSTOMER_NUM_INLINE_INFO);
+        customer_info_t* newOverflowPtr =
+            (customer_info_t*)TM_MALLOC(newCapacity * sizeof(customer_info_t));
+        assert(newOverflowPtr != NULL);
+        for (i = 0; i < capacity; i++) {
+            newOverflowPtr[i].key = (long)TM_SHARED_READ(overflowPtr[i].key);
+            newOverflowPtr[i].price = (long)TM_SHARED_READ(overflowPtr[i].price);
+        }
+        if (overflowPtr != NULL) {
+            TM_FREE(overflowPtr);
+        }
+        TM_SHARED_WRITE_P(customerPtr->overflowPtr, newOverflowPtr);
+        TM_SHARED_WRITE(customerPtr->overflowCapacity, newCapacity);
+        overflowPtr = newOverflowPtr;
+    }
+
+    customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, numInfo);
+    TM_SHARED_WRITE(infoPtr->key, key);
+    TM_SHARED_WRITE(infoPtr->price, price);
+    TM_SHARED_WRITE(customerPtr->numInfo, (numInfo + 1));
+
+    return TRUE;
+}
+
+bool_t
+HTMcustomer_addReservationInfo (customer_t* customerPtr,
+                             reservation_type_t type, long id, long price)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = (long)HTM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        if (HTMinfoKey(infoAt(customerPtr, overflowPtr, i)) == key) {
+            return FALSE;
+        }
+    }
+
+    /* Full: move the overflow entries to an array twice the size */
+    long capacity = (long)HTM_SHARED_READ(customerPtr->overflowCapacity);
+    if (numInfo == CUSTOMER_NUM_INLINE_INFO + capacity) {
+        long newCapacity =
+            ((capacity > 0) ? (2 * capacity) : CUSTOMER_NUM_INLINE_INFO);
+        customer_info_t* newOverflowPtr =
+            (customer_info_t*)HTM_MALLOC(newCapacity * sizeof(customer_info_t));
+        assert(newOverflowPtr != NULL);
+        for (i = 0; i < capacity; i++) {
+            newOverflowPtr[i].key = (long)HTM_SHARED_READ(overflowPtr[i].key);
+            newOverflowPtr[i].price = (long)HTM_SHARED_READ(overflowPtr[i].price);
+        }
+        if (overflowPtr != NULL) {
+            HTM_FREE(overflowPtr);
+        }
+        HTMsetOverflow(customerPtr, newOverflowPtr, newCapacity);
+        overflowPtr = newOverflowPtr;
+    }
+
+    HTMsetInfo(infoAt(customerPtr, overflowPtr, numInfo), key, price);
+    HTM_SHARED_WRITE(customerPtr->numInfo, (numInfo + 1));
+
+    return TRUE;
+}
+
+bool_t
+customer_addReservationInfo_seq (
+                             customer_t* customerPtr,
+                             reservation_type_t type, long id, long price)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = customerPtr->numInfo;
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        if (infoAt(customerPtr, customerPtr->overflowPtr, i)->key == key) {
+            return FALSE;
+        }
+    }
+
+    /* Full: grow the overflow array to twice the size */
+    long capacity = customerPtr->overflowCapacity;
+    if (numInfo == CUSTOMER_NUM_INLINE_INFO + capacity) {
+        long newCapacity =
+            ((capacity > 0) ? (2 * capacity) : CUSTOMER_NUM_INLINE_INFO);
+        customer_info_t* newOverflowPtr =
+            (customer_info_t*)realloc(customerPtr->overflowPtr,
+                                      newCapacity * sizeof(customer_info_t));
+        assert(newOverflowPtr != NULL);
+        customerPtr->overflowPtr = newOverflowPtr;
+        customerPtr->overflowCapacity = newCapacity;
+    }
+
+    customer_info_t* infoPtr =
+        infoAt(customerPtr, customerPtr->overflowPtr, numInfo);
+    infoPtr->key = key;
+    infoPtr->price = price;
+    customerPtr->numInfo = numInfo + 1;
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * customer_removeReservationInfo
+ * -- Returns TRUE if success, else FALSE
+ * =============================================================================
+ */
+TM_CANCELLABLE
+bool_t
+customer_removeReservationInfo (TM_ARGDECL
+                                customer_t* customerPtr,
+                                reservation_type_t type, long id)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = (long)TM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, i);
+        if ((long)TM_SHARED_READ(infoPtr->key) == key) {
+            /* Fill the hole with the last entry */
+            if (i != (numInfo - 1)) {
+                customer_info_t* lastPtr =
+                    infoAt(customerPtr, overflowPtr, (numInfo - 1));
+                TM_SHARED_WRITE(infoPtr->key, (long)TM_SHARED_READ(lastPtr->key));
+                TM_SHARED_WRITE(infoPtr->price,
+                                (long)TM_SHARED_READ(lastPtr->price));
+            }
+            TM_SHARED_WRITE(customerPtr->numInfo, (numInfo - 1));
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+bool_t
+HTMcustomer_removeReservationInfo (customer_t* customerPtr,
+                                   reservation_type_t type, long id)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = (long)HTM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, i);
+        if (HTMinfoKey(infoPtr) == key) {
+            /* Fill the hole with the last entry */
+            if (i != (numInfo - 1)) {
+                customer_info_t* lastPtr =
+                    infoAt(customerPtr, overflowPtr, (numInfo - 1));
+                HTMsetInfo(infoPtr, HTMinfoKey(lastPtr), HTMinfoPrice(lastPtr));
+            }
+            HTM_SHARED_WRITE(customerPtr->numInfo, (numInfo - 1));
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+bool_t
+customer_removeReservationInfo_seq (customer_t* customerPtr,
+                                    reservation_type_t type, long id)
+{
+    long key = CUSTOMER_INFO_KEY(type, id);
+    long numInfo = customerPtr->numInfo;
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        customer_info_t* infoPtr =
+            infoAt(customerPtr, customerPtr->overflowPtr, i);
+        if (infoPtr->key == key) {
+            /* Fill the hole with the last entry */
+            *infoPtr = *infoAt(customerPtr, customerPtr->overflowPtr,
+                               (numInfo - 1));
+            customerPtr->numInfo = numInfo - 1;
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * customer_getBill
+ * -- Returns total cost of reservations
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+customer_getBill (TM_ARGDECL  customer_t* customerPtr)
+{
+    long bill = 0;
+    long numInfo = (long)TM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        bill += (long)TM_SHARED_READ(infoAt(customerPtr, overflowPtr, i)->price);
+    }
+
+    return bill;
+}
+
+
+long
+HTMcustomer_getBill (customer_t* customerPtr)
+{
+    long bill = 0;
+    long numInfo = (long)HTM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo; i++) {
+        bill += HTMinfoPrice(infoAt(customerPtr, overflowPtr, i));
+    }
+
+    return bill;
+}
+
+
+long
+customer_getBill_seq (customer_t* customerPtr)
+{
+    long bill = 0;
+    long i;
+
+    for (i = 0; i < customerPtr->numInfo; i++) {
+        bill += infoAt(customerPtr, customerPtr->overflowPtr, i)->price;
+    }
+
+    return bill;
+}
+
+
+/* =============================================================================
+ * customer_getReservationInfo
+ * -- Reads the type and id of the index'th reservation info
+ * -- Returns FALSE if the customer has no more than 'index' reservation infos
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+customer_getReservationInfo (TM_ARGDECL
+                             customer_t* customerPtr, long index,
+                             reservation_type_t* typePtr, long* idPtr)
+{
+    if (index >= (long)TM_SHARED_READ(customerPtr->numInfo)) {
+        return FALSE;
+    }
+
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    long key = (long)TM_SHARED_READ(infoAt(customerPtr, overflowPtr, index)->key);
+    *typePtr = CUSTOMER_INFO_TYPE(key);
+    *idPtr = CUSTOMER_INFO_ID(key);
+
+    return TRUE;
+}
+
+
+bool_t
+HTMcustomer_getReservationInfo (customer_t* customerPtr, long index,
+                                reservation_type_t* typePtr, long* idPtr)
+{
+    if (index >= (long)HTM_SHARED_READ(customerPtr->numInfo)) {
+        return FALSE;
+    }
+
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    long key = HTMinfoKey(infoAt(customerPtr, overflowPtr, index));
+    *typePtr = CUSTOMER_INFO_TYPE(key);
+    *idPtr = CUSTOMER_INFO_ID(key);
+
+    return TRUE;
+}
+
+
+bool_t
+customer_getReservationInfo_seq (customer_t* customerPtr, long index,
+                                 reservation_type_t* typePtr, long* idPtr)
+{
+    if (index >= customerPtr->numInfo) {
+        return FALSE;
+    }
+
+    long key = infoAt(customerPtr, customerPtr->overflowPtr, index)->key;
+    *typePtr = CUSTOMER_INFO_TYPE(key);
+    *idPtr = CUSTOMER_INFO_ID(key);
+
+    return TRUE;
+}
+
+/* =============================================================================
+ * customer_copyReservationInfos
+ * -- Copies up to 'maxInfo' reservation infos as (type, id, price) triples
+ * -- Returns the number of reservation infos the customer holds
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+customer_copyReservationInfos (TM_ARGDECL
+                               customer_t* customerPtr, long* infos, long maxInfo)
+{
+    long numInfo = (long)TM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)TM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo && i < maxInfo; i++) {
+        customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, i);
+        long key = (long)TM_SHARED_READ(infoPtr->key);
+        infos[3 * i + 0] = (long)CUSTOMER_INFO_TYPE(key);
+        infos[3 * i + 1] = CUSTOMER_INFO_ID(key);
+        infos[3 * i + 2] = (long)TM_SHARED_READ(infoPtr->price);
+    }
+
+    return numInfo;
+}
+
+
+long
+HTMcustomer_copyReservationInfos (customer_t* customerPtr,
+                                  long* infos, long maxInfo)
+{
+    long numInfo = (long)HTM_SHARED_READ(customerPtr->numInfo);
+    customer_info_t* overflowPtr =
+        (customer_info_t*)HTM_SHARED_READ_P(customerPtr->overflowPtr);
+    long i;
+
+    for (i = 0; i < numInfo && i < maxInfo; i++) {
+        customer_info_t* infoPtr = infoAt(customerPtr, overflowPtr, i);
+        long key = HTMinfoKey(infoPtr);
+        infos[3 * i + 0] = (long)CUSTOMER_INFO_TYPE(key);
+        infos[3 * i + 1] = CUSTOMER_INFO_ID(key);
+        infos[3 * i + 2] = HTMinfoPrice(infoPtr);
+    }
+
+    return numInfo;
+}
+
+
+long
+customer_copyReservationInfos_seq (customer_t* customerPtr,
+                                   long* infos, long maxInfo)
+{
+    long i;
+
+    for (i = 0; i < customerPtr->numInfo && i < maxInfo; i++) {
+        customer_info_t* infoPtr =
+            infoAt(customerPtr, customerPtr->overflowPtr, i);
+        infos[3 * i + 0] = (long)CUSTOMER_INFO_TYPE(infoPtr->key);
+        infos[3 * i + 1] = CUSTOMER_INFO_ID(infoPtr->key);
+        infos[3 * i + 2] = infoPtr->price;
+    }
+
+    return customerPtr->numInfo;
+}
+
+
+
+/* =============================================================================
+ * customer_setCompare
+ * -- Nothing to restore; infos hold no function pointers
+ * =============================================================================
+ */
+void
+customer_setCompare (long id, customer_t *customerPtr)
+{
+}
+
+
+#else /* !CUSTOMER_INLINE_INFO */
+
+
 /* =============================================================================
  * customer_alloc
  * =============================================================================
@@ -136,18 +704,6 @@ customer_alloc_seq (long id)
 }
 
 
-/* =============================================================================
- * customer_compare
- * -- Returns -1 if A < B, 0 if A = B, 1 if A > B
- * =============================================================================
- */
-long
-customer_compare (customer_t* aPtr, customer_t* bPtr)
-{
-    return (aPtr->id - bPtr->id);
-}
-
-
 /* =============================================================================
  * customer_free
  * =============================================================================
@@ -271,6 +827,66 @@ customer_removeReservationInfo (TM_ARGDECL
     return TRUE;
 }
 
+bool_t
+HTMcustomer_removeReservationInfo (customer_t* customerPtr,
+                                   reservation_type_t type, long id)
+{
+    reservation_info_t findReservationInfo;
+
+    findReservationInfo.type = type;
+    findReservationInfo.id = id;
+    /* price not used to compare reservation infos */
+
+    list_t* reservationInfoListPtr =
+        (list_t*)HTM_SHARED_READ(customerPtr->reservationInfoListPtr);
+
+    reservation_info_t* reservationInfoPtr =
+        (reservation_info_t*)HTMLIST_FIND(reservationInfoListPtr,
+                                          &findReservationInfo);
+
+    if (reservationInfoPtr == NULL) {
+        return FALSE;
+    }
+
+    bool_t status = HTMLIST_REMOVE(reservationInfoListPtr,
+                                   (void*)&findReservationInfo);
+    if (status == FALSE) {
+        HTM_RESTART();
+    }
+
+    HTMRESERVATION_INFO_FREE(reservationInfoPtr);
+
+    return TRUE;
+}
+
+bool_t
+customer_removeReservationInfo_seq (customer_t* customerPtr,
+                                    reservation_type_t type, long id)
+{
+    reservation_info_t findReservationInfo;
+
+    findReservationInfo.type = type;
+    findReservationInfo.id = id;
+    /* price not used to compare reservation infos */
+
+    list_t* reservationInfoListPtr = customerPtr->reservationInfoListPtr;
+
+    reservation_info_t* reservationInfoPtr =
+        (reservation_info_t*)list_find(reservationInfoListPtr,
+                                       &findReservationInfo);
+
+    if (reservationInfoPtr == NULL) {
+        return FALSE;
+    }
+
+    /* Found above, so the remove cannot fail */
+    LIST_REMOVE(reservationInfoListPtr, (void*)&findReservationInfo);
+
+    RESERVATION_INFO_FREE_SEQ(reservationInfoPtr);
+
+    return TRUE;
+}
+
 
 /* =============================================================================
  * customer_getBill
@@ -333,6 +949,87 @@ customer_getBill_seq (customer_t* customerPtr)
     return bill;
 }
 
+/* =============================================================================
+ * customer_copyReservationInfos
+ * -- Copies up to 'maxInfo' reservation infos as (type, id, price) triples
+ * -- Returns the number of reservation infos the customer holds
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+customer_copyReservationInfos (TM_ARGDECL
+                               customer_t* customerPtr, long* infos, long maxInfo)
+{
+    long numInfo = 0;
+    list_iter_t it;
+    list_t* reservationInfoListPtr =
+        (list_t*)TM_SHARED_READ(customerPtr->reservationInfoListPtr);
+
+    TMLIST_ITER_RESET(&it, reservationInfoListPtr);
+    while (TMLIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
+        reservation_info_t* reservationInfoPtr =
+            (reservation_info_t*)TMLIST_ITER_NEXT(&it, reservationInfoListPtr);
+        if (numInfo < maxInfo) {
+            infos[3 * numInfo + 0] = (long)reservationInfoPtr->type;
+            infos[3 * numInfo + 1] = reservationInfoPtr->id;
+            infos[3 * numInfo + 2] = reservationInfoPtr->price;
+        }
+        numInfo++;
+    }
+
+    return numInfo;
+}
+
+
+long
+HTMcustomer_copyReservationInfos (customer_t* customerPtr,
+                                  long* infos, long maxInfo)
+{
+    long numInfo = 0;
+    list_iter_t it;
+    list_t* reservationInfoListPtr =
+        (list_t*)HTM_SHARED_READ(customerPtr->reservationInfoListPtr);
+
+    HTMLIST_ITER_RESET(&it, reservationInfoListPtr);
+    while (HTMLIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
+        reservation_info_t* reservationInfoPtr =
+            (reservation_info_t*)HTMLIST_ITER_NEXT(&it, reservationInfoListPtr);
+        if (numInfo < maxInfo) {
+            infos[3 * numInfo + 0] = (long)reservationInfoPtr->type;
+            infos[3 * numInfo + 1] = reservationInfoPtr->id;
+            infos[3 * numInfo + 2] = reservationInfoPtr->price;
+        }
+        numInfo++;
+    }
+
+    return numInfo;
+}
+
+
+long
+customer_copyReservationInfos_seq (customer_t* customerPtr,
+                                   long* infos, long maxInfo)
+{
+    long numInfo = 0;
+    list_iter_t it;
+    list_t* reservationInfoListPtr = customerPtr->reservationInfoListPtr;
+
+    LIST_ITER_RESET(&it, reservationInfoListPtr);
+    while (LIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
+        reservation_info_t* reservationInfoPtr =
+            (reservation_info_t*)LIST_ITER_NEXT(&it, reservationInfoListPtr);
+        if (numInfo < maxInfo) {
+            infos[3 * numInfo + 0] = (long)reservationInfoPtr->type;
+            infos[3 * numInfo + 1] = reservationInfoPtr->id;
+            infos[3 * numInfo + 2] = reservationInfoPtr->price;
+        }
+        numInfo++;
+    }
+
+    return numInfo;
+}
+
+
 
 /* =============================================================================
  * customer_setCompare
@@ -345,6 +1042,9 @@ customer_setCompare (long id, customer_t *customerPtr)
 }
 
 
+#endif /* !CUSTOMER_INLINE_INFO */
+
+
 /* =============================================================================
  * TEST_CUSTOMER
  * =============================================================================
@@ -391,6 +1091,44 @@ main ()
     assert(customer_removeReservationInfo(customer1Ptr, 1, 1));
     assert(customer_getBill(customer1Ptr) == 0);
 
+    /* Test sequential remove reservation info */
+    assert(customer_addReservationInfo_seq(customer3Ptr, 0, 1, 2));
+    assert(customer_addReservationInfo_seq(customer3Ptr, 1, 1, 3));
+    assert(!customer_removeReservationInfo_seq(customer3Ptr, 0, 2));
+    assert(customer_removeReservationInfo_seq(customer3Ptr, 0, 1));
+    assert(!customer_removeReservationInfo_seq(customer3Ptr, 0, 1));
+    assert(customer_getBill_seq(customer3Ptr) == 3);
+    assert(customer_removeReservationInfo_seq(customer3Ptr, 1, 1));
+    assert(customer_getBill_seq(customer3Ptr) == 0);
+
+#ifdef CUSTOMER_INLINE_INFO
+    /* Test overflow: grow past the inline entries, then remove out of order */
+    {
+        long i;
+        long bill = 0;
+        for (i = 0; i < 40; i++) {
+            assert(customer_addReservationInfo(customer2Ptr, i % 3, i, i));
+            bill += i;
+        }
+        assert(!customer_addReservationInfo(customer2Ptr, 2, 38, 1));
+        assert(customer_getBill(customer2Ptr) == bill);
+        for (i = 0; i < 40; i += 3) {
+            assert(customer_removeReservationInfo(customer2Ptr, i % 3, i));
+            bill -= i;
+        }
+        assert(customer_getBill(customer2Ptr) == bill);
+        for (i = 0; i < 40; i++) {
+            reservation_type_t type;
+            long id;
+            if (!customer_getReservationInfo(customer2Ptr, i, &type, &id)) {
+                break;
+            }
+            assert((long)type == (id % 3) && (id % 3) != 0);
+        }
+        assert(i == 40 - 14);
+    }
+#endif /* CUSTOMER_INLINE_INFO */
+
     customer_free(customer1Ptr);
     customer_free(customer2Ptr);
     customer_free(customer3Ptr);
@@ -79,11 +79,46 @@
 #include "tm.h"
 #include "types.h"
 
+#ifdef CUSTOMER_INLINE_INFO
+
+/*
+ * Reservation infos live in the customer itself instead of a list of
+ * separately allocated nodes: the first CUSTOMER_NUM_INLINE_INFO inline, the
+ * rest in an overflow array that doubles when full. An entry packs the type
+ * and id into one word next to the price, so a customer with up to six
+ * reservations is 128 bytes and no pointers. Entries are unordered; removing
+ * one moves the last entry into its place.
+ */
+#  ifndef CUSTOMER_NUM_INLINE_INFO
+#    define CUSTOMER_NUM_INLINE_INFO (6)
+#  endif
+
+#  define CUSTOMER_INFO_KEY(type, id)   (((id) << 2) | (long)(type))
+#  define CUSTOMER_INFO_TYPE(key)       ((reservation_type_t)((key) & 3))
+#  define CUSTOMER_INFO_ID(key)         ((key) >> 2)
+
+typedef struct customer_info {
+    long key;   /* CUSTOMER_INFO_KEY(type, id) */
+    long price; /* holds price at time reservation was made */
+} customer_info_t;
+
+typedef struct customer {
+    long id;
+    long numInfo;
+    long overflowCapacity;
+    customer_info_t* overflowPtr;
+    customer_info_t infos[CUSTOMER_NUM_INLINE_INFO];
+} customer_t;
+
+#else /* !CUSTOMER_INLINE_INFO */
+
 typedef struct customer {
     long id;
     list_t* reservationInfoListPtr;
 } customer_t;
 
+#endif /* !CUSTOMER_INLINE_INFO */
+
 
 /* =============================================================================
  * customer_alloc
@@ -163,6 +198,14 @@ customer_removeReservationInfo (TM_ARGDECL
                                 customer_t* customerPtr,
                                 reservation_type_t type, long id);
 
+bool_t
+HTMcustomer_removeReservationInfo (customer_t* customerPtr,
+                                   reservation_type_t type, long id);
+
+bool_t
+customer_removeReservationInfo_seq (customer_t* customerPtr,
+                                    reservation_type_t type, long id);
+
 
 /* =============================================================================
  * customer_getBill
@@ -179,6 +222,49 @@ HTMcustomer_getBill (customer_t* customerPtr);
 long
 customer_getBill_seq (customer_t* customerPtr);
 
+/* =============================================================================
+ * customer_copyReservationInfos
+ * -- Copies up to 'maxInfo' reservation infos as (type, id, price) triples
+ * -- Returns the number of reservation infos the customer holds
+ * =============================================================================
+ */
+TM_CALLABLE
+long
+customer_copyReservationInfos (TM_ARGDECL
+                               customer_t* customerPtr, long* infos, long maxInfo);
+
+long
+HTMcustomer_copyReservationInfos (customer_t* customerPtr,
+                                  long* infos, long maxInfo);
+
+long
+customer_copyReservationInfos_seq (customer_t* customerPtr,
+                                   long* infos, long maxInfo);
+
+
+
+#ifdef CUSTOMER_INLINE_INFO
+/* =============================================================================
+ * customer_getReservationInfo
+ * -- Reads the type and id of the index'th reservation info
+ * -- Returns FALSE if the customer has no more than 'index' reservation infos
+ * =============================================================================
+ */
+TM_CALLABLE
+bool_t
+customer_getReservationInfo (TM_ARGDECL
+                             customer_t* customerPtr, long index,
+                             reservation_type_t* typePtr, long* idPtr);
+
+bool_t
+HTMcustomer_getReservationInfo (customer_t* customerPtr, long index,
+                                reservation_type_t* typePtr, long* idPtr);
+
+bool_t
+customer_getReservationInfo_seq (customer_t* customerPtr, long index,
+                                 reservation_type_t* typePtr, long* idPtr);
+#endif /* CUSTOMER_INLINE_INFO */
+
 
 /* =============================================================================
  * customer_setCompare
@@ -191,8 +277,14 @@ customer_setCompare (long id, customer_t *customerPtr);
     customer_alloc_seq(TM_ARG  id)
 #define CUSTOMER_ADD_RESERVATION_INFO_SEQ(cust, type, id, price)  \
     customer_addReservationInfo_seq(cust, type, id, price)
+#define CUSTOMER_REMOVE_RESERVATION_INFO_SEQ(cust, type, id) \
+    customer_removeReservationInfo_seq(cust, type, id)
 #define CUSTOMER_GET_BILL_SEQ(cust) \
     customer_getBill_seq(cust)
+#define CUSTOMER_GET_RESERVATION_INFO_SEQ(cust, i, type, id) \
+    customer_getReservationInfo_seq(cust, i, type, id)
+#define CUSTOMER_COPY_RESERVATION_INFOS_SEQ(cust, infos, max) \
+    customer_copyReservationInfos_seq(cust, infos, max)
 #define CUSTOMER_FREE_SEQ(cust) \
     customer_free_seq(TM_ARG  cust)
 
@@ -200,8 +292,14 @@ customer_setCompare (long id, customer_t *customerPtr);
     HTMcustomer_alloc(TM_ARG  id)
 #define HTMCUSTOMER_ADD_RESERVATION_INFO(cust, type, id, price)  \
     HTMcustomer_addReservationInfo(cust, type, id, price)
+#define HTMCUSTOMER_REMOVE_RESERVATION_INFO(cust, type, id) \
+    HTMcustomer_removeReservationInfo(cust, type, id)
 #define HTMCUSTOMER_GET_BILL(cust) \
     HTMcustomer_getBill(cust)
+#define HTMCUSTOMER_GET_RESERVATION_INFO(cust, i, type, id) \
+    HTMcustomer_getReservationInfo(cust, i, type, id)
+#define HTMCUSTOMER_COPY_RESERVATION_INFOS(cust, infos, max) \
+    HTMcustomer_copyReservationInfos(cust, infos, max)
 #define HTMCUSTOMER_FREE(cust) \
     HTMcustomer_free(TM_ARG  cust)
 
@@ -213,6 +311,10 @@ customer_setCompare (long id, customer_t *customerPtr);
     customer_removeReservationInfo(TM_ARG  cust, type, id)
 #define CUSTOMER_GET_BILL(cust) \
     customer_getBill(TM_ARG  cust)
+#define CUSTOMER_GET_RESERVATION_INFO(cust, i, type, id) \
+    customer_getReservationInfo(TM_ARG  cust, i, type, id)
+#define CUSTOMER_COPY_RESERVATION_INFOS(cust, infos, max) \
+    customer_copyReservationInfos(TM_ARG  cust, infos, max)
 #define CUSTOMER_FREE(cust) \
     customer_free(TM_ARG  cust)
 
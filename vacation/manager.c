@@ -72,11 +72,13 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include "customer.h"
 #include "map.h"
 #include "pair.h"
 #include "manager.h"
 #include "reservation.h"
+#include "thread.h"
 #include "tm.h"
 #include "types.h"
 
@@ -110,70 +112,1258 @@ bool_t
 addReservation (TM_ARGDECL  MAP_T* tablePtr, long id, long num, long price);
 
 
+#ifdef MANAGER_DURABLE
+typedef struct manager_redo {
+    long writer;
+    long epoch;     /* the transaction read */
+    long numWord;
+    long capacity;
+    long* words;    /* images, see REDO IMAGES */
+} manager_redo_t;
+#endif
+
+
+#ifdef MANAGER_SHARDED
+#  define NUM_SHARD(mgr)        ((mgr)->numShard)
+#  define SHARDS(mgr, table)    ((mgr)->table##Tables)
+#  define SHARD_OF(mgr, id)     MANAGER_SHARD(mgr, id)
+#else
+#  define NUM_SHARD(mgr)        (1)
+#  define SHARDS(mgr, table)    (&(mgr)->table##TablePtr)
+#  define SHARD_OF(mgr, id)     (0)
+#endif
+
+
+/* =============================================================================
+ * tableAlloc
+ * =============================================================================
+ */
+static MAP_T*
+tableAlloc ()
+{
+    return MAP_ALLOC(NULL, NULL);
+}
+
+
+/* =============================================================================
+ * shardsAlloc
+ * =============================================================================
+ */
+static void
+shardsAlloc (MAP_T** tablePtrs, long numShard)
+{
+    long s;
+
+    for (s = 0; s < numShard; s++) {
+        tablePtrs[s] = tableAlloc();
+        assert(tablePtrs[s] != NULL);
+    }
+}
+
+
+/* =============================================================================
+ * manager_alloc
+ * =============================================================================
+ */
+#ifdef MANAGER_SHARDED
+manager_t*
+manager_alloc (long numShard)
+#else
+manager_t*
+manager_alloc ()
+#endif
+{
+    manager_t* managerPtr = (manager_t*)malloc(sizeof(manager_t));
+    assert(managerPtr != NULL);
+
+#ifdef MANAGER_SHARDED
+    assert(numShard > 0);
+    managerPtr->numShard = numShard;
+    managerPtr->carTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    managerPtr->roomTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    managerPtr->flightTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    managerPtr->customerTables = (MAP_T**)malloc(numShard * sizeof(MAP_T*));
+    assert(managerPtr->carTables != NULL);
+    assert(managerPtr->roomTables != NULL);
+    assert(managerPtr->flightTables != NULL);
+    assert(managerPtr->customerTables != NULL);
+#endif
+
+    shardsAlloc(SHARDS(managerPtr, car), NUM_SHARD(managerPtr));
+    shardsAlloc(SHARDS(managerPtr, room), NUM_SHARD(managerPtr));
+    shardsAlloc(SHARDS(managerPtr, flight), NUM_SHARD(managerPtr));
+    shardsAlloc(SHARDS(managerPtr, customer), NUM_SHARD(managerPtr));
+
+#ifdef MANAGER_SNAPSHOT
+    {
+        long t;
+        managerPtr->maxSnapshotId = -1;
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            managerPtr->snapshots[t] = NULL;
+        }
+        managerPtr->billSnapshots = NULL;
+    }
+#endif
+#ifdef MANAGER_DURABLE
+    {
+        long k;
+        managerPtr->logPtr = NULL;
+        managerPtr->maxDurableId = -1;
+        for (k = 0; k <= NUM_RESERVATION_TYPE; k++) {
+            managerPtr->versions[k] = NULL;
+        }
+        managerPtr->numRedo = 0;
+        managerPtr->redos = NULL;
+    }
+#endif
+
+    return managerPtr;
+}
+
+
+/* =============================================================================
+ * manager_getReservationTable
+ * -- Returns the map holding 'id' for a reservation_type_t 'type'
+ * =============================================================================
+ */
+TM_PURE
+MAP_T*
+manager_getReservationTable (manager_t* managerPtr, long type, long id)
+{
+    switch (type) {
+        case RESERVATION_CAR:
+            return MANAGER_TABLE(managerPtr, car, id);
+        case RESERVATION_FLIGHT:
+            return MANAGER_TABLE(managerPtr, flight, id);
+        case RESERVATION_ROOM:
+            return MANAGER_TABLE(managerPtr, room, id);
+        default:
+            assert(0);
+    }
+
+    return NULL;
+}
+
+
+/* =============================================================================
+ * tableFree
+ * =============================================================================
+ */
+static void
+tableFree (void *k, void *v)
+{
+    if (freeData && v)
+        freeData(v);
+}
+
+
+/* =============================================================================
+ * shardsFree
+ * =============================================================================
+ */
+static void
+shardsFree (MAP_T** tablePtrs, long numShard, void (*freeFn)(void *))
+{
+    long s;
+
+    for (s = 0; s < numShard; s++) {
+        freeData = freeFn;
+        MAP_FREE(tablePtrs[s], tableFree);
+    }
+}
+
+
+/* =============================================================================
+ * manager_free
+ * =============================================================================
+ */
+void
+manager_free (manager_t* managerPtr)
+{
+    shardsFree(SHARDS(managerPtr, car), NUM_SHARD(managerPtr),
+               (void (*)(void *))reservation_free_seq);
+    shardsFree(SHARDS(managerPtr, room), NUM_SHARD(managerPtr),
+               (void (*)(void *))reservation_free_seq);
+    shardsFree(SHARDS(managerPtr, flight), NUM_SHARD(managerPtr),
+               (void (*)(void *))reservation_free_seq);
+    shardsFree(SHARDS(managerPtr, customer), NUM_SHARD(managerPtr),
+               (void (*)(void *))customer_free_seq);
+
+#ifdef MANAGER_SHARDED
+    free(managerPtr->carTables);
+    free(managerPtr->roomTables);
+    free(managerPtr->flightTables);
+    free(managerPtr->customerTables);
+#endif
+#ifdef MANAGER_SNAPSHOT
+    {
+        long t;
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            free(managerPtr->snapshots[t]);
+        }
+        free(managerPtr->billSnapshots);
+    }
+#endif
+#ifdef MANAGER_DURABLE
+    {
+        long k;
+        for (k = 0; k <= NUM_RESERVATION_TYPE; k++) {
+            free(managerPtr->versions[k]);
+        }
+        for (k = 0; k < managerPtr->numRedo; k++) {
+            free(managerPtr->redos[k].words);
+        }
+        free(managerPtr->redos);
+    }
+#endif
+    free(managerPtr);
+}
+
+
+#if defined(MANAGER_SNAPSHOT) || defined(MANAGER_DURABLE)
+/* =============================================================================
+ * ID WORDS
+ * -- Arrays with one word per id, each word on a cache line of its own:
+ *    hardware transactions detect conflicts per line, so packed words would
+ *    make transactions on neighbouring ids conflict
+ * =============================================================================
+ */
+
+#define ID_LINE_SIZE                (64)
+#define ID_LINE_WORDS               (ID_LINE_SIZE / (long)sizeof(long))
+#define ID_WORD(words, id)          ((words)[(long)(id) * ID_LINE_WORDS])
+
+
+/* =============================================================================
+ * allocIdWords
+ * -- Zeroed words for ids 0..maxId
+ * -- Returns NULL on failure
+ * =============================================================================
+ */
+static long*
+allocIdWords (long maxId)
+{
+    size_t size = (size_t)(maxId + 1) * ID_LINE_SIZE;
+    long* words = (long*)aligned_alloc(ID_LINE_SIZE, size);
+
+    if (words != NULL) {
+        memset(words, 0, size);
+    }
+
+    return words;
+}
+#endif /* MANAGER_SNAPSHOT || MANAGER_DURABLE */
+
+
+#ifdef MANAGER_SNAPSHOT
+/* =============================================================================
+ * SNAPSHOT WORDS
+ * -- A reservation word is numFree << 32 | price, or SNAPSHOT_NONE; a bill
+ *    word is the bill, or SNAPSHOT_NONE
+ * -- Writers only touch words of ids they already wrote in the tables; the
+ *    words are ID_WORDs, so writers of different ids do not share lines
+ * =============================================================================
+ */
+
+#define SNAPSHOT_NONE               (-1L)
+#define SNAPSHOT_PACK(numFree, price) \
+    (((numFree) << 32) | (price))
+#define SNAPSHOT_NUM_FREE(word)     ((word) >> 32)
+#define SNAPSHOT_PRICE(word)        ((word) & 0xffffffffL)
+
+#define SNAPSHOT_TRACKED(mgr, id) \
+    ((mgr)->billSnapshots != NULL && \
+     (unsigned long)(id) <= (unsigned long)(mgr)->maxSnapshotId)
+
+
+/* =============================================================================
+ * snapshotWord
+ * =============================================================================
+ */
+static inline long
+snapshotWord (long numFree, long price)
+{
+    assert(numFree >= 0 && numFree <= 0x7fffffffL);
+    assert(price >= 0 && price <= 0xffffffffL);
+
+    return SNAPSHOT_PACK(numFree, price);
+}
+
+
+/* =============================================================================
+ * snapshotReservation
+ * -- Publishes reservation (type, id) as the transaction sees it
+ * -- Returns the reservation, or NULL if it does not exist or snapshots are
+ *    not enabled
+ * =============================================================================
+ */
+TM_CALLABLE
+static reservation_t*
+snapshotReservation (TM_ARGDECL  manager_t* managerPtr, long type, long id)
+{
+    reservation_t* reservationPtr;
+    long word = SNAPSHOT_NONE;
+
+    if (managerPtr->billSnapshots == NULL) {
+        return NULL; /* not enabled yet */
+    }
+    reservationPtr = (reservation_t*)TMMAP_FIND(
+        manager_getReservationTable(managerPtr, type, id), id);
+    if (!SNAPSHOT_TRACKED(managerPtr, id)) {
+        return reservationPtr;
+    }
+    if (reservationPtr != NULL) {
+        word = snapshotWord(
+            RESERVATION_READ_NUM_FREE(reservationPtr),
+            (long)TM_SHARED_READ_TAG(reservationPtr->price, reservationPtr));
+    }
+    TM_SHARED_WRITE(ID_WORD(managerPtr->snapshots[type], id), word);
+
+    return reservationPtr;
+}
+
+static reservation_t*
+HTMsnapshotReservation (manager_t* managerPtr, long type, long id)
+{
+    reservation_t* reservationPtr;
+
+    if (managerPtr->billSnapshots == NULL) {
+        return NULL; /* not enabled yet */
+    }
+    reservationPtr = (reservation_t*)HTMMAP_FIND(
+        manager_getReservationTable(managerPtr, type, id), id);
+    if (!SNAPSHOT_TRACKED(managerPtr, id)) {
+        return reservationPtr;
+    }
+    HTM_SHARED_WRITE(ID_WORD(managerPtr->snapshots[type], id),
+                     ((reservationPtr == NULL) ?
+                      SNAPSHOT_NONE :
+                      snapshotWord(HTMRESERVATION_READ_NUM_FREE(reservationPtr),
+                                   (long)HTM_SHARED_READ(reservationPtr->price))));
+
+    return reservationPtr;
+}
+
+static reservation_t*
+snapshotReservation_seq (manager_t* managerPtr, long type, long id)
+{
+    reservation_t* reservationPtr;
+    long word = SNAPSHOT_NONE;
+
+    if (managerPtr->billSnapshots == NULL) {
+        return NULL; /* not enabled yet */
+    }
+    reservationPtr = (reservation_t*)MAP_FIND(
+        manager_getReservationTable(managerPtr, type, id), id);
+    if (!SNAPSHOT_TRACKED(managerPtr, id)) {
+        return reservationPtr;
+    }
+    if (reservationPtr != NULL) {
+        word = snapshotWord(reservationPtr->numFree, reservationPtr->price);
+    }
+    ID_WORD(managerPtr->snapshots[type], id) = word;
+
+    return reservationPtr;
+}
+
+
+/* =============================================================================
+ * snapshotBill
+ * -- Publishes 'bill' for the customer; SNAPSHOT_NONE if it was deleted
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+snapshotBill (TM_ARGDECL  manager_t* managerPtr, long customerId, long bill)
+{
+    if (SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        TM_SHARED_WRITE(ID_WORD(managerPtr->billSnapshots, customerId), bill);
+    }
+}
+
+static void
+HTMsnapshotBill (manager_t* managerPtr, long customerId, long bill)
+{
+    if (SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        HTM_SHARED_WRITE(ID_WORD(managerPtr->billSnapshots, customerId), bill);
+    }
+}
+
+static void
+snapshotBill_seq (manager_t* managerPtr, long customerId, long bill)
+{
+    if (SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        ID_WORD(managerPtr->billSnapshots, customerId) = bill;
+    }
+}
+
+
+/* =============================================================================
+ * snapshotReserve
+ * -- Publishes a successful reservation of (type, id) by the customer
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+snapshotReserve (TM_ARGDECL
+                 manager_t* managerPtr, long type, long customerId, long id)
+{
+    reservation_t* reservationPtr =
+        snapshotReservation(TM_ARG  managerPtr, type, id);
+
+    if (reservationPtr != NULL && SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        long bill = (long)TM_SHARED_READ(
+            ID_WORD(managerPtr->billSnapshots, customerId));
+        snapshotBill(TM_ARG
+                     managerPtr,
+                     customerId,
+                     bill + (long)TM_SHARED_READ_TAG(reservationPtr->price,
+                                                     reservationPtr));
+    }
+}
+
+static void
+HTMsnapshotReserve (manager_t* managerPtr, long type, long customerId, long id)
+{
+    reservation_t* reservationPtr =
+        HTMsnapshotReservation(managerPtr, type, id);
+
+    if (reservationPtr != NULL && SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        long bill = (long)HTM_SHARED_READ(
+            ID_WORD(managerPtr->billSnapshots, customerId));
+        HTMsnapshotBill(managerPtr,
+                        customerId,
+                        bill + (long)HTM_SHARED_READ(reservationPtr->price));
+    }
+}
+
+static void
+snapshotReserve_seq (manager_t* managerPtr, long type, long customerId, long id)
+{
+    reservation_t* reservationPtr =
+        snapshotReservation_seq(managerPtr, type, id);
+
+    if (reservationPtr != NULL && SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        snapshotBill_seq(managerPtr,
+                         customerId,
+                         ID_WORD(managerPtr->billSnapshots, customerId) +
+                         reservationPtr->price);
+    }
+}
+
+
+/* =============================================================================
+ * manager_enableSnapshots_seq
+ * -- Publishes the current tables for ids 0..maxId; later writes keep the
+ *    words current. Ids beyond maxId are not tracked.
+ * -- Call once after loading, before any client starts
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_enableSnapshots_seq (manager_t* managerPtr, long maxId)
+{
+    long t;
+    long id;
+
+    assert(managerPtr->billSnapshots == NULL);
+    if (maxId < 0) {
+        return FALSE;
+    }
+
+    for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+        managerPtr->snapshots[t] = allocIdWords(maxId);
+        if (managerPtr->snapshots[t] == NULL) {
+            return FALSE;
+        }
+    }
+    managerPtr->billSnapshots = allocIdWords(maxId);
+    if (managerPtr->billSnapshots == NULL) {
+        return FALSE;
+    }
+    managerPtr->maxSnapshotId = maxId;
+
+    for (id = 0; id <= maxId; id++) {
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            snapshotReservation_seq(managerPtr, t, id);
+        }
+        snapshotBill_seq(managerPtr,
+                         id,
+                         manager_queryCustomerBill_seq(managerPtr, id));
+    }
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * manager_snapshotQuery
+ * -- Returns the number of free units of reservation (type, id) and stores
+ *    its price in *pricePtr, from one committed state
+ * -- Returns -1 if the reservation does not exist or is not tracked
+ * -- Safe outside a transaction
+ * -- Two calls may see two different committed states
+ * =============================================================================
+ */
+long
+manager_snapshotQuery (manager_t* managerPtr, long type, long id, long* pricePtr)
+{
+    long word;
+
+    if (!SNAPSHOT_TRACKED(managerPtr, id)) {
+        return -1;
+    }
+    word = __atomic_load_n(&ID_WORD(managerPtr->snapshots[type], id),
+                           __ATOMIC_ACQUIRE);
+    if (word == SNAPSHOT_NONE) {
+        return -1;
+    }
+    *pricePtr = SNAPSHOT_PRICE(word);
+
+    return SNAPSHOT_NUM_FREE(word);
+}
+
+
+/* =============================================================================
+ * manager_snapshotQueryCustomerBill
+ * -- Returns the bill of a committed state of the customer
+ * -- Returns -1 if the customer does not exist or is not tracked
+ * -- Safe outside a transaction
+ * =============================================================================
+ */
+long
+manager_snapshotQueryCustomerBill (manager_t* managerPtr, long customerId)
+{
+    if (!SNAPSHOT_TRACKED(managerPtr, customerId)) {
+        return -1;
+    }
+
+    return __atomic_load_n(&ID_WORD(managerPtr->billSnapshots, customerId),
+                           __ATOMIC_ACQUIRE);
+}
+
+
+#define SNAPSHOT_RESERVATION(mgr, type, id) \
+    snapshotReservation(TM_ARG  mgr, type, id)
+#define SNAPSHOT_BILL(mgr, customerId, bill) \
+    snapshotBill(TM_ARG  mgr, customerId, bill)
+#define SNAPSHOT_RESERVE(mgr, type, customerId, id) \
+    snapshotReserve(TM_ARG  mgr, type, customerId, id)
+
+#define HTMSNAPSHOT_RESERVATION(mgr, type, id) \
+    HTMsnapshotReservation(mgr, type, id)
+#define HTMSNAPSHOT_BILL(mgr, customerId, bill) \
+    HTMsnapshotBill(mgr, customerId, bill)
+#define HTMSNAPSHOT_RESERVE(mgr, type, customerId, id) \
+    HTMsnapshotReserve(mgr, type, customerId, id)
+
+#define SNAPSHOT_RESERVATION_SEQ(mgr, type, id) \
+    snapshotReservation_seq(mgr, type, id)
+#define SNAPSHOT_BILL_SEQ(mgr, customerId, bill) \
+    snapshotBill_seq(mgr, customerId, bill)
+#define SNAPSHOT_RESERVE_SEQ(mgr, type, customerId, id) \
+    snapshotReserve_seq(mgr, type, customerId, id)
+
+#else /* !MANAGER_SNAPSHOT */
+
+#define SNAPSHOT_RESERVATION(mgr, type, id)             /* nothing */
+#define SNAPSHOT_BILL(mgr, customerId, bill)            /* nothing */
+#define SNAPSHOT_RESERVE(mgr, type, customerId, id)     /* nothing */
+#define HTMSNAPSHOT_RESERVATION(mgr, type, id)          /* nothing */
+#define HTMSNAPSHOT_BILL(mgr, customerId, bill)         /* nothing */
+#define HTMSNAPSHOT_RESERVE(mgr, type, customerId, id)  /* nothing */
+#define SNAPSHOT_RESERVATION_SEQ(mgr, type, id)         /* nothing */
+#define SNAPSHOT_BILL_SEQ(mgr, customerId, bill)        /* nothing */
+#define SNAPSHOT_RESERVE_SEQ(mgr, type, customerId, id) /* nothing */
+
+#endif /* !MANAGER_SNAPSHOT */
+
+
+#ifdef MANAGER_DURABLE
+/* =============================================================================
+ * REDO IMAGES
+ * -- A reservation image is kind (its type), id, version, exists, numUsed,
+ *    numFree, numTotal, price; a customer image is kind (REDO_CUSTOMER), id,
+ *    version, exists, numInfo, and numInfo (type, id, price) triples
+ * -- Versions of ids written by a transaction are bumped in it; they are
+ *    ID_WORDs, so writers of different ids do not share lines
+ * =============================================================================
+ */
+
+#define REDO_CUSTOMER               (NUM_RESERVATION_TYPE)
+#define REDO_HEADER_WORDS           (4)
+#define REDO_RESERVATION_WORDS      (REDO_HEADER_WORDS + 4)
+#define REDO_CUSTOMER_WORDS(numInfo) \
+    (REDO_HEADER_WORDS + 1 + 3 * (numInfo))
+#define REDO_INITIAL_WORDS          (256)
+#define REDO_DUMP_WORDS             (1L << 14) /* per checkpoint record */
+
+typedef struct replay {
+    manager_t* managerPtr;
+    bool_t isValid;
+} replay_t;
+
+static __thread manager_redo_t* global_redoPtr = NULL;
+
+
+/* =============================================================================
+ * redoAppend
+ * -- Returns room for 'numWord' more words
+ * =============================================================================
+ */
+TM_PURE
+static long*
+redoAppend (manager_redo_t* redoPtr, long numWord)
+{
+    long* words;
+
+    if (redoPtr->numWord + numWord > redoPtr->capacity) {
+        long capacity = 2 * (redoPtr->numWord + numWord);
+        words = (long*)realloc(redoPtr->words, capacity * sizeof(long));
+        assert(words != NULL);
+        redoPtr->words = words;
+        redoPtr->capacity = capacity;
+    }
+    words = &redoPtr->words[redoPtr->numWord];
+    redoPtr->numWord += numWord;
+
+    return words;
+}
+
+
+/* =============================================================================
+ * durableReservation
+ * -- Records the image of reservation (type, id) as the transaction sees it
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+durableReservation (TM_ARGDECL  manager_t* managerPtr, long type, long id)
+{
+    reservation_t* reservationPtr;
+    long version;
+    long* versionPtr;
+    long* words;
+
+    if (global_redoPtr == NULL) {
+        return; /* not a client transaction */
+    }
+    assert((unsigned long)id <= (unsigned long)managerPtr->maxDurableId);
+    reservationPtr = (reservation_t*)TMMAP_FIND(
+        manager_getReservationTable(managerPtr, type, id), id);
+    versionPtr = &ID_WORD(managerPtr->versions[type], id);
+    version = (long)TM_SHARED_READ(*versionPtr) + 1;
+    TM_SHARED_WRITE(*versionPtr, version);
+
+    words = redoAppend(global_redoPtr, REDO_RESERVATION_WORDS);
+    words[0] = type;
+    words[1] = id;
+    words[2] = version;
+    words[3] = (reservationPtr != NULL);
+    if (reservationPtr != NULL) {
+        words[4] = (long)TM_SHARED_READ_TAG(reservationPtr->numUsed, reservationPtr);
+        words[5] = RESERVATION_READ_NUM_FREE(reservationPtr);
+        words[6] = (long)TM_SHARED_READ_TAG(reservationPtr->numTotal, reservationPtr);
+        words[7] = (long)TM_SHARED_READ_TAG(reservationPtr->price, reservationPtr);
+    } else {
+        words[4] = words[5] = words[6] = words[7] = 0;
+    }
+}
+
+static void
+HTMdurableReservation (manager_t* managerPtr, long type, long id)
+{
+    reservation_t* reservationPtr;
+    long version;
+    long* words;
+
+    if (global_redoPtr == NULL) {
+        return; /* not a client transaction */
+    }
+    assert((unsigned long)id <= (unsigned long)managerPtr->maxDurableId);
+    reservationPtr = (reservation_t*)HTMMAP_FIND(
+        manager_getReservationTable(managerPtr, type, id), id);
+    version = (long)HTM_SHARED_READ(
+        ID_WORD(managerPtr->versions[type], id)) + 1;
+    HTM_SHARED_WRITE(ID_WORD(managerPtr->versions[type], id), version);
+
+    words = redoAppend(global_redoPtr, REDO_RESERVATION_WORDS);
+    words[0] = type;
+    words[1] = id;
+    words[2] = version;
+    words[3] = (reservationPtr != NULL);
+    if (reservationPtr != NULL) {
+        words[4] = (long)HTM_SHARED_READ(reservationPtr->numUsed);
+        words[5] = HTMRESERVATION_READ_NUM_FREE(reservationPtr);
+        words[6] = (long)HTM_SHARED_READ(reservationPtr->numTotal);
+        words[7] = (long)HTM_SHARED_READ(reservationPtr->price);
+    } else {
+        words[4] = words[5] = words[6] = words[7] = 0;
+    }
+}
+
+
+/* =============================================================================
+ * durableCustomer
+ * -- Records the image of the customer as the transaction sees it
+ * =============================================================================
+ */
+TM_CALLABLE
+static void
+durableCustomer (TM_ARGDECL  manager_t* managerPtr, long customerId)
+{
+    customer_t* customerPtr;
+    long numInfo = 0;
+    long version;
+    long* versionPtr;
+    long* words;
+
+    if (global_redoPtr == NULL) {
+        return; /* not a client transaction */
+    }
+    assert((unsigned long)customerId <= (unsigned long)managerPtr->maxDurableId);
+    customerPtr = (customer_t*)TMMAP_FIND(
+        MANAGER_TABLE(managerPtr, customer, customerId), customerId);
+    versionPtr = &ID_WORD(managerPtr->versions[REDO_CUSTOMER], customerId);
+    version = (long)TM_SHARED_READ(*versionPtr) + 1;
+    TM_SHARED_WRITE(*versionPtr, version);
+
+    if (customerPtr != NULL) {
+        numInfo = CUSTOMER_COPY_RESERVATION_INFOS(customerPtr, NULL, 0);
+    }
+    words = redoAppend(global_redoPtr, REDO_CUSTOMER_WORDS(numInfo));
+    words[0] = REDO_CUSTOMER;
+    words[1] = customerId;
+    words[2] = version;
+    words[3] = (customerPtr != NULL);
+    words[4] = numInfo;
+    if (numInfo > 0) {
+        CUSTOMER_COPY_RESERVATION_INFOS(customerPtr, &words[5], numInfo);
+    }
+}
+
+static void
+HTMdurableCustomer (manager_t* managerPtr, long customerId)
+{
+    customer_t* customerPtr;
+    long numInfo = 0;
+    long version;
+    long* words;
+
+    if (global_redoPtr == NULL) {
+        return; /* not a client transaction */
+    }
+    assert((unsigned long)customerId <= (unsigned long)managerPtr->maxDurableId);
+    customerPtr = (customer_t*)HTMMAP_FIND(
+        MANAGER_TABLE(managerPtr, customer, customerId), customerId);
+    version = (long)HTM_SHARED_READ(
+        ID_WORD(managerPtr->versions[REDO_CUSTOMER], customerId)) + 1;
+    HTM_SHARED_WRITE(ID_WORD(managerPtr->versions[REDO_CUSTOMER], customerId),
+                     version);
+
+    if (customerPtr != NULL) {
+        numInfo = HTMCUSTOMER_COPY_RESERVATION_INFOS(customerPtr, NULL, 0);
+    }
+    words = redoAppend(global_redoPtr, REDO_CUSTOMER_WORDS(numInfo));
+    words[0] = REDO_CUSTOMER;
+    words[1] = customerId;
+    words[2] = version;
+    words[3] = (customerPtr != NULL);
+    words[4] = numInfo;
+    if (numInfo > 0) {
+        HTMCUSTOMER_COPY_RESERVATION_INFOS(customerPtr, &words[5], numInfo);
+    }
+}
+
+
+/* =============================================================================
+ * applyReservation_seq
+ * =============================================================================
+ */
+static void
+applyReservation_seq (manager_t* managerPtr, const long* words)
+{
+    long id = words[1];
+    MAP_T* tablePtr = manager_getReservationTable(managerPtr, words[0], id);
+    reservation_t* reservationPtr = (reservation_t*)MAP_FIND(tablePtr, id);
+    bool_t status;
+
+    if (!words[3]) {
+        if (reservationPtr != NULL) {
+            status = MAP_REMOVE(tablePtr, id);
+            assert(status);
+            RESERVATION_FREE_SEQ(reservationPtr);
+        }
+        return;
+    }
+
+    if (reservationPtr == NULL) {
+        reservationPtr = RESERVATION_ALLOC_SEQ(id, words[6], words[7]);
+        assert(reservationPtr != NULL);
+        status = MAP_INSERT(tablePtr, id, reservationPtr);
+        assert(status);
+    }
+    reservationPtr->numUsed = words[4];
+    reservationPtr->numFree = words[5];
+    reservationPtr->numTotal = words[6];
+    reservationPtr->price = words[7];
+}
+
+
+/* =============================================================================
+ * applyCustomer_seq
+ * =============================================================================
+ */
+static void
+applyCustomer_seq (manager_t* managerPtr, const long* words)
+{
+    long id = words[1];
+    MAP_T* tablePtr = MANAGER_TABLE(managerPtr, customer, id);
+    customer_t* customerPtr = (customer_t*)MAP_FIND(tablePtr, id);
+    bool_t status;
+    long i;
+
+    if (customerPtr != NULL) {
+        status = MAP_REMOVE(tablePtr, id);
+        assert(status);
+        CUSTOMER_FREE_SEQ(customerPtr);
+    }
+    if (!words[3]) {
+        return;
+    }
+
+    customerPtr = CUSTOMER_ALLOC_SEQ(id);
+    assert(customerPtr != NULL);
+    for (i = 0; i < words[4]; i++) {
+        const long* infoPtr = &words[5 + 3 * i];
+        status = CUSTOMER_ADD_RESERVATION_INFO_SEQ(customerPtr,
+                                                   (reservation_type_t)infoPtr[0],
+                                                   infoPtr[1],
+                                                   infoPtr[2]);
+        assert(status);
+    }
+    status = MAP_INSERT(tablePtr, id, customerPtr);
+    assert(status);
+}
+
+
+/* =============================================================================
+ * applyRecord
+ * -- Checkpoint records (epoch 0) hold each object once and are applied as
+ *    they are; a logged image is applied only over an older version
+ * =============================================================================
+ */
+static void
+applyRecord (void* argPtr, long epoch, const void* dataPtr, long size)
+{
+    replay_t* replayPtr = (replay_t*)argPtr;
+    manager_t* managerPtr = replayPtr->managerPtr;
+    const long* words = (const long*)dataPtr;
+    long numWord = size / (long)sizeof(long);
+    long w = 0;
+
+    while (w < numWord) {
+        long kind;
+        long id;
+        long numImageWord;
+        long* versionPtr;
+        if (w + REDO_HEADER_WORDS + 1 > numWord) {
+            replayPtr->isValid = FALSE;
+            return;
+        }
+        kind = words[w];
+        id = words[w + 1];
+        numImageWord = ((kind == REDO_CUSTOMER) ?
+                        REDO_CUSTOMER_WORDS(words[w + REDO_HEADER_WORDS]) :
+                        REDO_RESERVATION_WORDS);
+        if (kind < 0 || kind > REDO_CUSTOMER ||
+            (unsigned long)id > (unsigned long)managerPtr->maxDurableId ||
+            numImageWord < REDO_HEADER_WORDS + 1 || w + numImageWord > numWord)
+        {
+            replayPtr->isValid = FALSE; /* written with a larger -r? */
+            return;
+        }
+        versionPtr = &ID_WORD(managerPtr->versions[kind], id);
+        if (epoch == 0 || words[w + 2] > *versionPtr) {
+            *versionPtr = words[w + 2];
+            if (kind == REDO_CUSTOMER) {
+                applyCustomer_seq(managerPtr, &words[w]);
+            } else {
+                applyReservation_seq(managerPtr, &words[w]);
+            }
+        }
+        w += numImageWord;
+    }
+}
+
+
+/* =============================================================================
+ * dumpTables
+ * -- Writes an image of every reservation and customer
+ * =============================================================================
+ */
+static bool_t
+dumpTables (void* argPtr, redolog_t* logPtr)
+{
+    manager_t* managerPtr = (manager_t*)argPtr;
+    manager_redo_t dump = { 0, 0, 0, 0, NULL };
+    bool_t status = TRUE;
+    long id;
+
+    for (id = 0; id <= managerPtr->maxDurableId && status; id++) {
+        customer_t* customerPtr;
+        long t;
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            reservation_t* reservationPtr = (reservation_t*)MAP_FIND(
+                manager_getReservationTable(managerPtr, t, id), id);
+            long* words;
+            if (reservationPtr == NULL) {
+                continue;
+            }
+            words = redoAppend(&dump, REDO_RESERVATION_WORDS);
+            words[0] = t;
+            words[1] = id;
+            words[2] = ID_WORD(managerPtr->versions[t], id);
+            words[3] = TRUE;
+            words[4] = reservationPtr->numUsed;
+            words[5] = reservationPtr->numFree;
+            words[6] = reservationPtr->numTotal;
+            words[7] = reservationPtr->price;
+        }
+        customerPtr = (customer_t*)MAP_FIND(
+            MANAGER_TABLE(managerPtr, customer, id), id);
+        if (customerPtr != NULL) {
+            long numInfo = CUSTOMER_COPY_RESERVATION_INFOS_SEQ(customerPtr, NULL, 0);
+            long* words = redoAppend(&dump, REDO_CUSTOMER_WORDS(numInfo));
+            words[0] = REDO_CUSTOMER;
+            words[1] = id;
+            words[2] = ID_WORD(managerPtr->versions[REDO_CUSTOMER], id);
+            words[3] = TRUE;
+            words[4] = numInfo;
+            CUSTOMER_COPY_RESERVATION_INFOS_SEQ(customerPtr, &words[5], numInfo);
+        }
+        if (dump.numWord >= REDO_DUMP_WORDS || id == managerPtr->maxDurableId) {
+            if (dump.numWord > 0) {
+                status = redolog_dump(logPtr, dump.words,
+                                      dump.numWord * sizeof(long));
+            }
+            dump.numWord = 0;
+        }
+    }
+
+    free(dump.words);
+
+    return status;
+}
+
+
 /* =============================================================================
- * tableAlloc
+ * manager_enableDurable_seq
+ * -- Keeps versions for ids 0..maxId and a redo buffer for each of
+ *    'numThread' clients; ids beyond maxId must not be written
+ * -- Call once on an empty manager, before recovering or loading it
+ * -- Returns TRUE on success, else FALSE
  * =============================================================================
  */
-static MAP_T*
-tableAlloc ()
+bool_t
+manager_enableDurable_seq (manager_t* managerPtr, redolog_t* logPtr,
+                           long maxId, long numThread)
 {
-    return MAP_ALLOC(NULL, NULL);
+    long k;
+    long i;
+
+    assert(managerPtr->logPtr == NULL);
+    if (maxId < 0 || numThread < 1) {
+        return FALSE;
+    }
+
+    for (k = 0; k <= REDO_CUSTOMER; k++) {
+        managerPtr->versions[k] = allocIdWords(maxId);
+        if (managerPtr->versions[k] == NULL) {
+            return FALSE;
+        }
+    }
+    managerPtr->redos =
+        (manager_redo_t*)calloc(numThread, sizeof(manager_redo_t));
+    if (managerPtr->redos == NULL) {
+        return FALSE;
+    }
+    managerPtr->numRedo = numThread;
+    for (i = 0; i < numThread; i++) {
+        manager_redo_t* redoPtr = &managerPtr->redos[i];
+        redoPtr->writer = i;
+        redoPtr->capacity = REDO_INITIAL_WORDS;
+        redoPtr->words = (long*)malloc(REDO_INITIAL_WORDS * sizeof(long));
+        if (redoPtr->words == NULL) {
+            return FALSE;
+        }
+    }
+    managerPtr->maxDurableId = maxId;
+    managerPtr->logPtr = logPtr;
+
+    return TRUE;
 }
 
 
 /* =============================================================================
- * manager_alloc
+ * manager_recoverDurable_seq
+ * -- Rebuilds the empty tables from the checkpoint and logs
+ * -- Returns the number of log records applied, or -1 on failure
  * =============================================================================
  */
-manager_t*
-manager_alloc ()
+long
+manager_recoverDurable_seq (manager_t* managerPtr)
 {
-    manager_t* managerPtr = (manager_t*)malloc(sizeof(manager_t));
-    assert(managerPtr != NULL);
+    replay_t replay;
+    long numApplied;
 
-    managerPtr->carTablePtr = tableAlloc();
-    managerPtr->roomTablePtr = tableAlloc();
-    managerPtr->flightTablePtr = tableAlloc();
-    managerPtr->customerTablePtr = tableAlloc();
-    assert(managerPtr->carTablePtr != NULL);
-    assert(managerPtr->roomTablePtr != NULL);
-    assert(managerPtr->flightTablePtr != NULL);
-    assert(managerPtr->customerTablePtr != NULL);
+    replay.managerPtr = managerPtr;
+    replay.isValid = TRUE;
+    numApplied = redolog_replay(managerPtr->logPtr, &applyRecord, &replay);
 
-    return managerPtr;
+    return (replay.isValid ? numApplied : -1);
 }
 
 
 /* =============================================================================
- * tableFree
+ * manager_startDurable_seq
+ * -- Checkpoints the tables and starts a log per client
+ * -- Returns TRUE on success, else FALSE
  * =============================================================================
  */
-static void
-tableFree (void *k, void *v)
+bool_t
+manager_startDurable_seq (manager_t* managerPtr)
 {
-    if (freeData && v)
-        freeData(v);
+    return (redolog_checkpoint(managerPtr->logPtr, &dumpTables, managerPtr) &&
+            redolog_start(managerPtr->logPtr, managerPtr->numRedo));
 }
 
 
+/* =============================================================================
+ * manager_enterRedo
+ * -- Binds the calling client's redo buffer; before the transaction
+ * =============================================================================
+ */
+void
+manager_enterRedo (manager_t* managerPtr)
+{
+    long threadId = thread_getId();
+
+    assert(threadId < managerPtr->numRedo);
+    global_redoPtr = &managerPtr->redos[threadId];
+    redolog_begin(managerPtr->logPtr, global_redoPtr->writer);
+}
+
 
 /* =============================================================================
- * manager_free
+ * manager_beginRedo
+ * -- Empties the redo buffer; first thing in the transaction
  * =============================================================================
  */
+TM_PURE
 void
-manager_free (manager_t* managerPtr)
+manager_beginRedo (manager_t* managerPtr)
 {
-    freeData = (void (*)(void *))reservation_free_seq;
-    MAP_FREE(managerPtr->carTablePtr, tableFree);
-    freeData = (void (*)(void *))reservation_free_seq;
-    MAP_FREE(managerPtr->roomTablePtr, tableFree);
-    freeData = (void (*)(void *))reservation_free_seq;
-    MAP_FREE(managerPtr->flightTablePtr, tableFree);
-    freeData = (void (*)(void *))customer_free_seq;
-    MAP_FREE(managerPtr->customerTablePtr, tableFree);
+    global_redoPtr->numWord = 0;
+}
 
-    free(managerPtr);
+
+/* =============================================================================
+ * manager_endRedo
+ * -- Reads the epoch if anything was written; last thing in the transaction
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+manager_endRedo (TM_ARGDECL  manager_t* managerPtr)
+{
+    if (global_redoPtr->numWord > 0) {
+        global_redoPtr->epoch = (long)TM_SHARED_READ(
+            *redolog_getEpochPtr(managerPtr->logPtr));
+    }
+}
+
+void
+HTMmanager_endRedo (manager_t* managerPtr)
+{
+    if (global_redoPtr->numWord > 0) {
+        global_redoPtr->epoch = (long)HTM_SHARED_READ(
+            *redolog_getEpochPtr(managerPtr->logPtr));
+    }
+}
+
+
+/* =============================================================================
+ * manager_commitRedo
+ * -- Logs the redo buffer and waits until it is durable; after the commit
+ * =============================================================================
+ */
+void
+manager_commitRedo (manager_t* managerPtr)
+{
+    manager_redo_t* redoPtr = global_redoPtr;
+
+    redolog_commit(managerPtr->logPtr, redoPtr->writer, redoPtr->epoch,
+                   redoPtr->words, redoPtr->numWord * sizeof(long));
+    if (redoPtr->numWord > 0) {
+        redolog_sync(managerPtr->logPtr, redoPtr->epoch);
+    }
+}
+
+
+#define DURABLE_RESERVATION(mgr, type, id) \
+    durableReservation(TM_ARG  mgr, type, id)
+#define DURABLE_CUSTOMER(mgr, customerId) \
+    durableCustomer(TM_ARG  mgr, customerId)
+
+#define HTMDURABLE_RESERVATION(mgr, type, id) \
+    HTMdurableReservation(mgr, type, id)
+#define HTMDURABLE_CUSTOMER(mgr, customerId) \
+    HTMdurableCustomer(mgr, customerId)
+
+#else /* !MANAGER_DURABLE */
+
+#define DURABLE_RESERVATION(mgr, type, id)              /* nothing */
+#define DURABLE_CUSTOMER(mgr, customerId)               /* nothing */
+#define HTMDURABLE_RESERVATION(mgr, type, id)           /* nothing */
+#define HTMDURABLE_CUSTOMER(mgr, customerId)            /* nothing */
+
+#endif /* !MANAGER_DURABLE */
+
+
+/* =============================================================================
+ * buildShards
+ * -- Builds each shard from the ids 1..numId it holds, still in id order
+ * =============================================================================
+ */
+static bool_t
+buildShards (manager_t* managerPtr, MAP_T** tablePtrs, long numId, void** vals)
+{
+    long numShard = NUM_SHARD(managerPtr);
+    void** keys = (void**)malloc(numId * sizeof(void*));
+    void** shardVals = (void**)malloc(numId * sizeof(void*));
+    long* starts = (long*)calloc((numShard + 1), sizeof(long));
+    bool_t status = TRUE;
+    long i;
+    long s;
+
+    assert(keys != NULL && shardVals != NULL && starts != NULL);
+
+    /* Counting sort by shard keeps ids sorted within each shard */
+    for (i = 1; i <= numId; i++) {
+        starts[SHARD_OF(managerPtr, i) + 1]++;
+    }
+    for (s = 0; s < numShard; s++) {
+        starts[s + 1] += starts[s];
+    }
+    for (i = 1; i <= numId; i++) {
+        long j = starts[SHARD_OF(managerPtr, i)]++;
+        keys[j] = (void*)i;
+        shardVals[j] = vals[i - 1];
+    }
+    for (s = 0; s < numShard && status; s++) {
+        long start = ((s == 0) ? 0 : starts[s - 1]);
+        status = MAP_BUILD(tablePtrs[s], &keys[start], &shardVals[start], (starts[s] - start));
+    }
+
+    free(keys);
+    free(shardVals);
+    free(starts);
+
+    return status;
+}
+
+
+/* =============================================================================
+ * loadReservations
+ * =============================================================================
+ */
+static bool_t
+loadReservations (manager_t* managerPtr, MAP_T** tablePtrs,
+                  long numId, const long* nums, const long* prices)
+{
+    void** vals = (void**)malloc(numId * sizeof(void*));
+    bool_t status;
+    long i;
+
+    assert(vals != NULL);
+    for (i = 0; i < numId; i++) {
+        vals[i] = RESERVATION_ALLOC_SEQ((i + 1), nums[i], prices[i]);
+        assert(vals[i] != NULL);
+    }
+    status = buildShards(managerPtr, tablePtrs, numId, vals);
+
+    free(vals);
+
+    return status;
+}
+
+
+/* =============================================================================
+ * manager_loadCars_seq
+ * -- Fills the empty car table with ids 1..numId, where id i has nums[i-1]
+ *    cars at prices[i-1]
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadCars_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices)
+{
+    return loadReservations(managerPtr, SHARDS(managerPtr, car), numId, nums, prices);
+}
+
+
+/* =============================================================================
+ * manager_loadFlights_seq
+ * -- Fills the empty flight table with ids 1..numId, where id i has nums[i-1]
+ *    seats at prices[i-1]
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadFlights_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices)
+{
+    return loadReservations(managerPtr, SHARDS(managerPtr, flight), numId, nums, prices);
+}
+
+
+/* =============================================================================
+ * manager_loadRooms_seq
+ * -- Fills the empty room table with ids 1..numId, where id i has nums[i-1]
+ *    rooms at prices[i-1]
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadRooms_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices)
+{
+    return loadReservations(managerPtr, SHARDS(managerPtr, room), numId, nums, prices);
+}
+
+
+/* =============================================================================
+ * manager_loadCustomers_seq
+ * -- Fills the empty customer table with ids 1..numId
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadCustomers_seq (manager_t* managerPtr, long numId)
+{
+    void** vals = (void**)malloc(numId * sizeof(void*));
+    bool_t status;
+    long i;
+
+    assert(vals != NULL);
+    for (i = 0; i < numId; i++) {
+        vals[i] = CUSTOMER_ALLOC_SEQ(i + 1);
+        assert(vals[i] != NULL);
+    }
+    status = buildShards(managerPtr, SHARDS(managerPtr, customer), numId, vals);
+
+    free(vals);
+
+    return status;
 }
 
 
@@ -313,19 +1503,39 @@ bool_t
 manager_addCar (TM_ARGDECL
                 manager_t* managerPtr, long carId, long numCars, long price)
 {
-    return addReservation(TM_ARG  managerPtr->carTablePtr, carId, numCars, price);
+    bool_t status = addReservation(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId, numCars, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_addCar (manager_t* managerPtr, long carId, long numCars, long price)
 {
-    return HTMaddReservation(managerPtr->carTablePtr, carId, numCars, price);
+    bool_t status = HTMaddReservation(MANAGER_TABLE(managerPtr, car, carId), carId, numCars, price);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_addCar_seq (manager_t* managerPtr, long carId, long numCars, long price)
 {
-    return addReservation_seq(managerPtr->carTablePtr, carId, numCars, price);
+    bool_t status = addReservation_seq(MANAGER_TABLE(managerPtr, car, carId), carId, numCars, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 
@@ -343,21 +1553,41 @@ bool_t
 manager_deleteCar (TM_ARGDECL  manager_t* managerPtr, long carId, long numCar)
 {
     /* -1 keeps old price */
-    return addReservation(TM_ARG  managerPtr->carTablePtr, carId, -numCar, -1);
+    bool_t status = addReservation(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId, -numCar, -1);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_deleteCar (manager_t* managerPtr, long carId, long numCar)
 {
     /* -1 keeps old price */
-    return HTMaddReservation(managerPtr->carTablePtr, carId, -numCar, -1);
+    bool_t status = HTMaddReservation(MANAGER_TABLE(managerPtr, car, carId), carId, -numCar, -1);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_deleteCar_seq (manager_t* managerPtr, long carId, long numCar)
 {
     /* -1 keeps old price */
-    return addReservation_seq(managerPtr->carTablePtr, carId, -numCar, -1);
+    bool_t status = addReservation_seq(MANAGER_TABLE(managerPtr, car, carId), carId, -numCar, -1);
+
+    if (status) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_CAR, carId);
+    }
+
+    return status;
 }
 
 
@@ -373,19 +1603,39 @@ bool_t
 manager_addRoom (TM_ARGDECL
                  manager_t* managerPtr, long roomId, long numRoom, long price)
 {
-    return addReservation(TM_ARG  managerPtr->roomTablePtr, roomId, numRoom, price);
+    bool_t status = addReservation(TM_ARG  MANAGER_TABLE(managerPtr, room, roomId), roomId, numRoom, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_addRoom (manager_t* managerPtr, long roomId, long numRoom, long price)
 {
-    return HTMaddReservation(managerPtr->roomTablePtr, roomId, numRoom, price);
+    bool_t status = HTMaddReservation(MANAGER_TABLE(managerPtr, room, roomId), roomId, numRoom, price);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_addRoom_seq (manager_t* managerPtr, long roomId, long numRoom, long price)
 {
-    return addReservation_seq(managerPtr->roomTablePtr, roomId, numRoom, price);
+    bool_t status = addReservation_seq(MANAGER_TABLE(managerPtr, room, roomId), roomId, numRoom, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 
@@ -403,21 +1653,41 @@ bool_t
 manager_deleteRoom (TM_ARGDECL  manager_t* managerPtr, long roomId, long numRoom)
 {
     /* -1 keeps old price */
-    return addReservation(TM_ARG  managerPtr->roomTablePtr, roomId, -numRoom, -1);
+    bool_t status = addReservation(TM_ARG  MANAGER_TABLE(managerPtr, room, roomId), roomId, -numRoom, -1);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_deleteRoom (manager_t* managerPtr, long roomId, long numRoom)
 {
     /* -1 keeps old price */
-    return HTMaddReservation(managerPtr->roomTablePtr, roomId, -numRoom, -1);
+    bool_t status = HTMaddReservation(MANAGER_TABLE(managerPtr, room, roomId), roomId, -numRoom, -1);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_deleteRoom_seq (manager_t* managerPtr, long roomId, long numRoom)
 {
     /* -1 keeps old price */
-    return addReservation_seq(TM_ARG  managerPtr->roomTablePtr, roomId, -numRoom, -1);
+    bool_t status = addReservation_seq(TM_ARG  MANAGER_TABLE(managerPtr, room, roomId), roomId, -numRoom, -1);
+
+    if (status) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_ROOM, roomId);
+    }
+
+    return status;
 }
 
 
@@ -433,20 +1703,40 @@ bool_t
 manager_addFlight (TM_ARGDECL
                    manager_t* managerPtr, long flightId, long numSeat, long price)
 {
-    return addReservation(TM_ARG
-                          managerPtr->flightTablePtr, flightId, numSeat, price);
+    bool_t status = addReservation(TM_ARG
+                                   MANAGER_TABLE(managerPtr, flight, flightId), flightId, numSeat, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_addFlight (manager_t* managerPtr, long flightId, long numSeat, long price)
 {
-    return HTMaddReservation(managerPtr->flightTablePtr, flightId, numSeat, price);
+    bool_t status = HTMaddReservation(MANAGER_TABLE(managerPtr, flight, flightId), flightId, numSeat, price);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_addFlight_seq (manager_t* managerPtr, long flightId, long numSeat, long price)
 {
-    return addReservation_seq(managerPtr->flightTablePtr, flightId, numSeat, price);
+    bool_t status = addReservation_seq(MANAGER_TABLE(managerPtr, flight, flightId), flightId, numSeat, price);
+
+    if (status) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
+
+    return status;
 }
 
 
@@ -467,7 +1757,7 @@ manager_deleteFlight (TM_ARGDECL  manager_t* managerPtr, long flightId)
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
     TM_LOG_BEGIN(MGR_DELFLIGHT, NULL, managerPtr, flightId);
 #endif /* !ORIGINAL && MERGE_MANAGER */
-    reservationPtr = (reservation_t*)TMMAP_FIND(managerPtr->flightTablePtr, flightId);
+    reservationPtr = (reservation_t*)TMMAP_FIND(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
     if (reservationPtr == NULL) {
         rv = FALSE;
         goto out;
@@ -479,10 +1769,14 @@ manager_deleteFlight (TM_ARGDECL  manager_t* managerPtr, long flightId)
     }
 
     rv = addReservation(TM_ARG
-                        managerPtr->flightTablePtr,
+                        MANAGER_TABLE(managerPtr, flight, flightId),
                         flightId,
                         -1*(long)TM_SHARED_READ_TAG(reservationPtr->numTotal, reservationPtr),
                         -1 /* -1 keeps old price */);
+    if (rv) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
 out:
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
     TM_LOG_END(MGR_DELFLIGHT, &rv);
@@ -496,7 +1790,7 @@ HTMmanager_deleteFlight (manager_t* managerPtr, long flightId)
     reservation_t* reservationPtr;
     bool_t rv;
 
-    reservationPtr = (reservation_t*)HTMMAP_FIND(managerPtr->flightTablePtr, flightId);
+    reservationPtr = (reservation_t*)HTMMAP_FIND(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
     if (reservationPtr == NULL) {
         rv = FALSE;
         goto out;
@@ -508,10 +1802,14 @@ HTMmanager_deleteFlight (manager_t* managerPtr, long flightId)
     }
 
     rv = HTMaddReservation(TM_ARG
-                        managerPtr->flightTablePtr,
+                        MANAGER_TABLE(managerPtr, flight, flightId),
                         flightId,
                         -1*reservationPtr->numTotal,
                         -1 /* -1 keeps old price */);
+    if (rv) {
+        HTMSNAPSHOT_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
 out:
     return rv;
 }
@@ -522,7 +1820,7 @@ manager_deleteFlight_seq (manager_t* managerPtr, long flightId)
     reservation_t* reservationPtr;
     bool_t rv;
 
-    reservationPtr = (reservation_t*)MAP_FIND(managerPtr->flightTablePtr, flightId);
+    reservationPtr = (reservation_t*)MAP_FIND(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
     if (reservationPtr == NULL) {
         rv = FALSE;
         goto out;
@@ -534,10 +1832,13 @@ manager_deleteFlight_seq (manager_t* managerPtr, long flightId)
     }
 
     rv = addReservation_seq(TM_ARG
-                        managerPtr->flightTablePtr,
+                        MANAGER_TABLE(managerPtr, flight, flightId),
                         flightId,
                         -1*reservationPtr->numTotal,
                         -1 /* -1 keeps old price */);
+    if (rv) {
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, RESERVATION_FLIGHT, flightId);
+    }
 out:
     return rv;
 }
@@ -559,18 +1860,21 @@ manager_addCustomer (TM_ARGDECL  manager_t* managerPtr, long customerId)
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
     TM_LOG_BEGIN(MGR_ADDCUSTOMER, NULL, managerPtr, customerId);
 #endif /* !ORIGINAL && MERGE_MANAGER */
-    if (TMMAP_CONTAINS(managerPtr->customerTablePtr, customerId)) {
+    if (TMMAP_CONTAINS(MANAGER_TABLE(managerPtr, customer, customerId), customerId)) {
         rv = FALSE;
         goto out;
     }
 
     customerPtr = CUSTOMER_ALLOC(customerId);
     assert(customerPtr != NULL);
-    rv = TMMAP_INSERT(managerPtr->customerTablePtr, customerId, customerPtr);
+    rv = TMMAP_INSERT(MANAGER_TABLE(managerPtr, customer, customerId), customerId, customerPtr);
     if (rv == FALSE) {
         TM_RESTART();
     }
 
+    SNAPSHOT_BILL(managerPtr, customerId, 0);
+    DURABLE_CUSTOMER(managerPtr, customerId);
+
     rv = TRUE;
 out:
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
@@ -585,18 +1889,21 @@ HTMmanager_addCustomer (manager_t* managerPtr, long customerId)
     customer_t* customerPtr;
     bool_t rv;
 
-    if (HTMMAP_CONTAINS(managerPtr->customerTablePtr, customerId)) {
+    if (HTMMAP_CONTAINS(MANAGER_TABLE(managerPtr, customer, customerId), customerId)) {
         rv = FALSE;
         goto out;
     }
 
     customerPtr = HTMCUSTOMER_ALLOC(customerId);
     assert(customerPtr != NULL);
-    rv = HTMMAP_INSERT(managerPtr->customerTablePtr, customerId, customerPtr);
+    rv = HTMMAP_INSERT(MANAGER_TABLE(managerPtr, customer, customerId), customerId, customerPtr);
     if (rv == FALSE) {
         HTM_RESTART();
     }
 
+    HTMSNAPSHOT_BILL(managerPtr, customerId, 0);
+    HTMDURABLE_CUSTOMER(managerPtr, customerId);
+
     rv = TRUE;
 out:
     return rv;
@@ -608,15 +1915,17 @@ manager_addCustomer_seq (manager_t* managerPtr, long customerId)
     customer_t* customerPtr;
     bool_t status;
 
-    if (MAP_CONTAINS(managerPtr->customerTablePtr, customerId)) {
+    if (MAP_CONTAINS(MANAGER_TABLE(managerPtr, customer, customerId), customerId)) {
         return FALSE;
     }
 
     customerPtr = CUSTOMER_ALLOC_SEQ(customerId);
     assert(customerPtr != NULL);
-    status = MAP_INSERT(managerPtr->customerTablePtr, customerId, customerPtr);
+    status = MAP_INSERT(MANAGER_TABLE(managerPtr, customer, customerId), customerId, customerPtr);
     assert(status);
 
+    SNAPSHOT_BILL_SEQ(managerPtr, customerId, 0);
+
     return TRUE;
 }
 
@@ -633,25 +1942,43 @@ bool_t
 manager_deleteCustomer (TM_ARGDECL  manager_t* managerPtr, long customerId)
 {
     customer_t* customerPtr;
-    MAP_T* reservationTables[NUM_RESERVATION_TYPE];
+    MAP_T* tablePtr;
+#ifdef CUSTOMER_INLINE_INFO
+    reservation_type_t type;
+    long id;
+    long i;
+#else
     list_t* reservationInfoListPtr;
     list_iter_t it;
+#endif
     bool_t rv;
 
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
     TM_LOG_BEGIN(MGR_DELCUSTOMER, NULL, managerPtr, customerId);
 #endif /* !ORIGINAL && MERGE_MANAGER */
-    customerPtr = (customer_t*)TMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)TMMAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     if (customerPtr == NULL) {
         rv = FALSE;
         goto out;
     }
 
-    reservationTables[RESERVATION_CAR] = managerPtr->carTablePtr;
-    reservationTables[RESERVATION_ROOM] = managerPtr->roomTablePtr;
-    reservationTables[RESERVATION_FLIGHT] = managerPtr->flightTablePtr;
-
     /* Cancel this customer's reservations */
+#ifdef CUSTOMER_INLINE_INFO
+    for (i = 0; CUSTOMER_GET_RESERVATION_INFO(customerPtr, i, &type, &id); i++) {
+        reservation_t* reservationPtr;
+        tablePtr = manager_getReservationTable(managerPtr, type, id);
+        reservationPtr = (reservation_t*)TMMAP_FIND(tablePtr, id);
+        if (reservationPtr == NULL) {
+            TM_RESTART();
+        }
+        rv = RESERVATION_CANCEL(reservationPtr);
+        if (rv == FALSE) {
+            TM_RESTART();
+        }
+        SNAPSHOT_RESERVATION(managerPtr, type, id);
+        DURABLE_RESERVATION(managerPtr, type, id);
+    }
+#else /* !CUSTOMER_INLINE_INFO */
     reservationInfoListPtr = customerPtr->reservationInfoListPtr;
     TMLIST_ITER_RESET(&it, reservationInfoListPtr);
     while (TMLIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
@@ -659,9 +1986,11 @@ manager_deleteCustomer (TM_ARGDECL  manager_t* managerPtr, long customerId)
         reservation_t* reservationPtr;
         reservationInfoPtr =
             (reservation_info_t*)TMLIST_ITER_NEXT(&it, reservationInfoListPtr);
+        tablePtr = manager_getReservationTable(managerPtr,
+                                               reservationInfoPtr->type,
+                                               reservationInfoPtr->id);
         reservationPtr =
-            (reservation_t*)TMMAP_FIND(reservationTables[reservationInfoPtr->type],
-                                     reservationInfoPtr->id);
+            (reservation_t*)TMMAP_FIND(tablePtr, reservationInfoPtr->id);
         if (reservationPtr == NULL) {
             TM_RESTART();
         }
@@ -669,14 +1998,23 @@ manager_deleteCustomer (TM_ARGDECL  manager_t* managerPtr, long customerId)
         if (rv == FALSE) {
             TM_RESTART();
         }
+        SNAPSHOT_RESERVATION(managerPtr,
+                             reservationInfoPtr->type,
+                             reservationInfoPtr->id);
+        DURABLE_RESERVATION(managerPtr,
+                            reservationInfoPtr->type,
+                            reservationInfoPtr->id);
         RESERVATION_INFO_FREE(reservationInfoPtr);
     }
+#endif /* !CUSTOMER_INLINE_INFO */
 
-    rv = TMMAP_REMOVE(managerPtr->customerTablePtr, customerId);
+    rv = TMMAP_REMOVE(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     if (rv == FALSE) {
         TM_RESTART();
     }
     CUSTOMER_FREE(customerPtr);
+    SNAPSHOT_BILL(managerPtr, customerId, SNAPSHOT_NONE);
+    DURABLE_CUSTOMER(managerPtr, customerId);
 
     rv = TRUE;
 out:
@@ -690,22 +2028,40 @@ bool_t
 HTMmanager_deleteCustomer (manager_t* managerPtr, long customerId)
 {
     customer_t* customerPtr;
-    MAP_T* reservationTables[NUM_RESERVATION_TYPE];
+    MAP_T* tablePtr;
+#ifdef CUSTOMER_INLINE_INFO
+    reservation_type_t type;
+    long id;
+    long i;
+#else
     list_t* reservationInfoListPtr;
     list_iter_t it;
+#endif
     bool_t rv;
 
-    customerPtr = (customer_t*)HTMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)HTMMAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     if (customerPtr == NULL) {
         rv = FALSE;
         goto out;
     }
 
-    reservationTables[RESERVATION_CAR] = managerPtr->carTablePtr;
-    reservationTables[RESERVATION_ROOM] = managerPtr->roomTablePtr;
-    reservationTables[RESERVATION_FLIGHT] = managerPtr->flightTablePtr;
-
     /* Cancel this customer's reservations */
+#ifdef CUSTOMER_INLINE_INFO
+    for (i = 0; HTMCUSTOMER_GET_RESERVATION_INFO(customerPtr, i, &type, &id); i++) {
+        reservation_t* reservationPtr;
+        tablePtr = manager_getReservationTable(managerPtr, type, id);
+        reservationPtr = (reservation_t*)HTMMAP_FIND(tablePtr, id);
+        if (reservationPtr == NULL) {
+            HTM_RESTART();
+        }
+        rv = HTMRESERVATION_CANCEL(reservationPtr);
+        if (rv == FALSE) {
+            HTM_RESTART();
+        }
+        HTMSNAPSHOT_RESERVATION(managerPtr, type, id);
+        HTMDURABLE_RESERVATION(managerPtr, type, id);
+    }
+#else /* !CUSTOMER_INLINE_INFO */
     reservationInfoListPtr = customerPtr->reservationInfoListPtr;
     HTMLIST_ITER_RESET(&it, reservationInfoListPtr);
     while (HTMLIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
@@ -713,9 +2069,11 @@ HTMmanager_deleteCustomer (manager_t* managerPtr, long customerId)
         reservation_t* reservationPtr;
         reservationInfoPtr =
             (reservation_info_t*)HTMLIST_ITER_NEXT(&it, reservationInfoListPtr);
+        tablePtr = manager_getReservationTable(managerPtr,
+                                               reservationInfoPtr->type,
+                                               reservationInfoPtr->id);
         reservationPtr =
-            (reservation_t*)HTMMAP_FIND(reservationTables[reservationInfoPtr->type],
-                                     reservationInfoPtr->id);
+            (reservation_t*)HTMMAP_FIND(tablePtr, reservationInfoPtr->id);
         if (reservationPtr == NULL) {
             HTM_RESTART();
         }
@@ -723,14 +2081,23 @@ HTMmanager_deleteCustomer (manager_t* managerPtr, long customerId)
         if (rv == FALSE) {
             HTM_RESTART();
         }
+        HTMSNAPSHOT_RESERVATION(managerPtr,
+                                reservationInfoPtr->type,
+                                reservationInfoPtr->id);
+        HTMDURABLE_RESERVATION(managerPtr,
+                               reservationInfoPtr->type,
+                               reservationInfoPtr->id);
         HTMRESERVATION_INFO_FREE(reservationInfoPtr);
     }
+#endif /* !CUSTOMER_INLINE_INFO */
 
-    rv = HTMMAP_REMOVE(managerPtr->customerTablePtr, customerId);
+    rv = HTMMAP_REMOVE(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     if (rv == FALSE) {
         HTM_RESTART();
     }
     HTMCUSTOMER_FREE(customerPtr);
+    HTMSNAPSHOT_BILL(managerPtr, customerId, SNAPSHOT_NONE);
+    HTMDURABLE_CUSTOMER(managerPtr, customerId);
 
     rv = TRUE;
 out:
@@ -741,22 +2108,35 @@ bool_t
 manager_deleteCustomer_seq (manager_t* managerPtr, long customerId)
 {
     customer_t* customerPtr;
-    MAP_T* reservationTables[NUM_RESERVATION_TYPE];
+    MAP_T* tablePtr;
+#ifdef CUSTOMER_INLINE_INFO
+    reservation_type_t type;
+    long id;
+    long i;
+#else
     list_t* reservationInfoListPtr;
     list_iter_t it;
+#endif
     bool_t rv;
 
-    customerPtr = (customer_t*)MAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)MAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     if (customerPtr == NULL) {
         rv = FALSE;
         goto out;
     }
 
-    reservationTables[RESERVATION_CAR] = managerPtr->carTablePtr;
-    reservationTables[RESERVATION_ROOM] = managerPtr->roomTablePtr;
-    reservationTables[RESERVATION_FLIGHT] = managerPtr->flightTablePtr;
-
     /* Cancel this customer's reservations */
+#ifdef CUSTOMER_INLINE_INFO
+    for (i = 0; CUSTOMER_GET_RESERVATION_INFO_SEQ(customerPtr, i, &type, &id); i++) {
+        reservation_t* reservationPtr;
+        tablePtr = manager_getReservationTable(managerPtr, type, id);
+        reservationPtr = (reservation_t*)MAP_FIND(tablePtr, id);
+        assert (reservationPtr != NULL);
+        rv = RESERVATION_CANCEL_SEQ(reservationPtr);
+        assert (rv != FALSE);
+        SNAPSHOT_RESERVATION_SEQ(managerPtr, type, id);
+    }
+#else /* !CUSTOMER_INLINE_INFO */
     reservationInfoListPtr = customerPtr->reservationInfoListPtr;
     LIST_ITER_RESET(&it, reservationInfoListPtr);
     while (LIST_ITER_HASNEXT(&it, reservationInfoListPtr)) {
@@ -764,18 +2144,25 @@ manager_deleteCustomer_seq (manager_t* managerPtr, long customerId)
         reservation_t* reservationPtr;
         reservationInfoPtr =
             (reservation_info_t*)LIST_ITER_NEXT(&it, reservationInfoListPtr);
+        tablePtr = manager_getReservationTable(managerPtr,
+                                               reservationInfoPtr->type,
+                                               reservationInfoPtr->id);
         reservationPtr =
-            (reservation_t*)MAP_FIND(reservationTables[reservationInfoPtr->type],
-                                     reservationInfoPtr->id);
+            (reservation_t*)MAP_FIND(tablePtr, reservationInfoPtr->id);
         assert (reservationPtr != NULL);
         rv = RESERVATION_CANCEL_SEQ(reservationPtr);
         assert (rv != FALSE);
+        SNAPSHOT_RESERVATION_SEQ(managerPtr,
+                                 reservationInfoPtr->type,
+                                 reservationInfoPtr->id);
         RESERVATION_INFO_FREE_SEQ(reservationInfoPtr);
     }
+#endif /* !CUSTOMER_INLINE_INFO */
 
-    rv = MAP_REMOVE(managerPtr->customerTablePtr, customerId);
+    rv = MAP_REMOVE(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
     assert (rv != FALSE);
     CUSTOMER_FREE_SEQ(customerPtr);
+    SNAPSHOT_BILL_SEQ(managerPtr, customerId, SNAPSHOT_NONE);
 
     rv = TRUE;
 out:
@@ -806,7 +2193,7 @@ queryNumFree (TM_ARGDECL  MAP_T* tablePtr, long id)
 #endif /* !ORIGINAL && MERGE_MANAGER */
     reservationPtr = (reservation_t*)TMMAP_FIND(tablePtr, id);
     if (reservationPtr != NULL) {
-        numFree = (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
+        numFree = RESERVATION_PEEK_NUM_FREE(reservationPtr);
     }
 #if !defined(ORIGINAL) && defined(MERGE_MANAGER)
     TM_LOG_END(MGR_QUERYFREE, &numFree);
@@ -909,19 +2296,19 @@ TM_CALLABLE
 long
 manager_queryCar (TM_ARGDECL  manager_t* managerPtr, long carId)
 {
-    return queryNumFree(TM_ARG  managerPtr->carTablePtr, carId);
+    return queryNumFree(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 long
 HTMmanager_queryCar (manager_t* managerPtr, long carId)
 {
-    return HTMqueryNumFree(managerPtr->carTablePtr, carId);
+    return HTMqueryNumFree(MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 long
 manager_queryCar_seq (TM_ARGDECL  manager_t* managerPtr, long carId)
 {
-    return queryNumFree_seq(TM_ARG  managerPtr->carTablePtr, carId);
+    return queryNumFree_seq(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 
@@ -935,19 +2322,19 @@ TM_CALLABLE
 long
 manager_queryCarPrice (TM_ARGDECL  manager_t* managerPtr, long carId)
 {
-    return queryPrice(TM_ARG  managerPtr->carTablePtr, carId);
+    return queryPrice(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 long
 HTMmanager_queryCarPrice (manager_t* managerPtr, long carId)
 {
-    return HTMqueryPrice(managerPtr->carTablePtr, carId);
+    return HTMqueryPrice(MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 long
 manager_queryCarPrice_seq (TM_ARGDECL  manager_t* managerPtr, long carId)
 {
-    return queryPrice_seq(TM_ARG  managerPtr->carTablePtr, carId);
+    return queryPrice_seq(TM_ARG  MANAGER_TABLE(managerPtr, car, carId), carId);
 }
 
 
@@ -961,19 +2348,19 @@ TM_CALLABLE
 long
 manager_queryRoom (TM_ARGDECL  manager_t* managerPtr, long roomId)
 {
-    return queryNumFree(TM_ARG  managerPtr->roomTablePtr, roomId);
+    return queryNumFree(TM_ARG  MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 long
 HTMmanager_queryRoom (manager_t* managerPtr, long roomId)
 {
-    return HTMqueryNumFree(managerPtr->roomTablePtr, roomId);
+    return HTMqueryNumFree(MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 long
 manager_queryRoom_seq (manager_t* managerPtr, long roomId)
 {
-    return queryNumFree_seq(managerPtr->roomTablePtr, roomId);
+    return queryNumFree_seq(MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 
@@ -987,19 +2374,19 @@ TM_CALLABLE
 long
 manager_queryRoomPrice (TM_ARGDECL  manager_t* managerPtr, long roomId)
 {
-    return queryPrice(TM_ARG  managerPtr->roomTablePtr, roomId);
+    return queryPrice(TM_ARG  MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 long
 HTMmanager_queryRoomPrice (manager_t* managerPtr, long roomId)
 {
-    return HTMqueryPrice(managerPtr->roomTablePtr, roomId);
+    return HTMqueryPrice(MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 long
 manager_queryRoomPrice_seq (manager_t* managerPtr, long roomId)
 {
-    return queryPrice_seq(managerPtr->roomTablePtr, roomId);
+    return queryPrice_seq(MANAGER_TABLE(managerPtr, room, roomId), roomId);
 }
 
 
@@ -1013,19 +2400,19 @@ TM_CALLABLE
 long
 manager_queryFlight (TM_ARGDECL  manager_t* managerPtr, long flightId)
 {
-    return queryNumFree(TM_ARG  managerPtr->flightTablePtr, flightId);
+    return queryNumFree(TM_ARG  MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 long
 HTMmanager_queryFlight (manager_t* managerPtr, long flightId)
 {
-    return HTMqueryNumFree(managerPtr->flightTablePtr, flightId);
+    return HTMqueryNumFree(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 long
 manager_queryFlight_seq (manager_t* managerPtr, long flightId)
 {
-    return queryNumFree_seq(managerPtr->flightTablePtr, flightId);
+    return queryNumFree_seq(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 
@@ -1039,19 +2426,19 @@ TM_CALLABLE
 long
 manager_queryFlightPrice (TM_ARGDECL  manager_t* managerPtr, long flightId)
 {
-    return queryPrice(TM_ARG  managerPtr->flightTablePtr, flightId);
+    return queryPrice(TM_ARG  MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 long
 HTMmanager_queryFlightPrice (manager_t* managerPtr, long flightId)
 {
-    return HTMqueryPrice(managerPtr->flightTablePtr, flightId);
+    return HTMqueryPrice(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 long
 manager_queryFlightPrice_seq (manager_t* managerPtr, long flightId)
 {
-    return queryPrice_seq(managerPtr->flightTablePtr, flightId);
+    return queryPrice_seq(MANAGER_TABLE(managerPtr, flight, flightId), flightId);
 }
 
 
@@ -1068,7 +2455,7 @@ manager_queryCustomerBill (TM_ARGDECL  manager_t* managerPtr, long customerId)
     long bill = -1;
     customer_t* customerPtr;
 
-    customerPtr = (customer_t*)TMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)TMMAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
 
     if (customerPtr != NULL) {
         bill = CUSTOMER_GET_BILL(customerPtr);
@@ -1083,7 +2470,7 @@ HTMmanager_queryCustomerBill (manager_t* managerPtr, long customerId)
     long bill = -1;
     customer_t* customerPtr;
 
-    customerPtr = (customer_t*)HTMMAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)HTMMAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
 
     if (customerPtr != NULL) {
         bill = HTMCUSTOMER_GET_BILL(customerPtr);
@@ -1098,7 +2485,7 @@ manager_queryCustomerBill_seq (manager_t* managerPtr, long customerId)
     long bill = -1;
     customer_t* customerPtr;
 
-    customerPtr = (customer_t*)MAP_FIND(managerPtr->customerTablePtr, customerId);
+    customerPtr = (customer_t*)MAP_FIND(MANAGER_TABLE(managerPtr, customer, customerId), customerId);
 
     if (customerPtr != NULL) {
         bill = CUSTOMER_GET_BILL_SEQ(customerPtr);
@@ -1273,33 +2660,55 @@ TM_CANCELLABLE
 bool_t
 manager_reserveCar (TM_ARGDECL  manager_t* managerPtr, long customerId, long carId)
 {
-    return reserve(TM_ARG
-                   managerPtr->carTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   carId,
-                   RESERVATION_CAR);
+    bool_t status = reserve(TM_ARG
+                            MANAGER_TABLE(managerPtr, car, carId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            carId,
+                            RESERVATION_CAR);
+
+    if (status) {
+        SNAPSHOT_RESERVE(managerPtr, RESERVATION_CAR, customerId, carId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_reserveCar (manager_t* managerPtr, long customerId, long carId)
 {
-    return HTMreserve(managerPtr->carTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   carId,
-                   RESERVATION_CAR);
+    bool_t status = HTMreserve(MANAGER_TABLE(managerPtr, car, carId),
+                               MANAGER_TABLE(managerPtr, customer, customerId),
+                               customerId,
+                               carId,
+                               RESERVATION_CAR);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVE(managerPtr, RESERVATION_CAR, customerId, carId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        HTMDURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_reserveCar_seq (manager_t* managerPtr, long customerId, long carId)
 {
-    return reserve_seq(
-                   managerPtr->carTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   carId,
-                   RESERVATION_CAR);
+    bool_t status = reserve_seq(
+                            MANAGER_TABLE(managerPtr, car, carId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            carId,
+                            RESERVATION_CAR);
+
+    if (status) {
+        SNAPSHOT_RESERVE_SEQ(managerPtr, RESERVATION_CAR, customerId, carId);
+    }
+
+    return status;
 }
 
 
@@ -1313,33 +2722,55 @@ TM_CANCELLABLE
 bool_t
 manager_reserveRoom (TM_ARGDECL  manager_t* managerPtr, long customerId, long roomId)
 {
-    return reserve(TM_ARG
-                   managerPtr->roomTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   roomId,
-                   RESERVATION_ROOM);
+    bool_t status = reserve(TM_ARG
+                            MANAGER_TABLE(managerPtr, room, roomId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            roomId,
+                            RESERVATION_ROOM);
+
+    if (status) {
+        SNAPSHOT_RESERVE(managerPtr, RESERVATION_ROOM, customerId, roomId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_reserveRoom (manager_t* managerPtr, long customerId, long roomId)
 {
-    return HTMreserve(managerPtr->roomTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   roomId,
-                   RESERVATION_ROOM);
+    bool_t status = HTMreserve(MANAGER_TABLE(managerPtr, room, roomId),
+                               MANAGER_TABLE(managerPtr, customer, customerId),
+                               customerId,
+                               roomId,
+                               RESERVATION_ROOM);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVE(managerPtr, RESERVATION_ROOM, customerId, roomId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        HTMDURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_reserveRoom_seq (manager_t* managerPtr, long customerId, long roomId)
 {
-    return reserve_seq(
-                   managerPtr->roomTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   roomId,
-                   RESERVATION_ROOM);
+    bool_t status = reserve_seq(
+                            MANAGER_TABLE(managerPtr, room, roomId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            roomId,
+                            RESERVATION_ROOM);
+
+    if (status) {
+        SNAPSHOT_RESERVE_SEQ(managerPtr, RESERVATION_ROOM, customerId, roomId);
+    }
+
+    return status;
 }
 /* =============================================================================
  * manager_reserveFlight
@@ -1352,33 +2783,55 @@ bool_t
 manager_reserveFlight (TM_ARGDECL
                        manager_t* managerPtr, long customerId, long flightId)
 {
-    return reserve(TM_ARG
-                   managerPtr->flightTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   flightId,
-                   RESERVATION_FLIGHT);
+    bool_t status = reserve(TM_ARG
+                            MANAGER_TABLE(managerPtr, flight, flightId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            flightId,
+                            RESERVATION_FLIGHT);
+
+    if (status) {
+        SNAPSHOT_RESERVE(managerPtr, RESERVATION_FLIGHT, customerId, flightId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 HTMmanager_reserveFlight (manager_t* managerPtr, long customerId, long flightId)
 {
-    return HTMreserve(managerPtr->flightTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   flightId,
-                   RESERVATION_FLIGHT);
+    bool_t status = HTMreserve(MANAGER_TABLE(managerPtr, flight, flightId),
+                               MANAGER_TABLE(managerPtr, customer, customerId),
+                               customerId,
+                               flightId,
+                               RESERVATION_FLIGHT);
+
+    if (status) {
+        HTMSNAPSHOT_RESERVE(managerPtr, RESERVATION_FLIGHT, customerId, flightId);
+        HTMDURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        HTMDURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 bool_t
 manager_reserveFlight_seq (manager_t* managerPtr, long customerId, long flightId)
 {
-    return reserve_seq(
-                   managerPtr->flightTablePtr,
-                   managerPtr->customerTablePtr,
-                   customerId,
-                   flightId,
-                   RESERVATION_FLIGHT);
+    bool_t status = reserve_seq(
+                            MANAGER_TABLE(managerPtr, flight, flightId),
+                            MANAGER_TABLE(managerPtr, customer, customerId),
+                            customerId,
+                            flightId,
+                            RESERVATION_FLIGHT);
+
+    if (status) {
+        SNAPSHOT_RESERVE_SEQ(managerPtr, RESERVATION_FLIGHT, customerId, flightId);
+    }
+
+    return status;
 }
 
 
@@ -1447,12 +2900,23 @@ TM_CANCELLABLE
 bool_t
 manager_cancelCar (TM_ARGDECL  manager_t* managerPtr, long customerId, long carId)
 {
-    return cancel(TM_ARG
-                  managerPtr->carTablePtr,
-                  managerPtr->customerTablePtr,
-                  customerId,
-                  carId,
-                  RESERVATION_CAR);
+    bool_t status = cancel(TM_ARG
+                           MANAGER_TABLE(managerPtr, car, carId),
+                           MANAGER_TABLE(managerPtr, customer, customerId),
+                           customerId,
+                           carId,
+                           RESERVATION_CAR);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_CAR, carId);
+        SNAPSHOT_BILL(managerPtr,
+                      customerId,
+                      manager_queryCustomerBill(TM_ARG  managerPtr, customerId));
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 
@@ -1466,12 +2930,23 @@ TM_CANCELLABLE
 bool_t
 manager_cancelRoom (TM_ARGDECL  manager_t* managerPtr, long customerId, long roomId)
 {
-    return cancel(TM_ARG
-                  managerPtr->roomTablePtr,
-                  managerPtr->customerTablePtr,
-                  customerId,
-                  roomId,
-                  RESERVATION_ROOM);
+    bool_t status = cancel(TM_ARG
+                           MANAGER_TABLE(managerPtr, room, roomId),
+                           MANAGER_TABLE(managerPtr, customer, customerId),
+                           customerId,
+                           roomId,
+                           RESERVATION_ROOM);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_ROOM, roomId);
+        SNAPSHOT_BILL(managerPtr,
+                      customerId,
+                      manager_queryCustomerBill(TM_ARG  managerPtr, customerId));
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 
@@ -1487,12 +2962,23 @@ bool_t
 manager_cancelFlight (TM_ARGDECL
                       manager_t* managerPtr, long customerId, long flightId)
 {
-    return cancel(TM_ARG
-                  managerPtr->flightTablePtr,
-                  managerPtr->customerTablePtr,
-                  customerId,
-                  flightId,
-                  RESERVATION_FLIGHT);
+    bool_t status = cancel(TM_ARG
+                           MANAGER_TABLE(managerPtr, flight, flightId),
+                           MANAGER_TABLE(managerPtr, customer, customerId),
+                           customerId,
+                           flightId,
+                           RESERVATION_FLIGHT);
+
+    if (status) {
+        SNAPSHOT_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        DURABLE_RESERVATION(managerPtr, RESERVATION_FLIGHT, flightId);
+        SNAPSHOT_BILL(managerPtr,
+                      customerId,
+                      manager_queryCustomerBill(TM_ARG  managerPtr, customerId));
+        DURABLE_CUSTOMER(managerPtr, customerId);
+    }
+
+    return status;
 }
 
 
@@ -1770,6 +3256,11 @@ stm_merge_t TMmanager_merge(stm_merge_context_t *params) {
                 ASSERT(prev_reservation);
 
                 ASSERT(prev_reservation != reservationPtr);
+#  ifdef RESERVATION_ESCROW
+                /* numFree was read outside the transaction */
+                old = params->rv.sint;
+                new = (reservationPtr ? RESERVATION_PEEK_NUM_FREE(reservationPtr) : -1);
+#  else
                 if (prev_reservation) {
                     r = TM_SHARED_DID_READ(prev_reservation->numFree);
                     ASSERT(STM_VALID_READ(r));
@@ -1784,6 +3275,7 @@ stm_merge_t TMmanager_merge(stm_merge_context_t *params) {
                     new = (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
                 } else
                     new = -1;
+#  endif /* !RESERVATION_ESCROW */
 # endif /* MERGE_RBTREE */
             }
 
@@ -1872,7 +3364,7 @@ stm_merge_t TMmanager_merge(stm_merge_context_t *params) {
                 printf("\nMGR_RESERVE addr:%p tablePtr:%p customerTablePtr:%p customerId:%ld id:%ld type:%d\n", params->addr, tablePtr, customerTablePtr, customerId, id, type);
 # endif
             } else {
-# ifdef MERGE_LIST
+# if defined(MERGE_LIST) && !defined(CUSTOMER_INLINE_INFO)
                 extern const stm_op_id_t LIST_INSERT;
                 const stm_op_id_t prev = stm_get_op_opcode(params->previous);
 
@@ -1899,7 +3391,7 @@ stm_merge_t TMmanager_merge(stm_merge_context_t *params) {
                         return STM_MERGE_OK;
                     }
                 }
-# endif /* MERGE_LIST */
+# endif /* MERGE_LIST && !CUSTOMER_INLINE_INFO */
             }
         } else {
             ASSERT(params->rv.sint == TRUE || params->rv.sint == FALSE);
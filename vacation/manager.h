@@ -75,23 +75,246 @@
 
 
 #include "map.h"
+#include "redolog.h"
+#include "reservation.h"
 #include "tm.h"
 #include "types.h"
 
+/*
+ * With -DMANAGER_SHARDED each table is split into numShard independent maps
+ * by a hash of the id, so transactions on different ids mostly walk
+ * different roots. MANAGER_TABLE(mgr, car, id) names the map holding 'id'.
+ */
 typedef struct manager {
+#ifdef MANAGER_SHARDED
+    long numShard;
+    MAP_T** carTables;
+    MAP_T** roomTables;
+    MAP_T** flightTables;
+    MAP_T** customerTables;
+#else
     MAP_T* carTablePtr;
     MAP_T* roomTablePtr;
     MAP_T* flightTablePtr;
     MAP_T* customerTablePtr;
+#endif
+#ifdef MANAGER_SNAPSHOT
+    long maxSnapshotId;
+    long* snapshots[NUM_RESERVATION_TYPE];
+    long* billSnapshots;
+#endif
+#ifdef MANAGER_DURABLE
+    redolog_t* logPtr;
+    long maxDurableId;
+    long* versions[NUM_RESERVATION_TYPE + 1]; /* the last is for customers */
+    long numRedo;
+    struct manager_redo* redos;
+#endif
 } manager_t;
 
+#ifdef MANAGER_SHARDED
+#  define MANAGER_SHARD(mgr, id) \
+    ((long)((((unsigned long)(id) * 0x9e3779b97f4a7c15UL) >> 32) % \
+            (unsigned long)(mgr)->numShard))
+#  define MANAGER_TABLE(mgr, table, id) \
+    ((mgr)->table##Tables[MANAGER_SHARD(mgr, id)])
+#else
+#  define MANAGER_TABLE(mgr, table, id)  ((mgr)->table##TablePtr)
+#endif
+
+/*
+ * With -DMANAGER_SNAPSHOT every write transaction also publishes, in one word
+ * per id, the numFree and price of each reservation it touches and the bill
+ * of each customer it touches. The words are updated in the same transaction
+ * as the tables, so a single word always holds a committed state, and
+ * queries read them with a plain load: no read set, no validation and no
+ * aborts of their own. Each word is its own snapshot: there is no epoch
+ * shared across ids, so a query over several ids may combine states from
+ * different commits, i.e. a set of values that never coexisted. The client
+ * accepts this: it uses such queries only to pick candidates, and
+ * manager_reserve* re-checks availability in the transaction that reserves,
+ * so a stale pick costs at most a missed or less than best reservation,
+ * never an inconsistent table. A global sequence number read around the
+ * query would make it atomic, but every writer would then write the same
+ * line and conflict with every other writer.
+ *
+ * Each word has a cache line to itself, so writers of different ids do not
+ * conflict over the words, at 64 bytes per id and table. With HTM, a query
+ * that loads the word of an id that a running hardware transaction has
+ * written still aborts that transaction, as the line is in its write set; a
+ * software writer is never aborted by a query.
+ */
+
+/*
+ * With -DMANAGER_DURABLE every write transaction also records, in a per-thread
+ * redo buffer, the image of each reservation and customer it touches along
+ * with a per-id version bumped in the same transaction (one cache line per
+ * version, so writers of different ids do not conflict over them). After the
+ * commit the client appends the buffer to its log and waits for the group
+ * commit (see redolog.h). Recovery loads the last checkpoint and applies each
+ * logged image whose version is newer than what the tables hold, so images of
+ * one epoch may be replayed in any order.
+ *
+ * A client wraps each transaction as
+ *
+ *   MANAGER_REDO_ENTER(mgr);
+ *   TM_BEGIN(); MANAGER_REDO_BEGIN(mgr); ... MANAGER_REDO_END(mgr); TM_END();
+ *   MANAGER_REDO_COMMIT(mgr);
+ *
+ * and the macros expand to nothing in other builds.
+ */
+
 
 /* =============================================================================
  * manager_alloc
  * =============================================================================
  */
+#ifdef MANAGER_SHARDED
+manager_t*
+manager_alloc (long numShard);
+#else
 manager_t*
 manager_alloc ();
+#endif
+
+
+#ifdef MANAGER_SNAPSHOT
+/* =============================================================================
+ * manager_enableSnapshots_seq
+ * -- Publishes the current tables for ids 0..maxId; later writes keep the
+ *    words current. Ids beyond maxId are not tracked.
+ * -- Call once after loading, before any client starts
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_enableSnapshots_seq (manager_t* managerPtr, long maxId);
+
+
+/* =============================================================================
+ * manager_snapshotQuery
+ * -- Returns the number of free units of reservation (type, id) and stores
+ *    its price in *pricePtr, from one committed state
+ * -- Returns -1 if the reservation does not exist or is not tracked
+ * -- Safe outside a transaction
+ * -- Two calls may see two different committed states
+ * =============================================================================
+ */
+long
+manager_snapshotQuery (manager_t* managerPtr, long type, long id, long* pricePtr);
+
+
+/* =============================================================================
+ * manager_snapshotQueryCustomerBill
+ * -- Returns the bill of a committed state of the customer
+ * -- Returns -1 if the customer does not exist or is not tracked
+ * -- Safe outside a transaction
+ * =============================================================================
+ */
+long
+manager_snapshotQueryCustomerBill (manager_t* managerPtr, long customerId);
+#endif /* MANAGER_SNAPSHOT */
+
+
+#ifdef MANAGER_DURABLE
+/* =============================================================================
+ * manager_enableDurable_seq
+ * -- Keeps versions for ids 0..maxId and a redo buffer for each of
+ *    'numThread' clients; ids beyond maxId must not be written
+ * -- Call once on an empty manager, before recovering or loading it
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_enableDurable_seq (manager_t* managerPtr, redolog_t* logPtr,
+                           long maxId, long numThread);
+
+
+/* =============================================================================
+ * manager_recoverDurable_seq
+ * -- Rebuilds the empty tables from the checkpoint and logs
+ * -- Returns the number of log records applied, or -1 on failure
+ * =============================================================================
+ */
+long
+manager_recoverDurable_seq (manager_t* managerPtr);
+
+
+/* =============================================================================
+ * manager_startDurable_seq
+ * -- Checkpoints the tables and starts a log per client
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_startDurable_seq (manager_t* managerPtr);
+
+
+/* =============================================================================
+ * manager_enterRedo
+ * -- Binds the calling client's redo buffer; before the transaction
+ * =============================================================================
+ */
+void
+manager_enterRedo (manager_t* managerPtr);
+
+
+/* =============================================================================
+ * manager_beginRedo
+ * -- Empties the redo buffer; first thing in the transaction
+ * =============================================================================
+ */
+TM_PURE
+void
+manager_beginRedo (manager_t* managerPtr);
+
+
+/* =============================================================================
+ * manager_endRedo
+ * -- Reads the epoch if anything was written; last thing in the transaction
+ * =============================================================================
+ */
+TM_CALLABLE
+void
+manager_endRedo (TM_ARGDECL  manager_t* managerPtr);
+
+void
+HTMmanager_endRedo (manager_t* managerPtr);
+
+
+/* =============================================================================
+ * manager_commitRedo
+ * -- Logs the redo buffer and waits until it is durable; after the commit
+ * =============================================================================
+ */
+void
+manager_commitRedo (manager_t* managerPtr);
+
+#  define MANAGER_REDO_ENTER(mgr)       manager_enterRedo(mgr)
+#  define MANAGER_REDO_BEGIN(mgr)       manager_beginRedo(mgr)
+#  define MANAGER_REDO_END(mgr)         manager_endRedo(TM_ARG  mgr)
+#  define HTMMANAGER_REDO_END(mgr)      HTMmanager_endRedo(mgr)
+#  define MANAGER_REDO_COMMIT(mgr)      manager_commitRedo(mgr)
+
+#else /* !MANAGER_DURABLE */
+
+#  define MANAGER_REDO_ENTER(mgr)       /* nothing */
+#  define MANAGER_REDO_BEGIN(mgr)       /* nothing */
+#  define MANAGER_REDO_END(mgr)         /* nothing */
+#  define HTMMANAGER_REDO_END(mgr)      /* nothing */
+#  define MANAGER_REDO_COMMIT(mgr)      /* nothing */
+
+#endif /* !MANAGER_DURABLE */
+
+
+/* =============================================================================
+ * manager_getReservationTable
+ * -- Returns the map holding 'id' for a reservation_type_t 'type'
+ * =============================================================================
+ */
+TM_PURE
+MAP_T*
+manager_getReservationTable (manager_t* managerPtr, long type, long id);
 
 
 /* =============================================================================
@@ -102,6 +325,50 @@ void
 manager_free (manager_t* managerPtr);
 
 
+/* =============================================================================
+ * manager_loadCars_seq
+ * -- Fills the empty car table with ids 1..numId, where id i has nums[i-1]
+ *    cars at prices[i-1]
+ * -- Tables are built in one pass; used for bulk loading at startup
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadCars_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices);
+
+
+/* =============================================================================
+ * manager_loadFlights_seq
+ * -- Fills the empty flight table with ids 1..numId, where id i has nums[i-1]
+ *    seats at prices[i-1]
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadFlights_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices);
+
+
+/* =============================================================================
+ * manager_loadRooms_seq
+ * -- Fills the empty room table with ids 1..numId, where id i has nums[i-1]
+ *    rooms at prices[i-1]
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadRooms_seq (manager_t* managerPtr, long numId, const long* nums, const long* prices);
+
+
+/* =============================================================================
+ * manager_loadCustomers_seq
+ * -- Fills the empty customer table with ids 1..numId
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+bool_t
+manager_loadCustomers_seq (manager_t* managerPtr, long numId);
+
+
 /* =============================================================================
  * ADMINISTRATIVE INTERFACE
  * =============================================================================
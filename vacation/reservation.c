@@ -92,6 +92,223 @@ TM_CANCELLABLE
 static void
 checkReservation (TM_ARGDECL  reservation_t* reservationPtr);
 
+
+#ifdef RESERVATION_ESCROW
+/* =============================================================================
+ * ESCROW
+ * -- Each thread lists the escrow changes of its running transaction: a
+ *    negative 'num' was taken already, a positive one is returned on commit
+ * -- Counters of reservations allocated by the running attempt are listed as
+ *    fresh and changed transactionally instead: if the attempt aborts, the
+ *    allocation is undone and there is no counter left to return seats to
+ * -- Hardware transactions change the counters directly, as their atomic
+ *    operations are rolled back with them
+ * =============================================================================
+ */
+
+typedef struct escrow {
+    long* counterPtr;
+    long num;
+    bool_t isFresh;
+} escrow_t;
+
+static __thread escrow_t* global_escrows = NULL;
+static __thread long global_numEscrow = 0;
+static __thread long global_escrowCapacity = 0;
+
+
+/* =============================================================================
+ * escrowRecord
+ * =============================================================================
+ */
+TM_PURE
+static void
+escrowRecord (long* counterPtr, long num, bool_t isFresh)
+{
+    if (global_numEscrow == global_escrowCapacity) {
+        long capacity = ((global_escrowCapacity > 0) ?
+                         (2 * global_escrowCapacity) : 16);
+        escrow_t* escrows =
+            (escrow_t*)realloc(global_escrows, capacity * sizeof(escrow_t));
+        assert(escrows != NULL);
+        global_escrows = escrows;
+        global_escrowCapacity = capacity;
+    }
+    global_escrows[global_numEscrow].counterPtr = counterPtr;
+    global_escrows[global_numEscrow].num = num;
+    global_escrows[global_numEscrow].isFresh = isFresh;
+    global_numEscrow++;
+}
+
+
+/* =============================================================================
+ * escrowIsFresh
+ * -- Returns TRUE if the running attempt allocated the counter
+ * =============================================================================
+ */
+TM_PURE
+static bool_t
+escrowIsFresh (long* counterPtr)
+{
+    long i;
+
+    for (i = 0; i < global_numEscrow; i++) {
+        if (global_escrows[i].isFresh &&
+            global_escrows[i].counterPtr == counterPtr)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+
+/* =============================================================================
+ * escrowTake
+ * -- Subtracts 'num' if the counter holds at least that much
+ * -- Returns TRUE on success, else FALSE
+ * =============================================================================
+ */
+static inline bool_t
+escrowTake (long* counterPtr, long num)
+{
+    long value = __atomic_load_n(counterPtr, __ATOMIC_RELAXED);
+
+    do {
+        if (value < num) {
+            return FALSE;
+        }
+    } while (!__atomic_compare_exchange_n(counterPtr, &value, (value - num),
+                                          TRUE, __ATOMIC_ACQ_REL,
+                                          __ATOMIC_RELAXED));
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * reservation_escrowBegin
+ * -- Returns the seats taken by an aborted attempt and drops the seats it
+ *    would have returned; first thing in the transaction
+ * =============================================================================
+ */
+TM_PURE
+void
+reservation_escrowBegin ()
+{
+    long i;
+
+    for (i = 0; i < global_numEscrow; i++) {
+        if (global_escrows[i].num < 0) {
+            __atomic_fetch_add(global_escrows[i].counterPtr,
+                               -global_escrows[i].num, __ATOMIC_RELEASE);
+        }
+    }
+    global_numEscrow = 0;
+}
+
+
+/* =============================================================================
+ * reservation_escrowCommit
+ * -- Keeps the seats taken and returns the seats freed; after the commit
+ * =============================================================================
+ */
+void
+reservation_escrowCommit ()
+{
+    long i;
+
+    for (i = 0; i < global_numEscrow; i++) {
+        if (global_escrows[i].num > 0) {
+            __atomic_fetch_add(global_escrows[i].counterPtr,
+                               global_escrows[i].num, __ATOMIC_RELEASE);
+        }
+    }
+    global_numEscrow = 0;
+}
+
+
+/* =============================================================================
+ * reservation_escrowExit
+ * -- Frees the calling thread's escrow buffer
+ * =============================================================================
+ */
+void
+reservation_escrowExit ()
+{
+    assert(global_numEscrow == 0);
+    free(global_escrows);
+    global_escrows = NULL;
+    global_escrowCapacity = 0;
+}
+
+
+/* =============================================================================
+ * escrowTakeRecorded
+ * -- escrowTake in a software transaction; returned if it aborts
+ * =============================================================================
+ */
+TM_PURE
+static bool_t
+escrowTakeRecorded (long* counterPtr, long num)
+{
+    if (!escrowTake(counterPtr, num)) {
+        return FALSE;
+    }
+    escrowRecord(counterPtr, -num, FALSE);
+
+    return TRUE;
+}
+
+
+/* =============================================================================
+ * TMescrowTake
+ * =============================================================================
+ */
+TM_CANCELLABLE
+static bool_t
+TMescrowTake (TM_ARGDECL  reservation_t* reservationPtr, long num)
+{
+    if (escrowIsFresh(&reservationPtr->numFree)) {
+        long numFree =
+            (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
+        if (numFree < num) {
+            return FALSE;
+        }
+        TM_SHARED_WRITE(reservationPtr->numFree, (numFree - num));
+        return TRUE;
+    }
+
+    return escrowTakeRecorded(&reservationPtr->numFree, num);
+}
+
+
+/* =============================================================================
+ * TMescrowGive
+ * =============================================================================
+ */
+TM_CANCELLABLE
+static void
+TMescrowGive (TM_ARGDECL  reservation_t* reservationPtr, long num)
+{
+    if (escrowIsFresh(&reservationPtr->numFree)) {
+        TM_SHARED_WRITE(reservationPtr->numFree,
+                        ((long)TM_SHARED_READ_TAG(reservationPtr->numFree,
+                                                  reservationPtr) + num));
+    } else if (num > 0) {
+        escrowRecord(&reservationPtr->numFree, num, FALSE);
+    }
+}
+
+#  define ESCROW_TAKE(r, num)       TMescrowTake(TM_ARG  r, num)
+#  define ESCROW_GIVE(r, num)       TMescrowGive(TM_ARG  r, num)
+#  define HTMESCROW_TAKE(r, num)    escrowTake(&(r)->numFree, num)
+#  define HTMESCROW_GIVE(r, num) \
+    __atomic_fetch_add(&(r)->numFree, num, __ATOMIC_RELEASE)
+#endif /* RESERVATION_ESCROW */
+
+
 /* =============================================================================
  * reservation_info_alloc
  * -- Returns NULL on failure
@@ -201,6 +418,12 @@ checkReservation (TM_ARGDECL  reservation_t* reservationPtr)
         TM_RESTART();
     }
 
+#ifdef RESERVATION_ESCROW
+    long numTotal = (long)TM_SHARED_READ_TAG(reservationPtr->numTotal, reservationPtr);
+    if (numUsed > numTotal) {
+        TM_RESTART(); /* numFree is only exact without transactions */
+    }
+#else
     long numFree = (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
     if (numFree < 0) {
         TM_RESTART();
@@ -214,6 +437,7 @@ checkReservation (TM_ARGDECL  reservation_t* reservationPtr)
     if ((numUsed + numFree) != numTotal) {
         TM_RESTART();
     }
+#endif
 
     long price = (long)TM_SHARED_READ_TAG(reservationPtr->price, reservationPtr);
     if (price < 0) {
@@ -236,6 +460,12 @@ HTMcheckReservation (reservation_t* reservationPtr)
         HTM_RESTART();
     }
 
+#ifdef RESERVATION_ESCROW
+    long numTotal = (long)HTM_SHARED_READ(reservationPtr->numTotal);
+    if (numUsed > numTotal) {
+        HTM_RESTART();
+    }
+#else
     long numFree = (long)HTM_SHARED_READ(reservationPtr->numFree);
     if (numFree < 0) {
         HTM_RESTART();
@@ -249,6 +479,7 @@ HTMcheckReservation (reservation_t* reservationPtr)
     if ((numUsed + numFree) != numTotal) {
         HTM_RESTART();
     }
+#endif
 
     long price = (long)HTM_SHARED_READ(reservationPtr->price);
     if (price < 0) {
@@ -289,6 +520,9 @@ reservation_alloc (TM_ARGDECL  long id, long numTotal, long price)
         reservationPtr->numFree = numTotal;
         reservationPtr->numTotal = numTotal;
         reservationPtr->price = price;
+#ifdef RESERVATION_ESCROW
+        escrowRecord(&reservationPtr->numFree, 0, TRUE);
+#endif
         CHECK_RESERVATION(reservationPtr);
     }
 
@@ -344,6 +578,15 @@ TM_CANCELLABLE
 bool_t
 reservation_addToTotal (TM_ARGDECL  reservation_t* reservationPtr, long num)
 {
+#ifdef RESERVATION_ESCROW
+    if (num < 0) {
+        if (!ESCROW_TAKE(reservationPtr, -num)) {
+            return FALSE;
+        }
+    } else {
+        ESCROW_GIVE(reservationPtr, num);
+    }
+#else
     long numFree = (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
 
     if (numFree + num < 0) {
@@ -351,6 +594,7 @@ reservation_addToTotal (TM_ARGDECL  reservation_t* reservationPtr, long num)
     }
 
     TM_SHARED_WRITE(reservationPtr->numFree, (numFree + num));
+#endif
     TM_SHARED_WRITE(reservationPtr->numTotal,
                     ((long)TM_SHARED_READ_TAG(reservationPtr->numTotal, reservationPtr) + num));
 
@@ -363,6 +607,15 @@ reservation_addToTotal (TM_ARGDECL  reservation_t* reservationPtr, long num)
 bool_t
 HTMreservation_addToTotal (reservation_t* reservationPtr, long num)
 {
+#ifdef RESERVATION_ESCROW
+    if (num < 0) {
+        if (!HTMESCROW_TAKE(reservationPtr, -num)) {
+            return FALSE;
+        }
+    } else {
+        HTMESCROW_GIVE(reservationPtr, num);
+    }
+#else
     long numFree = (long)HTM_SHARED_READ(reservationPtr->numFree);
 
     if (numFree + num < 0) {
@@ -370,6 +623,7 @@ HTMreservation_addToTotal (reservation_t* reservationPtr, long num)
     }
 
     HTM_SHARED_WRITE(reservationPtr->numFree, (numFree + num));
+#endif
     HTM_SHARED_WRITE(reservationPtr->numTotal,
                     ((long)HTM_SHARED_READ(reservationPtr->numTotal) + num));
 
@@ -409,6 +663,14 @@ reservation_make (TM_ARGDECL  reservation_t* reservationPtr)
 #if !defined(ORIGINAL) && defined(MERGE_RESERVATION)
     TM_LOG_BEGIN(RSV_MAKE, NULL, reservationPtr);
 #endif /* !ORIGINAL && MERGE_RESERVATION */
+#ifdef RESERVATION_ESCROW
+    if (!ESCROW_TAKE(reservationPtr, 1)) {
+        rv = FALSE;
+        goto out;
+    }
+    TM_SHARED_WRITE(reservationPtr->numUsed,
+                    ((long)TM_SHARED_READ_TAG(reservationPtr->numUsed, reservationPtr) + 1));
+#else
     long numFree = (long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr);
 
     if (numFree < 1) {
@@ -418,6 +680,7 @@ reservation_make (TM_ARGDECL  reservation_t* reservationPtr)
     TM_SHARED_WRITE(reservationPtr->numUsed,
                     ((long)TM_SHARED_READ_TAG(reservationPtr->numUsed, reservationPtr) + 1));
     TM_SHARED_WRITE(reservationPtr->numFree, (numFree - 1));
+#endif
 
     CHECK_RESERVATION(reservationPtr);
 
@@ -435,6 +698,14 @@ HTMreservation_make (reservation_t* reservationPtr)
 {
     bool_t rv;
 
+#ifdef RESERVATION_ESCROW
+    if (!HTMESCROW_TAKE(reservationPtr, 1)) {
+        rv = FALSE;
+        goto out;
+    }
+    HTM_SHARED_WRITE(reservationPtr->numUsed,
+                    ((long)HTM_SHARED_READ(reservationPtr->numUsed) + 1));
+#else
     long numFree = (long)HTM_SHARED_READ(reservationPtr->numFree);
 
     if (numFree < 1) {
@@ -444,6 +715,7 @@ HTMreservation_make (reservation_t* reservationPtr)
     HTM_SHARED_WRITE(reservationPtr->numUsed,
                     ((long)HTM_SHARED_READ(reservationPtr->numUsed) + 1));
     HTM_SHARED_WRITE(reservationPtr->numFree, (numFree - 1));
+#endif
 
     HTMCHECK_RESERVATION(reservationPtr);
 
@@ -491,8 +763,12 @@ reservation_cancel (TM_ARGDECL  reservation_t* reservationPtr)
     }
 
     TM_SHARED_WRITE(reservationPtr->numUsed, (numUsed - 1));
+#ifdef RESERVATION_ESCROW
+    ESCROW_GIVE(reservationPtr, 1);
+#else
     TM_SHARED_WRITE(reservationPtr->numFree,
                     ((long)TM_SHARED_READ_TAG(reservationPtr->numFree, reservationPtr) + 1));
+#endif
 
     CHECK_RESERVATION(reservationPtr);
 
@@ -518,8 +794,12 @@ HTMreservation_cancel (reservation_t* reservationPtr)
     }
 
     HTM_SHARED_WRITE(reservationPtr->numUsed, (numUsed - 1));
+#ifdef RESERVATION_ESCROW
+    HTMESCROW_GIVE(reservationPtr, 1);
+#else
     HTM_SHARED_WRITE(reservationPtr->numFree,
                     ((long)TM_SHARED_READ(reservationPtr->numFree) + 1));
+#endif
 
     HTMCHECK_RESERVATION(reservationPtr);
 
@@ -725,6 +1005,59 @@ main ()
     reservation_free(reservation2Ptr);
     reservation_free(reservation3Ptr);
 
+#ifdef RESERVATION_ESCROW
+    /* Aborts are simulated by undoing the attempt's transactional writes */
+    long i;
+
+    /* Seats taken by an aborted attempt are returned when it begins again */
+    reservation1Ptr = reservation_alloc_seq(1, 10, 5);
+    reservation_escrowBegin();
+    assert(reservation_addToTotal(reservation1Ptr, -3));
+    assert(reservation1Ptr->numFree == 7);
+    reservation1Ptr->numTotal = 10;
+    reservation_escrowBegin();
+    assert(reservation1Ptr->numFree == 10);
+
+    /* Seats taken are kept on commit, seats freed are returned then */
+    assert(reservation_make(reservation1Ptr));
+    reservation_escrowCommit();
+    assert(reservation1Ptr->numFree == 9);
+    reservation_escrowBegin();
+    assert(reservation_cancel(reservation1Ptr));
+    assert(reservation1Ptr->numFree == 9);
+    reservation_escrowCommit();
+    assert(reservation1Ptr->numFree == 10);
+    checkReservation_seq(reservation1Ptr);
+
+    /*
+     * Seats taken from a reservation allocated by the attempt are not held
+     * in escrow: the abort frees it, and the next begin must not touch it
+     */
+    reservation_escrowBegin();
+    reservation2Ptr = reservation_alloc(2, 10, 5);
+    assert(reservation_addToTotal(reservation2Ptr, -4));
+    assert(reservation_make(reservation2Ptr));
+    assert(reservation2Ptr->numFree == 5);
+    for (i = 0; i < global_numEscrow; i++) {
+        assert(global_escrows[i].num == 0);
+    }
+    reservation_free(reservation2Ptr);
+    reservation_escrowBegin();
+    assert(global_numEscrow == 0);
+
+    /* Nor are seats returned to it, so a commit does not add them again */
+    reservation3Ptr = reservation_alloc(3, 10, 5);
+    assert(reservation_addToTotal(reservation3Ptr, 5));
+    assert(reservation3Ptr->numFree == 15);
+    reservation_escrowCommit();
+    assert(reservation3Ptr->numFree == 15);
+    checkReservation_seq(reservation3Ptr);
+
+    reservation_free(reservation1Ptr);
+    reservation_free(reservation3Ptr);
+    reservation_escrowExit();
+#endif /* RESERVATION_ESCROW */
+
     puts("All tests passed.");
 
     return 0;
@@ -90,12 +90,43 @@ typedef struct reservation_info {
     long price; /* holds price at time reservation was made */
 } reservation_info_t;
 
+/*
+ * With RESERVATION_SPLIT, numUsed and numFree each get a cache line of their
+ * own, apart from the fields that queries read (price) and that only table
+ * updates write (numTotal). 64 bytes of padding between the groups keep them
+ * on different lines whatever the alignment of the allocation, at the cost of
+ * 168 bytes instead of 40 per reservation.
+ *
+ * With RESERVATION_ESCROW, numFree is an escrow counter that transactions
+ * change with atomic operations instead of transactional accesses: taking
+ * seats is a single decrement-if-enough, and seats returned by a transaction
+ * are added after it commits. The seats that a transaction has taken count as
+ * held until it commits; if it aborts instead, they are returned when it
+ * begins again. So numFree never exceeds numTotal - numUsed, and equals it
+ * when no transaction is running. A reservation allocated by the running
+ * transaction is invisible to the others until it commits, and is gone if it
+ * aborts, so its numFree is changed transactionally instead. Transactions
+ * that need the committed free count read RESERVATION_READ_NUM_FREE.
+ */
+#ifdef RESERVATION_SPLIT
+#  define RESERVATION_PAD_SIZE          (64)
+#endif
+
 typedef struct reservation {
     long id;
+#ifdef RESERVATION_SPLIT
+    long numTotal;
+    long price;
+    char pad1[RESERVATION_PAD_SIZE];
+    long numUsed;
+    char pad2[RESERVATION_PAD_SIZE];
+    long numFree;
+#else
     long numUsed;
     long numFree;
     long numTotal;
     long price;
+#endif
 } reservation_t;
 
 
@@ -253,6 +284,59 @@ void
 reservation_free_seq (reservation_t* reservationPtr);
 
 
+#ifdef RESERVATION_ESCROW
+/* =============================================================================
+ * reservation_escrowBegin
+ * -- Returns the seats taken by an aborted attempt and drops the seats it
+ *    would have returned; first thing in the transaction
+ * =============================================================================
+ */
+TM_PURE
+void
+reservation_escrowBegin ();
+
+
+/* =============================================================================
+ * reservation_escrowCommit
+ * -- Keeps the seats taken and returns the seats freed; after the commit
+ * =============================================================================
+ */
+void
+reservation_escrowCommit ();
+
+
+/* =============================================================================
+ * reservation_escrowExit
+ * -- Frees the calling thread's escrow buffer
+ * =============================================================================
+ */
+void
+reservation_escrowExit ();
+
+
+#  define RESERVATION_ESCROW_BEGIN()    reservation_escrowBegin()
+#  define RESERVATION_ESCROW_COMMIT()   reservation_escrowCommit()
+#  define RESERVATION_ESCROW_EXIT()     reservation_escrowExit()
+#  define RESERVATION_PEEK_NUM_FREE(r) \
+    __atomic_load_n(&(r)->numFree, __ATOMIC_RELAXED)
+#  define RESERVATION_READ_NUM_FREE(r) \
+    ((long)TM_SHARED_READ_TAG((r)->numTotal, r) - \
+     (long)TM_SHARED_READ_TAG((r)->numUsed, r))
+#  define HTMRESERVATION_READ_NUM_FREE(r) \
+    ((long)HTM_SHARED_READ((r)->numTotal) - (long)HTM_SHARED_READ((r)->numUsed))
+#else /* !RESERVATION_ESCROW */
+#  define RESERVATION_ESCROW_BEGIN()    /* nothing */
+#  define RESERVATION_ESCROW_COMMIT()   /* nothing */
+#  define RESERVATION_ESCROW_EXIT()     /* nothing */
+#  define RESERVATION_PEEK_NUM_FREE(r) \
+    ((long)TM_SHARED_READ_TAG((r)->numFree, r))
+#  define RESERVATION_READ_NUM_FREE(r) \
+    ((long)TM_SHARED_READ_TAG((r)->numFree, r))
+#  define HTMRESERVATION_READ_NUM_FREE(r) \
+    ((long)HTM_SHARED_READ((r)->numFree))
+#endif /* !RESERVATION_ESCROW */
+
+
 #define RESERVATION_INFO_ALLOC_SEQ(type, id, price) \
     reservation_info_alloc_seq(type, id, price)
 
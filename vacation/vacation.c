@@ -82,12 +82,32 @@
 #include "operation.h"
 #include "random.h"
 #include "reservation.h"
+#include "sampler.h"
 #include "thread.h"
 #include "timer.h"
 #include "tm.h"
 #include "types.h"
 #include "utility.h"
 
+#if defined(PERSISTENT) && defined(MANAGER_SHARDED)
+#  error "MANAGER_SHARDED does not support PERSISTENT"
+#endif
+
+#if defined(PERSISTENT) && defined(MANAGER_SNAPSHOT)
+#  error "MANAGER_SNAPSHOT does not support PERSISTENT"
+#endif
+
+#if defined(PERSISTENT) && defined(MANAGER_DURABLE)
+#  error "MANAGER_DURABLE replaces PERSISTENT"
+#endif
+
+#ifdef MANAGER_DURABLE
+#  include "redolog.h"
+#  ifndef DURABLE_DIR
+#    define DURABLE_DIR     "vacation.durable"
+#  endif
+#endif /* MANAGER_DURABLE */
+
 #ifdef PERSISTENT
 #include <libpmemobj.h>
 #include <sys/stat.h>
@@ -107,15 +127,22 @@ typedef struct root {
 #endif /* PERSISTENT */
 
 enum param_types {
+    PARAM_HOTACCESS    = (unsigned char)'a',
     PARAM_CLIENTS      = (unsigned char)'c',
+    PARAM_GROUP        = (unsigned char)'g',
+    PARAM_HOTSET       = (unsigned char)'h',
+    PARAM_LOAD         = (unsigned char)'l',
     PARAM_NUMBER       = (unsigned char)'n',
     PARAM_QUERIES      = (unsigned char)'q',
     PARAM_RELATIONS    = (unsigned char)'r',
+    PARAM_SHARDS       = (unsigned char)'s',
     PARAM_TRANSACTIONS = (unsigned char)'t',
     PARAM_USER         = (unsigned char)'u',
+    PARAM_ZIPF         = (unsigned char)'z',
 };
 
 #define PARAM_DEFAULT_CLIENTS      (1)
+#define PARAM_DEFAULT_GROUP        (0)
 #define PARAM_DEFAULT_NUMBER       (10)
 #define PARAM_DEFAULT_QUERIES      (90)
 #ifdef PERSISTENT
@@ -126,9 +153,26 @@ enum param_types {
 # define PARAM_DEFAULT_TRANSACTIONS (1 << 26)
 #endif /* PERSISTENT */
 #define PARAM_DEFAULT_USER         (80)
+#define PARAM_DEFAULT_SHARDS       (1)
+#define PARAM_DEFAULT_LOAD         (0)
+#define PARAM_DEFAULT_HOTACCESS    (90)
+#define PARAM_DEFAULT_HOTSET       (0)
+#define PARAM_DEFAULT_ZIPF         (0)
 
 double global_params[256]; /* 256 = ascii limit */
 
+static sampler_t* global_idSamplerPtr = NULL; /* shared by all clients */
+
+#ifdef MANAGER_DURABLE
+static redolog_t* global_logPtr = NULL;
+#endif
+
+#ifdef CLIENT_PHASES
+static const char* global_phaseScript = NULL;
+static client_phase_t* global_phases = NULL; /* shared by all clients */
+static long global_numPhase = 0;
+#endif
+
 
 HTM_STATS(global_tsx_status);
 
@@ -142,18 +186,40 @@ displayUsage (const char* appName)
 {
     printf("Usage: %s [options]\n", appName);
     puts("\nOptions:                                             (defaults)\n");
+    printf("    a <UINT>   Percentage of [a]ccesses to hot set   (%i)\n",
+           PARAM_DEFAULT_HOTACCESS);
     printf("    c <UINT>   Number of [c]lients                   (%i)\n",
            PARAM_DEFAULT_CLIENTS);
+#ifdef MANAGER_DURABLE
+    printf("    g <UINT>   [g]roup commit interval in us         (%i)\n",
+           PARAM_DEFAULT_GROUP);
+#endif
+    printf("    h <UINT>   Percentage of ids in [h]ot set, 0=off (%i)\n",
+           PARAM_DEFAULT_HOTSET);
+#ifdef CLIENT_OPEN_LOOP
+    printf("    l <UINT>   Offered [l]oad in transactions/s      (%i)\n",
+           PARAM_DEFAULT_LOAD);
+#endif
     printf("    n <UINT>   [n]umber of user queries/transaction  (%i)\n",
            PARAM_DEFAULT_NUMBER);
+#ifdef CLIENT_PHASES
+    puts("    p <STR>    [p]hase script, replaces t            (none)\n"
+         "               e.g. 10s:u=98,10s:u=60,1000t:u=0:d=100");
+#endif
     printf("    q <UINT>   Percentage of relations [q]ueried     (%i)\n",
            PARAM_DEFAULT_QUERIES);
     printf("    r <UINT>   Number of possible [r]elations        (%i)\n",
            PARAM_DEFAULT_RELATIONS);
+#ifdef MANAGER_SHARDED
+    printf("    s <UINT>   Number of [s]hards per table          (%i)\n",
+           PARAM_DEFAULT_SHARDS);
+#endif
     printf("    t <UINT>   Number of [t]ransactions              (%i)\n",
            PARAM_DEFAULT_TRANSACTIONS);
     printf("    u <UINT>   Percentage of [u]ser transactions     (%i)\n",
            PARAM_DEFAULT_USER);
+    printf("    z <FLT>    [z]ipf exponent of ids, 0=uniform     (%i)\n",
+           PARAM_DEFAULT_ZIPF);
     exit(1);
 }
 
@@ -165,12 +231,18 @@ displayUsage (const char* appName)
 static void
 setDefaultParams ()
 {
+    global_params[PARAM_HOTACCESS]    = PARAM_DEFAULT_HOTACCESS;
     global_params[PARAM_CLIENTS]      = PARAM_DEFAULT_CLIENTS;
+    global_params[PARAM_GROUP]        = PARAM_DEFAULT_GROUP;
+    global_params[PARAM_HOTSET]       = PARAM_DEFAULT_HOTSET;
+    global_params[PARAM_LOAD]         = PARAM_DEFAULT_LOAD;
     global_params[PARAM_NUMBER]       = PARAM_DEFAULT_NUMBER;
     global_params[PARAM_QUERIES]      = PARAM_DEFAULT_QUERIES;
     global_params[PARAM_RELATIONS]    = PARAM_DEFAULT_RELATIONS;
+    global_params[PARAM_SHARDS]       = PARAM_DEFAULT_SHARDS;
     global_params[PARAM_TRANSACTIONS] = PARAM_DEFAULT_TRANSACTIONS;
     global_params[PARAM_USER]         = PARAM_DEFAULT_USER;
+    global_params[PARAM_ZIPF]         = PARAM_DEFAULT_ZIPF;
 }
 
 
@@ -188,16 +260,35 @@ parseArgs (long argc, char* const argv[])
 
     setDefaultParams();
 
-    while ((opt = getopt(argc, argv, "c:n:q:r:t:u:")) != -1) {
+    while ((opt = getopt(argc, argv, "a:c:g:h:l:n:p:q:r:s:t:u:z:")) != -1) {
         switch (opt) {
+            case 'a':
             case 'c':
+#ifdef MANAGER_DURABLE
+            case 'g':
+#endif
+            case 'h':
+#ifdef CLIENT_OPEN_LOOP
+            case 'l':
+#endif
             case 'n':
             case 'q':
             case 'r':
+#ifdef MANAGER_SHARDED
+            case 's':
+#endif
             case 't':
             case 'u':
                 global_params[(unsigned char)opt] = atol(optarg);
                 break;
+            case 'z':
+                global_params[(unsigned char)opt] = atof(optarg);
+                break;
+#ifdef CLIENT_PHASES
+            case 'p':
+                global_phaseScript = optarg;
+                break;
+#endif
             case '?':
             default:
                 opterr++;
@@ -210,12 +301,60 @@ parseArgs (long argc, char* const argv[])
         opterr++;
     }
 
+    if (global_params[PARAM_SHARDS] < 1) {
+        fprintf(stderr, "Need at least one shard\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_HOTSET] < 0 || global_params[PARAM_HOTSET] > 100 ||
+        global_params[PARAM_HOTACCESS] < 0 || global_params[PARAM_HOTACCESS] > 100)
+    {
+        fprintf(stderr, "Hot set percentages must be within [0, 100]\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_ZIPF] < 0) {
+        fprintf(stderr, "Zipf exponent cannot be negative\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_HOTSET] > 0 && global_params[PARAM_ZIPF] > 0) {
+        fprintf(stderr, "Choose either a hot set or a Zipf exponent\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_LOAD] < 0) {
+        fprintf(stderr, "Offered load cannot be negative\n");
+        opterr++;
+    }
+
+    if (global_params[PARAM_GROUP] < 0) {
+        fprintf(stderr, "Group commit interval cannot be negative\n");
+        opterr++;
+    }
+
+#ifdef CLIENT_PHASES
+    if (global_phaseScript != NULL) {
+        global_phases =
+            client_parsePhases(global_phaseScript,
+                               (long)global_params[PARAM_CLIENTS],
+                               (long)global_params[PARAM_USER],
+                               (long)global_params[PARAM_NUMBER],
+                               &global_numPhase);
+        if (global_phases == NULL) {
+            fprintf(stderr, "Malformed phase script: %s\n", global_phaseScript);
+            opterr++;
+        }
+    }
+#endif
+
     if (opterr) {
         displayUsage(argv[0]);
     }
 }
 
 
+#if !defined(USE_BULK_LOAD) || defined(PERSISTENT)
 /* =============================================================================
  * addCustomer
  * -- Wrapper function
@@ -230,6 +369,92 @@ addCustomer (manager_t* managerPtr, long id, long num, long price)
     return manager_addCustomer_seq(managerPtr, id);
 #endif /* PERSISTENT */
 }
+#endif /* !USE_BULK_LOAD || PERSISTENT */
+
+
+#if defined(USE_BULK_LOAD) && !defined(PERSISTENT)
+
+#define RELATION_STREAM_CHUNK (4096)
+
+typedef bool_t (*loadTable_t)(manager_t*, long, const long*, const long*);
+
+typedef struct loadArg {
+    manager_t* managerPtr;
+    loadTable_t* loaders;
+    long numTable;
+    long numRelation;
+    long** nums;
+    long** prices;
+    unsigned long seed;
+} loadArg_t;
+
+
+/* =============================================================================
+ * loadCustomers
+ * -- Wrapper function
+ * =============================================================================
+ */
+static bool_t
+loadCustomers (manager_t* managerPtr, long numId, const long* nums, const long* prices)
+{
+    return manager_loadCustomers_seq(managerPtr, numId);
+}
+
+
+/* =============================================================================
+ * loadTables
+ * -- Each RELATION_STREAM_CHUNK of each table draws its values from its own
+ *    stream, so the tables do not depend on the number of threads
+ * -- Every id appears once per table, so tables are built in id order
+ *    instead of shuffling ids, one table per thread
+ * =============================================================================
+ */
+static void
+loadTables (void* argPtr)
+{
+    loadArg_t* loadArgPtr = (loadArg_t*)argPtr;
+    long myId = thread_getId();
+    long numThread = thread_getNumThread();
+    long numRelation = loadArgPtr->numRelation;
+    long numChunk = (numRelation + RELATION_STREAM_CHUNK - 1) / RELATION_STREAM_CHUNK;
+    unsigned long values[2 * RELATION_STREAM_CHUNK];
+    long c;
+    long t;
+
+    random_t* randomPtr = random_alloc();
+    assert(randomPtr != NULL);
+
+    for (c = myId; c < (loadArgPtr->numTable * numChunk); c += numThread) {
+        long* nums = loadArgPtr->nums[c / numChunk];
+        long* prices = loadArgPtr->prices[c / numChunk];
+        long start = (c % numChunk) * RELATION_STREAM_CHUNK;
+        long num = numRelation - start;
+        long i;
+        if (num > RELATION_STREAM_CHUNK) {
+            num = RELATION_STREAM_CHUNK;
+        }
+        random_seedStream(randomPtr, loadArgPtr->seed, c);
+        random_fill(randomPtr, values, (2 * num), 5);
+        for (i = 0; i < num; i++) {
+            nums[start + i] = (values[2 * i] + 1) * 100;
+            prices[start + i] = (values[2 * i + 1] * 10) + 50;
+        }
+    }
+
+    random_free(randomPtr);
+
+    thread_barrier_wait();
+
+    for (t = myId; t < loadArgPtr->numTable; t += numThread) {
+        bool_t status = loadArgPtr->loaders[t](loadArgPtr->managerPtr,
+                                               numRelation,
+                                               loadArgPtr->nums[t],
+                                               loadArgPtr->prices[t]);
+        assert(status);
+    }
+}
+
+#endif /* USE_BULK_LOAD && !PERSISTENT */
 
 
 /* =============================================================================
@@ -242,9 +467,22 @@ initializeManager (
     manager_t *managerPtr
 #endif /* PERSISTENT */
 ) {
-    long i;
     long numRelation;
     random_t* randomPtr;
+#if defined(USE_BULK_LOAD) && !defined(PERSISTENT)
+    loadTable_t loaders[] = {
+        &manager_loadCars_seq,
+        &manager_loadFlights_seq,
+        &manager_loadRooms_seq,
+        &loadCustomers
+    };
+    long numTable = sizeof(loaders) / sizeof(loaders[0]);
+    long* nums[sizeof(loaders) / sizeof(loaders[0])];
+    long* prices[sizeof(loaders) / sizeof(loaders[0])];
+    loadArg_t arg;
+    long t;
+#else /* !USE_BULK_LOAD || PERSISTENT */
+    long i;
     long* ids;
 #ifdef PERSISTENT
     bool_t (*manager_add[])(manager_t*, long, long, long) = {
@@ -263,6 +501,7 @@ initializeManager (
 #endif /* PERSISTENT */
     long t;
     long numTable = sizeof(manager_add) / sizeof(manager_add[0]);
+#endif /* !USE_BULK_LOAD || PERSISTENT */
 
     printf("Initializing manager... ");
     fflush(stdout);
@@ -273,11 +512,65 @@ initializeManager (
 #ifdef PERSISTENT
     manager_alloc(managerPtr);
 #else
+#  ifdef MANAGER_SHARDED
+    manager_t* managerPtr = manager_alloc((long)global_params[PARAM_SHARDS]);
+#  else
     manager_t* managerPtr = manager_alloc();
+#  endif
 #endif /* PERSISTENT */
     assert(managerPtr != NULL);
 
     numRelation = (long)global_params[PARAM_RELATIONS];
+
+#ifdef MANAGER_DURABLE
+    if (!manager_enableDurable_seq(managerPtr,
+                                   global_logPtr,
+                                   numRelation,
+                                   (long)global_params[PARAM_CLIENTS]))
+    {
+        fprintf(stderr, "\nCannot allocate durable state\n");
+        exit(1);
+    }
+    if (redolog_hasCheckpoint(global_logPtr)) {
+        long numApplied = manager_recoverDurable_seq(managerPtr);
+        if (numApplied < 0) {
+            fprintf(stderr, "\nCannot recover from %s; was it written with a "
+                    "larger -r?\n", DURABLE_DIR);
+            exit(1);
+        }
+        printf("recovered from %s with %li logged transactions... ",
+               DURABLE_DIR, numApplied);
+        fflush(stdout);
+        goto loaded;
+    }
+#endif /* MANAGER_DURABLE */
+
+#if defined(USE_BULK_LOAD) && !defined(PERSISTENT)
+    arg.managerPtr = managerPtr;
+    arg.loaders = loaders;
+    arg.numTable = numTable;
+    arg.numRelation = numRelation;
+    arg.nums = nums;
+    arg.prices = prices;
+    arg.seed = random_generate(randomPtr);
+    for (t = 0; t < numTable; t++) {
+        nums[t] = (long*)malloc(numRelation * sizeof(long));
+        prices[t] = (long*)malloc(numRelation * sizeof(long));
+        assert(nums[t] != NULL && prices[t] != NULL);
+    }
+#  ifdef OTM
+#pragma omp parallel
+    {
+        loadTables((void*)&arg);
+    }
+#  else
+    thread_start(loadTables, (void*)&arg);
+#  endif
+    for (t = 0; t < numTable; t++) {
+        free(nums[t]);
+        free(prices[t]);
+    }
+#else /* !USE_BULK_LOAD || PERSISTENT */
     ids = (long*)malloc(numRelation * sizeof(long));
     for (i = 0; i < numRelation; i++) {
         ids[i] = i + 1;
@@ -316,11 +609,29 @@ initializeManager (
 
     } /* for t */
 
+    free(ids);
+#endif /* !USE_BULK_LOAD || PERSISTENT */
+
+#ifdef MANAGER_DURABLE
+loaded:
+#endif
+#ifdef MANAGER_SNAPSHOT
+    if (!manager_enableSnapshots_seq(managerPtr, numRelation)) {
+        fprintf(stderr, "\nCannot allocate snapshots\n");
+        exit(1);
+    }
+#endif
+#ifdef MANAGER_DURABLE
+    if (!manager_startDurable_seq(managerPtr)) {
+        fprintf(stderr, "\nCannot checkpoint to %s\n", DURABLE_DIR);
+        exit(1);
+    }
+#endif
+
     puts("done.");
     fflush(stdout);
 
     random_free(randomPtr);
-    free(ids);
 
     return managerPtr;
 }
@@ -356,6 +667,19 @@ initializeClients (manager_t* managerPtr)
     numTransactionPerClient = (long)((double)numTransaction / (double)numClient + 0.5);
     queryRange = (long)((double)percentQuery / 100.0 * (double)numRelation + 0.5);
 
+    /* Skewed ids: the lowest ids are the hottest */
+    if (global_params[PARAM_ZIPF] > 0) {
+        global_idSamplerPtr = sampler_allocZipf(queryRange,
+                                                global_params[PARAM_ZIPF]);
+        assert(global_idSamplerPtr != NULL);
+    } else if (global_params[PARAM_HOTSET] > 0) {
+        global_idSamplerPtr =
+            sampler_allocHotspot(queryRange,
+                                 global_params[PARAM_HOTSET] / 100.0,
+                                 global_params[PARAM_HOTACCESS] / 100.0);
+        assert(global_idSamplerPtr != NULL);
+    }
+
     for (i = 0; i < numClient; i++) {
         clients[i] = client_alloc(i,
                                   managerPtr,
@@ -364,17 +688,56 @@ initializeClients (manager_t* managerPtr)
                                   queryRange,
                                   percentUser);
         assert(clients[i]  != NULL);
+        client_setIdSampler(clients[i], global_idSamplerPtr);
+#ifdef CLIENT_OPEN_LOOP
+        client_setArrivalRate(clients[i],
+                              global_params[PARAM_LOAD] / (double)numClient);
+#endif
+#ifdef CLIENT_PHASES
+        if (global_phases != NULL &&
+            !client_setPhases(clients[i], global_phases, global_numPhase))
+        {
+            fprintf(stderr, "\nCannot allocate phase statistics\n");
+            exit(1);
+        }
+#endif
     }
 
     puts("done.");
     printf("    Transactions        = %li\n", numTransaction);
     printf("    Clients             = %li\n", numClient);
     printf("    Transactions/client = %li\n", numTransactionPerClient);
+#ifdef CLIENT_PHASES
+    if (global_phases != NULL) {
+        printf("    Phases              = %s (instead of transactions)\n",
+               global_phaseScript);
+    }
+#endif
     printf("    Queries/transaction = %li\n", numQueryPerTransaction);
     printf("    Relations           = %li\n", numRelation);
+#ifdef MANAGER_SHARDED
+    printf("    Shards/table        = %li\n", (long)global_params[PARAM_SHARDS]);
+#endif
+#ifdef CLIENT_OPEN_LOOP
+    if (global_params[PARAM_LOAD] > 0) {
+        printf("    Offered load        = %li/s\n", (long)global_params[PARAM_LOAD]);
+    } else {
+        puts("    Offered load        = closed loop");
+    }
+#endif
     printf("    Query percent       = %li\n", percentQuery);
     printf("    Query range         = %li\n", queryRange);
     printf("    Percent user        = %li\n", percentUser);
+    if (global_params[PARAM_ZIPF] > 0) {
+        printf("    Id distribution     = Zipf, theta %g\n",
+               global_params[PARAM_ZIPF]);
+    } else if (global_params[PARAM_HOTSET] > 0) {
+        printf("    Id distribution     = %li%% of accesses to %li%% of ids\n",
+               (long)global_params[PARAM_HOTACCESS],
+               (long)global_params[PARAM_HOTSET]);
+    } else {
+        puts("    Id distribution     = uniform");
+    }
     fflush(stdout);
 
     random_free(randomPtr);
@@ -395,13 +758,12 @@ checkTables (manager_t* managerPtr)
     bool_t status = TRUE;
     long i;
     long numRelation = (long)global_params[PARAM_RELATIONS];
-    MAP_T* customerTablePtr = managerPtr->customerTablePtr;
-    MAP_T* tables[] = {
-        managerPtr->carTablePtr,
-        managerPtr->flightTablePtr,
-        managerPtr->roomTablePtr,
+    long types[] = {
+        RESERVATION_CAR,
+        RESERVATION_FLIGHT,
+        RESERVATION_ROOM
     };
-    long numTable = sizeof(tables) / sizeof(tables[0]);
+    long numTable = sizeof(types) / sizeof(types[0]);
     bool_t (*manager_add[])(manager_t*, long, long, long) = {
         &manager_addCar_seq,
         &manager_addFlight_seq,
@@ -413,11 +775,94 @@ checkTables (manager_t* managerPtr)
     fflush(stdout);
 
 #ifndef PERSISTENT
+#ifdef MANAGER_SNAPSHOT
+    /* Check that the snapshot words match the tables */
+    for (i = 1; i <= numRelation; i++) {
+        for (t = 0; t < numTable; t++) {
+            MAP_T* tablePtr = manager_getReservationTable(managerPtr, types[t], i);
+            reservation_t* r = (reservation_t*)MAP_FIND(tablePtr, i);
+            long price = -1;
+            long numFree = manager_snapshotQuery(managerPtr, types[t], i, &price);
+            if (r ? (numFree != r->numFree || price != r->price) : (numFree != -1)) {
+                status = FALSE;
+            }
+            assert(status);
+        }
+        if (manager_snapshotQueryCustomerBill(managerPtr, i) !=
+            manager_queryCustomerBill_seq(managerPtr, i))
+        {
+            status = FALSE;
+        }
+        assert(status);
+    }
+#endif /* MANAGER_SNAPSHOT */
+
+#ifdef MANAGER_DURABLE
+    /* Check that every reservation counts the customers holding it */
+    {
+        long* numHelds = (long*)calloc(NUM_RESERVATION_TYPE * (numRelation + 1),
+                                       sizeof(long));
+        long* infos = NULL;
+        long maxInfo = 0;
+        assert(numHelds != NULL);
+        for (i = 0; i <= numRelation; i++) {
+            customer_t* c = MAP_FIND(MANAGER_TABLE(managerPtr, customer, i), i);
+            long numInfo;
+            long k;
+            if (c == NULL) {
+                continue;
+            }
+            numInfo = CUSTOMER_COPY_RESERVATION_INFOS_SEQ(c, infos, maxInfo);
+            if (numInfo > maxInfo) {
+                maxInfo = numInfo;
+                infos = (long*)realloc(infos, 3 * maxInfo * sizeof(long));
+                assert(infos != NULL);
+                CUSTOMER_COPY_RESERVATION_INFOS_SEQ(c, infos, maxInfo);
+            }
+            for (k = 0; k < numInfo; k++) {
+                long type = infos[3 * k];
+                long id = infos[3 * k + 1];
+                assert(type >= 0 && type < NUM_RESERVATION_TYPE);
+                assert(id >= 0 && id <= numRelation);
+                numHelds[type * (numRelation + 1) + id]++;
+            }
+        }
+        for (t = 0; t < NUM_RESERVATION_TYPE; t++) {
+            for (i = 0; i <= numRelation; i++) {
+                MAP_T* tablePtr = manager_getReservationTable(managerPtr, t, i);
+                reservation_t* r = (reservation_t*)MAP_FIND(tablePtr, i);
+                long numHeld = numHelds[t * (numRelation + 1) + i];
+                if (r ? (r->numUsed != numHeld) : (numHeld != 0)) {
+                    status = FALSE;
+                }
+                assert(status);
+            }
+        }
+        free(infos);
+        free(numHelds);
+    }
+#endif /* MANAGER_DURABLE */
+
+#ifdef RESERVATION_ESCROW
+    /* Check that every seat taken from escrow was used or returned */
+    for (t = 0; t < numTable; t++) {
+        for (i = 1; i <= numRelation; i++) {
+            MAP_T* tablePtr = manager_getReservationTable(managerPtr, types[t], i);
+            reservation_t* r = (reservation_t*)MAP_FIND(tablePtr, i);
+            if (r && (r->numUsed + r->numFree) != r->numTotal) {
+                status = FALSE;
+            }
+            assert(status);
+        }
+    }
+#endif /* RESERVATION_ESCROW */
+
     /* Check for unique customer IDs */
     long percentQuery = (long)global_params[PARAM_QUERIES];
     long queryRange = (long)((double)percentQuery / 100.0 * (double)numRelation + 0.5);
     long maxCustomerId = queryRange + 1;
     for (i = 1; i <= maxCustomerId; i++) {
+        MAP_T* customerTablePtr = MANAGER_TABLE(managerPtr, customer, i);
         customer_t *c;
         if ((c = MAP_FIND(customerTablePtr, i))) {
             customer_free_seq(c);
@@ -430,8 +875,8 @@ checkTables (manager_t* managerPtr)
 
     /* Check reservation tables for consistency and unique ids */
     for (t = 0; t < numTable; t++) {
-        MAP_T* tablePtr = tables[t];
         for (i = 1; i <= numRelation; i++) {
+            MAP_T* tablePtr = manager_getReservationTable(managerPtr, types[t], i);
             reservation_t *r;
             if ((r = MAP_FIND(tablePtr, i))) {
                 status = status ? manager_add[t](managerPtr, i, 0, 0) : status; /* validate entry */
@@ -452,6 +897,127 @@ checkTables (manager_t* managerPtr)
 }
 
 
+#ifdef CLIENT_OPEN_LOOP
+/* =============================================================================
+ * printLatencies
+ * -- Merges the clients' histograms and prints percentiles per action, in us
+ * =============================================================================
+ */
+static void
+printLatencies (client_t** clients, double seconds)
+{
+    static const char* actionNames[NUM_ACTION] = {
+        "reserve", "delete", "update"
+    };
+    long numClient = (long)global_params[PARAM_CLIENTS];
+    unsigned long total = 0;
+    long a;
+    long i;
+
+    for (a = 0; a < NUM_ACTION; a++) {
+        for (i = 0; i < numClient; i++) {
+            total += histogram_getCount(clients[i]->latencies[a]);
+        }
+    }
+    printf("Throughput = %.0f transactions/s (%li clients)\n",
+           (double)total / seconds, numClient);
+    printf("    %-8s %10s %10s %10s %10s %10s\n",
+           "action", "count", "p50(us)", "p99(us)", "p99.9(us)", "max(us)");
+
+    for (a = 0; a < NUM_ACTION; a++) {
+        histogram_t* mergedPtr = histogram_alloc();
+        assert(mergedPtr != NULL);
+        for (i = 0; i < numClient; i++) {
+            histogram_merge(mergedPtr, clients[i]->latencies[a]);
+        }
+        printf("    %-8s %10lu %10.1f %10.1f %10.1f %10.1f\n",
+               actionNames[a],
+               histogram_getCount(mergedPtr),
+               histogram_getPercentile(mergedPtr, 50.0) / 1000.0,
+               histogram_getPercentile(mergedPtr, 99.0) / 1000.0,
+               histogram_getPercentile(mergedPtr, 99.9) / 1000.0,
+               histogram_getMax(mergedPtr) / 1000.0);
+        histogram_free(mergedPtr);
+    }
+}
+#endif /* CLIENT_OPEN_LOOP */
+
+
+#ifdef CLIENT_PHASES
+/* =============================================================================
+ * printPhases
+ * -- A phase lasts from the first client entering it to the last one leaving
+ * -- Requests count every action issued; 'served' are those that snapshots
+ *    answered without a transaction
+ * =============================================================================
+ */
+static void
+printPhases (client_t** clients)
+{
+    long numClient = (long)global_params[PARAM_CLIENTS];
+    long p;
+    long i;
+
+    printf("    %-5s %-8s %4s %4s %10s %9s %12s %10s %10s %10s %8s %8s\n",
+           "phase", "length", "u", "d", "seconds", "requests", "requests/s",
+           "reserve", "delete", "update", "served", "aborts");
+
+    for (p = 0; p < global_numPhase; p++) {
+        const client_phase_t* phasePtr = &global_phases[p];
+        unsigned long start = ~0UL;
+        unsigned long stop = 0;
+        long numRequest[NUM_ACTION] = { 0 };
+        long numServed = 0;
+        long numAbort = 0;
+        long total;
+        char length[32];
+        double seconds;
+        long a;
+
+        for (i = 0; i < numClient; i++) {
+            const client_phase_stats_t* statsPtr = &clients[i]->phaseStats[p];
+            if (statsPtr->startNs < start) {
+                start = statsPtr->startNs;
+            }
+            if (statsPtr->stopNs > stop) {
+                stop = statsPtr->stopNs;
+            }
+            for (a = 0; a < NUM_ACTION; a++) {
+                numRequest[a] += statsPtr->numRequest[a];
+                numServed += statsPtr->numServed[a];
+            }
+            numAbort += statsPtr->numAbort;
+        }
+        total = numRequest[ACTION_MAKE_RESERVATION] +
+                numRequest[ACTION_DELETE_CUSTOMER] +
+                numRequest[ACTION_UPDATE_TABLES];
+        seconds = (stop > start) ? ((double)(stop - start) / 1e9) : 0.0;
+
+        if (phasePtr->numTransaction > 0) {
+            snprintf(length, sizeof(length), "%lit",
+                     phasePtr->numTransaction * numClient);
+        } else {
+            snprintf(length, sizeof(length), "%gs",
+                     (double)phasePtr->durationNs / 1e9);
+        }
+        printf("    %-5li %-8s %4li ", (p + 1), length, phasePtr->percentUser);
+        if (phasePtr->percentDelete >= 0) {
+            printf("%4li", phasePtr->percentDelete);
+        } else {
+            printf("%4s", "-");
+        }
+        printf(" %10.3f %9li %12.0f %10li %10li %10li %8li %8li\n",
+               seconds, total, ((seconds > 0.0) ? (total / seconds) : 0.0),
+               numRequest[ACTION_MAKE_RESERVATION],
+               numRequest[ACTION_DELETE_CUSTOMER],
+               numRequest[ACTION_UPDATE_TABLES],
+               numServed,
+               numAbort);
+    }
+}
+#endif /* CLIENT_PHASES */
+
+
 /* =============================================================================
  * freeClients
  * =============================================================================
@@ -467,6 +1033,12 @@ freeClients (client_t** clients)
         client_free(clientPtr);
     }
     free(clients);
+    sampler_free(global_idSamplerPtr);
+    global_idSamplerPtr = NULL;
+#ifdef CLIENT_PHASES
+    free(global_phases);
+    global_phases = NULL;
+#endif
 }
 
 
@@ -535,6 +1107,13 @@ MAIN(argc, argv)
         rootp->glb_mgr_initialized = 1;
     }
 #else
+#  ifdef MANAGER_DURABLE
+    global_logPtr = redolog_open(DURABLE_DIR, (long)global_params[PARAM_GROUP]);
+    if (global_logPtr == NULL) {
+        fprintf(stderr, "Cannot open %s\n", DURABLE_DIR);
+        exit(1);
+    }
+#  endif
     managerPtr = initializeManager();
 #endif /* PERSISTENT */
 
@@ -560,6 +1139,24 @@ MAIN(argc, argv)
     puts("done.");
     printf("Transaction time = %f\n",
            TIMER_DIFF_SECONDS(start, stop));
+#ifdef CLIENT_OPEN_LOOP
+    printLatencies(clients, TIMER_DIFF_SECONDS(start, stop));
+#endif
+#ifdef CLIENT_PHASES
+    if (global_phases != NULL) {
+        printPhases(clients);
+    }
+#endif
+#ifdef MANAGER_DURABLE
+    {
+        long numRecord;
+        long numByte;
+        long numFlush;
+        redolog_getStats(global_logPtr, &numRecord, &numByte, &numFlush);
+        printf("Logged %li transactions, %li bytes, in %li flushes\n",
+               numRecord, numByte, numFlush);
+    }
+#endif
     fflush(stdout);
     bool_t status = checkTables(managerPtr);
     assert(status);
@@ -571,6 +1168,9 @@ MAIN(argc, argv)
     fflush(stdout);
     freeClients(clients);
     manager_free(managerPtr);
+#ifdef MANAGER_DURABLE
+    redolog_close(global_logPtr);
+#endif
     puts("done.");
     fflush(stdout);
 
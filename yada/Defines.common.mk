@@ -6,8 +6,11 @@
 
 
 CFLAGS += -DLIST_NO_DUPLICATES
-CFLAGS += -DMAP_USE_RBTREE
+CFLAGS += -DMAP_USE_RBTREE # or -DMAP_USE_ATREE, -DMAP_USE_SKIPLIST
+#CFLAGS += -DRBTREE_COMPACT
 CFLAGS += -DSET_USE_RBTREE
+#CFLAGS += -DHEAP_ARITY=4 -DHEAP_CACHED_KEY # or -DHEAP_USE_MULTIQUEUE
+#CFLAGS += -DRANDOM_USE_XOSHIRO # or -DRANDOM_USE_PCG, -DRANDOM_USE_PHILOX
 CFLAGS += -DMERGE_HEAP -DMERGE_LIST -DMERGE_RBTREE # -DMERGE_QUEUE -DMERGE_ELEMENT -DMERGE_MESH -DMERGE_REGION
 
 PROG := yada
@@ -17,13 +20,18 @@ SRCS += \
 	mesh.c \
 	region.c \
 	yada.c \
+	$(LIB)/atree.c \
 	$(LIB)/heap.c \
+	$(LIB)/mqheap.c \
 	$(LIB)/list.c \
+	$(LIB)/ulist.c \
 	$(LIB)/mt19937ar.c \
 	$(LIB)/pair.c \
 	$(LIB)/queue.c \
 	$(LIB)/random.c \
 	$(LIB)/rbtree.c \
+	$(LIB)/crbtree.c \
+	$(LIB)/skiplist.c \
 	$(LIB)/thread.c \
 	$(LIB)/vector.c \
 #
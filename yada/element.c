@@ -659,6 +659,21 @@ element_heapCompare (const void* aPtr, const void* bPtr)
 }
 
 
+/* =============================================================================
+ * element_heapKey
+ *
+ * Cached priority for heap_setKey, agrees with element_heapCompare
+ * =============================================================================
+ */
+long
+element_heapKey (const void* aPtr)
+{
+    element_t* elementPtr = (element_t*)aPtr;
+
+    return ((elementPtr->encroachedEdgePtr) ? 1 : 0);
+}
+
+
 /* =============================================================================
  * element_isInCircumCircle
  * =============================================================================
@@ -236,6 +236,16 @@ long
 element_heapCompare (const void* aPtr, const void* bPtr);
 
 
+/* =============================================================================
+ * element_heapKey
+ *
+ * Cached priority for heap_setKey, agrees with element_heapCompare
+ * =============================================================================
+ */
+long
+element_heapKey (const void* aPtr);
+
+
 /* =============================================================================
  * element_isInCircumCircle
  * =============================================================================
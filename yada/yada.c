@@ -356,6 +356,7 @@ MAIN(argc, argv)
     puts("done.");
     global_workHeapPtr = heap_alloc(1, &element_heapCompare);
     assert(global_workHeapPtr);
+    heap_setKey(global_workHeapPtr, &element_heapKey);
     long initNumBadElement = initializeWork(global_workHeapPtr, global_meshPtr);
 
     printf("Initial number of mesh elements = %li\n", initNumElement);